@@ -138,7 +138,7 @@ A1_T_ERROR A1RV32Settings::GetInstructions(const std::wstring &inst_sign, std::v
 
 
 A1RV32Settings global_settings;
-A1Settings &_global_settings = global_settings;
+A1Settings &_a1_global_settings = global_settings;
 
 
 static void b1_print_version(FILE *fstr)
@@ -854,7 +854,7 @@ public:
 
 static void load_RV32_instructions()
 {
-	if(_global_settings.GetCompressed())
+	if(_a1_global_settings.GetCompressed())
 	{
 		ADD_INST(L"C.ADDI4SPNXV,XV,V", L"0:3 {3:5:2} {3:9:4} {3:2:1} {3:3:1} {1:2:3} 0:2", RV32ArgType::AT_RV32_COMP_REG, RV32ArgType::AT_RV32_REG_SP, RV32ArgType::AT_RV32_10BIT_UVAL4);
 		// ADDI rd', SP, <nzuimm10> (<nzuimm10> is a multiple of 4)
@@ -1029,7 +1029,7 @@ static void load_RV32_instructions()
 
 
 	// Zmmul or M
-	if(_global_settings.GetMultiplication())
+	if(_a1_global_settings.GetMultiplication())
 	{
 		ADD_INST(L"MULXV,XV,XV", L"1:7 {3:4:5} {2:4:5} 0:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG);
 		ADD_INST(L"MULHXV,XV,XV", L"1:7 {3:4:5} {2:4:5} 1:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG);
@@ -1037,7 +1037,7 @@ static void load_RV32_instructions()
 		ADD_INST(L"MULHSUXV,XV,XV", L"1:7 {3:4:5} {2:4:5} 2:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG);
 	}
 
-	if(_global_settings.GetDivision())
+	if(_a1_global_settings.GetDivision())
 	{
 		ADD_INST(L"DIVXV,XV,XV", L"1:7 {3:4:5} {2:4:5} 4:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG);
 		ADD_INST(L"DIVUXV,XV,XV", L"1:7 {3:4:5} {2:4:5} 5:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG);
@@ -1047,7 +1047,7 @@ static void load_RV32_instructions()
 
 
 	// compressed instructions to use instead of 32-bit ones
-	if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst() && _global_settings.GetFixAddresses())
+	if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst() && _a1_global_settings.GetFixAddresses())
 	{
 		// C.J
 		ADD_INSTI(0, L"JV", L"5:3 {1:B:1} {1:4:1} {1:9:2} {1:A:1} {1:6:1} {1:7:1} {1:3:3} {1:5:1} 1:2", RV32ArgType::AT_RV32_12BIT_OFF);
@@ -1081,7 +1081,7 @@ static void load_RV32_instructions()
 	ADD_INST2(L"LIXV,V",		L"{2.H20:13:8} {2.H20:B:8} {2.H20:3:4} {1:4:5} 37:7 | {2.L12:B:4} {2.L12:7:8} {1:4:5} 0:3 {1:4:5} 13:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
 	// (for <value32>.L12 == 0) LI rd, <value32>: LUI rd, <value32>.H20
 	ADD_IDER(RV32Inst2L0, 1, L"LIXV,V", L"{2.H20:13:8} {2.H20:B:8} {2.H20:3:4} {1:4:5} 37:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
-	if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+	if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 	{
 		// (for <value32>.L12 == [-32..31]) LA rd, <value32>: LUI rd, <value32>.H20 + C.ADDI rd, <value32>.L12
 		ADD_IDER(RV32Inst2L6, 2, L"LAXV,V", L"{2.H20:13:8} {2.H20:B:8} {2.H20:3:4} {1:4:5} 37:7 | 0:3 {2.L12:5:1} {1:4:5} {2.L12:4:5} 1:2", RV32ArgType::AT_RV32_REG_NZ, RV32ArgType::AT_RV32_4BYTE_VAL);
@@ -1123,7 +1123,7 @@ static void load_RV32_instructions()
 	ADD_INST(L"SHXV,V", L"{2:B:7} {1:4:5} 0:5 1:3 {2:4:5} 23:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_12BIT_VAL);
 	ADD_INST(L"SWXV,V", L"{2:B:7} {1:4:5} 0:5 2:3 {2:4:5} 23:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_12BIT_VAL);
 
-	if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+	if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 	{
 		// RET: C.JR X1
 		ADD_INST(L"RET", L"4:3 0:1 1:5 0:5 2:2");
@@ -1136,14 +1136,14 @@ static void load_RV32_instructions()
 	}
 
 
-	if(_global_settings.GetFixAddresses())
+	if(_a1_global_settings.GetFixAddresses())
 	{
 		// (for rd != rs) ADDI rd, rs, <value32>: LUI rd, <value32>.H20 + ADDI rd, rd, <value32>.L12 + ADD rd, rd, rs
 		ADD_IDER(RV32Inst12Ne, 3, L"ADDIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} {1:4:5} 37:7 | {3.L12:B:4} {3.L12:7:8} {1:4:5} 0:3 {1:4:5} 13:7 | 0:7 {1:4:5} {2:4:5} 0:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
 		// (for rd != rs, <value32>.L12 == 0) ADDI rd, rs, <value32>: LUI rd, <value32>.H20 + ADD rd, rd, rs
 		ADD_IDER(RV32Inst12Ne3L0, 2, L"ADDIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} {1:4:5} 37:7 | 0:7 {1:4:5} {2:4:5} 0:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
 
-		if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+		if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 		{
 			// (for rd != rs) ADDI rd, rs, <value32>: LUI rd, <value32>.H20 + ADDI rd, rd, <value32>.L12 + C.ADD rd, rs
 			ADD_IDER(RV32Inst12Ne, 3, L"ADDIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} {1:4:5} 37:7 | {3.L12:B:4} {3.L12:7:8} {1:4:5} 0:3 {1:4:5} 13:7 | 4:3 1:1 {1:4:5} {2:4:5} 2:2", RV32ArgType::AT_RV32_REG_NZ, RV32ArgType::AT_RV32_REG_NZ, RV32ArgType::AT_RV32_4BYTE_VAL);
@@ -1166,7 +1166,7 @@ static void load_RV32_instructions()
 		// (for rd != rs, <value32>.L12 == 0) ORI rd, rs, <value32>: LUI rd, <value32>.H20 + OR rd, rd, rs
 		ADD_IDER(RV32Inst12Ne3L0, 2, L"ORIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} {1:4:5} 37:7 | 0:7 {2:4:5} {1:4:5} 6:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
 
-		if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+		if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 		{
 			// (for rd != rs) ORI rd, rs, <value32>: LUI rd, <value32>.H20 + ADDI rd, rd, <value32>.L12 + C.OR rd, rs
 			ADD_IDER(RV32Inst12Ne, 3, L"ORIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} {1:4:5} 37:7 | {3.L12:B:4} {3.L12:7:8} {1:4:5} 0:3 {1:4:5} 13:7 | 4:3 0:1 3:2 {1:2:3} 2:2 {2:2:3} 1:2", RV32ArgType::AT_RV32_COMP_REG, RV32ArgType::AT_RV32_COMP_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
@@ -1189,7 +1189,7 @@ static void load_RV32_instructions()
 		// (for rd != rs, <value32>.L12 == 0) XORI rd, rs, <value32>: LUI rd, <value32>.H20 + XOR rd, rd, rs
 		ADD_IDER(RV32Inst12Ne3L0, 2, L"XORIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} {1:4:5} 37:7 | 0:7 {2:4:5} {1:4:5} 4:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
 
-		if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+		if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 		{
 			// (for rd != rs) XORI rd, rs, <value32>: LUI rd, <value32>.H20 + ADDI rd, rd, <value32>.L12 + C.XOR rd, rs
 			ADD_IDER(RV32Inst12Ne, 3, L"XORIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} {1:4:5} 37:7 | {3.L12:B:4} {3.L12:7:8} {1:4:5} 0:3 {1:4:5} 13:7 | 4:3 0:1 3:2 {1:2:3} 1:2 {2:2:3} 1:2", RV32ArgType::AT_RV32_COMP_REG, RV32ArgType::AT_RV32_COMP_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
@@ -1212,7 +1212,7 @@ static void load_RV32_instructions()
 		// (for rd != rs, <value32>.L12 == 0) ANDI rd, rs, <value32>: LUI rd, <value32>.H20 + AND rd, rd, rs
 		ADD_IDER(RV32Inst12Ne3L0, 2, L"ANDIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} {1:4:5} 37:7 | 0:7 {2:4:5} {1:4:5} 7:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
 
-		if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+		if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 		{
 			// (for rd != rs) ANDI rd, rs, <value32>: LUI rd, <value32>.H20 + ADDI rd, rd, <value32>.L12 + C.AND rd, rs
 			ADD_IDER(RV32Inst12Ne, 3, L"ANDIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} {1:4:5} 37:7 | {3.L12:B:4} {3.L12:7:8} {1:4:5} 0:3 {1:4:5} 13:7 | 4:3 0:1 3:2 {1:2:3} 3:2 {2:2:3} 1:2", RV32ArgType::AT_RV32_COMP_REG, RV32ArgType::AT_RV32_COMP_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
@@ -1252,7 +1252,7 @@ static void load_RV32_instructions()
 		// (for rd != rs) LHU rd, <value32>(rs): LUI rd, <value32>.H20 + ADD rd, rd, rs + LHU rd, <value32>.L12(rd)
 		ADD_IDER(RV32Inst13Ne, 3, L"LHUXV,V(XV)", L"{2.H20:13:8} {2.H20:B:8} {2.H20:3:4} {1:4:5} 37:7 | 0:7 {3:4:5} {1:4:5} 0:3 {1:4:5} 33:7 | {2.L12:B:4} {2.L12:7:8} {1:4:5} 5:3 {1:4:5} 3:7", RV32ArgType::AT_RV32_REG_NZ, RV32ArgType::AT_RV32_4BYTE_VAL, RV32ArgType::AT_RV32_REG);
 
-		if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+		if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 		{
 			// (for rd != rs) LB rd, <value32>(rs): LUI rd, <value32>.H20 + C.ADD rd, rs + LB rd, <value32>.L12(rd)
 			ADD_IDERC(RV32Inst13Ne, 3, L"LBXV,V(XV)", L"{2.H20:13:8} {2.H20:B:8} {2.H20:3:4} {1:4:5} 37:7 | 4:3 1:1 {1:4:5} {3:4:5} 2:2 | {2.L12:B:4} {2.L12:7:8} {1:4:5} 0:3 {1:4:5} 3:7", RV32ArgType::AT_RV32_REG_NZ, RV32ArgType::AT_RV32_4BYTE_VAL, RV32ArgType::AT_RV32_REG_NZ);
@@ -1279,7 +1279,7 @@ static void load_RV32_instructions()
 		// (for rd == rs, <value32>.L12 == 0) ADDI r, r, <value32>: LUI T0, <value32>.H20 + ADD r, r, T0
 		ADD_IDER(RV32Inst12Eq3L0, 2, L"ADDIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} 5:5 37:7 | 0:7 5:5 {2:4:5} 0:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
 
-		if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+		if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 		{
 			// (for rd == rs) ADDI r, r, <value32>: LUI T0, <value32>.H20 + ADDI r, r, <value32>.L12 + C.ADD r, T0
 			ADD_IDER(RV32Inst12EqNT0, 3, L"ADDIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} 5:5 37:7 | {3.L12:B:4} {3.L12:7:8} {1:4:5} 0:3 {1:4:5} 13:7 | 4:3 1:1 {1:4:5} 5:5 2:2", RV32ArgType::AT_RV32_REG_NZ, RV32ArgType::AT_RV32_REG_NZ, RV32ArgType::AT_RV32_4BYTE_VAL);
@@ -1302,7 +1302,7 @@ static void load_RV32_instructions()
 		// (for rd == rs, <value32>.L12 == 0) ORI r, r, <value32>: LUI T0, <value32>.H20 + OR r, r, T0
 		ADD_IDER(RV32Inst12Eq3L0, 2, L"ORIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} 5:5 37:7 | 0:7 5:5 {1:4:5} 6:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
 
-		if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+		if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 		{
 			// (for rd == rs, <value32>.H20 == [-32..31], <value32>.L12 == 0) ORI r, r, <value32>: C.LUI T0, <value32>.H20 + OR r, r, T0
 			ADD_IDER(RV32Inst12Eq3H6NZL0, 2, L"ORIXV,XV,V", L"3:3 {3.H20:5:1} 5:5 {3.H20:4:5} 1:2 | 0:7 5:5 {1:4:5} 6:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
@@ -1320,7 +1320,7 @@ static void load_RV32_instructions()
 		// (for rd == rs, <value32>.L12 == 0) XORI r, r, <value32>: LUI T0, <value32>.H20 + XOR r, r, T0
 		ADD_IDER(RV32Inst12Eq3L0, 2, L"XORIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} 5:5 37:7 | 0:7 5:5 {1:4:5} 4:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
 
-		if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+		if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 		{
 			// (for rd == rs, <value32>.H20 == [-32..31], <value32>.L12 == 0) XORI r, r, <value32>: C.LUI T0, <value32>.H20 + XOR r, r, T0
 			ADD_IDER(RV32Inst12Eq3H6NZL0, 2, L"XORIXV,XV,V", L"3:3 {3.H20:5:1} 5:5 {3.H20:4:5} 1:2 | 0:7 5:5 {1:4:5} 4:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
@@ -1338,7 +1338,7 @@ static void load_RV32_instructions()
 		// (for rd == rs, <value32>.L12 == 0) ANDI r, r, <value32>: LUI T0, <value32>.H20 + AND r, r, T0
 		ADD_IDER(RV32Inst12Eq3L0, 2, L"ANDIXV,XV,V", L"{3.H20:13:8} {3.H20:B:8} {3.H20:3:4} 5:5 37:7 | 0:7 5:5 {1:4:5} 7:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
 
-		if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+		if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 		{
 			// (for rd == rs, <value32>.H20 == [-32..31], <value32>.L12 == 0) ANDI r, r, <value32>: C.LUI T0, <value32>.H20 + AND r, r, T0
 			ADD_IDER(RV32Inst12Eq3H6NZL0, 2, L"ANDIXV,XV,V", L"3:3 {3.H20:5:1} 5:5 {3.H20:4:5} 1:2 | 0:7 5:5 {1:4:5} 7:3 {1:4:5} 33:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL);
@@ -1398,7 +1398,7 @@ static void load_RV32_instructions()
 		// LHU ZERO, <value32>(rs): LUI T0, <value32>.H20 + ADD T0, T0, rs + LHU ZERO, <value32>.L12(T0)
 		ADD_IDER(RV32Inst13NeNT0, 3, L"LHUXV,V(XV)", L"{2.H20:13:8} {2.H20:B:8} {2.H20:3:4} 5:5 37:7 | 0:7 {3:4:5} 5:5 0:3 5:5 33:7 | {2.L12:B:4} {2.L12:7:8} 5:5 5:3 0:5 3:7", RV32ArgType::AT_RV32_REG_Z, RV32ArgType::AT_RV32_4BYTE_VAL, RV32ArgType::AT_RV32_REG);
 
-		if(_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
+		if(_a1_global_settings.GetCompressed() && global_settings.GetAutoCompInst())
 		{
 			// SB rs1, <value32>(rs2): LUI T0, <value32>.H20 + C.ADD T0, rs2 + SB rs1, <value32>.L12(T0)
 			ADD_IDER(RV32Inst13NeNT0, 3, L"SBXV,V(XV)", L"{2.H20:13:8} {2.H20:B:8} {2.H20:3:4} 5:5 37:7 | 4:3 1:1 5:5 {3:4:5} 2:2 | {2.L12:B:7} {1:4:5} 5:5 0:3 {2.L12:4:5} 23:7", RV32ArgType::AT_RV32_REG, RV32ArgType::AT_RV32_4BYTE_VAL, RV32ArgType::AT_RV32_REG_NZ);
@@ -1476,7 +1476,7 @@ static void load_registers()
 	ADD_REG(L"A4", 14);
 	ADD_REG(L"A5", 15);
 
-	if(!_global_settings.GetEmbedded())
+	if(!_a1_global_settings.GetEmbedded())
 	{
 		ADD_REG(L"X16", 16);
 		ADD_REG(L"X17", 17);
@@ -1555,7 +1555,7 @@ protected:
 		while(true)
 		{
 			std::vector<const Inst *> insts;
-			auto err = _global_settings.GetInstructions(signature, insts, line_num, file_name);
+			auto err = _a1_global_settings.GetInstructions(signature, insts, line_num, file_name);
 			if(err != A1_T_ERROR::A1_RES_OK)
 			{
 				return err;
@@ -1643,7 +1643,7 @@ protected:
 				{
 					break;
 				}
-				_global_settings.AddInstToReplace(line_num, file_name, _inst);
+				_a1_global_settings.AddInstToReplace(line_num, file_name, _inst);
 				continue;
 			}
 
@@ -1960,7 +1960,7 @@ int main(int argc, char **argv)
 				(argv[i][1] == 'F' || argv[i][1] == 'f') &&
 				argv[i][2] == 0)
 			{
-				_global_settings.SetFixAddresses();
+				_a1_global_settings.SetFixAddresses();
 				continue;
 			}
 
@@ -2062,7 +2062,7 @@ int main(int argc, char **argv)
 						args_error = true;
 						args_error_txt = "wrong RAM size";
 					}
-					_global_settings.SetRAMSize(n);
+					_a1_global_settings.SetRAMSize(n);
 				}
 
 				continue;
@@ -2088,7 +2088,7 @@ int main(int argc, char **argv)
 						args_error = true;
 						args_error_txt = "wrong RAM starting address";
 					}
-					_global_settings.SetRAMStart(n);
+					_a1_global_settings.SetRAMStart(n);
 				}
 
 				continue;
@@ -2114,7 +2114,7 @@ int main(int argc, char **argv)
 						args_error = true;
 						args_error_txt = "wrong ROM size";
 					}
-					_global_settings.SetROMSize(n);
+					_a1_global_settings.SetROMSize(n);
 				}
 
 				continue;
@@ -2140,7 +2140,7 @@ int main(int argc, char **argv)
 						args_error = true;
 						args_error_txt = "wrong ROM starting address";
 					}
-					_global_settings.SetROMStart(n);
+					_a1_global_settings.SetROMStart(n);
 				}
 
 				continue;
@@ -2183,9 +2183,9 @@ int main(int argc, char **argv)
 	}
 
 
-	_global_settings.SetTargetName("RV32");
-	_global_settings.SetMCUName(MCU_name);
-	_global_settings.SetLibDirRoot(lib_dir);
+	_a1_global_settings.SetTargetName("RV32");
+	_a1_global_settings.SetMCUName(MCU_name);
+	_a1_global_settings.SetLibDirRoot(lib_dir);
 
 	// load target-specific stuff
 	if(!select_target(global_settings))
@@ -2237,15 +2237,15 @@ int main(int argc, char **argv)
 		return 0;
 	}
 
-	_global_settings.InitLibDirs();
+	_a1_global_settings.InitLibDirs();
 
 	// read settings file if specified
 	if(!MCU_name.empty())
 	{
-		auto file_name = _global_settings.GetLibFileName(MCU_name, ".cfg");
+		auto file_name = _a1_global_settings.GetLibFileName(MCU_name, ".cfg");
 		if(!file_name.empty())
 		{
-			auto err = static_cast<A1_T_ERROR>(_global_settings.Read(file_name));
+			auto err = static_cast<A1_T_ERROR>(_a1_global_settings.Read(file_name));
 			if(err != A1_T_ERROR::A1_RES_OK)
 			{
 				a1_print_error(err, -1, file_name, print_err_desc);
@@ -2253,7 +2253,7 @@ int main(int argc, char **argv)
 			}
 
 			std::wstring ext;
-			_global_settings.GetValue(L"EXTENSIONS", ext);
+			_a1_global_settings.GetValue(L"EXTENSIONS", ext);
 			if(!ext.empty())
 			{
 				extensions = Utils::str_toupper(Utils::wstr2str(ext));
@@ -2261,18 +2261,18 @@ int main(int argc, char **argv)
 		}
 		else
 		{
-			a1_print_warning(A1_T_WARNING::A1_WRN_WUNKNMCU, -1, MCU_name, _global_settings.GetPrintWarningDesc());
+			a1_print_warning(A1_T_WARNING::A1_WRN_WUNKNMCU, -1, MCU_name, _a1_global_settings.GetPrintWarningDesc());
 		}
 
 		// initialize library directories a time more to take into account additional ones read from cfg file
-		_global_settings.InitLibDirs();
+		_a1_global_settings.InitLibDirs();
 	}
 
 
 	_B1C_consts[L"__EXTENSIONS"].first = extensions;
 
 	// parse extensions
-	_global_settings.SetEmbedded(false);
+	_a1_global_settings.SetEmbedded(false);
 	auto z = extensions.find('Z');
 	auto e = extensions.rfind('I', z);
 	if(e != std::string::npos)
@@ -2285,42 +2285,42 @@ int main(int argc, char **argv)
 		if(e != std::string::npos)
 		{
 			extensions.erase(e, 1);
-			_global_settings.SetEmbedded();
+			_a1_global_settings.SetEmbedded();
 		}
 	}
 
-	_global_settings.SetCompressed(false);
+	_a1_global_settings.SetCompressed(false);
 	z = extensions.find('Z');
 	e = extensions.rfind('C', z);
 	if(e != std::string::npos)
 	{
 		extensions.erase(e, 1);
-		_global_settings.SetCompressed();
+		_a1_global_settings.SetCompressed();
 	}
 
-	_global_settings.SetMultiplication(false);
-	_global_settings.SetDivision(false);
+	_a1_global_settings.SetMultiplication(false);
+	_a1_global_settings.SetDivision(false);
 	z = extensions.find('Z');
 	e = extensions.rfind('M', z);
 	if(e != std::string::npos)
 	{
 		extensions.erase(e, 1);
-		_global_settings.SetMultiplication();
-		_global_settings.SetDivision();
+		_a1_global_settings.SetMultiplication();
+		_a1_global_settings.SetDivision();
 	}
 
 	e = extensions.find("ZMMUL");
 	if(e != std::string::npos)
 	{
 		extensions.erase(e, 5);
-		_global_settings.SetMultiplication();
+		_a1_global_settings.SetMultiplication();
 	}
 
 	extensions = Utils::str_ltrim(extensions, "_");
 
 	if(!extensions.empty())
 	{
-		a1_print_warning(A1_T_WARNING::A1_WRN_WUNKMCUEX, -1, "", _global_settings.GetPrintWarningDesc());
+		a1_print_warning(A1_T_WARNING::A1_WRN_WUNKMCUEX, -1, "", _a1_global_settings.GetPrintWarningDesc());
 	}
 
 
@@ -2373,12 +2373,12 @@ int main(int argc, char **argv)
 	err = secs.ReadSourceFiles(files);
 	if(err != A1_T_ERROR::A1_RES_OK)
 	{
-		if(_global_settings.GetPrintWarnings())
+		if(_a1_global_settings.GetPrintWarnings())
 		{
 			auto &ws = secs.GetWarnings();
 			for(auto &w: ws)
 			{
-				a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _global_settings.GetPrintWarningDesc());
+				a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _a1_global_settings.GetPrintWarningDesc());
 			}
 		}
 
@@ -2391,12 +2391,12 @@ int main(int argc, char **argv)
 		err = secs.ReadSections();
 		if(err != A1_T_ERROR::A1_RES_OK)
 		{
-			if(_global_settings.GetPrintWarnings())
+			if(_a1_global_settings.GetPrintWarnings())
 			{
 				auto &ws = secs.GetWarnings();
 				for(auto &w: ws)
 				{
-					a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _global_settings.GetPrintWarningDesc());
+					a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _a1_global_settings.GetPrintWarningDesc());
 				}
 			}
 
@@ -2405,19 +2405,19 @@ int main(int argc, char **argv)
 		}
 
 		err = secs.Write(ofn);
-		if(err == A1_T_ERROR::A1_RES_ERELOUTRANGE && _global_settings.GetFixAddresses())
+		if(err == A1_T_ERROR::A1_RES_ERELOUTRANGE && _a1_global_settings.GetFixAddresses())
 		{
 			continue;
 		}
 		else
 		if(err != A1_T_ERROR::A1_RES_OK)
 		{
-			if(_global_settings.GetPrintWarnings())
+			if(_a1_global_settings.GetPrintWarnings())
 			{
 				auto &ws = secs.GetWarnings();
 				for(auto &w: ws)
 				{
-					a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _global_settings.GetPrintWarningDesc());
+					a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _a1_global_settings.GetPrintWarningDesc());
 				}
 			}
 
@@ -2428,12 +2428,12 @@ int main(int argc, char **argv)
 		break;
 	}
 
-	if(_global_settings.GetPrintWarnings())
+	if(_a1_global_settings.GetPrintWarnings())
 	{
 		auto &ws = secs.GetWarnings();
 		for(auto &w: ws)
 		{
-			a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _global_settings.GetPrintWarningDesc());
+			a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _a1_global_settings.GetPrintWarningDesc());
 		}
 	}
 
@@ -19,6 +19,10 @@
 #include "../../common/source/a1errors.h"
 #include "../../common/source/version.h"
 #include "../../common/source/gitrev.h"
+#include "../../common/source/cmpsrv.h"
+#include "../../common/source/timerep.h"
+
+#include "a1stm8.h"
 
 
 static const char *version = B1_CMP_VERSION;
@@ -983,8 +987,8 @@ public:
 };
 
 
-A1STM8Settings global_settings;
-A1Settings &_global_settings = global_settings;
+static A1STM8Settings global_settings;
+A1Settings &_a1_global_settings = global_settings;
 
 
 class CodeStmtSTM8: public CodeStmt
@@ -1023,7 +1027,7 @@ protected:
 	A1_T_ERROR GetInstruction(const std::wstring &signature, const std::map<std::wstring, MemRef> &memrefs, int line_num, const std::string &file_name) override
 	{
 		std::vector<const Inst *> insts;
-		auto err = _global_settings.GetInstructions(signature, insts, line_num, file_name);
+		auto err = _a1_global_settings.GetInstructions(signature, insts, line_num, file_name);
 		if(err != A1_T_ERROR::A1_RES_OK)
 		{
 			return err;
@@ -1190,7 +1194,7 @@ protected:
 		for(int32_t i = 0; i < _token_files.size(); i++)
 		{
 			int32_t size = 0;
-			auto err = ReadSections(i, SectType::ST_DATA, STM8_PAGE0_SECTION_TYPE_MOD, _global_settings.GetRAMStart() + _data_size, size, _global_settings.GetRAMSize() - _data_size - _global_settings.GetHeapSize());
+			auto err = ReadSections(i, SectType::ST_DATA, STM8_PAGE0_SECTION_TYPE_MOD, _a1_global_settings.GetRAMStart() + _data_size, size, _a1_global_settings.GetRAMSize() - _data_size - _a1_global_settings.GetHeapSize());
 			if(err != A1_T_ERROR::A1_RES_OK)
 			{
 				return err;
@@ -1203,7 +1207,7 @@ protected:
 				return A1_T_ERROR::A1_RES_EWSECSIZE;
 			}
 
-			if(_data_size + _global_settings.GetHeapSize() + _global_settings.GetStackSize() > _global_settings.GetRAMSize())
+			if(_data_size + _a1_global_settings.GetHeapSize() + _a1_global_settings.GetStackSize() > _a1_global_settings.GetRAMSize())
 			{
 				_warnings.push_back(std::make_tuple(-1, _src_files[i], A1_T_WARNING::A1_WRN_EWNORAM));
 			}
@@ -1221,7 +1225,7 @@ public:
 };
 
 
-int main(int argc, char **argv)
+int a1stm8_main(int argc, char **argv)
 {
 	int i;
 	bool print_err_desc = false;
@@ -1230,6 +1234,8 @@ int main(int argc, char **argv)
 	std::string lib_dir;
 	std::string MCU_name;
 	bool print_mem_use = false;
+	bool time_report = false;
+	std::string time_report_json;
 	std::vector<std::string> files;
 	bool args_error = false;
 	std::string args_error_txt;
@@ -1259,7 +1265,7 @@ int main(int argc, char **argv)
 				(argv[i][1] == 'F' || argv[i][1] == 'f') &&
 				argv[i][2] == 0)
 			{
-				_global_settings.SetFixAddresses();
+				_a1_global_settings.SetFixAddresses();
 				continue;
 			}
 
@@ -1309,13 +1315,13 @@ int main(int argc, char **argv)
 			{
 				if(argv[i][2] == 'S' || argv[i][2] == 's')
 				{
-					_global_settings.SetMemModelSmall();
-					_global_settings.SetRetAddressSize(STM8_RET_ADDR_SIZE_MM_SMALL);
+					_a1_global_settings.SetMemModelSmall();
+					_a1_global_settings.SetRetAddressSize(STM8_RET_ADDR_SIZE_MM_SMALL);
 				}
 				else
 				{
-					_global_settings.SetMemModelLarge();
-					_global_settings.SetRetAddressSize(STM8_RET_ADDR_SIZE_MM_LARGE);
+					_a1_global_settings.SetMemModelLarge();
+					_a1_global_settings.SetRetAddressSize(STM8_RET_ADDR_SIZE_MM_LARGE);
 				}
 
 				continue;
@@ -1331,6 +1337,30 @@ int main(int argc, char **argv)
 				continue;
 			}
 
+			// print assembling stages time and memory usage report
+			if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == "TIME-REPORT")
+			{
+				time_report = true;
+				continue;
+			}
+
+			// write assembling stages time and memory usage report in JSON format
+			if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == "TIME-REPORT-JSON")
+			{
+				if(i == argc - 1)
+				{
+					args_error = true;
+					args_error_txt = "missing report file name";
+				}
+				else
+				{
+					i++;
+					time_report_json = argv[i];
+				}
+
+				continue;
+			}
+
 			// specify output file name
 			if ((argv[i][0] == '-' || argv[i][0] == '/') &&
 				(argv[i][1] == 'O' || argv[i][1] == 'o') &&
@@ -1370,7 +1400,7 @@ int main(int argc, char **argv)
 						args_error = true;
 						args_error_txt = "wrong RAM size";
 					}
-					_global_settings.SetRAMSize(n);
+					_a1_global_settings.SetRAMSize(n);
 				}
 
 				continue;
@@ -1396,7 +1426,7 @@ int main(int argc, char **argv)
 						args_error = true;
 						args_error_txt = "wrong RAM starting address";
 					}
-					_global_settings.SetRAMStart(n);
+					_a1_global_settings.SetRAMStart(n);
 				}
 
 				continue;
@@ -1422,7 +1452,7 @@ int main(int argc, char **argv)
 						args_error = true;
 						args_error_txt = "wrong ROM size";
 					}
-					_global_settings.SetROMSize(n);
+					_a1_global_settings.SetROMSize(n);
 				}
 
 				continue;
@@ -1448,7 +1478,7 @@ int main(int argc, char **argv)
 						args_error = true;
 						args_error_txt = "wrong ROM starting address";
 					}
-					_global_settings.SetROMStart(n);
+					_a1_global_settings.SetROMStart(n);
 				}
 
 				continue;
@@ -1490,9 +1520,9 @@ int main(int argc, char **argv)
 		files.push_back(argv[i]);
 	}
 
-	_global_settings.SetTargetName("STM8");
-	_global_settings.SetMCUName(MCU_name);
-	_global_settings.SetLibDirRoot(lib_dir);
+	_a1_global_settings.SetTargetName("STM8");
+	_a1_global_settings.SetMCUName(MCU_name);
+	_a1_global_settings.SetLibDirRoot(lib_dir);
 
 	// load target-specific stuff
 	if(!select_target(global_settings))
@@ -1520,6 +1550,7 @@ int main(int argc, char **argv)
 		std::fputs(B1_PROJECT_NAME, stderr);
 		std::fputs(" [options] filename [filename1 filename2 ... filenameN]\n", stderr);
 		std::fputs("options:\n", stderr);
+		std::fputs("-client or /client - send the command line to compile server (the first option only), e.g. -client /tmp/a1stm8.sock\n", stderr);
 		std::fputs("-d or /d - print error description\n", stderr);
 		std::fputs("-l or /l - libraries directory, e.g. -l \"../lib\"\n", stderr);
 		std::fputs("-m or /m - specify MCU name, e.g. -m STM8S103F3\n", stderr);
@@ -1529,7 +1560,10 @@ int main(int argc, char **argv)
 		std::fputs("-ram_start or /ram_start - specify RAM starting address, e.g.: -ram_start 0\n", stderr);
 		std::fputs("-rom_size or /rom_size - specify ROM size, e.g.: -rom_size 0x2000\n", stderr);
 		std::fputs("-rom_start or /rom_start - specify ROM starting address, e.g.: -rom_start 0x8000\n", stderr);
+		std::fputs("-server or /server - run compile server on a local socket (the first option only), e.g. -server /tmp/a1stm8.sock\n", stderr);
 		std::fputs("-t or /t - set target (default STM8), e.g.: -t STM8\n", stderr);
+		std::fputs("-time-report or /time-report - print assembling stages time and memory usage report\n", stderr);
+		std::fputs("-time-report-json or /time-report-json - append assembling stages time and memory usage report in JSON format to the file, e.g. -time-report-json report.json\n", stderr);
 		std::fputs("-v or /v - show assembler version\n", stderr);
 		return 1;
 	}
@@ -1542,15 +1576,15 @@ int main(int argc, char **argv)
 		return 0;
 	}
 
-	_global_settings.InitLibDirs();
+	_a1_global_settings.InitLibDirs();
 
 	// read settings file if specified
 	if(!MCU_name.empty())
 	{
-		auto file_name = _global_settings.GetLibFileName(MCU_name, ".cfg");
+		auto file_name = _a1_global_settings.GetLibFileName(MCU_name, ".cfg");
 		if(!file_name.empty())
 		{
-			auto err = static_cast<A1_T_ERROR>(_global_settings.Read(file_name));
+			auto err = static_cast<A1_T_ERROR>(_a1_global_settings.Read(file_name));
 			if(err != A1_T_ERROR::A1_RES_OK)
 			{
 				a1_print_error(err, -1, file_name, print_err_desc);
@@ -1559,11 +1593,11 @@ int main(int argc, char **argv)
 		}
 		else
 		{
-			a1_print_warning(A1_T_WARNING::A1_WRN_WUNKNMCU, -1, MCU_name, _global_settings.GetPrintWarningDesc());
+			a1_print_warning(A1_T_WARNING::A1_WRN_WUNKNMCU, -1, MCU_name, _a1_global_settings.GetPrintWarningDesc());
 		}
 
 		// initialize library directories a time more to take into account additional ones read from cfg file
-		_global_settings.InitLibDirs();
+		_a1_global_settings.InitLibDirs();
 	}
 
 
@@ -1600,12 +1634,12 @@ int main(int argc, char **argv)
 	}
 
 
-	// initialize instructions map
-	load_all_instructions();
+	// initialize instructions map (compile server loads it once on start)
+	a1stm8_load_instructions();
 
-	if(_global_settings.GetFixAddresses())
+	if(_a1_global_settings.GetFixAddresses())
 	{
-		if(_global_settings.GetMemModelSmall())
+		if(_a1_global_settings.GetMemModelSmall())
 		{
 			load_extra_instructions_small();
 		}
@@ -1620,17 +1654,22 @@ int main(int argc, char **argv)
 	_B1C_consts[L"__MCU_NAME"].first = MCU_name;
 
 
+	if(time_report || !time_report_json.empty())
+	{
+		trep_enable();
+	}
+
 	STM8Sections secs;
 
 	err = secs.ReadSourceFiles(files);
 	if(err != A1_T_ERROR::A1_RES_OK)
 	{
-		if(_global_settings.GetPrintWarnings())
+		if(_a1_global_settings.GetPrintWarnings())
 		{
 			auto &ws = secs.GetWarnings();
 			for(auto &w: ws)
 			{
-				a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _global_settings.GetPrintWarningDesc());
+				a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _a1_global_settings.GetPrintWarningDesc());
 			}
 		}
 
@@ -1643,12 +1682,12 @@ int main(int argc, char **argv)
 		err = secs.ReadSections();
 		if(err != A1_T_ERROR::A1_RES_OK)
 		{
-			if(_global_settings.GetPrintWarnings())
+			if(_a1_global_settings.GetPrintWarnings())
 			{
 				auto &ws = secs.GetWarnings();
 				for(auto &w: ws)
 				{
-					a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _global_settings.GetPrintWarningDesc());
+					a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _a1_global_settings.GetPrintWarningDesc());
 				}
 			}
 
@@ -1657,19 +1696,19 @@ int main(int argc, char **argv)
 		}
 
 		err = secs.Write(ofn);
-		if(err == A1_T_ERROR::A1_RES_ERELOUTRANGE && _global_settings.GetFixAddresses())
+		if(err == A1_T_ERROR::A1_RES_ERELOUTRANGE && _a1_global_settings.GetFixAddresses())
 		{
 			continue;
 		}
 		else
 		if(err != A1_T_ERROR::A1_RES_OK)
 		{
-			if(_global_settings.GetPrintWarnings())
+			if(_a1_global_settings.GetPrintWarnings())
 			{
 				auto &ws = secs.GetWarnings();
 				for(auto &w: ws)
 				{
-					a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _global_settings.GetPrintWarningDesc());
+					a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _a1_global_settings.GetPrintWarningDesc());
 				}
 			}
 
@@ -1680,26 +1719,116 @@ int main(int argc, char **argv)
 		break;
 	}
 
-	if(_global_settings.GetPrintWarnings())
+	if(_a1_global_settings.GetPrintWarnings())
 	{
 		auto &ws = secs.GetWarnings();
 		for(auto &w: ws)
 		{
-			a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _global_settings.GetPrintWarningDesc());
+			a1_print_warning(std::get<2>(w), std::get<0>(w), std::get<1>(w), _a1_global_settings.GetPrintWarningDesc());
 		}
 	}
 
 	if(print_mem_use)
 	{
-		std::fwprintf(stdout, L"Memory usage:\n");
-		std::fwprintf(stdout, L"Variables: %d (%ls kB)\n", (int)secs.GetVariablesSize(), get_size_kB(secs.GetVariablesSize()).c_str());
-		std::fwprintf(stdout, L"Heap: %d (%ls kB)\n", (int)secs.GetHeapSize(), get_size_kB(secs.GetHeapSize()).c_str());
-		std::fwprintf(stdout, L"Stack: %d (%ls kB)\n", (int)secs.GetStackSize(), get_size_kB(secs.GetStackSize()).c_str());
-		std::fwprintf(stdout, L"Total RAM: %d (%ls kB)\n", (int)secs.GetVariablesSize() + secs.GetHeapSize() + secs.GetStackSize(), get_size_kB(secs.GetVariablesSize() + secs.GetHeapSize() + secs.GetStackSize()).c_str());
-		std::fwprintf(stdout, L"Constants: %d (%ls kB)\n", (int)secs.GetConstSize(), get_size_kB(secs.GetConstSize()).c_str());
-		std::fwprintf(stdout, L"Code: %d (%ls kB)\n", (int)secs.GetCodeSize(), get_size_kB(secs.GetCodeSize()).c_str());
-		std::fwprintf(stdout, L"Total ROM: %d (%ls kB)\n", (int)(secs.GetConstSize() + secs.GetCodeSize()), get_size_kB(secs.GetConstSize() + secs.GetCodeSize()).c_str());
+		// byte-oriented output: the built-in assembler shares stdout with the compiler
+		std::fprintf(stdout, "Memory usage:\n");
+		std::fprintf(stdout, "Variables: %d (%s kB)\n", (int)secs.GetVariablesSize(), Utils::wstr2str(get_size_kB(secs.GetVariablesSize())).c_str());
+		std::fprintf(stdout, "Heap: %d (%s kB)\n", (int)secs.GetHeapSize(), Utils::wstr2str(get_size_kB(secs.GetHeapSize())).c_str());
+		std::fprintf(stdout, "Stack: %d (%s kB)\n", (int)secs.GetStackSize(), Utils::wstr2str(get_size_kB(secs.GetStackSize())).c_str());
+		std::fprintf(stdout, "Total RAM: %d (%s kB)\n", (int)secs.GetVariablesSize() + secs.GetHeapSize() + secs.GetStackSize(), Utils::wstr2str(get_size_kB(secs.GetVariablesSize() + secs.GetHeapSize() + secs.GetStackSize())).c_str());
+		std::fprintf(stdout, "Constants: %d (%s kB)\n", (int)secs.GetConstSize(), Utils::wstr2str(get_size_kB(secs.GetConstSize())).c_str());
+		std::fprintf(stdout, "Code: %d (%s kB)\n", (int)secs.GetCodeSize(), Utils::wstr2str(get_size_kB(secs.GetCodeSize())).c_str());
+		std::fprintf(stdout, "Total ROM: %d (%s kB)\n", (int)(secs.GetConstSize() + secs.GetCodeSize()), Utils::wstr2str(get_size_kB(secs.GetConstSize() + secs.GetCodeSize())).c_str());
+	}
+
+	if(time_report)
+	{
+		trep_print(stderr);
+	}
+
+	if(!time_report_json.empty() && !trep_write_json(time_report_json))
+	{
+		std::perror("fail");
+	}
+
+	return 0;
+}
+
+void a1stm8_load_instructions()
+{
+	if(_instructions.empty())
+	{
+		load_all_instructions();
+	}
+}
+
+int a1stm8_warm_up(int argc, char **argv)
+{
+	const auto MCU_name = get_MCU_config_name(srv_get_opt_value(argc, argv, "M"));
+	if(MCU_name.empty())
+	{
+		return 0;
+	}
+
+	STM8Settings settings;
+
+	settings.SetTargetName("STM8");
+	settings.SetMCUName(MCU_name);
+	settings.SetLibDirRoot(srv_get_opt_value(argc, argv, "L"));
+	settings.InitLibDirs();
+
+	auto file_name = settings.GetLibFileName(MCU_name, ".cfg");
+	if(!file_name.empty())
+	{
+		settings.Read(file_name);
 	}
 
 	return 0;
 }
+
+#ifndef A1STM8_BUILTIN
+int main(int argc, char **argv)
+{
+	// compile server mode options should go first
+	if(argc > 2 && (argv[1][0] == '-' || argv[1][0] == '/'))
+	{
+		const auto opt = Utils::str_toupper(std::string(argv[1] + 1));
+
+		// run compile server
+		if(opt == "SERVER")
+		{
+			// initialize instructions map once for all requests
+			a1stm8_load_instructions();
+
+			Settings::EnableFileCache();
+
+			if(srv_run(argv[2], std::string(), a1stm8_main, a1stm8_warm_up) != 0)
+			{
+				std::perror("fail");
+			}
+
+			return 6;
+		}
+
+		// send the command line to compile server
+		if(opt == "CLIENT")
+		{
+			const std::string socket_name = argv[2];
+
+			argc -= 2;
+			argv[2] = argv[0];
+			argv += 2;
+
+			auto retcode = srv_request(socket_name, argc, argv);
+			if(retcode >= 0)
+			{
+				return retcode;
+			}
+
+			// the server is not available, process the command line locally
+		}
+	}
+
+	return a1stm8_main(argc, argv);
+}
+#endif
@@ -0,0 +1,20 @@
+/*
+ STM8 assembler
+ Copyright (c) 2021-2026 Nikolay Pletnev
+ MIT license
+
+ a1stm8.h: STM8 assembler entry points (c1stm8 built with A1STM8_BUILTIN option calls them directly)
+*/
+
+
+#pragma once
+
+
+// the assembler entry point
+extern int a1stm8_main(int argc, char **argv);
+
+// initializes instructions map (compile server loads it once on start)
+extern void a1stm8_load_instructions();
+
+// loads settings of the MCU specified in the request command line to keep them resident in compile server
+extern int a1stm8_warm_up(int argc, char **argv);
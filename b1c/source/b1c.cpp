@@ -15,12 +15,18 @@
 #include <cmath>
 #include <iterator>
 #include <list>
+#include <deque>
 #include <stack>
 #include <functional>
+#include <thread>
+#include <atomic>
 
 #include "../../common/source/version.h"
 #include "../../common/source/gitrev.h"
+#include "../../common/source/cmpsrv.h"
 #include "../../common/source/trgsel.h"
+#include "../../common/source/timerep.h"
+#include "../../common/source/b1ir.h"
 
 #include "b1c.h"
 
@@ -408,11 +414,11 @@ void B1FileCompiler::change_ref_names()
 		{
 			if(c->cmd == L"IOCTL")
 			{
-				for(auto &a: c->args)
+				for(int a = 0; a < (int)c->args.size(); a++)
 				{
-					if(a[0].type == B1Types::B1T_VARREF && a[0].value == vr.first)
+					if(c->args[a][0].type == B1Types::B1T_VARREF && c->args[a][0].value == vr.first)
 					{
-						a[0].value = name;
+						c->edit_args()[a][0].value = name;
 					}
 				}
 			}
@@ -708,10 +714,9 @@ B1_T_ERROR B1FileCompiler::process_expression(iterator pos, B1_CMP_EXP_TYPE &res
 					auto type = (hash == B1_FN_STRIIF_FN_HASH) ? B1Types::B1T_STRING : B1Types::B1T_COMMON;
 					auto type_name = Utils::get_type_name(type);
 
-					auto &args = iif_refs.back()[0].get().args;
-					args[1] = B1_CMP_ARG(type_name, type);
-					iif_refs.back()[1].get().args[1][0].type = type;
-					iif_refs.back()[2].get().args[1][0].type = type;
+					iif_refs.back()[0].get().edit_args()[1] = B1_CMP_ARG(type_name, type);
+					iif_refs.back()[1].get().edit_args()[1][0].type = type;
+					iif_refs.back()[2].get().edit_args()[1][0].type = type;
 					iif_refs.pop_back();
 				}
 				else
@@ -889,8 +894,8 @@ B1_T_ERROR B1FileCompiler::process_expression(iterator pos, B1_CMP_EXP_TYPE &res
 
 				B1_CMP_CMD cmd(_curr_line_num, _curr_line_cnt, _curr_src_file_id, _curr_src_line_id);
 				cmd.type = B1_CMD_TYPE::B1_CMD_TYPE_COMMAND;
-				cmd.cmd = token;
-				cmd.args = args;
+				cmd.set_cmd(token);
+				cmd.edit_args() = args;
 				insert(pos, cmd);
 
 				if(B1_RPNREC_GET_TYPE(tflags) != B1_RPNREC_TYPE_OPER)
@@ -1194,6 +1199,53 @@ bool B1FileCompiler::is_label()
 	return false;
 }
 
+// the same as b1_ex_prg_get_prog_line(B1_T_LINE_NUM_NEXT) but takes the lines read once from _prog_lines
+B1_T_ERROR B1FileCompiler::get_prog_line()
+{
+	auto pl = _prog_lines.find(b1_curr_prog_line_cnt);
+	if(pl != _prog_lines.end())
+	{
+		const auto &line = std::get<2>(pl->second);
+		std::copy(line.cbegin(), line.cend(), b1_progline);
+		b1_curr_prog_line_cnt = std::get<1>(pl->second);
+		return std::get<0>(pl->second);
+	}
+
+	auto line_cnt = b1_curr_prog_line_cnt;
+
+	if(!_prog_file_loaded)
+	{
+		auto err = b1_ex_prg_set_prog_file(_file_name.c_str());
+		if(err != B1_RES_OK)
+		{
+			return err;
+		}
+
+		_prog_file_loaded = true;
+		b1_curr_prog_line_cnt = line_cnt;
+	}
+
+	auto err = b1_ex_prg_get_prog_line(B1_T_LINE_NUM_NEXT);
+	if(err == B1_RES_OK || err == B1_RES_EPROGUNEND)
+	{
+		int len = 0;
+
+		if(err == B1_RES_OK)
+		{
+			while(len < B1_MAX_PROGLINE_LEN && !B1_T_ISCSTRTERM(b1_progline[len]))
+			{
+				len++;
+			}
+			// copy string terminator too
+			len++;
+		}
+
+		_prog_lines[line_cnt] = std::make_tuple(err, b1_curr_prog_line_cnt, std::vector<B1_T_CHAR>(b1_progline, b1_progline + len));
+	}
+
+	return err;
+}
+
 B1_T_ERROR B1FileCompiler::st_option_set(const B1_T_CHAR *s, uint8_t value_type, bool onoff, int *value)
 {
 	B1_T_ERROR err;
@@ -1852,9 +1904,9 @@ B1_T_ERROR B1FileCompiler::st_let(const B1_T_CHAR **stop_tokens, B1_CMP_ARG *var
 
 	B1_CMP_CMD cmd(_curr_line_num, _curr_line_cnt, _curr_src_file_id, _curr_src_line_id);
 	cmd.type = B1_CMD_TYPE::B1_CMD_TYPE_COMMAND;
-	cmd.cmd = L"=";
-	cmd.args.push_back(res);
-	cmd.args.push_back(res1);
+	cmd.set_cmd(L"=");
+	cmd.edit_args().push_back(res);
+	cmd.edit_args().push_back(res1);
 	push_back(cmd);
 
 	if(var_ref != nullptr)
@@ -2458,8 +2510,8 @@ B1C_T_ERROR B1FileCompiler::st_dim(bool first_run, bool is_const)
 
 				B1_CMP_CMD cmd(_curr_line_num, _curr_line_cnt, _curr_src_file_id, _curr_src_line_id);
 				cmd.type = B1_CMD_TYPE::B1_CMD_TYPE_COMMAND;
-				cmd.cmd = at ? L"MA" : L"GA";
-				cmd.args = args;
+				cmd.set_cmd(at ? L"MA" : L"GA");
+				cmd.edit_args() = args;
 
 				push_back(cmd);
 
@@ -2930,9 +2982,9 @@ B1_T_ERROR B1FileCompiler::st_def(bool first_run)
 
 	B1_CMP_CMD cmd(_curr_line_num, _curr_line_cnt, _curr_src_file_id, _curr_src_line_id);
 	cmd.type = B1_CMD_TYPE::B1_CMD_TYPE_COMMAND;
-	cmd.cmd = L"RETVAL";
-	cmd.args.push_back(res);
-	cmd.args.push_back(B1_CMP_ARG(Utils::get_type_name(fn_type), fn_type));
+	cmd.set_cmd(L"RETVAL");
+	cmd.edit_args().push_back(res);
+	cmd.edit_args().push_back(B1_CMP_ARG(Utils::get_type_name(fn_type), fn_type));
 	push_back(cmd);
 
 	if(exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL)
@@ -2952,7 +3004,7 @@ B1_T_ERROR B1FileCompiler::st_def(bool first_run)
 			continue;
 		}
 
-		for(auto &a: cmd.args)
+		for(auto &a: cmd.edit_args())
 		{
 			for(auto &aa: a)
 			{
@@ -3782,10 +3834,10 @@ B1_T_ERROR B1FileCompiler::st_read()
 
 		B1_CMP_CMD cmd(_curr_line_num, _curr_line_cnt, _curr_src_file_id, _curr_src_line_id);
 		cmd.type = B1_CMD_TYPE::B1_CMD_TYPE_COMMAND;
-		cmd.cmd = L"READ";
+		cmd.set_cmd(L"READ");
 		// put namespace name
-		cmd.args.push_back(B1_CMP_ARG(_curr_name_space));
-		cmd.args.push_back(res);
+		cmd.edit_args().push_back(B1_CMP_ARG(_curr_name_space));
+		cmd.edit_args().push_back(res);
 		push_back(cmd);
 
 		if(res.size() > 1)
@@ -3865,3445 +3917,6695 @@ B1_T_ERROR B1FileCompiler::st_wend()
 	emit_command(L"JMP", _state.second[0]);
 	emit_label(_state.second[1]);
 
+	// SELECT CASE selector values moved to the loop by BREAK or CONTINUE statements
+	for(auto l = _state.second.crbegin(); l != _state.second.crend(); l++)
+	{
+		if(is_gen_local(*l))
+		{
+			emit_command(L"LF", *l);
+		}
+	}
+
 	return B1_RES_OK;
 }
 
-B1_T_ERROR B1FileCompiler::st_continue()
+// returns the state of the nearest loop enclosing the current statement (IF statements and SELECT CASE blocks
+// are skipped), nullptr if there is no such loop. SELECT CASE blocks between the statement and the loop keep their
+// selector values in local variables till END SELECT statement, so the jump out of the blocks would leave the locals
+// allocated. Such locals are moved to the loop: they are allocated before the loop label and freed after the loop end
+// label, the same way as FOR statement limit and increment values are.
+std::pair<B1FileCompiler::B1_CMP_STATE, std::vector<std::wstring>> *B1FileCompiler::get_loop_state()
 {
-	bool if_stmt = _state.first == B1_CMP_STATE::B1_CMP_STATE_IF || _state.first == B1_CMP_STATE::B1_CMP_STATE_ELSEIF || _state.first == B1_CMP_STATE::B1_CMP_STATE_ELSE;
+	auto *state = &_state;
+	auto prev = _state_stack.rbegin();
+	std::vector<std::pair<B1_CMP_STATE, std::vector<std::wstring>> *> selects;
 
-	if(if_stmt && _state_stack.size() < 1)
+	while(true)
 	{
-		return B1_RES_ENOTINLOOP;
+		if(state->first == B1_CMP_STATE::B1_CMP_STATE_FOR || state->first == B1_CMP_STATE::B1_CMP_STATE_WHILE)
+		{
+			break;
+		}
+
+		//        0         1          2            3           4                   5
+		// state: selector, end label, tests label, else label, current CASE label, local to free
+		if(state->first == B1_CMP_STATE::B1_CMP_STATE_SELECT && !state->second[5].empty())
+		{
+			selects.push_back(state);
+		}
+
+		if(state->first == B1_CMP_STATE::B1_CMP_STATE_OK || prev == _state_stack.rend())
+		{
+			return nullptr;
+		}
+
+		state = &*prev;
+		prev++;
 	}
 
-	const auto &state = if_stmt ? _state_stack.back() : _state;
+	if(selects.empty())
+	{
+		return state;
+	}
 
-	if(state.first == B1_CMP_STATE::B1_CMP_STATE_FOR)
+	const auto &loop_label = state->second[(state->first == B1_CMP_STATE::B1_CMP_STATE_FOR) ? 3 : 0];
+	auto ll = std::find_if(begin(), end(), [&loop_label](const B1_CMP_CMD &cmd) { return B1CUtils::is_label(cmd) && cmd.cmd == loop_label; });
+	if(ll == end())
 	{
-		emit_command(L"JMP", state.second[5]);
+		return nullptr;
 	}
-	else
-	if(state.first == B1_CMP_STATE::B1_CMP_STATE_WHILE)
+
+	// the outermost block local is allocated first
+	for(auto s = selects.rbegin(); s != selects.rend(); s++)
 	{
-		emit_command(L"JMP", state.second[0]);
+		auto &local = (*s)->second[5];
+
+		auto la = std::find_if(rbegin(), rend(), [&local](const B1_CMP_CMD &cmd) { return !B1CUtils::is_label(cmd) && cmd.cmd == L"LA" && cmd.args[0][0].value == local; });
+		if(la == rend())
+		{
+			return nullptr;
+		}
+
+		insert(ll, *la);
+		erase(std::prev(la.base()));
+
+		state->second.push_back(local);
+		local.clear();
 	}
-	else
+
+	return state;
+}
+
+B1_T_ERROR B1FileCompiler::st_continue()
+{
+	const auto *state = get_loop_state();
+
+	if(state == nullptr)
 	{
 		return B1_RES_ENOTINLOOP;
 	}
 
+	if(state->first == B1_CMP_STATE::B1_CMP_STATE_FOR)
+	{
+		emit_command(L"JMP", state->second[5]);
+	}
+	else
+	{
+		emit_command(L"JMP", state->second[0]);
+	}
+
 	return B1_RES_OK;
 }
 
 B1_T_ERROR B1FileCompiler::st_break()
 {
-	bool if_stmt = _state.first == B1_CMP_STATE::B1_CMP_STATE_IF || _state.first == B1_CMP_STATE::B1_CMP_STATE_ELSEIF || _state.first == B1_CMP_STATE::B1_CMP_STATE_ELSE;
+	const auto *state = get_loop_state();
 
-	if(if_stmt && _state_stack.size() < 1)
+	if(state == nullptr)
 	{
 		return B1_RES_ENOTINLOOP;
 	}
 
-	const auto &state = if_stmt ? _state_stack.back() : _state;
-
-	if(state.first == B1_CMP_STATE::B1_CMP_STATE_FOR)
-	{
-		emit_command(L"JMP", state.second[6]);
-	}
-	else
-	if(state.first == B1_CMP_STATE::B1_CMP_STATE_WHILE)
+	if(state->first == B1_CMP_STATE::B1_CMP_STATE_FOR)
 	{
-		emit_command(L"JMP", state.second[1]);
+		emit_command(L"JMP", state->second[6]);
 	}
 	else
 	{
-		return B1_RES_ENOTINLOOP;
+		emit_command(L"JMP", state->second[1]);
 	}
 
 	return B1_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::st_print()
+// checks if the token is the keyword (used for the keywords unknown to b1core)
+static bool is_keyword(const B1_TOKENDATA &td, const wchar_t *keyword)
 {
-	B1C_T_ERROR err;
-	bool next_print_zone, newline;
+	return	td.length != 0 && (td.type & B1_TOKEN_TYPE_LETTERS) &&
+			Utils::str_toupper(B1CUtils::get_progline_substring(td.offset, td.offset + td.length)) == keyword;
+}
 
-	next_print_zone = false;
-	newline = true;
+// recognizes SELECT CASE, CASE and END SELECT statements, next_off gets the offset of the text following the keywords
+B1_T_ERROR B1FileCompiler::get_select_stmt(uint8_t stmt, B1_CMP_SEL_STMT &sel_stmt, B1_T_INDEX &next_off) const
+{
+	B1_TOKENDATA td;
 
-	std::wstring dev_name;
+	sel_stmt = B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_NONE;
+	next_off = b1_curr_prog_line_offset;
 
-	err = read_device_name(std::vector({ std::wstring(B1C_DEV_OPT_TXT), std::wstring(B1C_DEV_OPT_OUT) }), true, dev_name);
-	if(err != B1C_T_ERROR::B1C_RES_OK)
+	// b1core treats SELECT CASE and CASE statements as implicit LET statements
+	if(stmt != B1_ID_STMT_UNKNOWN && stmt != B1_ID_STMT_END)
 	{
-		return err;
+		return B1_RES_OK;
 	}
 
-	// process PRINT statement arguments
-	for(;; b1_curr_prog_line_offset++)
+	auto err = b1_tok_get(next_off, 0, &td);
+	if(err != B1_RES_OK)
 	{
-		// build RPN for every PRINT statement argument
-		err = static_cast<B1C_T_ERROR>(b1_rpn_build(b1_curr_prog_line_offset, PRINT_STOP_TOKENS, &b1_curr_prog_line_offset));
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			return err;
-		}
+		return err;
+	}
 
-		if(next_print_zone)
+	if(stmt == B1_ID_STMT_END)
+	{
+		if(is_keyword(td, L"SELECT"))
 		{
-			// go to the next print zone
-			emit_command(L"OUT", std::vector<std::wstring>({ dev_name, L"TAB" }));
-			back().args[1].push_back(B1_TYPED_VALUE(L"0"));
-
-			next_print_zone = false;
+			sel_stmt = B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_END;
+			next_off = td.offset + td.length;
 		}
 
-		// no RPN: empty expression was specified to b1_rpn_build function
-		if(b1_rpn[0].flags == 0)
-		{
-			break;
-		}
+		return B1_RES_OK;
+	}
 
-		newline = true;
+	if(is_keyword(td, L"CASE"))
+	{
+		sel_stmt = B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_CASE;
+		next_off = td.offset + td.length;
 
-		// get next print zone flag
-		next_print_zone = (b1_curr_prog_line_offset != 0) && B1_T_ISCOMMA(b1_progline[b1_curr_prog_line_offset]);
+		return B1_RES_OK;
+	}
 
-		// compile the expression part
-		B1_CMP_EXP_TYPE exp_type;
-		B1_CMP_ARG res;
-		err = static_cast<B1C_T_ERROR>(process_expression(end(), exp_type, res));
-		if(err != B1C_T_ERROR::B1C_RES_OK)
+	if(is_keyword(td, L"SELECT"))
+	{
+		err = b1_tok_get(td.offset + td.length, 0, &td);
+		if(err != B1_RES_OK)
 		{
 			return err;
 		}
 
-		if(exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
+		if(is_keyword(td, L"CASE"))
 		{
-			return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+			sel_stmt = B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_SELECT;
+			next_off = td.offset + td.length;
 		}
+	}
 
-		if(!(exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_IMM_VAL && res[0].value.empty()))
-		{
-			std::wstring cmd;
+	return B1_RES_OK;
+}
 
-			// process special PRINT functions (TAB and SPC)
-			if(exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL && back().cmd == L"=" && back().args[0].size() == 2 && (back().args[0][0].value == L"TAB" || back().args[0][0].value == L"SPC"))
-			{
-				cmd = back().args[0][0].value;
-				back().args[0][0] = back().args[0][1];
-				back().args[0].pop_back();
+B1C_T_ERROR B1FileCompiler::st_select()
+{
+	B1_T_ERROR err;
+	B1_CMP_EXP_TYPE exp_type;
+	B1_CMP_ARG res;
 
-				emit_command(L"OUT", std::vector<std::wstring>({ dev_name, cmd }));
-				back().args[1].push_back(B1_TYPED_VALUE(res[0].value));
-			}
-			else
-			{
-				emit_command(L"OUT", std::vector<std::wstring>({ dev_name, res[0].value }));
-			}
+	// the selector is compared with CASE clause values in tests placed before the tests label, the code of CASE
+	// clauses follows the label:
+	// <selector evaluation>
+	// <tests: JT to CASE labels>
+	// JMP, <CASE ELSE label or end label>
+	// :<CASE label 1>
+	// <statements 1>
+	// JMP, <end label>
+	// ...
+	// :<end label>
 
-			if(exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL)
-			{
-				emit_command(L"LF", res[0].value);
-			}
-		}
+	// build RPN for the selector expression
+	err = b1_rpn_build(b1_curr_prog_line_offset, NULL, &b1_curr_prog_line_offset);
+	if(err != B1_RES_OK)
+	{
+		return static_cast<B1C_T_ERROR>(err);
+	}
 
-		if(!b1_curr_prog_line_offset)
-		{
-			break;
-		}
+	if(b1_curr_prog_line_offset != 0)
+	{
+		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+	}
 
-		newline = false;
+	err = process_expression(end(), exp_type, res);
+	if(err != B1_RES_OK)
+	{
+		return static_cast<B1C_T_ERROR>(err);
 	}
 
-	if(newline)
+	if(exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
 	{
-		emit_command(L"OUT", std::vector<std::wstring>({ dev_name, L"NL"}));
+		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+	}
+
+	// function with no arguments must be called once so its value is kept in local variable, the same is true for
+	// volatile and memory-mapped variables (they can be changed by interrupt handlers or hardware between the tests)
+	if(	exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_VAR &&
+		(fn_exists(res[0].value) || is_volatile_var(res[0].value) || is_mem_var_name(res[0].value)))
+	{
+		std::wstring local = emit_local(B1Types::B1T_UNKNOWN);
+		emit_command(L"=", std::vector<B1_CMP_ARG>({ res, B1_CMP_ARG(local) }));
+		res = B1_CMP_ARG(local);
 	}
 
+	//        0         1          2            3           4                   5
+	// state: selector, end label, tests label, else label, current CASE label, local to free
+	_state.second.push_back(res[0].value);
+	_state.second.push_back(emit_label(true));
+	_state.second.push_back(emit_label());
+	_state.second.push_back(std::wstring());
+	_state.second.push_back(std::wstring());
+	_state.second.push_back(is_gen_local(res[0].value) ? res[0].value.str() : std::wstring());
+
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::st_input()
+B1C_T_ERROR B1FileCompiler::st_case()
 {
-	B1C_T_ERROR err;
-	bool get_prompt = true;
-	bool first = true;
+	B1_T_ERROR err;
+	B1_TOKENDATA td;
 
-	std::wstring dev_name;
+	//        0         1          2            3           4                   5
+	// state: selector, end label, tests label, else label, current CASE label, local to free
 
-	err = read_device_name(std::vector({ std::wstring(B1C_DEV_OPT_TXT), std::wstring(B1C_DEV_OPT_IN) }), false, dev_name);
-	if(err != B1C_T_ERROR::B1C_RES_OK)
+	// CASE ELSE must be the last clause
+	if(!_state.second[3].empty())
 	{
-		return err;
+		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 	}
 
-	auto rep_label = emit_label();
+	// the previous clause ends with a jump to the end of the block
+	if(!_state.second[4].empty())
+	{
+		emit_command(L"JMP", _state.second[1]);
+	}
 
-	while(b1_curr_prog_line_offset != 0)
+	const auto case_label = emit_label(true);
+	_state.second[4] = case_label;
+
+	err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+	if(err != B1_RES_OK)
 	{
-		// build RPN
-		err = static_cast<B1C_T_ERROR>(b1_rpn_build(b1_curr_prog_line_offset, INPUT_STOP_TOKEN, &b1_curr_prog_line_offset));
-		if(err != B1C_T_ERROR::B1C_RES_OK)
+		return static_cast<B1C_T_ERROR>(err);
+	}
+
+	if(is_keyword(td, L"ELSE"))
+	{
+		err = b1_tok_get(td.offset + td.length, 0, &td);
+		if(err != B1_RES_OK)
 		{
-			return err;
+			return static_cast<B1C_T_ERROR>(err);
 		}
-		if(b1_rpn[0].flags == 0)
+
+		if(td.length != 0)
 		{
-			// INPUT statement without arguments
 			return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 		}
 
-		if(get_prompt)
-		{
-			// test for optional prompt string
-			std::wstring prompt;
+		_state.second[3] = case_label;
+		emit_label(case_label);
 
-			if(concat_strings_rpn(prompt) == B1_RES_OK)
-			{
-				if(b1_curr_prog_line_offset == 0)
-				{
-					// INPUT with prompt string only is not allowed
-					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-				}
-			}
-			else
-			{
-				prompt = L"\"" + B1CUtils::b1str_to_cstr(_PROMPT) + L"\"";
-				get_prompt = false;
-			}
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
 
-			if(prompt != L"\"\"")
-			{
-				emit_command(L"OUT", std::vector<std::wstring>({ dev_name, prompt }));
-			}
-		}
+	// the tests are inserted before the tests label
+	auto tests_label = std::find_if(rbegin(), rend(), [this](const B1_CMP_CMD &cmd) { return B1CUtils::is_label(cmd) && cmd.cmd == _state.second[2]; });
+	if(tests_label == rend())
+	{
+		return static_cast<B1C_T_ERROR>(B1_RES_EENVFAT);
+	}
+	auto pos = std::prev(tests_label.base());
 
-		if(first)
+	// "TO" keyword is the first FOR statement stop token
+	const B1_T_CHAR *case_stop_tokens[3] = { _COMMA, FOR_STOP_TOKEN1[0], NULL };
+
+	// evaluates the next value of the clause, sets is_range to true if the value is followed by "TO" keyword
+	auto get_value = [this, &pos, &case_stop_tokens](B1_CMP_ARG &res, bool &is_range) -> B1_T_ERROR
+	{
+		B1_CMP_EXP_TYPE exp_type;
+		B1_TOKENDATA td;
+
+		auto err = b1_rpn_build(b1_curr_prog_line_offset, case_stop_tokens, &b1_curr_prog_line_offset);
+		if(err != B1_RES_OK)
 		{
-			emit_command(L"SET", std::vector<std::wstring>({ L"ERR", L"0" }));
-			first = false;
+			return err;
 		}
 
-		if(!get_prompt)
+		err = process_expression(pos, exp_type, res);
+		if(err != B1_RES_OK)
 		{
-			// compile the expression
-			B1_CMP_EXP_TYPE exp_type;
-			B1_CMP_ARG res;
+			return err;
+		}
 
-			err = static_cast<B1C_T_ERROR>(process_expression(end(), exp_type, res, true));
-			if(err != B1C_T_ERROR::B1C_RES_OK)
+		if(exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
+		{
+			return B1_RES_ESYNTAX;
+		}
+
+		is_range = false;
+
+		if(b1_curr_prog_line_offset != 0)
+		{
+			err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+			if(err != B1_RES_OK)
 			{
 				return err;
 			}
 
-			if(exp_type != B1_CMP_EXP_TYPE::B1_CMP_ET_VAR)
+			is_range = !(td.length == 1 && b1_progline[td.offset] == B1_T_C_COMMA);
+			b1_curr_prog_line_offset = td.offset + td.length;
+		}
+
+		return B1_RES_OK;
+	};
+
+	// compares the selector with the value and jumps to the label if the comparison result is TRUE
+	auto emit_test = [this, &pos](const std::wstring &op, const B1_CMP_ARG &res, const std::wstring &label)
+	{
+		emit_command(op, pos, std::vector<B1_CMP_ARG>({ B1_CMP_ARG(_state.second[0]), res }));
+		if(is_gen_local(res[0].value))
+		{
+			emit_command(L"LF", pos, res[0].value.str());
+		}
+		emit_command(L"JT", pos, label);
+	};
+
+	while(true)
+	{
+		B1_CMP_ARG res;
+		bool is_range = false;
+
+		err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+		if(err != B1_RES_OK)
+		{
+			return static_cast<B1C_T_ERROR>(err);
+		}
+
+		if(td.length == 0)
+		{
+			return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+		}
+
+		if(is_keyword(td, L"IS"))
+		{
+			// IS <relational operator> <value>
+			err = b1_tok_get(td.offset + td.length, 0, &td);
+			if(err != B1_RES_OK)
 			{
-				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				return static_cast<B1C_T_ERROR>(err);
 			}
 
-			if(is_const_var(res[0].value))
+			std::wstring op = B1CUtils::get_progline_substring(td.offset, td.offset + td.length);
+			if(op == L"=")
 			{
-				return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
+				op = L"==";
+			}
+			else
+			if(op != L"<>" && op != L">" && op != L"<" && op != L">=" && op != L"<=")
+			{
+				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 			}
 
-			emit_command(L"IN", { B1_CMP_ARG(dev_name), res });
+			b1_curr_prog_line_offset = td.offset + td.length;
 
-			if(res.size() > 1)
+			err = get_value(res, is_range);
+			if(err != B1_RES_OK)
 			{
-				for(auto l = res.crbegin(); l != res.crend() - 1; l++)
-				{
-					if(is_gen_local(l->value))
-					{
-						emit_command(L"LF", l->value);
-					}
-				}
+				return static_cast<B1C_T_ERROR>(err);
 			}
 
-			emit_command(L"ERR", { B1_CMP_ARG(L""), rep_label });
-		}
-
-		get_prompt = false;
+			if(is_range)
+			{
+				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+			}
 
-		if(b1_curr_prog_line_offset != 0)
+			emit_test(op, res, case_label);
+		}
+		else
 		{
-			if(B1_T_ISCOMMA(b1_progline[b1_curr_prog_line_offset]))
+			err = get_value(res, is_range);
+			if(err != B1_RES_OK)
 			{
-				b1_curr_prog_line_offset++;
+				return static_cast<B1C_T_ERROR>(err);
+			}
+
+			if(is_range)
+			{
+				// <value1> TO <value2>
+				const auto skip_label = emit_label(true);
+
+				emit_test(L"<", res, skip_label);
+
+				err = get_value(res, is_range);
+				if(err != B1_RES_OK)
+				{
+					return static_cast<B1C_T_ERROR>(err);
+				}
+
+				if(is_range)
+				{
+					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				}
+
+				emit_test(L"<=", res, case_label);
+				emit_label(skip_label, pos);
 			}
 			else
 			{
-				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				emit_test(L"==", res, case_label);
 			}
 		}
+
+		if(b1_curr_prog_line_offset == 0)
+		{
+			break;
+		}
 	}
 
+	emit_label(case_label);
+
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::st_read_range(std::vector<std::pair<B1_CMP_ARG, B1_CMP_EXP_TYPE>> &range)
+B1C_T_ERROR B1FileCompiler::st_end_select()
 {
 	B1_TOKENDATA td;
-	auto saved_line_offset = b1_curr_prog_line_offset;
 
 	auto err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
 	if(err != B1_RES_OK)
 	{
-		b1_curr_prog_line_offset = saved_line_offset;
-		return static_cast<B1C_T_ERROR>(err);
-	}
-	if(td.length == 0 || !(td.type & B1_TOKEN_TYPE_IDNAME))
-	{
-		b1_curr_prog_line_offset = saved_line_offset;
-		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-	}
-
-	auto name = Utils::str_toupper(B1CUtils::get_progline_substring(td.offset, td.offset + td.length));
-	auto fn = get_fn(name);
-	if(fn != nullptr)
-	{
-		b1_curr_prog_line_offset = saved_line_offset;
-		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-	}
-
-	bool expl = true;
-	name = get_var_name(name, expl);
-
-	b1_curr_prog_line_offset = td.offset + td.length;
-	err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
-	if(err != B1_RES_OK)
-	{
-		b1_curr_prog_line_offset = saved_line_offset;
-		return static_cast<B1C_T_ERROR>(err);
-	}
-	if(td.length == 0 || !(td.type & B1_TOKEN_TYPE_OPERATION) || b1_progline[b1_curr_prog_line_offset] != B1_T_C_OPBRACK)
-	{
-		b1_curr_prog_line_offset = saved_line_offset;
-		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-	}
-
-	b1_curr_prog_line_offset = td.offset + td.length;
-	err = st_dim_get_size(true, true, range);
-	if(err != B1_RES_OK)
-	{
-		b1_curr_prog_line_offset = saved_line_offset;
 		return static_cast<B1C_T_ERROR>(err);
 	}
 
-	if(b1_progline[b1_curr_prog_line_offset] != B1_T_C_CLBRACK)
+	if(td.length != 0)
 	{
-		b1_curr_prog_line_offset = saved_line_offset;
 		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 	}
 
-	b1_curr_prog_line_offset = td.offset + td.length;
-	err = st_dim_get_size(false, true, range);
-	if(err != B1_RES_OK)
-	{
-		return B1C_T_ERROR::B1C_RES_ERANGSNTX;
-	}
-
-	if(b1_progline[b1_curr_prog_line_offset] != B1_T_C_CLBRACK)
+	//        0         1          2            3           4                   5
+	// state: selector, end label, tests label, else label, current CASE label, local to free
+	auto tests_label = std::find_if(rbegin(), rend(), [this](const B1_CMP_CMD &cmd) { return B1CUtils::is_label(cmd) && cmd.cmd == _state.second[2]; });
+	if(tests_label == rend())
 	{
-		return B1C_T_ERROR::B1C_RES_ERANGSNTX;
+		return static_cast<B1C_T_ERROR>(B1_RES_EENVFAT);
 	}
+	auto pos = std::prev(tests_label.base());
 
-	b1_curr_prog_line_offset++;
-
-	// implicitly declared arrays are not allowed with PUT/GET/TRANSFER statements because their type is INT
-	if(!expl || get_var_type(name) != B1Types::B1T_BYTE || get_var_dim(name) != 1)
-	{
-		return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
-	}
+	// no one clause matches the selector value
+	emit_command(L"JMP", pos, _state.second[3].empty() ? _state.second[1] : _state.second[3]);
+	erase(pos);
 
-	err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
-	if(err != B1_RES_OK)
-	{
-		b1_curr_prog_line_offset = saved_line_offset;
-		return static_cast<B1C_T_ERROR>(err);
-	}
+	emit_label(_state.second[1]);
 
-	if(td.length == 0)
-	{
-		b1_curr_prog_line_offset = 0;
-	}
-	else
+	// the local is empty if it is moved to the enclosing loop (see get_loop_state)
+	if(!_state.second[5].empty())
 	{
-		b1_curr_prog_line_offset = td.offset;
+		emit_command(L"LF", _state.second[5]);
 	}
 
-	range[0].first.insert(range[0].first.begin(), B1_TYPED_VALUE(name, B1Types::B1T_BYTE));
-	range[0].second = B1_CMP_EXP_TYPE::B1_CMP_ET_VAR;
-
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::read_device_name(const std::vector<std::wstring> &dev_opts, bool allow_devname_only, std::wstring &dev_name)
+B1C_T_ERROR B1FileCompiler::st_print()
 {
-	B1_TOKENDATA td;
-	auto saved_line_offset = b1_curr_prog_line_offset;
+	B1C_T_ERROR err;
+	bool next_print_zone, newline;
 
-	dev_name.clear();
+	next_print_zone = false;
+	newline = true;
 
-	// read optional device name
-	auto err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
-	if(err != B1_RES_OK)
+	std::wstring dev_name;
+
+	err = read_device_name(std::vector({ std::wstring(B1C_DEV_OPT_TXT), std::wstring(B1C_DEV_OPT_OUT) }), true, dev_name);
+	if(err != B1C_T_ERROR::B1C_RES_OK)
 	{
-		return static_cast<B1C_T_ERROR>(err);
+		return err;
 	}
 
-	if(td.length == 0)
+	// process PRINT statement arguments
+	for(;; b1_curr_prog_line_offset++)
 	{
-		if(!allow_devname_only)
+		// build RPN for every PRINT statement argument
+		err = static_cast<B1C_T_ERROR>(b1_rpn_build(b1_curr_prog_line_offset, PRINT_STOP_TOKENS, &b1_curr_prog_line_offset));
+		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
-			return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+			return err;
 		}
-	}
-	else
-	if(td.type & B1_TOKEN_TYPE_DEVNAME)
-	{
-		b1_curr_prog_line_offset = td.offset + td.length;
-
-		dev_name = Utils::str_toupper(B1CUtils::get_progline_substring(td.offset, b1_curr_prog_line_offset));
 
-		err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
-		if(err != B1_RES_OK)
+		if(next_print_zone)
 		{
-			return static_cast<B1C_T_ERROR>(err);
-		}
+			// go to the next print zone
+			emit_command(L"OUT", std::vector<std::wstring>({ dev_name, L"TAB" }));
+			back().edit_args()[1].push_back(B1_TYPED_VALUE(L"0"));
 
-		if(td.length != 1 || !B1_T_ISCOMMA(b1_progline[td.offset]))
-		{
-			if(!(allow_devname_only && td.length == 0))
-			{
-				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-			}
+			next_print_zone = false;
 		}
-		else
+
+		// no RPN: empty expression was specified to b1_rpn_build function
+		if(b1_rpn[0].flags == 0)
 		{
-			b1_curr_prog_line_offset = td.offset + td.length;
+			break;
 		}
-	}
-	
-	if(dev_name.empty())
-	{
-		// no device name specified
-		b1_curr_prog_line_offset = saved_line_offset;
 
-		bool in_dev = std::find(dev_opts.cbegin(), dev_opts.cend(), B1C_DEV_OPT_IN) != dev_opts.cend();
-		bool out_dev = std::find(dev_opts.cbegin(), dev_opts.cend(), B1C_DEV_OPT_OUT) != dev_opts.cend();
+		newline = true;
 
-		if(!_opt_inputdevice_def && in_dev)
+		// get next print zone flag
+		next_print_zone = (b1_curr_prog_line_offset != 0) && B1_T_ISCOMMA(b1_progline[b1_curr_prog_line_offset]);
+
+		// compile the expression part
+		B1_CMP_EXP_TYPE exp_type;
+		B1_CMP_ARG res;
+		err = static_cast<B1C_T_ERROR>(process_expression(end(), exp_type, res));
+		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
-			dev_name = _opt_inputdevice;
+			return err;
 		}
 
-		if(!_opt_outputdevice_def && out_dev)
+		if(exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
 		{
-			dev_name = _opt_outputdevice;
+			return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 		}
 
-		if(in_dev && out_dev && !dev_name.empty())
+		if(!(exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_IMM_VAL && res[0].value.empty()))
 		{
-			if(_opt_inputdevice != _opt_outputdevice)
+			std::wstring cmd;
+
+			// process special PRINT functions (TAB and SPC)
+			if(exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL && back().cmd == L"=" && back().args[0].size() == 2 && (back().args[0][0].value == L"TAB" || back().args[0][0].value == L"SPC"))
 			{
-				return B1C_T_ERROR::B1C_RES_EINCOPTS;
+				cmd = back().args[0][0].value;
+				back().edit_args()[0][0] = back().args[0][1];
+				back().edit_args()[0].pop_back();
+
+				emit_command(L"OUT", std::vector<std::wstring>({ dev_name, cmd }));
+				back().edit_args()[1].push_back(B1_TYPED_VALUE(res[0].value));
+			}
+			else
+			{
+				emit_command(L"OUT", std::vector<std::wstring>({ dev_name, res[0].value }));
 			}
-		}
-	}
 
-	if(!dev_name.empty())
-	{
-		auto dopts = _global_settings.GetDeviceOptions(dev_name);
-		if(dopts == nullptr)
-		{
-			return B1C_T_ERROR::B1C_RES_EWDEVTYPE;
-		}
-		for(auto &o: dev_opts)
-		{
-			if(dopts->find(o) == dopts->cend())
+			if(exp_type == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL)
 			{
-				return B1C_T_ERROR::B1C_RES_EWDEVTYPE;
+				emit_command(L"LF", res[0].value);
 			}
 		}
+
+		if(!b1_curr_prog_line_offset)
+		{
+			break;
+		}
+
+		newline = false;
+	}
+
+	if(newline)
+	{
+		emit_command(L"OUT", std::vector<std::wstring>({ dev_name, L"NL"}));
 	}
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-// now the only USING clause option is XOR
-B1C_T_ERROR B1FileCompiler::st_read_using_clause(B1_CMP_ARGS &args, iterator pos)
+B1C_T_ERROR B1FileCompiler::st_input()
 {
-	B1_TOKENDATA td;
+	B1C_T_ERROR err;
+	bool get_prompt = true;
+	bool first = true;
 
-	args.clear();
+	std::wstring dev_name;
 
-	auto err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
-	if(err != B1_RES_OK)
+	err = read_device_name(std::vector({ std::wstring(B1C_DEV_OPT_TXT), std::wstring(B1C_DEV_OPT_IN) }), false, dev_name);
+	if(err != B1C_T_ERROR::B1C_RES_OK)
 	{
-		return static_cast<B1C_T_ERROR>(err);
+		return err;
 	}
-	else
-	if(td.length != 0 && (td.type & B1_TOKEN_TYPE_IDNAME) && !b1_t_strcmpi(_USING, b1_progline + td.offset, td.length))
+
+	auto rep_label = emit_label();
+
+	while(b1_curr_prog_line_offset != 0)
 	{
-		b1_curr_prog_line_offset = td.offset + td.length;
-		
-		err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
-		if(err != B1_RES_OK)
+		// build RPN
+		err = static_cast<B1C_T_ERROR>(b1_rpn_build(b1_curr_prog_line_offset, INPUT_STOP_TOKEN, &b1_curr_prog_line_offset));
+		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
-			return static_cast<B1C_T_ERROR>(err);
+			return err;
+		}
+		if(b1_rpn[0].flags == 0)
+		{
+			// INPUT statement without arguments
+			return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 		}
 
-		if(td.length != 0 && (td.type & B1_TOKEN_TYPE_IDNAME) && !b1_t_strcmpi(_XOR, b1_progline + td.offset, td.length))
+		if(get_prompt)
 		{
-			b1_curr_prog_line_offset = td.offset + td.length;
+			// test for optional prompt string
+			std::wstring prompt;
 
-			err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
-			if(err != B1_RES_OK)
+			if(concat_strings_rpn(prompt) == B1_RES_OK)
 			{
-				return static_cast<B1C_T_ERROR>(err);
+				if(b1_curr_prog_line_offset == 0)
+				{
+					// INPUT with prompt string only is not allowed
+					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				}
 			}
-			if(td.length != 1 || b1_progline[td.offset] != B1_T_C_OPBRACK)
+			else
 			{
-				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				prompt = L"\"" + B1CUtils::b1str_to_cstr(_PROMPT) + L"\"";
+				get_prompt = false;
 			}
-			b1_curr_prog_line_offset = td.offset + td.length;
-
-			bool read_second_val = false;
-			B1_CMP_EXP_TYPE res_type1 = B1_CMP_EXP_TYPE::B1_CMP_ET_UNKNOWN, res_type2 = B1_CMP_EXP_TYPE::B1_CMP_ET_UNKNOWN;
 
-			// read the first value: USING XOR(<value1>[,[<value2>]])
-			err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
-			if(err != B1_RES_OK)
+			if(prompt != L"\"\"")
 			{
-				return static_cast<B1C_T_ERROR>(err);
+				emit_command(L"OUT", std::vector<std::wstring>({ dev_name, prompt }));
 			}
+		}
 
-			if(td.length == 1 && b1_progline[td.offset] == B1_T_C_COMMA)
+		if(first)
+		{
+			emit_command(L"SET", std::vector<std::wstring>({ L"ERR", L"0" }));
+			first = false;
+		}
+
+		if(!get_prompt)
+		{
+			// compile the expression
+			B1_CMP_EXP_TYPE exp_type;
+			B1_CMP_ARG res;
+
+			err = static_cast<B1C_T_ERROR>(process_expression(end(), exp_type, res, true));
+			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
-				// the first value is omitted: USING XOR(,<value2>)
-				b1_curr_prog_line_offset = td.offset + td.length;
-				args.push_back(B1_CMP_ARG(L""));
-				read_second_val = true;
+				return err;
 			}
-			else
-			if(td.length == 1 && b1_progline[td.offset] == B1_T_C_CLBRACK)
+
+			if(exp_type != B1_CMP_EXP_TYPE::B1_CMP_ET_VAR)
 			{
-				// error, no values at all: USING XOR()
 				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 			}
-			else
-			{
-				auto err1 = b1_rpn_build(b1_curr_prog_line_offset, USING_SEPARATORS, &b1_curr_prog_line_offset);
-				if(err1 != B1_RES_OK)
-				{
-					return static_cast<B1C_T_ERROR>(err1);
-				}
-				if(b1_curr_prog_line_offset == 0)
-				{
-					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-				}
-
-				args.push_back(B1_CMP_ARG());
-				err1 = process_expression(pos, res_type1, args.back());
-				if(err1 != B1_RES_OK)
-				{
-					return static_cast<B1C_T_ERROR>(err1);
-				}
-				if(res_type1 == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
-				{
-					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-				}
 
-				if(b1_progline[b1_curr_prog_line_offset] == B1_T_C_CLBRACK)
-				{
-					// one value for both input and output data: USING XOR(<value>)
-					b1_curr_prog_line_offset++;
-					args.push_back(args.back());
-				}
-				else
-				{
-					// put the first value: USING XOR(<value1>, [<value2>])
-					b1_curr_prog_line_offset++;
-					read_second_val = true;
-				}
+			if(is_const_var(res[0].value))
+			{
+				return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
 			}
 
-			if(read_second_val)
-			{
-				auto err1 = b1_rpn_build(b1_curr_prog_line_offset, USING_SEPARATORS, &b1_curr_prog_line_offset);
-				if(err1 != B1_RES_OK)
-				{
-					return static_cast<B1C_T_ERROR>(err1);
-				}
-				if(b1_curr_prog_line_offset == 0 || b1_progline[b1_curr_prog_line_offset] != B1_T_C_CLBRACK)
-				{
-					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-				}
+			emit_command(L"IN", { B1_CMP_ARG(dev_name), res });
 
-				if(b1_rpn[0].flags == 0)
-				{
-					// the second value is omitted: USING XOR(<value1>,)
-					if(args.back()[0].value.empty())
-					{
-						return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-					}
-					args.push_back(B1_CMP_ARG(L""));
-				}
-				else
+			if(res.size() > 1)
+			{
+				for(auto l = res.crbegin(); l != res.crend() - 1; l++)
 				{
-					// process the second value
-					args.push_back(B1_CMP_ARG());
-					err1 = process_expression(pos, res_type2, args.back());
-					if(err1 != B1_RES_OK)
-					{
-						return static_cast<B1C_T_ERROR>(err1);
-					}
-					if(res_type2 == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
+					if(is_gen_local(l->value))
 					{
-						return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+						emit_command(L"LF", l->value);
 					}
 				}
-
-				b1_curr_prog_line_offset++;
 			}
 
-			if(res_type2 == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL)
+			emit_command(L"ERR", { B1_CMP_ARG(L""), rep_label });
+		}
+
+		get_prompt = false;
+
+		if(b1_curr_prog_line_offset != 0)
+		{
+			if(B1_T_ISCOMMA(b1_progline[b1_curr_prog_line_offset]))
 			{
-				emit_command(L"LF", args.back()[0].value);
+				b1_curr_prog_line_offset++;
 			}
-			if(res_type1 == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL)
+			else
 			{
-				emit_command(L"LF", (*std::prev(args.end(), 2))[0].value);
+				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 			}
 		}
-		else
-		{
-			return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-		}
-	}
-	else
-	{
-		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 	}
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-// PUT [#<dev_name>, ] <value1> [, <value2>, ..., <valueN>][USING XOR([IN_VALUE][,][OUT_VALUE])]: is_input = false, is_output = true
-// GET [#<dev_name>, ] <var1> [, <var2>, ..., <varN>][USING XOR([IN_VALUE][,][OUT_VALUE])]: is_input = true, is_output = false
-// TRANSFER [#<dev_name>, ] <var1> [, <var2>, ..., <varN>][USING XOR([IN_VALUE][,][OUT_VALUE])]: is_input = true, is_output = true
-B1C_T_ERROR B1FileCompiler::st_put_get_trr(const std::wstring &cmd_name, bool is_input, bool is_output)
+B1C_T_ERROR B1FileCompiler::st_read_range(std::vector<std::pair<B1_CMP_ARG, B1_CMP_EXP_TYPE>> &range)
 {
-	std::wstring dev_name;
-	auto dev_opts = std::vector({ std::wstring(B1C_DEV_OPT_BIN) });
-	std::vector<iterator> cmds;
-	iterator start = std::prev(end());
+	B1_TOKENDATA td;
+	auto saved_line_offset = b1_curr_prog_line_offset;
 
-	if(is_input)
+	auto err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+	if(err != B1_RES_OK)
 	{
-		dev_opts.push_back(B1C_DEV_OPT_IN);
+		b1_curr_prog_line_offset = saved_line_offset;
+		return static_cast<B1C_T_ERROR>(err);
 	}
-	if(is_output)
+	if(td.length == 0 || !(td.type & B1_TOKEN_TYPE_IDNAME))
 	{
-		dev_opts.push_back(B1C_DEV_OPT_OUT);
+		b1_curr_prog_line_offset = saved_line_offset;
+		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 	}
 
-	auto err = read_device_name(dev_opts, false, dev_name);
-	if(err != B1C_T_ERROR::B1C_RES_OK)
+	auto name = Utils::str_toupper(B1CUtils::get_progline_substring(td.offset, td.offset + td.length));
+	auto fn = get_fn(name);
+	if(fn != nullptr)
 	{
-		return err;
+		b1_curr_prog_line_offset = saved_line_offset;
+		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 	}
 
-	// read other statement arguments
-	while(b1_curr_prog_line_offset != 0)
-	{
-		// first try to read array range
-		std::vector<std::pair<B1_CMP_ARG, B1_CMP_EXP_TYPE>> range;
-		auto err = st_read_range(range);
-		if(err == static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM) || err == B1C_T_ERROR::B1C_RES_ERANGSNTX)
+	bool expl = true;
+	name = get_var_name(name, expl);
+
+	b1_curr_prog_line_offset = td.offset + td.length;
+	err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+	if(err != B1_RES_OK)
+	{
+		b1_curr_prog_line_offset = saved_line_offset;
+		return static_cast<B1C_T_ERROR>(err);
+	}
+	if(td.length == 0 || !(td.type & B1_TOKEN_TYPE_OPERATION) || b1_progline[b1_curr_prog_line_offset] != B1_T_C_OPBRACK)
+	{
+		b1_curr_prog_line_offset = saved_line_offset;
+		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+	}
+
+	b1_curr_prog_line_offset = td.offset + td.length;
+	err = st_dim_get_size(true, true, range);
+	if(err != B1_RES_OK)
+	{
+		b1_curr_prog_line_offset = saved_line_offset;
+		return static_cast<B1C_T_ERROR>(err);
+	}
+
+	if(b1_progline[b1_curr_prog_line_offset] != B1_T_C_CLBRACK)
+	{
+		b1_curr_prog_line_offset = saved_line_offset;
+		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+	}
+
+	b1_curr_prog_line_offset = td.offset + td.length;
+	err = st_dim_get_size(false, true, range);
+	if(err != B1_RES_OK)
+	{
+		return B1C_T_ERROR::B1C_RES_ERANGSNTX;
+	}
+
+	if(b1_progline[b1_curr_prog_line_offset] != B1_T_C_CLBRACK)
+	{
+		return B1C_T_ERROR::B1C_RES_ERANGSNTX;
+	}
+
+	b1_curr_prog_line_offset++;
+
+	// implicitly declared arrays are not allowed with PUT/GET/TRANSFER statements because their type is INT
+	if(!expl || get_var_type(name) != B1Types::B1T_BYTE || get_var_dim(name) != 1)
+	{
+		return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
+	}
+
+	err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+	if(err != B1_RES_OK)
+	{
+		b1_curr_prog_line_offset = saved_line_offset;
+		return static_cast<B1C_T_ERROR>(err);
+	}
+
+	if(td.length == 0)
+	{
+		b1_curr_prog_line_offset = 0;
+	}
+	else
+	{
+		b1_curr_prog_line_offset = td.offset;
+	}
+
+	range[0].first.insert(range[0].first.begin(), B1_TYPED_VALUE(name, B1Types::B1T_BYTE));
+	range[0].second = B1_CMP_EXP_TYPE::B1_CMP_ET_VAR;
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+B1C_T_ERROR B1FileCompiler::read_device_name(const std::vector<std::wstring> &dev_opts, bool allow_devname_only, std::wstring &dev_name)
+{
+	B1_TOKENDATA td;
+	auto saved_line_offset = b1_curr_prog_line_offset;
+
+	dev_name.clear();
+
+	// read optional device name
+	auto err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+	if(err != B1_RES_OK)
+	{
+		return static_cast<B1C_T_ERROR>(err);
+	}
+
+	if(td.length == 0)
+	{
+		if(!allow_devname_only)
+		{
+			return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+		}
+	}
+	else
+	if(td.type & B1_TOKEN_TYPE_DEVNAME)
+	{
+		b1_curr_prog_line_offset = td.offset + td.length;
+
+		dev_name = Utils::str_toupper(B1CUtils::get_progline_substring(td.offset, b1_curr_prog_line_offset));
+
+		err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+		if(err != B1_RES_OK)
+		{
+			return static_cast<B1C_T_ERROR>(err);
+		}
+
+		if(td.length != 1 || !B1_T_ISCOMMA(b1_progline[td.offset]))
+		{
+			if(!(allow_devname_only && td.length == 0))
+			{
+				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+			}
+		}
+		else
+		{
+			b1_curr_prog_line_offset = td.offset + td.length;
+		}
+	}
+	
+	if(dev_name.empty())
+	{
+		// no device name specified
+		b1_curr_prog_line_offset = saved_line_offset;
+
+		bool in_dev = std::find(dev_opts.cbegin(), dev_opts.cend(), B1C_DEV_OPT_IN) != dev_opts.cend();
+		bool out_dev = std::find(dev_opts.cbegin(), dev_opts.cend(), B1C_DEV_OPT_OUT) != dev_opts.cend();
+
+		if(!_opt_inputdevice_def && in_dev)
+		{
+			dev_name = _opt_inputdevice;
+		}
+
+		if(!_opt_outputdevice_def && out_dev)
+		{
+			dev_name = _opt_outputdevice;
+		}
+
+		if(in_dev && out_dev && !dev_name.empty())
+		{
+			if(_opt_inputdevice != _opt_outputdevice)
+			{
+				return B1C_T_ERROR::B1C_RES_EINCOPTS;
+			}
+		}
+	}
+
+	if(!dev_name.empty())
+	{
+		auto dopts = _global_settings.GetDeviceOptions(dev_name);
+		if(dopts == nullptr)
+		{
+			return B1C_T_ERROR::B1C_RES_EWDEVTYPE;
+		}
+		for(auto &o: dev_opts)
+		{
+			if(dopts->find(o) == dopts->cend())
+			{
+				return B1C_T_ERROR::B1C_RES_EWDEVTYPE;
+			}
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+// now the only USING clause option is XOR
+B1C_T_ERROR B1FileCompiler::st_read_using_clause(B1_CMP_ARGS &args, iterator pos)
+{
+	B1_TOKENDATA td;
+
+	args.clear();
+
+	auto err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+	if(err != B1_RES_OK)
+	{
+		return static_cast<B1C_T_ERROR>(err);
+	}
+	else
+	if(td.length != 0 && (td.type & B1_TOKEN_TYPE_IDNAME) && !b1_t_strcmpi(_USING, b1_progline + td.offset, td.length))
+	{
+		b1_curr_prog_line_offset = td.offset + td.length;
+		
+		err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+		if(err != B1_RES_OK)
+		{
+			return static_cast<B1C_T_ERROR>(err);
+		}
+
+		if(td.length != 0 && (td.type & B1_TOKEN_TYPE_IDNAME) && !b1_t_strcmpi(_XOR, b1_progline + td.offset, td.length))
+		{
+			b1_curr_prog_line_offset = td.offset + td.length;
+
+			err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+			if(err != B1_RES_OK)
+			{
+				return static_cast<B1C_T_ERROR>(err);
+			}
+			if(td.length != 1 || b1_progline[td.offset] != B1_T_C_OPBRACK)
+			{
+				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+			}
+			b1_curr_prog_line_offset = td.offset + td.length;
+
+			bool read_second_val = false;
+			B1_CMP_EXP_TYPE res_type1 = B1_CMP_EXP_TYPE::B1_CMP_ET_UNKNOWN, res_type2 = B1_CMP_EXP_TYPE::B1_CMP_ET_UNKNOWN;
+
+			// read the first value: USING XOR(<value1>[,[<value2>]])
+			err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+			if(err != B1_RES_OK)
+			{
+				return static_cast<B1C_T_ERROR>(err);
+			}
+
+			if(td.length == 1 && b1_progline[td.offset] == B1_T_C_COMMA)
+			{
+				// the first value is omitted: USING XOR(,<value2>)
+				b1_curr_prog_line_offset = td.offset + td.length;
+				args.push_back(B1_CMP_ARG(L""));
+				read_second_val = true;
+			}
+			else
+			if(td.length == 1 && b1_progline[td.offset] == B1_T_C_CLBRACK)
+			{
+				// error, no values at all: USING XOR()
+				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+			}
+			else
+			{
+				auto err1 = b1_rpn_build(b1_curr_prog_line_offset, USING_SEPARATORS, &b1_curr_prog_line_offset);
+				if(err1 != B1_RES_OK)
+				{
+					return static_cast<B1C_T_ERROR>(err1);
+				}
+				if(b1_curr_prog_line_offset == 0)
+				{
+					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				}
+
+				args.push_back(B1_CMP_ARG());
+				err1 = process_expression(pos, res_type1, args.back());
+				if(err1 != B1_RES_OK)
+				{
+					return static_cast<B1C_T_ERROR>(err1);
+				}
+				if(res_type1 == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
+				{
+					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				}
+
+				if(b1_progline[b1_curr_prog_line_offset] == B1_T_C_CLBRACK)
+				{
+					// one value for both input and output data: USING XOR(<value>)
+					b1_curr_prog_line_offset++;
+					args.push_back(args.back());
+				}
+				else
+				{
+					// put the first value: USING XOR(<value1>, [<value2>])
+					b1_curr_prog_line_offset++;
+					read_second_val = true;
+				}
+			}
+
+			if(read_second_val)
+			{
+				auto err1 = b1_rpn_build(b1_curr_prog_line_offset, USING_SEPARATORS, &b1_curr_prog_line_offset);
+				if(err1 != B1_RES_OK)
+				{
+					return static_cast<B1C_T_ERROR>(err1);
+				}
+				if(b1_curr_prog_line_offset == 0 || b1_progline[b1_curr_prog_line_offset] != B1_T_C_CLBRACK)
+				{
+					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				}
+
+				if(b1_rpn[0].flags == 0)
+				{
+					// the second value is omitted: USING XOR(<value1>,)
+					if(args.back()[0].value.empty())
+					{
+						return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+					}
+					args.push_back(B1_CMP_ARG(L""));
+				}
+				else
+				{
+					// process the second value
+					args.push_back(B1_CMP_ARG());
+					err1 = process_expression(pos, res_type2, args.back());
+					if(err1 != B1_RES_OK)
+					{
+						return static_cast<B1C_T_ERROR>(err1);
+					}
+					if(res_type2 == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
+					{
+						return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+					}
+				}
+
+				b1_curr_prog_line_offset++;
+			}
+
+			if(res_type2 == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL)
+			{
+				emit_command(L"LF", args.back()[0].value);
+			}
+			if(res_type1 == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL)
+			{
+				emit_command(L"LF", (*std::prev(args.end(), 2))[0].value);
+			}
+		}
+		else
+		{
+			return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+		}
+	}
+	else
+	{
+		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+// PUT [#<dev_name>, ] <value1> [, <value2>, ..., <valueN>][USING XOR([IN_VALUE][,][OUT_VALUE])]: is_input = false, is_output = true
+// GET [#<dev_name>, ] <var1> [, <var2>, ..., <varN>][USING XOR([IN_VALUE][,][OUT_VALUE])]: is_input = true, is_output = false
+// TRANSFER [#<dev_name>, ] <var1> [, <var2>, ..., <varN>][USING XOR([IN_VALUE][,][OUT_VALUE])]: is_input = true, is_output = true
+B1C_T_ERROR B1FileCompiler::st_put_get_trr(const std::wstring &cmd_name, bool is_input, bool is_output)
+{
+	std::wstring dev_name;
+	auto dev_opts = std::vector({ std::wstring(B1C_DEV_OPT_BIN) });
+	std::vector<iterator> cmds;
+	iterator start = std::prev(end());
+
+	if(is_input)
+	{
+		dev_opts.push_back(B1C_DEV_OPT_IN);
+	}
+	if(is_output)
+	{
+		dev_opts.push_back(B1C_DEV_OPT_OUT);
+	}
+
+	auto err = read_device_name(dev_opts, false, dev_name);
+	if(err != B1C_T_ERROR::B1C_RES_OK)
+	{
+		return err;
+	}
+
+	// read other statement arguments
+	while(b1_curr_prog_line_offset != 0)
+	{
+		// first try to read array range
+		std::vector<std::pair<B1_CMP_ARG, B1_CMP_EXP_TYPE>> range;
+		auto err = st_read_range(range);
+		if(err == static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM) || err == B1C_T_ERROR::B1C_RES_ERANGSNTX)
+		{
+			return err;
+		}
+
+		if(err == B1C_T_ERROR::B1C_RES_OK)
+		{
+			if(range[1].second == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
+			{
+				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+			}
+
+			if(is_input)
+			{
+				if(is_const_var(range[0].first[0].value))
+				{
+					return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
+				}
+			}
+
+			std::wstring count_local = emit_local(B1Types::B1T_UNKNOWN);
+			emit_command(L"-", { range[1].first, B1_CMP_ARG(range[0].first[1].value, range[0].first[1].type), B1_CMP_ARG(count_local) });
+			emit_command(L"+", std::vector<std::wstring>({ count_local, L"1", count_local }));
+			emit_command(cmd_name, std::vector<B1_CMP_ARG>({ dev_name, range[0].first, count_local }));
+			cmds.push_back(std::prev(end()));
+			emit_command(L"LF", count_local);
+
+			if(range[1].second == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL)
+			{
+				emit_command(L"LF", range[1].first[0].value);
+			}
+
+			if(is_gen_local(range[0].first[1].value))
+			{
+				emit_command(L"LF", range[0].first[1].value);
+			}
+		}
+		else
+		{
+			// build RPN
+			auto err1 = b1_rpn_build(b1_curr_prog_line_offset, PUT_GET_STOP_TOKENS, &b1_curr_prog_line_offset);
+			if(err1 != B1_RES_OK)
+			{
+				return static_cast<B1C_T_ERROR>(err1);
+			}
+
+			// no RPN: empty expression was specified to b1_rpn_build function
+			if(b1_rpn[0].flags == 0)
+			{
+				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+			}
+
+			// compile the expression
+			range.push_back(std::make_pair(B1_CMP_ARG(), B1_CMP_EXP_TYPE::B1_CMP_ET_UNKNOWN));
+			err1 = process_expression(end(), range[0].second, range[0].first, is_input);
+			if(err1 != B1_RES_OK)
+			{
+				return static_cast<B1C_T_ERROR>(err1);
+			}
+
+			if(range[0].first[0].value.empty())
+			{
+				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+			}
+
+			if(is_input)
+			{
+				if(range[0].second != B1_CMP_EXP_TYPE::B1_CMP_ET_VAR)
+				{
+					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				}
+
+				if(is_const_var(range[0].first[0].value))
+				{
+					return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
+				}
+
+				emit_command(cmd_name, std::vector<B1_CMP_ARG>({ dev_name, range[0].first }));
+				cmds.push_back(std::prev(end()));
+
+				if(range[0].first.size() > 1)
+				{
+					for(auto l = range[0].first.crbegin(); l != range[0].first.crend() - 1; l++)
+					{
+						if(is_gen_local(l->value))
+						{
+							emit_command(L"LF", l->value);
+						}
+					}
+				}
+			}
+			else
+			{
+				if(range[0].second == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
+				{
+					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				}
+
+				emit_command(cmd_name, std::vector<std::wstring>({ dev_name, range[0].first[0].value }));
+				cmds.push_back(std::prev(end()));
+
+				if(range[0].second == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL)
+				{
+					emit_command(L"LF", range[0].first[0].value);
+				}
+			}
+		}
+
+		if(b1_curr_prog_line_offset != 0)
+		{
+			if(B1_T_ISCOMMA(b1_progline[b1_curr_prog_line_offset]))
+			{
+				b1_curr_prog_line_offset++;
+			}
+			else
+			{
+				// check for USING keyword presence
+				B1_CMP_ARGS args;
+				err = st_read_using_clause(args, std::next(start));
+				if(err != B1C_T_ERROR::B1C_RES_OK)
+				{
+					return err;
+				}
+
+				for(auto &cmd: cmds)
+				{
+					B1_CMP_ARGS a;
+
+					if(!args[0][0].value.empty())
+					{
+						a.push_back(B1_CMP_ARG(L"XORIN", B1Types::B1T_BYTE));
+						a[0].push_back(args[0][0]);
+						emit_command(L"XARG", cmd, a);
+					}
+					
+					a.clear();
+					if(!args[1][0].value.empty())
+					{
+						a.push_back(B1_CMP_ARG(L"XOROUT", B1Types::B1T_BYTE));
+						a[0].push_back(args[1][0]);
+						emit_command(L"XARG", cmd, a);
+					}
+				}
+
+				break;
+			}
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+B1_T_ERROR B1FileCompiler::st_label(bool first_run)
+{
+	B1_T_ERROR err;
+	B1_TOKENDATA td;
+
+	// read label name
+	err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+	if(err != B1_RES_OK)
+	{
+		return err;
+	}
+
+	if(td.length == 0)
+	{
+		return B1_RES_ESYNTAX;
+	}
+
+	if(!(td.type & B1_TOKEN_TYPE_IDNAME))
+	{
+		return B1_RES_EINVTOK;
+	}
+
+	auto label_name = Utils::str_toupper(B1CUtils::get_progline_substring(td.offset, td.offset + td.length));
+	
+	if(first_run)
+	{
+		if(_labels.find(label_name) != _labels.cend())
+		{
+			return B1_RES_EIDINUSE;
+		}
+
+		_labels.insert(label_name);
+	}
+	else
+	{
+		emit_label(L"__ULB_" + label_name);
+	}
+
+	b1_curr_prog_line_offset = td.offset + td.length;
+	err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
+	if(err != B1_RES_OK)
+	{
+		return err;
+	}
+
+	if(td.length != 0)
+	{
+		return B1_RES_ESYNTAX;
+	}
+
+	return B1_RES_OK;
+}
+
+B1_CMP_CMDS::const_iterator B1FileCompiler::find_LF(B1_CMP_CMDS::const_iterator lacmd, B1_CMP_CMDS::const_iterator intlfcmd, bool& intlf_found)
+{
+	const auto &la = *lacmd;
+
+	intlf_found = false;
+
+	for(lacmd++; lacmd != cend(); lacmd++)
+	{
+		const auto &lf = *lacmd;
+
+		if(B1CUtils::is_label(lf))
+		{
+			continue;
+		}
+
+		if(lf.cmd == L"LF")
+		{
+			if(lacmd == intlfcmd)
+			{
+				intlf_found = true;
+				continue;
+			}
+
+			if(la.args[0][0].value == lf.args[0][0].value)
+			{
+				return lacmd;
+			}
+		}
+	}
+
+	return cend();
+}
+
+void B1FileCompiler::fix_LA_LF_order()
+{
+	std::stack<iterator> lastmt;
+	iterator tmp, lf;
+
+	for(auto i = begin(); i != end(); i++)
+	{
+		if(i->cmd == L"LA")
+		{
+			lastmt.push(i);
+			continue;
+		}
+
+		if(i->cmd == L"LF")
+		{
+			if(i->args[0][0].value == lastmt.top()->args[0][0].value)
+			{
+				lastmt.pop();
+			}
+			else
+			{
+				get_LA_LF(lastmt.top(), end(), tmp, lf);
+				insert(std::next(lf), *i);
+				tmp = std::prev(i);
+				erase(i);
+				i = tmp;
+			}
+		}
+	}
+}
+
+B1C_T_ERROR B1FileCompiler::remove_unused_labels(bool &changed)
+{
+	std::set<std::wstring> used_labels;
+	// index and name of every label
+	std::vector<std::pair<const_iterator, std::wstring>> labels;
+
+	changed = false;
+
+	// find and remove unused labels
+	for(auto cmdi = cbegin(); cmdi != cend(); cmdi++)
+	{
+		// do not remove function definitions
+		if(B1CUtils::is_label(*cmdi) && !B1CUtils::is_def_fn(*cmdi))
+		{
+			labels.push_back(std::pair<const_iterator, std::wstring>(cmdi, cmdi->cmd));
+		}
+		else
+		if(cmdi->cmd == L"JMP" || cmdi->cmd == L"JF" || cmdi->cmd == L"JT" || cmdi->cmd == L"CALL" || cmdi->cmd == L"ERR" || (cmdi->cmd == L"RST" && cmdi->args.size() > 1))
+		{
+			used_labels.insert(cmdi->args[(cmdi->cmd == L"RST" || cmdi->cmd == L"ERR") ? 1 : 0][0].value);
+		}
+	}
+
+	used_labels.insert(_req_labels.cbegin(), _req_labels.cend());
+
+	for(auto l = labels.crbegin(); l != labels.crend(); l++)
+	{
+		if(used_labels.find(l->second) == used_labels.end())
+		{
+			erase(l->first);
+			changed = true;
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+B1C_T_ERROR B1FileCompiler::remove_duplicate_labels(bool &changed)
+{
+	// find and remove duplicates
+	std::vector<std::vector<std::pair<const_iterator, bool>>> label_ranges;
+
+	changed = false;
+
+	decltype(label_ranges)::value_type range;
+
+	for(auto cmdi = cbegin(); cmdi != cend(); cmdi++)
+	{
+		// do not take into account functions and subroutines
+		if(B1CUtils::is_label(*cmdi))
+		{
+			range.push_back(std::make_pair(cmdi, (_req_labels.find(cmdi->cmd) != _req_labels.cend() || B1CUtils::is_def_fn(*cmdi) || _sub_labels.find(cmdi->cmd) != _sub_labels.cend())));
+		}
+		else
+		{
+			if(!range.empty())
+			{
+				label_ranges.push_back(range);
+				range.clear();
+			}
+		}
+	}
+	if(!range.empty())
+	{
+		label_ranges.push_back(range);
+		range.clear();
+	}
+
+	if(!label_ranges.empty())
+	{
+		std::map<std::wstring, std::wstring> toreplace;
+
+		// build list of labels to replace
+		for(const auto &lr: label_ranges)
+		{
+			// find label to keep
+			bool keep_all = true;
+			auto lk = lr.cend();
+
+			for(auto l = lr.cbegin(); l != lr.cend(); l++)
+			{
+				if(l->second && lk == lr.cend())
+				{
+					lk = l;
+				}
+				if(!l->second)
+				{
+					keep_all = false;
+				}
+			}
+			if(lk == lr.cend())
+			{
+				lk = std::prev(lr.cend());
+			}
+
+			if(!keep_all)
+			{
+				for(auto l = lr.cbegin(); l != lr.cend(); l++)
+				{
+					if(l == lk || l->second)
+					{
+						continue;
+					}
+					toreplace[l->first->cmd] = lk->first->cmd;
+				}
+			}
+		}
+
+		// replace labels marked for deletion
+		for(auto &cmd: *this)
+		{
+			if(B1CUtils::is_label(cmd))
+			{
+				continue;
+			}
+
+			if(cmd.cmd == L"JMP" || cmd.cmd == L"JF" || cmd.cmd == L"JT" || cmd.cmd == L"CALL" || cmd.cmd == L"ERR" || (cmd.cmd == L"RST" && cmd.args.size() > 1))
+			{
+				int i = (cmd.cmd == L"RST" || cmd.cmd == L"ERR") ? 1 : 0;
+				auto rep = toreplace.find(cmd.args[i][0].value);
+				if(rep != toreplace.end())
+				{
+					cmd.edit_args()[i][0].value = rep->second;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+bool B1FileCompiler::is_udef_used(const B1_TYPED_VALUE &val)
+{
+	auto fn = get_fn(val);
+	if(fn != nullptr && !fn->isstdfn)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+bool B1FileCompiler::is_udef_used(const B1_CMP_ARG &arg)
+{
+	auto fn = get_fn(arg);
+	if(fn != nullptr && !fn->isstdfn)
+	{
+		return true;
+	}
+
+	for(const auto &aa: arg)
+	{
+		if(is_udef_used(aa))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool B1FileCompiler::is_udef_used(const B1_CMP_CMD &cmd)
+{
+	if(B1CUtils::is_label(cmd))
+	{
+		return false;
+	}
+
+	if(cmd.cmd == L"GA")
+	{
+		for(auto a = cmd.args.begin() + 2; a != cmd.args.end(); a++)
+		{
+			if(is_udef_used(*a))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	if(cmd.cmd == L"RETVAL")
+	{
+		return is_udef_used(cmd.args[0]);
+	}
+
+	if(cmd.cmd == L"OUT")
+	{
+		return is_udef_used(cmd.args[1]);
+	}
+
+	if(cmd.cmd == L"IN")
+	{
+		return is_udef_used(cmd.args[1]);
+	}
+
+	if(cmd.cmd == L"SET")
+	{
+		return is_udef_used(cmd.args[1]);
+	}
+
+	if(cmd.cmd == L"IOCTL")
+	{
+		return (cmd.args.size() > 2) ? is_udef_used(cmd.args[2]) : false;
+	}
+
+	if(cmd.cmd == L"READ")
+	{
+		return is_udef_used(cmd.args[1]);
+	}
+
+	if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
+	{
+		return (cmd.args.size() == 2) ? is_udef_used(cmd.args[1]) : (is_udef_used(cmd.args[1]) || is_udef_used(cmd.args[2]));
+	}
+
+	if(cmd.cmd == L"XARG")
+	{
+		return is_udef_used(cmd.args[0]);
+	}
+
+
+	if(cmd.args.size() == 2)
+	{
+		for(auto &op: B1CUtils::_un_ops)
+		{
+			if(cmd.cmd == op)
+			{
+				for(const auto &a: cmd.args)
+				{
+					if(is_udef_used(a))
+					{
+						return true;
+					}
+				}
+
+				return false;
+			}
+		}
+
+		for(auto &op: B1CUtils::_log_ops)
+		{
+			if(cmd.cmd == op)
+			{
+				for(const auto &a: cmd.args)
+				{
+					if(is_udef_used(a))
+					{
+						return true;
+					}
+				}
+
+				return false;
+			}
+		}
+	}
+
+	if(cmd.args.size() == 3)
+	{
+		for(auto &op: B1CUtils::_bin_ops)
+		{
+			if(cmd.cmd == op)
+			{
+				for(const auto &a: cmd.args)
+				{
+					if(is_udef_used(a))
+					{
+						return true;
+					}
+				}
+
+				return false;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool B1FileCompiler::is_volatile_used(const B1_CMP_ARG &arg)
+{
+	for(const auto &aa: arg)
+	{
+		if(!B1CUtils::is_imm_val(aa.value) && is_volatile_var(aa.value))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool B1FileCompiler::is_volatile_used(const B1_CMP_CMD &cmd)
+{
+	if(B1CUtils::is_label(cmd))
+	{
+		return false;
+	}
+
+	if(cmd.cmd == L"GA")
+	{
+		for(auto a = cmd.args.begin() + 2; a != cmd.args.end(); a++)
+		{
+			if(is_volatile_used(*a))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	if(cmd.cmd == L"RETVAL")
+	{
+		return is_volatile_used(cmd.args[0]);
+	}
+
+	if(cmd.cmd == L"OUT")
+	{
+		return is_volatile_used(cmd.args[1]);
+	}
+
+	if(cmd.cmd == L"IN")
+	{
+		return is_volatile_used(cmd.args[1]);
+	}
+
+	if(cmd.cmd == L"SET")
+	{
+		return is_volatile_used(cmd.args[1]);
+	}
+
+	if(cmd.cmd == L"IOCTL")
+	{
+		return (cmd.args.size() > 2) ? is_volatile_used(cmd.args[2]) : false;
+	}
+
+	if(cmd.cmd == L"READ")
+	{
+		return is_volatile_used(cmd.args[1]);
+	}
+
+	if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
+	{
+		return (cmd.args.size() == 2) ? is_volatile_used(cmd.args[1]) : (is_volatile_used(cmd.args[1]) || is_volatile_used(cmd.args[2]));
+	}
+
+	if(cmd.cmd == L"XARG")
+	{
+		return is_volatile_used(cmd.args[0]);
+	}
+
+	if(cmd.args.size() == 2)
+	{
+		for(auto &op: B1CUtils::_un_ops)
+		{
+			if(cmd.cmd == op)
+			{
+				for(const auto &a: cmd.args)
+				{
+					if(is_volatile_used(a))
+					{
+						return true;
+					}
+				}
+
+				return false;
+			}
+		}
+
+		for(auto &op: B1CUtils::_log_ops)
+		{
+			if(cmd.cmd == op)
+			{
+				for (const auto &a: cmd.args)
+				{
+					if(is_volatile_used(a))
+					{
+						return true;
+					}
+				}
+
+				return false;
+			}
+		}
+	}
+
+	if(cmd.args.size() == 3)
+	{
+		for(auto &op: B1CUtils::_bin_ops)
+		{
+			if(cmd.cmd == op)
+			{
+				for(const auto &a: cmd.args)
+				{
+					if(is_volatile_used(a))
+					{
+						return true;
+					}
+				}
+
+				return false;
+			}
+		}
+	}
+
+	return false;
+}
+
+// builds control-flow graph of the file code
+B1_CMP_FLOW B1FileCompiler::get_flow()
+{
+	return B1_CMP_FLOW(*this,
+		[this](const std::wstring &label)
+		{
+			// subroutines, functions and labels used indirectly (e.g. with IOCTL statement)
+			return _sub_labels.find(label) != _sub_labels.cend() || _req_labels.find(label) != _req_labels.cend() || B1CUtils::is_def_fn(label);
+		},
+		[this](const B1_CMP_CMD &cmd)
+		{
+			// user defined functions can use any variable
+			return is_udef_used(cmd);
+		});
+}
+
+// checks if source arguments of unary or binary operation contain function calls (reading function values can have side effects)
+bool B1FileCompiler::is_fn_used(const B1_CMP_CMD &cmd)
+{
+	for(auto a = cmd.args.cbegin(); a != cmd.args.cend() - 1; a++)
+	{
+		if((*a)[0].value == L"IOCTL" || (*a)[0].value == L"IOCTL$" || get_fn(*a) != nullptr)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+B1C_T_ERROR B1FileCompiler::remove_duplicate_assigns(bool &changed)
+{
+	changed = false;
+
+	// remove assignments of values that are never read: overwritten on every path or not used at all
+	// =,10,A
+	// JT,label1  ->  the first line is removed
+	// =,15,A
+	// ...
+	// :label1
+	// =,20,A
+	auto flow = get_flow();
+	flow.calc_liveness();
+
+	const auto &blocks = flow.get_blocks();
+
+	for(int b = 0; b < (int)blocks.size(); b++)
+	{
+		auto live = flow.get_live_out(b);
+		std::vector<const_iterator> rem;
+
+		for(auto i = blocks[b].last; i != blocks[b].first; )
+		{
+			i--;
+
+			const auto &cmd = *i;
+
+			if(!B1CUtils::is_label(cmd) && (B1CUtils::is_un_op(cmd) || B1CUtils::is_bin_op(cmd)) && !is_volatile_used(cmd) && !is_fn_used(cmd))
+			{
+				const auto &dstarg = cmd.args.back();
+
+				if(dstarg.size() == 1 && !flow.is_live(live, dstarg[0].value))
+				{
+					// the command is removed so it does not make its arguments live
+					rem.push_back(i);
+					continue;
+				}
+			}
+
+			flow.live_step_back(cmd, live);
+		}
+
+		for(const auto &r: rem)
+		{
+			erase(r);
+			changed = true;
+		}
+	}
+
+	// assignments to subscripted variables and assignments of function values
+	for(auto i = cbegin(); i != cend(); i++)
+	{
+		const auto &cmd =*i;
+
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		if(is_volatile_used(cmd))
+		{
+			continue;
+		}
+
+		const B1_CMP_ARG *dstarg = nullptr;
+
+		if(B1CUtils::is_un_op(cmd))
+		{
+			dstarg = &cmd.args[1];
+		}
+		else
+		if(B1CUtils::is_bin_op(cmd))
+		{
+			dstarg = &cmd.args[2];
+		}
+		else
+		{
+			continue;
+		}
+
+		if(dstarg->size() == 1 && !is_fn_used(cmd))
+		{
+			continue;
+		}
+
+		std::set<std::wstring> jumps;
+		std::set<std::wstring> labels;
+
+		for(auto j = std::next(i); j != cend(); j++)
+		{
+			const auto &cmd1 = *j;
+
+			if(B1CUtils::is_label(cmd1))
+			{
+				labels.insert(cmd1.cmd);
+				continue;
+			}
+
+			if(cmd1.cmd == L"JMP" || cmd1.cmd == L"JT" || cmd1.cmd == L"JF" || cmd1.cmd == L"ERR")
+			{
+				jumps.insert(cmd1.args[cmd1.cmd == L"ERR" ? 1 : 0][0].value);
+			}
+
+			if(cmd1.cmd == L"CALL" || cmd1.cmd == L"END" || cmd1.cmd == L"RET")
+			{
+				break;
+			}
+
+			bool is_local = false;
+
+			if(dstarg->size() > 1)
+			{
+				// forbid deleting assignment to a subscripted variable if its subscripts are variables
+				auto a = dstarg->begin() + 1;
+				for(; a != dstarg->end(); a++)
+				{
+					if(!B1CUtils::is_imm_val(a->value))
+					{
+						break;
+					}
+				}
+				if(a != dstarg->end())
+				{
+					break;
+				}
+
+				// forbid deleting assignment to a subscripted variable if the variable is used somewhere else
+				// =,10,A(5)
+				// =,A(I),B   ->  do not delete the first line because I can be equal to 5
+				// =,15,A(5)
+				if(B1CUtils::is_src(cmd1, (*dstarg)[0].value))
+				{
+					break;
+				}
+			}
+			else
+			{
+				is_local = is_gen_local((*dstarg)[0].value);
+			}
+
+			if(B1CUtils::arg_is_src(cmd1, *dstarg))
+			{
+				break;
+			}
+
+			//no user defined functions calls (functions can use dstarg)
+			// =,10,A
+			// =,DOSOMETHING(B),C  ->  do not delete the first line because DOSOMETHING fn can use it
+			// =,15,A
+			if(!is_local && is_udef_used(cmd1))
+			{
+				break;
+			}
+
+			if(B1CUtils::arg_is_dst(cmd1, *dstarg, is_local))
+			{
+				if(std::includes(labels.cbegin(), labels.cend(), jumps.cbegin(), jumps.cend()))
+				{
+					erase(i--);
+					changed = true;
+				}
+				break;
+			}
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+B1C_T_ERROR B1FileCompiler::remove_self_assigns(bool &changed)
+{
+	changed = false;
+
+	// remove assignments like "=,<var>,<the_same_var>"
+	for(auto i = cbegin(); i != cend(); i++)
+	{
+		auto &cmd = *i;
+
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		if(cmd.cmd == L"=" && cmd.args[0] == cmd.args[1])
+		{
+			if(is_volatile_used(cmd))
+			{
+				continue;
+			}
+
+			// subscripts should not be functions
+			bool fn_used = false;
+
+			for(auto a = cmd.args[0].begin() + 1; a != cmd.args[0].end(); a++)
+			{
+				if(fn_exists(a->value))
+				{
+					fn_used = true;
+					break;
+				}
+			}
+
+			if(!fn_used)
+			{
+				erase(i--);
+				changed = true;
+			}
+
+			continue;
+		}
+	}
+
+	// optimize assignments like
+	// =,<var1>,<var2>
+	// =,<var2>,<var1>
+	for(auto i = cbegin(); i != cend(); i++)
+	{
+		auto &cmd = *i;
+
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		auto j = i;
+		j++;
+		if(j == cend())
+		{
+			break;
+		}
+
+		auto &cmd1 = *j;
+
+		if(	(cmd.cmd == L"=" && cmd.args[0].size() == 1 && cmd.args[1].size() == 1) && 
+			(cmd1.cmd == L"=" && cmd1.args[0].size() == 1 && cmd1.args[1].size() == 1) &&
+			(cmd.args[0][0].value == cmd1.args[1][0].value && cmd.args[1][0].value == cmd1.args[0][0].value))
+		{
+			if(	(cmd.args[0][0].type == B1Types::B1T_STRING && cmd.args[1][0].type != B1Types::B1T_STRING) ||
+				(cmd.args[0][0].type != B1Types::B1T_STRING && cmd.args[1][0].type == B1Types::B1T_STRING))
+			{
+				continue;
+			}
+
+			if(	(cmd.args[1][0].type == B1Types::B1T_BYTE && cmd.args[0][0].type != B1Types::B1T_BYTE) ||
+				(cmd.args[1][0].type != B1Types::B1T_LONG && cmd.args[0][0].type == B1Types::B1T_LONG))
+			{
+				continue;
+			}
+
+			if(is_volatile_used(cmd))
+			{
+				continue;
+			}
+
+			if(fn_exists(cmd.args[0][0].value) || fn_exists(cmd.args[1][0].value))
+			{
+				continue;
+			}
+
+			erase(j);
+			changed = true;
+
+			continue;
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+B1C_T_ERROR B1FileCompiler::remove_jumps(bool &changed)
+{
+	changed = false;
+
+	// remove all commands between JMP, RET or END and the next label
+	for(auto i = cbegin(); i != cend(); i++)
+	{
+		auto &cmd = *i;
+
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		if(cmd.cmd == L"JMP" || cmd.cmd == L"RET" || cmd.cmd == L"END")
+		{
+			for(i++; i != cend(); i++)
+			{
+				auto &cmd1 = *i;
+
+				if(B1CUtils::is_label(cmd1) || cmd1.cmd == L"LA" || cmd1.cmd == L"LF")
+				{
+					break;
+				}
+
+				if(!(cmd1.cmd == L"DAT" || cmd1.cmd == L"DEF" || cmd1.cmd == L"MA" || cmd1.cmd == L"NS" || cmd1.cmd == L"END" ||
+					 (cmd1.cmd == L"GA" && cmd1.args[1].size() > 1) || B1CUtils::is_log_op(cmd1)
+					))
+				{
+					erase(i--);
+					changed = true;
+				}
+			}
+
+			if(i == cend())
+			{
+				break;
+			}
+		}
+	}
+
+	// remove jumps on the next commmand
+	for(auto i = cbegin(); i != cend(); i++)
+	{
+		auto &cmd = *i;
+
+		if(cmd.cmd == L"JMP" || cmd.cmd == L"JF" || cmd.cmd == L"JT")
+		{
+			auto nxti = std::next(i);
+			if(nxti == cend())
+			{
+				break;
+			}
+
+			auto &cmd1 = *nxti;
+			if(B1CUtils::is_label(cmd1) && cmd.args[0][0].value == cmd1.cmd)
+			{
+				erase(i);
+				i = nxti;
+
+				changed = true;
+			}
+		}
+	}
+
+	// JF,l1
+	// JMP(JT),l2  ->   JT,l2
+	// :l1              :l1
+	//
+	// JT,l1
+	// JMP(JF),l2  ->   JF,l2
+	//:l1              :l1
+	for(auto i = begin(); i != end(); i++)
+	{
+		auto &cmd = *i;
+
+		if(cmd.cmd == L"JF" || cmd.cmd == L"JT")
+		{
+			auto nxti = std::next(i);
+			if(nxti == end())
+			{
+				break;
+			}
+			auto &cmd1 = *nxti;
+
+			if((cmd1.cmd == L"JMP" || cmd1.cmd == L"JF" || cmd1.cmd == L"JT") &&
+				cmd.cmd != cmd1.cmd)
+			{
+				nxti = std::next(nxti);
+				if(nxti == end())
+				{
+					break;
+				}
+				auto &cmd2 = *nxti;
+
+				if(B1CUtils::is_label(cmd2) && cmd.args[0][0].value == cmd2.cmd)
+				{
+					cmd1.set_cmd((cmd.cmd == L"JF") ? L"JT" : L"JF");
+					erase(i);
+					i = nxti;
+
+					changed = true;
+				}
+			}
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+// remove compare operation, convert JT/JF to JMP and remove JF/JT
+void B1FileCompiler::remove_compare_op(B1_CMP_CMDS::iterator i, bool is_true)
+{
+	// remove compare operation, convert JT/JF to JMP and remove JF/JT
+	erase(i++);
+
+	for(auto j = i; j != end(); j++)
+	{
+		auto &cmd = *j;
+
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		if((!is_true && cmd.cmd == L"JF") || (is_true && cmd.cmd == L"JT"))
+		{
+			cmd.set_cmd(L"JMP");
+			continue;
+		}
+
+		if((!is_true && cmd.cmd == L"JT") || (is_true && cmd.cmd == L"JF"))
+		{
+			erase(j--);
+			continue;
+		}
+
+		if(B1CUtils::is_log_op(cmd) || cmd.cmd == L"JMP" || cmd.cmd == L"END" || cmd.cmd == L"RET" || cmd.cmd == L"ERR")
+		{
+			break;
+		}
+	}
+}
+
+B1C_T_ERROR B1FileCompiler::remove_redundant_comparisons(bool &changed)
+{
+	changed = false;
+
+	// remove unused compare operations (no JF or JT after logical operator)
+	for(auto i = cbegin(); i != cend(); i++)
+	{
+		auto &cmd = *i;
+
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		if(B1CUtils::is_log_op(cmd) && !is_volatile_used(cmd))
+		{
+			for(auto j = std::next(i); j != cend(); j++)
+			{
+				auto &cmd1 = *j;
+
+				if(B1CUtils::is_label(cmd1))
+				{
+					continue;
+				}
+
+				if(cmd1.cmd == L"JT" || cmd1.cmd == L"JF")
+				{
+					break;
+				}
+
+				if(B1CUtils::is_log_op(cmd1) || cmd1.cmd == L"JMP" || cmd1.cmd == L"END" || cmd1.cmd == L"RET" || cmd1.cmd == L"ERR" || cmd1.cmd == L"RETVAL")
+				{
+					erase(i--);
+
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// optimize comparisons of the same variables (e.g. A(I) is always equal to A(I)) and evaluate comparison of immediate numeric values (e.g. 2 > 1)
+	for(auto i = begin(); i != end(); i++)
+	{
+		auto &cmd = *i;
+
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		if(B1CUtils::is_log_op(cmd) && !is_volatile_used(cmd))
+		{
+			bool eq = false;
+			bool lt = false;
+			bool lt_comp = false;
+
+			if(cmd.args[0].size() == 1 && cmd.args[1].size() == 1 && B1CUtils::is_num_val(cmd.args[0][0].value) && B1CUtils::is_num_val(cmd.args[1][0].value))
+			{
+				// compare numeric values
+				int32_t n1, n2;
+
+				if(Utils::str2int32(cmd.args[0][0].value, n1) == B1_RES_OK && Utils::str2int32(cmd.args[1][0].value, n2) == B1_RES_OK)
+				{
+					eq = n1 == n2;
+					lt = n1 < n2;
+					lt_comp = true;
+				}
+				else
+				{
+					eq = cmd.args[0] == cmd.args[1];
+				}
+			}
+			else
+			{
+				eq = cmd.args[0] == cmd.args[1];
+			}
+
+			bool is_true = false;
+
+			if(cmd.cmd == L"==")
+			{
+				if(lt_comp)
+				{
+					is_true = eq;
+				}
+				else
+				{
+					if(eq)
+					{
+						is_true = true;
+					}
+					else
+					{
+						continue;
+					}
+				}
+			}
+			else
+			if(cmd.cmd == L"<>")
+			{
+				if(lt_comp)
+				{
+					is_true = !eq;
+				}
+				else
+				{
+					if(eq)
+					{
+						is_true = false;
+					}
+					else
+					{
+						continue;
+					}
+				}
+			}
+			else
+			if(cmd.cmd == L">")
+			{
+				if(lt_comp)
+				{
+					is_true = !(eq || lt);
+				}
+				else
+				{
+					if(eq)
+					{
+						is_true = false;
+					}
+					else
+					{
+						continue;
+					}
+				}
+			}
+			else
+			if(cmd.cmd == L"<")
+			{
+				if(lt_comp)
+				{
+					is_true = lt;
+				}
+				else
+				{
+					if(eq)
+					{
+						is_true = false;
+					}
+					else
+					{
+						continue;
+					}
+				}
+			}
+			else
+			if(cmd.cmd == L">=")
+			{
+				if(lt_comp)
+				{
+					is_true = !lt;
+				}
+				else
+				{
+					if(eq)
+					{
+						is_true = true;
+					}
+					else
+					{
+						continue;
+					}
+				}
+			}
+			else
+			if(cmd.cmd == L"<=")
+			{
+				if(lt_comp)
+				{
+					is_true = lt || eq;
+				}
+				else
+				{
+					if(eq)
+					{
+						is_true = true;
+					}
+					else
+					{
+						continue;
+					}
+				}
+			}
+
+			remove_compare_op(i--, is_true);
+			changed = true;
+		}
+	}
+
+	// remove unnecessary comparisons of unsigned variables to negative and zero values 
+	for(auto i = begin(); i != end(); i++)
+	{
+		auto &cmd = *i;
+
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		if(B1CUtils::is_log_op(cmd) && !is_volatile_used(cmd))
+		{
+			int32_t n;
+			// numeric is on the left side of the expression
+			bool lnum = false;
+			B1Types vtype;
+			int32_t min, max;
+			bool proceed = false;
+
+			if(cmd.args[0].size() == 1 && B1CUtils::is_num_val(cmd.args[0][0].value) && Utils::str2int32(cmd.args[0][0].value, n) == B1_RES_OK && !B1CUtils::is_imm_val(cmd.args[1][0].value) && cmd.args[1][0].type != B1Types::B1T_STRING)
+			{
+				Utils::correct_int_value(n, cmd.args[0][0].type);
+				lnum = true;
+				vtype = cmd.args[1][0].type;
+				proceed = true;
+			}
+			else
+			if(cmd.args[1].size() == 1 && B1CUtils::is_num_val(cmd.args[1][0].value) && Utils::str2int32(cmd.args[1][0].value, n) == B1_RES_OK && !B1CUtils::is_imm_val(cmd.args[0][0].value) && cmd.args[0][0].type != B1Types::B1T_STRING)
+			{
+				Utils::correct_int_value(n, cmd.args[1][0].type);
+				vtype = cmd.args[0][0].type;
+				proceed = true;
+			}
+
+			if(proceed)
+			{
+				if(vtype == B1Types::B1T_LONG)
+				{
+					min = INT32_MIN;
+					max = INT32_MAX;
+				}
+				else
+				if(vtype == B1Types::B1T_INT)
+				{
+					min = -32768;
+					max = 32767;
+				}
+				else
+				if(vtype == B1Types::B1T_WORD)
+				{
+					min = 0;
+					max = 65535;
+				}
+				else
+				{
+					min = 0;
+					max = 255;
+				}
+
+				if(n >= max)
+				{
+					if((!lnum && cmd.cmd == L">") || (lnum && cmd.cmd == L"<"))
+					{
+						remove_compare_op(i--, false);
+						changed = true;
+						continue;
+					}
+
+					if((!lnum && cmd.cmd == L"<=") || (lnum && cmd.cmd == L">="))
+					{
+						remove_compare_op(i--, true);
+						changed = true;
+						continue;
+					}
+
+					if((!lnum && cmd.cmd == L">=") || (lnum && cmd.cmd == L"<="))
+					{
+						if(n == max)
+						{
+							cmd.set_cmd(L"==");
+							i--;
+						}
+						else
+						{
+							remove_compare_op(i--, false);
+						}
+						
+						changed = true;
+						continue;
+					}
+
+					if((!lnum && cmd.cmd == L"<") || (lnum && cmd.cmd == L">"))
+					{
+						if(n == max)
+						{
+							cmd.set_cmd(L"<>");
+						}
+						else
+						{
+							remove_compare_op(i--, true);
+						}
+
+						changed = true;
+						continue;
+					}
+				}
+
+				if(n <= min)
+				{
+					if((!lnum && cmd.cmd == L">=") || (lnum && cmd.cmd == L"<="))
+					{
+						remove_compare_op(i--, true);
+						changed = true;
+						continue;
+					}
+
+					if((!lnum && cmd.cmd == L"<") || (lnum && cmd.cmd == L">"))
+					{
+						remove_compare_op(i--, false);
+						changed = true;
+						continue;
+					}
+
+					if((!lnum && cmd.cmd == L">") || (lnum && cmd.cmd == L"<"))
+					{
+						if(n == min)
+						{
+							cmd.set_cmd(L"<>");
+							i--;
+						}
+						else
+						{
+							remove_compare_op(i--, true);
+						}
+						
+						changed = true;
+						continue;
+					}
+
+					if((!lnum && cmd.cmd == L"<=") || (lnum && cmd.cmd == L">="))
+					{
+						if(n == min)
+						{
+							cmd.set_cmd(L"==");
+							i--;
+						}
+						else
+						{
+							remove_compare_op(i--, false);
+						}
+
+						changed = true;
+						continue;
+					}
+				}
+
+				if(n > max)
+				{
+					if(cmd.cmd == L"==" || cmd.cmd == L"<>")
+					{
+						remove_compare_op(i--, cmd.cmd == L"<>");
+						changed = true;
+						continue;
+					}
+				}
+
+				if(n < min)
+				{
+					if(cmd.cmd == L"==" || cmd.cmd == L"<>")
+					{
+						remove_compare_op(i--, cmd.cmd == L"<>");
+						changed = true;
+						continue;
+					}
+				}
+			}
+		}
+	}
+
+	// optimize comparison with zero value
+	for(auto i = begin(); i != end(); i++)
+	{
+		auto &cmd = *i;
+
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		if(B1CUtils::is_log_op(cmd))
+		{
+			int32_t n;
+
+			if((cmd.args[0][0].type == B1Types::B1T_BYTE || cmd.args[0][0].type == B1Types::B1T_WORD) && 
+				cmd.args[1].size() == 1 && B1CUtils::is_num_val(cmd.args[1][0].value) && Utils::str2int32(cmd.args[1][0].value, n) == B1_RES_OK && n == 0)
+			{
+				if(cmd.cmd == L">")
+				{
+					cmd.set_cmd(L"<>");
+					changed = true;
+					continue;
+				}
+				else
+				if(cmd.cmd == L"<=")
+				{
+					cmd.set_cmd(L"==");
+					changed = true;
+					continue;
+				}
+			}
+			else
+			if((cmd.args[1][0].type == B1Types::B1T_BYTE || cmd.args[1][0].type == B1Types::B1T_WORD) && 
+				cmd.args[0].size() == 1 && B1CUtils::is_num_val(cmd.args[0][0].value) && Utils::str2int32(cmd.args[0][0].value, n) == B1_RES_OK && n == 0)
+			{
+				if(cmd.cmd == L"<=" || cmd.cmd == L">=")
+				{
+					cmd.set_cmd(L"==");
+					changed = true;
+					continue;
+				}
+			}
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+// does not take into account value type, just changes its sign
+// -,<imm_val>,var  ->  =,-<imm_val>,var
+B1C_T_ERROR B1FileCompiler::replace_unary_minus(bool &changed)
+{
+	changed = false;
+
+	for(auto &cmd: *this)
+	{
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		// get rid from unary minus
+		// -,10,A  ->  =,-10,A
+		if(cmd.cmd == L"-" && cmd.args.size() == 2 && B1CUtils::is_num_val(cmd.args[0][0].value))
+		{
+			cmd.set_cmd(L"=");
+			if(cmd.args[0][0].value.find(L"-") == 0)
+			{
+				cmd.edit_args()[0][0].value.erase(0, 1);
+			}
+			else
+			{
+				cmd.edit_args()[0][0].value.insert(0, L"-");
+			}
+
+			changed = true;
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+// -,<imm_val>,var  ->  =,-<imm_val>,var
+B1C_T_ERROR B1FileCompiler::eval_unary_ops(bool &changed)
+{
+	changed = false;
+
+	for(auto &cmd: *this)
+	{
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		// get rid from unary minus and NOT operations
+		// -,10,A  ->  =,-10,A
+		if((cmd.cmd == L"-" || cmd.cmd == L"!") && cmd.args.size() == 2 && B1CUtils::is_num_val(cmd.args[0][0].value))
+		{
+			if(cmd.cmd == L"-")
+			{
+				// if type is absent just change the sign
+				if(cmd.args[0][0].type == B1Types::B1T_UNKNOWN)
+				{
+					cmd.set_cmd(L"=");
+					if(cmd.args[0][0].value.find(L"-") == 0)
+					{
+						cmd.edit_args()[0][0].value.erase(0, 1);
+					}
+					else
+					{
+						cmd.edit_args()[0][0].value.insert(0, L"-");
+					}
+				}
+				// if value type is present process the value as numeric
+				else
+				{
+					int32_t n;
+
+					auto err = Utils::str2int32(cmd.args[0][0].value, n);
+					if(err != B1_RES_OK)
+					{
+						return static_cast<B1C_T_ERROR>(err);
+					}
+
+					Utils::correct_int_value(n, cmd.args[0][0].type);
+					n = -n;
+					Utils::correct_int_value(n, cmd.args[0][0].type);
+
+					cmd.set_cmd(L"=");
+					cmd.edit_args()[0][0].value = std::to_wstring(n);
+				}
+			}
+			else
+			{
+				// evaluate binary NOT only if value type is specified
+				if(cmd.args[0][0].type == B1Types::B1T_UNKNOWN)
+				{
+					continue;
+				}
+
+				int32_t n;
+
+				auto err = Utils::str2int32(cmd.args[0][0].value, n);
+				if(err != B1_RES_OK)
+				{
+					return static_cast<B1C_T_ERROR>(err);
+				}
+
+				Utils::correct_int_value(n, cmd.args[0][0].type);
+				n = ~n;
+				Utils::correct_int_value(n, cmd.args[0][0].type);
+
+				cmd.set_cmd(L"=");
+				cmd.edit_args()[0][0].value = std::to_wstring(n);
+			}
+
+			changed = true;
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+void B1FileCompiler::set_to_init_value_arg(B1_CMP_CMD &cmd, int arg_num, bool is_dst, const std::map<std::wstring, std::pair<bool, std::wstring>> &vars, bool init, bool &changed)
+{
+	const auto &arg = cmd.args[arg_num];
+
+	for(auto aa = arg.begin(); aa != arg.end(); aa++)
+	{
+		// do not process subscripted variables
+		if(aa == arg.begin() && (is_dst || arg.size() > 1))
+		{
+			continue;
+		}
+
+		if(is_volatile_var(aa->value))
+		{
+			continue;
+		}
+
+		auto v = vars.find(aa->value);
+		if(init)
+		{
+			if(v != vars.end())
+			{
+				if(v->second.first)
+				{
+					if(aa->type == B1Types::B1T_STRING && v->second.second.front() != L'\"')
+					{
+						cmd.edit_args()[arg_num][aa - arg.begin()].value = L"\"" + v->second.second + L"\"";
+					}
+					else
+					{
+						cmd.edit_args()[arg_num][aa - arg.begin()].value = v->second.second;
+					}
+					changed = true;
+				}
+			}
+			else
+			{
+				auto type = get_var_type(aa->value);
+				if(type != B1Types::B1T_UNKNOWN && !is_mem_var_name(aa->value))
+				{
+					cmd.edit_args()[arg_num][aa - arg.begin()].value = (type == B1Types::B1T_STRING) ? L"\"\"" : L"0";
+					changed = true;
+				}
+			}
+		}
+		else
+		{
+			if(v != vars.end())
+			{
+				if(v->second.first)
+				{
+					if(aa->type == B1Types::B1T_STRING && v->second.second.front() != L'\"')
+					{
+						cmd.edit_args()[arg_num][aa - arg.begin()].value = L"\"" + v->second.second + L"\"";
+					}
+					else
+					{
+						cmd.edit_args()[arg_num][aa - arg.begin()].value = v->second.second;
+					}
+					changed = true;
+				}
+			}
+		}
+	}
+}
+
+// replaces variables not in vars set with their initial values
+std::wstring B1FileCompiler::set_to_init_value(B1_CMP_CMD &cmd, const std::map<std::wstring, std::pair<bool, std::wstring>> &vars, bool init, bool &changed)
+{
+	if(B1CUtils::is_label(cmd))
+	{
+		return L"";
+	}
+
+	if(B1CUtils::is_inline_asm(cmd))
+	{
+		return L"";
+	}
+
+	if(cmd.cmd == L"GA" || cmd.cmd == L"MA")
+	{
+		for(auto a = cmd.args.begin() + (cmd.cmd == L"GA" ? 2 : 3); a != cmd.args.end(); a++)
+		{
+			set_to_init_value_arg(cmd, a - cmd.args.begin(), false, vars, init, changed);
+		}
+
+		return L"";
+	}
+
+	if(cmd.cmd == L"RETVAL")
+	{
+		set_to_init_value_arg(cmd, 0, false, vars, init, changed);
+		return L"";
+	}
+
+	if(cmd.cmd == L"IN" || cmd.cmd == L"READ")
+	{
+		set_to_init_value_arg(cmd, 1, true, vars, init, changed);
+		if(cmd.args[1].size() == 1)
+		{
+			return cmd.args[1][0].value;
+		}
+		return L"";
+	}
+
+	if(cmd.cmd == L"OUT" || cmd.cmd == L"SET")
+	{
+		set_to_init_value_arg(cmd, 1, false, vars, init, changed);
+		return L"";
+	}
+
+	if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
+	{
+		bool is_dst = (cmd.cmd != L"PUT");
+		set_to_init_value_arg(cmd, 1, is_dst, vars, init, changed);
+		if(cmd.args.size() != 2)
+		{
+			set_to_init_value_arg(cmd, 2, false, vars, init, changed);
+		}
+
+		if(is_dst && cmd.args[1].size() == 1)
+		{
+			return cmd.args[1][0].value;
+		}
+
+		return L"";
+	}
+
+	if(cmd.cmd == L"XARG")
+	{
+		set_to_init_value_arg(cmd, 0, false, vars, init, changed);
+		return L"";
+	}
+
+	if(cmd.cmd == L"IOCTL")
+	{
+		if(cmd.args.size() > 2 && cmd.args[2][0].type != B1Types::B1T_VARREF)
+		{
+			set_to_init_value_arg(cmd, 2, false, vars, init, changed);
+		}
+
+		return L"";
+	}
+
+	if(B1CUtils::is_un_op(cmd))
+	{
+		set_to_init_value_arg(cmd, 0, false, vars, init, changed);
+		set_to_init_value_arg(cmd, 1, true, vars, init, changed);
+		if(cmd.args[1].size() == 1)
+		{
+			return cmd.args[1][0].value;
+		}
+		return L"";
+	}
+
+	if(B1CUtils::is_bin_op(cmd))
+	{
+		set_to_init_value_arg(cmd, 0, false, vars, init, changed);
+		set_to_init_value_arg(cmd, 1, false, vars, init, changed);
+		set_to_init_value_arg(cmd, 2, true, vars, init, changed);
+		if(cmd.args[2].size() == 1)
+		{
+			return cmd.args[2][0].value;
+		}
+		return L"";
+	}
+
+	if(B1CUtils::is_log_op(cmd))
+	{
+		set_to_init_value_arg(cmd, 0, false, vars, init, changed);
+		set_to_init_value_arg(cmd, 1, false, vars, init, changed);
+		return L"";
+	}
+
+	return L"";
+}
+
+// evaluates binary operation with integer operands, returns false if the result is undefined (e.g. division by zero)
+bool B1FileCompiler::eval_num_op(wchar_t op, int32_t n1, int32_t n2, int32_t &res)
+{
+	switch(op)
+	{
+		case L'+':
+			res = (int32_t)((uint32_t)n1 + (uint32_t)n2);
+			return true;
+		case L'-':
+			res = (int32_t)((uint32_t)n1 - (uint32_t)n2);
+			return true;
+		case L'*':
+			res = (int32_t)((uint32_t)n1 * (uint32_t)n2);
+			return true;
+		case L'/':
+		case L'%':
+			if(n2 == 0 || (n1 == INT32_MIN && n2 == -1))
+			{
+				return false;
+			}
+			res = (op == L'/') ? n1 / n2 : n1 % n2;
+			return true;
+		case L'^':
+		{
+			const double p = std::pow(n1, n2);
+			if(!(p >= INT32_MIN && p <= INT32_MAX))
+			{
+				return false;
+			}
+			res = (int32_t)p;
+			return true;
+		}
+		// left shift
+		case L'<':
+			if(n2 < 0 || n2 > 31)
+			{
+				return false;
+			}
+			res = (int32_t)((uint32_t)n1 << n2);
+			return true;
+		// right shift
+		case L'>':
+			if(n2 < 0 || n2 > 31)
+			{
+				return false;
+			}
+			res = n1 >> n2;
+			return true;
+		case L'&':
+			res = n1 & n2;
+			return true;
+		case L'|':
+			res = n1 | n2;
+			return true;
+		case L'~':
+			res = n1 ^ n2;
+			return true;
+	}
+
+	return false;
+}
+
+// checks if value of the variable can be known at compile time (volatile and memory variables can be changed outside of the code)
+bool B1FileCompiler::is_imm_var(const std::wstring &name) const
+{
+	return is_gen_local(name) || (!is_volatile_var(name) && !is_mem_var_name(name));
+}
+
+// gets immediate value of the argument: the value itself or the variable value known at compile time
+bool B1FileCompiler::get_imm_arg(const B1_CMP_FLOW &flow, const B1_CMP_ARG &arg, const std::vector<B1_ATOM> &vals, B1_TYPED_VALUE &val) const
+{
+	if(arg.size() != 1)
+	{
+		return false;
+	}
+
+	if(B1CUtils::is_imm_val(arg[0].value))
+	{
+		val = arg[0];
+		return true;
+	}
+
+	const int v = flow.get_var_index(arg[0].value);
+	if(v < 0 || vals[v].empty())
+	{
+		return false;
+	}
+
+	val = B1_TYPED_VALUE(vals[v], arg[0].type);
+	return true;
+}
+
+// gets compile-time value assigned to scalar variable by assignment, unary or binary operation
+// (var is -1 if the command does not assign value to such a variable, val is empty if the value is unknown)
+void B1FileCompiler::get_assigned_imm(const B1_CMP_FLOW &flow, const B1_CMP_CMD &cmd, const std::vector<B1_ATOM> &vals, int &var, B1_ATOM &val) const
+{
+	var = -1;
+	val.clear();
+
+	if(!B1CUtils::is_un_op(cmd) && !B1CUtils::is_bin_op(cmd))
+	{
+		return;
+	}
+
+	const auto &dst = cmd.args.back();
+	if(dst.size() != 1 || !is_imm_var(dst[0].value))
+	{
+		return;
+	}
+
+	var = flow.get_var_index(dst[0].value);
+	if(var < 0)
+	{
+		return;
+	}
+
+	const auto dst_type = dst[0].type;
+	const bool num_dst = dst_type == B1Types::B1T_BYTE || dst_type == B1Types::B1T_INT || dst_type == B1Types::B1T_WORD || dst_type == B1Types::B1T_LONG;
+
+	auto get_num = [](const B1_TYPED_VALUE &tv, int32_t &n)
+	{
+		if(!B1CUtils::is_num_val(tv.value) || Utils::str2int32(tv.value, n) != B1_RES_OK)
+		{
+			return false;
+		}
+		Utils::correct_int_value(n, tv.type);
+		return true;
+	};
+
+	B1_TYPED_VALUE v1, v2;
+	int32_t n1, n2;
+
+	if(!get_imm_arg(flow, cmd.args[0], vals, v1))
+	{
+		return;
+	}
+
+	if(cmd.cmd == L"=")
+	{
+		if(dst_type == B1Types::B1T_STRING)
+		{
+			if(B1CUtils::is_str_val(v1.value))
+			{
+				val = v1.value;
+			}
+			else
+			if(get_num(v1, n1))
+			{
+				val = L"\"" + std::to_wstring(n1) + L"\"";
+			}
+		}
+		else
+		if(num_dst && get_num(v1, n1))
+		{
+			Utils::correct_int_value(n1, dst_type);
+			val = std::to_wstring(n1);
+		}
+		return;
+	}
+
+	if(!num_dst && dst_type != B1Types::B1T_STRING)
+	{
+		return;
+	}
+
+	if(B1CUtils::is_un_op(cmd))
+	{
+		// -,10,A  or  !,10,A
+		if(!num_dst || !get_num(v1, n1) || (cmd.cmd == L"!" && v1.type == B1Types::B1T_UNKNOWN))
+		{
+			return;
+		}
+
+		n1 = (cmd.cmd == L"-") ? (int32_t)(0 - (uint32_t)n1) : ~n1;
+		Utils::correct_int_value(n1, v1.type);
+		Utils::correct_int_value(n1, dst_type);
+		val = std::to_wstring(n1);
+		return;
+	}
+
+	// numeric binary operation, the same calculation as eval_imm_exps does
+	if(!get_imm_arg(flow, cmd.args[1], vals, v2) || !get_num(v1, n1) || !get_num(v2, n2) || !eval_num_op(cmd.cmd.front(), n1, n2, n1))
+	{
+		return;
+	}
+
+	B1Types com_type = B1Types::B1T_UNKNOWN;
+
+	if(cmd.cmd.front() == L'^')
+	{
+		com_type = v1.type;
+	}
+	else
+	{
+		bool comp_types = false;
+		B1CUtils::get_com_type(v1.type, v2.type, com_type, comp_types);
+	}
+
+	Utils::correct_int_value(n1, com_type);
+
+	if(dst_type == B1Types::B1T_STRING)
+	{
+		val = L"\"" + std::to_wstring(n1) + L"\"";
+	}
+	else
+	{
+		Utils::correct_int_value(n1, dst_type);
+		val = std::to_wstring(n1);
+	}
+}
+
+// turns compile-time values of variables before the command into the values after it,
+// cond is the result of the last comparison (0 - false, 1 - true, -1 - unknown)
+void B1FileCompiler::imm_values_step(const B1_CMP_FLOW &flow, const B1_CMP_CMD &cmd, std::vector<B1_ATOM> &vals, int &cond) const
+{
+	if(B1CUtils::is_label(cmd))
+	{
+		return;
+	}
+
+	if(cmd.cmd != L"JT" && cmd.cmd != L"JF")
+	{
+		cond = -1;
+	}
+
+	if(B1CUtils::is_log_op(cmd))
+	{
+		// compare numeric values the same way remove_redundant_comparisons does
+		B1_TYPED_VALUE v1, v2;
+		int32_t n1, n2;
+
+		if(	get_imm_arg(flow, cmd.args[0], vals, v1) && get_imm_arg(flow, cmd.args[1], vals, v2) &&
+			B1CUtils::is_num_val(v1.value) && B1CUtils::is_num_val(v2.value) &&
+			Utils::str2int32(v1.value, n1) == B1_RES_OK && Utils::str2int32(v2.value, n2) == B1_RES_OK
+			)
 		{
-			return err;
+			cond =	(cmd.cmd == L"==") ? (n1 == n2) :
+					(cmd.cmd == L"<>") ? (n1 != n2) :
+					(cmd.cmd == L">") ? (n1 > n2) :
+					(cmd.cmd == L"<") ? (n1 < n2) :
+					(cmd.cmd == L">=") ? (n1 >= n2) : (n1 <= n2);
 		}
+	}
 
-		if(err == B1C_T_ERROR::B1C_RES_OK)
+	int var = -1;
+	B1_ATOM val;
+
+	if((cmd.cmd == L"GA" || cmd.cmd == L"GF") && is_imm_var(cmd.args[0][0].value) && get_var_dim(cmd.args[0][0].value) == 0 && !is_const_var(cmd.args[0][0].value))
+	{
+		// allocated or freed variable gets its initial value
+		var = flow.get_var_index(cmd.args[0][0].value);
+		val = (get_var_type(cmd.args[0][0].value) == B1Types::B1T_STRING) ? L"\"\"" : L"0";
+	}
+	else
+	{
+		get_assigned_imm(flow, cmd, vals, var, val);
+	}
+
+	B1_CMP_USE_DEF ud;
+	flow.get_use_def(cmd, ud);
+
+	if(ud.ext)
+	{
+		for(int v = 0; v < (int)vals.size(); v++)
 		{
-			if(range[1].second == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
+			if(flow.is_ext_var(v))
 			{
-				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				vals[v].clear();
 			}
+		}
+	}
+	for(const auto d: ud.def)
+	{
+		vals[d].clear();
+	}
+	for(const auto m: ud.mod)
+	{
+		vals[m].clear();
+	}
 
-			if(is_input)
+	if(var >= 0)
+	{
+		vals[var] = val;
+	}
+}
+
+// conditional constant propagation: calculates compile-time values of variables at the beginning of every block.
+// only blocks reachable from the code entries are processed and branches that are never taken (comparison result
+// is known) are not followed, so assignments in the code that is never executed do not hide values known before
+void B1FileCompiler::calc_imm_values(const B1_CMP_FLOW &flow, bool init, std::vector<std::vector<B1_ATOM>> &vals, std::vector<bool> &reached)
+{
+	const auto &blocks = flow.get_blocks();
+	const int blocks_num = (int)blocks.size();
+	const int vars_num = flow.get_vars_num();
+
+	vals.assign(blocks_num, std::vector<B1_ATOM>());
+	reached.assign(blocks_num, false);
+
+	// values at the end of every block and blocks executed after it
+	std::vector<std::vector<B1_ATOM>> out_vals(blocks_num);
+	std::vector<std::vector<int>> exec_succs(blocks_num);
+
+	// initial values of variables at the code beginning
+	std::vector<B1_ATOM> init_vals(vars_num);
+
+	if(init)
+	{
+		for(int v = 0; v < vars_num; v++)
+		{
+			const auto &vname = flow.get_var_name(v);
+
+			if(is_gen_local(vname) || !is_imm_var(vname))
 			{
-				if(is_const_var(range[0].first[0].value))
+				continue;
+			}
+
+			auto type = get_var_type(vname);
+			if(type != B1Types::B1T_UNKNOWN)
+			{
+				init_vals[v] = (type == B1Types::B1T_STRING) ? L"\"\"" : L"0";
+			}
+		}
+	}
+
+	std::deque<int> queue;
+	std::vector<bool> queued(blocks_num, false);
+
+	for(int b = 0; b < blocks_num; b++)
+	{
+		if(blocks[b].entry)
+		{
+			queue.push_back(b);
+			queued[b] = true;
+		}
+	}
+
+	std::vector<B1_ATOM> cur;
+	std::vector<int> succs;
+
+	while(!queue.empty())
+	{
+		const int b = queue.front();
+		queue.pop_front();
+		queued[b] = false;
+
+		const auto &blk = blocks[b];
+		bool no_input = true;
+
+		// a variable has known value at the block beginning if it is the same on all executed edges
+		if(blk.entry)
+		{
+			if(b == 0 && init)
+			{
+				cur = init_vals;
+			}
+			else
+			{
+				cur.assign(vars_num, B1_ATOM());
+			}
+			no_input = false;
+		}
+
+		for(const auto p: blk.preds)
+		{
+			if(!reached[p] || std::find(exec_succs[p].cbegin(), exec_succs[p].cend(), b) == exec_succs[p].cend())
+			{
+				continue;
+			}
+
+			if(no_input)
+			{
+				cur = out_vals[p];
+				no_input = false;
+				continue;
+			}
+
+			for(int v = 0; v < vars_num; v++)
+			{
+				if(cur[v] != out_vals[p][v])
 				{
-					return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
+					cur[v].clear();
 				}
 			}
+		}
 
-			std::wstring count_local = emit_local(B1Types::B1T_UNKNOWN);
-			emit_command(L"-", { range[1].first, B1_CMP_ARG(range[0].first[1].value, range[0].first[1].type), B1_CMP_ARG(count_local) });
-			emit_command(L"+", { count_local, L"1", count_local });
-			emit_command(cmd_name, std::vector<B1_CMP_ARG>({ dev_name, range[0].first, count_local }));
-			cmds.push_back(std::prev(end()));
-			emit_command(L"LF", count_local);
+		if(no_input)
+		{
+			continue;
+		}
 
-			if(range[1].second == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL)
+		vals[b] = cur;
+
+		int cond = -1;
+		for(auto i = blk.first; i != blk.last; i++)
+		{
+			imm_values_step(flow, *i, cur, cond);
+		}
+
+		const auto &last = *std::prev(blk.last);
+
+		if(cond >= 0 && !B1CUtils::is_label(last) && (last.cmd == L"JT" || last.cmd == L"JF"))
+		{
+			// only one branch can be taken
+			succs.clear();
+
+			if((last.cmd == L"JT") == (cond == 1))
 			{
-				emit_command(L"LF", range[1].first[0].value);
+				if(blk.jump >= 0)
+				{
+					succs.push_back(blk.jump);
+				}
+			}
+			else
+			if(b + 1 < blocks_num)
+			{
+				succs.push_back(b + 1);
+			}
+		}
+		else
+		{
+			succs = blk.succs;
+		}
+
+		if(!reached[b] || cur != out_vals[b] || succs != exec_succs[b])
+		{
+			reached[b] = true;
+			out_vals[b].swap(cur);
+			exec_succs[b] = succs;
+
+			for(const auto s: succs)
+			{
+				if(!queued[s])
+				{
+					queue.push_back(s);
+					queued[s] = true;
+				}
+			}
+		}
+	}
+}
+
+// replaces variables having values known at compile time with the values, removes excessive GA, GF and =,0,<var>
+B1C_T_ERROR B1FileCompiler::reuse_imm_values(bool init, bool &changed)
+{
+	changed = false;
+
+	auto flow = get_flow();
+
+	std::vector<std::vector<B1_ATOM>> block_vals;
+	std::vector<bool> reached;
+	calc_imm_values(flow, init, block_vals, reached);
+
+	const auto &blocks = flow.get_blocks();
+	B1_CMP_USE_DEF ud;
+	std::map<std::wstring, std::pair<bool, std::wstring>> imm_vars;
+	int var;
+	B1_ATOM val;
+
+	for(int b = 0; b < (int)blocks.size(); b++)
+	{
+		// the code that is never executed is left for remove_jumps
+		if(!reached[b])
+		{
+			continue;
+		}
+
+		auto &vals = block_vals[b];
+		int cond = -1;
+
+		for(auto i = blocks[b].first; i != blocks[b].last; )
+		{
+			auto &cmd = *i;
+
+			if(B1CUtils::is_label(cmd))
+			{
+				i++;
+				continue;
+			}
+
+			if((cmd.cmd == L"GA" || cmd.cmd == L"GF") && !is_volatile_var(cmd.args[0][0].value) && !is_mem_var_name(cmd.args[0][0].value) && get_var_dim(cmd.args[0][0].value) == 0)
+			{
+				if(is_const_var(cmd.args[0][0].value))
+				{
+					if(cmd.cmd == L"GF")
+					{
+						return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
+					}
+				}
+				else
+				{
+					var = flow.get_var_index(cmd.args[0][0].value);
+
+					if(var >= 0 && vals[var] == (get_var_type(cmd.args[0][0].value) == B1Types::B1T_STRING ? L"\"\"" : L"0"))
+					{
+						// the variable already has its initial value
+						erase(i++);
+						changed = true;
+						continue;
+					}
+				}
+			}
+			else
+			{
+				flow.get_use_def(cmd, ud);
+
+				imm_vars.clear();
+				for(const auto v: ud.use)
+				{
+					if(!vals[v].empty())
+					{
+						imm_vars[flow.get_var_name(v)] = std::make_pair(true, vals[v].str());
+					}
+				}
+
+				if(!imm_vars.empty())
+				{
+					set_to_init_value(cmd, imm_vars, false, changed);
+				}
+
+				get_assigned_imm(flow, cmd, vals, var, val);
+
+				if(var >= 0 && !val.empty() && vals[var] == val && !is_volatile_used(cmd))
+				{
+					// the variable already has the value
+					erase(i++);
+					changed = true;
+					continue;
+				}
+			}
+
+			imm_values_step(flow, cmd, vals, cond);
+			i++;
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+// reuses values of expressions calculated before (global common subexpression elimination):
+// +,A,B,C
+// ...       ->  if neither A, B nor C is changed on any path between the commands
+// +,A,B,D       the second one is replaced with =,C,D
+B1C_T_ERROR B1FileCompiler::reuse_exps(bool &changed)
+{
+	changed = false;
+
+	auto flow = get_flow();
+	const auto &blocks = flow.get_blocks();
+	const int blocks_num = (int)blocks.size();
+	const int vars_num = flow.get_vars_num();
+
+	// gets expression calculated by the command: operation and operands (commutative operations have
+	// their operands sorted) and variable storing the result
+	auto get_exp = [this, &flow](const B1_CMP_CMD &cmd, std::wstring &key, std::vector<int> &vars) -> bool
+	{
+		if(!B1CUtils::is_bin_op(cmd) && (!B1CUtils::is_un_op(cmd) || cmd.cmd == L"="))
+		{
+			return false;
+		}
+
+		const auto &dst = cmd.args.back();
+		if(dst.size() != 1 || dst[0].type == B1Types::B1T_STRING || !is_imm_var(dst[0].value) || is_fn_used(cmd) || is_udef_used(cmd))
+		{
+			return false;
+		}
+
+		const int dst_var = flow.get_var_index(dst[0].value);
+		if(dst_var < 0)
+		{
+			return false;
+		}
+
+		std::vector<std::wstring> ops;
+
+		vars.clear();
+
+		for(auto a = cmd.args.cbegin(); a != cmd.args.cend() - 1; a++)
+		{
+			const auto &tv = (*a)[0];
+
+			if(a->size() != 1 || tv.type == B1Types::B1T_STRING || B1CUtils::is_str_val(tv.value))
+			{
+				return false;
+			}
+
+			if(!B1CUtils::is_num_val(tv.value))
+			{
+				const int v = flow.get_var_index(tv.value);
+				if(v < 0 || v == dst_var || !is_imm_var(tv.value))
+				{
+					return false;
+				}
+				vars.push_back(v);
+			}
+
+			ops.push_back(tv.value.str() + L"<" + std::to_wstring((int)tv.type) + L">");
+		}
+
+		if(ops.size() == 2 && ops[1] < ops[0] && (cmd.cmd == L"+" || cmd.cmd == L"*" || cmd.cmd == L"&" || cmd.cmd == L"|" || cmd.cmd == L"~"))
+		{
+			std::swap(ops[0], ops[1]);
+		}
+
+		key = cmd.cmd;
+		for(const auto &op: ops)
+		{
+			key += L"," + op;
+		}
+		key += L"," + std::to_wstring((int)dst[0].type);
+
+		vars.push_back(dst_var);
+
+		return true;
+	};
+
+	// expressions calculated by commands: result variables (the last ones of the variable lists) and commands
+	std::vector<std::vector<int>> exp_vars;
+	std::unordered_map<const B1_CMP_CMD *, int> cmd_exps;
+	std::map<std::wstring, std::vector<int>> key_exps;
+	std::wstring key;
+	std::vector<int> vars;
+
+	for(const auto &blk: blocks)
+	{
+		for(auto i = blk.first; i != blk.last; i++)
+		{
+			if(!B1CUtils::is_label(*i) && get_exp(*i, key, vars))
+			{
+				cmd_exps[&*i] = (int)exp_vars.size();
+				key_exps[key].push_back((int)exp_vars.size());
+				exp_vars.push_back(vars);
 			}
+		}
+	}
+
+	const int exps_num = (int)exp_vars.size();
+
+	// nothing to reuse if every expression is calculated once
+	if(exps_num == (int)key_exps.size())
+	{
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
+
+	// expressions whose values are lost when a variable is changed
+	std::vector<B1_CMP_BITSET> var_kill(vars_num, B1_CMP_BITSET(exps_num));
+	B1_CMP_BITSET ext_kill(exps_num), all_exps(exps_num);
+
+	for(int e = 0; e < exps_num; e++)
+	{
+		all_exps.set(e);
+
+		for(const auto v: exp_vars[e])
+		{
+			var_kill[v].set(e);
+			if(flow.is_ext_var(v))
+			{
+				ext_kill.set(e);
+			}
+		}
+	}
+
+	B1_CMP_USE_DEF ud;
+
+	auto avail_step = [&flow, &ud, &var_kill, &ext_kill, &cmd_exps](const B1_CMP_CMD &cmd, B1_CMP_BITSET &avail)
+	{
+		if(B1CUtils::is_label(cmd))
+		{
+			return;
+		}
+
+		flow.get_use_def(cmd, ud);
+
+		if(ud.ext)
+		{
+			avail.subtract(ext_kill);
+		}
+		for(const auto d: ud.def)
+		{
+			avail.subtract(var_kill[d]);
+		}
+		for(const auto m: ud.mod)
+		{
+			avail.subtract(var_kill[m]);
+		}
+
+		auto e = cmd_exps.find(&cmd);
+		if(e != cmd_exps.end())
+		{
+			avail.set(e->second);
+		}
+	};
 
-			if(is_gen_local(range[0].first[1].value))
-			{
-				emit_command(L"LF", range[0].first[1].value);
-			}
+	// available expressions: calculated on every path to the block beginning and not changed after that
+	std::vector<bool> reachable(blocks_num, false);
+	std::vector<int> stack;
+
+	for(int b = 0; b < blocks_num; b++)
+	{
+		if(blocks[b].entry)
+		{
+			reachable[b] = true;
+			stack.push_back(b);
 		}
-		else
+	}
+	while(!stack.empty())
+	{
+		const int b = stack.back();
+		stack.pop_back();
+
+		for(const auto s: blocks[b].succs)
 		{
-			// build RPN
-			auto err1 = b1_rpn_build(b1_curr_prog_line_offset, PUT_GET_STOP_TOKENS, &b1_curr_prog_line_offset);
-			if(err1 != B1_RES_OK)
+			if(!reachable[s])
 			{
-				return static_cast<B1C_T_ERROR>(err1);
+				reachable[s] = true;
+				stack.push_back(s);
 			}
+		}
+	}
 
-			// no RPN: empty expression was specified to b1_rpn_build function
-			if(b1_rpn[0].flags == 0)
+	std::vector<B1_CMP_BITSET> avail_in(blocks_num, all_exps), avail_out(blocks_num, all_exps);
+	B1_CMP_BITSET avail(exps_num);
+	bool stop = false;
+
+	while(!stop)
+	{
+		stop = true;
+
+		for(int b = 0; b < blocks_num; b++)
+		{
+			if(!reachable[b])
 			{
-				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				continue;
 			}
 
-			// compile the expression
-			range.push_back(std::make_pair(B1_CMP_ARG(), B1_CMP_EXP_TYPE::B1_CMP_ET_UNKNOWN));
-			err1 = process_expression(end(), range[0].second, range[0].first, is_input);
-			if(err1 != B1_RES_OK)
+			const auto &blk = blocks[b];
+
+			if(blk.entry)
 			{
-				return static_cast<B1C_T_ERROR>(err1);
+				avail.clear();
 			}
-
-			if(range[0].first[0].value.empty())
+			else
 			{
-				return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
+				avail = all_exps;
 			}
 
-			if(is_input)
+			for(const auto p: blk.preds)
 			{
-				if(range[0].second != B1_CMP_EXP_TYPE::B1_CMP_ET_VAR)
-				{
-					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-				}
-
-				if(is_const_var(range[0].first[0].value))
+				if(reachable[p])
 				{
-					return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
+					avail.intersect(avail_out[p]);
 				}
+			}
 
-				emit_command(cmd_name, std::vector<B1_CMP_ARG>({ dev_name, range[0].first }));
-				cmds.push_back(std::prev(end()));
+			avail_in[b] = avail;
 
-				if(range[0].first.size() > 1)
-				{
-					for(auto l = range[0].first.crbegin(); l != range[0].first.crend() - 1; l++)
-					{
-						if(is_gen_local(l->value))
-						{
-							emit_command(L"LF", l->value);
-						}
-					}
-				}
-			}
-			else
+			for(auto i = blk.first; i != blk.last; i++)
 			{
-				if(range[0].second == B1_CMP_EXP_TYPE::B1_CMP_ET_LOGICAL)
-				{
-					return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
-				}
-
-				emit_command(cmd_name, std::vector<std::wstring>({ dev_name, range[0].first[0].value }));
-				cmds.push_back(std::prev(end()));
+				avail_step(*i, avail);
+			}
 
-				if(range[0].second == B1_CMP_EXP_TYPE::B1_CMP_ET_LOCAL)
-				{
-					emit_command(L"LF", range[0].first[0].value);
-				}
+			if(avail != avail_out[b])
+			{
+				avail_out[b] = avail;
+				stop = false;
 			}
 		}
+	}
 
-		if(b1_curr_prog_line_offset != 0)
+	for(int b = 0; b < blocks_num; b++)
+	{
+		if(!reachable[b])
 		{
-			if(B1_T_ISCOMMA(b1_progline[b1_curr_prog_line_offset]))
-			{
-				b1_curr_prog_line_offset++;
-			}
-			else
+			continue;
+		}
+
+		avail = avail_in[b];
+
+		for(auto i = blocks[b].first; i != blocks[b].last; )
+		{
+			auto &cmd = *i;
+
+			auto e = cmd_exps.find(&cmd);
+			if(e != cmd_exps.end() && get_exp(cmd, key, vars))
 			{
-				// check for USING keyword presence
-				B1_CMP_ARGS args;
-				err = st_read_using_clause(args, std::next(start));
-				if(err != B1C_T_ERROR::B1C_RES_OK)
+				// the same expression calculated before
+				int e1 = -1;
+
+				for(const auto ke: key_exps[key])
 				{
-					return err;
+					if(avail.test(ke))
+					{
+						e1 = ke;
+						break;
+					}
 				}
 
-				for(auto &cmd: cmds)
+				if(e1 >= 0)
 				{
-					B1_CMP_ARGS a;
+					const int dst_var = exp_vars[e->second].back();
+					const int src_var = exp_vars[e1].back();
 
-					if(!args[0][0].value.empty())
-					{
-						a.push_back(B1_CMP_ARG(L"XORIN", B1Types::B1T_BYTE));
-						a[0].push_back(args[0][0]);
-						emit_command(L"XARG", cmd, a);
-					}
-					
-					a.clear();
-					if(!args[1][0].value.empty())
+					if(src_var == dst_var)
 					{
-						a.push_back(B1_CMP_ARG(L"XOROUT", B1Types::B1T_BYTE));
-						a[0].push_back(args[1][0]);
-						emit_command(L"XARG", cmd, a);
+						// the variable already has the value
+						erase(i++);
+						changed = true;
+						continue;
 					}
-				}
 
-				break;
+					cmd.set_cmd(L"=");
+					cmd.edit_args().erase(cmd.args.begin(), cmd.args.end() - 1);
+					cmd.edit_args().insert(cmd.args.begin(), B1_CMP_ARG(flow.get_var_name(src_var), cmd.args[0][0].type));
+					changed = true;
+				}
 			}
+
+			avail_step(cmd, avail);
+			i++;
 		}
 	}
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1_T_ERROR B1FileCompiler::st_label(bool first_run)
+// gets range of values of the numeric type (returns false for other types)
+bool B1FileCompiler::get_type_range(B1Types type, B1_CMP_RANGE &range)
 {
-	B1_T_ERROR err;
-	B1_TOKENDATA td;
-
-	// read label name
-	err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
-	if(err != B1_RES_OK)
+	switch(type)
 	{
-		return err;
+		case B1Types::B1T_BYTE:
+			range = B1_CMP_RANGE(0, 255);
+			return true;
+		case B1Types::B1T_INT:
+			range = B1_CMP_RANGE(INT16_MIN, INT16_MAX);
+			return true;
+		case B1Types::B1T_WORD:
+			range = B1_CMP_RANGE(0, UINT16_MAX);
+			return true;
+		case B1Types::B1T_LONG:
+			range = B1_CMP_RANGE(INT32_MIN, INT32_MAX);
+			return true;
+		default:
+			break;
 	}
 
-	if(td.length == 0)
-	{
-		return B1_RES_ESYNTAX;
-	}
+	return false;
+}
 
-	if(!(td.type & B1_TOKEN_TYPE_IDNAME))
-	{
-		return B1_RES_EINVTOK;
-	}
+// checks if all the values of the range can be stored in a variable of the type
+bool B1FileCompiler::is_range_in_type(const B1_CMP_RANGE &range, B1Types type)
+{
+	B1_CMP_RANGE type_range;
+	return get_type_range(type, type_range) && range.first >= type_range.first && range.second <= type_range.second;
+}
 
-	auto label_name = Utils::str_toupper(B1CUtils::get_progline_substring(td.offset, td.offset + td.length));
-	
-	if(first_run)
-	{
-		if(_labels.find(label_name) != _labels.cend())
-		{
-			return B1_RES_EIDINUSE;
-		}
+// gets type of operation: the type the operands are converted to before calculation (returns false
+// if the operation is not numeric), t0 and t1 are types of the operands
+bool B1FileCompiler::get_op_com_type(const B1_CMP_CMD &cmd, B1Types t0, B1Types t1, B1Types &com_type)
+{
+	bool comp_types = false;
 
-		_labels.insert(label_name);
+	if(cmd.cmd == L"=")
+	{
+		com_type = t0;
 	}
 	else
+	if(B1CUtils::is_un_op(cmd))
 	{
-		emit_label(L"__ULB_" + label_name);
+		// unary operations are calculated in the destination type
+		com_type = cmd.args[1][0].type;
 	}
-
-	b1_curr_prog_line_offset = td.offset + td.length;
-	err = b1_tok_get(b1_curr_prog_line_offset, 0, &td);
-	if(err != B1_RES_OK)
+	else
+	if(cmd.cmd == L"^")
 	{
-		return err;
+		com_type = t0;
 	}
-
-	if(td.length != 0)
+	else
+	if(B1CUtils::get_com_type(t0, t1, com_type, comp_types) != B1_RES_OK)
 	{
-		return B1_RES_ESYNTAX;
+		return false;
 	}
 
-	return B1_RES_OK;
+	B1_CMP_RANGE range;
+	return get_type_range(com_type, range);
 }
 
-B1_CMP_CMDS::const_iterator B1FileCompiler::find_LF(B1_CMP_CMDS::const_iterator lacmd, B1_CMP_CMDS::const_iterator intlfcmd, bool& intlf_found)
+// calculates range of the operation result (not limited with the operation type), returns false if the range is unknown
+bool B1FileCompiler::get_op_range(const std::wstring &op, bool un_op, const B1_CMP_RANGE &r1, const B1_CMP_RANGE &r2, B1_CMP_RANGE &res)
 {
-	const auto &la = *lacmd;
-
-	intlf_found = false;
-
-	for(lacmd++; lacmd != cend(); lacmd++)
+	if(op == L"=")
 	{
-		const auto &lf = *lacmd;
+		res = r1;
+		return true;
+	}
 
-		if(B1CUtils::is_label(lf))
+	if(un_op)
+	{
+		if(op == L"-")
 		{
-			continue;
+			res = B1_CMP_RANGE(-r1.second, -r1.first);
+			return true;
 		}
-
-		if(lf.cmd == L"LF")
+		if(op == L"!")
 		{
-			if(lacmd == intlfcmd)
-			{
-				intlf_found = true;
-				continue;
-			}
-
-			if(la.args[0][0].value == lf.args[0][0].value)
-			{
-				return lacmd;
-			}
+			res = B1_CMP_RANGE(-r1.second - 1, -r1.first - 1);
+			return true;
 		}
+		return false;
 	}
 
-	return cend();
-}
+	if(op == L"+")
+	{
+		res = B1_CMP_RANGE(r1.first + r2.first, r1.second + r2.second);
+		return true;
+	}
 
-void B1FileCompiler::fix_LA_LF_order()
-{
-	std::stack<iterator> lastmt;
-	iterator tmp, lf;
+	if(op == L"-")
+	{
+		res = B1_CMP_RANGE(r1.first - r2.second, r1.second - r2.first);
+		return true;
+	}
 
-	for(auto i = begin(); i != end(); i++)
+	if(op == L"*" || op == L"/")
 	{
-		if(i->cmd == L"LA")
+		if(op == L"/" && r2.first <= 0 && r2.second >= 0)
 		{
-			lastmt.push(i);
-			continue;
+			return false;
 		}
 
-		if(i->cmd == L"LF")
+		// the results for range bounds include the minimal and the maximal values (divisor sign is the same for all its values)
+		const int64_t v[4] =
 		{
-			if(i->args[0][0].value == lastmt.top()->args[0][0].value)
-			{
-				lastmt.pop();
-			}
-			else
-			{
-				get_LA_LF(lastmt.top(), end(), tmp, lf);
-				insert(std::next(lf), *i);
-				tmp = std::prev(i);
-				erase(i);
-				i = tmp;
-			}
-		}
+			(op == L"*") ? r1.first * r2.first : r1.first / r2.first,
+			(op == L"*") ? r1.first * r2.second : r1.first / r2.second,
+			(op == L"*") ? r1.second * r2.first : r1.second / r2.first,
+			(op == L"*") ? r1.second * r2.second : r1.second / r2.second,
+		};
+		res = B1_CMP_RANGE(*std::min_element(v, v + 4), *std::max_element(v, v + 4));
+		return true;
 	}
-}
 
-B1C_T_ERROR B1FileCompiler::remove_unused_labels(bool &changed)
-{
-	std::set<std::wstring> used_labels;
-	// index and name of every label
-	std::vector<std::pair<const_iterator, std::wstring>> labels;
+	if(op == L"%")
+	{
+		if(r2.first <= 0 && r2.second >= 0)
+		{
+			return false;
+		}
 
-	changed = false;
+		// the remainder has sign of the dividend and its absolute value is less than the divisor's one
+		const int64_t m = std::max(std::abs(r2.first), std::abs(r2.second)) - 1;
+		res = B1_CMP_RANGE((r1.first >= 0) ? 0 : std::max(r1.first, -m), (r1.second <= 0) ? 0 : std::min(r1.second, m));
+		return true;
+	}
 
-	// find and remove unused labels
-	for(auto cmdi = cbegin(); cmdi != cend(); cmdi++)
+	if(op == L"&")
+	{
+		// AND with non-negative value cannot exceed it
+		if(r1.first >= 0 && r2.first >= 0)
+		{
+			res = B1_CMP_RANGE(0, std::min(r1.second, r2.second));
+			return true;
+		}
+		if(r1.first >= 0 || r2.first >= 0)
+		{
+			res = B1_CMP_RANGE(0, (r1.first >= 0) ? r1.second : r2.second);
+			return true;
+		}
+		return false;
+	}
+
+	if(op == L"|" || op == L"~")
 	{
-		// do not remove function definitions
-		if(B1CUtils::is_label(*cmdi) && !B1CUtils::is_def_fn(*cmdi))
+		// OR and XOR of non-negative values cannot have more significant bits than the operands
+		if(r1.first >= 0 && r2.first >= 0)
 		{
-			labels.push_back(std::pair<const_iterator, std::wstring>(cmdi, cmdi->cmd));
+			int64_t m = 1;
+			while(m <= r1.second || m <= r2.second)
+			{
+				m <<= 1;
+			}
+			res = B1_CMP_RANGE(0, m - 1);
+			return true;
 		}
-		else
-		if(cmdi->cmd == L"JMP" || cmdi->cmd == L"JF" || cmdi->cmd == L"JT" || cmdi->cmd == L"CALL" || cmdi->cmd == L"ERR" || (cmdi->cmd == L"RST" && cmdi->args.size() > 1))
+		return false;
+	}
+
+	if(op == L"<<")
+	{
+		if(r1.first >= 0 && r2.first >= 0 && r2.second <= 31)
 		{
-			used_labels.insert(cmdi->args[(cmdi->cmd == L"RST" || cmdi->cmd == L"ERR") ? 1 : 0][0].value);
+			res = B1_CMP_RANGE(r1.first << r2.first, r1.second << r2.second);
+			return true;
 		}
+		return false;
 	}
 
-	used_labels.insert(_req_labels.cbegin(), _req_labels.cend());
-
-	for(auto l = labels.crbegin(); l != labels.crend(); l++)
+	if(op == L">>")
 	{
-		if(used_labels.find(l->second) == used_labels.end())
+		if(r2.first >= 0 && r2.second <= 31)
 		{
-			erase(l->first);
-			changed = true;
+			res = B1_CMP_RANGE(std::min(r1.first >> r2.first, r1.first >> r2.second), std::max(r1.second >> r2.first, r1.second >> r2.second));
+			return true;
 		}
+		return false;
 	}
 
-	return B1C_T_ERROR::B1C_RES_OK;
+	return false;
 }
 
-B1C_T_ERROR B1FileCompiler::remove_duplicate_labels(bool &changed)
+// checks if range of values of the variable can be calculated (scalar numeric variable not changed outside of the code)
+bool B1FileCompiler::is_range_var(const std::wstring &name) const
 {
-	// find and remove duplicates
-	std::vector<std::vector<std::pair<const_iterator, bool>>> label_ranges;
+	B1_CMP_RANGE range;
+	return is_imm_var(name) && get_var_dim(name) == 0 && !is_const_var(name) && get_type_range(get_var_type(name), range);
+}
 
-	changed = false;
+// gets index of the variable converted with a numeric type conversion function if the conversion does not change
+// its value (such conversions are made by narrow_cmps), returns -1 otherwise
+int B1FileCompiler::get_cvt_var_index(const B1_CMP_FLOW &flow, const B1_CMP_ARG &arg, const std::vector<B1_CMP_RANGE> &ranges) const
+{
+	if(	ranges.empty() || arg.size() != 2 ||
+		!(arg[0].value == L"CBYTE" || arg[0].value == L"CINT" || arg[0].value == L"CWRD" || arg[0].value == L"CLNG") ||
+		!is_range_var(arg[1].value))
+	{
+		return -1;
+	}
 
-	decltype(label_ranges)::value_type range;
+	const int v = flow.get_var_index(arg[1].value);
+	return (v >= 0 && is_range_in_type(ranges[v], arg[0].type)) ? v : -1;
+}
 
-	for(auto cmdi = cbegin(); cmdi != cend(); cmdi++)
+// gets range of the argument value: immediate value, variable value range or the whole range of the argument type
+bool B1FileCompiler::get_arg_range(const B1_CMP_FLOW &flow, const B1_CMP_ARG &arg, const std::vector<B1_CMP_RANGE> &ranges, B1_CMP_RANGE &range) const
+{
+	if(!get_type_range(arg[0].type, range))
 	{
-		// do not take into account functions and subroutines
-		if(B1CUtils::is_label(*cmdi))
-		{
-			range.push_back(std::make_pair(cmdi, (_req_labels.find(cmdi->cmd) != _req_labels.cend() || B1CUtils::is_def_fn(*cmdi) || _sub_labels.find(cmdi->cmd) != _sub_labels.cend())));
-		}
-		else
-		{
-			if(!range.empty())
-			{
-				label_ranges.push_back(range);
-				range.clear();
-			}
-		}
+		return false;
 	}
-	if(!range.empty())
+
+	if(arg.size() != 1)
 	{
-		label_ranges.push_back(range);
-		range.clear();
+		const int v = get_cvt_var_index(flow, arg, ranges);
+		if(v >= 0)
+		{
+			range = ranges[v];
+		}
+		return true;
 	}
 
-	if(!label_ranges.empty())
+	if(B1CUtils::is_num_val(arg[0].value))
 	{
-		std::map<std::wstring, std::wstring> toreplace;
+		int32_t n;
 
-		// build list of labels to replace
-		for(const auto &lr: label_ranges)
+		if(Utils::str2int32(arg[0].value, n) == B1_RES_OK)
 		{
-			// find label to keep
-			bool keep_all = true;
-			auto lk = lr.cend();
-
-			for(auto l = lr.cbegin(); l != lr.cend(); l++)
-			{
-				if(l->second && lk == lr.cend())
-				{
-					lk = l;
-				}
-				if(!l->second)
-				{
-					keep_all = false;
-				}
-			}
-			if(lk == lr.cend())
-			{
-				lk = std::prev(lr.cend());
-			}
-
-			if(!keep_all)
-			{
-				for(auto l = lr.cbegin(); l != lr.cend(); l++)
-				{
-					if(l == lk || l->second)
-					{
-						continue;
-					}
-					toreplace[l->first->cmd] = lk->first->cmd;
-				}
-			}
+			Utils::correct_int_value(n, arg[0].type);
+			range = B1_CMP_RANGE(n, n);
 		}
+		return true;
+	}
 
-		// replace labels marked for deletion
-		for(auto &cmd: *this)
+	if(!ranges.empty() && is_range_var(arg[0].value))
+	{
+		const int v = flow.get_var_index(arg[0].value);
+		if(v >= 0)
 		{
-			if(B1CUtils::is_label(cmd))
-			{
-				continue;
-			}
-
-			if(cmd.cmd == L"JMP" || cmd.cmd == L"JF" || cmd.cmd == L"JT" || cmd.cmd == L"CALL" || cmd.cmd == L"ERR" || (cmd.cmd == L"RST" && cmd.args.size() > 1))
-			{
-				int i = (cmd.cmd == L"RST" || cmd.cmd == L"ERR") ? 1 : 0;
-				auto rep = toreplace.find(cmd.args[i][0].value);
-				if(rep != toreplace.end())
-				{
-					cmd.args[i][0].value = rep->second;
-				}
-			}
+			range = ranges[v];
 		}
 	}
 
-	return B1C_T_ERROR::B1C_RES_OK;
+	return true;
 }
 
-bool B1FileCompiler::is_udef_used(const B1_TYPED_VALUE &val)
+// gets ranges of values of all the variables not limited with the code (ranges of their types)
+void B1FileCompiler::get_var_type_ranges(const B1_CMP_FLOW &flow, std::vector<B1_CMP_RANGE> &ranges) const
 {
-	auto fn = get_fn(val);
-	if(fn != nullptr && !fn->isstdfn)
+	ranges.resize(flow.get_vars_num());
+
+	for(int v = 0; v < flow.get_vars_num(); v++)
 	{
-		return true;
+		if(!get_type_range(get_var_type(flow.get_var_name(v)), ranges[v]))
+		{
+			ranges[v] = B1_CMP_RANGE(INT32_MIN, INT32_MAX);
+		}
 	}
-
-	return false;
 }
 
-bool B1FileCompiler::is_udef_used(const B1_CMP_ARG &arg)
+// turns ranges of variable values before the command into the ranges after it (type_ranges - ranges of the variable types)
+void B1FileCompiler::value_ranges_step(const B1_CMP_FLOW &flow, const B1_CMP_CMD &cmd, const std::vector<B1_CMP_RANGE> &type_ranges, std::vector<B1_CMP_RANGE> &ranges) const
 {
-	auto fn = get_fn(arg);
-	if(fn != nullptr && !fn->isstdfn)
+	if(B1CUtils::is_label(cmd))
 	{
-		return true;
+		return;
 	}
 
-	for(const auto &aa: arg)
+	int var = -1;
+	B1_CMP_RANGE range;
+
+	if((cmd.cmd == L"GA" || cmd.cmd == L"GF") && is_range_var(cmd.args[0][0].value))
 	{
-		if(is_udef_used(aa))
-		{
-			return true;
-		}
+		// allocated or freed variable gets its initial value
+		var = flow.get_var_index(cmd.args[0][0].value);
+		range = B1_CMP_RANGE(0, 0);
 	}
+	else
+	if((B1CUtils::is_un_op(cmd) || B1CUtils::is_bin_op(cmd)) && cmd.args.back().size() == 1 && is_range_var(cmd.args.back()[0].value))
+	{
+		const auto &dst = cmd.args.back()[0];
+		B1Types com_type;
+		B1_CMP_RANGE r1, r2;
 
-	return false;
-}
+		var = flow.get_var_index(dst.value);
 
-bool B1FileCompiler::is_udef_used(const B1_CMP_CMD &cmd)
-{
-	if(B1CUtils::is_label(cmd))
-	{
-		return false;
+		// the operation result is converted to the operation type and then to the destination type,
+		// the power operator is calculated by the library function in the type different from the operation one
+		if(	cmd.cmd == L"^" || !get_op_com_type(cmd, cmd.args[0][0].type, cmd.args[1][0].type, com_type) ||
+			!get_arg_range(flow, cmd.args[0], ranges, r1) || (B1CUtils::is_bin_op(cmd) && !get_arg_range(flow, cmd.args[1], ranges, r2)) ||
+			!get_op_range(cmd.cmd, B1CUtils::is_un_op(cmd) && cmd.cmd != L"=", r1, r2, range) || !is_range_in_type(range, com_type) ||
+			!is_range_in_type(range, dst.type))
+		{
+			get_type_range(dst.type, range);
+		}
 	}
 
-	if(cmd.cmd == L"GA")
+	B1_CMP_USE_DEF ud;
+	flow.get_use_def(cmd, ud);
+
+	if(ud.ext)
 	{
-		for(auto a = cmd.args.begin() + 2; a != cmd.args.end(); a++)
+		for(int v = 0; v < (int)ranges.size(); v++)
 		{
-			if(is_udef_used(*a))
+			if(flow.is_ext_var(v))
 			{
-				return true;
+				ranges[v] = type_ranges[v];
 			}
 		}
+	}
+	for(const auto d: ud.def)
+	{
+		ranges[d] = type_ranges[d];
+	}
+	for(const auto m: ud.mod)
+	{
+		ranges[m] = type_ranges[m];
+	}
 
-		return false;
+	if(var >= 0)
+	{
+		ranges[var] = range;
 	}
+}
 
-	if(cmd.cmd == L"RETVAL")
+// limits ranges of the compared variables with the comparison result (cond), returns false if the result
+// is not possible with the current ranges
+bool B1FileCompiler::limit_value_ranges(const B1_CMP_FLOW &flow, const B1_CMP_CMD &cmd, bool cond, std::vector<B1_CMP_RANGE> &ranges) const
+{
+	B1Types com_type;
+	B1_CMP_RANGE r1, r2;
+
+	// the comparison is numeric and both values are not changed by conversion to the operation type
+	if(	!get_op_com_type(cmd, cmd.args[0][0].type, cmd.args[1][0].type, com_type) ||
+		!get_arg_range(flow, cmd.args[0], ranges, r1) || !get_arg_range(flow, cmd.args[1], ranges, r2) ||
+		!is_range_in_type(r1, com_type) || !is_range_in_type(r2, com_type))
 	{
-		return is_udef_used(cmd.args[0]);
+		return true;
 	}
 
-	if(cmd.cmd == L"OUT")
+	std::wstring op = cmd.cmd;
+
+	if(!cond)
 	{
-		return is_udef_used(cmd.args[1]);
+		op =	(op == L"==") ? L"<>" :
+				(op == L"<>") ? L"==" :
+				(op == L">") ? L"<=" :
+				(op == L"<") ? L">=" :
+				(op == L">=") ? L"<" : L">";
 	}
 
-	if(cmd.cmd == L"IN")
+	// turn the comparison into one of the ==, <>, < and <= ones
+	if(op == L">" || op == L">=")
 	{
-		return is_udef_used(cmd.args[1]);
+		std::swap(r1, r2);
 	}
 
-	if(cmd.cmd == L"SET")
+	if(op == L"==")
 	{
-		return is_udef_used(cmd.args[1]);
+		r1.first = r2.first = std::max(r1.first, r2.first);
+		r1.second = r2.second = std::min(r1.second, r2.second);
+	}
+	else
+	if(op == L"<>")
+	{
+		if(r2.first == r2.second)
+		{
+			r1.first += (r1.first == r2.first) ? 1 : 0;
+			r1.second -= (r1.second == r2.first) ? 1 : 0;
+		}
+		if(r1.first == r1.second)
+		{
+			r2.first += (r2.first == r1.first) ? 1 : 0;
+			r2.second -= (r2.second == r1.first) ? 1 : 0;
+		}
+	}
+	else
+	{
+		const int64_t d = (op == L"<" || op == L">") ? 1 : 0;
+		r1.second = std::min(r1.second, r2.second - d);
+		r2.first = std::max(r2.first, r1.first + d);
 	}
 
-	if(cmd.cmd == L"IOCTL")
+	if(r1.first > r1.second || r2.first > r2.second)
 	{
-		return (cmd.args.size() > 2) ? is_udef_used(cmd.args[2]) : false;
+		return false;
 	}
 
-	if(cmd.cmd == L"READ")
+	if(op == L">" || op == L">=")
 	{
-		return is_udef_used(cmd.args[1]);
+		std::swap(r1, r2);
 	}
 
-	if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
+	const int v1 = (cmd.args[0].size() == 1 && is_range_var(cmd.args[0][0].value)) ? flow.get_var_index(cmd.args[0][0].value) : get_cvt_var_index(flow, cmd.args[0], ranges);
+	const int v2 = (cmd.args[1].size() == 1 && is_range_var(cmd.args[1][0].value)) ? flow.get_var_index(cmd.args[1][0].value) : get_cvt_var_index(flow, cmd.args[1], ranges);
+
+	if(v1 != v2)
 	{
-		return (cmd.args.size() == 2) ? is_udef_used(cmd.args[1]) : (is_udef_used(cmd.args[1]) || is_udef_used(cmd.args[2]));
+		if(v1 >= 0)
+		{
+			ranges[v1] = r1;
+		}
+		if(v2 >= 0)
+		{
+			ranges[v2] = r2;
+		}
 	}
 
-	if(cmd.cmd == L"XARG")
+	return true;
+}
+
+// number of times a block is processed before ranges of values at its beginning are extended to the nearest
+// compared values or to the type ranges (makes the analysis of loops stop)
+#define B1C_RANGES_WIDENING_VISITS 3
+// number of passes limiting the ranges after the extension
+#define B1C_RANGES_NARROWING_PASSES 2
+
+// value range analysis: calculates ranges of numeric variable values at the beginning of every block. conditional
+// jumps limit ranges of the compared variables, branches that cannot be taken with the ranges are not followed
+void B1FileCompiler::calc_value_ranges(const B1_CMP_FLOW &flow, bool init, std::vector<std::vector<B1_CMP_RANGE>> &ranges, std::vector<bool> &reached)
+{
+	const auto &blocks = flow.get_blocks();
+	const int blocks_num = (int)blocks.size();
+	const int vars_num = flow.get_vars_num();
+
+	ranges.assign(blocks_num, std::vector<B1_CMP_RANGE>());
+	reached.assign(blocks_num, false);
+
+	std::vector<B1_CMP_RANGE> type_ranges;
+	get_var_type_ranges(flow, type_ranges);
+
+	// ranges at the code beginning
+	std::vector<B1_CMP_RANGE> init_ranges = type_ranges;
+
+	if(init)
 	{
-		return is_udef_used(cmd.args[0]);
+		for(int v = 0; v < vars_num; v++)
+		{
+			const auto &vname = flow.get_var_name(v);
+
+			if(!is_gen_local(vname) && is_range_var(vname))
+			{
+				init_ranges[v] = B1_CMP_RANGE(0, 0);
+			}
+		}
 	}
 
+	// values compared with variables (the nearest values can be bounds of loop variable ranges)
+	std::vector<int64_t> limits;
 
-	if(cmd.args.size() == 2)
+	for(const auto &blk: blocks)
 	{
-		for(auto &op: B1CUtils::_un_ops)
+		for(auto i = blk.first; i != blk.last; i++)
 		{
-			if(cmd.cmd == op)
+			if(B1CUtils::is_label(*i) || !B1CUtils::is_log_op(*i))
+			{
+				continue;
+			}
+
+			for(const auto &arg: i->args)
+			{
+				int32_t n;
+
+				if(arg.size() == 1 && B1CUtils::is_num_val(arg[0].value) && Utils::str2int32(arg[0].value, n) == B1_RES_OK)
+				{
+					Utils::correct_int_value(n, arg[0].type);
+					limits.push_back((int64_t)n - 1);
+					limits.push_back(n);
+					limits.push_back((int64_t)n + 1);
+				}
+			}
+		}
+	}
+
+	std::sort(limits.begin(), limits.end());
+	limits.erase(std::unique(limits.begin(), limits.end()), limits.end());
+
+	// ranges at the end of every block for every block executed after it
+	std::vector<std::vector<std::pair<int, std::vector<B1_CMP_RANGE>>>> out_ranges(blocks_num);
+	std::vector<int> visits(blocks_num, 0);
+
+	std::vector<B1_CMP_RANGE> cur;
+	std::vector<std::pair<int, std::vector<B1_CMP_RANGE>>> out;
+
+	// processes the block, returns false if the ranges at the block end are not changed
+	auto process_block = [&](int b, bool widen) -> bool
+	{
+		const auto &blk = blocks[b];
+		bool no_input = true;
+
+		if(blk.entry)
+		{
+			cur = (b == 0) ? init_ranges : type_ranges;
+			no_input = false;
+		}
+
+		for(const auto p: blk.preds)
+		{
+			if(!reached[p])
+			{
+				continue;
+			}
+
+			for(const auto &o: out_ranges[p])
+			{
+				if(o.first != b)
+				{
+					continue;
+				}
+
+				if(no_input)
+				{
+					cur = o.second;
+					no_input = false;
+					continue;
+				}
+
+				for(int v = 0; v < vars_num; v++)
+				{
+					cur[v].first = std::min(cur[v].first, o.second[v].first);
+					cur[v].second = std::max(cur[v].second, o.second[v].second);
+				}
+			}
+		}
+
+		if(no_input)
+		{
+			return false;
+		}
+
+		// the ranges only grow until they are stable, the ones growing too long are extended to the nearest
+		// compared values or to the type ranges
+		if(widen && visits[b]++ > 0)
+		{
+			const bool ext = visits[b] > B1C_RANGES_WIDENING_VISITS;
+
+			for(int v = 0; v < vars_num; v++)
 			{
-				for(const auto &a: cmd.args)
+				if(cur[v].first < ranges[b][v].first)
 				{
-					if(is_udef_used(a))
+					if(ext)
 					{
-						return true;
+						auto t = std::upper_bound(limits.cbegin(), limits.cend(), cur[v].first);
+						cur[v].first = (t == limits.cbegin()) ? type_ranges[v].first : std::max(*std::prev(t), type_ranges[v].first);
 					}
 				}
+				else
+				{
+					cur[v].first = ranges[b][v].first;
+				}
 
-				return false;
+				if(cur[v].second > ranges[b][v].second)
+				{
+					if(ext)
+					{
+						auto t = std::lower_bound(limits.cbegin(), limits.cend(), cur[v].second);
+						cur[v].second = (t == limits.cend()) ? type_ranges[v].second : std::min(*t, type_ranges[v].second);
+					}
+				}
+				else
+				{
+					cur[v].second = ranges[b][v].second;
+				}
 			}
 		}
 
-		for(auto &op: B1CUtils::_log_ops)
+		ranges[b] = cur;
+
+		for(auto i = blk.first; i != blk.last; i++)
 		{
-			if(cmd.cmd == op)
+			value_ranges_step(flow, *i, type_ranges, cur);
+		}
+
+		// comparison the conditional jump depends on
+		const B1_CMP_CMD *cmp = nullptr;
+		bool jump_if_true = false;
+
+		const auto &last = *std::prev(blk.last);
+
+		if(!B1CUtils::is_label(last) && (last.cmd == L"JT" || last.cmd == L"JF") && std::prev(blk.last) != blk.first)
+		{
+			const auto &prev = *std::prev(blk.last, 2);
+
+			if(!B1CUtils::is_label(prev) && B1CUtils::is_log_op(prev))
 			{
-				for(const auto &a: cmd.args)
-				{
-					if(is_udef_used(a))
-					{
-						return true;
-					}
+				cmp = &prev;
+				jump_if_true = (last.cmd == L"JT");
+			}
+		}
 
-					return false;
+		out.clear();
+
+		for(const auto s: blk.succs)
+		{
+			if(std::find_if(out.cbegin(), out.cend(), [s](const std::pair<int, std::vector<B1_CMP_RANGE>> &o) { return o.first == s; }) != out.cend())
+			{
+				continue;
+			}
+
+			out.emplace_back(s, cur);
+
+			if(cmp != nullptr && (s == blk.jump) != (s == b + 1))
+			{
+				if(!limit_value_ranges(flow, *cmp, (s == blk.jump) == jump_if_true, out.back().second))
+				{
+					// the branch cannot be taken
+					out.pop_back();
 				}
 			}
 		}
+
+		if(reached[b] && out == out_ranges[b])
+		{
+			return false;
+		}
+
+		reached[b] = true;
+		out_ranges[b].swap(out);
+		return true;
+	};
+
+	std::deque<int> queue;
+	std::vector<bool> queued(blocks_num, false);
+
+	for(int b = 0; b < blocks_num; b++)
+	{
+		if(blocks[b].entry)
+		{
+			queue.push_back(b);
+			queued[b] = true;
+		}
 	}
 
-	if(cmd.args.size() == 3)
+	while(!queue.empty())
 	{
-		for(auto &op: B1CUtils::_bin_ops)
+		const int b = queue.front();
+		queue.pop_front();
+		queued[b] = false;
+
+		if(process_block(b, true))
 		{
-			if(cmd.cmd == op)
+			for(const auto &o: out_ranges[b])
 			{
-				for(const auto &a: cmd.args)
+				if(!queued[o.first])
 				{
-					if(is_udef_used(a))
-					{
-						return true;
-					}
-
-					return false;
+					queue.push_back(o.first);
+					queued[o.first] = true;
 				}
 			}
 		}
 	}
 
-	return false;
-}
-
-bool B1FileCompiler::is_volatile_used(const B1_CMP_ARG &arg)
-{
-	for(const auto &aa: arg)
+	// the ranges extended to the variable type ranges in loops are limited again with the conditions
+	for(int n = 0; n < B1C_RANGES_NARROWING_PASSES; n++)
 	{
-		if(!B1CUtils::is_imm_val(aa.value) && is_volatile_var(aa.value))
+		for(int b = 0; b < blocks_num; b++)
 		{
-			return true;
+			if(reached[b])
+			{
+				process_block(b, false);
+			}
 		}
 	}
-
-	return false;
 }
 
-bool B1FileCompiler::is_volatile_used(const B1_CMP_CMD &cmd)
+// narrows types of local variables using ranges of their values, e.g. the local storing the result of
+// operation with LONG operands can be made BYTE if the operation result is always within 0..255
+B1C_T_ERROR B1FileCompiler::narrow_locals(bool init, bool &changed)
 {
-	if(B1CUtils::is_label(cmd))
-	{
-		return false;
-	}
+	changed = false;
 
-	if(cmd.cmd == L"GA")
+	// local variables of INT, WORD and LONG types
+	std::map<std::wstring, B1Types> locals;
+
+	for(const auto &cmd: *this)
 	{
-		for(auto a = cmd.args.begin() + 2; a != cmd.args.end(); a++)
+		if(!B1CUtils::is_label(cmd) && cmd.cmd == L"LA" && is_gen_local(cmd.args[0][0].value))
 		{
-			if(is_volatile_used(*a))
+			const auto type = Utils::get_type_by_name(cmd.args[1][0].value);
+			if(type == B1Types::B1T_INT || type == B1Types::B1T_WORD || type == B1Types::B1T_LONG)
 			{
-				return true;
+				locals[cmd.args[0][0].value] = type;
 			}
 		}
-
-		return false;
 	}
 
-	if(cmd.cmd == L"RETVAL")
+	if(locals.empty())
 	{
-		return is_volatile_used(cmd.args[0]);
+		return B1C_T_ERROR::B1C_RES_OK;
 	}
 
-	if(cmd.cmd == L"OUT")
+	// all references to the locals should be of their types
+	for(const auto &cmd: *this)
 	{
-		return is_volatile_used(cmd.args[1]);
-	}
+		if(B1CUtils::is_label(cmd) || cmd.cmd == L"LA" || cmd.cmd == L"LF")
+		{
+			continue;
+		}
 
-	if(cmd.cmd == L"IN")
-	{
-		return is_volatile_used(cmd.args[1]);
+		for(const auto &arg: cmd.args)
+		{
+			for(const auto &tv: arg)
+			{
+				auto l = locals.find(tv.value);
+				if(l != locals.end() && tv.type != l->second)
+				{
+					locals.erase(l);
+				}
+			}
+		}
 	}
 
-	if(cmd.cmd == L"SET")
+	if(locals.empty())
 	{
-		return is_volatile_used(cmd.args[1]);
+		return B1C_T_ERROR::B1C_RES_OK;
 	}
 
-	if(cmd.cmd == L"IOCTL")
-	{
-		return (cmd.args.size() > 2) ? is_volatile_used(cmd.args[2]) : false;
-	}
+	auto flow = get_flow();
+	const auto &blocks = flow.get_blocks();
 
-	if(cmd.cmd == L"READ")
-	{
-		return is_volatile_used(cmd.args[1]);
-	}
+	std::vector<std::vector<B1_CMP_RANGE>> block_ranges;
+	std::vector<bool> reached;
+	calc_value_ranges(flow, init, block_ranges, reached);
 
-	if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
-	{
-		return (cmd.args.size() == 2) ? is_volatile_used(cmd.args[1]) : (is_volatile_used(cmd.args[1]) || is_volatile_used(cmd.args[2]));
-	}
+	std::vector<B1_CMP_RANGE> type_ranges;
+	get_var_type_ranges(flow, type_ranges);
 
-	if(cmd.cmd == L"XARG")
-	{
-		return is_volatile_used(cmd.args[0]);
-	}
+	// ranges of values written to the locals
+	std::map<std::wstring, B1_CMP_RANGE> written;
+	std::vector<B1_CMP_RANGE> ranges;
+	B1_CMP_USE_DEF ud;
 
-	if(cmd.args.size() == 2)
+	for(int b = 0; b < (int)blocks.size(); b++)
 	{
-		for(auto &op: B1CUtils::_un_ops)
+		if(!reached[b])
 		{
-			if(cmd.cmd == op)
-			{
-				for(const auto &a: cmd.args)
-				{
-					if(is_volatile_used(a))
-					{
-						return true;
-					}
-				}
-
-				return false;
-			}
+			continue;
 		}
 
-		for(auto &op: B1CUtils::_log_ops)
+		ranges = block_ranges[b];
+
+		for(auto i = blocks[b].first; i != blocks[b].last; i++)
 		{
-			if(cmd.cmd == op)
-			{
-				for (const auto &a: cmd.args)
-				{
-					if(is_volatile_used(a))
-					{
-						return true;
-					}
+			value_ranges_step(flow, *i, type_ranges, ranges);
 
-					return false;
-				}
+			// LA and LF commands do not write values
+			if(B1CUtils::is_label(*i) || i->cmd == L"LA" || i->cmd == L"LF")
+			{
+				continue;
 			}
-		}
-	}
 
-	if(cmd.args.size() == 3)
-	{
-		for(auto &op: B1CUtils::_bin_ops)
-		{
-			if(cmd.cmd == op)
+			flow.get_use_def(*i, ud);
+			ud.def.insert(ud.def.end(), ud.mod.cbegin(), ud.mod.cend());
+
+			for(const auto d: ud.def)
 			{
-				for(const auto &a: cmd.args)
+				const auto &vname = flow.get_var_name(d);
+
+				if(locals.find(vname) == locals.end())
 				{
-					if(is_volatile_used(a))
-					{
-						return true;
-					}
+					continue;
+				}
 
-					return false;
+				auto w = written.find(vname);
+				if(w == written.end())
+				{
+					written[vname] = ranges[d];
+				}
+				else
+				{
+					w->second.first = std::min(w->second.first, ranges[d].first);
+					w->second.second = std::max(w->second.second, ranges[d].second);
 				}
 			}
 		}
 	}
 
-	return false;
-}
-
-B1C_T_ERROR B1FileCompiler::remove_duplicate_assigns(bool &changed)
-{
-	changed = false;
+	// the narrowest types the written values fit in
+	std::map<std::wstring, B1Types> new_types;
 
-	for(auto i = cbegin(); i != cend(); i++)
+	for(const auto &l: locals)
 	{
-		const auto &cmd =*i;
-
-		if(B1CUtils::is_label(cmd))
+		auto w = written.find(l.first);
+		if(w == written.end())
 		{
 			continue;
 		}
 
-		if(is_volatile_used(cmd))
+		for(const auto type: { B1Types::B1T_BYTE, B1Types::B1T_INT, B1Types::B1T_WORD })
 		{
-			continue;
+			if(type == l.second || (type != B1Types::B1T_BYTE && l.second != B1Types::B1T_LONG))
+			{
+				break;
+			}
+
+			if(is_range_in_type(w->second, type))
+			{
+				new_types[l.first] = type;
+				break;
+			}
 		}
+	}
 
-		const B1_CMP_ARG *dstarg = nullptr;
+	// reading a local of the new type should give the same results: the value can be used as an array subscript,
+	// function argument, assigned to a variable or used as an operand if the operation type is not changed or the
+	// operands and the result fit the new operation type
+	auto get_type = [&new_types](const B1_TYPED_VALUE &tv)
+	{
+		auto nt = new_types.find(tv.value);
+		return (nt == new_types.end()) ? tv.type : nt->second;
+	};
 
-		if(B1CUtils::is_un_op(cmd))
-		{
-			dstarg = &cmd.args[1];
-		}
-		else
-		if(B1CUtils::is_bin_op(cmd))
-		{
-			dstarg = &cmd.args[2];
-		}
-		else
-		{
-			continue;
-		}
+	bool stop = false;
 
-		std::set<std::wstring> jumps;
-		std::set<std::wstring> labels;
+	while(!stop && !new_types.empty())
+	{
+		stop = true;
 
-		for(auto j = std::next(i); j != cend(); j++)
+		for(int b = 0; b < (int)blocks.size(); b++)
 		{
-			const auto &cmd1 = *j;
-
-			if(B1CUtils::is_label(cmd1))
+			if(reached[b])
 			{
-				labels.insert(cmd1.cmd);
-				continue;
+				ranges = block_ranges[b];
 			}
-
-			if(cmd1.cmd == L"JMP" || cmd1.cmd == L"JT" || cmd1.cmd == L"JF" || cmd1.cmd == L"ERR")
+			else
 			{
-				jumps.insert(cmd1.args[cmd1.cmd == L"ERR" ? 1 : 0][0].value);
+				ranges.clear();
 			}
 
-			if(cmd1.cmd == L"CALL" || cmd1.cmd == L"END" || cmd1.cmd == L"RET")
+			for(auto i = blocks[b].first; i != blocks[b].last; i++)
 			{
-				break;
-			}
+				const auto &cmd = *i;
 
-			bool is_local = false;
+				if(B1CUtils::is_label(cmd) || cmd.cmd == L"LA" || cmd.cmd == L"LF")
+				{
+					continue;
+				}
 
-			if(dstarg->size() > 1)
-			{
-				// forbid deleting assignment to a subscripted variable if its subscripts are variables
-				auto a = dstarg->begin() + 1;
-				for(; a != dstarg->end(); a++)
+				const bool op = B1CUtils::is_un_op(cmd) || B1CUtils::is_bin_op(cmd) || B1CUtils::is_log_op(cmd);
+				// operands (scalar values) of the command that are the locals to narrow
+				std::vector<std::wstring> opnds;
+				bool valid = true;
+
+				for(int a = 0; a < (int)cmd.args.size(); a++)
 				{
-					if(!B1CUtils::is_imm_val(a->value))
+					const auto &arg = cmd.args[a];
+
+					if(arg.size() != 1 || new_types.find(arg[0].value) == new_types.end())
+					{
+						continue;
+					}
+
+					if(op && (a != (int)cmd.args.size() - 1 || B1CUtils::is_log_op(cmd)))
+					{
+						opnds.push_back(arg[0].value);
+					}
+					else
+					if(!op)
+					{
+						valid = false;
+						opnds.push_back(arg[0].value);
+					}
+				}
+
+				if(!opnds.empty() && valid && cmd.cmd != L"=")
+				{
+					B1Types com_type, new_com_type;
+
+					const auto &arg1 = cmd.args[0][0];
+					const auto &arg2 = (B1CUtils::is_un_op(cmd) ? cmd.args[0] : cmd.args[1])[0];
+
+					if(	!get_op_com_type(cmd, arg1.type, arg2.type, com_type) ||
+						!get_op_com_type(cmd, get_type(arg1), get_type(arg2), new_com_type))
+					{
+						valid = false;
+					}
+					else
+					if(com_type != new_com_type && reached[b])
 					{
-						break;
+						B1_CMP_RANGE r1, r2, res;
+
+						valid =	get_arg_range(flow, cmd.args[0], ranges, r1) && is_range_in_type(r1, new_com_type) &&
+								(B1CUtils::is_un_op(cmd) || (get_arg_range(flow, cmd.args[1], ranges, r2) && is_range_in_type(r2, new_com_type))) &&
+								(B1CUtils::is_log_op(cmd) || (cmd.cmd != L"^" && get_op_range(cmd.cmd, B1CUtils::is_un_op(cmd), r1, r2, res) && is_range_in_type(res, new_com_type)));
 					}
 				}
-				if(a != dstarg->end())
+
+				if(!valid)
 				{
-					break;
+					for(const auto &o: opnds)
+					{
+						new_types.erase(o);
+					}
+					stop = false;
 				}
 
-				// forbid deleting assignment to a subscripted variable if the variable is used somewhere else
-				// =,10,A(5)
-				// =,A(I),B   ->  do not delete the first line because I can be equal to 5
-				// =,15,A(5)
-				if(B1CUtils::is_src(cmd1, (*dstarg)[0].value))
+				if(reached[b])
 				{
-					break;
+					value_ranges_step(flow, cmd, type_ranges, ranges);
 				}
 			}
-			else
-			{
-				is_local = is_gen_local((*dstarg)[0].value);
-			}
+		}
+	}
 
-			if(B1CUtils::arg_is_src(cmd1, *dstarg))
-			{
-				break;
-			}
+	if(new_types.empty())
+	{
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
 
-			//no user defined functions calls (functions can use dstarg)
-			// =,10,A
-			// =,DOSOMETHING(B),C  ->  do not delete the first line because DOSOMETHING fn can use it
-			// =,15,A
-			if(!is_local && is_udef_used(cmd1))
+	for(auto &cmd: *this)
+	{
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		if(cmd.cmd == L"LA")
+		{
+			auto nt = new_types.find(cmd.args[0][0].value);
+			if(nt != new_types.end())
 			{
-				break;
+				cmd.edit_args()[1][0].value = Utils::get_type_name(nt->second);
+				cmd.edit_args()[1][0].type = nt->second;
 			}
+			continue;
+		}
 
-			if(B1CUtils::arg_is_dst(cmd1, *dstarg, is_local))
+		if(cmd.cmd == L"LF")
+		{
+			continue;
+		}
+
+		for(auto a = cmd.args.begin(); a != cmd.args.end(); a++)
+		{
+			for(auto tv = a->begin(); tv != a->end(); tv++)
 			{
-				if(std::includes(labels.cbegin(), labels.cend(), jumps.cbegin(), jumps.cend()))
+				auto nt = new_types.find(tv->value);
+				if(nt != new_types.end())
 				{
-					erase(i--);
-					changed = true;
+					cmd.edit_args()[a - cmd.args.begin()][tv - a->begin()].type = nt->second;
 				}
-				break;
 			}
 		}
 	}
 
+	for(const auto &nt: new_types)
+	{
+		auto v = _vars.find(nt.first);
+		if(v != _vars.end())
+		{
+			std::get<0>(v->second) = nt.second;
+		}
+	}
+
+	changed = true;
+
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::remove_self_assigns(bool &changed)
+// makes comparisons of LONG values be calculated in INT or WORD type if both compared values fit it. declared types
+// of the variables are not changed (the variables can be used elsewhere), the variables are converted with CINT or
+// CWRD functions (c1 compilers load just the low-order words of the variables then) and the immediate values are
+// retyped, e.g. FOR loop counter of LONG type compared with the loop end value:
+// <,I<LONG>,100<LONG>   ->   <,CINT<INT>(I<LONG>),100<INT>
+// comparisons of INT and WORD values are not narrowed to BYTE: the narrower comparison is not shorter if the value
+// is already loaded into a register (e.g. right after the loop counter increment)
+B1C_T_ERROR B1FileCompiler::narrow_cmps(bool init, bool &changed)
 {
 	changed = false;
 
-	// remove assignments like "=,<var>,<the_same_var>"
-	for(auto i = cbegin(); i != cend(); i++)
-	{
-		auto &cmd = *i;
+	bool found = false;
 
-		if(B1CUtils::is_label(cmd))
+	for(const auto &cmd: *this)
+	{
+		if(	!B1CUtils::is_label(cmd) && B1CUtils::is_log_op(cmd) &&
+			(cmd.args[0][0].type == B1Types::B1T_LONG || cmd.args[1][0].type == B1Types::B1T_LONG))
 		{
-			continue;
+			found = true;
+			break;
 		}
+	}
 
-		if(cmd.cmd == L"=" && cmd.args[0] == cmd.args[1])
-		{
-			if(is_volatile_used(cmd))
-			{
-				continue;
-			}
-
-			// subscripts should not be functions
-			bool fn_used = false;
+	if(!found)
+	{
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
 
-			for(auto a = cmd.args[0].begin() + 1; a != cmd.args[0].end(); a++)
-			{
-				if(fn_exists(a->value))
-				{
-					fn_used = true;
-					break;
-				}
-			}
+	auto flow = get_flow();
+	const auto &blocks = flow.get_blocks();
 
-			if(!fn_used)
-			{
-				erase(i--);
-				changed = true;
-			}
+	std::vector<std::vector<B1_CMP_RANGE>> block_ranges;
+	std::vector<bool> reached;
+	calc_value_ranges(flow, init, block_ranges, reached);
 
-			continue;
-		}
-	}
+	std::vector<B1_CMP_RANGE> type_ranges;
+	get_var_type_ranges(flow, type_ranges);
 
-	// optimize assignments like
-	// =,<var1>,<var2>
-	// =,<var2>,<var1>
-	for(auto i = cbegin(); i != cend(); i++)
+	// only immediate values and variables with known value ranges can be narrowed
+	auto is_narrow_arg = [this, &flow](const B1_CMP_ARG &arg)
 	{
-		auto &cmd = *i;
+		return arg.size() == 1 && (B1CUtils::is_num_val(arg[0].value) || (is_range_var(arg[0].value) && flow.get_var_index(arg[0].value) >= 0));
+	};
 
-		if(B1CUtils::is_label(cmd))
-		{
-			continue;
-		}
+	// comparisons to narrow and their new types
+	std::vector<std::pair<iterator, B1Types>> cmps;
+	std::vector<B1_CMP_RANGE> ranges;
 
-		auto j = i;
-		j++;
-		if(j == cend())
+	for(int b = 0; b < (int)blocks.size(); b++)
+	{
+		if(!reached[b])
 		{
-			break;
+			continue;
 		}
 
-		auto &cmd1 = *j;
+		ranges = block_ranges[b];
 
-		if(	(cmd.cmd == L"=" && cmd.args[0].size() == 1 && cmd.args[1].size() == 1) && 
-			(cmd1.cmd == L"=" && cmd1.args[0].size() == 1 && cmd1.args[1].size() == 1) &&
-			(cmd.args[0][0].value == cmd1.args[1][0].value && cmd.args[1][0].value == cmd1.args[0][0].value))
+		for(auto i = blocks[b].first; i != blocks[b].last; i++)
 		{
-			if(	(cmd.args[0][0].type == B1Types::B1T_STRING && cmd.args[1][0].type != B1Types::B1T_STRING) ||
-				(cmd.args[0][0].type != B1Types::B1T_STRING && cmd.args[1][0].type == B1Types::B1T_STRING))
-			{
-				continue;
-			}
+			B1Types com_type;
+			B1_CMP_RANGE r1, r2;
 
-			if(	(cmd.args[1][0].type == B1Types::B1T_BYTE && cmd.args[0][0].type != B1Types::B1T_BYTE) ||
-				(cmd.args[1][0].type != B1Types::B1T_LONG && cmd.args[0][0].type == B1Types::B1T_LONG))
+			if(	!B1CUtils::is_label(*i) && B1CUtils::is_log_op(*i) &&
+				get_op_com_type(*i, i->args[0][0].type, i->args[1][0].type, com_type) && com_type == B1Types::B1T_LONG &&
+				is_narrow_arg(i->args[0]) && is_narrow_arg(i->args[1]) &&
+				get_arg_range(flow, i->args[0], ranges, r1) && get_arg_range(flow, i->args[1], ranges, r2))
 			{
-				continue;
+				for(const auto type: { B1Types::B1T_INT, B1Types::B1T_WORD })
+				{
+					if(is_range_in_type(r1, type) && is_range_in_type(r2, type))
+					{
+						cmps.emplace_back(i, type);
+						break;
+					}
+				}
 			}
 
-			if(is_volatile_used(cmd))
+			value_ranges_step(flow, *i, type_ranges, ranges);
+		}
+	}
+
+	for(auto &c: cmps)
+	{
+		for(auto &arg: c.first->edit_args())
+		{
+			if(B1CUtils::is_num_val(arg[0].value))
 			{
-				continue;
+				int32_t n = 0;
+				Utils::str2int32(arg[0].value, n);
+				Utils::correct_int_value(n, c.second);
+				arg[0] = B1_TYPED_VALUE(std::to_wstring(n), c.second);
 			}
-
-			if(fn_exists(cmd.args[0][0].value) || fn_exists(cmd.args[1][0].value))
+			else
 			{
-				continue;
+				arg.insert(arg.begin(), B1_TYPED_VALUE((c.second == B1Types::B1T_INT) ? L"CINT" : L"CWRD", c.second));
 			}
-
-			erase(j);
-			changed = true;
-
-			continue;
 		}
+
+		changed = true;
 	}
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::remove_jumps(bool &changed)
-{
-	changed = false;
+// moves calculations of loop-invariant values out of the loop and replaces multiplications of induction variables
+// by constants with additions. the loop should be placed in code as a sequence of blocks starting with the header
+// and followed by the only exit block (FOR/NEXT and WHILE/WEND loops are), the values are stored in local variables
+// allocated before the loop header and freed in the exit block:
+//                      LA,local0
+//                      +,J,1,local0
+//                      LA,local1
+//                      *,I,4,local1
+// :loop                :loop
+// ...                  ...
+// +,J,1,local2    ->   =,local0,local2
+// *,I,4,local3         =,local1,local3
+// ...                  ...
+// +,I,1,I              +,I,1,I
+//                      +,local1,4,local1
+// JMP,loop             JMP,loop
+// :end                 :end
+//                      LF,local1
+//                      LF,local0
+bool B1FileCompiler::optimize_loop(const B1_CMP_FLOW &flow, const B1_CMP_LOOP &loop)
+{
+	const auto &blocks = flow.get_blocks();
+	const int last_blk = loop.blocks.back();
+
+	if(loop.header != loop.blocks.front() || loop.header == 0 || last_blk - loop.header + 1 != (int)loop.blocks.size())
+	{
+		return false;
+	}
 
-	// remove all commands between JMP, RET or END and the next label
-	for(auto i = cbegin(); i != cend(); i++)
+	// the loop can be entered by falling through to the header only
+	const auto &hdr = blocks[loop.header];
+
+	if(hdr.entry)
 	{
-		auto &cmd = *i;
+		return false;
+	}
 
-		if(B1CUtils::is_label(cmd))
+	for(const auto p: hdr.preds)
+	{
+		if(!loop.contains(p) && p != loop.header - 1)
 		{
-			continue;
+			return false;
 		}
+	}
 
-		if(cmd.cmd == L"JMP" || cmd.cmd == L"RET" || cmd.cmd == L"END")
-		{
-			for(i++; i != cend(); i++)
-			{
-				auto &cmd1 = *i;
+	const auto &prev_cmd = *std::prev(hdr.first);
+	if(B1CUtils::is_label(prev_cmd) || B1_CMP_FLOW::is_terminator(prev_cmd) || B1CUtils::is_log_op(prev_cmd))
+	{
+		return false;
+	}
 
-				if(B1CUtils::is_label(cmd1) || cmd1.cmd == L"LA" || cmd1.cmd == L"LF")
-				{
-					break;
-				}
+	// the loop can be left through the next block only
+	const int exit_blk = last_blk + 1;
 
-				if(!(cmd1.cmd == L"DAT" || cmd1.cmd == L"DEF" || cmd1.cmd == L"MA" || cmd1.cmd == L"NS" || cmd1.cmd == L"END" ||
-					 (cmd1.cmd == L"GA" && cmd1.args[1].size() > 1) || B1CUtils::is_log_op(cmd1)
-					))
-				{
-					erase(i--);
-					changed = true;
-				}
-			}
+	for(const auto b: loop.blocks)
+	{
+		if(blocks[b].entry || blocks[b].exit)
+		{
+			return false;
+		}
 
-			if(i == cend())
+		for(const auto s: blocks[b].succs)
+		{
+			if(!loop.contains(s) && s != exit_blk)
 			{
-				break;
+				return false;
 			}
 		}
 	}
 
-	// remove jumps on the next commmand
-	for(auto i = cbegin(); i != cend(); i++)
+	if(exit_blk >= (int)blocks.size() || blocks[exit_blk].entry)
 	{
-		auto &cmd = *i;
+		return false;
+	}
 
-		if(cmd.cmd == L"JMP" || cmd.cmd == L"JF" || cmd.cmd == L"JT")
+	for(const auto p: blocks[exit_blk].preds)
+	{
+		if(!loop.contains(p))
 		{
-			auto nxti = std::next(i);
-			if(nxti == cend())
-			{
-				break;
-			}
+			return false;
+		}
+	}
 
-			auto &cmd1 = *nxti;
-			if(B1CUtils::is_label(cmd1) && cmd.args[0][0].value == cmd1.cmd)
-			{
-				erase(i);
-				i = nxti;
+	// numbers of the loop commands writing variables (partial changes are counted twice)
+	std::vector<int> var_defs(flow.get_vars_num(), 0);
+	bool ext = false;
+	int locals = 0;
+	B1_CMP_USE_DEF ud;
 
-				changed = true;
-			}
+	for(auto i = hdr.first; i != blocks[last_blk].last; i++)
+	{
+		if(B1CUtils::is_label(*i))
+		{
+			continue;
+		}
+
+		if(B1CUtils::is_inline_asm(*i))
+		{
+			return false;
+		}
+
+		// local variables allocated in the loop must be freed in it too
+		if(i->cmd == L"LA")
+		{
+			locals++;
+		}
+		else
+		if(i->cmd == L"LF" && --locals < 0)
+		{
+			return false;
+		}
+
+		flow.get_use_def(*i, ud);
+
+		ext = ext || ud.ext;
+
+		for(const auto d: ud.def)
+		{
+			var_defs[d]++;
+		}
+		for(const auto m: ud.mod)
+		{
+			var_defs[m] += 2;
 		}
 	}
 
-	// JF,l1
-	// JMP(JT),l2  ->   JT,l2
-	// :l1              :l1
-	//
-	// JT,l1
-	// JMP(JF),l2  ->   JF,l2
-	//:l1              :l1
-	for(auto i = begin(); i != end(); i++)
+	if(locals != 0)
 	{
-		auto &cmd = *i;
+		return false;
+	}
+
+	B1_CMP_RANGE range;
+
+	auto get_var = [this, &flow](const B1_CMP_ARG &arg) -> int
+	{
+		B1_CMP_RANGE range;
+
+		if(arg.size() != 1 || B1CUtils::is_imm_val(arg[0].value) || !get_type_range(arg[0].type, range) || !is_imm_var(arg[0].value))
+		{
+			return -1;
+		}
 
-		if(cmd.cmd == L"JF" || cmd.cmd == L"JT")
+		return flow.get_var_index(arg[0].value);
+	};
+
+	auto is_invariant = [&flow, &var_defs, &ext, &get_var](const B1_CMP_ARG &arg) -> bool
+	{
+		if(arg.size() == 1 && B1CUtils::is_num_val(arg[0].value))
 		{
-			auto nxti = std::next(i);
-			if(nxti == end())
-			{
-				break;
-			}
-			auto &cmd1 = *nxti;
+			return true;
+		}
 
-			if((cmd1.cmd == L"JMP" || cmd1.cmd == L"JF" || cmd1.cmd == L"JT") &&
-				cmd.cmd != cmd1.cmd)
-			{
-				nxti = std::next(nxti);
-				if(nxti == end())
-				{
-					break;
-				}
-				auto &cmd2 = *nxti;
+		const int v = get_var(arg);
 
-				if(B1CUtils::is_label(cmd2) && cmd.args[0][0].value == cmd2.cmd)
-				{
-					cmd1.cmd = (cmd.cmd == L"JF") ? L"JT" : L"JF";
-					erase(i);
-					i = nxti;
+		return v >= 0 && var_defs[v] == 0 && !(ext && flow.is_ext_var(v));
+	};
 
-					changed = true;
-				}
-			}
-		}
-	}
+	auto get_int = [](const B1_CMP_ARG &arg, int32_t &n) -> bool
+	{
+		return arg.size() == 1 && B1CUtils::is_num_val(arg[0].value) && Utils::str2int32(arg[0].value, n) == B1_RES_OK;
+	};
 
-	return B1C_T_ERROR::B1C_RES_OK;
-}
+	auto get_size = [](B1Types type) -> int32_t
+	{
+		int32_t size = 0;
+		B1CUtils::get_asm_type(type, nullptr, &size);
+		return size;
+	};
 
-// remove compare operation, convert JT/JF to JMP and remove JF/JT
-void B1FileCompiler::remove_compare_op(B1_CMP_CMDS::iterator i, bool is_true)
-{
-	// remove compare operation, convert JT/JF to JMP and remove JF/JT
-	erase(i++);
+	// basic induction variables: changed once in the loop by adding a constant
+	//       variable     command   increment
+	std::map<int, std::pair<iterator, int32_t>> ivs;
 
-	for(auto j = i; j != end(); j++)
+	for(auto i = hdr.first; i != blocks[last_blk].last; i++)
 	{
-		auto &cmd = *j;
+		const auto &cmd = *i;
 
-		if(B1CUtils::is_label(cmd))
+		if(B1CUtils::is_label(cmd) || (cmd.cmd != L"+" && cmd.cmd != L"-") || cmd.args.size() != 3)
 		{
 			continue;
 		}
 
-		if((!is_true && cmd.cmd == L"JF") || (is_true && cmd.cmd == L"JT"))
+		const int v = get_var(cmd.args[2]);
+		if(v < 0 || var_defs[v] != 1 || (ext && flow.is_ext_var(v)))
 		{
-			cmd.cmd = L"JMP";
 			continue;
 		}
 
-		if((!is_true && cmd.cmd == L"JT") || (is_true && cmd.cmd == L"JF"))
+		int32_t n = 0;
+		int op = (get_var(cmd.args[0]) == v) ? 0 : (cmd.cmd == L"+" && get_var(cmd.args[1]) == v) ? 1 : -1;
+		if(op < 0 || !get_int(cmd.args[1 - op], n))
 		{
-			erase(j--);
 			continue;
 		}
 
-		if(B1CUtils::is_log_op(cmd) || cmd.cmd == L"JMP" || cmd.cmd == L"END" || cmd.cmd == L"RET" || cmd.cmd == L"ERR")
+		// the command following the variable change gets the variable update
+		const auto next = std::next(i);
+		if(next == end() || (!B1CUtils::is_label(*next) && (next->cmd == L"JT" || next->cmd == L"JF")))
 		{
-			break;
+			continue;
+		}
+
+		if(cmd.cmd == L"-")
+		{
+			eval_num_op(L'-', 0, n, n);
 		}
+
+		ivs[v] = std::make_pair(i, n);
 	}
-}
 
-B1C_T_ERROR B1FileCompiler::remove_redundant_comparisons(bool &changed)
-{
-	changed = false;
+	// local variables storing the moved values
+	std::map<std::wstring, B1_TYPED_VALUE> vals;
+	const auto pre_pos = hdr.first;
+	auto lf_pos = blocks[exit_blk].first;
+	bool changed = false;
 
-	// remove unused compare operations (no JF or JT after logical operator)
-	for(auto i = cbegin(); i != cend(); i++)
+	while(lf_pos != end() && B1CUtils::is_label(*lf_pos))
 	{
-		auto &cmd = *i;
+		lf_pos++;
+	}
 
-		if(B1CUtils::is_label(cmd))
+	auto get_key = [](const B1_CMP_CMD &cmd, B1Types type) -> std::wstring
+	{
+		std::wstring key = cmd.cmd;
+		for(auto a = cmd.args.cbegin(); a != cmd.args.cend() - 1; a++)
 		{
-			continue;
+			key += L"," + (*a)[0].value.str() + L"<" + std::to_wstring((int)(*a)[0].type) + L">";
 		}
+		return key + L"," + std::to_wstring((int)type);
+	};
 
-		if(B1CUtils::is_log_op(cmd) && !is_volatile_used(cmd))
-		{
-			for(auto j = std::next(i); j != cend(); j++)
-			{
-				auto &cmd1 = *j;
+	// allocates local variable for the whole loop and calculates its initial value before the loop
+	auto emit_loop_local = [this, &pre_pos, &lf_pos](const B1_CMP_CMD &cmd, B1Types type) -> B1_TYPED_VALUE
+	{
+		_curr_line_num = cmd.line_num;
+		_curr_line_cnt = cmd.line_cnt;
+		_curr_src_line_id = cmd.src_line_id;
 
-				if(B1CUtils::is_label(cmd1))
-				{
-					continue;
-				}
+		const B1_TYPED_VALUE local(emit_local(type, pre_pos), type);
 
-				if(cmd1.cmd == L"JT" || cmd1.cmd == L"JF")
-				{
-					break;
-				}
+		auto init = cmd;
+		init.edit_args().back() = B1_CMP_ARG(local.value, type);
+		insert(pre_pos, init);
 
-				if(B1CUtils::is_log_op(cmd1) || cmd1.cmd == L"JMP" || cmd1.cmd == L"END" || cmd1.cmd == L"RET" || cmd1.cmd == L"ERR" || cmd1.cmd == L"RETVAL")
-				{
-					erase(i--);
+		// the locals are freed in reverse order
+		emit_command(L"LF", lf_pos, local.value.str());
+		lf_pos--;
 
-					changed = true;
-					break;
-				}
-			}
-		}
-	}
+		return local;
+	};
 
-	// optimize comparisons of the same variables (e.g. A(I) is always equal to A(I)) and evaluate comparison of immediate numeric values (e.g. 2 > 1)
-	for(auto i = begin(); i != end(); i++)
+	for(auto i = hdr.first; i != blocks[last_blk].last; i++)
 	{
 		auto &cmd = *i;
 
-		if(B1CUtils::is_label(cmd))
+		if(B1CUtils::is_label(cmd) || !(B1CUtils::is_bin_op(cmd) || (B1CUtils::is_un_op(cmd) && cmd.cmd != L"=")))
 		{
 			continue;
 		}
 
-		if(B1CUtils::is_log_op(cmd) && !is_volatile_used(cmd))
+		auto &dst = cmd.args.back();
+		if(dst.size() != 1 || !get_type_range(dst[0].type, range) || is_fn_used(cmd) || is_udef_used(cmd))
 		{
-			bool eq = false;
-			bool lt = false;
-			bool lt_comp = false;
-
-			if(cmd.args[0].size() == 1 && cmd.args[1].size() == 1 && B1CUtils::is_num_val(cmd.args[0][0].value) && B1CUtils::is_num_val(cmd.args[1][0].value))
-			{
-				// compare numeric values
-				int32_t n1, n2;
+			continue;
+		}
 
-				if(Utils::str2int32(cmd.args[0][0].value, n1) == B1_RES_OK && Utils::str2int32(cmd.args[1][0].value, n2) == B1_RES_OK)
-				{
-					eq = n1 == n2;
-					lt = n1 < n2;
-					lt_comp = true;
-				}
-				else
-				{
-					eq = cmd.args[0] == cmd.args[1];
-				}
-			}
-			else
-			{
-				eq = cmd.args[0] == cmd.args[1];
-			}
+		B1_TYPED_VALUE local;
 
-			bool is_true = false;
+		// multiplication of induction variable by constant: the product is changed with the variable
+		int32_t n = 0;
+		int op = -1;
+		B1Types com_type = B1Types::B1T_UNKNOWN;
 
-			if(cmd.cmd == L"==")
-			{
-				if(lt_comp)
-				{
-					is_true = eq;
-				}
-				else
-				{
-					if(eq)
-					{
-						is_true = true;
-					}
-					else
-					{
-						continue;
-					}
-				}
-			}
-			else
-			if(cmd.cmd == L"<>")
-			{
-				if(lt_comp)
-				{
-					is_true = !eq;
-				}
-				else
-				{
-					if(eq)
-					{
-						is_true = false;
-					}
-					else
-					{
-						continue;
-					}
-				}
-			}
-			else
-			if(cmd.cmd == L">")
-			{
-				if(lt_comp)
-				{
-					is_true = !(eq || lt);
-				}
-				else
-				{
-					if(eq)
-					{
-						is_true = false;
-					}
-					else
-					{
-						continue;
-					}
-				}
-			}
-			else
-			if(cmd.cmd == L"<")
-			{
-				if(lt_comp)
-				{
-					is_true = lt;
-				}
-				else
-				{
-					if(eq)
-					{
-						is_true = false;
-					}
-					else
-					{
-						continue;
-					}
-				}
-			}
-			else
-			if(cmd.cmd == L">=")
-			{
-				if(lt_comp)
-				{
-					is_true = !lt;
-				}
-				else
-				{
-					if(eq)
-					{
-						is_true = true;
-					}
-					else
-					{
-						continue;
-					}
-				}
-			}
-			else
-			if(cmd.cmd == L"<=")
+		if(cmd.cmd == L"*" && get_op_com_type(cmd, cmd.args[0][0].type, cmd.args[1][0].type, com_type) && get_type_range(com_type, range))
+		{
+			for(int a = 0; a < 2; a++)
 			{
-				if(lt_comp)
-				{
-					is_true = lt || eq;
-				}
-				else
+				const int v = get_var(cmd.args[a]);
+				auto iv = ivs.find(v);
+
+				// the variable and product overflows have to match
+				if(iv != ivs.end() && iv->second.first != i && get_int(cmd.args[1 - a], n) &&
+					get_size(cmd.args[a][0].type) == get_size(com_type) && get_size(dst[0].type) <= get_size(com_type))
 				{
-					if(eq)
-					{
-						is_true = true;
-					}
-					else
-					{
-						continue;
-					}
+					op = a;
+					break;
 				}
 			}
-
-			remove_compare_op(i--, is_true);
-			changed = true;
-		}
-	}
-
-	// remove unnecessary comparisons of unsigned variables to negative and zero values 
-	for(auto i = begin(); i != end(); i++)
-	{
-		auto &cmd = *i;
-
-		if(B1CUtils::is_label(cmd))
-		{
-			continue;
 		}
 
-		if(B1CUtils::is_log_op(cmd) && !is_volatile_used(cmd))
+		if(op >= 0)
 		{
-			int32_t n;
-			// numeric is on the left side of the expression
-			bool lnum = false;
-			B1Types vtype;
-			int32_t min, max;
-			bool proceed = false;
+			const auto key = get_key(cmd, com_type);
 
-			if(cmd.args[0].size() == 1 && B1CUtils::is_num_val(cmd.args[0][0].value) && Utils::str2int32(cmd.args[0][0].value, n) == B1_RES_OK && !B1CUtils::is_imm_val(cmd.args[1][0].value) && cmd.args[1][0].type != B1Types::B1T_STRING)
+			auto val = vals.find(key);
+			if(val != vals.end())
 			{
-				Utils::correct_int_value(n, cmd.args[0][0].type);
-				lnum = true;
-				vtype = cmd.args[1][0].type;
-				proceed = true;
+				local = val->second;
 			}
 			else
-			if(cmd.args[1].size() == 1 && B1CUtils::is_num_val(cmd.args[1][0].value) && Utils::str2int32(cmd.args[1][0].value, n) == B1_RES_OK && !B1CUtils::is_imm_val(cmd.args[0][0].value) && cmd.args[0][0].type != B1Types::B1T_STRING)
 			{
-				Utils::correct_int_value(n, cmd.args[1][0].type);
-				vtype = cmd.args[0][0].type;
-				proceed = true;
-			}
+				local = emit_loop_local(cmd, com_type);
+				vals[key] = local;
 
-			if(proceed)
-			{
-				if(vtype == B1Types::B1T_LONG)
-				{
-					min = INT32_MIN;
-					max = INT32_MAX;
-				}
-				else
-				if(vtype == B1Types::B1T_INT)
-				{
-					min = -32768;
-					max = 32767;
-				}
-				else
-				if(vtype == B1Types::B1T_WORD)
+				// local = local + increment * constant
+				int32_t inc;
+				eval_num_op(L'*', ivs[get_var(cmd.args[op])].second, n, inc);
+				Utils::correct_int_value(inc, com_type);
+
+				if(inc != 0)
 				{
-					min = 0;
-					max = 65535;
+					const auto iv_cmd = ivs[get_var(cmd.args[op])].first;
+					emit_command(L"+", std::next(iv_cmd), std::vector<B1_TYPED_VALUE>({ local, B1_TYPED_VALUE(std::to_wstring(inc), com_type), local }));
 				}
-				else
+			}
+		}
+		else
+		{
+			// loop-invariant value
+			if(dst[0].type == B1Types::B1T_STRING || !is_gen_local(dst[0].value) || cmd.cmd == L"^")
+			{
+				continue;
+			}
+
+			bool inv = true;
+			for(auto a = cmd.args.cbegin(); a != cmd.args.cend() - 1; a++)
+			{
+				if(!is_invariant(*a))
 				{
-					min = 0;
-					max = 255;
+					inv = false;
+					break;
 				}
+			}
 
-				if(n >= max)
-				{
-					if((!lnum && cmd.cmd == L">") || (lnum && cmd.cmd == L"<"))
-					{
-						remove_compare_op(i--, false);
-						changed = true;
-						continue;
-					}
+			// division by zero error should not be raised if the command is never executed
+			if(!inv || ((cmd.cmd == L"/" || cmd.cmd == L"%") && (!get_int(cmd.args[1], n) || n == 0)))
+			{
+				continue;
+			}
 
-					if((!lnum && cmd.cmd == L"<=") || (lnum && cmd.cmd == L">="))
-					{
-						remove_compare_op(i--, true);
-						changed = true;
-						continue;
-					}
+			const auto key = get_key(cmd, dst[0].type);
 
-					if((!lnum && cmd.cmd == L">=") || (lnum && cmd.cmd == L"<="))
-					{
-						if(n == max)
-						{
-							cmd.cmd = L"==";
-							i--;
-						}
-						else
-						{
-							remove_compare_op(i--, false);
-						}
-						
-						changed = true;
-						continue;
-					}
+			auto val = vals.find(key);
+			if(val != vals.end())
+			{
+				local = val->second;
+			}
+			else
+			{
+				local = emit_loop_local(cmd, dst[0].type);
+				vals[key] = local;
+			}
+		}
 
-					if((!lnum && cmd.cmd == L"<") || (lnum && cmd.cmd == L">"))
-					{
-						if(n == max)
-						{
-							cmd.cmd = L"<>";
-						}
-						else
-						{
-							remove_compare_op(i--, true);
-						}
+		cmd.set_cmd(L"=");
+		cmd.edit_args().erase(cmd.args.begin(), cmd.args.end() - 1);
+		cmd.edit_args().insert(cmd.args.begin(), B1_CMP_ARG(local.value, local.type));
+		changed = true;
+	}
 
-						changed = true;
-						continue;
-					}
-				}
+	return changed;
+}
 
-				if(n <= min)
-				{
-					if((!lnum && cmd.cmd == L">=") || (lnum && cmd.cmd == L"<="))
-					{
-						remove_compare_op(i--, true);
-						changed = true;
-						continue;
-					}
+B1C_T_ERROR B1FileCompiler::optimize_loops(bool &changed)
+{
+	changed = false;
 
-					if((!lnum && cmd.cmd == L"<") || (lnum && cmd.cmd == L">"))
-					{
-						remove_compare_op(i--, false);
-						changed = true;
-						continue;
-					}
+	// the code changes make the flow graph invalid, so the loops are processed one by one (inner loops first)
+	bool stop = false;
 
-					if((!lnum && cmd.cmd == L">") || (lnum && cmd.cmd == L"<"))
-					{
-						if(n == min)
-						{
-							cmd.cmd = L"<>";
-							i--;
-						}
-						else
-						{
-							remove_compare_op(i--, true);
-						}
-						
-						changed = true;
-						continue;
-					}
+	while(!stop)
+	{
+		stop = true;
 
-					if((!lnum && cmd.cmd == L"<=") || (lnum && cmd.cmd == L">="))
-					{
-						if(n == min)
-						{
-							cmd.cmd = L"==";
-							i--;
-						}
-						else
-						{
-							remove_compare_op(i--, false);
-						}
+		auto flow = get_flow();
+		flow.calc_loops();
 
-						changed = true;
-						continue;
-					}
-				}
+		for(const auto &loop: flow.get_loops())
+		{
+			if(optimize_loop(flow, loop))
+			{
+				changed = true;
+				stop = false;
+				break;
+			}
+		}
+	}
 
-				if(n > max)
-				{
-					if(cmd.cmd == L"==" || cmd.cmd == L"<>")
-					{
-						remove_compare_op(i--, cmd.cmd == L"<>");
-						changed = true;
-						continue;
-					}
-				}
+	return B1C_T_ERROR::B1C_RES_OK;
+}
 
-				if(n < min)
-				{
-					if(cmd.cmd == L"==" || cmd.cmd == L"<>")
-					{
-						remove_compare_op(i--, cmd.cmd == L"<>");
-						changed = true;
-						continue;
-					}
-				}
+// removes local variable if it is not used or used to pass a value from one command to another
+// la and lf - LA and LF commands, rd and wr - commands that read and write the variable
+bool B1FileCompiler::remove_local(iterator la, iterator lf, std::vector<iterator> &rd, std::vector<iterator> &wr)
+{
+	const auto vname = la->args[0][0].value;
+	// indexes of commands to remove
+	std::vector<iterator> rem;
+	const B1_CMP_ARG *rd_arg = nullptr;
+	const B1_CMP_ARG *wr_arg = nullptr;
+
+	// LA,local
+	// =,X,local
+	// LF,local   ->  remove all commands
+	// or
+	// LA,local
+	// +,A,B,C
+	// LF,local   ->  remove LA and LF
+	if(rd.size() == 0)
+	{
+		bool remove_local = true;
+
+		for(auto &w: wr)
+		{
+			if(is_volatile_used(*w))
+			{
+				remove_local = false;
+			}
+			else
+			{
+				rem.push_back(w);
 			}
 		}
+		wr.clear();
+
+		if(remove_local)
+		{
+			rem.push_back(la);
+			rem.push_back(lf);
+		}
+	}
+	else
+	// LA,local
+	// +,A,B,local
+	// =,local,A    ->  +,A,B,A
+	// LF,local
+	if(rd.size() == 1 && wr.size() == 1 && (*rd.begin())->cmd == L"=" && la == std::prev(*wr.begin()) && la == std::prev(std::prev(*rd.begin())) && la == std::prev(std::prev(std::prev(lf))))
+	{
+		wr_arg = &(*rd.begin())->args[1];
+		rem.push_back(*rd.begin());
+		rd.clear();
+		rem.push_back(la);
+		rem.push_back(lf);
+	}
+	else
+	// LA,local
+	// =,X,local
+	// +,local,X,Y    ->  +,X,X,Y
+	// LF,local
+	if(rd.size() == 1 && wr.size() == 1 && (*wr.begin())->cmd == L"=" && la == std::prev(*wr.begin()) && la == std::prev(std::prev(*rd.begin())) && la == std::prev(std::prev(std::prev(lf))))
+	{
+		rd_arg = &(*wr.begin())->args[0];
+		rem.push_back(*wr.begin());
+		wr.clear();
+		rem.push_back(la);
+		rem.push_back(lf);
+	}
+
+	if(wr_arg != nullptr)
+	{
+		for(auto &w: wr)
+		{
+			B1CUtils::replace_dst(*w, vname, (*wr_arg));
+		}
 	}
 
-	// optimize comparison with zero value
-	for(auto i = begin(); i != end(); i++)
+	if(rd_arg != nullptr)
+	{
+		for(auto &r: rd)
+		{
+			B1CUtils::replace_src(*r, vname, (*rd_arg));
+		}
+	}
+
+	for(const auto &r: rem)
+	{
+		erase(r);
+	}
+
+	return rem.size() != 0;
+}
+
+B1C_T_ERROR B1FileCompiler::remove_locals(bool &changed)
+{
+	changed = false;
+
+	auto flow = get_flow();
+	B1_CMP_USE_DEF ud;
+
+	// local variables allocated at the current position, the columns are:
+	// LA command, commands that read the variable, commands that write it,
+	// the variable is used as array subscript or function argument, the variable commands are changed
+	std::map<int, std::tuple<iterator, std::vector<iterator>, std::vector<iterator>, bool, bool>> locals;
+
+	for(auto i = begin(); i != end(); )
 	{
+		auto next = std::next(i);
 		auto &cmd = *i;
 
 		if(B1CUtils::is_label(cmd))
 		{
+			i = next;
 			continue;
 		}
 
-		if(B1CUtils::is_log_op(cmd))
+		if(cmd.cmd == L"LA")
 		{
-			int32_t n;
+			locals[flow.get_var_index(cmd.args[0][0].value)] = std::make_tuple(i, std::vector<iterator>(), std::vector<iterator>(), false, false);
+			i = next;
+			continue;
+		}
 
-			if((cmd.args[0][0].type == B1Types::B1T_BYTE || cmd.args[0][0].type == B1Types::B1T_WORD) && 
-				cmd.args[1].size() == 1 && B1CUtils::is_num_val(cmd.args[1][0].value) && Utils::str2int32(cmd.args[1][0].value, n) == B1_RES_OK && n == 0)
+		if(cmd.cmd == L"LF")
+		{
+			auto l = locals.find(flow.get_var_index(cmd.args[0][0].value));
+			if(l != locals.end())
 			{
-				if(cmd.cmd == L">")
-				{
-					cmd.cmd = L"<>";
-					changed = true;
-					continue;
-				}
-				else
-				if(cmd.cmd == L"<=")
+				auto &lcl = l->second;
+
+				if(!std::get<3>(lcl) && !std::get<4>(lcl) && remove_local(std::get<0>(lcl), i, std::get<1>(lcl), std::get<2>(lcl)))
 				{
-					cmd.cmd = L"==";
+					// commands of the enclosing locals can be changed or removed, process them next time
+					for(auto &ol: locals)
+					{
+						std::get<1>(ol.second).clear();
+						std::get<2>(ol.second).clear();
+						std::get<4>(ol.second) = true;
+					}
+
 					changed = true;
-					continue;
 				}
+
+				locals.erase(l);
 			}
-			else
-			if((cmd.args[1][0].type == B1Types::B1T_BYTE || cmd.args[1][0].type == B1Types::B1T_WORD) && 
-				cmd.args[0].size() == 1 && B1CUtils::is_num_val(cmd.args[0][0].value) && Utils::str2int32(cmd.args[0][0].value, n) == B1_RES_OK && n == 0)
-			{
-				if(cmd.cmd == L"<=" || cmd.cmd == L">=")
-				{
-					cmd.cmd = L"==";
-					changed = true;
-					continue;
-				}
+
+			i = next;
+			continue;
+		}
+
+		if(locals.empty())
+		{
+			i = next;
+			continue;
+		}
+
+		if(B1CUtils::is_inline_asm(cmd))
+		{
+			for(auto &ol: locals)
+			{
+				std::get<3>(ol.second) = true;
 			}
-		}
-	}
 
-	return B1C_T_ERROR::B1C_RES_OK;
-}
+			i = next;
+			continue;
+		}
 
-// does not take into account value type, just changes its sign
-// -,<imm_val>,var  ->  =,-<imm_val>,var
-B1C_T_ERROR B1FileCompiler::replace_unary_minus(bool &changed)
-{
-	changed = false;
+		flow.get_use_def(cmd, ud);
 
-	for(auto &cmd: *this)
-	{
-		if(B1CUtils::is_label(cmd))
+		for(const auto v: ud.sub)
 		{
-			continue;
+			auto l = locals.find(v);
+			if(l != locals.end())
+			{
+				std::get<3>(l->second) = true;
+			}
 		}
 
-		// get rid from unary minus
-		// -,10,A  ->  =,-10,A
-		if(cmd.cmd == L"-" && cmd.args.size() == 2 && B1CUtils::is_num_val(cmd.args[0][0].value))
+		for(const auto v: ud.mod)
 		{
-			cmd.cmd = L"=";
-			if(cmd.args[0][0].value.find(L"-") == 0)
+			auto l = locals.find(v);
+			if(l != locals.end())
 			{
-				cmd.args[0][0].value.erase(0, 1);
+				std::get<3>(l->second) = true;
 			}
-			else
+		}
+
+		for(const auto v: ud.use)
+		{
+			auto l = locals.find(v);
+			if(l != locals.end() && !std::get<4>(l->second) && (std::get<1>(l->second).empty() || std::get<1>(l->second).back() != i))
 			{
-				cmd.args[0][0].value.insert(0, L"-");
+				std::get<1>(l->second).push_back(i);
 			}
+		}
 
-			changed = true;
+		for(const auto v: ud.def)
+		{
+			auto l = locals.find(v);
+			if(l != locals.end() && !std::get<4>(l->second) && (std::get<2>(l->second).empty() || std::get<2>(l->second).back() != i))
+			{
+				std::get<2>(l->second).push_back(i);
+			}
 		}
+
+		i = next;
 	}
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-// -,<imm_val>,var  ->  =,-<imm_val>,var
-B1C_T_ERROR B1FileCompiler::eval_unary_ops(bool &changed)
+B1_T_ERROR B1FileCompiler::get_type(B1_TYPED_VALUE &v, bool read, std::map<std::wstring, std::vector<std::pair<B1Types &, B1Types>>> &iif_locals)
 {
-	changed = false;
+	if(v.value.empty())
+	{
+		// omitted function argument
+		return B1_RES_OK;
+	}
 
-	for(auto &cmd: *this)
+	if(B1CUtils::is_num_val(v.value))
 	{
-		if(B1CUtils::is_label(cmd))
+		// num. value
+		std::wstring mod_val = v.value;
+		auto err = B1CUtils::get_num_min_type(v.value, v.type, mod_val);
+		v.value = mod_val;
+		return err;
+	}
+
+	if(B1CUtils::is_str_val(v.value))
+	{
+		// string value
+		v.type = B1Types::B1T_STRING;
+		return B1_RES_OK;
+	}
+
+	// skip function arguments
+	if(B1CUtils::is_fn_arg(v.value))
+	{
+		return B1_RES_OK;
+	}
+
+	if(is_gen_local(v.value))
+	{
+		// local variable
+		auto vt = _vars.find(v.value);
+
+		if(vt != _vars.end())
 		{
-			continue;
+			v.type = std::get<0>(vt->second);
 		}
-
-		// get rid from unary minus and NOT operations
-		// -,10,A  ->  =,-10,A
-		if((cmd.cmd == L"-" || cmd.cmd == L"!") && cmd.args.size() == 2 && B1CUtils::is_num_val(cmd.args[0][0].value))
+		else
 		{
-			if(cmd.cmd == L"-")
+			if((v.type == B1Types::B1T_UNKNOWN || v.type == B1Types::B1T_COMMON) && read)
 			{
-				// if type is absent just change the sign
-				if(cmd.args[0][0].type == B1Types::B1T_UNKNOWN)
+				// get common type for local variable of IIF pseudo-function
+				auto il = iif_locals.find(v.value);
+				if(il == iif_locals.end() || il->second.size() != 2)
 				{
-					cmd.cmd = L"=";
-					if(cmd.args[0][0].value.find(L"-") == 0)
-					{
-						cmd.args[0][0].value.erase(0, 1);
-					}
-					else
-					{
-						cmd.args[0][0].value.insert(0, L"-");
-					}
+					return B1_RES_ETYPMISM;
 				}
-				// if value type is present process the value as numeric
-				else
+
+				bool comp = false;
+				B1Types com_type = B1Types::B1T_UNKNOWN;
+				auto err = B1CUtils::get_com_type(il->second[0].second, il->second[1].second, com_type, comp);
+				if(err != B1_RES_OK)
 				{
-					int32_t n;
+					return err;
+				}
 
-					auto err = Utils::str2int32(cmd.args[0][0].value, n);
-					if(err != B1_RES_OK)
-					{
-						return static_cast<B1C_T_ERROR>(err);
-					}
+				il->second[0].first = com_type;
+				il->second[1].first = com_type;
+				v.type = com_type;
 
-					Utils::correct_int_value(n, cmd.args[0][0].type);
-					n = -n;
-					Utils::correct_int_value(n, cmd.args[0][0].type);
+				_vars[v.value] = std::make_tuple(com_type, 0, false, false, false, false);
 
-					cmd.cmd = L"=";
-					cmd.args[0][0].value = std::to_wstring(n);
-				}
+				iif_locals.erase(il);
 			}
 			else
+			if(v.type == B1Types::B1T_UNKNOWN || v.type == B1Types::B1T_COMMON)
 			{
-				// evaluate binary NOT only if value type is specified
-				if(cmd.args[0][0].type == B1Types::B1T_UNKNOWN)
-				{
-					continue;
-				}
-
-				int32_t n;
+				return B1_RES_ETYPMISM;
+			}
+			else
+			{
+				// internal variable of IIF$ pseudo-function
+				_vars[v.value] = std::make_tuple(v.type, 0, false, false, false, false);
+			}
+		}
 
-				auto err = Utils::str2int32(cmd.args[0][0].value, n);
-				if(err != B1_RES_OK)
-				{
-					return static_cast<B1C_T_ERROR>(err);
-				}
+		return B1_RES_OK;
+	}
 
-				Utils::correct_int_value(n, cmd.args[0][0].type);
-				n = ~n;
-				Utils::correct_int_value(n, cmd.args[0][0].type);
+	if(Utils::check_const_name(v.value))
+	{
+		v.type = Utils::get_const_type(v.value);
+		return B1_RES_OK;
+	}
 
-				cmd.cmd = L"=";
-				cmd.args[0][0].value = std::to_wstring(n);
-			}
+	auto fn = get_fn(v);
+	if(fn != nullptr)
+	{
+		// function with zero arguments
+		v.type = fn->rettype;
+		return B1_RES_OK;
+	}
 
-			changed = true;
-		}
+	// simple variable
+	if(v.type != B1Types::B1T_VARREF)
+	{
+		_compiler.mark_var_used(v.value, read);
 	}
 
-	return B1C_T_ERROR::B1C_RES_OK;
-}
+	// check current file variables
+	auto vt = _vars.find(v.value);
 
-void B1FileCompiler::set_to_init_value_arg(B1_CMP_ARG &arg, bool is_dst, const std::map<std::wstring, std::pair<bool, std::wstring>> &vars, bool init, bool &changed)
-{
-	for(auto aa = arg.begin(); aa != arg.end(); aa++)
+	if(vt != _vars.end())
 	{
-		// do not process subscripted variables
-		if(aa == arg.begin() && (is_dst || arg.size() > 1))
-		{
-			continue;
-		}
-
-		if(is_volatile_var(aa->value))
+		if(v.type != B1Types::B1T_VARREF)
 		{
-			continue;
+			if(std::get<1>(vt->second) != 0)
+			{
+				return B1_RES_ETYPMISM;
+			}
+			v.type = std::get<0>(vt->second);
 		}
 
-		auto v = vars.find(aa->value);
-		if(init)
+		if(std::get<5>(vt->second))
 		{
-			if(v != vars.end())
+			if(v.type == B1Types::B1T_VARREF)
 			{
-				if(v->second.first)
+				if(std::get<1>(vt->second) == 0)
 				{
-					if(aa->type == B1Types::B1T_STRING && v->second.second.front() != L'\"')
-					{
-						aa->value = L"\"" + v->second.second + L"\"";
-					}
-					else
-					{
-						aa->value = v->second.second;
-					}
-					changed = true;
+					return B1_RES_ETYPMISM;
 				}
 			}
 			else
 			{
-				auto type = get_var_type(aa->value);
-				if(type != B1Types::B1T_UNKNOWN && !is_mem_var_name(aa->value))
-				{
-					aa->value = (type == B1Types::B1T_STRING) ? L"\"\"" : L"0";
-					changed = true;
-				}
+				// replace scalar const variable with its value
+				v.value = _const_init.find(v.value)->second.second[0];
 			}
 		}
-		else
+
+		return B1_RES_OK;
+	}
+
+	// check global variables
+	vt = _compiler._global_vars.find(v.value);
+
+	if(vt != _compiler._global_vars.end())
+	{
+		if(v.type != B1Types::B1T_VARREF)
 		{
-			if(v != vars.end())
+			if(std::get<1>(vt->second) != 0)
 			{
-				if(v->second.first)
+				return B1_RES_ETYPMISM;
+			}
+			v.type = std::get<0>(vt->second);
+		}
+
+		if(std::get<5>(vt->second))
+		{
+			if(v.type == B1Types::B1T_VARREF)
+			{
+				if(std::get<1>(vt->second) == 0)
 				{
-					if(aa->type == B1Types::B1T_STRING && v->second.second.front() != L'\"')
-					{
-						aa->value = L"\"" + v->second.second + L"\"";
-					}
-					else
-					{
-						aa->value = v->second.second;
-					}
-					changed = true;
+					return B1_RES_ETYPMISM;
 				}
 			}
+			else
+			{
+				// replace scalar const variable with its value
+				v.value = _compiler._global_const_init.find(v.value)->second.second[0];
+			}
 		}
-	}
-}
 
-// replaces variables not in vars set with their initial values
-std::wstring B1FileCompiler::set_to_init_value(B1_CMP_CMD &cmd, const std::map<std::wstring, std::pair<bool, std::wstring>> &vars, bool init, bool &changed)
-{
-	if(B1CUtils::is_label(cmd))
-	{
-		return L"";
-	}
-
-	if(B1CUtils::is_inline_asm(cmd))
-	{
-		return L"";
+		return B1_RES_OK;
 	}
 
-	if(cmd.cmd == L"GA" || cmd.cmd == L"MA")
+	if(v.type != B1Types::B1T_VARREF)
 	{
-		for(auto a = cmd.args.begin() + (cmd.cmd == L"GA" ? 2 : 3); a != cmd.args.end(); a++)
+		v.type = Utils::get_type_by_type_spec(v.value, B1Types::B1T_UNKNOWN);
+		if(v.type == B1Types::B1T_UNKNOWN)
 		{
-			set_to_init_value_arg(*a, false, vars, init, changed);
+			return B1_RES_ETYPMISM;
 		}
 
-		return L"";
+		_vars[v.value] = std::make_tuple(v.type, 0, false, false, false, false);
 	}
 
-	if(cmd.cmd == L"RETVAL")
+	return B1_RES_OK;
+}
+
+B1_T_ERROR B1FileCompiler::get_type(B1_CMP_ARG &a, bool read, std::map<std::wstring, std::vector<std::pair<B1Types &, B1Types>>> &iif_locals)
+{
+	if(a.size() == 1)
 	{
-		set_to_init_value_arg(cmd.args[0], false, vars, init, changed);
-		return L"";
+		return get_type(a[0], read, iif_locals);
 	}
 
-	if(cmd.cmd == L"IN" || cmd.cmd == L"READ")
+	if(Utils::check_const_name(a[0].value))
 	{
-		set_to_init_value_arg(cmd.args[1], true, vars, init, changed);
-		if(cmd.args[1].size() == 1)
-		{
-			return cmd.args[1][0].value;
-		}
-		return L"";
+		return B1_RES_ESYNTAX;
 	}
 
-	if(cmd.cmd == L"OUT" || cmd.cmd == L"SET")
+	// process arguments first
+	for(auto aa = a.begin() + 1; aa != a.end(); aa++)
 	{
-		set_to_init_value_arg(cmd.args[1], false, vars, init, changed);
-		return L"";
+		auto err = get_type(*aa, true, iif_locals);
+		if(err != B1_RES_OK)
+		{
+			return err;
+		}
 	}
 
-	if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
+	if(a[0].value == L"IOCTL" || a[0].value == L"IOCTL$")
 	{
-		bool is_dst = (cmd.cmd != L"PUT");
-		set_to_init_value_arg(cmd.args[1], is_dst, vars, init, changed);
-		if(cmd.args.size() != 2)
+		auto dev_name = a[1].value;
+		dev_name.pop_back();
+		dev_name.erase(0, 1);
+		auto cmd_name = a[2].value;
+		cmd_name.pop_back();
+		cmd_name.erase(0, 1);
+		dev_name = _global_settings.GetIoDeviceName(dev_name);
+		Settings::IoCmd cmd;
+		if(!_global_settings.GetIoCmd(dev_name, cmd_name, cmd))
 		{
-			set_to_init_value_arg(cmd.args[2], false, vars, init, changed);
+			return B1_RES_EINVARG;
 		}
 
-		if(is_dst && cmd.args[1].size() == 1)
+		if(cmd.ret_type == B1Types::B1T_UNKNOWN)
 		{
-			return cmd.args[1][0].value;
+			return B1_RES_ESYNTAX;
 		}
 
-		return L"";
+		a[0].type = cmd.ret_type;
+
+		return B1_RES_OK;
 	}
 
-	if(cmd.cmd == L"XARG")
+	auto fn = get_fn(a);
+	if(fn != nullptr)
 	{
-		set_to_init_value_arg(cmd.args[0], false, vars, init, changed);
-		return L"";
+		// function with some arguments
+		a[0].type = fn->rettype;
+		return B1_RES_OK;
 	}
 
-	if(cmd.cmd == L"IOCTL")
-	{
-		if(cmd.args.size() > 2 && cmd.args[2][0].type != B1Types::B1T_VARREF)
-		{
-			set_to_init_value_arg(cmd.args[2], false, vars, init, changed);
-		}
+	// subscripted variable
+	_compiler.mark_var_used(a[0].value, read);
 
-		return L"";
-	}
+	// check current file variables
+	auto vt = _vars.find(a[0].value);
 
-	if(B1CUtils::is_un_op(cmd))
+	if(vt != _vars.end())
 	{
-		set_to_init_value_arg(cmd.args[0], false, vars, init, changed);
-		set_to_init_value_arg(cmd.args[1], true, vars, init, changed);
-		if(cmd.args[1].size() == 1)
+		if(std::get<1>(vt->second) != a.size() - 1)
 		{
-			return cmd.args[1][0].value;
+			return B1_RES_ETYPMISM;
 		}
-		return L"";
+		a[0].type = std::get<0>(vt->second);
+		return B1_RES_OK;
 	}
 
-	if(B1CUtils::is_bin_op(cmd))
+	// check global variables
+	vt = _compiler._global_vars.find(a[0].value);
+
+	if(vt != _compiler._global_vars.end())
 	{
-		set_to_init_value_arg(cmd.args[0], false, vars, init, changed);
-		set_to_init_value_arg(cmd.args[1], false, vars, init, changed);
-		set_to_init_value_arg(cmd.args[2], true, vars, init, changed);
-		if(cmd.args[2].size() == 1)
+		if(std::get<1>(vt->second) != a.size() - 1)
 		{
-			return cmd.args[2][0].value;
+			return B1_RES_ETYPMISM;
 		}
-		return L"";
+		a[0].type = std::get<0>(vt->second);
+		return B1_RES_OK;
 	}
 
-	if(B1CUtils::is_log_op(cmd))
+
+	a[0].type = Utils::get_type_by_type_spec(a[0].value, B1Types::B1T_UNKNOWN);
+	if(a[0].type == B1Types::B1T_UNKNOWN)
 	{
-		set_to_init_value_arg(cmd.args[0], false, vars, init, changed);
-		set_to_init_value_arg(cmd.args[1], false, vars, init, changed);
-		return L"";
+		return B1_RES_ETYPMISM;
 	}
 
-	return L"";
+	_vars[a[0].value] = std::make_tuple(a[0].type, (int)a.size() - 1, false, false, false, false);
+
+	return B1_RES_OK;
 }
 
-// remove excessive GA, GF and =,0,<var>
-B1C_T_ERROR B1FileCompiler::reuse_imm_values(bool init, bool &changed)
+B1C_T_ERROR B1FileCompiler::put_types()
 {
-	std::map<std::wstring, std::pair<bool, std::wstring>> modified_vars;
-
-	changed = false;
+	B1_T_ERROR err;
+	std::map<std::wstring, std::vector<std::pair<B1Types &, B1Types>>> iif_locals;
 
-	auto i = begin();
-	while(i != end())
+	// set types
+	for(auto &cmd: *this)
 	{
-		auto &cmd = *i;
+		// restore code line identification values (to display error position properly)
+		_curr_line_cnt = cmd.line_cnt;
+		_curr_line_num = cmd.line_num;
+		_curr_src_line_id = cmd.src_line_id;
 
-		if(B1CUtils::is_label(cmd) || cmd.cmd == L"CALL" || cmd.cmd == L"END" || cmd.cmd == L"RET" || cmd.cmd == L"INT")
+		if(B1CUtils::is_label(cmd))
 		{
-			modified_vars.clear();
-			init = false;
-
-			i++;
 			continue;
 		}
 
-		if((cmd.cmd == L"GA" || cmd.cmd == L"GF") && !is_volatile_var(cmd.args[0][0].value) && !is_mem_var_name(cmd.args[0][0].value) && get_var_dim(cmd.args[0][0].value) == 0)
+		if(	cmd.cmd == L"GF" || cmd.cmd == L"LA" || cmd.cmd == L"LF" || cmd.cmd == L"NS" ||
+			cmd.cmd == L"CALL" || cmd.cmd == L"JMP" || cmd.cmd == L"JF" || cmd.cmd == L"JT" ||
+			cmd.cmd == L"END" || cmd.cmd == L"RET" || cmd.cmd == L"DAT" || cmd.cmd == L"RST" ||
+			cmd.cmd == L"ERR" || cmd.cmd == L"DEF" || cmd.cmd == L"INT")
 		{
-			auto type = get_var_type(cmd.args[0][0].value);
+			continue;
+		}
 
-			if(is_const_var(cmd.args[0][0].value))
-			{
-				if(cmd.cmd == L"GF")
-				{
-					return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
-				}
-			}
-			else
-			if(init)
+		if(B1CUtils::is_log_op(cmd))
+		{
+			err = get_type(cmd.edit_args()[0], true, iif_locals);
+			if(err != B1_RES_OK)
 			{
-				if(modified_vars.find(cmd.args[0][0].value) == modified_vars.end())
-				{
-					erase(i++);
-					changed = true;
-					continue;
-				}
-				else
-				{
-					modified_vars[cmd.args[0][0].value] = std::make_pair(true, type == B1Types::B1T_STRING ? L"\"\"" : L"0");
-				}
+				return static_cast<B1C_T_ERROR>(err);
 			}
-			else
+			err = get_type(cmd.edit_args()[1], true, iif_locals);
+			if(err != B1_RES_OK)
 			{
-				if(modified_vars.find(cmd.args[0][0].value) == modified_vars.end())
-				{
-					modified_vars[cmd.args[0][0].value] = std::make_pair(true, type == B1Types::B1T_STRING ? L"\"\"" : L"0");
-				}
-				else
-				{
-					if(modified_vars[cmd.args[0][0].value].second == (type == B1Types::B1T_STRING ? L"\"\"" : L"0"))
-					{
-						erase(i++);
-						changed = true;
-						continue;
-					}
-					else
-					{
-						modified_vars[cmd.args[0][0].value] = std::make_pair(true, type == B1Types::B1T_STRING ? L"\"\"" : L"0");
-					}
-				}
+				return static_cast<B1C_T_ERROR>(err);
 			}
-
-			i++;
-			continue;
 		}
-
-		auto dstvar = set_to_init_value(cmd, modified_vars, init, changed);
-
-		if(	cmd.cmd == L"=" &&
-			(is_gen_local(cmd.args[1][0].value) || (!is_volatile_var(cmd.args[1][0].value) && cmd.args[1].size() == 1 && !is_mem_var_name(cmd.args[1][0].value)))
-			)
+		else
+		if(B1CUtils::is_un_op(cmd))
 		{
-			dstvar.clear();
+			err = get_type(cmd.edit_args()[0], true, iif_locals);
+			if(err != B1_RES_OK)
+			{
+				return static_cast<B1C_T_ERROR>(err);
+			}
 
-			if(B1CUtils::is_imm_val(cmd.args[0][0].value))
+			err = get_type(cmd.edit_args()[1], false, iif_locals);
+			if(err != B1_RES_OK)
 			{
-				auto mv = modified_vars.find(cmd.args[1][0].value);
-				if(mv == modified_vars.end())
+				if(err == B1_RES_ETYPMISM && is_gen_local(cmd.args[1][0].value))
 				{
-					auto type = is_gen_local(cmd.args[1][0].value) ? B1Types::B1T_UNKNOWN : get_var_type(cmd.args[1][0].value);
-					if(init && type != B1Types::B1T_UNKNOWN && ((type == B1Types::B1T_STRING && cmd.args[0][0].value == L"\"\"") || type != B1Types::B1T_STRING && cmd.args[0][0].value == L"0"))
+					if(cmd.args[1][0].type == B1Types::B1T_COMMON)
 					{
-						erase(i++);
-						changed = true;
-						continue;
-					}
+						// local variable of IIF pseudo-function
+						if(cmd.args[0][0].type == B1Types::B1T_STRING)
+						{
+							// IIF cannot return strings
+							return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
+						}
 
-					modified_vars[cmd.args[1][0].value] = std::make_pair(true, cmd.args[0][0].value);
-				}
-				else
-				{
-					if(mv->second.first == true && mv->second.second == cmd.args[0][0].value)
-					{
-						erase(i++);
-						changed = true;
-						continue;
+						iif_locals[cmd.args[1][0].value].push_back(std::make_pair(std::ref(cmd.edit_args()[1][0].type), cmd.args[0][0].type));
 					}
 					else
 					{
-						modified_vars[cmd.args[1][0].value] = std::make_pair(true, cmd.args[0][0].value);
+						cmd.edit_args()[1][0].type = cmd.args[0][0].type;
+						_vars[cmd.args[1][0].value] = std::make_tuple(cmd.args[0][0].type, 0, false, false, false, false);
 					}
-				}
-			}
-			else
-			{
-				modified_vars[cmd.args[1][0].value] = std::make_pair(false, L"");
-			}
-		}
-
-		if(!dstvar.empty())
-		{
-			modified_vars[dstvar] = std::make_pair(false, L"");
-		}
-
-		if(is_udef_used(cmd))
-		{
-			modified_vars.clear();
-			init = false;
-		}
-
-		i++;
-	}
-
-	return B1C_T_ERROR::B1C_RES_OK;
-}
-
-B1C_T_ERROR B1FileCompiler::remove_locals(bool &changed)
-{
-	changed = false;
-
-	for(auto i = begin(); i != end(); i++)
-	{
-		auto &cmd = *i;
-
-		if(B1CUtils::is_label(cmd))
-		{
-			continue;
-		}
-
-		if(cmd.cmd == L"LA")
-		{
-			auto la = i;
-			const auto &vname = cmd.args[0][0].value;
-			// indexes of commands that read and write the variable
-			std::vector<iterator> rd, wr;
-			// if the variable is used as array subscript or function argument
-			bool sub_or_arg = false;
-
-			for(i++; i != end(); i++)
-			{
-				auto &cmd1 = *i;
-
-				if(B1CUtils::is_label(cmd1))
-				{
 					continue;
 				}
 
-				if(cmd1.cmd == L"LF" && cmd1.args[0][0].value == vname)
-				{
-					if(!sub_or_arg)
-					{
-						// indexes of commands to remove
-						std::vector<iterator> rem;
-						const B1_CMP_ARG *rd_arg = nullptr;
-						const B1_CMP_ARG *wr_arg = nullptr;
-
-						// LA,local
-						// =,X,local
-						// LF,local   ->  remove all commands
-						// or
-						// LA,local
-						// +,A,B,C
-						// LF,local   ->  remove LA and LF
-						if(rd.size() == 0)
-						{
-							bool remove_local = true;
-
-							for(auto &w: wr)
-							{
-								if(is_volatile_used(*w))
-								{
-									remove_local = false;
-								}
-								else
-								{
-									rem.push_back(w);
-								}
-							}
-							wr.clear();
-
-							if(remove_local)
-							{
-								rem.push_back(la);
-								rem.push_back(i);
-							}
-						}
-						else
-						// LA,local
-						// +,A,B,local
-						// =,local,A    ->  +,A,B,A
-						// LF,local
-						if(rd.size() == 1 && wr.size() == 1 && (*rd.begin())->cmd == L"=" && la == std::prev(*wr.begin()) && la == std::prev(std::prev(*rd.begin())) && la == std::prev(std::prev(std::prev(i))))
-						{
-							wr_arg = &(*rd.begin())->args[1];
-							rem.push_back(*rd.begin());
-							rd.clear();
-							rem.push_back(la);
-							rem.push_back(i);
-						}
-						else
-						// LA,local
-						// =,X,local
-						// +,local,X,Y    ->  +,X,X,Y
-						// LF,local
-						if(rd.size() == 1 && wr.size() == 1 && (*wr.begin())->cmd == L"=" && la == std::prev(*wr.begin()) && la == std::prev(std::prev(*rd.begin())) && la == std::prev(std::prev(std::prev(i))))
-						{
-							rd_arg = &(*wr.begin())->args[0];
-							rem.push_back(*wr.begin());
-							wr.clear();
-							rem.push_back(la);
-							rem.push_back(i);
-						}
+				return static_cast<B1C_T_ERROR>(err);
+			}
+		}
+		else
+		if(B1CUtils::is_bin_op(cmd))
+		{
+			err = get_type(cmd.edit_args()[0], true, iif_locals);
+			if(err != B1_RES_OK)
+			{
+				return static_cast<B1C_T_ERROR>(err);
+			}
 
-						if(wr_arg != nullptr)
-						{
-							for(auto &w: wr)
-							{
-								B1CUtils::replace_dst(*w, vname, (*wr_arg));
-							}
-						}
+			err = get_type(cmd.edit_args()[1], true, iif_locals);
+			if(err != B1_RES_OK)
+			{
+				return static_cast<B1C_T_ERROR>(err);
+			}
 
-						if(rd_arg != nullptr)
+			err = get_type(cmd.edit_args()[2], false, iif_locals);
+			if(err != B1_RES_OK)
+			{
+				if(err == B1_RES_ETYPMISM && is_gen_local(cmd.args[2][0].value))
+				{
+					B1Types com_type = B1Types::B1T_UNKNOWN;
+					if(cmd.cmd == L"^")
+					{
+						com_type = cmd.args[0][0].type;
+						if(com_type == B1Types::B1T_UNKNOWN || com_type == B1Types::B1T_INVALID)
 						{
-							for(auto &r: rd)
-							{
-								B1CUtils::replace_src(*r, vname, (*rd_arg));
-							}
+							return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
 						}
-
-						if(rem.size() != 0)
+					}
+					else
+					{
+						bool comp = false;
+						err = B1CUtils::get_com_type(cmd.args[0][0].type, cmd.args[1][0].type, com_type, comp);
+						if(err != B1_RES_OK)
 						{
-							// remove local
-							i = std::prev(la);
-							for(const auto &r: rem)
-							{
-								erase(r);
-							}
-
-							changed = true;
+							return static_cast<B1C_T_ERROR>(err);
 						}
-						else
+					}
+
+					if(cmd.args[2][0].type == B1Types::B1T_COMMON)
+					{
+						// local variable of IIF pseudo-function
+						if(com_type == B1Types::B1T_STRING)
 						{
-							i = la;
+							// IIF cannot return strings
+							return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
 						}
+						iif_locals[cmd.args[2][0].value].push_back(std::make_pair(std::ref(cmd.edit_args()[2][0].type), com_type));
 					}
 					else
 					{
-						i = la;
+						cmd.edit_args()[2][0].type = com_type;
+						_vars[cmd.args[2][0].value] = std::make_tuple(com_type, 0, false, false, false, false);
 					}
+					continue;
+				}
 
-					break;
+				return static_cast<B1C_T_ERROR>(err);
+			}
+		}
+		else
+		{
+			// GET, PUT and TRR statements is a special case because of possible array range usage
+			if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
+			{
+				bool read = (cmd.cmd == L"PUT");
+
+				err = get_type(cmd.edit_args()[1], read, iif_locals);
+				if(err != B1_RES_OK)
+				{
+					return static_cast<B1C_T_ERROR>(err);
 				}
 
-				if(B1CUtils::is_src(cmd1, vname))
+				// forbid GET and TRR statements with string argument
+				if(!read && cmd.args[1][0].type == B1Types::B1T_STRING)
 				{
-					if(std::find(rd.begin(), rd.end(), i) == rd.end())
-					{
-						rd.push_back(i);
-					}
+					return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
 				}
 
-				if(B1CUtils::is_dst(cmd1, vname))
+				if(cmd.args.size() != 2)
 				{
-					if(std::find(wr.begin(), wr.end(), i) == wr.end())
+					err = get_type(cmd.edit_args()[2], true, iif_locals);
+					if(err != B1_RES_OK)
 					{
-						wr.push_back(i);
+						return static_cast<B1C_T_ERROR>(err);
 					}
 				}
 
-				if(B1CUtils::is_sub_or_arg(cmd1, vname))
-				{
-					sub_or_arg = true;
-				}
+				continue;
 			}
-		}
-	}
-
-	return B1C_T_ERROR::B1C_RES_OK;
-}
-
-B1_T_ERROR B1FileCompiler::get_type(B1_TYPED_VALUE &v, bool read, std::map<std::wstring, std::vector<std::pair<B1Types &, B1Types>>> &iif_locals)
-{
-	if(v.value.empty())
-	{
-		// omitted function argument
-		return B1_RES_OK;
-	}
-
-	if(B1CUtils::is_num_val(v.value))
-	{
-		// num. value
-		return B1CUtils::get_num_min_type(v.value, v.type, v.value);
-	}
-
-	if(B1CUtils::is_str_val(v.value))
-	{
-		// string value
-		v.type = B1Types::B1T_STRING;
-		return B1_RES_OK;
-	}
-
-	// skip function arguments
-	if(B1CUtils::is_fn_arg(v.value))
-	{
-		return B1_RES_OK;
-	}
 
-	if(is_gen_local(v.value))
-	{
-		// local variable
-		auto vt = _vars.find(v.value);
+			bool read = true;
+			if(cmd.cmd == L"IN" || cmd.cmd == L"READ")
+			{
+				read = false;
+			}
 
-		if(vt != _vars.end())
-		{
-			v.type = std::get<0>(vt->second);
-		}
-		else
-		{
-			if((v.type == B1Types::B1T_UNKNOWN || v.type == B1Types::B1T_COMMON) && read)
+			for(auto a = cmd.args.begin(); a != cmd.args.end(); a++)
 			{
-				// get common type for local variable of IIF pseudo-function
-				auto il = iif_locals.find(v.value);
-				if(il == iif_locals.end() || il->second.size() != 2)
+				if(cmd.cmd == L"GA" && a < cmd.args.begin() + 2)
 				{
-					return B1_RES_ETYPMISM;
+					continue;
+				}
+				if(cmd.cmd == L"MA" && a < cmd.args.begin() + 3)
+				{
+					continue;
+				}
+				if(cmd.cmd == L"RETVAL" && a != cmd.args.begin())
+				{
+					continue;
+				}
+				if(cmd.cmd == L"OUT" && a != cmd.args.begin() + 1)
+				{
+					continue;
+				}
+				if(cmd.cmd == L"IN" && a != cmd.args.begin() + 1)
+				{
+					continue;
+				}
+				if(cmd.cmd == L"SET" && a != cmd.args.begin() + 1)
+				{
+					continue;
+				}
+				if(cmd.cmd == L"IOCTL" && a != cmd.args.begin() + 2)
+				{
+					continue;
+				}
+				if(cmd.cmd == L"READ" && a == cmd.args.begin())
+				{
+					continue;
 				}
 
-				bool comp = false;
-				B1Types com_type = B1Types::B1T_UNKNOWN;
-				auto err = B1CUtils::get_com_type(il->second[0].second, il->second[1].second, com_type, comp);
+				err = get_type(cmd.edit_args()[a - cmd.args.begin()], read, iif_locals);
 				if(err != B1_RES_OK)
 				{
-					return err;
+					return static_cast<B1C_T_ERROR>(err);
 				}
-
-				il->second[0].first = com_type;
-				il->second[1].first = com_type;
-				v.type = com_type;
-
-				_vars[v.value] = std::make_tuple(com_type, 0, false, false, false, false);
-
-				iif_locals.erase(il);
-			}
-			else
-			if(v.type == B1Types::B1T_UNKNOWN || v.type == B1Types::B1T_COMMON)
-			{
-				return B1_RES_ETYPMISM;
-			}
-			else
-			{
-				// internal variable of IIF$ pseudo-function
-				_vars[v.value] = std::make_tuple(v.type, 0, false, false, false, false);
 			}
 		}
-
-		return B1_RES_OK;
-	}
-
-	if(Utils::check_const_name(v.value))
-	{
-		v.type = Utils::get_const_type(v.value);
-		return B1_RES_OK;
-	}
-
-	auto fn = get_fn(v);
-	if(fn != nullptr)
-	{
-		// function with zero arguments
-		v.type = fn->rettype;
-		return B1_RES_OK;
 	}
 
-	// simple variable
-	if(v.type != B1Types::B1T_VARREF)
+	// process LA stmts
+	for(auto i = begin(); i != end(); i++)
 	{
-		_compiler.mark_var_used(v.value, read);
-	}
-
-	// check current file variables
-	auto vt = _vars.find(v.value);
+		auto &cmd = *i;
 
-	if(vt != _vars.end())
-	{
-		if(v.type != B1Types::B1T_VARREF)
+		if(B1CUtils::is_label(cmd))
 		{
-			if(std::get<1>(vt->second) != 0)
-			{
-				return B1_RES_ETYPMISM;
-			}
-			v.type = std::get<0>(vt->second);
+			continue;
 		}
 
-		if(std::get<5>(vt->second))
+		if(cmd.cmd == L"LA")
 		{
-			if(v.type == B1Types::B1T_VARREF)
+			auto vt = _vars.find(cmd.args[0][0].value);
+
+			if(vt != _vars.end())
 			{
-				if(std::get<1>(vt->second) == 0)
-				{
-					return B1_RES_ETYPMISM;
-				}
+				cmd.edit_args()[1][0].value = Utils::get_type_name(std::get<0>(vt->second));
+				cmd.edit_args()[1][0].type = std::get<0>(vt->second);
 			}
 			else
 			{
-				// replace scalar const variable with its value
-				v.value = _const_init.find(v.value)->second.second[0];
+				for(auto i1 = std::next(i); i1 != end(); i1++)
+				{
+					if(i1->cmd == L"LF" && i1->args[0][0].value == cmd.args[0][0].value)
+					{
+						auto next = std::prev(i);
+						erase(i);
+						erase(i1);
+						i = next;
+						break;
+					}
+				}
+				continue;
 			}
 		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+B1C_T_ERROR B1FileCompiler::inline_fns(bool &changed)
+{
+	changed = false;
+
+	// remove unnecessary ASC, VAL, CHR$ and STR$ function calls
+	for(auto i = begin(); i != end(); i++)
+	{
+		auto &cmd = *i;
+
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
 
-		return B1_RES_OK;
-	}
-
-	// check global variables
-	vt = _compiler._global_vars.find(v.value);
+		_curr_line_num = cmd.line_num;
+		_curr_line_cnt = cmd.line_cnt;
+		_curr_src_line_id = cmd.src_line_id;
 
-	if(vt != _compiler._global_vars.end())
-	{
-		if(v.type != B1Types::B1T_VARREF)
+		for(auto ai = cmd.args.begin(); ai != cmd.args.end(); ai++)
 		{
-			if(std::get<1>(vt->second) != 0)
+			const auto &a = *ai;
+
+			if(a.size() == 2 && ((a[0].value == L"VAL" && a[1].type != B1Types::B1T_STRING) || (a[0].value == L"STR$" && a[1].type == B1Types::B1T_STRING)))
 			{
-				return B1_RES_ETYPMISM;
+				auto &ma = cmd.edit_args()[ai - cmd.args.begin()];
+				ma.erase(ma.begin());
+				changed = true;
 			}
-			v.type = std::get<0>(vt->second);
-		}
+			else
+			if(a.size() == 2 && a[1].type != B1Types::B1T_STRING && (a[0].value == L"CBYTE" || a[0].value == L"CINT" || a[0].value == L"CWRD" || a[0].value == L"CLNG") && B1CUtils::is_num_val(a[1].value))
+			{
+				auto &ma = cmd.edit_args()[ai - cmd.args.begin()];
+				auto type = ma[0].type;
+				int32_t n;
 
-		if(std::get<5>(vt->second))
-		{
-			if(v.type == B1Types::B1T_VARREF)
+				if(Utils::str2int32(ma[1].value, n) == B1_RES_OK)
+				{
+					Utils::correct_int_value(n, type);
+					ma[1].value = std::to_wstring(n);
+				}
+				ma.erase(ma.begin());
+				ma[0].type = type;
+
+				changed = true;
+			}
+			else
+			if(a.size() == 2 && a[0].value == L"CHR$" && B1CUtils::is_num_val(a[1].value))
 			{
-				if(std::get<1>(vt->second) == 0)
+				auto &ma = cmd.edit_args()[ai - cmd.args.begin()];
+				std::wstring res_str;
+
+				auto err = eval_chr(ma[1].value, ma[1].type, res_str);
+				ma[0].value = res_str;
+				if(err != B1_RES_OK)
 				{
-					return B1_RES_ETYPMISM;
+					return static_cast<B1C_T_ERROR>(err);
 				}
+
+				ma.erase(ma.begin() + 1);
+				changed = true;
 			}
 			else
+			if(a.size() == 2 && a[0].value == L"ASC" && B1CUtils::is_str_val(a[1].value))
 			{
-				// replace scalar const variable with its value
-				v.value = _compiler._global_const_init.find(v.value)->second.second[0];
+				std::wstring sval;
+				auto err = B1CUtils::get_string_data(a[1].value, sval);
+				if(err != B1_RES_OK)
+				{
+					return static_cast<B1C_T_ERROR>(err);
+				}
+				if(sval.empty())
+				{
+					return static_cast<B1C_T_ERROR>(B1_RES_EINVARG);
+				}
+
+				auto &ma = cmd.edit_args()[ai - cmd.args.begin()];
+				ma[0].value = std::to_wstring(sval.front());
+				ma.erase(ma.begin() + 1);
+				changed = true;
 			}
 		}
-
-		return B1_RES_OK;
 	}
 
-	if(v.type != B1Types::B1T_VARREF)
+	// inline ABS and SGN
+	for(auto i = begin(); i != end(); i++)
 	{
-		v.type = Utils::get_type_by_type_spec(v.value, B1Types::B1T_UNKNOWN);
-		if(v.type == B1Types::B1T_UNKNOWN)
+		auto &cmd = *i;
+
+		if(B1CUtils::is_label(cmd))
 		{
-			return B1_RES_ETYPMISM;
+			continue;
 		}
 
-		_vars[v.value] = std::make_tuple(v.type, 0, false, false, false, false);
-	}
-
-	return B1_RES_OK;
-}
+		_curr_line_num = cmd.line_num;
+		_curr_line_cnt = cmd.line_cnt;
+		_curr_src_line_id = cmd.src_line_id;
 
-B1_T_ERROR B1FileCompiler::get_type(B1_CMP_ARG &a, bool read, std::map<std::wstring, std::vector<std::pair<B1Types &, B1Types>>> &iif_locals)
-{
-	if(a.size() == 1)
-	{
-		return get_type(a[0], read, iif_locals);
-	}
+		for(int a = 0; a < cmd.args.size(); a++)
+		{
+			const auto &arg = cmd.args[a];
 
-	if(Utils::check_const_name(a[0].value))
-	{
-		return B1_RES_ESYNTAX;
-	}
+			if(arg.size() == 2 && arg[0].value == L"SGN")
+			{
+				const auto a1 = arg[1];
 
-	// process arguments first
-	for(auto aa = a.begin() + 1; aa != a.end(); aa++)
-	{
-		auto err = get_type(*aa, true, iif_locals);
-		if(err != B1_RES_OK)
-		{
-			return err;
-		}
-	}
+				auto ltype = arg[0].type;
+				auto local = emit_local(ltype, i);
 
-	if(a[0].value == L"IOCTL" || a[0].value == L"IOCTL$")
-	{
-		auto dev_name = a[1].value;
-		dev_name.pop_back();
-		dev_name.erase(0, 1);
-		auto cmd_name = a[2].value;
-		cmd_name.pop_back();
-		cmd_name.erase(0, 1);
-		dev_name = _global_settings.GetIoDeviceName(dev_name);
-		Settings::IoCmd cmd;
-		if(!_global_settings.GetIoCmd(dev_name, cmd_name, cmd))
-		{
-			return B1_RES_EINVARG;
-		}
+				// change original command
+				i->edit_args()[a][0].type = ltype;
+				i->edit_args()[a][0].value = local;
+				i->edit_args()[a].pop_back();
 
-		if(cmd.ret_type == B1Types::B1T_UNKNOWN)
-		{
-			return B1_RES_ESYNTAX;
-		}
+				emit_command(L"LF", std::next(i), local);
 
-		a[0].type = cmd.ret_type;
+				if(a1.type == B1Types::B1T_BYTE || a1.type == B1Types::B1T_WORD)
+				{
+					// =,SGN(A),B -> LA,local0
+					//               =,0,local0
+					//               ==,A,0
+					//               JT,label0
+					//               +,local0,1,local0
+					//               :label0
+					//               =,local0,B
+					//               LF,local0
+					emit_command(L"=", i, { B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE), B1_TYPED_VALUE(local, ltype) });
+					emit_command(L"==", i, { a1, B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE) });
+					auto label = emit_label(true);
+					emit_command(L"JT", i, label);
+					emit_command(L"=", i, { B1_TYPED_VALUE(L"1", B1Types::B1T_BYTE), B1_TYPED_VALUE(local, ltype) });
+					emit_label(label, i);
+				}
+				else
+				{
+					// =,SGN(A),B -> LA,local0
+					//               =,0,local0
+					//               ==,A,0
+					//               JT,label0
+					//               <,A,0
+					//               JT,label1
+					//               +,local0,2,local0
+					//               :label1
+					//               -,local0,1,local0
+					//               :label0
+					//               =,local0,B
+					//               LF,local0
+					emit_command(L"=", i, { B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE), B1_TYPED_VALUE(local, ltype) });
+					emit_command(L"==", i, { a1, B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE) });
+					auto label1 = emit_label(true);
+					auto label2 = emit_label(true);
+					emit_command(L"JT", i, label2);
+					emit_command(L"<", i, { a1, B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE) });
+					emit_command(L"JT", i, label1);
+					emit_command(L"=", i, { B1_TYPED_VALUE(L"2", B1Types::B1T_BYTE), B1_TYPED_VALUE(local, ltype) });
+					emit_label(label1, i);
+					emit_command(L"-", i, { B1_TYPED_VALUE(local, ltype), B1_TYPED_VALUE(L"1", B1Types::B1T_BYTE), B1_TYPED_VALUE(local, ltype) });
+					emit_label(label2, i);
+				}
 
-		return B1_RES_OK;
-	}
+				changed = true;
 
-	auto fn = get_fn(a);
-	if(fn != nullptr)
-	{
-		// function with some arguments
-		a[0].type = fn->rettype;
-		return B1_RES_OK;
-	}
+				i--;
+				break;
+			}
 
-	// subscripted variable
-	_compiler.mark_var_used(a[0].value, read);
+			if(arg.size() == 2 && arg[0].value == L"ABS")
+			{
+				const auto a1 = arg[1];
 
-	// check current file variables
-	auto vt = _vars.find(a[0].value);
+				if(a1.type == B1Types::B1T_BYTE || a1.type == B1Types::B1T_WORD)
+				{
+					// unsigned type: just remove ABS call
+					i->edit_args()[a][0].type = a1.type;
+					i->edit_args()[a][0].value = a1.value;
+					i->edit_args()[a].pop_back();
+				}
+				else
+				{
+					// =,ABS(A),B -> LA,local0
+					//               =,A,local0
+					//               <,local0,0
+					//               JF,label0
+					//               -,local0,local0
+					//               :label0
+					//               =,local0,B
+					//               LF,local0
+					auto local = emit_local(a1.type, i);
 
-	if(vt != _vars.end())
-	{
-		if(std::get<1>(vt->second) != a.size() - 1)
-		{
-			return B1_RES_ETYPMISM;
-		}
-		a[0].type = std::get<0>(vt->second);
-		return B1_RES_OK;
-	}
+					// change original command
+					i->edit_args()[a][0].type = a1.type;
+					i->edit_args()[a][0].value = local;
+					i->edit_args()[a].pop_back();
 
-	// check global variables
-	vt = _compiler._global_vars.find(a[0].value);
+					emit_command(L"LF", std::next(i), local);
 
-	if(vt != _compiler._global_vars.end())
-	{
-		if(std::get<1>(vt->second) != a.size() - 1)
-		{
-			return B1_RES_ETYPMISM;
-		}
-		a[0].type = std::get<0>(vt->second);
-		return B1_RES_OK;
-	}
+					emit_command(L"=", i, { a1, B1_TYPED_VALUE(local, a1.type) });
+					emit_command(L"<", i, { B1_TYPED_VALUE(local, a1.type), B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE) });
+					auto label = emit_label(true);
+					emit_command(L"JF", i, label);
+					emit_command(L"-", i, { B1_TYPED_VALUE(local, a1.type), B1_TYPED_VALUE(local, a1.type) });
+					emit_label(label, i);
+				}
 
+				changed = true;
 
-	a[0].type = Utils::get_type_by_type_spec(a[0].value, B1Types::B1T_UNKNOWN);
-	if(a[0].type == B1Types::B1T_UNKNOWN)
-	{
-		return B1_RES_ETYPMISM;
+				i--;
+				break;
+			}
+		}
 	}
 
-	_vars[a[0].value] = std::make_tuple(a[0].type, (int)a.size() - 1, false, false, false, false);
-
-	return B1_RES_OK;
+	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::put_types()
+// estimated code size (in bytes) and execution time (in cycles) of user-defined function call overhead (close to
+// the code generated by c1stm8): CALLR/RET instructions, pushing arguments (per 16-bit word) and freeing the stack
+#define B1C_UFN_CALL_SIZE 3
+#define B1C_UFN_CALL_CYCLES 4
+#define B1C_UFN_RET_SIZE 1
+#define B1C_UFN_RET_CYCLES 4
+#define B1C_UFN_ARG_SIZE 4
+#define B1C_UFN_ARG_CYCLES 3
+#define B1C_UFN_STK_FREE_SIZE 2
+#define B1C_UFN_STK_FREE_CYCLES 2
+// maximal code size growth (in bytes) allowed when inlining for speed (-O2): the limit applies to every user-defined
+// function separately and counts all its inlined calls in the file, so total file growth is up to 64 bytes per function
+#define B1C_UFN_MAX_GROWTH 64
+
+// inlines user-defined function calls if the cost model says it makes code smaller (or faster, depending on inlining mode):
+// =,FN(A,10),B -> LA,local0
+//                 <function body with __ARG_0 replaced with A and __ARG_1 replaced with 10, renamed labels and locals>
+//                 =,<function result>,local0
+//                 =,local0,B
+//                 LF,local0
+// the function body is removed if it is local and all its calls are inlined
+B1C_T_ERROR B1FileCompiler::inline_ufns(bool &changed)
 {
-	B1_T_ERROR err;
-	std::map<std::wstring, std::vector<std::pair<B1Types &, B1Types>>> iif_locals;
+	changed = false;
 
-	// set types
-	for(auto &cmd: *this)
-	{
-		// restore code line identification values (to display error position properly)
-		_curr_line_cnt = cmd.line_cnt;
-		_curr_line_num = cmd.line_num;
-		_curr_src_line_id = cmd.src_line_id;
+	// 16-bit words of a value
+	const auto get_words = [](B1Types type) -> int
+	{
+		int32_t size = 0;
+		return (B1CUtils::get_asm_type(type, nullptr, &size) && size > 2) ? 2 : 1;
+	};
+
+	// estimated size and execution time of the code generated for a command, known - locals with values known
+	// at compile time (commands that use only immediate values and known locals are evaluated by optimizer)
+	const auto get_cmd_cost = [this, &get_words](const B1_CMP_CMD &cmd, std::set<std::wstring> &known, bool &known_cond, int &size, int &cycles)
+	{
+		size = 0;
+		cycles = 0;
 
 		if(B1CUtils::is_label(cmd))
 		{
-			continue;
+			return;
 		}
 
-		if(	cmd.cmd == L"GF" || cmd.cmd == L"LA" || cmd.cmd == L"LF" || cmd.cmd == L"NS" ||
-			cmd.cmd == L"CALL" || cmd.cmd == L"JMP" || cmd.cmd == L"JF" || cmd.cmd == L"JT" ||
-			cmd.cmd == L"END" || cmd.cmd == L"RET" || cmd.cmd == L"DAT" || cmd.cmd == L"RST" ||
-			cmd.cmd == L"ERR" || cmd.cmd == L"DEF" || cmd.cmd == L"INT")
+		if(cmd.cmd == L"JMP")
 		{
-			continue;
+			size = 2;
+			cycles = 2;
+			return;
 		}
 
-		if(B1CUtils::is_log_op(cmd))
+		if(cmd.cmd == L"JT" || cmd.cmd == L"JF")
 		{
-			err = get_type(cmd.args[0], true, iif_locals);
-			if(err != B1_RES_OK)
-			{
-				return static_cast<B1C_T_ERROR>(err);
-			}
-			err = get_type(cmd.args[1], true, iif_locals);
-			if(err != B1_RES_OK)
+			if(!known_cond)
 			{
-				return static_cast<B1C_T_ERROR>(err);
+				size = 2;
+				cycles = 2;
 			}
+			known_cond = false;
+			return;
 		}
-		else
-		if(B1CUtils::is_un_op(cmd))
+
+		if(cmd.cmd == L"LA" || cmd.cmd == L"LF")
 		{
-			err = get_type(cmd.args[0], true, iif_locals);
-			if(err != B1_RES_OK)
+			size = 2;
+			cycles = 1;
+			return;
+		}
+
+		const bool is_op = B1CUtils::is_un_op(cmd) || B1CUtils::is_bin_op(cmd) || B1CUtils::is_log_op(cmd) || cmd.cmd == L"=";
+		const int src_num = (is_op && !B1CUtils::is_log_op(cmd)) ? (int)cmd.args.size() - 1 : (int)cmd.args.size();
+
+		bool all_known = is_op;
+		bool lib_call = (cmd.cmd == L"*" || cmd.cmd == L"/" || cmd.cmd == L"%" || cmd.cmd == L"^");
+		int words = 1;
+		int vals = 0;
+
+		for(int a = 0; a < (int)cmd.args.size(); a++)
+		{
+			if(cmd.cmd == L"RETVAL" && a > 0)
 			{
-				return static_cast<B1C_T_ERROR>(err);
+				break;
 			}
 
-			err = get_type(cmd.args[1], false, iif_locals);
-			if(err != B1_RES_OK)
+			const auto &arg = cmd.args[a];
+
+			for(const auto &tv: arg)
 			{
-				if(err == B1_RES_ETYPMISM && is_gen_local(cmd.args[1][0].value))
+				vals++;
+				words = std::max(words, get_words(tv.type));
+				if(tv.type == B1Types::B1T_STRING)
 				{
-					if(cmd.args[1][0].type == B1Types::B1T_COMMON)
-					{
-						// local variable of IIF pseudo-function
-						if(cmd.args[0][0].type == B1Types::B1T_STRING)
-						{
-							// IIF cannot return strings
-							return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
-						}
-
-						iif_locals[cmd.args[1][0].value].push_back(std::make_pair(std::ref(cmd.args[1][0].type), cmd.args[0][0].type));
-					}
-					else
-					{
-						cmd.args[1][0].type = cmd.args[0][0].type;
-						_vars[cmd.args[1][0].value] = std::make_tuple(cmd.args[0][0].type, 0, false, false, false, false);
-					}
-					continue;
+					lib_call = true;
 				}
+			}
 
-				return static_cast<B1C_T_ERROR>(err);
+			if(a < src_num && (arg.size() != 1 || !(B1CUtils::is_imm_val(arg[0].value) || known.find(arg[0].value.str()) != known.end())))
+			{
+				all_known = false;
 			}
 		}
-		else
-		if(B1CUtils::is_bin_op(cmd))
+
+		if(all_known)
 		{
-			err = get_type(cmd.args[0], true, iif_locals);
-			if(err != B1_RES_OK)
+			if(B1CUtils::is_log_op(cmd))
 			{
-				return static_cast<B1C_T_ERROR>(err);
+				known_cond = true;
+				return;
 			}
 
-			err = get_type(cmd.args[1], true, iif_locals);
-			if(err != B1_RES_OK)
+			if(is_gen_local(cmd.args.back()[0].value.str()))
 			{
-				return static_cast<B1C_T_ERROR>(err);
+				known.insert(cmd.args.back()[0].value.str());
+				return;
 			}
+		}
 
-			err = get_type(cmd.args[2], false, iif_locals);
-			if(err != B1_RES_OK)
-			{
-				if(err == B1_RES_ETYPMISM && is_gen_local(cmd.args[2][0].value))
-				{
-					B1Types com_type = B1Types::B1T_UNKNOWN;
-					if(cmd.cmd == L"^")
-					{
-						com_type = cmd.args[0][0].type;
-						if(com_type == B1Types::B1T_UNKNOWN || com_type == B1Types::B1T_INVALID)
-						{
-							return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
-						}
-					}
-					else
-					{
-						bool comp = false;
-						err = B1CUtils::get_com_type(cmd.args[0][0].type, cmd.args[1][0].type, com_type, comp);
-						if(err != B1_RES_OK)
-						{
-							return static_cast<B1C_T_ERROR>(err);
-						}
-					}
+		size = 3 * vals * words + (lib_call ? 3 : words);
+		cycles = 2 * vals * words + (lib_call ? 50 * words : words);
+	};
 
-					if(cmd.args[2][0].type == B1Types::B1T_COMMON)
-					{
-						// local variable of IIF pseudo-function
-						if(com_type == B1Types::B1T_STRING)
-						{
-							// IIF cannot return strings
-							return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
-						}
-						iif_locals[cmd.args[2][0].value].push_back(std::make_pair(std::ref(cmd.args[2][0].type), com_type));
-					}
-					else
-					{
-						cmd.args[2][0].type = com_type;
-						_vars[cmd.args[2][0].value] = std::make_tuple(com_type, 0, false, false, false, false);
-					}
-					continue;
-				}
+	// checks if a function argument value has to be copied to a local variable (instead of replacing the argument with the value)
+	const auto arg_needs_copy = [this](const B1_TYPED_VALUE &tv, B1Types arg_type) -> bool
+	{
+		if(B1CUtils::is_num_val(tv.value))
+		{
+			return arg_type == B1Types::B1T_STRING;
+		}
 
-				return static_cast<B1C_T_ERROR>(err);
-			}
+		if(B1CUtils::is_str_val(tv.value))
+		{
+			return arg_type != B1Types::B1T_STRING;
 		}
-		else
+
+		// different types, nested function calls and volatile variables (the function can read its argument several times)
+		return tv.type != arg_type || get_fn(tv) != nullptr || is_volatile_var(tv.value);
+	};
+
+	const int max_growth = (_compiler._inline_mode == B1C_INLINE_MODE::B1C_INLINE_SPEED) ? B1C_UFN_MAX_GROWTH : 0;
+
+	std::vector<std::wstring> fn_names;
+	for(const auto &cmd: *this)
+	{
+		if(B1CUtils::is_def_fn(cmd))
 		{
-			// GET, PUT and TRR statements is a special case because of possible array range usage
-			if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
-			{
-				bool read = (cmd.cmd == L"PUT");
+			fn_names.push_back(cmd.cmd);
+		}
+	}
 
-				err = get_type(cmd.args[1], read, iif_locals);
-				if(err != B1_RES_OK)
-				{
-					return static_cast<B1C_T_ERROR>(err);
-				}
+	for(const auto &fn_name: fn_names)
+	{
+		auto l = std::find_if(begin(), end(), [&fn_name](const B1_CMP_CMD &cmd) { return B1CUtils::is_label(cmd) && cmd.cmd == fn_name; });
+		const auto fn = get_fn(fn_name);
+		if(fn == nullptr || fn->isstdfn)
+		{
+			continue;
+		}
 
-				// forbid GET and TRR statements with string argument
-				if(!read && cmd.args[1][0].type == B1Types::B1T_STRING)
-				{
-					return static_cast<B1C_T_ERROR>(B1_RES_ETYPMISM);
-				}
+		auto &stats = _ufn_inline_stats[fn_name];
+		auto &report = _ufn_inline_report[fn_name];
+		report = fn_name.substr(fn_name.find(L"__DEF_") + 6) + L": ";
 
-				if(cmd.args.size() != 2)
-				{
-					err = get_type(cmd.args[2], true, iif_locals);
-					if(err != B1_RES_OK)
-					{
-						return static_cast<B1C_T_ERROR>(err);
-					}
-				}
+		// function body: commands after the label up to RET
+		auto body_end = end();
+		bool inlinable = true;
+		bool leaf = true;
+		int retvals = 0;
+		std::set<std::wstring> body_labels;
+		int body_size = B1C_UFN_RET_SIZE;
+		int body_cycles = 0;
+
+		for(auto i = std::next(l); i != end(); i++)
+		{
+			const auto &cmd = *i;
 
+			if(B1CUtils::is_label(cmd))
+			{
+				body_labels.insert(cmd.cmd);
 				continue;
 			}
 
-			bool read = true;
-			if(cmd.cmd == L"IN" || cmd.cmd == L"READ")
+			if(cmd.cmd == L"RET")
 			{
-				read = false;
+				body_end = i;
+				break;
 			}
 
-			for(auto a = cmd.args.begin(); a != cmd.args.end(); a++)
+			if(cmd.cmd == L"RETVAL")
 			{
-				if(cmd.cmd == L"GA" && a < cmd.args.begin() + 2)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"MA" && a < cmd.args.begin() + 3)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"RETVAL" && a != cmd.args.begin())
-				{
-					continue;
-				}
-				if(cmd.cmd == L"OUT" && a != cmd.args.begin() + 1)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"IN" && a != cmd.args.begin() + 1)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"SET" && a != cmd.args.begin() + 1)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"IOCTL" && a != cmd.args.begin() + 2)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"READ" && a == cmd.args.begin())
-				{
-					continue;
-				}
+				retvals++;
+			}
+			else
+			if(!(	cmd.cmd == L"LA" || cmd.cmd == L"LF" || cmd.cmd == L"JMP" || cmd.cmd == L"JT" || cmd.cmd == L"JF" || cmd.cmd == L"=" ||
+					B1CUtils::is_un_op(cmd) || B1CUtils::is_bin_op(cmd) || B1CUtils::is_log_op(cmd)))
+			{
+				inlinable = false;
+				break;
+			}
 
-				err = get_type(*a, read, iif_locals);
-				if(err != B1_RES_OK)
-				{
-					return static_cast<B1C_T_ERROR>(err);
-				}
+			if(is_udef_used(cmd))
+			{
+				leaf = false;
 			}
+
+			std::set<std::wstring> known;
+			bool known_cond = false;
+			int size, cycles;
+			get_cmd_cost(cmd, known, known_cond, size, cycles);
+			body_size += size;
+			body_cycles += cycles;
 		}
-	}
 
-	// process LA stmts
-	for(auto i = begin(); i != end(); i++)
-	{
-		auto &cmd = *i;
+		if(body_end == end() || retvals != 1)
+		{
+			inlinable = false;
+		}
 
-		if(B1CUtils::is_label(cmd))
+		// jumps out of the body
+		for(auto i = std::next(l); inlinable && i != body_end; i++)
+		{
+			if((i->cmd == L"JMP" || i->cmd == L"JT" || i->cmd == L"JF") && body_labels.find(i->args[0][0].value.str()) == body_labels.end())
+			{
+				inlinable = false;
+			}
+		}
+
+		if(!inlinable)
 		{
+			report += L"not inlined (unsupported statements)";
 			continue;
 		}
 
-		if(cmd.cmd == L"LA")
+		if(!leaf)
 		{
-			auto vt = _vars.find(cmd.args[0][0].value);
+			// calls of other functions are inlined first, recursive functions are never inlined
+			report += L"not inlined (calls user-defined functions)";
+			continue;
+		}
 
-			if(vt != _vars.end())
+		// call sites: command, argument index, code size and execution time change
+		std::vector<std::tuple<iterator, int, int, int>> sites;
+		int refs = 0;
+		int const_calls = 0;
+
+		for(auto i = begin(); i != end(); i++)
+		{
+			if(i == l)
 			{
-				cmd.args[1][0].value = Utils::get_type_name(std::get<0>(vt->second));
-				cmd.args[1][0].type = std::get<0>(vt->second);
+				// skip the function body
+				i = body_end;
+				continue;
 			}
-			else
+
+			const auto &cmd = *i;
+
+			if(B1CUtils::is_label(cmd))
 			{
-				for(auto i1 = std::next(i); i1 != end(); i1++)
+				continue;
+			}
+
+			// only the leftmost user-defined function call of a command can be inlined (to preserve the calls order)
+			bool first_call = true;
+
+			for(int a = 0; a < (int)cmd.args.size(); a++)
+			{
+				const auto &arg = cmd.args[a];
+
+				int fn_refs = 0;
+				for(const auto &tv: arg)
 				{
-					if(i1->cmd == L"LF" && i1->args[0][0].value == cmd.args[0][0].value)
+					if(tv.value == fn_name)
 					{
-						auto next = std::prev(i);
-						erase(i);
-						erase(i1);
-						i = next;
-						break;
+						fn_refs++;
 					}
 				}
-				continue;
-			}
-		}
-	}
+				refs += fn_refs;
 
-	return B1C_T_ERROR::B1C_RES_OK;
-}
+				if(	first_call && fn_refs == 1 && arg[0].value == fn_name && get_fn(arg) == fn &&
+					(cmd.cmd == L"=" || B1CUtils::is_un_op(cmd) || B1CUtils::is_bin_op(cmd) || B1CUtils::is_log_op(cmd) ||
+					(cmd.cmd == L"OUT" && a == 1) || (cmd.cmd == L"RETVAL" && a == 0)))
+				{
+					int call_size = B1C_UFN_CALL_SIZE;
+					int call_cycles = B1C_UFN_CALL_CYCLES + B1C_UFN_RET_CYCLES + body_cycles;
+					int inl_size = 0;
+					int inl_cycles = 0;
+					std::set<std::wstring> known;
+					bool const_args = false;
 
-B1C_T_ERROR B1FileCompiler::inline_fns(bool &changed)
-{
-	changed = false;
+					for(int k = 0; k < (int)fn->args.size(); k++)
+					{
+						const auto &tv = arg[k + 1];
+						const auto arg_type = fn->args[k].type;
+						const int words = get_words(arg_type);
+
+						call_size += B1C_UFN_ARG_SIZE * words;
+						call_cycles += B1C_UFN_ARG_CYCLES * words;
+
+						if(arg_needs_copy(tv, arg_type))
+						{
+							// LA, =, LF
+							inl_size += 4 + 6 * words;
+							inl_cycles += 2 + 4 * words;
+						}
+						else
+						if(B1CUtils::is_num_val(tv.value))
+						{
+							known.insert(L"__ARG_" + std::to_wstring(k));
+							const_args = true;
+						}
+					}
+
+					if(!fn->args.empty())
+					{
+						call_size += B1C_UFN_STK_FREE_SIZE;
+						call_cycles += B1C_UFN_STK_FREE_CYCLES;
+					}
+
+					bool known_cond = false;
+					for(auto i1 = std::next(l); i1 != body_end; i1++)
+					{
+						int size, cycles;
+						get_cmd_cost(*i1, known, known_cond, size, cycles);
+						inl_size += size;
+						inl_cycles += cycles;
+					}
+
+					if(const_args)
+					{
+						const_calls++;
+					}
+
+					sites.push_back(std::make_tuple(i, a, inl_size - call_size, inl_cycles - call_cycles));
+				}
+
+				if(is_udef_used(arg))
+				{
+					first_call = false;
+				}
+			}
+		}
 
-	// remove unnecessary ASC, VAL, CHR$ and STR$ function calls
-	for(auto i = begin(); i != end(); i++)
-	{
-		auto &cmd = *i;
+		report += std::to_wstring(refs) + L" call(s) (" + std::to_wstring(const_calls) + L" with constant arguments), body size " +
+			std::to_wstring(body_size) + L" bytes, ";
 
-		if(B1CUtils::is_label(cmd))
+		// the function body can be removed if all its calls are inlined (global functions can be called from other files)
+		const bool remove_body = (refs == (int)sites.size()) && (_ufns.find(fn_name) != _ufns.end());
+
+		int size_change = 0;
+		for(const auto &s: sites)
 		{
-			continue;
+			size_change += std::get<2>(s);
 		}
 
-		_curr_line_num = cmd.line_num;
-		_curr_line_cnt = cmd.line_cnt;
-		_curr_src_line_id = cmd.src_line_id;
-
-		for(auto &a: cmd.args)
+		std::vector<int> order;
+		if(remove_body && std::get<1>(stats) + size_change - body_size <= max_growth)
 		{
-			if(a.size() == 2 && ((a[0].value == L"VAL" && a[1].type != B1Types::B1T_STRING) || (a[0].value == L"STR$" && a[1].type == B1Types::B1T_STRING)))
+			for(int s = 0; s < (int)sites.size(); s++)
 			{
-				a.erase(a.begin());
-				changed = true;
+				order.push_back(s);
 			}
-			else
-			if(a.size() == 2 && a[1].type != B1Types::B1T_STRING && (a[0].value == L"CBYTE" || a[0].value == L"CINT" || a[0].value == L"CWRD" || a[0].value == L"CLNG") && B1CUtils::is_num_val(a[1].value))
+		}
+		else
+		{
+			// the cheapest calls first
+			std::vector<int> all;
+			for(int s = 0; s < (int)sites.size(); s++)
 			{
-				auto type = a[0].type;
-				int32_t n;
-
-				if(Utils::str2int32(a[1].value, n) == B1_RES_OK)
-				{
-					Utils::correct_int_value(n, type);
-					a[1].value = std::to_wstring(n);
-				}
-				a.erase(a.begin());
-				a[0].type = type;
-
-				changed = true;
+				all.push_back(s);
 			}
-			else
-			if(a.size() == 2 && a[0].value == L"CHR$" && B1CUtils::is_num_val(a[1].value))
-			{
-				a[0].value.clear();
-
-				auto err = eval_chr(a[1].value, a[1].type, a[0].value);
-				if(err != B1_RES_OK)
-				{
-					return static_cast<B1C_T_ERROR>(err);
-				}
+			std::stable_sort(all.begin(), all.end(), [&sites](int s1, int s2) { return std::get<2>(sites[s1]) < std::get<2>(sites[s2]); });
 
-				a.erase(a.begin() + 1);
-				changed = true;
-			}
-			else
-			if(a.size() == 2 && a[0].value == L"ASC" && B1CUtils::is_str_val(a[1].value))
+			size_change = 0;
+			for(auto s: all)
 			{
-				std::wstring sval;
-				auto err = B1CUtils::get_string_data(a[1].value, sval);
-				if(err != B1_RES_OK)
+				if(std::get<1>(stats) + size_change + std::get<2>(sites[s]) > max_growth)
 				{
-					return static_cast<B1C_T_ERROR>(err);
-				}
-				if(sval.empty())
-				{
-					return static_cast<B1C_T_ERROR>(B1_RES_EINVARG);
+					break;
 				}
-
-				a[0].value = std::to_wstring(sval.front());
-				a.erase(a.begin() + 1);
-				changed = true;
+				size_change += std::get<2>(sites[s]);
+				order.push_back(s);
 			}
 		}
-	}
-
-	// inline ABS and SGN
-	for(auto i = begin(); i != end(); i++)
-	{
-		auto &cmd = *i;
-
-		if(B1CUtils::is_label(cmd))
-		{
-			continue;
-		}
-
-		_curr_line_num = cmd.line_num;
-		_curr_line_cnt = cmd.line_cnt;
-		_curr_src_line_id = cmd.src_line_id;
 
-		for(int a = 0; a < cmd.args.size(); a++)
+		for(auto s: order)
 		{
-			const auto &arg = cmd.args[a];
+			auto i = std::get<0>(sites[s]);
+			const int a = std::get<1>(sites[s]);
+			const auto arg = i->args[a];
+			const auto ret_type = fn->rettype;
 
-			if(arg.size() == 2 && arg[0].value == L"SGN")
-			{
-				const auto a1 = arg[1];
+			_curr_line_num = i->line_num;
+			_curr_line_cnt = i->line_cnt;
+			_curr_src_line_id = i->src_line_id;
 
-				auto ltype = arg[0].type;
-				auto local = emit_local(ltype, i);
+			auto result = emit_local(ret_type, i);
 
-				// change original command
-				i->args[a][0].type = ltype;
-				i->args[a][0].value = local;
-				i->args[a].pop_back();
+			// argument values
+			std::map<std::wstring, B1_TYPED_VALUE> values;
+			std::vector<std::wstring> arg_locals;
 
-				emit_command(L"LF", std::next(i), local);
+			for(int k = 0; k < (int)fn->args.size(); k++)
+			{
+				const auto &tv = arg[k + 1];
+				const auto arg_type = fn->args[k].type;
+				const std::wstring arg_name = L"__ARG_" + std::to_wstring(k);
 
-				if(a1.type == B1Types::B1T_BYTE || a1.type == B1Types::B1T_WORD)
+				if(arg_needs_copy(tv, arg_type))
 				{
-					// =,SGN(A),B -> LA,local0
-					//               =,0,local0
-					//               ==,A,0
-					//               JT,label0
-					//               +,local0,1,local0
-					//               :label0
-					//               =,local0,B
-					//               LF,local0
-					emit_command(L"=", i, { B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE), B1_TYPED_VALUE(local, ltype) });
-					emit_command(L"==", i, { a1, B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE) });
-					auto label = emit_label(true);
-					emit_command(L"JT", i, label);
-					emit_command(L"=", i, { B1_TYPED_VALUE(L"1", B1Types::B1T_BYTE), B1_TYPED_VALUE(local, ltype) });
-					emit_label(label, i);
+					auto local = emit_local(arg_type, i);
+					emit_command(L"=", i, { tv, B1_TYPED_VALUE(local, arg_type) });
+					arg_locals.push_back(local);
+					values[arg_name] = B1_TYPED_VALUE(local, arg_type);
 				}
 				else
+				if(B1CUtils::is_num_val(tv.value))
 				{
-					// =,SGN(A),B -> LA,local0
-					//               =,0,local0
-					//               ==,A,0
-					//               JT,label0
-					//               <,A,0
-					//               JT,label1
-					//               +,local0,2,local0
-					//               :label1
-					//               -,local0,1,local0
-					//               :label0
-					//               =,local0,B
-					//               LF,local0
-					emit_command(L"=", i, { B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE), B1_TYPED_VALUE(local, ltype) });
-					emit_command(L"==", i, { a1, B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE) });
-					auto label1 = emit_label(true);
-					auto label2 = emit_label(true);
-					emit_command(L"JT", i, label2);
-					emit_command(L"<", i, { a1, B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE) });
-					emit_command(L"JT", i, label1);
-					emit_command(L"=", i, { B1_TYPED_VALUE(L"2", B1Types::B1T_BYTE), B1_TYPED_VALUE(local, ltype) });
-					emit_label(label1, i);
-					emit_command(L"-", i, { B1_TYPED_VALUE(local, ltype), B1_TYPED_VALUE(L"1", B1Types::B1T_BYTE), B1_TYPED_VALUE(local, ltype) });
-					emit_label(label2, i);
+					int32_t n = 0;
+					auto err = Utils::str2int32(tv.value, n);
+					if(err != B1_RES_OK)
+					{
+						return static_cast<B1C_T_ERROR>(err);
+					}
+					Utils::correct_int_value(n, arg_type);
+					values[arg_name] = B1_TYPED_VALUE(std::to_wstring(n), arg_type);
+				}
+				else
+				{
+					values[arg_name] = tv;
 				}
+			}
 
-				changed = true;
+			// copy the function body renaming labels and locals
+			std::map<std::wstring, std::wstring> names;
 
-				i--;
-				break;
+			for(const auto &bl: body_labels)
+			{
+				names[bl] = emit_label(true);
 			}
 
-			if(arg.size() == 2 && arg[0].value == L"ABS")
+			for(auto i1 = std::next(l); i1 != body_end; i1++)
 			{
-				const auto a1 = arg[1];
+				B1_CMP_CMD cmd = *i1;
 
-				if(a1.type == B1Types::B1T_BYTE || a1.type == B1Types::B1T_WORD)
+				cmd.line_num = i->line_num;
+				cmd.line_cnt = i->line_cnt;
+				cmd.src_file_id = i->src_file_id;
+				cmd.src_line_id = i->src_line_id;
+
+				if(B1CUtils::is_label(cmd))
 				{
-					// unsigned type: just remove ABS call
-					i->args[a][0].type = a1.type;
-					i->args[a][0].value = a1.value;
-					i->args[a].pop_back();
+					cmd.set_cmd(names[cmd.cmd]);
+					insert(i, cmd);
+					continue;
 				}
-				else
+
+				if(cmd.cmd == L"LA")
 				{
-					// =,ABS(A),B -> LA,local0
-					//               =,A,local0
-					//               <,local0,0
-					//               JF,label0
-					//               -,local0,local0
-					//               :label0
-					//               =,local0,B
-					//               LF,local0
-					auto local = emit_local(a1.type, i);
+					names[cmd.args[0][0].value.str()] = emit_local(Utils::get_type_by_name(cmd.args[1][0].value), i);
+					continue;
+				}
 
-					// change original command
-					i->args[a][0].type = a1.type;
-					i->args[a][0].value = local;
-					i->args[a].pop_back();
+				if(cmd.cmd == L"RETVAL")
+				{
+					cmd.set_cmd(L"=");
+					cmd.edit_args()[1] = B1_CMP_ARG(result, ret_type);
+				}
 
-					emit_command(L"LF", std::next(i), local);
+				for(auto &a1: cmd.edit_args())
+				{
+					for(auto &tv: a1)
+					{
+						auto v = values.find(tv.value.str());
+						if(v != values.end())
+						{
+							tv = v->second;
+							continue;
+						}
 
-					emit_command(L"=", i, { a1, B1_TYPED_VALUE(local, a1.type) });
-					emit_command(L"<", i, { B1_TYPED_VALUE(local, a1.type), B1_TYPED_VALUE(L"0", B1Types::B1T_BYTE) });
-					auto label = emit_label(true);
-					emit_command(L"JF", i, label);
-					emit_command(L"-", i, { B1_TYPED_VALUE(local, a1.type), B1_TYPED_VALUE(local, a1.type) });
-					emit_label(label, i);
+						auto n = names.find(tv.value.str());
+						if(n != names.end())
+						{
+							tv.value = n->second;
+						}
+					}
 				}
 
-				changed = true;
+				insert(i, cmd);
+			}
 
-				i--;
-				break;
+			for(auto lc = arg_locals.crbegin(); lc != arg_locals.crend(); lc++)
+			{
+				emit_command(L"LF", i, *lc);
 			}
+
+			i->edit_args()[a] = B1_CMP_ARG(result, ret_type);
+			emit_command(L"LF", std::next(i), result);
+
+			std::get<0>(stats)++;
+			std::get<1>(stats) += std::get<2>(sites[s]);
+			std::get<2>(stats) += std::get<3>(sites[s]);
+
+			changed = true;
+		}
+
+		const bool removed = remove_body && !sites.empty() && order.size() == sites.size();
+		if(removed)
+		{
+			std::get<1>(stats) -= body_size;
+
+			_ufns.erase(fn_name);
+			erase(l, std::next(body_end));
+		}
+
+		if(std::get<0>(stats) == 0)
+		{
+			report += L"not inlined (code size growth)";
+		}
+		else
+		{
+			report += L"inlined " + std::to_wstring(std::get<0>(stats)) + L" call(s), code size change " + std::to_wstring(std::get<1>(stats)) +
+				L" bytes, execution time change " + std::to_wstring(std::get<2>(stats)) + L" cycles" + (removed ? L", function body removed" : L"");
 		}
 	}
 
@@ -7350,6 +10652,29 @@ B1C_T_ERROR B1FileCompiler::reuse_locals(bool &changed)
 
 	iterator s0 = begin(), e0 = end(), la0, lf0, s1, e1, la1, lf1;
 
+	// checks if the code contains a loop (a jump back to a label of the code): the loop can read the external
+	// local value written by the previous iteration, so the internal locals cannot be replaced with it
+	auto has_loop = [](iterator s, iterator e) -> bool
+	{
+		std::set<std::wstring> labels;
+
+		for(auto i = s; i != e; i++)
+		{
+			if(B1CUtils::is_label(*i))
+			{
+				labels.insert(i->cmd);
+				continue;
+			}
+
+			if((i->cmd == L"JMP" || i->cmd == L"JT" || i->cmd == L"JF" || i->cmd == L"ERR") && labels.find(i->args[(i->cmd == L"ERR") ? 1 : 0][0].value) != labels.end())
+			{
+				return true;
+			}
+		}
+
+		return false;
+	};
+
 	while(true)
 	{
 		if(!get_LA_LF(s0, e0, la0, lf0))
@@ -7360,6 +10685,12 @@ B1C_T_ERROR B1FileCompiler::reuse_locals(bool &changed)
 		s1 = std::next(la0);
 		e1 = lf0;
 
+		if(has_loop(la0, lf0))
+		{
+			s0 = std::next(la0);
+			continue;
+		}
+
 		while(true)
 		{
 			if(!get_LA_LF(s1, e1, la1, lf1) || std::next(la1) == lf1)
@@ -7577,7 +10908,7 @@ B1C_T_ERROR B1FileCompiler::reuse_locals(bool &changed)
 					B1CUtils::replace_all(*i, la1->args[0][0].value, tv, true);
 				}
 
-				lf1->args[0][0].value = tv.value;
+				lf1->edit_args()[0][0].value = tv.value;
 
 				erase(lf0);
 				erase(la1);
@@ -7622,251 +10953,325 @@ B1C_T_ERROR B1FileCompiler::reuse_vars(bool &changed)
 {
 	changed = false;
 
-	for(auto i = begin(); i != end(); i++)
-	{
-		auto &cmd = *i;
+	auto flow = get_flow();
+	flow.calc_liveness();
 
-		if(B1CUtils::is_label(cmd))
-		{
-			continue;
-		}
+	const auto &blocks = flow.get_blocks();
+
+	for(int b = 0; b < (int)blocks.size(); b++)
+	{
+		// the block commands can be removed so remember the previous command to get the block beginning
+		const auto before = (b == 0) ? end() : std::prev(blocks[b].first);
+		// the block terminator (jump, call, return) is not changed
+		auto scan_end = blocks[b].last;
+		// variables live before the terminator
+		auto live = flow.get_live_out(b);
 
-		auto local = B1CUtils::get_dst_var(cmd, true);
-		if(local == nullptr || !is_gen_local(local->value))
+		if(scan_end != blocks[b].first && B1_CMP_FLOW::is_terminator(*std::prev(scan_end)))
 		{
-			continue;
+			scan_end--;
+			flow.live_step_back(*scan_end, live);
 		}
 
-		iterator wr = i;
-		iterator rd = end();
-		bool udef_used = false;
-
-		for(auto j = std::next(i); j != end(); j++)
+		for(auto i = (b == 0) ? begin() : std::next(before); i != scan_end; )
 		{
-			auto &cmd1 = *j;
+			auto next = std::next(i);
+			auto &cmd = *i;
 
-			if(	B1CUtils::is_label(cmd1) || cmd1.cmd == L"JMP" || cmd1.cmd == L"JT" || cmd1.cmd == L"JF" || cmd1.cmd == L"CALL" ||
-				cmd1.cmd == L"RET" || cmd1.cmd == L"ERR" || cmd1.cmd == L"END" || cmd1.cmd == L"DEF")
+			if(B1CUtils::is_label(cmd))
 			{
-				break;
+				i = next;
+				continue;
 			}
 
-			if(is_udef_used(cmd1))
+			auto local = B1CUtils::get_dst_var(cmd, true);
+			if(local == nullptr || !is_gen_local(local->value))
 			{
-				udef_used = true;
+				i = next;
+				continue;
 			}
 
-			auto dst1 = B1CUtils::get_dst_var(cmd1, true);
-			if(dst1 != nullptr && dst1->value == local->value)
-			{
-				wr = j;
-			}
-			if(B1CUtils::is_src(cmd1, local->value) || B1CUtils::is_sub_or_arg(cmd1, local->value))
-			{
-				rd = j;
-			}
+			iterator wr = i;
+			iterator rd = end();
+			bool udef_used = false;
 
-			if((wr == j && rd != j) || (cmd1.cmd == L"LF" && cmd1.args[0][0].value == local->value))
+			for(auto j = next; ; j++)
 			{
-				if(rd == end())
+				bool local_free = false;
+
+				if(j == scan_end)
 				{
-					if(!is_volatile_used(cmd))
+					// the local is not used after the block
+					if(flow.is_live(live, local->value))
 					{
-						erase(i++);
-						i--;
-						changed = true;
+						break;
 					}
+
+					local_free = true;
 				}
 				else
 				{
-					auto var_to_reuse = B1CUtils::get_dst_var(*rd, true);
-					if(var_to_reuse == nullptr || is_volatile_var(var_to_reuse->value))
+					auto &cmd1 = *j;
+
+					if(cmd1.cmd == L"DEF")
 					{
 						break;
 					}
-					if(udef_used && !is_gen_local(var_to_reuse->value))
+
+					if(is_udef_used(cmd1))
+					{
+						udef_used = true;
+					}
+
+					auto dst1 = B1CUtils::get_dst_var(cmd1, true);
+					if(dst1 != nullptr && dst1->value == local->value)
 					{
-						break;
+						wr = j;
 					}
-					
-					B1Types com_type;
-					bool comp_types = false;
-					if(B1CUtils::get_com_type(local->type, var_to_reuse->type, com_type, comp_types) != B1_RES_OK || !comp_types)
+					if(B1CUtils::is_src(cmd1, local->value) || B1CUtils::is_sub_or_arg(cmd1, local->value))
 					{
-						break;
+						rd = j;
 					}
 
-					bool var_used = false;
-					for(auto r = std::next(i); r != rd; r++)
+					local_free = (wr == j && rd != j) || (cmd1.cmd == L"LF" && cmd1.args[0][0].value == local->value);
+				}
+
+				if(local_free)
+				{
+					if(rd == end())
+					{
+						if(!is_volatile_used(cmd))
+						{
+							erase(i);
+							changed = true;
+						}
+					}
+					else
 					{
-						if(B1CUtils::is_used(*r, var_to_reuse->value))
+						auto var_to_reuse = B1CUtils::get_dst_var(*rd, true);
+						if(var_to_reuse == nullptr || is_volatile_var(var_to_reuse->value))
+						{
+							break;
+						}
+						if(udef_used && !is_gen_local(var_to_reuse->value))
+						{
+							break;
+						}
+					
+						B1Types com_type;
+						bool comp_types = false;
+						if(B1CUtils::get_com_type(local->type, var_to_reuse->type, com_type, comp_types) != B1_RES_OK || !comp_types)
+						{
+							break;
+						}
+
+						bool var_used = false;
+						for(auto r = std::next(i); r != rd; r++)
+						{
+							// the variable can also be a local allocated after the replaced one
+							if(B1CUtils::is_used(*r, var_to_reuse->value) || (r->cmd == L"LA" && r->args[0][0].value == var_to_reuse->value))
+							{
+								var_used = true;
+								break;
+							}
+						}
+						if(var_used || B1CUtils::is_src(*rd, var_to_reuse->value) || B1CUtils::is_sub_or_arg(*rd, var_to_reuse->value))
 						{
-							var_used = true;
 							break;
 						}
-					}
-					if(var_used || B1CUtils::is_src(*rd, var_to_reuse->value) || B1CUtils::is_sub_or_arg(*rd, var_to_reuse->value))
-					{
-						break;
-					}
 
-					auto local_name = local->value;
-					B1CUtils::replace_dst(*i, local_name, B1_CMP_ARG(var_to_reuse->value, var_to_reuse->type), true);
-					for(auto r = std::next(i); r != std::next(rd); r++)
-					{
-						B1CUtils::replace_all(*r, local_name, *var_to_reuse, true);
+						auto local_name = local->value;
+						B1CUtils::replace_dst(*i, local_name, B1_CMP_ARG(var_to_reuse->value, var_to_reuse->type), true);
+						for(auto r = std::next(i); r != std::next(rd); r++)
+						{
+							B1CUtils::replace_all(*r, local_name, *var_to_reuse, true);
+						}
+						changed = true;
 					}
-					changed = true;
-				}
 
-				break;
+					break;
+				}
 			}
-		}
-	}
 
-	// = <smth>,var1
-	// ... <- <smth> must not be used here
-	// +,var1,var2,var1
-	// ->
-	// ...
-	// +,<smth>,var2,var1
-	// or
-	// = <smth>,var1
-	// ... <- <smth> must not be used here
-	// +,var1,var2,var3
-	// +,var3,var4,var1
-	// ->
-	// ...
-	// +,<smth>,var2,var3
-	// +,var3,var4,var1
-
-	for(auto i = begin(); i != end(); i++)
-	{
-		auto &cmd = *i;
-
-		if(B1CUtils::is_label(cmd))
-		{
-			continue;
+			i = next;
 		}
 
-		bool arg1_udef = false;
-		bool arg1_volatile = false;
+		// = <smth>,var1
+		// ... <- <smth> must not be used here
+		// +,var1,var2,var1
+		// ->
+		// ...
+		// +,<smth>,var2,var1
+		// or
+		// = <smth>,var1
+		// ... <- <smth> must not be used here
+		// +,var1,var2,var3
+		// +,var3,var4,var1
+		// ->
+		// ...
+		// +,<smth>,var2,var3
+		// +,var3,var4,var1
 
-		if(cmd.cmd == L"=" && !(arg1_udef = is_udef_used(cmd.args[1])) && !(arg1_volatile = is_volatile_used(cmd.args[1])))
+		for(auto i = (b == 0) ? begin() : std::next(before); i != scan_end; )
 		{
-			bool arg0_udef = is_udef_used(cmd.args[0]);
-			bool arg0_volatile = is_volatile_used(cmd.args[0]);
+			auto next = std::next(i);
+			auto &cmd = *i;
+
+			if(B1CUtils::is_label(cmd))
+			{
+				i = next;
+				continue;
+			}
 
-			iterator rd = end(), wr = end();
+			bool arg1_udef = false;
+			bool arg1_volatile = false;
 
-			for(auto j = std::next(i); j != end(); j++)
+			if(cmd.cmd == L"=" && !(arg1_udef = is_udef_used(cmd.args[1])) && !(arg1_volatile = is_volatile_used(cmd.args[1])))
 			{
-				auto &cmd1 = *j;
+				bool arg0_udef = is_udef_used(cmd.args[0]);
+				bool arg0_volatile = is_volatile_used(cmd.args[0]);
 
-				if (B1CUtils::is_label(cmd1) || cmd1.cmd == L"JMP" || cmd1.cmd == L"JT" || cmd1.cmd == L"JF" || cmd1.cmd == L"CALL" ||
-					cmd1.cmd == L"RET" || cmd1.cmd == L"ERR" || cmd1.cmd == L"END" || cmd1.cmd == L"DEF" ||
-					(is_udef_used(cmd1) && !is_gen_local(cmd.args[1][0].value)))
-				{
-					break;
-				}
+				iterator rd = end(), wr = end();
 
-				if(arg0_udef)
+				for(auto j = next; ; j++)
 				{
-					auto dst_var = B1CUtils::get_dst_var(cmd1, false);
-					if(dst_var != nullptr)
+					bool is_src = false;
+					bool is_dst = false;
+
+					if(j == scan_end)
 					{
-						if(!is_gen_local(dst_var->value) && !(cmd.args[1].size() == 1 && B1_CMP_ARG(dst_var->value, dst_var->type) == cmd.args[1]))
+						// var1 is not used after the block
+						if(rd == end() || cmd.args[1].size() != 1 || flow.is_live(live, cmd.args[1][0].value))
 						{
 							break;
 						}
+
+						wr = j;
 					}
-				}
+					else
+					{
+						auto &cmd1 = *j;
 
-				if(cmd.args[1].size() == 1 && B1CUtils::is_sub_or_arg(cmd1, cmd.args[1][0].value))
-				{
-					break;
-				}
+						if(cmd1.cmd == L"DEF" || (is_udef_used(cmd1) && !is_gen_local(cmd.args[1][0].value)))
+						{
+							break;
+						}
 
-				bool is_src = B1CUtils::arg_is_src(cmd1, cmd.args[1]);
-				bool is_dst = B1CUtils::arg_is_dst(cmd1, cmd.args[1], false);
+						if(arg0_udef)
+						{
+							auto dst_var = B1CUtils::get_dst_var(cmd1, false);
+							if(dst_var != nullptr)
+							{
+								if(!is_gen_local(dst_var->value) && !(cmd.args[1].size() == 1 && B1_CMP_ARG(dst_var->value, dst_var->type) == cmd.args[1]))
+								{
+									break;
+								}
+							}
+						}
 
-				if(is_dst && cmd1.cmd == L"TRR")
-				{
-					break;
-				}
+						if(cmd.args[1].size() == 1 && B1CUtils::is_sub_or_arg(cmd1, cmd.args[1][0].value))
+						{
+							break;
+						}
 
-				if(!is_dst && ((cmd1.cmd == L"LF" && cmd1.args[0][0].value == cmd.args[1][0].value) || ((cmd1.cmd == L"GA" || cmd1.cmd == L"GF") && cmd1.args[0][0].value == cmd.args[1][0].value)))
-				{
-					is_dst = true;
-				}
+						is_src = B1CUtils::arg_is_src(cmd1, cmd.args[1]);
+						is_dst = B1CUtils::arg_is_dst(cmd1, cmd.args[1], false);
 
-				if(is_src)
-				{
-					if(rd != end())
-					{
-						break;
-					}
+						if(is_dst && cmd1.cmd == L"TRR")
+						{
+							break;
+						}
 
-					rd = j;
-				}
+						if(!is_dst && ((cmd1.cmd == L"LF" && cmd1.args[0][0].value == cmd.args[1][0].value) || ((cmd1.cmd == L"GA" || cmd1.cmd == L"GF") && cmd1.args[0][0].value == cmd.args[1][0].value)))
+						{
+							is_dst = true;
+						}
+					}
 
-				if(is_dst)
-				{
-					if(rd == end())
+					if(is_src)
 					{
-						break;
+						if(rd != end())
+						{
+							break;
+						}
+
+						rd = j;
 					}
 
-					wr = j;
-				}
+					if(is_dst)
+					{
+						if(rd == end())
+						{
+							break;
+						}
 
-				if(rd != end() && wr != end())
-				{
-					bool arg_or_sub_changed = false;
+						wr = j;
+					}
 
-					if(cmd.args[0].size() > 1)
+					if(rd != end() && wr != end())
 					{
-						auto last = (wr == rd) ? wr : std::next(wr);
-						for(auto i1 = std::next(i); !arg_or_sub_changed && i1 != last; i1++)
+						bool arg_or_sub_changed = false;
+
+						// <smth> variable, its subscripts and function arguments must not be changed before rd
+						for(auto i1 = next; !arg_or_sub_changed && i1 != std::next(rd); i1++)
 						{
-							for(auto a = cmd.args[0].cbegin() + 1; a != cmd.args[0].cend(); a++)
+							for(const auto &a: cmd.args[0])
 							{
-								if(B1CUtils::is_dst(*i1, a->value))
+								if(	(i1 != rd && B1CUtils::is_dst(*i1, a.value)) ||
+									(is_udef_used(*i1) && !B1CUtils::is_imm_val(a.value) && !is_gen_local(a.value))
+									)
 								{
 									arg_or_sub_changed = true;
 									break;
 								}
 							}
 						}
-					}
-					if(arg_or_sub_changed)
-					{
-						break;
-					}
 
-					int count = 0;
-					auto ctmp = *rd;
-					B1CUtils::replace_src(ctmp, cmd.args[1], cmd.args[0], &count);
-					if(count == 1 || !(arg0_volatile || arg0_udef))
-					{
-						*rd = ctmp;
-						auto next = std::prev(i);
-						erase(i);
-						i = next;
-						changed = true;
-					}
+						if(!arg_or_sub_changed && cmd.args[0].size() > 1)
+						{
+							auto last = (wr == rd || wr == scan_end) ? wr : std::next(wr);
+							for(auto i1 = next; !arg_or_sub_changed && i1 != last; i1++)
+							{
+								for(auto a = cmd.args[0].cbegin() + 1; a != cmd.args[0].cend(); a++)
+								{
+									if(B1CUtils::is_dst(*i1, a->value))
+									{
+										arg_or_sub_changed = true;
+										break;
+									}
+								}
+							}
+						}
+						if(arg_or_sub_changed)
+						{
+							break;
+						}
 
-					break;
+						int count = 0;
+						auto ctmp = *rd;
+						B1CUtils::replace_src(ctmp, cmd.args[1], cmd.args[0], &count);
+						if(count == 1 || !(arg0_volatile || arg0_udef))
+						{
+							*rd = ctmp;
+							erase(i);
+							changed = true;
+						}
+
+						break;
+					}
 				}
 			}
+
+			i = next;
 		}
 	}
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-bool B1FileCompiler::eval_imm_fn_arg(B1_CMP_ARG &a)
+bool B1FileCompiler::eval_imm_fn_arg(B1_CMP_CMD &cmd, int arg_num)
 {
+	const auto &a = cmd.args[arg_num];
 	bool changed = false;
 	auto fn = get_fn(a);
 
@@ -7881,8 +11286,9 @@ bool B1FileCompiler::eval_imm_fn_arg(B1_CMP_ARG &a)
 				if(Utils::str2int32(aa->value, n) == B1_RES_OK)
 				{
 					Utils::correct_int_value(n, aa->type);
-					aa->type = B1Types::B1T_STRING;
-					aa->value = L"\"" + std::to_wstring(n) + L"\"";
+					auto &v = cmd.edit_args()[arg_num][aa - a.begin()];
+					v.type = B1Types::B1T_STRING;
+					v.value = L"\"" + std::to_wstring(n) + L"\"";
 					changed = true;
 				}
 			}
@@ -7895,8 +11301,9 @@ bool B1FileCompiler::eval_imm_fn_arg(B1_CMP_ARG &a)
 			auto err = B1CUtils::get_string_data(a[1].value, sval);
 			if(err == B1_RES_OK)
 			{
-				a.pop_back();
-				a[0].value = std::to_wstring(sval.length());
+				auto &ma = cmd.edit_args()[arg_num];
+				ma.pop_back();
+				ma[0].value = std::to_wstring(sval.length());
 				changed = true;
 			}
 		}
@@ -7912,9 +11319,10 @@ bool B1FileCompiler::eval_imm_fn_arg(B1_CMP_ARG &a)
 
 				if(B1CUtils::get_num_min_type(sval, type, sval) == B1_RES_OK)
 				{
-					a.pop_back();
-					a[0].value = sval;
-					a[0].type = type;
+					auto &ma = cmd.edit_args()[arg_num];
+					ma.pop_back();
+					ma[0].value = sval;
+					ma[0].type = type;
 					changed = true;
 				}
 			}
@@ -7927,9 +11335,10 @@ bool B1FileCompiler::eval_imm_fn_arg(B1_CMP_ARG &a)
 			auto err = B1CUtils::get_string_data(a[1].value, sval);
 			if(err == B1_RES_OK)
 			{
-				a.pop_back();
-				a[0].value = sval;
-				a[0].type = fn->rettype;
+				auto &ma = cmd.edit_args()[arg_num];
+				ma.pop_back();
+				ma[0].value = sval;
+				ma[0].type = fn->rettype;
 				changed = true;
 			}
 		}
@@ -7941,8 +11350,9 @@ bool B1FileCompiler::eval_imm_fn_arg(B1_CMP_ARG &a)
 			if(Utils::str2int32(a[1].value, n) == B1_RES_OK)
 			{
 				Utils::correct_int_value(n, fn->args[0].type);
-				a.pop_back();
-				a[0].value = L"\"" + std::to_wstring(n) + L"\"";
+				auto &ma = cmd.edit_args()[arg_num];
+				ma.pop_back();
+				ma[0].value = L"\"" + std::to_wstring(n) + L"\"";
 				changed = true;
 			}
 		}
@@ -7976,8 +11386,8 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 			if(Utils::str2int32(cmd.args[0][0].value, n) == B1_RES_OK)
 			{
 				Utils::correct_int_value(n, cmd.args[0][0].type);
-				cmd.args[0][0].value = L"\"" + std::to_wstring(n) + L"\"";
-				cmd.args[0][0].type = B1Types::B1T_STRING;
+				cmd.edit_args()[0][0].value = L"\"" + std::to_wstring(n) + L"\"";
+				cmd.edit_args()[0][0].type = B1Types::B1T_STRING;
 				changed = true;
 			}
 			continue;
@@ -8011,44 +11421,10 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 
 			if(is_n1 && is_n2)
 			{
-				// process numeric values
-				switch(cmd.cmd.front())
+				// process numeric values (operations with undefined result like division by zero are left as is)
+				if(!eval_num_op(cmd.cmd.front(), n1, n2, n1))
 				{
-					case L'+':
-						n1 += n2;
-						break;
-					case L'-':
-						n1 -= n2;
-						break;
-					case L'*':
-						n1 *= n2;
-						break;
-					case L'/':
-						n1 /= n2;
-						break;
-					case L'^':
-						n1 = (int32_t)std::pow(n1, n2);
-						break;
-					// left shift
-					case L'<':
-						n1 <<= n2;
-						break;
-					// right shift
-					case L'>':
-						n1 >>= n2;
-						break;
-					case L'%':
-						n1 %= n2;
-						break;
-					case L'&':
-						n1 &= n2;
-						break;
-					case L'|':
-						n1 |= n2;
-						break;
-					case L'~':
-						n1 ^= n2;
-						break;
+					continue;
 				}
 
 				B1Types com_type = B1Types::B1T_UNKNOWN;
@@ -8078,11 +11454,11 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 					tv.value = std::to_wstring(n1);
 				}
 
-				cmd.cmd = L"=";
-				cmd.args[0].clear();
-				cmd.args[0].push_back(tv);
-				cmd.args[1] = cmd.args[2];
-				cmd.args.pop_back();
+				cmd.set_cmd(L"=");
+				cmd.edit_args()[0].clear();
+				cmd.edit_args()[0].push_back(tv);
+				cmd.edit_args()[1] = cmd.args[2];
+				cmd.edit_args().pop_back();
 
 				changed = true;
 			}
@@ -8111,10 +11487,10 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 				s1.pop_back();
 				s2.erase(0, 1);
 
-				cmd.cmd = L"=";
-				cmd.args.erase(cmd.args.begin());
-				cmd.args[0].clear();
-				cmd.args[0].push_back(B1_TYPED_VALUE(s1 + s2, B1Types::B1T_STRING));
+				cmd.set_cmd(L"=");
+				cmd.edit_args().erase(cmd.args.begin());
+				cmd.edit_args()[0].clear();
+				cmd.edit_args()[0].push_back(B1_TYPED_VALUE(s1 + s2, B1Types::B1T_STRING));
 
 				changed = true;
 			}
@@ -8126,16 +11502,16 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 			{
 				if(is_n1)
 				{
-					cmd.args[0][0].value = L"\"" + std::to_wstring(n1) + L"\"";
-					cmd.args[0][0].type = B1Types::B1T_STRING;
+					cmd.edit_args()[0][0].value = L"\"" + std::to_wstring(n1) + L"\"";
+					cmd.edit_args()[0][0].type = B1Types::B1T_STRING;
 
 					changed = true;
 				}
 				else
 				if(is_n2)
 				{
-					cmd.args[1][0].value = L"\"" + std::to_wstring(n2) + L"\"";
-					cmd.args[1][0].type = B1Types::B1T_STRING;
+					cmd.edit_args()[1][0].value = L"\"" + std::to_wstring(n2) + L"\"";
+					cmd.edit_args()[1][0].type = B1Types::B1T_STRING;
 
 					changed = true;
 				}
@@ -8297,7 +11673,7 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 
 								if(n1 <= 0 && cmd1.cmd != L"*")
 								{
-									cmd1.cmd = (cmd1.cmd == L"-") ? L"+" : L"-";
+									cmd1.set_cmd((cmd1.cmd == L"-") ? L"+" : L"-");
 									n1 = -n1;
 								}
 
@@ -8307,9 +11683,9 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 								val = std::to_wstring(n1);
 							}
 
-							cmd1.args[0] = cmd.args[imm_ind == 0 ? 1 : 0];
-							cmd1.args[1].clear();
-							cmd1.args[1].push_back(B1_TYPED_VALUE(val, type));
+							cmd1.edit_args()[0] = cmd.args[imm_ind == 0 ? 1 : 0];
+							cmd1.edit_args()[1].clear();
+							cmd1.edit_args()[1].push_back(B1_TYPED_VALUE(val, type));
 
 							erase(i--);
 
@@ -8334,7 +11710,7 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 
 		if(B1CUtils::is_un_op(cmd))
 		{
-			if(eval_imm_fn_arg(cmd.args[0]))
+			if(eval_imm_fn_arg(cmd, 0))
 			{
 				changed = true;
 			}
@@ -8342,12 +11718,12 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 		else
 		if(B1CUtils::is_bin_op(cmd) || B1CUtils::is_log_op(cmd))
 		{
-			if(eval_imm_fn_arg(cmd.args[0]))
+			if(eval_imm_fn_arg(cmd, 0))
 			{
 				changed = true;
 			}
 
-			if(eval_imm_fn_arg(cmd.args[1]))
+			if(eval_imm_fn_arg(cmd, 1))
 			{
 				changed = true;
 			}
@@ -8358,7 +11734,7 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 		{
 			for(auto a = cmd.args.begin() + (cmd.cmd == L"GA" ? 2 : 3); a != cmd.args.end(); a++)
 			{
-				if(eval_imm_fn_arg(*a))
+				if(eval_imm_fn_arg(cmd, a - cmd.args.begin()))
 				{
 					changed = true;
 				}
@@ -8367,7 +11743,7 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 		else
 		if(cmd.cmd == L"RETVAL")
 		{
-			if(eval_imm_fn_arg(cmd.args[0]))
+			if(eval_imm_fn_arg(cmd, 0))
 			{
 				changed = true;
 			}
@@ -8375,7 +11751,7 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 		else
 		if(cmd.cmd == L"OUT")
 		{
-			if(eval_imm_fn_arg(cmd.args[1]))
+			if(eval_imm_fn_arg(cmd, 1))
 			{
 				changed = true;
 			}
@@ -8383,7 +11759,7 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 		else
 		if(cmd.cmd == L"IN")
 		{
-			if(eval_imm_fn_arg(cmd.args[1]))
+			if(eval_imm_fn_arg(cmd, 1))
 			{
 				changed = true;
 			}
@@ -8391,7 +11767,7 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 		else
 		if(cmd.cmd == L"SET")
 		{
-			if(eval_imm_fn_arg(cmd.args[1]))
+			if(eval_imm_fn_arg(cmd, 1))
 			{
 				changed = true;
 			}
@@ -8399,7 +11775,7 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 		else
 		if(cmd.cmd == L"IOCTL")
 		{
-			if(cmd.args.size() > 2 && eval_imm_fn_arg(cmd.args[2]))
+			if(cmd.args.size() > 2 && eval_imm_fn_arg(cmd, 2))
 			{
 				changed = true;
 			}
@@ -8407,7 +11783,7 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 		else
 		if(cmd.cmd == L"READ")
 		{
-			if(eval_imm_fn_arg(cmd.args[1]))
+			if(eval_imm_fn_arg(cmd, 1))
 			{
 				changed = true;
 			}
@@ -8415,14 +11791,14 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 		else
 		if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
 		{
-			if(eval_imm_fn_arg(cmd.args[1]))
+			if(eval_imm_fn_arg(cmd, 1))
 			{
 				changed = true;
 			}
 
 			if(cmd.args.size() != 2)
 			{
-				if(eval_imm_fn_arg(cmd.args[2]))
+				if(eval_imm_fn_arg(cmd, 2))
 				{
 					changed = true;
 				}
@@ -8431,7 +11807,7 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 		else
 		if(cmd.cmd == L"XARG")
 		{
-			if(eval_imm_fn_arg(cmd.args[0]))
+			if(eval_imm_fn_arg(cmd, 0))
 			{
 				changed = true;
 			}
@@ -8473,8 +11849,8 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 
 					if(cmd.cmd == L"+" || (cmd.cmd == L"-" && imm_ind == 1))
 					{
-						cmd.cmd = L"=";
-						cmd.args.erase(cmd.args.begin() + imm_ind);
+						cmd.set_cmd(L"=");
+						cmd.edit_args().erase(cmd.args.begin() + imm_ind);
 						changed = true;
 					}
 					else
@@ -8482,9 +11858,9 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 						(cmd.cmd == L"/" && imm_ind == 0 && !is_volatile_used(cmd.args[1])) ||
 						(cmd.cmd == L"%" && imm_ind == 0 && !is_volatile_used(cmd.args[1])))
 					{
-						cmd.cmd = L"=";
-						cmd.args.erase(cmd.args.begin());
-						cmd.args[0] = B1_CMP_ARG(L"0", B1Types::B1T_BYTE);
+						cmd.set_cmd(L"=");
+						cmd.edit_args().erase(cmd.args.begin());
+						cmd.edit_args()[0] = B1_CMP_ARG(L"0", B1Types::B1T_BYTE);
 						changed = true;
 					}
 				}
@@ -8493,11 +11869,11 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 				{
 					if(cmd.cmd == L"*" || (cmd.cmd == L"/" && imm_ind == 1) || (cmd.cmd == L"%" && imm_ind == 1 && !is_volatile_used(cmd.args[0])))
 					{
-						cmd.cmd = L"=";
-						cmd.args.erase(cmd.args.begin() + imm_ind);
+						cmd.set_cmd(L"=");
+						cmd.edit_args().erase(cmd.args.begin() + imm_ind);
 						if(cmd.cmd == L"%")
 						{
-							cmd.args[0] = B1_CMP_ARG(L"0", B1Types::B1T_BYTE);
+							cmd.edit_args()[0] = B1_CMP_ARG(L"0", B1Types::B1T_BYTE);
 						}
 						changed = true;
 					}
@@ -8507,8 +11883,8 @@ B1C_T_ERROR B1FileCompiler::eval_imm_exps(bool &changed)
 				{
 					if(cmd.cmd == L"*" || (cmd.cmd == L"/" && imm_ind == 1))
 					{
-						cmd.cmd = L"-";
-						cmd.args.erase(cmd.args.begin() + imm_ind);
+						cmd.set_cmd(L"-");
+						cmd.edit_args().erase(cmd.args.begin() + imm_ind);
 						changed = true;
 					}
 				}
@@ -8617,7 +11993,7 @@ B1C_T_ERROR B1FileCompiler::remove_DAT_stmts()
 			// replace const variables' names with their values
 			bool first = true;
 
-			for(auto &v: cmd.args)
+			for(auto &v: cmd.edit_args())
 			{
 				// the first arg is namespace name
 				if(first)
@@ -8688,7 +12064,7 @@ B1C_T_ERROR B1FileCompiler::remove_DAT_stmts()
 			auto label = dat_labels.find(cmd.args[1][0].value);
 			if(label != dat_labels.end())
 			{
-				cmd.args[1][0].value = label->second;
+				cmd.edit_args()[1][0].value = label->second;
 			}
 			else
 			{
@@ -8700,8 +12076,10 @@ B1C_T_ERROR B1FileCompiler::remove_DAT_stmts()
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::remove_unused_vars(B1_CMP_ARG &a, bool &changed, bool subs_and_args_only /*= false*/)
+B1C_T_ERROR B1FileCompiler::remove_unused_vars(B1_CMP_CMD &cmd, int arg_num, bool &changed, bool subs_and_args_only /*= false*/)
 {
+	const auto &a = cmd.args[arg_num];
+
 	bool optimize = (a[0].type != B1Types::B1T_VARREF);
 
 	// check arguments
@@ -8722,7 +12100,7 @@ B1C_T_ERROR B1FileCompiler::remove_unused_vars(B1_CMP_ARG &a, bool &changed, boo
 			}
 			else
 			{
-				aa->value = (aa->type == B1Types::B1T_STRING) ? L"\"\"" : L"0";
+				cmd.edit_args()[arg_num][aa - a.begin()].value = (aa->type == B1Types::B1T_STRING) ? L"\"\"" : L"0";
 				changed = true;
 			}
 		}
@@ -8734,193 +12112,127 @@ B1C_T_ERROR B1FileCompiler::remove_unused_vars(B1_CMP_ARG &a, bool &changed, boo
 
 	if(!subs_and_args_only && optimize && _compiler.get_var_used(a[0].value) == 1 && !is_volatile_var(a[0].value) && !is_mem_var_name(a[0].value) && !is_const_var(a[0].value) && !is_udef_used(a))
 	{
-		a[0].value = (a[0].type == B1Types::B1T_STRING) ? L"\"\"" : L"0";
-		a.erase(a.begin() + 1, a.end());
+		auto &ma = cmd.edit_args()[arg_num];
+		ma[0].value = (ma[0].type == B1Types::B1T_STRING) ? L"\"\"" : L"0";
+		ma.erase(ma.begin() + 1, ma.end());
 		changed = true;
 	}
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-// replaces variables used for reading only with their default values (in expressions)
-// the function does not remove variables declarations
-B1C_T_ERROR B1FileCompiler::remove_unused_vars(bool &changed)
+B1C_T_ERROR B1FileCompiler::remove_unused_vars(B1_CMP_CMD &cmd, bool &changed)
 {
 	B1C_T_ERROR err;
 
-	changed = false;
+	_curr_line_cnt = cmd.line_cnt;
+	_curr_line_num = cmd.line_num;
+	_curr_src_line_id = cmd.src_line_id;
 
-	for(auto &cmd: *this)
+	if(cmd.cmd == L"GA")
 	{
-		_curr_line_cnt = cmd.line_cnt;
-		_curr_line_num = cmd.line_num;
-		_curr_src_line_id = cmd.src_line_id;
-
-		if(B1CUtils::is_label(cmd))
-		{
-			continue;
-		}
-
-		if(cmd.cmd == L"GA")
-		{
-			for(auto a = cmd.args.begin() + 2; a != cmd.args.end(); a++)
-			{
-				auto &arg = *a;
-				err = remove_unused_vars(arg, changed);
-				if(err != B1C_T_ERROR::B1C_RES_OK)
-				{
-					return err;
-				}
-			}
-
-			continue;
-		}
-
-		if(cmd.cmd == L"RETVAL")
-		{
-			err = remove_unused_vars(cmd.args[0], changed);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
-
-			continue;
-		}
-
-		if(cmd.cmd == L"OUT")
+		for(int a = 2; a < (int)cmd.args.size(); a++)
 		{
-			err = remove_unused_vars(cmd.args[1], changed);
+			err = remove_unused_vars(cmd, a, changed);
 			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
 				return err;
 			}
-
-			continue;
 		}
 
-		if(cmd.cmd == L"IN")
-		{
-			err = remove_unused_vars(cmd.args[1], changed);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
-
-			continue;
-		}
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
 
-		if(cmd.cmd == L"READ")
-		{
-			err = remove_unused_vars(cmd.args[1], changed);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
+	if(cmd.cmd == L"RETVAL" || cmd.cmd == L"XARG")
+	{
+		return remove_unused_vars(cmd, 0, changed);
+	}
 
-			continue;
-		}
+	if(cmd.cmd == L"OUT" || cmd.cmd == L"IN" || cmd.cmd == L"READ" || cmd.cmd == L"SET")
+	{
+		return remove_unused_vars(cmd, 1, changed);
+	}
 
-		if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
+	if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
+	{
+		if(cmd.args.size() != 2)
 		{
-			if(cmd.args.size() != 2)
-			{
-				err = remove_unused_vars(cmd.args[2], changed);
-				if(err != B1C_T_ERROR::B1C_RES_OK)
-				{
-					return err;
-				}
-
-				bool single_value = (cmd.args[2].size() == 1) && (cmd.args[2][0].value == L"1");
-				if(single_value)
-				{
-					cmd.args.pop_back();
-					changed = true;
-				}
-			}
-
-			err = remove_unused_vars(cmd.args[1], changed, (cmd.args.size() != 2));
+			err = remove_unused_vars(cmd, 2, changed);
 			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
 				return err;
 			}
 
-			continue;
-		}
-
-		if(cmd.cmd == L"SET")
-		{
-			err = remove_unused_vars(cmd.args[1], changed);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
+			bool single_value = (cmd.args[2].size() == 1) && (cmd.args[2][0].value == L"1");
+			if(single_value)
 			{
-				return err;
+				cmd.edit_args().pop_back();
+				changed = true;
 			}
-
-			continue;
 		}
 
-		if(cmd.cmd == L"XARG")
-		{
-			err = remove_unused_vars(cmd.args[0], changed);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
-
-			continue;
-		}
+		return remove_unused_vars(cmd, 1, changed, (cmd.args.size() != 2));
+	}
 
-		if(cmd.cmd == L"IOCTL")
+	if(cmd.cmd == L"IOCTL")
+	{
+		if(cmd.args.size() > 2)
 		{
-			if(cmd.args.size() > 2)
-			{
-				err = remove_unused_vars(cmd.args[2], changed);
-				if(err != B1C_T_ERROR::B1C_RES_OK)
-				{
-					return err;
-				}
-			}
-
-			continue;
+			return remove_unused_vars(cmd, 2, changed);
 		}
 
-		if(B1CUtils::is_un_op(cmd) || B1CUtils::is_log_op(cmd))
-		{
-			err = remove_unused_vars(cmd.args[0], changed);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
-
-			err = remove_unused_vars(cmd.args[1], changed);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
 
-			continue;
-		}
+	if(B1CUtils::is_un_op(cmd) || B1CUtils::is_log_op(cmd) || B1CUtils::is_bin_op(cmd))
+	{
+		const int args_num = B1CUtils::is_bin_op(cmd) ? 3 : 2;
 
-		if(B1CUtils::is_bin_op(cmd))
+		for(int a = 0; a < args_num; a++)
 		{
-			err = remove_unused_vars(cmd.args[0], changed);
+			err = remove_unused_vars(cmd, a, changed);
 			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
 				return err;
 			}
+		}
+	}
 
-			err = remove_unused_vars(cmd.args[1], changed);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
+	return B1C_T_ERROR::B1C_RES_OK;
+}
 
-			err = remove_unused_vars(cmd.args[2], changed);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
+// replaces variables used for reading only with their default values (in expressions)
+// the function does not remove variables declarations, only the commands using the variables are processed (they
+// are taken from the variables usage index)
+B1C_T_ERROR B1FileCompiler::remove_unused_vars(bool &changed)
+{
+	changed = false;
+
+	auto err = calc_vars_usage();
+	if(err != B1C_T_ERROR::B1C_RES_OK)
+	{
+		return err;
+	}
+
+	std::set<B1_CMP_CMD *> cmds(_io_cnt_cmds.cbegin(), _io_cnt_cmds.cend());
+
+	for(const auto &v: _var_cmds)
+	{
+		if(_compiler.get_var_used(v.first) == 1)
+		{
+			for(const auto &c: v.second)
 			{
-				return err;
+				cmds.insert(c.first);
 			}
+		}
+	}
 
-			continue;
+	for(auto cmd: cmds)
+	{
+		err = remove_unused_vars(*cmd, changed);
+		if(err != B1C_T_ERROR::B1C_RES_OK)
+		{
+			return err;
 		}
 	}
 
@@ -9002,7 +12314,7 @@ B1C_T_ERROR B1FileCompiler::eval_const_vars_values_1_iter(bool &changed, bool &a
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::calc_vars_usage(B1_TYPED_VALUE &v, bool read)
+B1C_T_ERROR B1FileCompiler::calc_vars_usage(const B1_TYPED_VALUE &v, bool read, std::vector<std::pair<B1_ATOM, int>> &usage)
 {
 	if(v.value.empty())
 	{
@@ -9048,22 +12360,22 @@ B1C_T_ERROR B1FileCompiler::calc_vars_usage(B1_TYPED_VALUE &v, bool read)
 	}
 
 	// simple variable
-	_compiler.mark_var_used(v.value, read);
+	mark_var_used(v.value, read, usage);
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::calc_vars_usage(B1_CMP_ARG &a, bool read)
+B1C_T_ERROR B1FileCompiler::calc_vars_usage(const B1_CMP_ARG &a, bool read, std::vector<std::pair<B1_ATOM, int>> &usage)
 {
 	if(a.size() == 1)
 	{
-		return calc_vars_usage(a[0], read);
+		return calc_vars_usage(a[0], read, usage);
 	}
 
 	// process arguments first
 	for(auto aa = a.begin() + 1; aa != a.end(); aa++)
 	{
-		auto err = calc_vars_usage(*aa, true);
+		auto err = calc_vars_usage(*aa, true, usage);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			return err;
@@ -9084,160 +12396,291 @@ B1C_T_ERROR B1FileCompiler::calc_vars_usage(B1_CMP_ARG &a, bool read)
 	}
 
 	// subscripted variable
-	_compiler.mark_var_used(a[0].value, read);
+	mark_var_used(a[0].value, read, usage);
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::calc_vars_usage()
+// calculates usage of the variables the command uses
+B1C_T_ERROR B1FileCompiler::calc_vars_usage(const B1_CMP_CMD &cmd, std::vector<std::pair<B1_ATOM, int>> &usage)
 {
 	B1C_T_ERROR err;
 
-	for(auto &cmd: *this)
+	// restore code line identification values (to display error position properly)
+	_curr_line_cnt = cmd.line_cnt;
+	_curr_line_num = cmd.line_num;
+	_curr_src_line_id = cmd.src_line_id;
+
+	if(B1CUtils::is_label(cmd))
 	{
-		// restore code line identification values (to display error position properly)
-		_curr_line_cnt = cmd.line_cnt;
-		_curr_line_num = cmd.line_num;
-		_curr_src_line_id = cmd.src_line_id;
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
 
-		if(B1CUtils::is_label(cmd))
+	if(cmd.cmd == L"GF" || cmd.cmd == L"LA" || cmd.cmd == L"LF" || cmd.cmd == L"NS" ||
+		cmd.cmd == L"CALL" || cmd.cmd == L"JMP" || cmd.cmd == L"JF" || cmd.cmd == L"JT" ||
+		cmd.cmd == L"END" || cmd.cmd == L"RET" || cmd.cmd == L"DAT" || cmd.cmd == L"RST" ||
+		cmd.cmd == L"ERR" || cmd.cmd == L"DEF" || cmd.cmd == L"INT")
+	{
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
+
+	if(B1CUtils::is_log_op(cmd))
+	{
+		err = calc_vars_usage(cmd.args[0], true, usage);
+		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
-			continue;
+			return err;
 		}
 
-		if(cmd.cmd == L"GF" || cmd.cmd == L"LA" || cmd.cmd == L"LF" || cmd.cmd == L"NS" ||
-			cmd.cmd == L"CALL" || cmd.cmd == L"JMP" || cmd.cmd == L"JF" || cmd.cmd == L"JT" ||
-			cmd.cmd == L"END" || cmd.cmd == L"RET" || cmd.cmd == L"DAT" || cmd.cmd == L"RST" ||
-			cmd.cmd == L"ERR" || cmd.cmd == L"DEF" || cmd.cmd == L"INT")
+		return calc_vars_usage(cmd.args[1], true, usage);
+	}
+
+	if(B1CUtils::is_un_op(cmd))
+	{
+		err = calc_vars_usage(cmd.args[0], true, usage);
+		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
-			continue;
+			return err;
 		}
 
-		if(B1CUtils::is_log_op(cmd))
+		return calc_vars_usage(cmd.args[1], false, usage);
+	}
+
+	if(B1CUtils::is_bin_op(cmd))
+	{
+		err = calc_vars_usage(cmd.args[0], true, usage);
+		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
-			err = calc_vars_usage(cmd.args[0], true);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
-			err = calc_vars_usage(cmd.args[1], true);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
+			return err;
 		}
-		else
-		if(B1CUtils::is_un_op(cmd))
+
+		err = calc_vars_usage(cmd.args[1], true, usage);
+		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
-			err = calc_vars_usage(cmd.args[0], true);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
+			return err;
+		}
 
-			err = calc_vars_usage(cmd.args[1], false);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
+		return calc_vars_usage(cmd.args[2], false, usage);
+	}
+
+	// PUT, GET and TRR is a special case
+	if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
+	{
+		bool read = (cmd.cmd == L"PUT");
+
+		err = calc_vars_usage(cmd.args[1], read, usage);
+		if(err != B1C_T_ERROR::B1C_RES_OK)
+		{
+			return err;
 		}
-		else
-		if(B1CUtils::is_bin_op(cmd))
+
+		if(cmd.args.size() != 2)
 		{
-			err = calc_vars_usage(cmd.args[0], true);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
+			return calc_vars_usage(cmd.args[2], true, usage);
+		}
 
-			err = calc_vars_usage(cmd.args[1], true);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
 
-			err = calc_vars_usage(cmd.args[2], false);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
-			}
+	for(auto a = cmd.args.begin(); a != cmd.args.end(); a++)
+	{
+		bool read = true;
+
+		if(cmd.cmd == L"GA" && a < cmd.args.begin() + 2)
+		{
+			continue;
 		}
-		else
+		if(cmd.cmd == L"MA" && a < cmd.args.begin() + 3)
 		{
-			// PUT, GET and TRR is a special case
-			if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
-			{
-				bool read = (cmd.cmd == L"PUT");
+			continue;
+		}
+		if(cmd.cmd == L"RETVAL" && a != cmd.args.begin())
+		{
+			continue;
+		}
+		if(cmd.cmd == L"OUT" && a != cmd.args.begin() + 1)
+		{
+			continue;
+		}
+		if(cmd.cmd == L"IN" && a != cmd.args.begin() + 1)
+		{
+			continue;
+		}
+		if(cmd.cmd == L"SET" && a != cmd.args.begin() + 1)
+		{
+			continue;
+		}
+		if(cmd.cmd == L"IOCTL" && a != cmd.args.begin() + 2)
+		{
+			continue;
+		}
+		if(cmd.cmd == L"READ" && a == cmd.args.begin())
+		{
+			continue;
+		}
 
-				err = calc_vars_usage(cmd.args[1], read);
-				if(err != B1C_T_ERROR::B1C_RES_OK)
-				{
-					return err;
-				}
+		if(cmd.cmd == L"IN" || cmd.cmd == L"READ")
+		{
+			read = false;
+		}
 
-				if(cmd.args.size() != 2)
-				{
-					err = calc_vars_usage(cmd.args[2], true);
-					if(err != B1C_T_ERROR::B1C_RES_OK)
-					{
-						return err;
-					}
-				}
+		err = calc_vars_usage(*a, read, usage);
+		if(err != B1C_T_ERROR::B1C_RES_OK)
+		{
+			return err;
+		}
+	}
 
-				continue;
-			}
+	return B1C_T_ERROR::B1C_RES_OK;
+}
 
-			for(auto a = cmd.args.begin(); a != cmd.args.end(); a++)
-			{
-				bool read = true;
+void B1FileCompiler::mark_var_used(const B1_ATOM &name, bool for_read, std::vector<std::pair<B1_ATOM, int>> &usage)
+{
+	auto v = std::find_if(usage.begin(), usage.end(), [&name](const std::pair<B1_ATOM, int> &u) { return u.first == name; });
+	if(v == usage.end())
+	{
+		usage.push_back(std::make_pair(name, for_read ? 1 : 2));
+	}
+	else
+	{
+		v->second = v->second | (for_read ? 1 : 2);
+	}
+}
 
-				if(cmd.cmd == L"GA" && a < cmd.args.begin() + 2)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"MA" && a < cmd.args.begin() + 3)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"RETVAL" && a != cmd.args.begin())
-				{
-					continue;
-				}
-				if(cmd.cmd == L"OUT" && a != cmd.args.begin() + 1)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"IN" && a != cmd.args.begin() + 1)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"SET" && a != cmd.args.begin() + 1)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"IOCTL" && a != cmd.args.begin() + 2)
-				{
-					continue;
-				}
-				if(cmd.cmd == L"READ" && a == cmd.args.begin())
-				{
-					continue;
-				}
+// recalculates usage of the variable in the file code from the commands using it and saves its previous value
+void B1FileCompiler::update_var_usage(const std::wstring &name)
+{
+	int usage = 0;
+
+	auto vc = _var_cmds.find(name);
+	if(vc != _var_cmds.end())
+	{
+		for(const auto &c: vc->second)
+		{
+			usage |= c.second;
+		}
+
+		if(usage == 0)
+		{
+			_var_cmds.erase(vc);
+		}
+	}
+
+	auto v = _vars_usage.find(name);
+	const int prev_usage = (v == _vars_usage.end()) ? 0 : v->second;
+
+	if(usage == prev_usage)
+	{
+		return;
+	}
+
+	// the first change made since the last B1Compiler::recalc_vars_usage() call keeps the previous value
+	_vars_usage_changes.insert(std::make_pair(name, prev_usage));
+
+	if(usage == 0)
+	{
+		_vars_usage.erase(v);
+	}
+	else
+	{
+		_vars_usage[name] = usage;
+	}
+}
+
+// removes the command from the variables usage index, the variables it used are added to vars
+void B1FileCompiler::remove_cmd_vars_usage(B1_CMP_CMD *cmd, std::set<std::wstring> &vars)
+{
+	_io_cnt_cmds.erase(cmd);
+
+	auto cu = _cmd_vars_usage.find(cmd);
+	if(cu == _cmd_vars_usage.end())
+	{
+		return;
+	}
+
+	for(const auto &u: cu->second)
+	{
+		auto vc = _var_cmds.find(u.first.str());
+		if(vc != _var_cmds.end())
+		{
+			vc->second.erase(cmd);
+		}
+		vars.insert(u.first.str());
+	}
+
+	_cmd_vars_usage.erase(cu);
+}
+
+// adds the command to the variables usage index, the variables it uses are added to vars
+B1C_T_ERROR B1FileCompiler::add_cmd_vars_usage(B1_CMP_CMD &cmd, std::set<std::wstring> &vars)
+{
+	std::vector<std::pair<B1_ATOM, int>> usage;
+
+	auto err = calc_vars_usage(cmd, usage);
+	if(err != B1C_T_ERROR::B1C_RES_OK)
+	{
+		return err;
+	}
+
+	// remove_unused_vars() removes explicit number of values equal to 1
+	if((cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR") && cmd.args.size() != 2)
+	{
+		_io_cnt_cmds.insert(&cmd);
+	}
+
+	if(usage.empty())
+	{
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
 
-				if(cmd.cmd == L"IN" || cmd.cmd == L"READ")
-				{
-					read = false;
-				}
+	for(const auto &u: usage)
+	{
+		_var_cmds[u.first.str()][&cmd] = u.second;
+		vars.insert(u.first.str());
+	}
 
-				err = calc_vars_usage(*a, read);
-				if(err != B1C_T_ERROR::B1C_RES_OK)
-				{
-					return err;
-				}
-			}
+	_cmd_vars_usage[&cmd] = std::move(usage);
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+// updates the variables usage index with the commands changed since the previous call, the first call builds the
+// index (all the commands are logged as inserted ones when the changes tracking starts)
+B1C_T_ERROR B1FileCompiler::calc_vars_usage()
+{
+	std::vector<B1_CMP_CMD *> changed;
+	std::vector<B1_CMP_CMD *> removed;
+	std::set<std::wstring> vars;
+
+	if(!_vars_usage_valid)
+	{
+		track_changes();
+		_vars_usage_valid = true;
+	}
+
+	get_changes(changed, removed);
+
+	for(auto cmd: removed)
+	{
+		remove_cmd_vars_usage(cmd, vars);
+	}
+
+	for(auto cmd: changed)
+	{
+		remove_cmd_vars_usage(cmd, vars);
+
+		auto err = add_cmd_vars_usage(*cmd, vars);
+		if(err != B1C_T_ERROR::B1C_RES_OK)
+		{
+			return err;
 		}
 	}
 
+	for(const auto &v: vars)
+	{
+		update_var_usage(v);
+	}
+
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
@@ -9425,6 +12868,8 @@ B1FileCompiler::B1FileCompiler(B1Compiler &compiler, const std::wstring &name_sp
 , _opt_nocheck(false)
 , _opt_inputdevice_def(true)
 , _opt_outputdevice_def(true)
+, _prog_file_loaded(false)
+, _vars_usage_valid(false)
 {
 }
 
@@ -9436,15 +12881,31 @@ B1FileCompiler::~B1FileCompiler()
 
 B1C_T_ERROR B1FileCompiler::Load(const std::string &file_name)
 {
+	TRepStage trep_stage("Load");
+
 	b1_reset();
 
+	auto prev_file_name = _file_name;
+
 	_int_name = _global_settings.GetInterruptName(file_name, _file_name);
 
+	// the file is loaded and tokenized once: the next runs replay its lines from _prog_lines
+	if(!_prog_lines.empty() && prev_file_name == _file_name)
+	{
+		_prog_file_loaded = false;
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
+
+	_prog_lines.clear();
+	_prog_file_loaded = true;
+
 	return static_cast<B1C_T_ERROR>(b1_ex_prg_set_prog_file(_file_name.c_str()));
 }
 
 B1C_T_ERROR B1FileCompiler::FirstRun()
 {
+	TRepStage trep_stage("FirstRun");
+
 	B1_T_ERROR err;
 	B1C_T_ERROR err1;
 	uint8_t stmt;
@@ -9460,7 +12921,7 @@ B1C_T_ERROR B1FileCompiler::FirstRun()
 
 	while(true)
 	{
-		err = b1_ex_prg_get_prog_line(B1_T_LINE_NUM_NEXT);
+		err = get_prog_line();
 		// do not treat B1_RES_EPROGUNEND as error in this case: just program end
 		if(err == B1_RES_EPROGUNEND)
 		{
@@ -9562,6 +13023,21 @@ B1C_T_ERROR B1FileCompiler::FirstRun()
 
 		if(stmt == B1_ID_STMT_END)
 		{
+			B1_CMP_SEL_STMT sel_stmt;
+			B1_T_INDEX sel_off;
+
+			// END SELECT statement
+			err = get_select_stmt(stmt, sel_stmt, sel_off);
+			if(err != B1_RES_OK)
+			{
+				break;
+			}
+
+			if(sel_stmt == B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_END)
+			{
+				continue;
+			}
+
 			if(endstmt)
 			{
 				//warning: using multiple END statements is not recommended
@@ -9592,6 +13068,8 @@ B1C_T_ERROR B1FileCompiler::FirstRun()
 
 B1C_T_ERROR B1FileCompiler::Compile()
 {
+	TRepStage trep_stage("Compile");
+
 	B1_T_ERROR err;
 	B1C_T_ERROR err1;
 	uint8_t stmt;
@@ -9621,7 +13099,7 @@ B1C_T_ERROR B1FileCompiler::Compile()
 	{
 		_curr_src_line_id++;
 
-		err = b1_ex_prg_get_prog_line(B1_T_LINE_NUM_NEXT);
+		err = get_prog_line();
 		// do not treat B1_RES_EPROGUNEND as error in this case: just program end
 		if(err == B1_RES_EPROGUNEND)
 		{
@@ -9758,6 +13236,81 @@ B1C_T_ERROR B1FileCompiler::Compile()
 			_state_stack.pop_back();
 		}
 
+		B1_CMP_SEL_STMT sel_stmt;
+		B1_T_INDEX sel_off;
+
+		err = get_select_stmt(stmt, sel_stmt, sel_off);
+		if(err != B1_RES_OK)
+		{
+			break;
+		}
+
+		// CASE outside of SELECT CASE block is a variable name
+		if(sel_stmt == B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_CASE && _state.first != B1_CMP_STATE::B1_CMP_STATE_SELECT)
+		{
+			sel_stmt = B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_NONE;
+		}
+
+		// SELECT CASE statement must be followed by CASE clause or END SELECT statement
+		if(	_state.first == B1_CMP_STATE::B1_CMP_STATE_SELECT && _state.second[4].empty() &&
+			sel_stmt != B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_CASE && sel_stmt != B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_END)
+		{
+			err = B1_RES_ESYNTAX;
+			break;
+		}
+
+		if(sel_stmt == B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_SELECT)
+		{
+			b1_curr_prog_line_offset = sel_off;
+
+			_state_stack.push_back(_state);
+			_state.first = B1_CMP_STATE::B1_CMP_STATE_SELECT;
+			_state.second.clear();
+
+			err1 = st_select();
+			if(err1 != B1C_T_ERROR::B1C_RES_OK)
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		if(sel_stmt == B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_CASE)
+		{
+			b1_curr_prog_line_offset = sel_off;
+
+			err1 = st_case();
+			if(err1 != B1C_T_ERROR::B1C_RES_OK)
+			{
+				break;
+			}
+
+			continue;
+		}
+
+		if(sel_stmt == B1_CMP_SEL_STMT::B1_CMP_SEL_STMT_END)
+		{
+			if(_state.first != B1_CMP_STATE::B1_CMP_STATE_SELECT)
+			{
+				err1 = B1C_T_ERROR::B1C_RES_EENDWOSEL;
+				break;
+			}
+
+			b1_curr_prog_line_offset = sel_off;
+
+			err1 = st_end_select();
+			if(err1 != B1C_T_ERROR::B1C_RES_OK)
+			{
+				break;
+			}
+
+			_state = _state_stack.back();
+			_state_stack.pop_back();
+
+			continue;
+		}
+
 		if(stmt == B1_ID_STMT_IF)
 		{
 			_state_stack.push_back(_state);
@@ -9910,6 +13463,11 @@ B1C_T_ERROR B1FileCompiler::Compile()
 		{
 			return static_cast<B1C_T_ERROR>(B1_RES_EWHILEWOWND);
 		}
+		else
+		if(_state.first == B1_CMP_STATE::B1_CMP_STATE_SELECT)
+		{
+			return B1C_T_ERROR::B1C_RES_ESELWOEND;
+		}
 
 		return static_cast<B1C_T_ERROR>(B1_RES_ESYNTAX);
 	}
@@ -9920,7 +13478,7 @@ B1C_T_ERROR B1FileCompiler::Compile()
 		b1_curr_prog_line_cnt = def.first - 1;
 		_curr_src_line_id = def.second;
 
-		err = b1_ex_prg_get_prog_line(B1_T_LINE_NUM_NEXT);
+		err = get_prog_line();
 		if(err != B1_RES_OK)
 		{
 			return static_cast<B1C_T_ERROR>(err);
@@ -10065,7 +13623,7 @@ B1C_T_ERROR B1FileCompiler::put_fn_def_values()
 		{
 			for(auto a = cmd.args.begin() + 2; a != cmd.args.end(); a++)
 			{
-				auto &arg = *a;
+				auto &arg = cmd.edit_args()[a - cmd.args.begin()];
 				err = put_fn_def_values(arg);
 				if(err != B1C_T_ERROR::B1C_RES_OK)
 				{
@@ -10078,7 +13636,7 @@ B1C_T_ERROR B1FileCompiler::put_fn_def_values()
 
 		if(cmd.cmd == L"RETVAL")
 		{
-			err = put_fn_def_values(cmd.args[0]);
+			err = put_fn_def_values(cmd.edit_args()[0]);
 			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
 				return err;
@@ -10089,7 +13647,7 @@ B1C_T_ERROR B1FileCompiler::put_fn_def_values()
 
 		if(cmd.cmd == L"OUT")
 		{
-			err = put_fn_def_values(cmd.args[1]);
+			err = put_fn_def_values(cmd.edit_args()[1]);
 			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
 				return err;
@@ -10102,7 +13660,7 @@ B1C_T_ERROR B1FileCompiler::put_fn_def_values()
 		{
 			if(cmd.cmd == L"PUT")
 			{
-				err = put_fn_def_values(cmd.args[1]);
+				err = put_fn_def_values(cmd.edit_args()[1]);
 				if(err != B1C_T_ERROR::B1C_RES_OK)
 				{
 					return err;
@@ -10111,7 +13669,7 @@ B1C_T_ERROR B1FileCompiler::put_fn_def_values()
 
 			if(cmd.args.size() != 2)
 			{
-				err = put_fn_def_values(cmd.args[2]);
+				err = put_fn_def_values(cmd.edit_args()[2]);
 				if(err != B1C_T_ERROR::B1C_RES_OK)
 				{
 					return err;
@@ -10123,7 +13681,7 @@ B1C_T_ERROR B1FileCompiler::put_fn_def_values()
 
 		if(cmd.cmd == L"SET")
 		{
-			err = put_fn_def_values(cmd.args[1]);
+			err = put_fn_def_values(cmd.edit_args()[1]);
 			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
 				return err;
@@ -10134,7 +13692,7 @@ B1C_T_ERROR B1FileCompiler::put_fn_def_values()
 
 		if(cmd.cmd == L"XARG")
 		{
-			err = put_fn_def_values(cmd.args[0]);
+			err = put_fn_def_values(cmd.edit_args()[0]);
 			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
 				return err;
@@ -10147,7 +13705,7 @@ B1C_T_ERROR B1FileCompiler::put_fn_def_values()
 		{
 			if(cmd.args.size() > 2)
 			{
-				err = put_fn_def_values(cmd.args[2]);
+				err = put_fn_def_values(cmd.edit_args()[2]);
 				if(err != B1C_T_ERROR::B1C_RES_OK)
 				{
 					return err;
@@ -10159,7 +13717,7 @@ B1C_T_ERROR B1FileCompiler::put_fn_def_values()
 
 		if(B1CUtils::is_un_op(cmd))
 		{
-			err = put_fn_def_values(cmd.args[0]);
+			err = put_fn_def_values(cmd.edit_args()[0]);
 			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
 				return err;
@@ -10170,13 +13728,13 @@ B1C_T_ERROR B1FileCompiler::put_fn_def_values()
 
 		if(B1CUtils::is_bin_op(cmd) || B1CUtils::is_log_op(cmd))
 		{
-			err = put_fn_def_values(cmd.args[0]);
+			err = put_fn_def_values(cmd.edit_args()[0]);
 			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
 				return err;
 			}
 
-			err = put_fn_def_values(cmd.args[1]);
+			err = put_fn_def_values(cmd.edit_args()[1]);
 			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
 				return err;
@@ -10209,6 +13767,8 @@ std::wstring B1FileCompiler::replace_type_spec(const std::wstring &token) const
 // puts values and variables types, functions types and def. values and makes some essential optimzations
 B1C_T_ERROR B1FileCompiler::PutTypesAndOptimize()
 {
+	TRepStage trep_stage("PutTypesAndOptimize");
+
 	B1C_T_ERROR err = B1C_T_ERROR::B1C_RES_OK;
 	bool stop, changed;
 
@@ -10222,155 +13782,15 @@ B1C_T_ERROR B1FileCompiler::PutTypesAndOptimize()
 	if(err != B1C_T_ERROR::B1C_RES_OK)
 	{
 		return err;
-	}
-
-	stop = false;
-
-	while(!stop)
-	{
-		stop = true;
-
-		err = inline_fns(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-
-		err = remove_unused_labels(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-
-		err = remove_duplicate_labels(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-
-		err = remove_self_assigns(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-
-		err = remove_duplicate_assigns(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-
-		err = remove_jumps(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-
-		err = eval_unary_ops(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-
-		err = remove_locals(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-
-		err = reuse_locals(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-
-		err = eval_imm_exps(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-	}
-
-	if(err != B1C_T_ERROR::B1C_RES_OK)
-	{
-		return err;
-	}
-
-	return B1C_T_ERROR::B1C_RES_OK;
-}
-
-B1C_T_ERROR B1FileCompiler::Optimize(bool init)
-{
-	B1C_T_ERROR err;
-	bool stop, changed;
-
-	stop = false;
-
-	while(!stop)
-	{
-		stop = true;
-
-		err = remove_unused_labels(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-
-		err = remove_duplicate_labels(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
+	}
 
-		err = remove_self_assigns(changed);
+	stop = false;
+
+	while(!stop)
+	{
+		stop = true;
+
+		err = inline_fns(changed);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			break;
@@ -10380,7 +13800,7 @@ B1C_T_ERROR B1FileCompiler::Optimize(bool init)
 			stop = false;
 		}
 
-		err = remove_duplicate_assigns(changed);
+		err = remove_unused_labels(changed);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			break;
@@ -10390,7 +13810,7 @@ B1C_T_ERROR B1FileCompiler::Optimize(bool init)
 			stop = false;
 		}
 
-		err = remove_jumps(changed);
+		err = remove_duplicate_labels(changed);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			break;
@@ -10400,7 +13820,7 @@ B1C_T_ERROR B1FileCompiler::Optimize(bool init)
 			stop = false;
 		}
 
-		err = remove_redundant_comparisons(changed);
+		err = remove_self_assigns(changed);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			break;
@@ -10420,7 +13840,7 @@ B1C_T_ERROR B1FileCompiler::Optimize(bool init)
 			stop = false;
 		}
 
-		err = eval_unary_ops(changed);
+		err = remove_jumps(changed);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			break;
@@ -10430,7 +13850,7 @@ B1C_T_ERROR B1FileCompiler::Optimize(bool init)
 			stop = false;
 		}
 
-		err = reuse_imm_values(init, changed);
+		err = eval_unary_ops(changed);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			break;
@@ -10460,16 +13880,6 @@ B1C_T_ERROR B1FileCompiler::Optimize(bool init)
 			stop = false;
 		}
 
-		err = reuse_vars(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
-
 		err = eval_imm_exps(changed);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
@@ -10479,35 +13889,153 @@ B1C_T_ERROR B1FileCompiler::Optimize(bool init)
 		{
 			stop = false;
 		}
+	}
 
-		err = remove_unused_vars(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
+	if(err != B1C_T_ERROR::B1C_RES_OK)
+	{
+		return err;
+	}
 
-		err = inline_fns(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
-		{
-			stop = false;
-		}
+	return B1C_T_ERROR::B1C_RES_OK;
+}
 
-		err = optimize_GA_GF(changed);
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			break;
-		}
-		if(changed)
+B1C_T_ERROR B1FileCompiler::run_opt_pass(B1_CMP_OPT_PASS pass, bool init, bool &changed)
+{
+	switch(pass)
+	{
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_UNUSED_LABELS:
+			return remove_unused_labels(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_DUPLICATE_LABELS:
+			return remove_duplicate_labels(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_SELF_ASSIGNS:
+			return remove_self_assigns(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_JUMPS:
+			return remove_jumps(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_REDUNDANT_COMPARISONS:
+			return remove_redundant_comparisons(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_DUPLICATE_ASSIGNS:
+			return remove_duplicate_assigns(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_EVAL_UNARY_OPS:
+			return eval_unary_ops(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REUSE_IMM_VALUES:
+			return reuse_imm_values(init, changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REUSE_EXPS:
+			return reuse_exps(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_LOCALS:
+			return remove_locals(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REUSE_LOCALS:
+			return reuse_locals(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REUSE_VARS:
+			return reuse_vars(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_EVAL_IMM_EXPS:
+			return eval_imm_exps(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_UNUSED_VARS:
+			return remove_unused_vars(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_INLINE_FNS:
+			return inline_fns(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_INLINE_UFNS:
+			return inline_ufns(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_OPTIMIZE_GA_GF:
+			return optimize_GA_GF(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_OPTIMIZE_LOOPS:
+			return optimize_loops(changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_NARROW_LOCALS:
+			return narrow_locals(init, changed);
+		case B1_CMP_OPT_PASS::B1_CMP_OPT_NARROW_CMPS:
+			return narrow_cmps(init, changed);
+	}
+
+	changed = false;
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+// kinds of code changes made by optimization passes
+// labels and jumps
+#define B1C_OPT_CHG_FLOW 1
+// commands removed or added
+#define B1C_OPT_CHG_CMDS 2
+// command arguments replaced (e.g. variables with values)
+#define B1C_OPT_CHG_ARGS 4
+#define B1C_OPT_CHG_ALL (B1C_OPT_CHG_FLOW | B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS)
+
+// maximal number of optimization pass runs per file (the code is correct after every pass so optimizing
+// can be stopped at any moment if the passes do not converge)
+#define B1C_OPT_MAX_PASS_RUNS 10000
+
+B1C_T_ERROR B1FileCompiler::Optimize(bool init)
+{
+	TRepStage trep_stage("Optimize");
+
+	// passes in order of execution, a pass runs again only after the code changes it depends on
+	//                         pass             name         changes made  changes the pass depends on
+	static const std::tuple<B1_CMP_OPT_PASS, const char *, int,          int> passes[] =
+	{
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_UNUSED_LABELS, "remove_unused_labels", B1C_OPT_CHG_FLOW | B1C_OPT_CHG_CMDS, B1C_OPT_CHG_FLOW),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_DUPLICATE_LABELS, "remove_duplicate_labels", B1C_OPT_CHG_FLOW, B1C_OPT_CHG_FLOW | B1C_OPT_CHG_CMDS),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_SELF_ASSIGNS, "remove_self_assigns", B1C_OPT_CHG_CMDS, B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_JUMPS, "remove_jumps", B1C_OPT_CHG_FLOW | B1C_OPT_CHG_CMDS, B1C_OPT_CHG_FLOW | B1C_OPT_CHG_CMDS),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_REDUNDANT_COMPARISONS, "remove_redundant_comparisons", B1C_OPT_CHG_FLOW | B1C_OPT_CHG_CMDS, B1C_OPT_CHG_ALL),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_DUPLICATE_ASSIGNS, "remove_duplicate_assigns", B1C_OPT_CHG_CMDS, B1C_OPT_CHG_ALL),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_EVAL_UNARY_OPS, "eval_unary_ops", B1C_OPT_CHG_ARGS, B1C_OPT_CHG_ARGS),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REUSE_IMM_VALUES, "reuse_imm_values", B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS, B1C_OPT_CHG_ALL),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REUSE_EXPS, "reuse_exps", B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS, B1C_OPT_CHG_ALL),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_LOCALS, "remove_locals", B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS, B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REUSE_LOCALS, "reuse_locals", B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS, B1C_OPT_CHG_ALL),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REUSE_VARS, "reuse_vars", B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS, B1C_OPT_CHG_ALL),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_EVAL_IMM_EXPS, "eval_imm_exps", B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS, B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_REMOVE_UNUSED_VARS, "remove_unused_vars", B1C_OPT_CHG_CMDS, B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_INLINE_FNS, "inline_fns", B1C_OPT_CHG_ALL, B1C_OPT_CHG_ALL),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_INLINE_UFNS, "inline_ufns", B1C_OPT_CHG_ALL, B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_OPTIMIZE_GA_GF, "optimize_GA_GF", B1C_OPT_CHG_CMDS, B1C_OPT_CHG_ALL),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_OPTIMIZE_LOOPS, "optimize_loops", B1C_OPT_CHG_CMDS | B1C_OPT_CHG_ARGS, B1C_OPT_CHG_ALL),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_NARROW_LOCALS, "narrow_locals", B1C_OPT_CHG_ARGS, B1C_OPT_CHG_ALL),
+		std::make_tuple(B1_CMP_OPT_PASS::B1_CMP_OPT_NARROW_CMPS, "narrow_cmps", B1C_OPT_CHG_ARGS, B1C_OPT_CHG_ALL),
+	};
+	const int passes_num = sizeof(passes) / sizeof(passes[0]);
+
+	B1C_T_ERROR err = B1C_T_ERROR::B1C_RES_OK;
+	// passes to run: all of them at first
+	std::vector<bool> pending(passes_num, true);
+	int runs = 0;
+	bool stop = false;
+
+	while(!stop && runs < B1C_OPT_MAX_PASS_RUNS)
+	{
+		stop = true;
+
+		for(int p = 0; p < passes_num && runs < B1C_OPT_MAX_PASS_RUNS; p++)
 		{
-			stop = false;
+			if(!pending[p])
+			{
+				continue;
+			}
+
+			pending[p] = false;
+			runs++;
+
+			bool changed = false;
+			{
+				TRepPass trep_pass(std::get<1>(passes[p]));
+				err = run_opt_pass(std::get<0>(passes[p]), init, changed);
+				trep_pass.changed = changed;
+			}
+			if(err != B1C_T_ERROR::B1C_RES_OK)
+			{
+				return err;
+			}
+
+			if(changed)
+			{
+				// schedule the passes that can find something new after the change
+				for(int p1 = 0; p1 < passes_num; p1++)
+				{
+					if(std::get<3>(passes[p1]) & std::get<2>(passes[p]))
+					{
+						pending[p1] = true;
+						stop = false;
+					}
+				}
+			}
 		}
 	}
 
@@ -10611,30 +14139,26 @@ B1C_T_ERROR B1FileCompiler::CheckGAStmts() const
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::WriteUFns(const std::string &file_name) const
+B1C_T_ERROR B1FileCompiler::WriteUFns(B1IRWriter &irw) const
 {
-	std::FILE *ofp = std::fopen(file_name.c_str(), "a");
-	if(ofp == nullptr)
-	{
-		return B1C_T_ERROR::B1C_RES_EFOPEN;
-	}
-
 	for(const auto &ufn: _ufns)
 	{
-		std::fwprintf(ofp, L"DEF,%ls,%ls", replace_type_spec(ufn.second.iname).c_str(), Utils::get_type_name(ufn.second.rettype).c_str());
+		std::vector<B1_CMP_ARG> args({ B1_CMP_ARG(replace_type_spec(ufn.second.iname)), B1_CMP_ARG(Utils::get_type_name(ufn.second.rettype)) });
 		for(const auto &arg: ufn.second.args)
 		{
-			std::fwprintf(ofp, L",%ls", Utils::get_type_name(arg.type).c_str());
+			args.push_back(B1_CMP_ARG(Utils::get_type_name(arg.type)));
 		}
-		std::fwprintf(ofp, L"\n");
-	}
 
-	std::fclose(ofp);
+		if(!irw.WriteCommand(L"DEF", args))
+		{
+			return B1C_T_ERROR::B1C_RES_EFWRITE;
+		}
+	}
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::WriteStmt(const B1_CMP_CMD &cmd, std::FILE *ofp, int &curr_line_id) const
+B1C_T_ERROR B1FileCompiler::WriteStmt(const B1_CMP_CMD &cmd, B1IRWriter &irw, int &curr_line_id) const
 {
 	if(_out_src_lines)
 	{
@@ -10645,7 +14169,7 @@ B1C_T_ERROR B1FileCompiler::WriteStmt(const B1_CMP_CMD &cmd, std::FILE *ofp, int
 			if(curr_line_id >= 0)
 			{
 				const auto ln = _src_lines.find(curr_line_id);
-				if(std::fwprintf(ofp, L";%ls\n", ln->second.c_str()) < 0)
+				if(!irw.WriteComment(ln->second))
 				{
 					return B1C_T_ERROR::B1C_RES_EFWRITE;
 				}
@@ -10655,65 +14179,38 @@ B1C_T_ERROR B1FileCompiler::WriteStmt(const B1_CMP_CMD &cmd, std::FILE *ofp, int
 
 	if(B1CUtils::is_label(cmd))
 	{
-		if(std::fwprintf(ofp, L":%ls", replace_type_spec(cmd.cmd).c_str()) < 0)
+		if(!irw.WriteLabel(replace_type_spec(cmd.cmd)))
 		{
 			return B1C_T_ERROR::B1C_RES_EFWRITE;
 		}
 	}
 	else
 	{
-		std::wstring sep;
-
-		if(std::fwprintf(ofp, L"%ls", cmd.cmd.c_str()) < 0)
-		{
-			return B1C_T_ERROR::B1C_RES_EFWRITE;
-		}
+		std::vector<B1_CMP_ARG> args;
 
 		for(auto arg = cmd.args.cbegin(); arg != cmd.args.cend(); arg++)
 		{
-			for(auto ai = arg->cbegin(); ai != arg->cend(); ai++)
-			{
-				sep = (ai == std::next(arg->cbegin())) ? L"(" : L",";
-				if(std::fwprintf(ofp, L"%ls%ls", sep.c_str(), replace_type_spec(ai->value).c_str()) < 0)
-				{
-					return B1C_T_ERROR::B1C_RES_EFWRITE;
-				}
-
-				if(ai->type != B1Types::B1T_UNKNOWN && !((cmd.cmd == L"LA" && arg == std::next(cmd.args.cbegin())) || ((cmd.cmd == L"GA" || cmd.cmd == L"MA") && arg == std::next(cmd.args.cbegin())) || (cmd.cmd == L"RETVAL" && arg == std::next(cmd.args.cbegin()))))
-				{
-					if(std::fwprintf(ofp, L"<%ls>", Utils::get_type_name(ai->type).c_str()) < 0)
-					{
-						return B1C_T_ERROR::B1C_RES_EFWRITE;
-					}
-				}
-			}
+			// variable and return value types are written without type specification
+			const bool no_type = (cmd.cmd == L"LA" || cmd.cmd == L"GA" || cmd.cmd == L"MA" || cmd.cmd == L"RETVAL") && arg == std::next(cmd.args.cbegin());
 
-			if(arg->size() > 1)
+			args.emplace_back();
+			for(const auto &a: *arg)
 			{
-				if(std::fwprintf(ofp, L")") < 0)
-				{
-					return B1C_T_ERROR::B1C_RES_EFWRITE;
-				}
+				args.back().push_back(B1_TYPED_VALUE(replace_type_spec(a.value), no_type ? B1Types::B1T_UNKNOWN : a.type));
 			}
 		}
-	}
 
-	if(std::fwprintf(ofp, L"\n") < 0)
-	{
-		return B1C_T_ERROR::B1C_RES_EFWRITE;
+		if(!irw.WriteCommand(cmd.cmd, args))
+		{
+			return B1C_T_ERROR::B1C_RES_EFWRITE;
+		}
 	}
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::WriteMAs(const std::string &file_name)
+B1C_T_ERROR B1FileCompiler::WriteMAs(B1IRWriter &irw)
 {
-	std::FILE *ofp = std::fopen(file_name.c_str(), "a");
-	if(ofp == nullptr)
-	{
-		return B1C_T_ERROR::B1C_RES_EFOPEN;
-	}
-
 	int line_id = -1;
 	for(const auto &c: _MA_stmts)
 	{
@@ -10726,10 +14223,9 @@ B1C_T_ERROR B1FileCompiler::WriteMAs(const std::string &file_name)
 			continue;
 		}
 
-		auto err = WriteStmt(c, ofp, line_id);
+		auto err = WriteStmt(c, irw, line_id);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
-			std::fclose(ofp);
 			return err;
 		}
 
@@ -10744,54 +14240,37 @@ B1C_T_ERROR B1FileCompiler::WriteMAs(const std::string &file_name)
 
 			// copy _curr_line_num, _curr_line_cnt, _curr_src_file_id, _curr_src_line_id members from GA statement
 			B1_CMP_CMD dc(c);
-			dc.cmd = L"DAT";
-			dc.args.clear();
-			dc.args.push_back(c.args[0][0].value);
+			dc.set_cmd(L"DAT");
+			dc.edit_args().clear();
+			dc.edit_args().push_back(c.args[0][0].value);
 			for(const auto &iv: init->second.second)
 			{
-				dc.args.push_back(B1_CMP_ARG(iv, init->second.first));
+				dc.edit_args().push_back(B1_CMP_ARG(iv, init->second.first));
 			}
 			_DAT_stmts.push_back(dc);
 		}
 	}
 
-	std::fclose(ofp);
-
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::WriteDATs(const std::string &file_name) const
+B1C_T_ERROR B1FileCompiler::WriteDATs(B1IRWriter &irw) const
 {
-	std::FILE *ofp = std::fopen(file_name.c_str(), "a");
-	if(ofp == nullptr)
-	{
-		return B1C_T_ERROR::B1C_RES_EFOPEN;
-	}
-
 	int line_id = -1;
 	for(const auto &c: _DAT_stmts)
 	{
-		auto err = WriteStmt(c, ofp, line_id);
+		auto err = WriteStmt(c, irw, line_id);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
-			std::fclose(ofp);
 			return err;
 		}
 	}
 
-	std::fclose(ofp);
-
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1FileCompiler::Write(const std::string &file_name) const
+B1C_T_ERROR B1FileCompiler::Write(B1IRWriter &irw) const
 {
-	std::FILE *ofp = std::fopen(file_name.c_str(), "a");
-	if(ofp == nullptr)
-	{
-		return B1C_T_ERROR::B1C_RES_EFOPEN;
-	}
-
 	int line_id = -1;
 
 	for(const auto &c: *this)
@@ -10806,16 +14285,13 @@ B1C_T_ERROR B1FileCompiler::Write(const std::string &file_name) const
 			}
 		}
 
-		auto err = WriteStmt(c, ofp, line_id);
+		auto err = WriteStmt(c, irw, line_id);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
-			std::fclose(ofp);
 			return err;
 		}
 	}
 
-	std::fclose(ofp);
-
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
@@ -11123,6 +14599,8 @@ B1C_T_ERROR B1Compiler::eval_const_vars_values()
 
 void B1Compiler::mark_var_used(const std::wstring &name, bool for_read)
 {
+	std::lock_guard<std::mutex> lock(_used_vars_mutex);
+
 	auto v = _used_vars.find(name);
 	if(v == _used_vars.end())
 	{
@@ -11147,41 +14625,291 @@ int B1Compiler::get_var_used(const std::wstring &name)
 	}
 }
 
+// updates _used_vars with the variables usage changes made in the files since the previous call, the first call
+// replaces the usage data collected when the files are compiled
 B1C_T_ERROR B1Compiler::recalc_vars_usage(bool &changed)
 {
-	int chksum = 0;
+	changed = false;
+
+	// the files update their variables usage indices with the commands changed since the previous call
+	auto err = process_files([](B1FileCompiler &fc, int)
+	{
+		return fc.calc_vars_usage();
+	});
+	if(err != B1C_T_ERROR::B1C_RES_OK)
+	{
+		return err;
+	}
+
+	// usage values of the changed variables before the update
+	std::map<std::wstring, int> prev_used_vars;
+
+	if(!_used_vars_valid)
+	{
+		prev_used_vars.swap(_used_vars);
+		_used_vars_files.clear();
+	}
+
+	for(auto &fc: _file_compilers)
+	{
+		for(const auto &v: fc._vars_usage_changes)
+		{
+			auto fu = fc._vars_usage.find(v.first);
+			const int usage = (fu == fc._vars_usage.end()) ? 0 : fu->second;
+
+			auto &files = _used_vars_files[v.first];
+			files.first += ((usage & 1) ? 1 : 0) - ((v.second & 1) ? 1 : 0);
+			files.second += ((usage & 2) ? 1 : 0) - ((v.second & 2) ? 1 : 0);
+			const int used = ((files.first > 0) ? 1 : 0) | ((files.second > 0) ? 2 : 0);
+
+			auto uv = _used_vars.find(v.first);
+
+			if(_used_vars_valid)
+			{
+				prev_used_vars.insert(std::make_pair(v.first, (uv == _used_vars.end()) ? 0 : uv->second));
+			}
+
+			if(used == 0)
+			{
+				_used_vars_files.erase(v.first);
+				if(uv != _used_vars.end())
+				{
+					_used_vars.erase(uv);
+				}
+			}
+			else
+			{
+				_used_vars[v.first] = used;
+			}
+		}
+
+		fc._vars_usage_changes.clear();
+	}
+
+	if(!_used_vars_valid)
+	{
+		changed = (prev_used_vars != _used_vars);
+		_used_vars_valid = true;
+
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
+
+	for(const auto &v: prev_used_vars)
+	{
+		if(get_var_used(v.first) != v.second)
+		{
+			changed = true;
+			break;
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
+// removes subroutines and user-defined functions unreachable from the program entries: the code beginning of
+// every file (the main program and interrupt handlers) and labels used indirectly (e.g. with IOCTL statement).
+// the files are processed together because global functions can be called from any file, the variables used
+// by the removed code only are removed by the next optimization round
+B1C_T_ERROR B1Compiler::remove_unreachable_code(bool &changed)
+{
+	TRepStage trep_stage("RemoveUnreachableCode");
+
+	changed = false;
+
+	std::vector<B1_CMP_FLOW> flows;
+	// label name -> file index, block index
+	std::map<std::wstring, std::pair<int, int>> labels;
+
+	flows.reserve(_file_compilers.size());
+
+	for(int f = 0; f < (int)_file_compilers.size(); f++)
+	{
+		flows.push_back(_file_compilers[f].get_flow());
+
+		const auto &blocks = flows.back().get_blocks();
+
+		for(int b = 0; b < (int)blocks.size(); b++)
+		{
+			for(auto i = blocks[b].first; i != blocks[b].last && B1CUtils::is_label(*i); i++)
+			{
+				labels[i->cmd] = std::make_pair(f, b);
+			}
+		}
+	}
+
+	std::vector<std::vector<bool>> reached;
+	std::vector<std::pair<int, int>> queue;
+
+	for(const auto &flow: flows)
+	{
+		reached.push_back(std::vector<bool>(flow.get_blocks().size(), false));
+	}
+
+	auto reach = [&reached, &queue](int f, int b)
+	{
+		if(!reached[f][b])
+		{
+			reached[f][b] = true;
+			queue.push_back(std::make_pair(f, b));
+		}
+	};
+
+	// every reference to a label or a function name makes its block reachable
+	auto reach_refs = [&labels, &reach](const B1_CMP_CMD &cmd)
+	{
+		for(const auto &a: cmd.args)
+		{
+			for(const auto &tv: a)
+			{
+				auto l = labels.find(tv.value);
+				if(l != labels.end())
+				{
+					reach(l->second.first, l->second.second);
+				}
+			}
+		}
+	};
+
+	for(int f = 0; f < (int)_file_compilers.size(); f++)
+	{
+		if(!reached[f].empty())
+		{
+			reach(f, 0);
+		}
+
+		for(const auto &cmd: _file_compilers[f]._MA_stmts)
+		{
+			reach_refs(cmd);
+		}
+
+		for(const auto &rl: _file_compilers[f]._req_labels)
+		{
+			auto l = labels.find(rl);
+			if(l != labels.end())
+			{
+				reach(l->second.first, l->second.second);
+			}
+		}
+	}
+
+	while(!queue.empty())
+	{
+		auto fb = queue.back();
+		queue.pop_back();
+
+		const auto &blk = flows[fb.first].get_blocks()[fb.second];
+
+		for(auto i = blk.first; i != blk.last; i++)
+		{
+			if(!B1CUtils::is_label(*i))
+			{
+				reach_refs(*i);
+			}
+		}
+
+		for(auto s: blk.succs)
+		{
+			reach(fb.first, s);
+		}
+	}
+
+	for(int f = 0; f < (int)_file_compilers.size(); f++)
+	{
+		auto &fc = _file_compilers[f];
+		const auto &blocks = flows[f].get_blocks();
+
+		std::set<const B1_CMP_CMD *> unreached;
+
+		for(int b = 0; b < (int)blocks.size(); b++)
+		{
+			if(!reached[f][b])
+			{
+				for(auto i = blocks[b].first; i != blocks[b].last; i++)
+				{
+					unreached.insert(&*i);
+				}
+			}
+		}
+
+		if(unreached.empty())
+		{
+			continue;
+		}
 
-	changed = false;
+		// LA and LF commands are removed in pairs only (the stack usage is checked along the code)
+		std::vector<B1_CMP_CMDS::iterator> las;
+		std::set<const B1_CMP_CMD *> keep_locals;
 
-	for(const auto &v: _used_vars)
-	{
-		chksum += v.second;
-	}
+		for(auto i = fc.begin(); i != fc.end(); i++)
+		{
+			if(B1CUtils::is_label(*i))
+			{
+				continue;
+			}
 
-	_used_vars.clear();
+			if(i->cmd == L"LA")
+			{
+				las.push_back(i);
+			}
+			else
+			if(i->cmd == L"LF" && !las.empty())
+			{
+				if(unreached.find(&*las.back()) == unreached.end() || unreached.find(&*i) == unreached.end())
+				{
+					keep_locals.insert(&*las.back());
+					keep_locals.insert(&*i);
+				}
 
-	for(auto &fc: _file_compilers)
-	{
-		_curr_file_name = fc.GetFileName();
+				las.pop_back();
+			}
+		}
 
-		auto err = fc.calc_vars_usage();
-		if(err != B1C_T_ERROR::B1C_RES_OK)
+		for(const auto &la: las)
 		{
-			b1_curr_prog_line_cnt = fc._curr_line_cnt;
-			return err;
+			keep_locals.insert(&*la);
 		}
-	}
 
-	int chksum1 = 0;
+		for(auto i = fc.begin(); i != fc.end(); )
+		{
+			auto next = std::next(i);
+			const auto &cmd = *i;
 
-	for(const auto &v: _used_vars)
-	{
-		chksum1 += v.second;
-	}
+			if(unreached.find(&cmd) != unreached.end())
+			{
+				bool remove = true;
 
-	if(chksum != chksum1)
-	{
-		changed = true;
+				if(B1CUtils::is_label(cmd))
+				{
+					// the function is not called: remove its definition
+					if(B1CUtils::is_def_fn(cmd))
+					{
+						if(fc._ufns.erase(cmd.cmd) == 0)
+						{
+							_global_ufns.erase(cmd.cmd);
+						}
+					}
+				}
+				else
+				if(cmd.cmd == L"LA" || cmd.cmd == L"LF")
+				{
+					remove = (keep_locals.find(&cmd) == keep_locals.end());
+				}
+				else
+				if(cmd.cmd == L"DAT" || cmd.cmd == L"DEF" || cmd.cmd == L"MA" || cmd.cmd == L"NS" || cmd.cmd == L"INT" || cmd.cmd == L"END" || (cmd.cmd == L"GA" && cmd.args[1].size() > 1))
+				{
+					remove = false;
+				}
+
+				if(remove)
+				{
+					fc._sub_labels.erase(cmd.cmd);
+					fc.erase(i);
+					changed = true;
+				}
+			}
+
+			i = next;
+		}
 	}
 
 	return B1C_T_ERROR::B1C_RES_OK;
@@ -11191,9 +14919,12 @@ B1C_T_ERROR B1Compiler::recalc_vars_usage(bool &changed)
 B1Compiler::B1Compiler(bool no_opt, bool out_src_lines)
 : _no_opt(no_opt)
 , _out_src_lines(out_src_lines)
+, _threads_num(1)
+, _inline_mode(B1C_INLINE_MODE::B1C_INLINE_SIZE)
 , _opt_explicit(false)
 , _opt_base1(false)
 , _opt_nocheck(false)
+, _used_vars_valid(false)
 {
 }
 
@@ -11201,6 +14932,16 @@ B1Compiler::~B1Compiler()
 {
 }
 
+void B1Compiler::SetThreadsNum(int threads_num)
+{
+	_threads_num = threads_num;
+}
+
+void B1Compiler::SetInlineMode(B1C_INLINE_MODE inline_mode)
+{
+	_inline_mode = inline_mode;
+}
+
 B1C_T_ERROR B1Compiler::Load(const std::vector<std::string> &file_names)
 {
 	_curr_file_name.clear();
@@ -11213,6 +14954,76 @@ B1C_T_ERROR B1Compiler::Load(const std::vector<std::string> &file_names)
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
+// calls fn for every file compiler, the files are processed in parallel if more than one thread is allowed:
+// fn can change the file compiler's own data only (B1Compiler data can be read or updated with mark_var_used),
+// the error of the first file in the source files order is returned so the result does not depend on threads scheduling
+B1C_T_ERROR B1Compiler::process_files(const std::function<B1C_T_ERROR(B1FileCompiler &, int)> &fn)
+{
+	const int files_num = _file_compilers.size();
+	int threads_num = (_threads_num == 0) ? (int)std::thread::hardware_concurrency() : _threads_num;
+
+	if(threads_num > files_num)
+	{
+		threads_num = files_num;
+	}
+
+	if(threads_num <= 1)
+	{
+		for(int i = 0; i < files_num; i++)
+		{
+			auto &fc = _file_compilers[i];
+
+			_curr_file_name = fc.GetFileName();
+
+			auto err = fn(fc, i);
+			if(err != B1C_T_ERROR::B1C_RES_OK)
+			{
+				b1_curr_prog_line_cnt = fc._curr_line_cnt;
+				return err;
+			}
+		}
+
+		return B1C_T_ERROR::B1C_RES_OK;
+	}
+
+	std::vector<B1C_T_ERROR> errs(files_num, B1C_T_ERROR::B1C_RES_OK);
+	std::atomic<int> next_file(0);
+
+	auto worker = [this, &fn, &errs, &next_file, files_num]()
+	{
+		for(int i = next_file++; i < files_num; i = next_file++)
+		{
+			errs[i] = fn(_file_compilers[i], i);
+		}
+	};
+
+	std::vector<std::thread> threads;
+
+	for(int i = 1; i < threads_num; i++)
+	{
+		threads.emplace_back(worker);
+	}
+
+	worker();
+
+	for(auto &t: threads)
+	{
+		t.join();
+	}
+
+	for(int i = 0; i < files_num; i++)
+	{
+		if(errs[i] != B1C_T_ERROR::B1C_RES_OK)
+		{
+			_curr_file_name = _file_compilers[i].GetFileName();
+			b1_curr_prog_line_cnt = _file_compilers[i]._curr_line_cnt;
+			return errs[i];
+		}
+	}
+
+	return B1C_T_ERROR::B1C_RES_OK;
+}
+
 B1C_T_ERROR B1Compiler::Compile()
 {
 	_opt_explicit = false;
@@ -11339,19 +15150,16 @@ B1C_T_ERROR B1Compiler::Compile()
 	// change the function names to their generated names like MAX -> __DEF_MAX
 	change_global_ufn_names();
 
-	for(auto &fc: _file_compilers)
+	// the stages below do not use b1core (its state is global), so the files can be processed in parallel,
+	// on error process_files restores code line counter value (after compilation it is set to the line after the last one)
+	err = process_files([](B1FileCompiler &fc, int)
 	{
-		_curr_file_name = fc.GetFileName();
-
 		fc.change_ufn_names();
-
-		auto err = fc.PutTypesAndOptimize();
-		if(err != B1C_T_ERROR::B1C_RES_OK)
-		{
-			// restore code line counter value (after compilation it is set to the line after the last one)
-			b1_curr_prog_line_cnt = fc._curr_line_cnt;
-			return err;
-		}
+		return fc.PutTypesAndOptimize();
+	});
+	if(err != B1C_T_ERROR::B1C_RES_OK)
+	{
+		return err;
 	}
 
 	// set proper varref names
@@ -11368,26 +15176,31 @@ B1C_T_ERROR B1Compiler::Compile()
 
 		while(changed)
 		{
-			bool init = true;
+			// variables usage data is only read here, it is recalculated after all the files are optimized
+			auto err = process_files([](B1FileCompiler &fc, int fc_ind)
+			{
+				return fc.Optimize(fc_ind == 0);
+			});
+			if(err != B1C_T_ERROR::B1C_RES_OK)
+			{
+				return err;
+			}
 
-			for(auto &fc: _file_compilers)
+			err = recalc_vars_usage(changed);
+			if(err != B1C_T_ERROR::B1C_RES_OK)
 			{
-				_curr_file_name = fc.GetFileName();
+				return err;
+			}
 
-				auto err = fc.Optimize(init);
+			if(!changed)
+			{
+				// the code cannot be optimized more, remove unreachable subroutines and functions (and then the
+				// variables they use)
+				err = remove_unreachable_code(changed);
 				if(err != B1C_T_ERROR::B1C_RES_OK)
 				{
-					b1_curr_prog_line_cnt = fc._curr_line_cnt;
 					return err;
 				}
-
-				init = false;
-			}
-
-			auto err = recalc_vars_usage(changed);
-			if(err != B1C_T_ERROR::B1C_RES_OK)
-			{
-				return err;
 			}
 		}
 	}
@@ -11409,30 +15222,26 @@ B1C_T_ERROR B1Compiler::Compile()
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1Compiler::WriteUFns(const std::string &file_name) const
+B1C_T_ERROR B1Compiler::WriteUFns(B1IRWriter &irw) const
 {
-	std::FILE *ofp = std::fopen(file_name.c_str(), "a");
-	if(ofp == nullptr)
-	{
-		return B1C_T_ERROR::B1C_RES_EFOPEN;
-	}
-
 	for(const auto &ufn: _global_ufns)
 	{
-		std::fwprintf(ofp, L"DEF,%ls,%ls", ufn.second.iname.c_str(), Utils::get_type_name(ufn.second.rettype).c_str());
+		std::vector<B1_CMP_ARG> args({ B1_CMP_ARG(ufn.second.iname), B1_CMP_ARG(Utils::get_type_name(ufn.second.rettype)) });
 		for(const auto &arg: ufn.second.args)
 		{
-			std::fwprintf(ofp, L",%ls", Utils::get_type_name(arg.type).c_str());
+			args.push_back(B1_CMP_ARG(Utils::get_type_name(arg.type)));
 		}
-		std::fwprintf(ofp, L"\n");
-	}
 
-	std::fclose(ofp);
+		if(!irw.WriteCommand(L"DEF", args))
+		{
+			return B1C_T_ERROR::B1C_RES_EFWRITE;
+		}
+	}
 
 	return B1C_T_ERROR::B1C_RES_OK;
 }
 
-B1C_T_ERROR B1Compiler::Write(const std::string &file_name)
+B1C_T_ERROR B1Compiler::Write(const std::string &file_name, bool text_ir)
 {
 	// some checks before writing compiled code
 	for(auto &fc: _file_compilers)
@@ -11449,18 +15258,17 @@ B1C_T_ERROR B1Compiler::Write(const std::string &file_name)
 
 	_curr_file_name = file_name;
 
-	// truncate output file
-	std::FILE *ofp = std::fopen(file_name.c_str(), "w");
-	if(ofp == nullptr)
+	// intermediate code is written in binary form, text form is optional (for debugging)
+	B1IRWriter irw(text_ir);
+	if(!irw.Open(file_name))
 	{
 		return B1C_T_ERROR::B1C_RES_EFOPEN;
 	}
-	std::fclose(ofp);
 
 	// write MA stmts
 	for(auto &fc: _file_compilers)
 	{
-		auto err = fc.WriteMAs(file_name);
+		auto err = fc.WriteMAs(irw);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			return err;
@@ -11468,14 +15276,14 @@ B1C_T_ERROR B1Compiler::Write(const std::string &file_name)
 	}
 
 	// write DEF commands
-	auto err = WriteUFns(file_name);
+	auto err = WriteUFns(irw);
 	if(err != B1C_T_ERROR::B1C_RES_OK)
 	{
 		return err;
 	}
 	for(const auto &fc: _file_compilers)
 	{
-		err = fc.WriteUFns(file_name);
+		err = fc.WriteUFns(irw);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			return err;
@@ -11484,7 +15292,7 @@ B1C_T_ERROR B1Compiler::Write(const std::string &file_name)
 
 	for(const auto &fc: _file_compilers)
 	{
-		err = fc.Write(file_name);
+		err = fc.Write(irw);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			return err;
@@ -11494,13 +15302,18 @@ B1C_T_ERROR B1Compiler::Write(const std::string &file_name)
 	// write DAT stmts
 	for(const auto &fc: _file_compilers)
 	{
-		auto err = fc.WriteDATs(file_name);
+		auto err = fc.WriteDATs(irw);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			return err;
 		}
 	}
 
+	if(!irw.Close())
+	{
+		return B1C_T_ERROR::B1C_RES_EFWRITE;
+	}
+
 	_curr_file_name.clear();
 
 	return B1C_T_ERROR::B1C_RES_OK;
@@ -11548,7 +15361,7 @@ static void b1c_print_warnings(const std::vector<std::pair<std::string, std::vec
 }
 
 
-int main(int argc, char **argv)
+static int b1c_main(int argc, char **argv)
 {
 	int i;
 	int retcode = 0;
@@ -11564,21 +15377,93 @@ int main(int argc, char **argv)
 	bool list_devs = false;
 	bool list_cmds = false;
 	std::string dev_name;
-	std::string args;
+	std::vector<std::string> args;
 	bool args_error = false;
 	std::string args_error_txt;
 	std::string ofn;
+	bool time_report = false;
+	std::string time_report_json;
+	int threads_num = 1;
+	B1C_INLINE_MODE inline_mode = B1C_INLINE_MODE::B1C_INLINE_SIZE;
+	bool inline_report = false;
+	bool text_ir = false;
 
 	// options
 	for(i = 1; i < argc; i++)
 	{
+		// library modules cache directory (used by intermediate code compiler)
+		if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == "CACHE")
+		{
+			if(i == argc - 1)
+			{
+				args_error = true;
+				args_error_txt = "missing cache directory";
+			}
+			else
+			{
+				i++;
+				args.push_back("-cache");
+				args.push_back(argv[i]);
+			}
+
+			continue;
+		}
+
+		// print compilation stages time and memory usage report (for all compilation tools)
+		if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == "TIME-REPORT")
+		{
+			time_report = true;
+			args.push_back("-time-report");
+			continue;
+		}
+
+		// write compilation stages time and memory usage report in JSON format (for all compilation tools)
+		if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == "TIME-REPORT-JSON")
+		{
+			if(i == argc - 1)
+			{
+				args_error = true;
+				args_error_txt = "missing report file name";
+			}
+			else
+			{
+				i++;
+				time_report_json = argv[i];
+				args.push_back("-time-report-json");
+				args.push_back(argv[i]);
+			}
+
+			continue;
+		}
+
+		// print user-defined functions inlining report
+		if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == "INLINE-REPORT")
+		{
+			inline_report = true;
+			continue;
+		}
+
+		// write intermediate code in text form
+		if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == "IR-TEXT")
+		{
+			text_ir = true;
+			continue;
+		}
+
+		// user-defined functions inlining: optimize for code size (default) or for speed
+		if((argv[i][0] == '-' || argv[i][0] == '/') && (Utils::str_toupper(std::string(argv[i] + 1)) == "OS" || Utils::str_toupper(std::string(argv[i] + 1)) == "O2"))
+		{
+			inline_mode = (argv[i][2] == '2') ? B1C_INLINE_MODE::B1C_INLINE_SPEED : B1C_INLINE_MODE::B1C_INLINE_SIZE;
+			continue;
+		}
+
 		// print error description
 		if ((argv[i][0] == '-' || argv[i][0] == '/') &&
 			(argv[i][1] == 'D' || argv[i][1] == 'd') &&
 			argv[i][2] == 0)
 		{
 			print_err_desc = true;
-			args = args + " -d";
+			args.push_back("-d");
 
 			continue;
 		}
@@ -11606,7 +15491,36 @@ int main(int argc, char **argv)
 					args_error = true;
 					args_error_txt = "wrong heap size";
 				}
-				args = args + " -hs " + argv[i];
+				args.push_back("-hs");
+				args.push_back(argv[i]);
+			}
+
+			continue;
+		}
+
+		// number of threads to process source files with (0 - number of processors)
+		if ((argv[i][0] == '-' || argv[i][0] == '/') &&
+			(argv[i][1] == 'J' || argv[i][1] == 'j') &&
+			argv[i][2] == 0)
+		{
+			if(i == argc - 1)
+			{
+				args_error = true;
+				args_error_txt = "missing threads number";
+			}
+			else
+			{
+				i++;
+				auto len = std::strlen(argv[i]);
+				std::wstring s(argv[i], argv[i] + len);
+				int32_t n = 0;
+				auto err = Utils::str2int32(s, n);
+				if(err != B1_RES_OK || n < 0)
+				{
+					args_error = true;
+					args_error_txt = "wrong threads number";
+				}
+				threads_num = n;
 			}
 
 			continue;
@@ -11625,7 +15539,8 @@ int main(int argc, char **argv)
 			else
 			{
 				i++;
-				args = args + " -l " + argv[i];
+				args.push_back("-l");
+				args.push_back(argv[i]);
 				lib_dir = argv[i];
 			}
 
@@ -11676,7 +15591,8 @@ int main(int argc, char **argv)
 			{
 				i++;
 				MCU_name = get_MCU_config_name(argv[i]);
-				args = args + " -m " + MCU_name;
+				args.push_back("-m");
+				args.push_back(MCU_name);
 			}
 
 			continue;
@@ -11697,7 +15613,7 @@ int main(int argc, char **argv)
 				_global_settings.SetMemModelLarge();
 			}
 
-			args = args + " " + argv[i];
+			args.push_back(argv[i]);
 			continue;
 		}
 
@@ -11707,7 +15623,7 @@ int main(int argc, char **argv)
 			(argv[i][2] == 'U' || argv[i][2] == 'u') &&
 			argv[i][3] == 0)
 		{
-			args = args + " -mu";
+			args.push_back("-mu");
 			continue;
 		}
 
@@ -11718,7 +15634,7 @@ int main(int argc, char **argv)
 			argv[i][3] == 0)
 		{
 			no_asm = true;
-			args = args + " -na";
+			args.push_back("-na");
 
 			continue;
 		}
@@ -11740,7 +15656,7 @@ int main(int argc, char **argv)
 			(argv[i][3] == 'I' || argv[i][3] == 'i') &&
 			argv[i][4] == 0)
 		{
-			args = args + " -nci";
+			args.push_back("-nci");
 			continue;
 		}
 
@@ -11750,7 +15666,7 @@ int main(int argc, char **argv)
 			(argv[i][2] == 'O' || argv[i][2] == 'o') &&
 			argv[i][3] == 0)
 		{
-			args = args + " -no";
+			args.push_back("-no");
 			continue;
 		}
 
@@ -11793,7 +15709,8 @@ int main(int argc, char **argv)
 					args_error = true;
 					args_error_txt = "wrong RAM size";
 				}
-				args = args + " -ram_size " + argv[i];
+				args.push_back("-ram_size");
+				args.push_back(argv[i]);
 			}
 
 			continue;
@@ -11819,7 +15736,8 @@ int main(int argc, char **argv)
 					args_error = true;
 					args_error_txt = "wrong RAM starting address";
 				}
-				args = args + " -ram_start " + argv[i];
+				args.push_back("-ram_start");
+				args.push_back(argv[i]);
 			}
 
 			continue;
@@ -11845,7 +15763,8 @@ int main(int argc, char **argv)
 					args_error = true;
 					args_error_txt = "wrong ROM size";
 				}
-				args = args + " -rom_size " + argv[i];
+				args.push_back("-rom_size");
+				args.push_back(argv[i]);
 			}
 
 			continue;
@@ -11871,7 +15790,8 @@ int main(int argc, char **argv)
 					args_error = true;
 					args_error_txt = "wrong ROM starting address";
 				}
-				args = args + " -rom_start " + argv[i];
+				args.push_back("-rom_start");
+				args.push_back(argv[i]);
 			}
 
 			continue;
@@ -11909,7 +15829,8 @@ int main(int argc, char **argv)
 					args_error = true;
 					args_error_txt = "wrong stack size";
 				}
-				args = args + " -ss " + argv[i];
+				args.push_back("-ss");
+				args.push_back(argv[i]);
 			}
 
 			continue;
@@ -11934,7 +15855,8 @@ int main(int argc, char **argv)
 					args_error = true;
 					args_error_txt = "invalid target";
 				}
-				args = args + " -t " + target_name;
+				args.push_back("-t");
+				args.push_back(target_name);
 			}
 
 			continue;
@@ -11982,8 +15904,13 @@ int main(int argc, char **argv)
 		std::fputs(B1_PROJECT_NAME, stderr);
 		std::fputs(" [options] filename [filename1] ... [filenameN]\n", stderr);
 		std::fputs("options:\n", stderr);
+		std::fputs("-cache or /cache - library modules cache directory, e.g. -cache /tmp/c1stm8.cache\n", stderr);
+		std::fputs("-client or /client - send the command line to compile server (the first option only), e.g. -client /tmp/b1c.sock\n", stderr);
 		std::fputs("-d or /d - print error description\n", stderr);
 		std::fputs("-hs or /hs - set heap size (in bytes), e.g. -hs 1024\n", stderr);
+		std::fputs("-inline-report or /inline-report - print user-defined functions inlining decisions\n", stderr);
+		std::fputs("-ir-text or /ir-text - write intermediate code in text form (for debugging)\n", stderr);
+		std::fputs("-j or /j - number of threads to process source files with (default 1, 0 - number of processors), e.g. -j 4\n", stderr);
 		std::fputs("-l or /l - libraries directory, e.g. -l \"../lib\"\n", stderr);
 		std::fputs("-ld or /ld - print available devices list\n", stderr);
 		std::fputs("-lc or /lc - print available device commands, e.g.: -lc UART\n", stderr);
@@ -11993,15 +15920,21 @@ int main(int argc, char **argv)
 		std::fputs("-mu or /mu - print memory usage\n", stderr);
 		std::fputs("-na or /na - don't run assembler\n", stderr);
 		std::fputs("-nc or /nc - compile only\n", stderr);
+		std::fputs("-next-server or /next-server - send c1 compiler command lines to its compile server (with -server option only), e.g. -next-server /tmp/c1stm8.sock\n", stderr);
 		std::fputs("-no or /no - disable optimizations\n", stderr);
 		std::fputs("-o or /o - output file name, e.g.: -o out.b1c\n", stderr);
+		std::fputs("-O2 or /O2 - inline user-defined functions to make code faster (code size can grow by up to 64 bytes per function)\n", stderr);
+		std::fputs("-Os or /Os - inline user-defined functions only if it does not increase code size (default)\n", stderr);
 		std::fputs("-ram_size or /ram_size - specify RAM size, e.g.: -ram_size 0x400\n", stderr);
 		std::fputs("-ram_start or /ram_start - specify RAM starting address, e.g.: -ram_start 0\n", stderr);
 		std::fputs("-rom_size or /rom_size - specify ROM size, e.g.: -rom_size 0x2000\n", stderr);
 		std::fputs("-rom_start or /rom_start - specify ROM starting address, e.g.: -rom_start 0x8000\n", stderr);
 		std::fputs("-s or /s - output source lines\n", stderr);
+		std::fputs("-server or /server - run compile server on a local socket (the first option only), e.g. -server /tmp/b1c.sock\n", stderr);
 		std::fputs("-ss or /ss - set stack size (in bytes), e.g. -ss 256\n", stderr);
 		std::fputs("-t or /t - set target (default STM8), e.g.: -t STM8\n", stderr);
+		std::fputs("-time-report or /time-report - print compilation stages time and memory usage report\n", stderr);
+		std::fputs("-time-report-json or /time-report-json - append compilation stages time and memory usage report in JSON format to the file, e.g. -time-report-json report.json\n", stderr);
 		std::fputs("-v or /v - show compiler version\n", stderr);
 		return 1;
 	}
@@ -12014,6 +15947,11 @@ int main(int argc, char **argv)
 		return 0;
 	}
 
+	if(time_report || !time_report_json.empty())
+	{
+		trep_enable();
+	}
+
 
 	// list of source files
 	std::vector<std::string> src_files;
@@ -12147,6 +16085,8 @@ int main(int argc, char **argv)
 
 
 	B1Compiler b1c(false, out_src_lines);
+	b1c.SetThreadsNum(threads_num);
+	b1c.SetInlineMode(inline_mode);
 
 	// load program files
 	B1C_T_ERROR err = b1c.Load(src_files);
@@ -12200,7 +16140,7 @@ int main(int argc, char **argv)
 			ofn += tmp;
 		}
 
-		err = b1c.Write(ofn);
+		err = b1c.Write(ofn, text_ir);
 		if(err != B1C_T_ERROR::B1C_RES_OK)
 		{
 			b1c_print_warnings(b1c.GetWarnings());
@@ -12210,21 +16150,45 @@ int main(int argc, char **argv)
 
 		if(b1c.GetOptExplicit())
 		{
-			args += " -op EXPLICIT";
+			args.push_back("-op");
+			args.push_back("EXPLICIT");
 		}
 
 		if(b1c.GetOptBase1())
 		{
-			args += " -op BASE1";
+			args.push_back("-op");
+			args.push_back("BASE1");
 		}
 
 		if(b1c.GetOptNoCheck())
 		{
-			args += " -op NOCHECK";
+			args.push_back("-op");
+			args.push_back("NOCHECK");
 		}
 
 		b1c_print_warnings(b1c.GetWarnings());
 
+		if(inline_report)
+		{
+			for(const auto &fr: b1c.GetInlineReport())
+			{
+				for(const auto &r: fr.second)
+				{
+					std::fputs((fr.first + ": " + Utils::wstr2str(r) + "\n").c_str(), stderr);
+				}
+			}
+		}
+
+		if(time_report)
+		{
+			trep_print(stderr);
+		}
+
+		if(!time_report_json.empty() && !trep_write_json(time_report_json))
+		{
+			std::perror("fail");
+		}
+
 		if(!no_comp)
 		{
 			std::fputs("running c1 compiler...\n", stdout);
@@ -12242,7 +16206,10 @@ int main(int argc, char **argv)
 				cwd.clear();
 			}
 
-			int sc = std::system((cwd + get_c1_compiler_name(_global_settings) + " -fr" + args + " " + ofn).c_str());
+			args.insert(args.begin(), "-fr");
+			args.push_back(ofn);
+
+			int sc = srv_run_next_stage(cwd + get_c1_compiler_name(_global_settings), args);
 			if(sc == -1)
 			{
 				std::perror("fail");
@@ -12254,6 +16221,82 @@ int main(int argc, char **argv)
 	return retcode;
 }
 
+// loads settings of the MCU specified in the request command line to keep them resident in compile server
+static int b1c_warm_up(int argc, char **argv)
+{
+	const auto MCU_name = get_MCU_config_name(srv_get_opt_value(argc, argv, "M"));
+	if(MCU_name.empty())
+	{
+		return 0;
+	}
+
+	auto target_name = Utils::str_toupper(Utils::str_trim(srv_get_opt_value(argc, argv, "T")));
+	Settings settings;
+
+	settings.SetTargetName(target_name.empty() ? "STM8" : target_name);
+	settings.SetMCUName(MCU_name);
+	settings.SetLibDirRoot(srv_get_opt_value(argc, argv, "L"));
+	settings.InitLibDirs();
+
+	auto file_name = settings.GetLibFileName(MCU_name, ".cfg");
+	if(!file_name.empty())
+	{
+		settings.Read(file_name);
+	}
+
+	settings.InitLibDirs();
+
+	file_name = settings.GetLibFileName(MCU_name, ".io");
+	if(!file_name.empty())
+	{
+		settings.ReadIoSettings(file_name);
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	// compile server mode options should go first
+	if(argc > 2 && (argv[1][0] == '-' || argv[1][0] == '/'))
+	{
+		const auto opt = Utils::str_toupper(std::string(argv[1] + 1));
+
+		// run compile server
+		if(opt == "SERVER")
+		{
+			Settings::EnableFileCache();
+
+			if(srv_run(argv[2], srv_get_opt_value(argc, argv, "NEXT-SERVER"), b1c_main, b1c_warm_up) != 0)
+			{
+				std::perror("fail");
+			}
+
+			return 9;
+		}
+
+		// send the command line to compile server
+		if(opt == "CLIENT")
+		{
+			const std::string socket_name = argv[2];
+
+			argc -= 2;
+			argv[2] = argv[0];
+			argv += 2;
+
+			auto retcode = srv_request(socket_name, argc, argv);
+			if(retcode >= 0)
+			{
+				return retcode;
+			}
+
+			// the server is not available, process the command line locally
+		}
+	}
+
+	return b1c_main(argc, argv);
+}
+
 #ifndef B1_FEATURE_UNICODE_UCS2
 #error Unicode support must be enabled
 #endif
@@ -16,12 +16,27 @@ extern "C"
 }
 
 #include <set>
+#include <unordered_map>
+#include <mutex>
+#include <functional>
 
 #include "errors.h"
 #include "b1cmp.h"
+#include "b1cfg.h"
+
+
+// user-defined functions inlining goal
+enum class B1C_INLINE_MODE
+{
+	// inline function calls if it does not increase code size (default)
+	B1C_INLINE_SIZE,
+	// inline function calls to save execution time, code size can grow within a limit
+	B1C_INLINE_SPEED,
+};
 
 
 class B1Compiler;
+class B1IRWriter;
 
 class B1FileCompiler: B1_CMP_CMDS
 {
@@ -53,6 +68,7 @@ private:
 		B1_CMP_STATE_ELSE,
 		B1_CMP_STATE_FOR,
 		B1_CMP_STATE_WHILE,
+		B1_CMP_STATE_SELECT,
 	};
 
 	enum class B1_CMP_STMT
@@ -62,11 +78,53 @@ private:
 		B1_CMP_STMT_RESTORE,
 	};
 
+	// statements of SELECT CASE block (b1core does not know the keywords so they are recognized by the compiler)
+	enum class B1_CMP_SEL_STMT
+	{
+		B1_CMP_SEL_STMT_NONE,
+		B1_CMP_SEL_STMT_SELECT,
+		B1_CMP_SEL_STMT_CASE,
+		B1_CMP_SEL_STMT_END,
+	};
+
+	// optimization passes run by Optimize function
+	enum class B1_CMP_OPT_PASS
+	{
+		B1_CMP_OPT_REMOVE_UNUSED_LABELS,
+		B1_CMP_OPT_REMOVE_DUPLICATE_LABELS,
+		B1_CMP_OPT_REMOVE_SELF_ASSIGNS,
+		B1_CMP_OPT_REMOVE_JUMPS,
+		B1_CMP_OPT_REMOVE_REDUNDANT_COMPARISONS,
+		B1_CMP_OPT_REMOVE_DUPLICATE_ASSIGNS,
+		B1_CMP_OPT_EVAL_UNARY_OPS,
+		B1_CMP_OPT_REUSE_IMM_VALUES,
+		B1_CMP_OPT_REUSE_EXPS,
+		B1_CMP_OPT_REMOVE_LOCALS,
+		B1_CMP_OPT_REUSE_LOCALS,
+		B1_CMP_OPT_REUSE_VARS,
+		B1_CMP_OPT_EVAL_IMM_EXPS,
+		B1_CMP_OPT_REMOVE_UNUSED_VARS,
+		B1_CMP_OPT_INLINE_FNS,
+		B1_CMP_OPT_INLINE_UFNS,
+		B1_CMP_OPT_OPTIMIZE_GA_GF,
+		B1_CMP_OPT_OPTIMIZE_LOOPS,
+		B1_CMP_OPT_NARROW_LOCALS,
+		B1_CMP_OPT_NARROW_CMPS,
+	};
+
+	// range of integer values
+	typedef std::pair<int64_t, int64_t> B1_CMP_RANGE;
+
 	std::vector<std::pair<B1_CMP_STATE, std::vector<std::wstring>>> _state_stack;
 
 	std::pair<B1_CMP_STATE, std::vector<std::wstring>> _state;
 	std::map<int32_t, std::wstring> _src_lines;
 
+	// program lines read during the first run (the next runs take them from here instead of loading the file again)
+	//       prev. line cnt            result      line cnt            line
+	std::map<B1_T_PROG_LINE_CNT, std::tuple<B1_T_ERROR, B1_T_PROG_LINE_CNT, std::vector<B1_T_CHAR>>> _prog_lines;
+	bool _prog_file_loaded;
+
 	//       gen. name                type     dim  volatile mem   static const
 	std::map<std::wstring, std::tuple<B1Types, int, bool,    bool, bool,  bool>> _vars;
 	//       var name                type     values
@@ -91,6 +149,27 @@ private:
 
 	std::map<std::wstring, std::pair<std::wstring, std::vector<iterator>>> _var_refs;
 
+	// variables usage index: variables used by every command and commands using every variable, the index is
+	// built by the first calc_vars_usage() call and then updated with the commands changes log
+	//                                                     var. name 1 - reading, 2 - writing, 3 - reading + writing
+	std::unordered_map<B1_CMP_CMD *, std::vector<std::pair<B1_ATOM, int>>> _cmd_vars_usage;
+	//       var. name               command
+	std::map<std::wstring, std::map<B1_CMP_CMD *, int>> _var_cmds;
+	// GET, PUT and TRR commands with an explicit number of values
+	std::unordered_set<B1_CMP_CMD *> _io_cnt_cmds;
+	// variables usage in the file code (see B1Compiler::_used_vars)
+	//                     1 - reading, 2 - writing, 3 - reading + writing
+	std::map<std::wstring, int> _vars_usage;
+	// previous usage values of the variables changed since the last B1Compiler::recalc_vars_usage() call
+	std::map<std::wstring, int> _vars_usage_changes;
+	// the index is built
+	bool _vars_usage_valid;
+
+	// user-defined functions inlining statistics and report lines
+	//                     inlined calls, code size change (bytes), execution time change (cycles)
+	std::map<std::wstring, std::tuple<int, int, int>> _ufn_inline_stats;
+	std::map<std::wstring, std::wstring> _ufn_inline_report;
+
 
 	B1C_T_ERROR put_var_name(const std::wstring &name, const B1Types type, int dims, bool is_global, bool is_volatile, bool is_mem_var, bool is_static, bool is_const);
 	B1C_T_ERROR put_const_var_init_values(const std::wstring &name, const std::vector<std::wstring> &const_init);
@@ -119,6 +198,7 @@ private:
 	B1_T_ERROR concat_strings_rpn(std::wstring &res);
 
 	bool is_label();
+	B1_T_ERROR get_prog_line();
 
 	B1_T_ERROR st_option_set(const B1_T_CHAR *s, uint8_t value_type, bool onoff, int *value);
 	B1_T_ERROR st_option_set_expr(const B1_T_CHAR *s, B1_CMP_EXP_TYPE &exp_type, B1_CMP_ARG &res);
@@ -148,8 +228,13 @@ private:
 	B1_T_ERROR st_read();
 	B1_T_ERROR st_while();
 	B1_T_ERROR st_wend();
+	std::pair<B1_CMP_STATE, std::vector<std::wstring>> *get_loop_state();
 	B1_T_ERROR st_continue();
 	B1_T_ERROR st_break();
+	B1_T_ERROR get_select_stmt(uint8_t stmt, B1_CMP_SEL_STMT &sel_stmt, B1_T_INDEX &next_off) const;
+	B1C_T_ERROR st_select();
+	B1C_T_ERROR st_case();
+	B1C_T_ERROR st_end_select();
 	B1C_T_ERROR st_print();
 	B1C_T_ERROR st_input();
 	B1C_T_ERROR st_read_range(std::vector<std::pair<B1_CMP_ARG, B1_CMP_EXP_TYPE>> &range);
@@ -166,6 +251,8 @@ private:
 	bool is_udef_used(const B1_CMP_CMD &cmd);
 	bool is_volatile_used(const B1_CMP_ARG &arg);
 	bool is_volatile_used(const B1_CMP_CMD &cmd);
+	B1_CMP_FLOW get_flow();
+	bool is_fn_used(const B1_CMP_CMD &cmd);
 	B1C_T_ERROR remove_duplicate_assigns(bool &changed);
 	B1C_T_ERROR remove_self_assigns(bool &changed);
 	B1C_T_ERROR remove_jumps(bool &changed);
@@ -173,9 +260,32 @@ private:
 	B1C_T_ERROR remove_redundant_comparisons(bool &changed);
 	B1C_T_ERROR replace_unary_minus(bool &changed);
 	B1C_T_ERROR eval_unary_ops(bool &changed);
-	void set_to_init_value_arg(B1_CMP_ARG &arg, bool is_dst, const std::map<std::wstring, std::pair<bool, std::wstring>> &vars, bool init, bool &changed);
+	void set_to_init_value_arg(B1_CMP_CMD &cmd, int arg_num, bool is_dst, const std::map<std::wstring, std::pair<bool, std::wstring>> &vars, bool init, bool &changed);
 	std::wstring set_to_init_value(B1_CMP_CMD &cmd, const std::map<std::wstring, std::pair<bool, std::wstring>> &vars, bool init, bool &changed);
+	static bool eval_num_op(wchar_t op, int32_t n1, int32_t n2, int32_t &res);
+	bool is_imm_var(const std::wstring &name) const;
+	bool get_imm_arg(const B1_CMP_FLOW &flow, const B1_CMP_ARG &arg, const std::vector<B1_ATOM> &vals, B1_TYPED_VALUE &val) const;
+	void get_assigned_imm(const B1_CMP_FLOW &flow, const B1_CMP_CMD &cmd, const std::vector<B1_ATOM> &vals, int &var, B1_ATOM &val) const;
+	void imm_values_step(const B1_CMP_FLOW &flow, const B1_CMP_CMD &cmd, std::vector<B1_ATOM> &vals, int &cond) const;
+	void calc_imm_values(const B1_CMP_FLOW &flow, bool init, std::vector<std::vector<B1_ATOM>> &vals, std::vector<bool> &reached);
 	B1C_T_ERROR reuse_imm_values(bool init, bool &changed);
+	B1C_T_ERROR reuse_exps(bool &changed);
+	static bool get_type_range(B1Types type, B1_CMP_RANGE &range);
+	static bool is_range_in_type(const B1_CMP_RANGE &range, B1Types type);
+	static bool get_op_com_type(const B1_CMP_CMD &cmd, B1Types t0, B1Types t1, B1Types &com_type);
+	static bool get_op_range(const std::wstring &op, bool un_op, const B1_CMP_RANGE &r1, const B1_CMP_RANGE &r2, B1_CMP_RANGE &res);
+	bool is_range_var(const std::wstring &name) const;
+	int get_cvt_var_index(const B1_CMP_FLOW &flow, const B1_CMP_ARG &arg, const std::vector<B1_CMP_RANGE> &ranges) const;
+	bool get_arg_range(const B1_CMP_FLOW &flow, const B1_CMP_ARG &arg, const std::vector<B1_CMP_RANGE> &ranges, B1_CMP_RANGE &range) const;
+	void get_var_type_ranges(const B1_CMP_FLOW &flow, std::vector<B1_CMP_RANGE> &ranges) const;
+	void value_ranges_step(const B1_CMP_FLOW &flow, const B1_CMP_CMD &cmd, const std::vector<B1_CMP_RANGE> &type_ranges, std::vector<B1_CMP_RANGE> &ranges) const;
+	bool limit_value_ranges(const B1_CMP_FLOW &flow, const B1_CMP_CMD &cmd, bool cond, std::vector<B1_CMP_RANGE> &ranges) const;
+	void calc_value_ranges(const B1_CMP_FLOW &flow, bool init, std::vector<std::vector<B1_CMP_RANGE>> &ranges, std::vector<bool> &reached);
+	B1C_T_ERROR narrow_locals(bool init, bool &changed);
+	B1C_T_ERROR narrow_cmps(bool init, bool &changed);
+	bool optimize_loop(const B1_CMP_FLOW &flow, const B1_CMP_LOOP &loop);
+	B1C_T_ERROR optimize_loops(bool &changed);
+	bool remove_local(iterator la, iterator lf, std::vector<iterator> &rd, std::vector<iterator> &wr);
 	B1C_T_ERROR remove_locals(bool &changed);
 	B1_T_ERROR get_type(B1_TYPED_VALUE &v, bool read, std::map<std::wstring, std::vector<std::pair<B1Types &, B1Types>>> &iif_locals);
 	B1_T_ERROR get_type(B1_CMP_ARG &a, bool read, std::map<std::wstring, std::vector<std::pair<B1Types &, B1Types>>> &iif_locals);
@@ -183,20 +293,28 @@ private:
 	B1C_T_ERROR put_fn_def_values(B1_CMP_ARG &arg);
 	B1C_T_ERROR put_fn_def_values();
 	B1C_T_ERROR inline_fns(bool &changed);
+	B1C_T_ERROR inline_ufns(bool &changed);
 	bool get_LA_LF(iterator s, iterator e, iterator &la, iterator &lf);
 	B1C_T_ERROR reuse_locals(bool &changed);
 	B1C_T_ERROR reuse_vars(bool &changed);
-	bool eval_imm_fn_arg(B1_CMP_ARG &a);
+	bool eval_imm_fn_arg(B1_CMP_CMD &cmd, int arg_num);
 	B1C_T_ERROR eval_imm_exps(bool &changed);
 	B1C_T_ERROR check_MA_stmts();
 	B1C_T_ERROR remove_DAT_stmts();
-	B1C_T_ERROR remove_unused_vars(B1_CMP_ARG &a, bool &changed, bool subs_and_args_only = false);
+	B1C_T_ERROR remove_unused_vars(B1_CMP_CMD &cmd, int arg_num, bool &changed, bool subs_and_args_only = false);
+	B1C_T_ERROR remove_unused_vars(B1_CMP_CMD &cmd, bool &changed);
 	B1C_T_ERROR remove_unused_vars(bool &changed);
 	B1C_T_ERROR get_const_var_value(const std::wstring &var_name, bool &var_found, std::wstring &value);
 	B1C_T_ERROR eval_const_vars_values_1_iter(bool &changed, bool &all_resolved);
-	B1C_T_ERROR calc_vars_usage(B1_TYPED_VALUE &v, bool read);
-	B1C_T_ERROR calc_vars_usage(B1_CMP_ARG &a, bool read);
+	B1C_T_ERROR calc_vars_usage(const B1_TYPED_VALUE &v, bool read, std::vector<std::pair<B1_ATOM, int>> &usage);
+	B1C_T_ERROR calc_vars_usage(const B1_CMP_ARG &a, bool read, std::vector<std::pair<B1_ATOM, int>> &usage);
+	B1C_T_ERROR calc_vars_usage(const B1_CMP_CMD &cmd, std::vector<std::pair<B1_ATOM, int>> &usage);
+	void mark_var_used(const B1_ATOM &name, bool for_read, std::vector<std::pair<B1_ATOM, int>> &usage);
+	void update_var_usage(const std::wstring &name);
+	void remove_cmd_vars_usage(B1_CMP_CMD *cmd, std::set<std::wstring> &vars);
+	B1C_T_ERROR add_cmd_vars_usage(B1_CMP_CMD &cmd, std::set<std::wstring> &vars);
 	B1C_T_ERROR optimize_GA_GF(bool &changed);
+	B1C_T_ERROR run_opt_pass(B1_CMP_OPT_PASS pass, bool init, bool &changed);
 	bool get_opt_explicit() const;
 	B1C_T_ERROR set_opt_explicit();
 	bool get_opt_base1() const;
@@ -247,17 +365,22 @@ public:
 	B1C_T_ERROR Optimize(bool init);
 	B1C_T_ERROR CollectDeclStmts();
 	B1C_T_ERROR CheckGAStmts() const;
-	B1C_T_ERROR WriteUFns(const std::string &file_name) const;
-	B1C_T_ERROR WriteStmt(const B1_CMP_CMD &cmd, std::FILE *ofp, int &curr_line_id) const;
-	B1C_T_ERROR WriteMAs(const std::string &file_name);
-	B1C_T_ERROR WriteDATs(const std::string &file_name) const;
-	B1C_T_ERROR Write(const std::string &file_name) const;
+	B1C_T_ERROR WriteUFns(B1IRWriter &irw) const;
+	B1C_T_ERROR WriteStmt(const B1_CMP_CMD &cmd, B1IRWriter &irw, int &curr_line_id) const;
+	B1C_T_ERROR WriteMAs(B1IRWriter &irw);
+	B1C_T_ERROR WriteDATs(B1IRWriter &irw) const;
+	B1C_T_ERROR Write(B1IRWriter &irw) const;
 
 	std::string GetFileName() const
 	{
 		return _file_name;
 	}
 
+	const std::map<std::wstring, std::wstring> &GetInlineReport() const
+	{
+		return _ufn_inline_report;
+	}
+
 	const std::map<int32_t, std::vector<B1C_T_WARNING>> &GetWarnings() const
 	{
 		return _warnings;
@@ -281,6 +404,8 @@ private:
 
 	//                     1 - reading, 2 - writing, 3 - reading + writing
 	std::map<std::wstring, int> _used_vars;
+	// guards _used_vars updates made by files processed in parallel (the map is read only in the stages without updates)
+	std::mutex _used_vars_mutex;
 
 	std::vector<std::pair<std::string, std::vector<std::pair<int32_t, B1C_T_WARNING>>>> _warnings;
 
@@ -288,6 +413,8 @@ private:
 protected:
 	bool _no_opt;
 	bool _out_src_lines;
+	int _threads_num;
+	B1C_INLINE_MODE _inline_mode;
 	std::vector<B1FileCompiler> _file_compilers;
 
 	std::vector<std::string> _file_names;
@@ -296,6 +423,11 @@ protected:
 	bool _opt_base1;
 	bool _opt_nocheck;
 
+	// numbers of the files reading and writing every variable (recalc_vars_usage() updates _used_vars with them)
+	std::map<std::wstring, std::pair<int, int>> _used_vars_files;
+	// _used_vars is calculated from the files variables usage
+	bool _used_vars_valid;
+
 	mutable std::string _curr_file_name;
 
 
@@ -323,6 +455,9 @@ protected:
 	int get_var_used(const std::wstring &name);
 
 	B1C_T_ERROR recalc_vars_usage(bool &changed);
+	B1C_T_ERROR remove_unreachable_code(bool &changed);
+
+	B1C_T_ERROR process_files(const std::function<B1C_T_ERROR(B1FileCompiler &, int)> &fn);
 
 
 public:
@@ -331,10 +466,13 @@ public:
 
 	~B1Compiler();
 
+	void SetThreadsNum(int threads_num);
+	void SetInlineMode(B1C_INLINE_MODE inline_mode);
+
 	B1C_T_ERROR Load(const std::vector<std::string> &file_names);
 	B1C_T_ERROR Compile();
-	B1C_T_ERROR WriteUFns(const std::string &file_name) const;
-	B1C_T_ERROR Write(const std::string &file_name);
+	B1C_T_ERROR WriteUFns(B1IRWriter &irw) const;
+	B1C_T_ERROR Write(const std::string &file_name, bool text_ir);
 
 	bool GetOptExplicit() const;
 	bool GetOptBase1() const;
@@ -365,4 +503,22 @@ public:
 
 		return _warnings;
 	}
+
+	// user-defined functions inlining decisions: file name, report lines
+	std::vector<std::pair<std::string, std::vector<std::wstring>>> GetInlineReport() const
+	{
+		std::vector<std::pair<std::string, std::vector<std::wstring>>> report;
+
+		for(const auto &fc: _file_compilers)
+		{
+			report.push_back(std::make_pair(fc.GetFileName(), std::vector<std::wstring>()));
+
+			for(const auto &r: fc.GetInlineReport())
+			{
+				report.back().second.push_back(r.second);
+			}
+		}
+
+		return report;
+	}
 };
\ No newline at end of file
@@ -77,6 +77,8 @@ static const std::string b1c_err_msgs[] =
 	"initializers missing",
 	"",
 	"wrong line number for RESTORE statement",
+	"SELECT CASE without END SELECT",
+	"END SELECT without SELECT CASE",
 
 	"the last message"
 };
@@ -38,6 +38,8 @@ enum class B1C_T_ERROR
 	B1C_RES_ECNSTNOINIT,
 	B1C_RES_ERANGSNTX,
 	B1C_RES_ERSTWODAT,
+	B1C_RES_ESELWOEND,
+	B1C_RES_EENDWOSEL,
 
 	B1C_RES_LASTERRCODE
 };
@@ -0,0 +1,207 @@
+#!/bin/bash
+# compiler throughput benchmark
+# [<bin_dir>] [<out_dir>]
+# compiles b1c/docs/samples for every MCU configuration from common/lib/STM8 and synthetic large
+# programs, writes end-to-end times (results.csv) and per-tool stage reports (json/*.json) to out_dir
+
+root_dir=$(cd "$(dirname "$0")/.." && pwd)
+bin_dir=${1:-$root_dir/bin/lnx/x64/gcc/rel}
+out_dir=${2:-$root_dir/bench/out}
+
+# the compiler runs in per-test work directories, so both paths must be absolute
+bin_dir=$(cd "$bin_dir" 2>/dev/null && pwd) || { echo "directory not found: $1"; exit 1; }
+out_dir=$(mkdir -p "$out_dir" && cd "$out_dir" && pwd) || exit 1
+
+# synthetic programs sizes
+B1_BENCH_LINES=${B1_BENCH_LINES:-5000}
+B1_BENCH_GOSUB_DEPTH=${B1_BENCH_GOSUB_DEPTH:-1000}
+B1_BENCH_DATA_STMTS=${B1_BENCH_DATA_STMTS:-1000}
+B1_BENCH_CONST_ARRAYS=${B1_BENCH_CONST_ARRAYS:-200}
+# MCU used to compile synthetic programs
+B1_BENCH_MCU=${B1_BENCH_MCU:-STM8S207K8}
+
+if [ ! -x "$bin_dir/b1c" ] || [ ! -x "$bin_dir/c1stm8" ] || [ ! -x "$bin_dir/a1stm8" ]
+then
+  echo "b1c, c1stm8 or a1stm8 executable not found in $bin_dir"
+  exit 1
+fi
+
+samples_dir=$root_dir/b1c/docs/samples
+lib_dir=$root_dir/common/
+
+rm -rf "$out_dir"
+mkdir -p "$out_dir/src" "$out_dir/json" "$out_dir/work"
+
+now_ns()
+{
+  date +%s%N
+}
+
+# <line_num> <text>
+put_line()
+{
+  echo "$1 $2"
+}
+
+# many lines of arithmetic expressions, conditions and PRINT statements
+gen_lines()
+{
+  local n=$1 i ln=10
+
+  put_line $ln "IOCTL UART, ENABLE"; ((ln+=10))
+  put_line $ln "IOCTL UART, START"; ((ln+=10))
+
+  for ((i = 0; i < n; i++))
+  do
+    case $((i % 4)) in
+      0) put_line $ln "A$((i % 50)) = A$(((i + 1) % 50)) * $((i % 7 + 1)) + B$((i % 30)) - $i";;
+      1) put_line $ln "IF A$((i % 50)) > $((i % 100)) THEN B$((i % 30)) = B$((i % 30)) + 1"
+         put_line $((ln + 5)) "ELSE B$((i % 30)) = B$((i % 30)) - 1";;
+      2) put_line $ln "S$((i % 10))\$ = \"L$i \" + STR\$(A$((i % 50)))";;
+      3) put_line $ln "PRINT S$((i % 10))\$; A$((i % 50)); B$((i % 30))";;
+    esac
+    ((ln+=10))
+  done
+
+  put_line $ln "END"
+}
+
+# chain of nested subroutines
+gen_gosub()
+{
+  local n=$1 i ln
+
+  put_line 10 "X = 0"
+  put_line 20 "GOSUB 100"
+  put_line 30 "PRINT X"
+  put_line 40 "END"
+
+  for ((i = 0; i < n; i++))
+  do
+    ln=$((100 + i * 10))
+    put_line $ln "X = X + $((i % 100))"
+    if ((i < n - 1))
+    then
+      put_line $((ln + 1)) "GOSUB $((ln + 10))"
+    fi
+    put_line $((ln + 2)) "RETURN"
+  done
+}
+
+# many DATA statements read in a loop
+gen_data()
+{
+  local n=$1 i j ln vals
+
+  put_line 10 "S = 0"
+  put_line 20 "FOR I = 1 TO $((n * 16))"
+  put_line 30 "READ V"
+  put_line 40 "S = S + V"
+  put_line 50 "NEXT I"
+  put_line 60 "PRINT S"
+  put_line 70 "END"
+
+  for ((i = 0; i < n; i++))
+  do
+    vals=$(((i * 16) % 30000))
+    for ((j = 1; j < 16; j++))
+    do
+      vals="$vals, $(((i * 16 + j) % 30000))"
+    done
+    put_line $((100 + i * 10)) "DATA $vals"
+  done
+}
+
+# many constant arrays (an array size is limited by the program line length)
+gen_dimconst()
+{
+  local n=$1 i j ln vals
+
+  for ((i = 0; i < n; i++))
+  do
+    vals=$((i % 256))
+    for ((j = 1; j < 40; j++))
+    do
+      vals="$vals, $(((i + j * 7) % 256))"
+    done
+    put_line $((10 + i * 10)) "DIM CONST C$i(0 TO 39) AS BYTE = ($vals)"
+  done
+
+  ln=$((10 + n * 10))
+  put_line $ln "S = 0"; ((ln+=10))
+  put_line $ln "FOR I = 0 TO 39"; ((ln+=10))
+  for ((i = 0; i < n; i++))
+  do
+    put_line $ln "S = S + C$i(I)"; ((ln+=10))
+  done
+  put_line $ln "NEXT I"; ((ln+=10))
+  put_line $ln "PRINT S"; ((ln+=10))
+  put_line $ln "END"
+}
+
+# <name> <MCU_name> <file1> [<file2> ...]
+run()
+{
+  local name=$1 mcu=$2 work=$out_dir/work/$1.$2 json=$out_dir/json/$1.$2.json
+  shift 2
+
+  mkdir -p "$work"
+  cp "$@" "$work/"
+
+  local files=()
+  for f in "$@"
+  do
+    files+=("$(basename "$f")")
+  done
+
+  local start=$(now_ns)
+  (cd "$work" && "$bin_dir/b1c" -d -l "$lib_dir" -m $mcu -mu -time-report-json "$json" "${files[@]}" > out.txt 2>&1)
+  local rc=$?
+  local end=$(now_ns)
+
+  echo "$name,$mcu,$rc,$(((end - start) / 1000000))" >> "$out_dir/results.csv"
+  if [ $rc -ne 0 ]
+  then
+    echo "$name ($mcu): failed with code $rc"
+  fi
+}
+
+gen_lines $B1_BENCH_LINES > "$out_dir/src/lines.bsc"
+gen_gosub $B1_BENCH_GOSUB_DEPTH > "$out_dir/src/gosub.bsc"
+gen_data $B1_BENCH_DATA_STMTS > "$out_dir/src/data.bsc"
+gen_dimconst $B1_BENCH_CONST_ARRAYS > "$out_dir/src/dimconst.bsc"
+
+echo "name,mcu,retcode,time_ms" > "$out_dir/results.csv"
+
+bench_start=$(now_ns)
+
+for cfg in "$root_dir"/common/lib/STM8/*.cfg
+do
+  mcu=$(basename "$cfg" .cfg)
+
+  for src in "$samples_dir"/*.bsc
+  do
+    name=$(basename "$src" .bsc)
+
+    # the files are compiled together with their main programs
+    case $name in
+      blink2_tm|blink3_tm|st7565mdata) continue;;
+      blink2|blink3) run $name $mcu "$src" "$samples_dir/${name}_tm.bsc";;
+      st7565m105) run $name $mcu "$src" "$samples_dir/st7565mdata.bsc";;
+      *) run $name $mcu "$src";;
+    esac
+  done
+done
+
+for name in lines gosub data dimconst
+do
+  run synth_$name $B1_BENCH_MCU "$out_dir/src/$name.bsc"
+done
+
+bench_end=$(now_ns)
+
+# summary: total end-to-end time and total time of every tool
+echo "runs: $(($(wc -l < "$out_dir/results.csv") - 1)), failed: $(awk -F, 'NR > 1 && $3 != 0' "$out_dir/results.csv" | wc -l)"
+echo "total time, ms: $(((bench_end - bench_start) / 1000000))"
+cat "$out_dir"/json/*.json 2>/dev/null | sed -n 's/^{"tool":"\([^"]*\)".*"total_time_ms":\([0-9.]*\).*$/\1 \2/p' | \
+  awk '{ t[$1] += $2 } END { for(n in t) printf("%s time, ms: %.3f\n", n, t[n]) }'
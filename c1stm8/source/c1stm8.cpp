@@ -10,16 +10,33 @@
 #include <clocale>
 #include <cstring>
 #include <algorithm>
+#include <chrono>
 
 #include "../../common/source/trgsel.h"
 #include "../../common/source/version.h"
 #include "../../common/source/gitrev.h"
+#include "../../common/source/cmpsrv.h"
+#include "../../common/source/libarc.h"
+#include "../../common/source/timerep.h"
 
 #include "c1stm8.h"
 
 
+#ifdef A1STM8_BUILTIN
+// a1stm8 sources are built into the compiler: the assembler runs in the same process
+#include "../../a1stm8/source/a1stm8.h"
+#endif
+
 static const char *version = B1_CMP_VERSION;
 
+// SELECT CASE tests compilation: minimal number of values to build a jump table or a binary decision tree, maximal
+// jump table size (in entries) and entries per value ratio, maximal number of values compared one by one in a leaf
+// of the decision tree
+static const size_t STM8_SWITCH_MIN_CASES = 4;
+static const int32_t STM8_SWITCH_MAX_TABLE_SIZE = 256;
+static const int32_t STM8_SWITCH_MAX_ENTRIES_PER_CASE = 3;
+static const size_t STM8_SWITCH_MAX_LEAF_CASES = 3;
+
 
 STM8Settings global_settings;
 Settings &_global_settings = global_settings;
@@ -53,6 +70,149 @@ bool B1_ASM_OP_STM8::ParseNumeric(const std::wstring &num_str, int32_t &n) const
 	return false;
 }
 
+static AOC get_opcode(const std::wstring &op)
+{
+	const static std::map<std::wstring, AOC> opcodes(
+	{
+		{ L"ADC", AOC::AOC_ADC }, { L"ADD", AOC::AOC_ADD }, { L"ADDW", AOC::AOC_ADDW }, { L"AND", AOC::AOC_AND },
+		{ L"BCCM", AOC::AOC_BCCM }, { L"BCP", AOC::AOC_BCP }, { L"BCPL", AOC::AOC_BCPL }, { L"BREAK", AOC::AOC_BREAK },
+		{ L"BRES", AOC::AOC_BRES }, { L"BSET", AOC::AOC_BSET }, { L"BTJF", AOC::AOC_BTJF }, { L"BTJT", AOC::AOC_BTJT },
+		{ L"CALL", AOC::AOC_CALL }, { L"CALLF", AOC::AOC_CALLF }, { L"CALLR", AOC::AOC_CALLR }, { L"CCF", AOC::AOC_CCF },
+		{ L"CLR", AOC::AOC_CLR }, { L"CLRW", AOC::AOC_CLRW }, { L"CP", AOC::AOC_CP }, { L"CPL", AOC::AOC_CPL },
+		{ L"CPLW", AOC::AOC_CPLW }, { L"CPW", AOC::AOC_CPW }, { L"DEC", AOC::AOC_DEC }, { L"DECW", AOC::AOC_DECW },
+		{ L"DIV", AOC::AOC_DIV }, { L"DIVW", AOC::AOC_DIVW }, { L"EXG", AOC::AOC_EXG }, { L"EXGW", AOC::AOC_EXGW },
+		{ L"HALT", AOC::AOC_HALT }, { L"INC", AOC::AOC_INC }, { L"INCW", AOC::AOC_INCW }, { L"INT", AOC::AOC_INT },
+		{ L"IRET", AOC::AOC_IRET }, { L"JP", AOC::AOC_JP }, { L"JPF", AOC::AOC_JPF }, { L"JRA", AOC::AOC_JRA },
+		{ L"JRC", AOC::AOC_JRC }, { L"JREQ", AOC::AOC_JREQ }, { L"JRF", AOC::AOC_JRF }, { L"JRH", AOC::AOC_JRH },
+		{ L"JRIH", AOC::AOC_JRIH }, { L"JRIL", AOC::AOC_JRIL }, { L"JRM", AOC::AOC_JRM }, { L"JRMI", AOC::AOC_JRMI },
+		{ L"JRNC", AOC::AOC_JRNC }, { L"JRNE", AOC::AOC_JRNE }, { L"JRNH", AOC::AOC_JRNH }, { L"JRNM", AOC::AOC_JRNM },
+		{ L"JRNV", AOC::AOC_JRNV }, { L"JRPL", AOC::AOC_JRPL }, { L"JRSGE", AOC::AOC_JRSGE }, { L"JRSGT", AOC::AOC_JRSGT },
+		{ L"JRSLE", AOC::AOC_JRSLE }, { L"JRSLT", AOC::AOC_JRSLT }, { L"JRT", AOC::AOC_JRT }, { L"JRUGE", AOC::AOC_JRUGE },
+		{ L"JRUGT", AOC::AOC_JRUGT }, { L"JRULE", AOC::AOC_JRULE }, { L"JRULT", AOC::AOC_JRULT }, { L"JRV", AOC::AOC_JRV },
+		{ L"LD", AOC::AOC_LD }, { L"LDF", AOC::AOC_LDF }, { L"LDW", AOC::AOC_LDW }, { L"MOV", AOC::AOC_MOV }, { L"MUL", AOC::AOC_MUL },
+		{ L"NEG", AOC::AOC_NEG }, { L"NEGW", AOC::AOC_NEGW }, { L"NOP", AOC::AOC_NOP }, { L"OR", AOC::AOC_OR },
+		{ L"POP", AOC::AOC_POP }, { L"POPW", AOC::AOC_POPW }, { L"PUSH", AOC::AOC_PUSH }, { L"PUSHW", AOC::AOC_PUSHW },
+		{ L"RCF", AOC::AOC_RCF }, { L"RET", AOC::AOC_RET }, { L"RETF", AOC::AOC_RETF }, { L"RIM", AOC::AOC_RIM },
+		{ L"RLC", AOC::AOC_RLC }, { L"RLCW", AOC::AOC_RLCW }, { L"RLWA", AOC::AOC_RLWA }, { L"RRC", AOC::AOC_RRC },
+		{ L"RRCW", AOC::AOC_RRCW }, { L"RRWA", AOC::AOC_RRWA }, { L"RVF", AOC::AOC_RVF }, { L"SBC", AOC::AOC_SBC },
+		{ L"SCF", AOC::AOC_SCF }, { L"SIM", AOC::AOC_SIM }, { L"SLA", AOC::AOC_SLA }, { L"SLAW", AOC::AOC_SLAW },
+		{ L"SLL", AOC::AOC_SLL }, { L"SLLW", AOC::AOC_SLLW }, { L"SRA", AOC::AOC_SRA }, { L"SRAW", AOC::AOC_SRAW },
+		{ L"SRL", AOC::AOC_SRL }, { L"SRLW", AOC::AOC_SRLW }, { L"SUB", AOC::AOC_SUB }, { L"SUBW", AOC::AOC_SUBW },
+		{ L"SWAP", AOC::AOC_SWAP }, { L"SWAPW", AOC::AOC_SWAPW }, { L"TNZ", AOC::AOC_TNZ }, { L"TNZW", AOC::AOC_TNZW },
+		{ L"TRAP", AOC::AOC_TRAP }, { L"WFE", AOC::AOC_WFE }, { L"WFI", AOC::AOC_WFI }, { L"XOR", AOC::AOC_XOR }
+	});
+
+	auto oc = opcodes.find(op);
+	return (oc == opcodes.cend()) ? AOC::AOC_UNKNOWN : oc->second;
+}
+
+static AOR get_reg(const std::wstring &reg)
+{
+	const static std::map<std::wstring, AOR> regs(
+	{
+		{ L"A", AOR::AOR_A }, { L"X", AOR::AOR_X }, { L"XL", AOR::AOR_XL }, { L"XH", AOR::AOR_XH }, { L"Y", AOR::AOR_Y }, { L"YL", AOR::AOR_YL },
+		{ L"YH", AOR::AOR_YH }, { L"SP", AOR::AOR_SP }, { L"CC", AOR::AOR_CC }
+	});
+
+	auto r = regs.find(reg);
+	return (r == regs.cend()) ? AOR::AOR_NONE : r->second;
+}
+
+// numeric values are converted to hex form by the parser (see Utils::str_tohex32)
+static bool get_hex_num(const std::wstring &str, int32_t &n)
+{
+	if(str.length() < 3 || str.length() > 10 || str[0] != L'0' || str[1] != L'x')
+	{
+		return false;
+	}
+
+	uint32_t un = 0;
+	for(auto c = str.cbegin() + 2; c != str.cend(); c++)
+	{
+		if(*c >= L'0' && *c <= L'9')
+		{
+			un = (un << 4) + (*c - L'0');
+		}
+		else
+		if(*c >= L'a' && *c <= L'f')
+		{
+			un = (un << 4) + (*c - L'a' + 10);
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	n = (int32_t)un;
+	return true;
+}
+
+static B1_ASM_ARG_STM8 decode_arg(const std::wstring &arg)
+{
+	B1_ASM_ARG_STM8 da;
+
+	if(arg.empty())
+	{
+		return da;
+	}
+
+	da._reg = get_reg(arg);
+	if(da._reg != AOR::AOR_NONE)
+	{
+		da._mode = AOM::AOM_REG;
+		return da;
+	}
+
+	if(arg.front() == L'[')
+	{
+		da._mode = AOM::AOM_OTHER;
+		return da;
+	}
+
+	if(arg.front() != L'(')
+	{
+		da._mode = AOM::AOM_IMM;
+		da._is_num = get_hex_num(arg, da._num);
+		return da;
+	}
+
+	if(arg.back() != L')')
+	{
+		da._mode = AOM::AOM_OTHER;
+		return da;
+	}
+
+	auto addr = arg.substr(1, arg.length() - 2);
+
+	da._reg = get_reg(addr);
+	if(da._reg != AOR::AOR_NONE)
+	{
+		da._mode = AOM::AOM_IND;
+		return da;
+	}
+
+	auto pos = addr.rfind(L", ");
+	if(pos != std::wstring::npos)
+	{
+		da._reg = get_reg(addr.substr(pos + 2));
+		if(da._reg == AOR::AOR_NONE || addr.front() == L'[')
+		{
+			da._reg = AOR::AOR_NONE;
+			da._mode = AOM::AOM_OTHER;
+			return da;
+		}
+
+		da._mode = AOM::AOM_IDX;
+		da._is_num = get_hex_num(addr.substr(0, pos), da._num);
+		return da;
+	}
+
+	da._mode = AOM::AOM_MEM;
+	da._is_num = get_hex_num(addr, da._num);
+	return da;
+}
+
 bool B1_ASM_OP_STM8::Parse() const
 {
 	const static std::vector<wchar_t> dels({ L',', L'(', L')', L'[', L']' });
@@ -62,9 +222,12 @@ bool B1_ASM_OP_STM8::Parse() const
 	{
 		auto data = Utils::str_trim(_data);
 
+		_live_use = -1;
+
 		if(_type == AOT::AOT_LABEL)
 		{
 			_op = data;
+			_opc = AOC::AOC_UNKNOWN;
 			_parsed = true;
 		}
 		else
@@ -191,6 +354,14 @@ bool B1_ASM_OP_STM8::Parse() const
 
 			_op = op;
 			_args = args;
+
+			_opc = get_opcode(_op);
+			_opnds.clear();
+			for(const auto &a: _args)
+			{
+				_opnds.push_back(decode_arg(a));
+			}
+
 			_parsed = true;
 		}
 	}
@@ -198,6 +369,31 @@ bool B1_ASM_OP_STM8::Parse() const
 	return _parsed;
 }
 
+bool B1_ASM_OP_STM8::IsReg(size_t arg_num, AOR reg) const
+{
+	return arg_num < _opnds.size() && _opnds[arg_num]._mode == AOM::AOM_REG && _opnds[arg_num]._reg == reg;
+}
+
+bool B1_ASM_OP_STM8::IsImm(size_t arg_num, int32_t num) const
+{
+	return arg_num < _opnds.size() && _opnds[arg_num]._mode == AOM::AOM_IMM && _opnds[arg_num]._is_num && _opnds[arg_num]._num == num;
+}
+
+bool B1_ASM_OP_STM8::IsInd(size_t arg_num, AOR reg) const
+{
+	return arg_num < _opnds.size() && _opnds[arg_num]._mode == AOM::AOM_IND && _opnds[arg_num]._reg == reg;
+}
+
+bool B1_ASM_OP_STM8::IsIdx(size_t arg_num, AOR reg, int32_t off) const
+{
+	return arg_num < _opnds.size() && _opnds[arg_num]._mode == AOM::AOM_IDX && _opnds[arg_num]._reg == reg && _opnds[arg_num]._is_num && _opnds[arg_num]._num == off;
+}
+
+bool B1_ASM_OP_STM8::IsRelJump() const
+{
+	return _opc >= AOC::AOC_JRA && _opc <= AOC::AOC_JRV;
+}
+
 
 C1_T_ERROR C1STM8Compiler::process_asm_cmd(const std::wstring &line)
 {
@@ -257,7 +453,7 @@ C1_T_ERROR C1STM8Compiler::process_asm_cmd(const std::wstring &line)
 
 			if(cmd.empty())
 			{
-				_asm_stmt_it->args.push_back(B1_CMP_ARG(line));
+				_asm_stmt_it->edit_args().push_back(B1_CMP_ARG(line));
 			}
 			else
 			{
@@ -307,12 +503,12 @@ C1_T_ERROR C1STM8Compiler::process_asm_cmd(const std::wstring &line)
 					cmd = L" " + cmd;
 				}
 
-				_asm_stmt_it->args.push_back(B1_CMP_ARG(std::wstring(line.begin(), line.begin() + prev_off) + cmd + L" " + line.substr(prev_off + len)));
+				_asm_stmt_it->edit_args().push_back(B1_CMP_ARG(std::wstring(line.begin(), line.begin() + prev_off) + cmd + L" " + line.substr(prev_off + len)));
 			}
 		}
 		else
 		{
-			_asm_stmt_it->args.push_back(B1_CMP_ARG(line));
+			_asm_stmt_it->edit_args().push_back(B1_CMP_ARG(line));
 		}
 	}
 
@@ -324,6 +520,15 @@ B1_ASM_OPS::iterator C1STM8Compiler::create_asm_op(B1_ASM_OPS &sec, B1_ASM_OPS::
 	return sec.emplace(where, new B1_ASM_OP_STM8(type, lbl, _comment, is_volatile, is_inline));
 }
 
+void C1STM8Compiler::get_cache_state(std::vector<int64_t> &state) const
+{
+	C1Compiler::get_cache_state(state);
+
+	state.push_back(_page0);
+	state.push_back(_page0_sec.size());
+	state.push_back(_irq_handlers.size());
+}
+
 C1_T_ERROR C1STM8Compiler::stm8_calc_array_size(const B1_CMP_VAR &var, int32_t size1)
 {
 	if(var.fixed_size)
@@ -1797,7 +2002,7 @@ C1_T_ERROR C1STM8Compiler::stm8_load(const B1_CMP_ARG &arg, const B1Types req_ty
 		}
 
 		rv = is_ma ? (ma->second.use_symbol ? ma->second.symbol : std::to_wstring(ma->second.address)) :
-			arg[0].value;
+			arg[0].value.str();
 
 		// get value
 		if(init_type == B1Types::B1T_BYTE)
@@ -3003,6 +3208,70 @@ C1_T_ERROR C1STM8Compiler::stm8_un_op(const B1_CMP_CMD &cmd, bool omit_zero_init
 	return C1_T_ERROR::C1_RES_OK;
 }
 
+// makes additive, multiplicative and bitwise operations be calculated in the destination type if it is narrower
+// than the operation type (low-order bits of the result do not depend on high-order bits of the operands),
+// immediate operands are truncated to the destination type
+void C1STM8Compiler::stm8_narrow_op_type(const B1_CMP_CMD &cmd, B1_CMP_ARG &arg1, B1_CMP_ARG &arg2, B1Types &com_type, bool &comp) const
+{
+	const auto dst_type = cmd.args[2][0].type;
+
+	if(dst_type == B1Types::B1T_BYTE)
+	{
+		if(com_type != B1Types::B1T_INT && com_type != B1Types::B1T_WORD && com_type != B1Types::B1T_LONG)
+		{
+			return;
+		}
+	}
+	else
+	if(dst_type == B1Types::B1T_INT || dst_type == B1Types::B1T_WORD)
+	{
+		if(com_type != B1Types::B1T_LONG)
+		{
+			return;
+		}
+	}
+	else
+	{
+		return;
+	}
+
+	int32_t n1 = 0, n2 = 0;
+	const bool imm1 = B1CUtils::is_num_val(arg1[0].value);
+	const bool imm2 = B1CUtils::is_num_val(arg2[0].value);
+
+	if((imm1 && Utils::str2int32(arg1[0].value, n1) != B1_RES_OK) || (imm2 && Utils::str2int32(arg2[0].value, n2) != B1_RES_OK))
+	{
+		return;
+	}
+
+	com_type = dst_type;
+	comp = true;
+
+	if(imm1)
+	{
+		Utils::correct_int_value(n1, com_type);
+		arg1[0].value = std::to_wstring(n1);
+		arg1[0].type = com_type;
+	}
+	else
+	if(arg1[0].type == B1Types::B1T_BYTE && com_type != B1Types::B1T_BYTE)
+	{
+		comp = false;
+	}
+
+	if(imm2)
+	{
+		Utils::correct_int_value(n2, com_type);
+		arg2[0].value = std::to_wstring(n2);
+		arg2[0].type = com_type;
+	}
+	else
+	if(arg2[0].type == B1Types::B1T_BYTE && com_type != B1Types::B1T_BYTE)
+	{
+		comp = false;
+	}
+}
+
 // additive operations
 C1_T_ERROR C1STM8Compiler::stm8_add_op(const B1_CMP_CMD &cmd)
 {
@@ -3030,6 +3299,8 @@ C1_T_ERROR C1STM8Compiler::stm8_add_op(const B1_CMP_CMD &cmd)
 		comp = true;
 	}
 
+	stm8_narrow_op_type(cmd, arg1, arg2, com_type, comp);
+
 	if(cmd.cmd != L"+")
 	{
 		if(arg1[0].type == B1Types::B1T_STRING || arg2[0].type == B1Types::B1T_STRING)
@@ -3313,6 +3584,11 @@ C1_T_ERROR C1STM8Compiler::stm8_mul_op(const B1_CMP_CMD &cmd)
 		{
 			return static_cast<C1_T_ERROR>(err);
 		}
+
+		if(cmd.cmd == L"*")
+		{
+			stm8_narrow_op_type(cmd, arg1, arg2, com_type, comp);
+		}
 	}
 
 	if(com_type == B1Types::B1T_BYTE)
@@ -3471,6 +3747,8 @@ C1_T_ERROR C1STM8Compiler::stm8_bit_op(const B1_CMP_CMD &cmd)
 		return static_cast<C1_T_ERROR>(err);
 	}
 
+	stm8_narrow_op_type(cmd, arg1, arg2, com_type, comp);
+
 	if(cmd.cmd == L"&")
 	{
 		inst = L"AND";
@@ -4256,7 +4534,7 @@ C1_T_ERROR C1STM8Compiler::stm8_load_ptr(const B1_CMP_ARG &first, const B1_CMP_A
 		return err;
 	}
 
-	const auto rv = is_ma ? (var->use_symbol ? var->symbol : std::to_wstring(var->address)) : first[0].value;
+	const auto rv = is_ma ? (var->use_symbol ? var->symbol : std::to_wstring(var->address)) : first[0].value.str();
 
 	if(is_ma)
 	{
@@ -4728,118 +5006,372 @@ C1_T_ERROR C1STM8Compiler::stm8_write_ioctl(std::list<B1_CMP_CMD>::iterator &cmd
 	return C1_T_ERROR::C1_RES_OK;
 }
 
-C1_T_ERROR C1STM8Compiler::write_data_sec(bool code_init)
+// writes binary decision tree for the case values [first, last) sorted in ascending order, the selector value is
+// expected in A (BYTE type) or X (INT and WORD types) register
+void C1STM8Compiler::stm8_write_switch_tree(const std::vector<std::pair<int32_t, std::wstring>> &cases, size_t first, size_t last, const B1Types type, const std::wstring &dflt_label)
 {
-	B1_ASM_OPS *data = _page0 ? &_page0_sec : &_data_sec;
+	const auto write_cmp = [this, type](int32_t value)
+	{
+		if(type == B1Types::B1T_BYTE)
+		{
+			add_op(*_curr_code_sec, L"CP A, " + Utils::str_tohex16(value), false); //A1 BYTE_VALUE
+		}
+		else
+		{
+			add_op(*_curr_code_sec, L"CPW X, " + Utils::str_tohex16(value), false); //A3 WORD_VALUE
+		}
+	};
 
-	_comment.clear();
+	if(last - first <= STM8_SWITCH_MAX_LEAF_CASES)
+	{
+		for(auto i = first; i < last; i++)
+		{
+			write_cmp(cases[i].first);
+			add_op(*_curr_code_sec, L"JREQ " + cases[i].second, false); //27 SIGNED_BYTE_OFFSET
+		}
 
-	for(const auto &vn: _vars_order)
+		add_op(*_curr_code_sec, L"JRA " + dflt_label, false); //20 SIGNED_BYTE_OFFSET
+
+		return;
+	}
+
+	const auto mid = first + (last - first) / 2;
+	const auto left_label = emit_label(true);
+
+	write_cmp(cases[mid].first);
+	add_op(*_curr_code_sec, L"JREQ " + cases[mid].second, false); //27 SIGNED_BYTE_OFFSET
+	if(type == B1Types::B1T_INT)
 	{
-		bool is_static = false;
-		int32_t size, rep;
-		std::wstring type;
+		add_op(*_curr_code_sec, L"JRSLT " + left_label, false); //2F SIGNED_BYTE_OFFSET
+	}
+	else
+	{
+		add_op(*_curr_code_sec, L"JRULT " + left_label, false); //25 SIGNED_BYTE_OFFSET
+	}
+	_req_symbols.insert(left_label);
 
-		auto v = _mem_areas.find(vn);
-		if(v != _mem_areas.cend())
+	stm8_write_switch_tree(cases, mid + 1, last, type, dflt_label);
+
+	add_lbl(*_curr_code_sec, _curr_code_sec->cend(), left_label, false);
+	_all_symbols.insert(left_label);
+
+	stm8_write_switch_tree(cases, first, mid, type, dflt_label);
+}
+
+// compiles a sequence of equality tests of the same variable with integer constants followed by conditional jumps
+// (SELECT CASE statement tests or a chain of IF statements) into a jump table or a binary decision tree, short
+// sequences are left for ordinary compilation (done is set to false)
+C1_T_ERROR C1STM8Compiler::stm8_write_switch(std::list<B1_CMP_CMD>::iterator &cmd_it, bool &done)
+{
+	done = false;
+
+	const auto sel = cmd_it->args[0];
+	const auto type = sel[0].type;
+
+	if(sel.size() != 1 || B1CUtils::is_imm_val(sel[0].value) || (type != B1Types::B1T_BYTE && type != B1Types::B1T_INT && type != B1Types::B1T_WORD))
+	{
+		return C1_T_ERROR::C1_RES_OK;
+	}
+
+	// the selector is read once instead of reading it before every comparison so it must not be volatile
+	if(!B1CUtils::is_local(sel[0].value) && !B1CUtils::is_fn_arg(sel[0].value))
+	{
+		const auto ma = _mem_areas.find(sel[0].value);
+		if(ma != _mem_areas.cend())
 		{
-			// constant variables are placed in .CONST section
-			if(v->second.is_const)
+			if(ma->second.is_volatile || ma->second.dim_num != 0)
 			{
-				continue;
+				return C1_T_ERROR::C1_RES_OK;
 			}
-
-			is_static = true;
 		}
 		else
 		{
-			v = _vars.find(vn);
-			if(v == _vars.cend())
+			const auto var = _vars.find(sel[0].value);
+			if(var == _vars.cend() || var->second.is_volatile || var->second.dim_num != 0)
 			{
-				continue;
+				return C1_T_ERROR::C1_RES_OK;
 			}
 		}
+	}
 
-		_curr_src_file_id = v->second.src_file_id;
-		_curr_line_cnt = v->second.src_line_cnt;
+	//                    value    label
+	std::vector<std::pair<int32_t, std::wstring>> cases;
+	std::set<int32_t> values;
+	auto last = cmd_it;
 
-		if(v->second.dim_num == 0)
+	for(auto ci = cmd_it; ci != end(); ci++)
+	{
+		const auto &cmd = *ci;
+
+		if(	!B1CUtils::is_cmd(cmd) || cmd.cmd != L"==" || cmd.args[0].size() != 1 || cmd.args[0][0].value != sel[0].value || cmd.args[0][0].type != type ||
+			cmd.args[1].size() != 1 || !B1CUtils::is_num_val(cmd.args[1][0].value))
 		{
-			if(!B1CUtils::get_asm_type(v->second.type, &type, &size, &rep))
-			{
-				return C1_T_ERROR::C1_RES_EINVTYPNAME;
-			}
+			break;
 		}
-		else
-		if(is_static)
+
+		const auto jt = std::next(ci);
+		if(jt == end() || !B1CUtils::is_cmd(*jt) || jt->cmd != L"JT")
 		{
-			if(!B1CUtils::get_asm_type(v->second.type, &type, &size, &rep))
-			{
-				return C1_T_ERROR::C1_RES_EINVTYPNAME;
-			}
+			break;
+		}
 
-			rep = 1;
+		// deferred stores are written before the commands they are attached to
+		if(std::find_if(_store_at.cbegin(), _store_at.cend(), [&ci, &jt, &cmd_it](const auto &s) { return (std::get<0>(s) == ci && ci != cmd_it) || std::get<0>(s) == jt; }) != _store_at.cend())
+		{
+			break;
+		}
 
-			for(int32_t i = 0; i < v->second.dim_num; i++)
-			{
-				rep *= v->second.dims[i * 2 + 1] - v->second.dims[i * 2] + 1;
-			}
+		int32_t n = 0;
+		if(Utils::str2int32(cmd.args[1][0].value, n) != B1_RES_OK)
+		{
+			break;
+		}
 
-			size *= rep;
+		B1Types com_type = B1Types::B1T_UNKNOWN;
+		bool comp = false;
+		if(B1CUtils::get_com_type(type, cmd.args[1][0].type, com_type, comp) != B1_RES_OK)
+		{
+			break;
+		}
+
+		// the values are compared in the common type
+		if(com_type == B1Types::B1T_BYTE)
+		{
+			n = (uint8_t)n;
 		}
 		else
+		if(com_type == B1Types::B1T_INT)
 		{
-			if(!B1CUtils::get_asm_type(v->second.type, &type, &size, &rep, v->second.dim_num))
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
-
-			// correct size for arrays with known sizes (address only, no dimensions)
-			if(v->second.fixed_size)
-			{
-				size = size / rep;
-				rep = 1;
-			}
+			n = (type == B1Types::B1T_WORD) ? (int32_t)(uint16_t)n : (int32_t)(int16_t)n;
 		}
-
-		if(!code_init && std::find(_init_files.cbegin(), _init_files.cend(), v->first) != _init_files.cend())
+		else
+		if(com_type == B1Types::B1T_WORD)
 		{
-			continue;
+			n = (uint16_t)n;
 		}
 
-		if(_page0 && _data_size + size > STM8_PAGE0_SIZE)
+		last = jt;
+		ci = jt;
+
+		// the selector never equals the value out of its type range, the first of equal values wins
+		if(	((type == B1Types::B1T_BYTE && n >= 0 && n <= 255) || (type == B1Types::B1T_INT && n >= -32768 && n <= 32767) || (type == B1Types::B1T_WORD && n >= 0 && n <= 65535)) &&
+			values.insert(n).second)
 		{
-			_page0 = false;
-			data = &_data_sec;
+			cases.push_back(std::make_pair(n, jt->args[0][0].value.str()));
 		}
+	}
 
-		add_lbl(*data, data->cend(), v->first, v->second.is_volatile);
-		add_data(*data, data->cend(), type + (rep == 1 ? std::wstring() : L" (" + std::to_wstring(rep) + L")"), v->second.is_volatile);
+	// the command following the tests must not depend on the comparison result
+	const auto next = std::next(last);
+	if(cases.size() < STM8_SWITCH_MIN_CASES || (next != end() && B1CUtils::is_cmd(*next) && (next->cmd == L"JT" || next->cmd == L"JF")))
+	{
+		return C1_T_ERROR::C1_RES_OK;
+	}
 
-		_all_symbols.insert(v->first);
+	std::sort(cases.begin(), cases.end());
 
-		v->second.size = size;
-		v->second.address = _data_size;
+	const auto min_value = cases.front().first;
+	const auto span = cases.back().first - min_value + 1;
 
-		_data_size += size;
+	auto err = stm8_load(sel, type, LVT::LVT_REG);
+	if(err != C1_T_ERROR::C1_RES_OK)
+	{
+		return err;
 	}
 
-	// non-user variables
-	if(!_data_stmts.empty())
+	const auto dflt_label = emit_label(true);
+	_req_symbols.insert(dflt_label);
+
+	// jump table entries are 16-bit addresses so the table is used with small memory model only
+	if(_global_settings.GetRetAddressSize() == 2 && span <= STM8_SWITCH_MAX_TABLE_SIZE && span <= (int32_t)cases.size() * STM8_SWITCH_MAX_ENTRIES_PER_CASE)
 	{
-		for(const auto &dt: _data_stmts)
-		{
-			// namespace
-			std::wstring label = dt.first;
+		const auto table_label = emit_label(true);
+		_req_symbols.insert(table_label);
 
-			// no __DAT_PTR variable for const variables data
-			if(_mem_areas.find(label) != _mem_areas.cend())
+		if(type == B1Types::B1T_BYTE)
+		{
+			if(min_value != 0)
 			{
-				continue;
+				add_op(*_curr_code_sec, L"SUB A, " + Utils::str_tohex16(min_value), false); //A0 BYTE_VALUE
 			}
-
-			label = label.empty() ? std::wstring() : (label + L"::");
-
+			if(span < 256)
+			{
+				add_op(*_curr_code_sec, L"CP A, " + Utils::str_tohex16(span), false); //A1 BYTE_VALUE
+				add_op(*_curr_code_sec, L"JRUGE " + dflt_label, false); //24 SIGNED_BYTE_OFFSET
+			}
+			add_op(*_curr_code_sec, L"CLRW X", false); //5F
+			add_op(*_curr_code_sec, L"LD XL, A", false); //97
+		}
+		else
+		{
+			if(min_value != 0)
+			{
+				add_op(*_curr_code_sec, L"SUBW X, " + Utils::str_tohex16(min_value), false); //1D WORD_VALUE
+			}
+			add_op(*_curr_code_sec, L"CPW X, " + Utils::str_tohex16(span), false); //A3 WORD_VALUE
+			add_op(*_curr_code_sec, L"JRUGE " + dflt_label, false); //24 SIGNED_BYTE_OFFSET
+		}
+
+		add_op(*_curr_code_sec, L"SLLW X", false); //58
+		add_op(*_curr_code_sec, L"LDW X, (" + table_label + L", X)", false); //DE WORD_OFFSET
+		add_op(*_curr_code_sec, L"JP (X)", false); //FC
+
+		// the table: addresses of CASE labels for all the values from min_value to max value
+		add_lbl(*_curr_const_sec, _curr_const_sec->cend(), table_label, false);
+		_all_symbols.insert(table_label);
+
+		auto c = cases.cbegin();
+		std::wstring entries;
+
+		for(int32_t i = 0; i < span; i++)
+		{
+			entries += entries.empty() ? L"DW " : L", ";
+
+			if(c->first == min_value + i)
+			{
+				entries += c->second;
+				c++;
+			}
+			else
+			{
+				entries += dflt_label;
+			}
+
+			if((i % 8) == 7 || i == span - 1)
+			{
+				add_data(*_curr_const_sec, _curr_const_sec->cend(), entries, false);
+				entries.clear();
+			}
+		}
+
+		_const_size += span * 2;
+	}
+	else
+	{
+		stm8_write_switch_tree(cases, 0, cases.size(), type, dflt_label);
+	}
+
+	add_lbl(*_curr_code_sec, _curr_code_sec->cend(), dflt_label, false);
+	_all_symbols.insert(dflt_label);
+
+	cmd_it = last;
+	done = true;
+
+	return C1_T_ERROR::C1_RES_OK;
+}
+
+C1_T_ERROR C1STM8Compiler::write_data_sec(bool code_init)
+{
+	B1_ASM_OPS *data = _page0 ? &_page0_sec : &_data_sec;
+
+	_comment.clear();
+
+	for(const auto &vn: _vars_order)
+	{
+		bool is_static = false;
+		int32_t size, rep;
+		std::wstring type;
+
+		auto v = _mem_areas.find(vn);
+		if(v != _mem_areas.cend())
+		{
+			// constant variables are placed in .CONST section
+			if(v->second.is_const)
+			{
+				continue;
+			}
+
+			is_static = true;
+		}
+		else
+		{
+			v = _vars.find(vn);
+			if(v == _vars.cend())
+			{
+				continue;
+			}
+		}
+
+		_curr_src_file_id = v->second.src_file_id;
+		_curr_line_cnt = v->second.src_line_cnt;
+
+		if(v->second.dim_num == 0)
+		{
+			if(!B1CUtils::get_asm_type(v->second.type, &type, &size, &rep))
+			{
+				return C1_T_ERROR::C1_RES_EINVTYPNAME;
+			}
+		}
+		else
+		if(is_static)
+		{
+			if(!B1CUtils::get_asm_type(v->second.type, &type, &size, &rep))
+			{
+				return C1_T_ERROR::C1_RES_EINVTYPNAME;
+			}
+
+			rep = 1;
+
+			for(int32_t i = 0; i < v->second.dim_num; i++)
+			{
+				rep *= v->second.dims[i * 2 + 1] - v->second.dims[i * 2] + 1;
+			}
+
+			size *= rep;
+		}
+		else
+		{
+			if(!B1CUtils::get_asm_type(v->second.type, &type, &size, &rep, v->second.dim_num))
+			{
+				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+			}
+
+			// correct size for arrays with known sizes (address only, no dimensions)
+			if(v->second.fixed_size)
+			{
+				size = size / rep;
+				rep = 1;
+			}
+		}
+
+		if(!code_init && std::find(_init_files.cbegin(), _init_files.cend(), v->first) != _init_files.cend())
+		{
+			continue;
+		}
+
+		if(_page0 && _data_size + size > STM8_PAGE0_SIZE)
+		{
+			_page0 = false;
+			data = &_data_sec;
+		}
+
+		add_lbl(*data, data->cend(), v->first, v->second.is_volatile);
+		add_data(*data, data->cend(), type + (rep == 1 ? std::wstring() : L" (" + std::to_wstring(rep) + L")"), v->second.is_volatile);
+
+		_all_symbols.insert(v->first);
+
+		v->second.size = size;
+		v->second.address = _data_size;
+
+		_data_size += size;
+	}
+
+	// non-user variables
+	if(!_data_stmts.empty())
+	{
+		for(const auto &dt: _data_stmts)
+		{
+			// namespace
+			std::wstring label = dt.first;
+
+			// no __DAT_PTR variable for const variables data
+			if(_mem_areas.find(label) != _mem_areas.cend())
+			{
+				continue;
+			}
+
+			label = label.empty() ? std::wstring() : (label + L"::");
+
 			label = label + L"__DAT_PTR";
 			B1_CMP_VAR var(label, B1Types::B1T_WORD, 0, false, false, -1, 0);
 			B1CUtils::get_asm_type(B1Types::B1T_WORD, nullptr, &var.size);
@@ -4866,6 +5398,160 @@ C1_T_ERROR C1STM8Compiler::write_data_sec(bool code_init)
 	return C1_T_ERROR::C1_RES_OK;
 }
 
+// gets arrays allocated on every path to the labels: array allocation checks are omitted in a loop if the array
+// is allocated before the loop and the loop body does not free it (and does not call subroutines)
+void C1STM8Compiler::calc_allocated_arrays()
+{
+	_label_allocated_arrays.clear();
+
+	// labels referenced by jump commands only (labels of subroutines, functions, error handlers, etc. can get control from anywhere)
+	std::map<std::wstring, bool> labels;
+
+	for(const auto &cmd: *this)
+	{
+		if(B1CUtils::is_inline_asm(cmd))
+		{
+			// inline code can jump to any label
+			return;
+		}
+
+		if(B1CUtils::is_label(cmd))
+		{
+			labels[cmd.cmd] = (_ufns.find(cmd.cmd) == _ufns.cend());
+		}
+	}
+
+	for(const auto &cmd: *this)
+	{
+		if(B1CUtils::is_label(cmd))
+		{
+			continue;
+		}
+
+		const bool jump = (cmd.cmd == L"JMP" || cmd.cmd == L"JT" || cmd.cmd == L"JF");
+
+		for(auto a = cmd.args.cbegin() + (jump ? 1 : 0); a < cmd.args.cend(); a++)
+		{
+			for(const auto &tv: *a)
+			{
+				auto l = labels.find(tv.value.str());
+				if(l != labels.end())
+				{
+					l->second = false;
+				}
+			}
+		}
+	}
+
+	// arrays allocated at the current command and on all the paths to the labels reached so far
+	std::set<std::wstring> arrays;
+	bool changed = true;
+
+	auto merge = [this, &changed](const std::wstring &label, const std::set<std::wstring> &arrays)
+	{
+		auto la = _label_allocated_arrays.find(label);
+		if(la == _label_allocated_arrays.end())
+		{
+			_label_allocated_arrays[label] = arrays;
+			changed = true;
+			return;
+		}
+
+		for(auto a = la->second.begin(); a != la->second.end(); )
+		{
+			if(arrays.find(*a) == arrays.end())
+			{
+				a = la->second.erase(a);
+				changed = true;
+			}
+			else
+			{
+				a++;
+			}
+		}
+	};
+
+	while(changed)
+	{
+		changed = false;
+
+		// the code beginning
+		bool reached = true;
+		arrays.clear();
+
+		for(const auto &cmd: *this)
+		{
+			if(B1CUtils::is_label(cmd))
+			{
+				if(!labels[cmd.cmd])
+				{
+					reached = true;
+					arrays.clear();
+					continue;
+				}
+
+				if(reached)
+				{
+					merge(cmd.cmd, arrays);
+				}
+
+				auto la = _label_allocated_arrays.find(cmd.cmd);
+				reached = (la != _label_allocated_arrays.end());
+				if(reached)
+				{
+					arrays = la->second;
+				}
+
+				continue;
+			}
+
+			if(cmd.cmd == L"INT")
+			{
+				// interrupt handler beginning
+				reached = true;
+				arrays.clear();
+				continue;
+			}
+
+			if(!reached)
+			{
+				continue;
+			}
+
+			if(cmd.cmd == L"GA" && cmd.args.size() > 2)
+			{
+				arrays.insert(cmd.args[0][0].value.str());
+			}
+			else
+			if(cmd.cmd == L"GF")
+			{
+				arrays.erase(cmd.args[0][0].value.str());
+			}
+			else
+			if(cmd.cmd == L"CALL" || cmd.cmd == L"INL")
+			{
+				arrays.clear();
+			}
+			else
+			if(cmd.cmd == L"JMP" || cmd.cmd == L"JT" || cmd.cmd == L"JF")
+			{
+				auto l = labels.find(cmd.args[0][0].value.str());
+				if(l != labels.end() && l->second)
+				{
+					merge(l->first, arrays);
+				}
+
+				reached = (cmd.cmd != L"JMP");
+			}
+			else
+			if(cmd.cmd == L"RET" || cmd.cmd == L"END" || cmd.cmd == L"STOP")
+			{
+				reached = false;
+			}
+		}
+	}
+}
+
 C1_T_ERROR C1STM8Compiler::write_code_sec(bool code_init)
 {
 	// code
@@ -4883,6 +5569,7 @@ C1_T_ERROR C1STM8Compiler::write_code_sec(bool code_init)
 	_clear_locals.clear();
 
 	_allocated_arrays.clear();
+	calc_allocated_arrays();
 
 	_comment.clear();
 
@@ -4991,7 +5678,15 @@ C1_T_ERROR C1STM8Compiler::write_code_sec(bool code_init)
 			_cmp_active = false;
 			_retval_active = false;
 
-			_allocated_arrays.clear();
+			const auto la = _label_allocated_arrays.find(cmd.cmd);
+			if(la != _label_allocated_arrays.cend())
+			{
+				_allocated_arrays = la->second;
+			}
+			else
+			{
+				_allocated_arrays.clear();
+			}
 
 			omit_zero_init = false;
 
@@ -6734,16 +7429,39 @@ C1_T_ERROR C1STM8Compiler::write_code_sec(bool code_init)
 			}
 			else
 			{
-				// numeric comparison
-				auto err = stm8_num_cmp_op(cmd);
-				if(err != C1_T_ERROR::C1_RES_OK)
+				if(cmd.cmd == L"==")
 				{
-					return err;
-				}
-			}
-
-			_retval_active = false;
-
+					// a sequence of tests (SELECT CASE statement)
+					bool done = false;
+					auto err = stm8_write_switch(ci, done);
+					if(err != C1_T_ERROR::C1_RES_OK)
+					{
+						return err;
+					}
+
+					if(done)
+					{
+						_cmp_active = false;
+						_retval_active = false;
+
+						omit_zero_init = false;
+
+						extra_params.clear();
+
+						continue;
+					}
+				}
+
+				// numeric comparison
+				auto err = stm8_num_cmp_op(cmd);
+				if(err != C1_T_ERROR::C1_RES_OK)
+				{
+					return err;
+				}
+			}
+
+			_retval_active = false;
+
 			omit_zero_init = false;
 
 			extra_params.clear();
@@ -6799,35 +7517,35 @@ std::wstring C1STM8Compiler::correct_SP_offset(const std::wstring &arg, int32_t
 bool C1STM8Compiler::is_arithm_op(const B1_ASM_OP_STM8 &ao, int32_t &size, int *n_SP_arg /*= nullptr*/) const
 {
 	bool res = false;
-	auto &op = ao._op;
+	auto op = ao._opc;
 
-	if(op == L"LDW" || op == L"ADDW" || op == L"SUBW" || op == L"MUL" || op == L"DIV" || op == L"DIVW" || op == L"INCW" || op == L"DECW" || op == L"NEGW" || op == L"CPLW" || op == L"CLRW" ||
-		op == L"SLLW" || op == L"SLAW" || op == L"SRLW" || op == L"SRAW" || op == L"RLWA" || op == L"RRWA")
+	if(op == AOC::AOC_LDW || op == AOC::AOC_ADDW || op == AOC::AOC_SUBW || op == AOC::AOC_MUL || op == AOC::AOC_DIV || op == AOC::AOC_DIVW || op == AOC::AOC_INCW || op == AOC::AOC_DECW || op == AOC::AOC_NEGW || op == AOC::AOC_CPLW || op == AOC::AOC_CLRW ||
+		op == AOC::AOC_SLLW || op == AOC::AOC_SLAW || op == AOC::AOC_SRLW || op == AOC::AOC_SRAW || op == AOC::AOC_RLWA || op == AOC::AOC_RRWA)
 	{
 		size = 2;
 		res = true;
-		if(op == L"LDW" && (ao._args[0] == L"X" || ao._args[0] == L"Y" || ao._args[0] == L"SP") && (ao._args[1] == L"X" || ao._args[1] == L"Y" || ao._args[1] == L"SP"))
+		if(op == AOC::AOC_LDW && (ao.IsReg(0, AOR::AOR_X) || ao.IsReg(0, AOR::AOR_Y) || ao.IsReg(0, AOR::AOR_SP)) && (ao.IsReg(1, AOR::AOR_X) || ao.IsReg(1, AOR::AOR_Y) || ao.IsReg(1, AOR::AOR_SP)))
 		{
 			res = false;
 		}
 		else
-		if((op == L"ADDW" || op == L"SUBW") && ao._args[0] == L"SP")
+		if((op == AOC::AOC_ADDW || op == AOC::AOC_SUBW) && ao.IsReg(0, AOR::AOR_SP))
 		{
 			res = false;
 		}
 	}
 	else
-	if(op == L"LD" || op == L"ADD" || op == L"SUB" || op == L"ADC" || op == L"SBC" || op == L"INC" || op == L"DEC" || op == L"NEG" || op == L"AND" || op == L"OR" || op == L"XOR" || op == L"CPL"
-		|| op == L"CLR" || op == L"SLL" || op == L"SLA" || op == L"SRL" || op == L"SRA" || op == L"RLC")
+	if(op == AOC::AOC_LD || op == AOC::AOC_ADD || op == AOC::AOC_SUB || op == AOC::AOC_ADC || op == AOC::AOC_SBC || op == AOC::AOC_INC || op == AOC::AOC_DEC || op == AOC::AOC_NEG || op == AOC::AOC_AND || op == AOC::AOC_OR || op == AOC::AOC_XOR || op == AOC::AOC_CPL
+		|| op == AOC::AOC_CLR || op == AOC::AOC_SLL || op == AOC::AOC_SLA || op == AOC::AOC_SRL || op == AOC::AOC_SRA || op == AOC::AOC_RLC)
 	{
 		size = 1;
 		res = true;
-		if(op == L"LD" && (ao._args[0] == L"A" || ao._args[0] == L"XL" || ao._args[0] == L"XH" || ao._args[0] == L"YL" || ao._args[0] == L"YH") && (ao._args[1] == L"A" || ao._args[1] == L"XL" || ao._args[1] == L"XH" || ao._args[1] == L"YL" || ao._args[1] == L"YH"))
+		if(op == AOC::AOC_LD && (ao.IsReg(0, AOR::AOR_A) || ao.IsReg(0, AOR::AOR_XL) || ao.IsReg(0, AOR::AOR_XH) || ao.IsReg(0, AOR::AOR_YL) || ao.IsReg(0, AOR::AOR_YH)) && (ao.IsReg(1, AOR::AOR_A) || ao.IsReg(1, AOR::AOR_XL) || ao.IsReg(1, AOR::AOR_XH) || ao.IsReg(1, AOR::AOR_YL) || ao.IsReg(1, AOR::AOR_YH)))
 		{
 			res = false;
 		}
 		else
-		if((op == L"ADD" || op == L"SUB") && ao._args[0] == L"SP")
+		if((op == AOC::AOC_ADD || op == AOC::AOC_SUB) && ao.IsReg(0, AOR::AOR_SP))
 		{
 			res = false;
 		}
@@ -6836,12 +7554,12 @@ bool C1STM8Compiler::is_arithm_op(const B1_ASM_OP_STM8 &ao, int32_t &size, int *
 	if(n_SP_arg != nullptr)
 	{
 		*n_SP_arg = -1;
-		if(ao._args.size() > 0 && (ao._args[0] == L"SP" || ao._args[0].find(L", SP)") != std::wstring::npos))
+		if(ao._args.size() > 0 && (ao.IsReg(0, AOR::AOR_SP) || ao._args[0].find(L", SP)") != std::wstring::npos))
 		{
 			*n_SP_arg = 0;
 		}
 		else
-		if(ao._args.size() == 2 && (ao._args[1] == L"SP" || ao._args[1].find(L", SP)") != std::wstring::npos))
+		if(ao._args.size() == 2 && (ao.IsReg(1, AOR::AOR_SP) || ao._args[1].find(L", SP)") != std::wstring::npos))
 		{
 			*n_SP_arg = 1;
 		}
@@ -6864,38 +7582,38 @@ bool C1STM8Compiler::is_reg_used(const B1_ASM_OP_STM8 &ao, const std::wstring &r
 	{
 		return true;
 	}
-	if(ao._op == L"JRA" || ao._op == L"JP" || ao._op == L"JPF" || ao._op == L"JRT" || ((ao._op.size() > 2 && ao._op[0] == L'J' && ao._op[1] == L'R') || ao._op == L"BTJF" || ao._op == L"BTJT"))
+	if(ao._opc == AOC::AOC_JRA || ao._opc == AOC::AOC_JP || ao._opc == AOC::AOC_JPF || ao._opc == AOC::AOC_JRT || (ao.IsRelJump() || ao._opc == AOC::AOC_BTJF || ao._opc == AOC::AOC_BTJT))
 	{
 		return true;
 	}
-	if(ao._op == L"CALLR" || ao._op == L"CALL" || ao._op == L"CALLF")
+	if(ao._opc == AOC::AOC_CALLR || ao._opc == AOC::AOC_CALL || ao._opc == AOC::AOC_CALLF)
 	{
 		return true;
 	}
-	if(ao._op == L"RET" || ao._op == L"RETF")
+	if(ao._opc == AOC::AOC_RET || ao._opc == AOC::AOC_RETF)
 	{
 		return true;
 	}
-	if((ao._op == L"RLWA" || ao._op == L"RRWA") && reg_name == L"A")
+	if((ao._opc == AOC::AOC_RLWA || ao._opc == AOC::AOC_RRWA) && reg_name == L"A")
 	{
 		return true;
 	}
-	if((ao._op == L"LD" || ao._op == L"LDW" || ao._op == L"LDF") && ao._args[0] == reg_name && ao._args[1] != L"(" + reg_name + L")" && ao._args[1].find(L", " + reg_name + L")") == std::wstring::npos)
+	if((ao._opc == AOC::AOC_LD || ao._opc == AOC::AOC_LDW || ao._opc == AOC::AOC_LDF) && ao._args[0] == reg_name && ao._args[1] != L"(" + reg_name + L")" && ao._args[1].find(L", " + reg_name + L")") == std::wstring::npos)
 	{
 		reg_write_op = true;
 		return false;
 	}
-	if((ao._op == L"CLR" || ao._op == L"CLRW") && ao._args[0] == reg_name)
+	if((ao._opc == AOC::AOC_CLR || ao._opc == AOC::AOC_CLRW) && ao._args[0] == reg_name)
 	{
 		reg_write_op = true;
 		return false;
 	}
-	if((ao._op == L"POP" || ao._op == L"POPW") && ao._args[0] == reg_name)
+	if((ao._opc == AOC::AOC_POP || ao._opc == AOC::AOC_POPW) && ao._args[0] == reg_name)
 	{
 		reg_write_op = true;
 		return false;
 	}
-	if(ao._op == L"IRET" || ao._op == L"TRAP")
+	if(ao._opc == AOC::AOC_IRET || ao._opc == AOC::AOC_TRAP)
 	{
 		reg_write_op = true;
 		return false;
@@ -6912,12 +7630,12 @@ bool C1STM8Compiler::is_reg_used(const B1_ASM_OP_STM8 &ao, const std::wstring &r
 			return true;
 		}
 	}
-	if(ao._op == L"EXG" && ((reg_name == L"X" && ao._args[1] == L"XL") || (reg_name == L"Y" && ao._args[1] == L"YL")))
+	if(ao._opc == AOC::AOC_EXG && ((reg_name == L"X" && ao.IsReg(1, AOR::AOR_XL)) || (reg_name == L"Y" && ao.IsReg(1, AOR::AOR_YL))))
 	{
 		return true;
 	}
 
-	if(ao._op == L"LD" && ((reg_name == L"X" && (ao._args[1] == L"XL" || ao._args[1] == L"XH")) || (reg_name == L"Y" && (ao._args[1] == L"YL" || ao._args[1] == L"YH"))))
+	if(ao._opc == AOC::AOC_LD && ((reg_name == L"X" && (ao.IsReg(1, AOR::AOR_XL) || ao.IsReg(1, AOR::AOR_XH))) || (reg_name == L"Y" && (ao.IsReg(1, AOR::AOR_YL) || ao.IsReg(1, AOR::AOR_YH)))))
 	{
 		return true;
 	}
@@ -6925,68 +7643,548 @@ bool C1STM8Compiler::is_reg_used(const B1_ASM_OP_STM8 &ao, const std::wstring &r
 	return false;
 }
 
-// a strange function - must be revised
-// for A, X and Y registers
-bool C1STM8Compiler::is_reg_used_after(B1_ASM_OPS::const_iterator start, B1_ASM_OPS::const_iterator end, const std::wstring &reg_name, bool branch /*= false*/) const
+// registers an instruction argument refers to: the register itself or the registers used to address memory
+static int32_t get_live_arg_regs(const B1_ASM_OP_STM8 &ao, size_t arg_num)
+{
+	if(arg_num >= ao._opnds.size())
+	{
+		return 0;
+	}
+
+	const auto &da = ao._opnds[arg_num];
+
+	if(da._mode == AOM::AOM_OTHER)
+	{
+		// pointer indirect modes: ([<ptr>], X), ([<ptr>.w], Y), etc.
+		const auto &arg = ao._args[arg_num];
+		return ((arg.find(L"X)") == std::wstring::npos) ? 0 : C1STM8_LIVE_X) | ((arg.find(L"Y)") == std::wstring::npos) ? 0 : C1STM8_LIVE_Y);
+	}
+
+	switch(da._reg)
+	{
+		case AOR::AOR_A:
+			return C1STM8_LIVE_A;
+		case AOR::AOR_X:
+			return C1STM8_LIVE_X;
+		case AOR::AOR_XL:
+			return C1STM8_LIVE_XL;
+		case AOR::AOR_XH:
+			return C1STM8_LIVE_XH;
+		case AOR::AOR_Y:
+			return C1STM8_LIVE_Y;
+		case AOR::AOR_YL:
+			return C1STM8_LIVE_YL;
+		case AOR::AOR_YH:
+			return C1STM8_LIVE_YH;
+		case AOR::AOR_CC:
+			return C1STM8_LIVE_FLAGS;
+		default:
+			// SP is not tracked
+			break;
+	}
+
+	return 0;
+}
+
+// registers and flags an instruction reads (use) and the ones it always writes (def), unknown instructions
+// read everything
+static void get_live_use_def(const B1_ASM_OP_STM8 &ao, int32_t &use, int32_t &def)
 {
-	int n = 0;
+	use = 0;
+	def = 0;
 
-	for(start++; start != end && (!branch || n < 5); start++, n++)
+	if(ao._type == AOT::AOT_LABEL)
 	{
-		auto &ao = *static_cast<const B1_ASM_OP_STM8 *>(start->get());
+		return;
+	}
 
-		if(ao._type == AOT::AOT_LABEL)
+	use = C1STM8_LIVE_ALL;
+
+	if(!ao.Parse())
+	{
+		return;
+	}
+
+	if(ao._live_use >= 0)
+	{
+		use = ao._live_use;
+		def = ao._live_def;
+		return;
+	}
+
+	const bool reg0 = ao._opnds.size() > 0 && ao._opnds[0]._mode == AOM::AOM_REG;
+	const bool reg1 = ao._opnds.size() > 1 && ao._opnds[1]._mode == AOM::AOM_REG;
+	const int32_t arg0 = get_live_arg_regs(ao, 0);
+	const int32_t arg1 = get_live_arg_regs(ao, 1);
+	// register written by the instruction (if the first argument is a register)
+	const int32_t dst0 = reg0 ? arg0 : 0;
+
+	switch(ao._opc)
+	{
+		case AOC::AOC_ADC:
+			use = C1STM8_LIVE_A | arg1 | C1STM8_LIVE_C;
+			def = C1STM8_LIVE_A | C1STM8_LIVE_V | C1STM8_LIVE_H | C1STM8_LIVE_N | C1STM8_LIVE_Z | C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_SBC:
+			use = C1STM8_LIVE_A | arg1 | C1STM8_LIVE_C;
+			def = C1STM8_LIVE_A | C1STM8_LIVE_V | C1STM8_LIVE_N | C1STM8_LIVE_Z | C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_ADD:
+		case AOC::AOC_ADDW:
+		case AOC::AOC_SUB:
+		case AOC::AOC_SUBW:
+			// stack pointer arithmetic does not change flags
+			use = ao.IsReg(0, AOR::AOR_SP) ? 0 : (arg0 | arg1);
+			def = ao.IsReg(0, AOR::AOR_SP) ? 0 : (dst0 | C1STM8_LIVE_V | C1STM8_LIVE_N | C1STM8_LIVE_Z | C1STM8_LIVE_C | ((ao._opc == AOC::AOC_ADD || ao._opc == AOC::AOC_ADDW) ? C1STM8_LIVE_H : 0));
+			break;
+		case AOC::AOC_AND:
+		case AOC::AOC_OR:
+		case AOC::AOC_XOR:
+			use = arg0 | arg1;
+			def = dst0 | C1STM8_LIVE_N | C1STM8_LIVE_Z;
+			break;
+		case AOC::AOC_CP:
+		case AOC::AOC_CPW:
+			use = arg0 | arg1;
+			def = C1STM8_LIVE_V | C1STM8_LIVE_N | C1STM8_LIVE_Z | C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_BCP:
+			use = arg0 | arg1;
+			def = C1STM8_LIVE_N | C1STM8_LIVE_Z;
+			break;
+		case AOC::AOC_LD:
+		case AOC::AOC_LDW:
+		case AOC::AOC_LDF:
+		case AOC::AOC_MOV:
+			// register to register transfers do not change flags
+			use = (reg0 ? 0 : arg0) | arg1;
+			def = dst0 | ((ao._opc == AOC::AOC_MOV || (reg0 && reg1)) ? 0 : (C1STM8_LIVE_N | C1STM8_LIVE_Z));
+			break;
+		case AOC::AOC_CLR:
+		case AOC::AOC_CLRW:
+			use = reg0 ? 0 : arg0;
+			def = dst0 | C1STM8_LIVE_N | C1STM8_LIVE_Z;
+			break;
+		case AOC::AOC_INC:
+		case AOC::AOC_INCW:
+		case AOC::AOC_DEC:
+		case AOC::AOC_DECW:
+			use = arg0;
+			def = dst0 | C1STM8_LIVE_V | C1STM8_LIVE_N | C1STM8_LIVE_Z;
+			break;
+		case AOC::AOC_NEG:
+		case AOC::AOC_NEGW:
+			use = arg0;
+			def = dst0 | C1STM8_LIVE_V | C1STM8_LIVE_N | C1STM8_LIVE_Z | C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_CPL:
+		case AOC::AOC_CPLW:
+		case AOC::AOC_SLA:
+		case AOC::AOC_SLAW:
+		case AOC::AOC_SLL:
+		case AOC::AOC_SLLW:
+		case AOC::AOC_SRA:
+		case AOC::AOC_SRAW:
+		case AOC::AOC_SRL:
+		case AOC::AOC_SRLW:
+			use = arg0;
+			def = dst0 | C1STM8_LIVE_N | C1STM8_LIVE_Z | C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_RLC:
+		case AOC::AOC_RLCW:
+		case AOC::AOC_RRC:
+		case AOC::AOC_RRCW:
+			use = arg0 | C1STM8_LIVE_C;
+			def = dst0 | C1STM8_LIVE_N | C1STM8_LIVE_Z | C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_SWAP:
+		case AOC::AOC_SWAPW:
+			use = arg0;
+			def = dst0 | C1STM8_LIVE_N | C1STM8_LIVE_Z;
+			break;
+		case AOC::AOC_TNZ:
+		case AOC::AOC_TNZW:
+			use = arg0;
+			def = C1STM8_LIVE_N | C1STM8_LIVE_Z;
+			break;
+		case AOC::AOC_RLWA:
+		case AOC::AOC_RRWA:
+			use = C1STM8_LIVE_A | arg0;
+			def = C1STM8_LIVE_A | arg0 | C1STM8_LIVE_N | C1STM8_LIVE_Z;
+			break;
+		case AOC::AOC_MUL:
+			use = arg0 | arg1;
+			def = arg0 | C1STM8_LIVE_H | C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_DIV:
+		case AOC::AOC_DIVW:
+			use = arg0 | arg1;
+			def = arg0 | arg1 | C1STM8_LIVE_FLAGS;
+			break;
+		case AOC::AOC_EXG:
+		case AOC::AOC_EXGW:
+			use = arg0 | arg1;
+			def = dst0 | (reg1 ? arg1 : 0);
+			break;
+		case AOC::AOC_PUSH:
+		case AOC::AOC_PUSHW:
+			use = arg0;
+			break;
+		case AOC::AOC_POP:
+		case AOC::AOC_POPW:
+			use = reg0 ? 0 : arg0;
+			def = dst0;
+			break;
+		case AOC::AOC_IRET:
+			// all registers are restored from stack
+			use = 0;
+			break;
+		case AOC::AOC_JP:
+		case AOC::AOC_JPF:
+			use = arg0;
+			break;
+		case AOC::AOC_JRA:
+		case AOC::AOC_JRF:
+		case AOC::AOC_JRT:
+		case AOC::AOC_JRIH:
+		case AOC::AOC_JRIL:
+		case AOC::AOC_JRM:
+		case AOC::AOC_JRNM:
+			use = 0;
+			break;
+		case AOC::AOC_JRC:
+		case AOC::AOC_JRNC:
+		case AOC::AOC_JRUGE:
+		case AOC::AOC_JRULT:
+			use = C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_JREQ:
+		case AOC::AOC_JRNE:
+			use = C1STM8_LIVE_Z;
+			break;
+		case AOC::AOC_JRMI:
+		case AOC::AOC_JRPL:
+			use = C1STM8_LIVE_N;
+			break;
+		case AOC::AOC_JRV:
+		case AOC::AOC_JRNV:
+			use = C1STM8_LIVE_V;
+			break;
+		case AOC::AOC_JRH:
+		case AOC::AOC_JRNH:
+			use = C1STM8_LIVE_H;
+			break;
+		case AOC::AOC_JRUGT:
+		case AOC::AOC_JRULE:
+			use = C1STM8_LIVE_C | C1STM8_LIVE_Z;
+			break;
+		case AOC::AOC_JRSGE:
+		case AOC::AOC_JRSLT:
+			use = C1STM8_LIVE_N | C1STM8_LIVE_V;
+			break;
+		case AOC::AOC_JRSGT:
+		case AOC::AOC_JRSLE:
+			use = C1STM8_LIVE_Z | C1STM8_LIVE_N | C1STM8_LIVE_V;
+			break;
+		case AOC::AOC_BTJF:
+		case AOC::AOC_BTJT:
+			use = arg0;
+			def = C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_BCPL:
+		case AOC::AOC_BRES:
+		case AOC::AOC_BSET:
+			use = arg0;
+			break;
+		case AOC::AOC_BCCM:
+			use = arg0 | C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_CCF:
+			use = C1STM8_LIVE_C;
+			def = C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_RCF:
+		case AOC::AOC_SCF:
+			use = 0;
+			def = C1STM8_LIVE_C;
+			break;
+		case AOC::AOC_RVF:
+			use = 0;
+			def = C1STM8_LIVE_V;
+			break;
+		case AOC::AOC_BREAK:
+		case AOC::AOC_HALT:
+		case AOC::AOC_NOP:
+		case AOC::AOC_RIM:
+		case AOC::AOC_SIM:
+		case AOC::AOC_WFE:
+		case AOC::AOC_WFI:
+			use = 0;
+			break;
+		default:
+			// calls, returns (registers can hold function arguments and return values), etc.
+			break;
+	}
+
+	ao._live_use = use;
+	ao._live_def = def;
+}
+
+// registers and flags live after an instruction: next_live is the set of the next instruction, jumps to
+// unknown labels or by address in register make everything live
+static int32_t get_live_out(const B1_ASM_OP_STM8 &ao, int32_t next_live, const std::map<std::wstring, const B1_ASM_OP_STM8 *> &labels)
+{
+	if(ao._type == AOT::AOT_LABEL)
+	{
+		return next_live;
+	}
+
+	if(!ao.Parse())
+	{
+		return C1STM8_LIVE_ALL;
+	}
+
+	auto target_live = [&ao, &labels](size_t arg_num) -> int32_t
+	{
+		if(arg_num >= ao._opnds.size() || ao._opnds[arg_num]._mode != AOM::AOM_IMM)
 		{
-			continue;
+			return C1STM8_LIVE_ALL;
 		}
 
-		if(!ao.Parse())
+		auto label = labels.find(ao._args[arg_num]);
+		return (label == labels.cend()) ? C1STM8_LIVE_ALL : label->second->_live_in;
+	};
+
+	switch(ao._opc)
+	{
+		case AOC::AOC_IRET:
+			return 0;
+		case AOC::AOC_RET:
+		case AOC::AOC_RETF:
+			return C1STM8_LIVE_ALL;
+		case AOC::AOC_JP:
+		case AOC::AOC_JPF:
+		case AOC::AOC_JRA:
+		case AOC::AOC_JRT:
+			return target_live(0);
+		case AOC::AOC_JRF:
+			return next_live;
+		case AOC::AOC_BTJF:
+		case AOC::AOC_BTJT:
+			return next_live | target_live(2);
+		default:
+			// conditional relative jumps and the other instructions
+			break;
+	}
+
+	return ao.IsRelJump() ? (next_live | target_live(0)) : next_live;
+}
+
+// checks if the instruction ends a block of straight-line code: the registers live after it are not just
+// the registers live before the next instruction
+static bool is_live_block_end(const B1_ASM_OP_STM8 &ao)
+{
+	if(ao._type == AOT::AOT_LABEL)
+	{
+		return false;
+	}
+
+	if(!ao.Parse())
+	{
+		return true;
+	}
+
+	return	ao._opc == AOC::AOC_IRET || ao._opc == AOC::AOC_RET || ao._opc == AOC::AOC_RETF || ao._opc == AOC::AOC_JP || ao._opc == AOC::AOC_JPF ||
+			ao._opc == AOC::AOC_BTJF || ao._opc == AOC::AOC_BTJT || ao.IsRelJump();
+}
+
+// backward liveness analysis of the code: the code is split into blocks starting with labels and ending with
+// jumps and branches, every block is summarized with the sets of registers read before written (gen) and written
+// (kill) so only the blocks are processed until the results become stable (because of backward jumps), then the
+// sets of every instruction are calculated with a single pass
+void C1STM8Compiler::update_liveness()
+{
+	struct LIVE_BLOCK
+	{
+		size_t first;
+		size_t last;
+		int32_t gen;
+		int32_t kill;
+	};
+
+	auto &cs = *_code_secs.begin();
+
+	std::vector<const B1_ASM_OP_STM8 *> ops;
+	std::vector<LIVE_BLOCK> blocks;
+
+	ops.reserve(cs.size());
+	_live_labels.clear();
+
+	for(auto &op: cs)
+	{
+		auto ao = static_cast<const B1_ASM_OP_STM8 *>(op.get());
+		ao->_live_in = 0;
+		ao->_live_out = 0;
+
+		if(ao->_type == AOT::AOT_LABEL)
 		{
-			return true;
+			_live_labels[ao->_data] = ao;
 		}
 
-		bool write_op = false;
-		bool reg_used = is_reg_used(ao, reg_name, write_op);
+		if(blocks.empty() || ao->_type == AOT::AOT_LABEL || is_live_block_end(*ops.back()))
+		{
+			blocks.push_back({ ops.size(), ops.size(), 0, 0 });
+		}
+
+		blocks.back().last = ops.size();
+		ops.push_back(ao);
+	}
 
-		if(ao._op == L"JRA" || ao._op == L"JP" || ao._op == L"JPF" || ao._op == L"JRT")
+	for(auto &b: blocks)
+	{
+		for(size_t i = b.last + 1; i-- > b.first;)
 		{
-			if(branch)
-			{
-				return true;
-			}
+			int32_t use = 0, def = 0;
+			get_live_use_def(*ops[i], use, def);
 
-			auto label = _opt_labels.find(ao._args[0]);
-			return (label == _opt_labels.cend()) ? true : is_reg_used_after(label->second, end, reg_name, true);
+			b.gen = use | (b.gen & ~def);
+			b.kill |= def;
 		}
-		else
-		if((ao._op.size() > 2 && ao._op[0] == L'J' && ao._op[1] == L'R') || ao._op == L"BTJF" || ao._op == L"BTJT")
+	}
+
+	// the first instruction of a block holds its live-in set (jump targets are looked up by labels)
+	bool changed = true;
+
+	while(changed)
+	{
+		changed = false;
+
+		int32_t live = C1STM8_LIVE_ALL;
+
+		for(auto b = blocks.crbegin(); b != blocks.crend(); b++)
 		{
-			if(branch)
-			{
-				return true;
-			}
+			auto &last = *ops[b->last];
+			last._live_out = get_live_out(last, live, _live_labels);
+			live = b->gen | (last._live_out & ~b->kill);
 
-			auto label = _opt_labels.find(ao._args[(ao._op[0] == L'J') ? 0 : 2]);
-			if(label == _opt_labels.cend())
+			auto &first = *ops[b->first];
+			if(live != first._live_in)
 			{
-				return true;
+				first._live_in = live;
+				changed = true;
 			}
+		}
+	}
 
-			if(is_reg_used_after(label->second, end, reg_name, true))
-			{
-				return true;
-			}
+	for(const auto &b: blocks)
+	{
+		int32_t live = ops[b.last]->_live_out;
 
-			continue;
+		for(size_t i = b.last + 1; i-- > b.first;)
+		{
+			auto &ao = *ops[i];
+
+			int32_t use = 0, def = 0;
+			get_live_use_def(ao, use, def);
+
+			ao._live_out = live;
+			live = use | (live & ~def);
+			ao._live_in = live;
 		}
+	}
+
+	_live_valid = true;
+}
+
+// checks if any of the registers or flags (C1STM8_LIVE_* bits) can be read after the instruction. the following
+// instructions are checked until the first jump or branch, the liveness analysis results are used only if the
+// registers are neither read nor written before it (so the analysis is not repeated after every code change)
+bool C1STM8Compiler::is_reg_live_after(B1_ASM_OPS::const_iterator it, int32_t regs)
+{
+	const auto &cs = *_code_secs.begin();
 
-		if(reg_used || write_op)
+	for(it++; it != cs.cend(); it++)
+	{
+		auto &ao = *static_cast<const B1_ASM_OP_STM8 *>(it->get());
+
+		int32_t use = 0, def = 0;
+		get_live_use_def(ao, use, def);
+
+		if(use & regs)
 		{
-			return reg_used;
+			return true;
+		}
+
+		if(ao._type == AOT::AOT_OP && (ao.IsRelJump() || ao._opc == AOC::AOC_JP || ao._opc == AOC::AOC_JPF || ao._opc == AOC::AOC_BTJF || ao._opc == AOC::AOC_BTJT ||
+			ao._opc == AOC::AOC_RET || ao._opc == AOC::AOC_RETF || ao._opc == AOC::AOC_IRET))
+		{
+			break;
+		}
+
+		regs &= ~def;
+		if(regs == 0)
+		{
+			return false;
 		}
 	}
 
-	return (start != end);
+	if(it == cs.cend())
+	{
+		return true;
+	}
+
+	if(!_live_valid)
+	{
+		update_liveness();
+	}
+
+	return (static_cast<const B1_ASM_OP_STM8 *>(it->get())->_live_in & regs) != 0;
+}
+
+// removes loads of registers that are not read later. the code is walked backwards so the liveness analysis
+// results stay valid: removing an instruction writing unused registers can only make fewer registers live
+void C1STM8Compiler::RemoveDeadLoads(bool &changed)
+{
+	TRepStage trep_stage("RemoveDeadLoads");
+
+	if(!_live_valid)
+	{
+		update_liveness();
+	}
+
+	auto &cs = *_code_secs.begin();
+
+	int32_t live = C1STM8_LIVE_ALL;
+
+	for(auto i = cs.end(); i != cs.begin();)
+	{
+		i--;
+
+		auto &ao = *static_cast<B1_ASM_OP_STM8 *>(i->get());
+
+		int32_t use = 0, def = 0;
+		get_live_use_def(ao, use, def);
+
+		ao._live_out = get_live_out(ao, live, _live_labels);
+
+		if(	(ao._opc == AOC::AOC_LD || ao._opc == AOC::AOC_LDW || ao._opc == AOC::AOC_CLR || ao._opc == AOC::AOC_CLRW) &&
+			!ao._volatile && !ao._is_inline && ao._opnds[0]._mode == AOM::AOM_REG && !ao.IsReg(0, AOR::AOR_SP) &&
+			// memory reads through pointers are left as is
+			(ao._opnds.size() < 2 || ao._opnds[1]._mode == AOM::AOM_REG || ao._opnds[1]._mode == AOM::AOM_IMM || ao._opnds[1]._mode == AOM::AOM_MEM || (ao._opnds[1]._mode == AOM::AOM_IDX && ao._opnds[1]._reg == AOR::AOR_SP)) &&
+			// the instruction changes N and Z flags (except for register to register transfers)
+			((def | C1STM8_LIVE_N | C1STM8_LIVE_Z) & ao._live_out) == 0
+			)
+		{
+			// the live set stays the same as the removed instruction did not read anything the others need
+			i = del_op(cs, i);
+			queue_opt_window(cs, i);
+			changed = true;
+			continue;
+		}
+
+		live = use | (ao._live_out & ~def);
+		ao._live_in = live;
+	}
 }
 
 C1STM8Compiler::C1STM8Compiler(bool out_src_lines, bool opt_nocheck)
@@ -6998,6 +8196,10 @@ C1STM8Compiler::C1STM8Compiler(bool out_src_lines, bool opt_nocheck)
 , _cmp_type(B1Types::B1T_UNKNOWN)
 , _retval_active(false)
 , _retval_type(B1Types::B1T_UNKNOWN)
+, _opt_rules1(0x1, true)
+, _opt_rules2(0x2, false)
+, _opt_rules3(0x4, true)
+, _live_valid(false)
 {
 	if(_global_settings.GetRetAddressSize() == 2)
 	{
@@ -7009,6 +8211,10 @@ C1STM8Compiler::C1STM8Compiler(bool out_src_lines, bool opt_nocheck)
 		_call_stmt = L"CALLF";
 		_ret_stmt = L"RETF";
 	}
+
+	init_opt_rules1();
+	init_opt_rules2();
+	init_opt_rules3();
 }
 
 C1STM8Compiler::~C1STM8Compiler()
@@ -7080,15 +8286,144 @@ C1_T_ERROR C1STM8Compiler::WriteCodeInitEnd()
 	return C1_T_ERROR::C1_RES_OK;
 }
 
-C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
+bool C1STM8_OPT_WND::Extend(int32_t wnd_size)
+{
+	while(_size <= wnd_size)
+	{
+		auto next = std::next(_its[_size - 1]);
+		if(next == _cs.end())
+		{
+			return false;
+		}
+
+		auto op = static_cast<B1_ASM_OP_STM8 *>(next->get());
+		if(op->_is_inline || !op->Parse())
+		{
+			return false;
+		}
+
+		_its[_size] = next;
+		_ops[_size] = op;
+		_size++;
+	}
+
+	return true;
+}
+
+void C1STM8_OPT_RULES::Add(int32_t id, int32_t wnd_size, const std::vector<AOC> &first_ops, const std::vector<AOC> &second_ops, const std::function<bool(C1STM8_OPT_WND &wnd, bool &changed)> &apply)
+{
+	_rules.emplace_back();
+	auto &rule = _rules.back();
+
+	rule._id = id;
+	rule._wnd_size = wnd_size;
+	rule._ops[0] = first_ops;
+	rule._ops[1] = second_ops;
+	rule._apply = apply;
+	rule._stat = nullptr;
+}
+
+void C1STM8_OPT_RULES::Compile()
+{
+	_index.clear();
+	_index.resize((int)AOC::AOC_COUNT);
+
+	for(auto &rule: _rules)
+	{
+		for(int opc = 0; opc < (int)AOC::AOC_COUNT; opc++)
+		{
+			if(rule._ops[0].empty() || std::find(rule._ops[0].cbegin(), rule._ops[0].cend(), (AOC)opc) != rule._ops[0].cend())
+			{
+				_index[opc].push_back(&rule);
+			}
+		}
+
+		rule._second_ops.assign((int)AOC::AOC_COUNT, rule._ops[1].empty());
+		for(auto opc: rule._ops[1])
+		{
+			rule._second_ops[(int)opc] = true;
+		}
+	}
+}
+
+// std::map elements are not moved on insertion so the rules can point to their records directly
+void C1STM8_OPT_RULES::InitStat(std::map<int32_t, C1_OPT_RULE_STAT> &stat)
+{
+	for(auto &rule: _rules)
+	{
+		rule._stat = &stat[rule._id];
+	}
+}
+
+void C1STM8Compiler::init_opt_rules_stat()
+{
+	_opt_rules1.InitStat(_opt_rules_stat);
+	_opt_rules2.InitStat(_opt_rules_stat);
+	_opt_rules3.InitStat(_opt_rules_stat);
+}
+
+// checks the rule collecting its statistics (the rules are called directly if the statistics are not collected)
+static bool c1stm8_apply_opt_rule_stat(const C1STM8_OPT_RULE &rule, C1STM8_OPT_WND &wnd, bool &changed)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	const bool applied = rule._apply(wnd, changed);
+
+	rule._stat->_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	rule._stat->_attempts++;
+	if(applied)
+	{
+		rule._stat->_hits++;
+	}
+
+	return applied;
+}
+
+// queues the instructions a change at the specified position can affect (the windows including the position) and
+// returns the first queued instruction
+B1_ASM_OPS::iterator C1STM8Compiler::queue_opt_window(B1_ASM_OPS &cs, B1_ASM_OPS::iterator where)
+{
+	auto first = where;
+	for(int32_t n = 1; n < C1STM8_OPT_WND::MAX_SIZE && first != cs.begin(); n++)
+	{
+		first--;
+	}
+
+	auto last = where;
+	for(int32_t n = 1; n < C1STM8_OPT_WND::MAX_SIZE && last != cs.end(); n++)
+	{
+		last++;
+	}
+
+	for(auto i = first; i != last; i++)
+	{
+		static_cast<B1_ASM_OP_STM8 *>(i->get())->_opt_queue = -1;
+	}
+
+	return first;
+}
+
+void C1STM8Compiler::QueueOptAll()
+{
+	for(auto &op: *_code_secs.begin())
+	{
+		static_cast<B1_ASM_OP_STM8 *>(op.get())->_opt_queue = -1;
+	}
+}
+
+// the function checks the instructions queued for the pass only: a change queues the instructions around the changed
+// position for all passes and the check continues from the first of them
+C1_T_ERROR C1STM8Compiler::apply_opt_rules(const C1STM8_OPT_RULES &rules, bool &changed)
 {
 	auto &cs = *_code_secs.begin();
-	auto i = cs.begin();
+
+	C1STM8_OPT_WND wnd(cs);
+	auto &i = wnd._its[0];
+
+	i = cs.begin();
 
 	while(i != cs.end())
 	{
-		int32_t rule_id = 0x10000;
-
 		auto &ao = *static_cast<B1_ASM_OP_STM8 *>(i->get());
 
 		if(ao._type == AOT::AOT_LABEL)
@@ -7098,49 +8433,96 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			continue;
 		}
 
-		if(ao._is_inline || !ao.Parse())
+		if(!(ao._opt_queue & rules.GetQueueBit()))
+		{
+			i++;
+			continue;
+		}
+
+		ao._opt_queue &= ~rules.GetQueueBit();
+
+		if((rules.GetSkipInline() && ao._is_inline) || !ao.Parse())
 		{
 			i++;
 			continue;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	((ao._op == L"LDW" || ao._op == L"LD") && (ao._args[0] == L"X" || ao._args[0] == L"Y" || ao._args[0] == L"A") && ao._args[1] == L"0x0") ||
-			(ao._op == L"MOV" && ao._args[1] == L"0x0")
+		wnd._ops[0] = &ao;
+		wnd._size = 1;
+
+		bool applied = false;
+
+		for(const auto *rule: rules.GetRules(ao._opc))
+		{
+			if(!wnd.Extend(rule->_wnd_size))
+			{
+				break;
+			}
+
+			if(rule->_wnd_size > 0 && !rule->_second_ops[(int)wnd._ops[1]->_opc])
+			{
+				continue;
+			}
+
+			if(_opt_rules_stat_on ? c1stm8_apply_opt_rule_stat(*rule, wnd, changed) : rule->_apply(wnd, changed))
+			{
+				applied = true;
+				break;
+			}
+		}
+
+		if(applied)
+		{
+			_live_valid = false;
+			i = queue_opt_window(cs, i);
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	return C1_T_ERROR::C1_RES_OK;
+}
+
+void C1STM8Compiler::init_opt_rules1()
+{
+	auto &rules = _opt_rules1;
+
+	rules.Add(0x10001, 0, { AOC::AOC_LD, AOC::AOC_LDW, AOC::AOC_MOV }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &ao = *wnd._ops[0];
+
+		if(	((ao._opc == AOC::AOC_LDW || ao._opc == AOC::AOC_LD) && (ao.IsReg(0, AOR::AOR_X) || ao.IsReg(0, AOR::AOR_Y) || ao.IsReg(0, AOR::AOR_A)) && ao.IsImm(1, 0x0)) ||
+			(ao._opc == AOC::AOC_MOV && ao.IsImm(1, 0x0))
 			)
 		{
 			// LDW X, 0 -> CLRW X
 			// LD A, 0 -> CLR A
 			// MOV (addr), 0 -> CLR (addr)
-			ao._data = (ao._op == L"LDW" ? L"CLRW " : L"CLR ") + ao._args[0];
+			ao._data = (ao._opc == AOC::AOC_LDW ? L"CLRW " : L"CLR ") + ao._args[0];
 			ao._parsed = false;
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		auto next1 = std::next(i);
-		if(next1 == cs.end())
-		{
-			i++;
-			continue;
-		}
+		return false;
+	});
 
-		auto &aon1 = *static_cast<B1_ASM_OP_STM8 *>(next1->get());
-		if(aon1._is_inline || !aon1.Parse())
-		{
-			i++;
-			continue;
-		}
+	rules.Add(0x10002, 1, { AOC::AOC_ADD, AOC::AOC_ADDW, AOC::AOC_AND, AOC::AOC_OR, AOC::AOC_SUB, AOC::AOC_SUBW, AOC::AOC_XOR }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
 		if(
-			(ao._op == L"ADDW" || ao._op == L"SUBW" || ao._op == L"ADD" || ao._op == L"SUB" || ao._op == L"OR" || ao._op == L"AND" || ao._op == L"XOR") &&
-			(ao._args[0] == L"A" || ao._args[0] == L"X" || ao._args[0] == L"Y" || ao._args[0] == L"SP") &&
-			(ao._args[1] == L"0x1" || ao._args[1] == L"0x0" || (ao._args[1] == L"-0x1" || Utils::str_toupper(ao._args[1]) == L"0XFFFF" || Utils::str_toupper(ao._args[1]) == L"0XFFFFFFFF" || (Utils::str_toupper(ao._args[1]) == L"0XFF" && ao._args[0] == L"A")))
+			(ao._opc == AOC::AOC_ADDW || ao._opc == AOC::AOC_SUBW || ao._opc == AOC::AOC_ADD || ao._opc == AOC::AOC_SUB || ao._opc == AOC::AOC_OR || ao._opc == AOC::AOC_AND || ao._opc == AOC::AOC_XOR) &&
+			(ao.IsReg(0, AOR::AOR_A) || ao.IsReg(0, AOR::AOR_X) || ao.IsReg(0, AOR::AOR_Y) || ao.IsReg(0, AOR::AOR_SP)) &&
+			(ao.IsImm(1, 0x1) || ao.IsImm(1, 0x0) || (ao.IsImm(1, -1) || ao.IsImm(1, 0xFFFF) || (ao.IsImm(1, 0xFF) && ao.IsReg(0, AOR::AOR_A))))
 			)
 		{
 			// -ADD/ADDW/SUB/SUBW/OR A/X/Y/SP, 0
@@ -7148,15 +8530,15 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			// -AND A, 0xFF
 			// ADD/ADDW A/X/Y, 1 -> INC/INCW A/X/Y
 			// SUB/SUBW A/X/Y, 1 -> INC/DECW A/X/Y
-			if(ao._args[1] == L"0x0" || ao._op == L"AND")
+			if(ao.IsImm(1, 0x0) || ao._opc == AOC::AOC_AND)
 			{
-				if(!(ao._op == L"AND" && (ao._args[1] == L"0x0" || ao._args[1] == L"0x1")))
+				if(!(ao._opc == AOC::AOC_AND && (ao.IsImm(1, 0x0) || ao.IsImm(1, 0x1))))
 				{
 					// AND A, -1
 					// OR A, 0
 					// XOR A, 0
 					// ADD/SUB/ADDW/SUBW <reg>, 0
-					if((ao._op == L"ADDW" || ao._op == L"SUBW") && ao._args[0] == L"X")
+					if((ao._opc == AOC::AOC_ADDW || ao._opc == AOC::AOC_SUBW) && ao.IsReg(0, AOR::AOR_X))
 					{
 						ao._data = L"RCF";
 						ao._parsed = false;
@@ -7166,59 +8548,66 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 						i = del_op(cs, i);
 					}
 
-					update_opt_rule_usage_stat(rule_id);
 					changed = true;
-					continue;
+					return true;
 				}
 				else
-				if(ao._op == L"AND" && ao._args[1] == L"0x0")
+				if(ao._opc == AOC::AOC_AND && ao.IsImm(1, 0x0))
 				{
 					// AND A, 0
 					ao._data = L"CLR A";
 					ao._parsed = false;
 
-					update_opt_rule_usage_stat(rule_id);
 					changed = true;
-					continue;
+					return true;
 				}
 			}
 			else
-			if(ao._args[0] != L"SP" && ao._op != L"OR" && ao._op != L"XOR")
+			if(!ao.IsReg(0, AOR::AOR_SP) && ao._opc != AOC::AOC_OR && ao._opc != AOC::AOC_XOR)
 			{
 				// ADD/SUB/ADDW/SUBW <reg>, 1/-1
-				if(	!((ao._op == L"ADDW" || ao._op == L"SUBW") && ao._args[0] == L"X" && aon1._op == L"JRNC") // used with 32-bit integer addition and subtraction
+				if(	!((ao._opc == AOC::AOC_ADDW || ao._opc == AOC::AOC_SUBW) && ao.IsReg(0, AOR::AOR_X) && aon1._opc == AOC::AOC_JRNC) // used with 32-bit integer addition and subtraction
 					)
 				{
-					if(ao._args[1] == L"0x1")
+					if(ao.IsImm(1, 0x1))
 					{
 						ao._data = (
-							ao._op == L"ADDW" ? L"INCW " :
-							ao._op == L"SUBW" ? L"DECW " :
-							ao._op == L"ADD" ? L"INC " : L"DEC "
+							ao._opc == AOC::AOC_ADDW ? L"INCW " :
+							ao._opc == AOC::AOC_SUBW ? L"DECW " :
+							ao._opc == AOC::AOC_ADD ? L"INC " : L"DEC "
 							) + ao._args[0];
 					}
 					else
 					{
 						ao._data = (
-							ao._op == L"ADDW" ? L"DECW " :
-							ao._op == L"SUBW" ? L"INCW " :
-							ao._op == L"ADD" ? L"DEC " : L"INC "
+							ao._opc == AOC::AOC_ADDW ? L"DECW " :
+							ao._opc == AOC::AOC_SUBW ? L"INCW " :
+							ao._opc == AOC::AOC_ADD ? L"DEC " : L"INC "
 							) + ao._args[0];
 					}
 					ao._parsed = false;
 
-					update_opt_rule_usage_stat(rule_id);
 					changed = true;
-					continue;
+					return true;
 				}
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if((ao._op == L"PUSH" && aon1._op == L"POP" && ao._args[0] != L"CC") || (ao._op == L"PUSHW" && aon1._op == L"POPW"))
+		return false;
+	});
+
+	rules.Add(0x10003, 1, { AOC::AOC_PUSH, AOC::AOC_PUSHW }, { AOC::AOC_POP, AOC::AOC_POPW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+
+		if((ao._opc == AOC::AOC_PUSH && aon1._opc == AOC::AOC_POP && !ao.IsReg(0, AOR::AOR_CC)) || (ao._opc == AOC::AOC_PUSHW && aon1._opc == AOC::AOC_POPW))
 		{
-			if(ao._op == L"PUSH")
+			if(ao._opc == AOC::AOC_PUSH)
 			{
 				if(ao._args[0] == aon1._args[0])
 				{
@@ -7261,14 +8650,22 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 				}
 			}
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if((ao._op == L"ADD" || ao._op == L"ADDW") && ao._args[0] == L"SP" && ((aon1._op == L"PUSH" && aon1._args[0] == L"A" && ao._args[1] == L"0x1") || (aon1._op == L"PUSHW" && ao._args[1] == L"0x2")))
+		return false;
+	});
+
+	rules.Add(0x10004, 1, { AOC::AOC_ADD, AOC::AOC_ADDW }, { AOC::AOC_PUSH, AOC::AOC_PUSHW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+
+		if((ao._opc == AOC::AOC_ADD || ao._opc == AOC::AOC_ADDW) && ao.IsReg(0, AOR::AOR_SP) && ((aon1._opc == AOC::AOC_PUSH && aon1.IsReg(0, AOR::AOR_A) && ao.IsImm(1, 0x1)) || (aon1._opc == AOC::AOC_PUSHW && ao.IsImm(1, 0x2))))
 		{
 			// ADDW SP, 2
 			// PUSHW X/Y
@@ -7279,72 +8676,94 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			// PUSH A
 			// ->
 			// LD(1, SP), A
-			ao._data = std::wstring(aon1._op == L"PUSH" ? L"LD" : L"LDW") + L" (0x1, SP), " + aon1._args[0];
+			ao._data = std::wstring(aon1._opc == AOC::AOC_PUSH ? L"LD" : L"LDW") + L" (0x1, SP), " + aon1._args[0];
 			ao._parsed = false;
 			del_op(cs, next1);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
+		return false;
+	});
+
+	rules.Add(0x10005, 1, {}, { AOC::AOC_LD, AOC::AOC_MOV },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
 		int i_size = 0;
 		bool i_arithm_op = is_arithm_op(ao, i_size);
-		
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(!ao._volatile && i_arithm_op && i_size == 1 && ao._args[0].front() == L'(' && (aon1._op == L"LD" || aon1._op == L"MOV") && ao._args[0] == aon1._args[0])
+
+		if(!ao._volatile && i_arithm_op && i_size == 1 && ao._args[0].front() == L'(' && (aon1._opc == AOC::AOC_LD || aon1._opc == AOC::AOC_MOV) && ao._args[0] == aon1._args[0])
 		{
 			// -CLR/LD/... (<mem_addr>), <smth>
 			// LD/MOV (<mem_addr>), <smth1>
 			i = del_op(cs, i);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(!ao._volatile && i_arithm_op && (ao._args[0] == L"A" || ao._args[0] == L"X" || ao._args[0] == L"Y") && (aon1._op == L"LD" || aon1._op == L"LDW") && ao._args[0] == aon1._args[0] &&
-			aon1._args[1] != L"(X)" && aon1._args[1] != L"(Y)" && aon1._args[1].find(L", X)") == std::wstring::npos && aon1._args[1].find(L", Y)") == std::wstring::npos)
+		return false;
+	});
+
+	rules.Add(0x10006, 1, {}, { AOC::AOC_LD, AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		int i_size = 0;
+		bool i_arithm_op = is_arithm_op(ao, i_size);
+
+		if(!ao._volatile && i_arithm_op && (ao.IsReg(0, AOR::AOR_A) || ao.IsReg(0, AOR::AOR_X) || ao.IsReg(0, AOR::AOR_Y)) && (aon1._opc == AOC::AOC_LD || aon1._opc == AOC::AOC_LDW) && ao._args[0] == aon1._args[0] &&
+			!aon1.IsInd(1, AOR::AOR_X) && !aon1.IsInd(1, AOR::AOR_Y) && aon1._args[1].find(L", X)") == std::wstring::npos && aon1._args[1].find(L", Y)") == std::wstring::npos)
 		{
 			// -CLR/LD/... <reg>, <smth>
 			// LD <reg>, <smth1>
+			// the flags the instruction changes and the load does not (e.g. carry of ADC/SBC) must not be used later
+			int32_t use = 0, def = 0, use1 = 0, def1 = 0;
+			get_live_use_def(ao, use, def);
+			get_live_use_def(aon1, use1, def1);
+			def &= C1STM8_LIVE_FLAGS & ~def1;
+			if(def != 0 && is_reg_live_after(next1, def))
+			{
+				return false;
+			}
+
 			i = del_op(cs, i);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
-		}
-
-		auto next2 = std::next(next1);
-		if(next2 == cs.end())
-		{
-			i++;
-			continue;
+			return true;
 		}
 
-		auto &aon2 = *static_cast<B1_ASM_OP_STM8 *>(next2->get());
-		if(aon2._is_inline || !aon2.Parse())
-		{
-			i++;
-			continue;
-		}
+		return false;
+	});
 
+	rules.Add(0x10007, 2, { AOC::AOC_PUSH, AOC::AOC_PUSHW, AOC::AOC_SUB, AOC::AOC_SUBW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
 		int n1_size = 0;
 		bool n1_arithm_op = is_arithm_op(aon1, n1_size);
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
 		if (
-			(((ao._op == L"PUSHW" && ao._args[0] == L"X") || ((ao._op == L"SUBW" || ao._op == L"SUB") && ao._args[0] == L"SP" && ao._args[1] == L"0x2")) &&
-			(n1_arithm_op && n1_size == 2 && aon1._args[0] == L"X") &&
-			(aon2._op == L"LDW" && aon2._args[0] == L"(0x1, SP)" && aon2._args[1] == L"X")) ||
+			(((ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_X)) || ((ao._opc == AOC::AOC_SUBW || ao._opc == AOC::AOC_SUB) && ao.IsReg(0, AOR::AOR_SP) && ao.IsImm(1, 0x2))) &&
+			(n1_arithm_op && n1_size == 2 && aon1.IsReg(0, AOR::AOR_X)) &&
+			(aon2._opc == AOC::AOC_LDW && aon2.IsIdx(0, AOR::AOR_SP, 0x1) && aon2.IsReg(1, AOR::AOR_X))) ||
 
-			(((ao._op == L"PUSH" && ao._args[0] == L"A") || ((ao._op == L"SUBW" || ao._op == L"SUB") && ao._args[0] == L"SP" && ao._args[1] == L"0x1")) &&
-			(n1_arithm_op && n1_size == 1 && aon1._args[0] == L"A") &&
-			(aon2._op == L"LD" && aon2._args[0] == L"(0x1, SP)" && aon2._args[1] == L"A"))
+			(((ao._opc == AOC::AOC_PUSH && ao.IsReg(0, AOR::AOR_A)) || ((ao._opc == AOC::AOC_SUBW || ao._opc == AOC::AOC_SUB) && ao.IsReg(0, AOR::AOR_SP) && ao.IsImm(1, 0x1))) &&
+			(n1_arithm_op && n1_size == 1 && aon1.IsReg(0, AOR::AOR_A)) &&
+			(aon2._opc == AOC::AOC_LD && aon2.IsIdx(0, AOR::AOR_SP, 0x1) && aon2.IsReg(1, AOR::AOR_A)))
 			)
 		{
 			// PUSH/PUSHW A/X or SUBW SP, 1/2
@@ -7377,19 +8796,30 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 				aon2._parsed = false;
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x10008, 2, {}, { AOC::AOC_PUSH, AOC::AOC_PUSHW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		int i_size = 0;
+		bool i_arithm_op = is_arithm_op(ao, i_size);
+
 		if (
-			(i_arithm_op && (ao._args[0] == L"A" || ao._args[0] == L"X" || ao._args[0] == L"Y") && !(ao._args.size() == 2 && (ao._args[1] == L"X" || ao._args[1] == L"Y" || ao._args[1] == L"XL" || ao._args[1] == L"YL" || ao._args[1] == L"XH" || ao._args[1] == L"YH" || ao._args[1] == L"SP"))) &&
-			ao._op != L"MUL" && ao._op != L"DIV" && ao._op != L"DIVW" &&
-			((aon1._op == L"PUSH" || aon1._op == L"PUSHW") && aon1._args[0] == ao._args[0]) &&
-			((aon2._op == L"LD" || aon2._op == L"LDW") && aon2._args[0] == ao._args[0] && aon2._args[1] == L"(0x1, SP)")
+			(i_arithm_op && (ao.IsReg(0, AOR::AOR_A) || ao.IsReg(0, AOR::AOR_X) || ao.IsReg(0, AOR::AOR_Y)) && !(ao._args.size() == 2 && (ao.IsReg(1, AOR::AOR_X) || ao.IsReg(1, AOR::AOR_Y) || ao.IsReg(1, AOR::AOR_XL) || ao.IsReg(1, AOR::AOR_YL) || ao.IsReg(1, AOR::AOR_XH) || ao.IsReg(1, AOR::AOR_YH) || ao.IsReg(1, AOR::AOR_SP)))) &&
+			ao._opc != AOC::AOC_MUL && ao._opc != AOC::AOC_DIV && ao._opc != AOC::AOC_DIVW &&
+			((aon1._opc == AOC::AOC_PUSH || aon1._opc == AOC::AOC_PUSHW) && aon1._args[0] == ao._args[0]) &&
+			((aon2._opc == AOC::AOC_LD || aon2._opc == AOC::AOC_LDW) && aon2._args[0] == ao._args[0] && aon2.IsIdx(1, AOR::AOR_SP, 0x1))
 			)
 		{
 			// LD/LDW A/X, smth (not Y) or ADD/ADDW A/X, smth or SUB/SUBW A/X, smth
@@ -7397,14 +8827,26 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			// -LD/LDW A/X, (1, SP)
 			del_op(cs, next2);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if( ((ao._op == L"PUSHW" && aon2._op == L"POPW") || (ao._op == L"PUSH" && aon2._op == L"POP")) && (ao._args[0] == aon2._args[0] && ao._args[0] != L"CC") &&
+		return false;
+	});
+
+	rules.Add(0x10009, 2, { AOC::AOC_PUSH, AOC::AOC_PUSHW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		int n1_size = 0;
+		bool n1_arithm_op = is_arithm_op(aon1, n1_size);
+
+		if( ((ao._opc == AOC::AOC_PUSHW && aon2._opc == AOC::AOC_POPW) || (ao._opc == AOC::AOC_PUSH && aon2._opc == AOC::AOC_POP)) && (ao._args[0] == aon2._args[0] && !ao.IsReg(0, AOR::AOR_CC)) &&
 			(n1_arithm_op && ao._args[0] != aon1._args[0])
 			)
 		{
@@ -7412,7 +8854,7 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			// LD/LDW/ADD/ADDW not <reg> and not (1, SP) or (2, SP), smth
 			// -POP/POPW <reg>
 			bool err = false;
-			int32_t size = (ao._op == L"PUSH") ? 1 : 2;
+			int32_t size = (ao._opc == AOC::AOC_PUSH) ? 1 : 2;
 			int32_t off;
 			bool no_SP_off = true;
 			if(!correct_SP_offset(aon1._args[0], 0, no_SP_off, &off).empty())
@@ -7452,17 +8894,26 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 				i = del_op(cs, i);
 				del_op(cs, next2);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if ((ao._op == L"ADD" || ao._op == L"ADDW") && ao._args[0] == L"SP" && ao._args[1] == L"0x4" &&
-			(aon1._op == L"PUSHW" && aon1._args[0] == L"X") &&
-			(aon2._op == L"PUSHW" && aon2._args[0] == L"Y")
+		return false;
+	});
+
+	rules.Add(0x1000A, 2, { AOC::AOC_ADD, AOC::AOC_ADDW }, { AOC::AOC_PUSHW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+
+		if ((ao._opc == AOC::AOC_ADD || ao._opc == AOC::AOC_ADDW) && ao.IsReg(0, AOR::AOR_SP) && ao.IsImm(1, 0x4) &&
+			(aon1._opc == AOC::AOC_PUSHW && aon1.IsReg(0, AOR::AOR_X)) &&
+			(aon2._opc == AOC::AOC_PUSHW && aon2.IsReg(0, AOR::AOR_Y))
 			)
 		{
 			// ADDW SP, 4
@@ -7477,16 +8928,25 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			aon1._parsed = false;
 			del_op(cs, next2);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if ((ao._op == L"LDW" && ao._args[0] == L"X") &&
-			(aon1._op == L"SUBW" && aon1._args[0] == L"X") &&
-			(aon2._op == L"INCW" && aon2._args[0] == L"X")
+		return false;
+	});
+
+	rules.Add(0x1000B, 2, { AOC::AOC_LDW }, { AOC::AOC_SUBW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+
+		if ((ao._opc == AOC::AOC_LDW && ao.IsReg(0, AOR::AOR_X)) &&
+			(aon1._opc == AOC::AOC_SUBW && aon1.IsReg(0, AOR::AOR_X)) &&
+			(aon2._opc == AOC::AOC_INCW && aon2.IsReg(0, AOR::AOR_X))
 			)
 		{
 			// LDW X, <imm>
@@ -7502,18 +8962,27 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 				ao._parsed = false;
 				del_op(cs, next2);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x1000C, 2, { AOC::AOC_CLRW }, { AOC::AOC_LDW, AOC::AOC_PUSHW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+
 		if (
-			(ao._op == L"CLRW" && ao._args[0] == L"X") &&
-			((aon1._op == L"LDW" && aon1._args[1] == L"X") || (aon1._op == L"PUSHW" && aon1._args[0] == L"X")) &&
-			((aon2._op == L"LDW" && aon2._args[0] == L"X" && aon2._args[1] == L"0x1") || (aon2._op == L"CLRW" && aon2._args[0] == L"X"))
+			(ao._opc == AOC::AOC_CLRW && ao.IsReg(0, AOR::AOR_X)) &&
+			((aon1._opc == AOC::AOC_LDW && aon1.IsReg(1, AOR::AOR_X)) || (aon1._opc == AOC::AOC_PUSHW && aon1.IsReg(0, AOR::AOR_X))) &&
+			((aon2._opc == AOC::AOC_LDW && aon2.IsReg(0, AOR::AOR_X) && aon2.IsImm(1, 0x1)) || (aon2._opc == AOC::AOC_CLRW && aon2.IsReg(0, AOR::AOR_X)))
 			)
 		{
 			// CLRW X
@@ -7523,7 +8992,7 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			// CLRW X
 			// LDW (smth), X
 			// INCW X
-			if(aon2._op == L"LDW")
+			if(aon2._opc == AOC::AOC_LDW)
 			{
 				aon2._data = L"INCW X";
 				aon2._parsed = false;
@@ -7533,34 +9002,29 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 				del_op(cs, next2);
 			}
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
-		}
-
-
-		auto next3 = std::next(next2);
-		if(next3 == cs.end())
-		{
-			i++;
-			continue;
-		}
-
-		auto &aon3 = *static_cast<B1_ASM_OP_STM8 *>(next3->get());
-		if(aon3._is_inline || !aon3.Parse())
-		{
-			i++;
-			continue;
+			return true;
 		}
 
+		return false;
+	});
+
+	rules.Add(0x1000D, 3, { AOC::AOC_ADD, AOC::AOC_ADDW }, { AOC::AOC_PUSH, AOC::AOC_PUSHW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
 		int n3_size = 0;
 		bool n3_arithm_op = is_arithm_op(aon3, n3_size);
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if ((ao._op == L"ADDW" || ao._op == L"ADD") && ao._args[0] == L"SP" &&
-			(aon1._op == L"PUSHW" || (aon1._op == L"PUSH" && aon1._args[0] == L"A")) &&
-			(aon2._op == L"SUBW" || aon2._op == L"SUB") && aon2._args[0] == L"SP" &&
+		if ((ao._opc == AOC::AOC_ADDW || ao._opc == AOC::AOC_ADD) && ao.IsReg(0, AOR::AOR_SP) &&
+			(aon1._opc == AOC::AOC_PUSHW || (aon1._opc == AOC::AOC_PUSH && aon1.IsReg(0, AOR::AOR_A))) &&
+			(aon2._opc == AOC::AOC_SUBW || aon2._opc == AOC::AOC_SUB) && aon2.IsReg(0, AOR::AOR_SP) &&
 			n3_arithm_op
 			)
 		{
@@ -7579,7 +9043,7 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 				n2 = 0;
 			}
 
-			int32_t n = (aon1._op == L"PUSH") ? 1 : 2;
+			int32_t n = (aon1._opc == AOC::AOC_PUSH) ? 1 : 2;
 
 			if(n1 > 0 && n2 > 0 && n1 - n2 == n)
 			{
@@ -7588,27 +9052,36 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 				del_op(cs, next2);
 				del_op(cs, next1);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
+		return false;
+	});
+
+	rules.Add(0x1000E, 3, { AOC::AOC_PUSH, AOC::AOC_PUSHW, AOC::AOC_SUB, AOC::AOC_SUBW }, { AOC::AOC_LD, AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
 		int n2_size = 0;
 		bool n2_arithm_op = is_arithm_op(aon2, n2_size);
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
 		if (
-			(((ao._op == L"PUSHW" && ao._args[0] == L"X") || ((ao._op == L"SUBW" || ao._op == L"SUB") && ao._args[0] == L"SP" && ao._args[1] == L"0x2")) &&
-			(aon1._op == L"LDW" && aon1._args[0] == L"X") &&
-			(n2_arithm_op && n2_size == 2 && !(aon2._op == L"MUL" || aon2._op == L"DIV" || aon2._op == L"DIVW") && aon2._args[0] == L"X") &&
-			(aon3._op == L"LDW" && aon3._args[0] == L"(0x1, SP)" && aon3._args[1] == L"X")) ||
-
-			(((ao._op == L"PUSH" && ao._args[0] == L"A") || ((ao._op == L"SUBW" || ao._op == L"SUB") && ao._args[0] == L"SP" && ao._args[1] == L"0x1")) &&
-			(aon1._op == L"LD" && aon1._args[0] == L"A") &&
-			(n2_arithm_op && n2_size == 1 && aon2._args[0] == L"A") &&
-			(aon3._op == L"LD" && aon3._args[0] == L"(0x1, SP)" && aon3._args[1] == L"A"))
+			(((ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_X)) || ((ao._opc == AOC::AOC_SUBW || ao._opc == AOC::AOC_SUB) && ao.IsReg(0, AOR::AOR_SP) && ao.IsImm(1, 0x2))) &&
+			(aon1._opc == AOC::AOC_LDW && aon1.IsReg(0, AOR::AOR_X)) &&
+			(n2_arithm_op && n2_size == 2 && !(aon2._opc == AOC::AOC_MUL || aon2._opc == AOC::AOC_DIV || aon2._opc == AOC::AOC_DIVW) && aon2.IsReg(0, AOR::AOR_X)) &&
+			(aon3._opc == AOC::AOC_LDW && aon3.IsIdx(0, AOR::AOR_SP, 0x1) && aon3.IsReg(1, AOR::AOR_X))) ||
+
+			(((ao._opc == AOC::AOC_PUSH && ao.IsReg(0, AOR::AOR_A)) || ((ao._opc == AOC::AOC_SUBW || ao._opc == AOC::AOC_SUB) && ao.IsReg(0, AOR::AOR_SP) && ao.IsImm(1, 0x1))) &&
+			(aon1._opc == AOC::AOC_LD && aon1.IsReg(0, AOR::AOR_A)) &&
+			(n2_arithm_op && n2_size == 1 && aon2.IsReg(0, AOR::AOR_A)) &&
+			(aon3._opc == AOC::AOC_LD && aon3.IsIdx(0, AOR::AOR_SP, 0x1) && aon3.IsReg(1, AOR::AOR_A)))
 			)
 		{
 			// PUSHW X or SUBW SP, 2
@@ -7620,7 +9093,7 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			// ADDW X, 10
 			// PUSHW X
 			bool err = false;
-			int32_t size = (aon3._op == L"LD") ? 1 : 2;
+			int32_t size = (aon3._opc == AOC::AOC_LD) ? 1 : 2;
 			std::wstring n1data;
 			bool no_SP_off = true;
 			n1data = correct_SP_offset(aon1._args[1], size, no_SP_off);
@@ -7664,18 +9137,26 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 				aon3._parsed = false;
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if (ao._op == L"CLRW" && ao._args[0] == L"Y" &&
-			!aon1._volatile && aon1._op == L"LDW" && aon1._args[0] == L"X" &&
-			!aon2._volatile && aon2._op == L"LDW" && aon2._args[1] == L"Y" &&
-			!aon3._volatile && aon3._op == L"LDW" && aon3._args[1] == L"X"
+		return false;
+	});
+
+	rules.Add(0x1000F, 3, { AOC::AOC_CLRW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+
+		if (ao._opc == AOC::AOC_CLRW && ao.IsReg(0, AOR::AOR_Y) &&
+			!aon1._volatile && aon1._opc == AOC::AOC_LDW && aon1.IsReg(0, AOR::AOR_X) &&
+			!aon2._volatile && aon2._opc == AOC::AOC_LDW && aon2.IsReg(1, AOR::AOR_Y) &&
+			!aon3._volatile && aon3._opc == AOC::AOC_LDW && aon3.IsReg(1, AOR::AOR_X)
 			)
 		{
 			// CLRW Y
@@ -7695,14 +9176,28 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			aon1._data = L"LDW " + aon2._args[0] + L", X";
 			aon1._parsed = false;
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if ((ao._op == L"RLWA" || ao._op == L"RRWA") && ao._op == aon1._op && ao._op == aon2._op &&
+		return false;
+	});
+
+	rules.Add(0x10010, 3, { AOC::AOC_RLWA, AOC::AOC_RRWA }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		int n3_size = 0;
+		bool n3_arithm_op = is_arithm_op(aon3, n3_size);
+
+		if ((ao._opc == AOC::AOC_RLWA || ao._opc == AOC::AOC_RRWA) && ao._op == aon1._op && ao._op == aon2._op &&
 			ao._args[0] == aon1._args[0] && ao._args[0] == aon2._args[0] &&
 			n3_arithm_op
 			)
@@ -7715,36 +9210,32 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			del_op(cs, next1);
 			i = del_op(cs, i);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
-		}
-
-
-		auto next4 = std::next(next3);
-		if(next4 == cs.end())
-		{
-			i++;
-			continue;
-		}
-
-		auto &aon4 = *static_cast<B1_ASM_OP_STM8 *>(next4->get());
-		if(aon4._is_inline || !aon4.Parse())
-		{
-			i++;
-			continue;
+			return true;
 		}
 
-		int n4_size = 0;
-		bool n4_arithm_op = is_arithm_op(aon4, n4_size);
-
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if (ao._op == L"PUSHW" && ao._args[0] == L"X" &&
-			aon1._op == L"LDW" && aon1._args[0] == L"X" && aon1._args[1] == L"Y" &&
-			aon2._op == L"LDW" && aon2._args[0].front() == L'(' && aon2._args[0].find(L", SP)") == std::wstring::npos && aon2._args[1] == L"X" &&
-			aon3._op == L"POPW" && aon3._args[0] == L"X" &&
-			aon4._op == L"LDW" && aon4._args[0].front() == L'(' && aon4._args[0].find(L", SP)") == std::wstring::npos && aon4._args[1] == L"X"
+		return false;
+	});
+
+	rules.Add(0x10011, 4, { AOC::AOC_PUSHW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+
+		if (ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_X) &&
+			aon1._opc == AOC::AOC_LDW && aon1.IsReg(0, AOR::AOR_X) && aon1.IsReg(1, AOR::AOR_Y) &&
+			aon2._opc == AOC::AOC_LDW && aon2._args[0].front() == L'(' && aon2._args[0].find(L", SP)") == std::wstring::npos && aon2.IsReg(1, AOR::AOR_X) &&
+			aon3._opc == AOC::AOC_POPW && aon3.IsReg(0, AOR::AOR_X) &&
+			aon4._opc == AOC::AOC_LDW && aon4._args[0].front() == L'(' && aon4._args[0].find(L", SP)") == std::wstring::npos && aon4.IsReg(1, AOR::AOR_X)
 			)
 		{
 			// PUSHW X
@@ -7762,15 +9253,27 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			aon2._parsed = false;
 			i = next2;
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if (ao._op == L"PUSHW" && aon1._op == L"PUSHW" && ao._args[0] != aon1._args[0] && (aon2._op == L"SUB" || aon2._op == L"SUBW") && aon2._args[0] == L"SP" &&
-			aon3._op == L"LDW" && aon4._op == L"LDW" && (aon3._args[0] == L"X" || aon3._args[0] == L"Y") && (aon4._args[0] == L"X" || aon4._args[0] == L"Y") &&
+		return false;
+	});
+
+	rules.Add(0x10012, 4, { AOC::AOC_PUSHW }, { AOC::AOC_PUSHW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto next4 = wnd._its[4];
+		auto &aon4 = *wnd._ops[4];
+
+		if (ao._opc == AOC::AOC_PUSHW && aon1._opc == AOC::AOC_PUSHW && ao._args[0] != aon1._args[0] && (aon2._opc == AOC::AOC_SUB || aon2._opc == AOC::AOC_SUBW) && aon2.IsReg(0, AOR::AOR_SP) &&
+			aon3._opc == AOC::AOC_LDW && aon4._opc == AOC::AOC_LDW && (aon3.IsReg(0, AOR::AOR_X) || aon3.IsReg(0, AOR::AOR_Y)) && (aon4.IsReg(0, AOR::AOR_X) || aon4.IsReg(0, AOR::AOR_Y)) &&
 			(aon3._args[0] != aon4._args[0]) && aon3._args[1].find(L", SP)") != std::wstring::npos && aon4._args[1].find(L", SP)") != std::wstring::npos
 			)
 		{
@@ -7789,8 +9292,8 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			{
 				if(n > 0 && n <= 255)
 				{
-					int32_t x_off = (ao._args[0] == L"X") ? n + 3 : (n + 1);
-					int32_t y_off = (ao._args[0] == L"X") ? n + 1 : (n + 3);
+					int32_t x_off = (ao.IsReg(0, AOR::AOR_X)) ? n + 3 : (n + 1);
+					int32_t y_off = (ao.IsReg(0, AOR::AOR_X)) ? n + 1 : (n + 3);
 
 					bool no_SP_off = true;
 					int32_t off1 = -1;
@@ -7799,35 +9302,49 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 					correct_SP_offset(aon4._args[1], 0, no_SP_off, &off2);
 					if(off1 > 0 && off2 > 0)
 					{
-						if (((x_off == off1 && aon3._args[0] == L"X") && (y_off == off2 && aon4._args[0] == L"Y")) ||
-							((x_off == off2 && aon4._args[0] == L"X") && (y_off == off1 && aon3._args[0] == L"Y")))
+						if (((x_off == off1 && aon3.IsReg(0, AOR::AOR_X)) && (y_off == off2 && aon4.IsReg(0, AOR::AOR_Y))) ||
+							((x_off == off2 && aon4.IsReg(0, AOR::AOR_X)) && (y_off == off1 && aon3.IsReg(0, AOR::AOR_Y))))
 						{
 							del_op(cs, next3);
 							del_op(cs, next4);
 
-							update_opt_rule_usage_stat(rule_id);
 							changed = true;
-							continue;
+							return true;
 						}
 					}
 				}
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x10013, 4, { AOC::AOC_LD }, { AOC::AOC_CLRW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+		int n4_size = 0;
+		bool n4_arithm_op = is_arithm_op(aon4, n4_size);
+
 		if (n4_arithm_op &&
-			!ao._volatile && !ao._is_inline && ao._op == L"LD" && ao._args[0] == L"A" &&
+			!ao._volatile && !ao._is_inline && ao._opc == AOC::AOC_LD && ao.IsReg(0, AOR::AOR_A) &&
 			(
 				// imm. value
-				(ao._args[1][0] != L'[' && ao._args[1][0] != L'(' && ao._args[1] != L"XL" && ao._args[1] != L"XH" && ao._args[1] != L"YL" && ao._args[1] != L"YH") ||
+				(ao._args[1][0] != L'[' && ao._args[1][0] != L'(' && !ao.IsReg(1, AOR::AOR_XL) && !ao.IsReg(1, AOR::AOR_XH) && !ao.IsReg(1, AOR::AOR_YL) && !ao.IsReg(1, AOR::AOR_YH)) ||
 				// direct addressing
-				(ao._args[1][0] == L'(' && ao._args[1] != L"(X)" && ao._args[1] != L"(Y)" && ao._args[1].find(L", X)") == std::wstring::npos && ao._args[1].find(L", Y)") == std::wstring::npos && ao._args[1].find(L", SP)") == std::wstring::npos)
+				(ao._args[1][0] == L'(' && !ao.IsInd(1, AOR::AOR_X) && !ao.IsInd(1, AOR::AOR_Y) && ao._args[1].find(L", X)") == std::wstring::npos && ao._args[1].find(L", Y)") == std::wstring::npos && ao._args[1].find(L", SP)") == std::wstring::npos)
 			) &&
-			aon1._op == L"CLRW" && aon1._args[0] == L"X" &&
-			aon2._op == L"LD" && aon2._args[0] == L"XL" &&
+			aon1._opc == AOC::AOC_CLRW && aon1.IsReg(0, AOR::AOR_X) &&
+			aon2._opc == AOC::AOC_LD && aon2.IsReg(0, AOR::AOR_XL) &&
 			// direct addressing
-			aon3._op == L"LDW" && aon3._args[0].front() == L'(' && aon3._args[0] != L"(Y)" && aon3._args[0].find(L", Y)") == std::wstring::npos && aon3._args[0].find(L", SP)") == std::wstring::npos && aon3._args[1] == L"X"
+			aon3._opc == AOC::AOC_LDW && aon3._args[0].front() == L'(' && !aon3.IsInd(0, AOR::AOR_Y) && aon3._args[0].find(L", Y)") == std::wstring::npos && aon3._args[0].find(L", SP)") == std::wstring::npos && aon3.IsReg(1, AOR::AOR_X)
 			)
 		{
 			// LD A, imm1 or (smth1)
@@ -7845,38 +9362,36 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			del_op(cs, next2);
 			del_op(cs, next3);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
-		}
-
-
-		auto next5 = std::next(next4);
-		if(next5 == cs.end())
-		{
-			i++;
-			continue;
-		}
-
-		auto &aon5 = *static_cast<B1_ASM_OP_STM8 *>(next5->get());
-		if(aon5._is_inline || !aon5.Parse())
-		{
-			i++;
-			continue;
+			return true;
 		}
 
-		int n5_size = 0;
-		bool n5_arithm_op = is_arithm_op(aon5, n5_size);
+		return false;
+	});
+
+	rules.Add(0x10014, 5, { AOC::AOC_LD }, { AOC::AOC_CLRW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto next4 = wnd._its[4];
+		auto &aon4 = *wnd._ops[4];
+		auto next5 = wnd._its[5];
+		auto &aon5 = *wnd._ops[5];
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
 		if(
-			(ao._op == L"LD" && ao._args[0] == L"A" && ao._args[1][0] == L'(') &&
-			(aon1._op == L"CLRW" && aon1._args[0] == L"X") &&
-			(aon2._op == L"LD" && aon2._args[0] == L"XL") &&
-			((aon3._op == L"DECW" || aon3._op == L"INCW" || aon3._op == L"ADDW" || aon3._op == L"SUBW") && aon3._args[0] == L"X") &&
-			(aon4._op == L"LD" && aon4._args[1] == L"XL") &&
-			(aon5._op == L"LD" && aon5._args[0] == ao._args[1] && aon5._args[1] == L"A")
+			(ao._opc == AOC::AOC_LD && ao.IsReg(0, AOR::AOR_A) && ao._args[1][0] == L'(') &&
+			(aon1._opc == AOC::AOC_CLRW && aon1.IsReg(0, AOR::AOR_X)) &&
+			(aon2._opc == AOC::AOC_LD && aon2.IsReg(0, AOR::AOR_XL)) &&
+			((aon3._opc == AOC::AOC_DECW || aon3._opc == AOC::AOC_INCW || aon3._opc == AOC::AOC_ADDW || aon3._opc == AOC::AOC_SUBW) && aon3.IsReg(0, AOR::AOR_X)) &&
+			(aon4._opc == AOC::AOC_LD && aon4.IsReg(1, AOR::AOR_XL)) &&
+			(aon5._opc == AOC::AOC_LD && aon5._args[0] == ao._args[1] && aon5.IsReg(1, AOR::AOR_A))
 		)
 		{
 			// LD A, (NS1::__VAR_I)
@@ -7889,7 +9404,7 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			// DEC (NS1::__VAR_I)
 
 			bool proceed = true;
-			if(aon3._op == L"DECW")
+			if(aon3._opc == AOC::AOC_DECW)
 			{
 				ao._data = L"DEC " + ao._args[1];
 				ao._parsed = false;
@@ -7897,7 +9412,7 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 				del_op(cs, next5);
 			}
 			else
-			if(aon3._op == L"INCW")
+			if(aon3._opc == AOC::AOC_INCW)
 			{
 				ao._data = L"INC " + ao._args[1];
 				ao._parsed = false;
@@ -7908,7 +9423,7 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			{
 				if(B1CUtils::is_num_val(aon3._args[1]))
 				{
-					aon3._data = ((aon3._op == L"ADDW") ? L"ADD A, " : L"SUB A, ") + aon3._args[1];
+					aon3._data = ((aon3._opc == AOC::AOC_ADDW) ? L"ADD A, " : L"SUB A, ") + aon3._args[1];
 					aon3._parsed = false;
 				}
 				else
@@ -7923,21 +9438,35 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 				del_op(cs, next2);
 				del_op(cs, next4);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x10015, 5, { AOC::AOC_LDW }, { AOC::AOC_PUSHW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+		auto &aon5 = *wnd._ops[5];
+
 		if(
-			(ao._op == L"LDW" && ao._args[0] == L"X" && ao._args[1] != L"(X)" && ao._args[1].find(L", X)") == std::wstring::npos) &&
-			(aon1._op == L"PUSHW" && aon1._args[0] == L"X") &&
-			(aon2._op == L"LDW" && aon2._args[0] == L"X" && aon2._args[1].front() == L'(') &&
-			((aon3._op == L"CALL" || aon3._op == L"CALLR" || aon3._op == L"CALLF") && aon3._args[0] == L"__LIB_STR_RLS") &&
-			(aon4._op == L"POPW" && aon4._args[0] == L"X") &&
-			(aon5._op == L"LDW" && aon5._args[1] == L"X" && aon5._args[0] == aon2._args[1])
+			(ao._opc == AOC::AOC_LDW && ao.IsReg(0, AOR::AOR_X) && !ao.IsInd(1, AOR::AOR_X) && ao._args[1].find(L", X)") == std::wstring::npos) &&
+			(aon1._opc == AOC::AOC_PUSHW && aon1.IsReg(0, AOR::AOR_X)) &&
+			(aon2._opc == AOC::AOC_LDW && aon2.IsReg(0, AOR::AOR_X) && aon2._args[1].front() == L'(') &&
+			((aon3._opc == AOC::AOC_CALL || aon3._opc == AOC::AOC_CALLR || aon3._opc == AOC::AOC_CALLF) && aon3._args[0] == L"__LIB_STR_RLS") &&
+			(aon4._opc == AOC::AOC_POPW && aon4.IsReg(0, AOR::AOR_X)) &&
+			(aon5._opc == AOC::AOC_LDW && aon5.IsReg(1, AOR::AOR_X) && aon5._args[0] == aon2._args[1])
 			)
 		{
 			// LDW X, __STR_0
@@ -7957,59 +9486,36 @@ C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 			del_op(cs, i);
 			i = next2;
 			
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
+		return false;
+	});
 
-		i++;
-	}
-
-	return C1_T_ERROR::C1_RES_OK;
+	rules.Compile();
 }
 
-C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
+C1_T_ERROR C1STM8Compiler::Optimize1(bool &changed)
 {
-	auto &cs = *_code_secs.begin();
-	auto i = cs.begin();
-
-	while(i != cs.end())
-	{
-		int32_t rule_id = 0x20000;
-
-		auto &ao = *static_cast<B1_ASM_OP_STM8 *>(i->get());
+	TRepStage trep_stage("Optimize1");
 
-		if(ao._type == AOT::AOT_LABEL)
-		{
-			_opt_labels[ao._data] = i;
-			i++;
-			continue;
-		}
-
-		if(!ao.Parse())
-		{
-			i++;
-			continue;
-		}
+	return apply_opt_rules(_opt_rules1, changed);
+}
 
-		auto next1 = std::next(i);
-		if(next1 == cs.end())
-		{
-			i++;
-			continue;
-		}
+void C1STM8Compiler::init_opt_rules2()
+{
+	auto &rules = _opt_rules2;
 
-		auto &aon1 = *static_cast<B1_ASM_OP_STM8 *>(next1->get());
-		if(aon1._is_inline || !aon1.Parse())
-		{
-			i++;
-			continue;
-		}
+	rules.Add(0x20001, 1, { AOC::AOC_ADD, AOC::AOC_ADDW, AOC::AOC_PUSH, AOC::AOC_PUSHW, AOC::AOC_SUB, AOC::AOC_SUBW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if((ao._op == L"PUSH" && ao._args[0][0] != L'(') || ao._op == L"PUSHW" || ((ao._op == L"ADD" || ao._op == L"ADDW" || ao._op == L"SUB" || ao._op == L"SUBW") && ao._args[0] == L"SP"))
+		if((ao._opc == AOC::AOC_PUSH && ao._args[0][0] != L'(') || ao._opc == AOC::AOC_PUSHW || ((ao._opc == AOC::AOC_ADD || ao._opc == AOC::AOC_ADDW || ao._opc == AOC::AOC_SUB || ao._opc == AOC::AOC_SUBW) && ao.IsReg(0, AOR::AOR_SP)))
 		{
 			// PUSH/PUSHW <reg> or ADDW/SUBW SP, <value1>
 			// ops not using stack
@@ -8036,7 +9542,7 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 					break;
 				}
 
-				if((next_ao->_op == L"ADDW" || next_ao->_op == L"ADD" || next_ao->_op == L"SUBW" || next_ao->_op == L"SUB") && next_ao->_args[0] == L"SP")
+				if((next_ao->_opc == AOC::AOC_ADDW || next_ao->_opc == AOC::AOC_ADD || next_ao->_opc == AOC::AOC_SUBW || next_ao->_opc == AOC::AOC_SUB) && next_ao->IsReg(0, AOR::AOR_SP))
 				{
 					proceed = true;
 					break;
@@ -8047,7 +9553,7 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 				bool n_arithm_op = is_arithm_op(*next_ao, n_size, &n_SP_arg);
 
 				if(
-					(!n_arithm_op && !(next_ao->_op == L"LD" || next_ao->_op == L"LDW" || next_ao->_op == L"TNZ" || next_ao->_op == L"TNZW" || next_ao->_op == L"CP" || next_ao->_op == L"CPW")) ||
+					(!n_arithm_op && !(next_ao->_opc == AOC::AOC_LD || next_ao->_opc == AOC::AOC_LDW || next_ao->_opc == AOC::AOC_TNZ || next_ao->_opc == AOC::AOC_TNZW || next_ao->_opc == AOC::AOC_CP || next_ao->_opc == AOC::AOC_CPW)) ||
 					(n_SP_arg >= 0)
 					)
 				{
@@ -8060,9 +9566,9 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 				int32_t sp_delta = 0;
 				bool err = false;
 
-				if(ao._op == L"PUSH") sp_delta--;
+				if(ao._opc == AOC::AOC_PUSH) sp_delta--;
 				else
-				if(ao._op == L"PUSHW") sp_delta -= 2;
+				if(ao._opc == AOC::AOC_PUSHW) sp_delta -= 2;
 				else
 				{
 					int32_t n;
@@ -8070,7 +9576,7 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 					{
 						if(n > 0 && n <= 255)
 						{
-							if(ao._op == L"ADD" || ao._op == L"ADDW")
+							if(ao._opc == AOC::AOC_ADD || ao._opc == AOC::AOC_ADDW)
 							{
 								sp_delta += n;
 							}
@@ -8097,7 +9603,7 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 					{
 						if(n > 0 && n <= 255)
 						{
-							if(next_ao->_op == L"ADD" || next_ao->_op == L"ADDW")
+							if(next_ao->_opc == AOC::AOC_ADD || next_ao->_opc == AOC::AOC_ADDW)
 							{
 								sp_delta += n;
 							}
@@ -8106,7 +9612,7 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 								// do not allow:
 								// PUSH/PUSHW <reg>
 								// SUBW SP, <value>
-								if(ao._op == L"PUSH" || ao._op == L"PUSHW")
+								if(ao._opc == AOC::AOC_PUSH || ao._opc == AOC::AOC_PUSHW)
 								{
 									err = true;
 								}
@@ -8140,41 +9646,57 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 							del_op(cs, next);
 						}
 
-						update_opt_rule_usage_stat(rule_id);
 						changed = true;
-						continue;
+						return true;
 					}
 				}
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if( (ao._op == L"PUSHW" && aon1._op == L"LDW" &&
-			((aon1._args[0] == ao._args[0] && aon1._args[1] == L"(0x1, SP)") || (aon1._args[1] == ao._args[0] && aon1._args[0] == L"(0x1, SP)"))) ||
+		return false;
+	});
+
+	rules.Add(0x20002, 1, { AOC::AOC_PUSH, AOC::AOC_PUSHW }, { AOC::AOC_LD, AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+
+		if( (ao._opc == AOC::AOC_PUSHW && aon1._opc == AOC::AOC_LDW &&
+			((aon1._args[0] == ao._args[0] && aon1.IsIdx(1, AOR::AOR_SP, 0x1)) || (aon1._args[1] == ao._args[0] && aon1.IsIdx(0, AOR::AOR_SP, 0x1)))) ||
 
-			(ao._op == L"PUSH" && ao._args[0] == L"A" && aon1._op == L"LD" &&
-				((aon1._args[0] == L"A" && aon1._args[1] == L"(0x1, SP)") || (aon1._args[1] == L"A" && aon1._args[0] == L"(0x1, SP)")))
+			(ao._opc == AOC::AOC_PUSH && ao.IsReg(0, AOR::AOR_A) && aon1._opc == AOC::AOC_LD &&
+				((aon1.IsReg(0, AOR::AOR_A) && aon1.IsIdx(1, AOR::AOR_SP, 0x1)) || (aon1.IsReg(1, AOR::AOR_A) && aon1.IsIdx(0, AOR::AOR_SP, 0x1))))
 			)
 		{
 			// PUSH/PUSHW <reg>
 			// -LD/LDW <reg>, (0x1, SP) or LD/LDW (0x1, SP), <reg>
 			del_op(cs, next1);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if((ao._op == L"LD" || ao._op == L"LDW") && (aon1._op == L"ADDW" || aon1._op == L"ADD") && aon1._args[0] == L"SP")
+		return false;
+	});
+
+	rules.Add(0x20003, 1, { AOC::AOC_LD, AOC::AOC_LDW }, { AOC::AOC_ADD, AOC::AOC_ADDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+
+		if((ao._opc == AOC::AOC_LD || ao._opc == AOC::AOC_LDW) && (aon1._opc == AOC::AOC_ADDW || aon1._opc == AOC::AOC_ADD) && aon1.IsReg(0, AOR::AOR_SP))
 		{
 			// -LDW (0x1, SP), X
 			// ADDW SP, 0x4
 			bool err = false;
 			int32_t n, n1;
-			int32_t size = ao._op == L"LD" ? 1 : 2;
+			int32_t size = ao._opc == AOC::AOC_LD ? 1 : 2;
 			bool no_SP_off = true;
 			if(correct_SP_offset(ao._args[0], 0, no_SP_off, &n).empty())
 			{
@@ -8195,16 +9717,24 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 				{
 					i = del_op(cs, i);
 
-					update_opt_rule_usage_stat(rule_id);
 					changed = true;
-					continue;
+					return true;
 				}
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(((ao._op == L"LDW" && aon1._op == L"LDW") || (ao._op == L"LD" && aon1._op == L"LD")) && ao._args[0] == aon1._args[1] && ao._args[1] == aon1._args[0])
+		return false;
+	});
+
+	rules.Add(0x20004, 1, { AOC::AOC_LD, AOC::AOC_LDW }, { AOC::AOC_LD, AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+
+		if(((ao._opc == AOC::AOC_LDW && aon1._opc == AOC::AOC_LDW) || (ao._opc == AOC::AOC_LD && aon1._opc == AOC::AOC_LD)) && ao._args[0] == aon1._args[1] && ao._args[1] == aon1._args[0])
 		{
 			// LDW X, (ADDR)
 			// -LDW (ADDR), X
@@ -8212,61 +9742,58 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			{
 				del_op(cs, next1);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
+		return false;
+	});
 
+	rules.Add(0x20005, 1, {}, { AOC::AOC_TNZ, AOC::AOC_TNZW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
 		int i_size = 0;
 		bool i_arithm_op = is_arithm_op(ao, i_size);
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(!aon1._volatile && i_arithm_op && i_size == 2 && !(ao._op == L"MUL" || ao._op == L"DIV" || ao._op == L"DIVW") && aon1._op == L"TNZW" && ao._args[0] == aon1._args[0])
+		if(!aon1._volatile && i_arithm_op && i_size == 2 && !(ao._opc == AOC::AOC_MUL || ao._opc == AOC::AOC_DIV || ao._opc == AOC::AOC_DIVW) && aon1._opc == AOC::AOC_TNZW && ao._args[0] == aon1._args[0])
 		{
 			// LDW X, smth not reg
 			// -TNZW X
 			del_op(cs, next1);
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 		else
-		if(!aon1._volatile && i_arithm_op && i_size == 1 && aon1._op == L"TNZ" && ao._args[0] == aon1._args[0])
+		if(!aon1._volatile && i_arithm_op && i_size == 1 && aon1._opc == AOC::AOC_TNZ && ao._args[0] == aon1._args[0])
 		{
 			// LD A, smth not reg
 			// -TNZ A
 			del_op(cs, next1);
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
-		}
-
-		auto next2 = std::next(next1);
-		if(next2 == cs.end())
-		{
-			i++;
-			continue;
+			return true;
 		}
 
-		auto &aon2 = *static_cast<B1_ASM_OP_STM8 *>(next2->get());
-		if(aon2._is_inline || !aon2.Parse())
-		{
-			i++;
-			continue;
-		}
+		return false;
+	});
 
+	rules.Add(0x20006, 2, { AOC::AOC_LD, AOC::AOC_LDW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
 		int n1_size = 0;
 		bool n1_arithm_op = is_arithm_op(aon1, n1_size);
-		int n2_size = 0;
-		bool n2_arithm_op = is_arithm_op(aon2, n2_size);
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
 		if(
-			!ao._volatile && (ao._op == L"LDW" || ao._op == L"LD") && (ao._op == aon2._op) && (ao._args == aon2._args) && (ao._args[1] == L"X" || ao._args[1] == L"A" || ao._args[1] == L"Y") &&
+			!ao._volatile && (ao._opc == AOC::AOC_LDW || ao._opc == AOC::AOC_LD) && (ao._op == aon2._op) && (ao._args == aon2._args) && (ao.IsReg(1, AOR::AOR_X) || ao.IsReg(1, AOR::AOR_A) || ao.IsReg(1, AOR::AOR_Y)) &&
 			(aon1._args.size() < 2 || (aon1._args.size() == 2 && aon1._args[1] != ao._args[0])) &&
 			(aon1._type == AOT::AOT_LABEL || n1_arithm_op)
 			)
@@ -8278,22 +9805,33 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			{
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x20007, 2, { AOC::AOC_LD }, { AOC::AOC_ADD, AOC::AOC_AND, AOC::AOC_CPL, AOC::AOC_DEC, AOC::AOC_INC, AOC::AOC_NEG, AOC::AOC_OR, AOC::AOC_SLA, AOC::AOC_SLL, AOC::AOC_SRA, AOC::AOC_SRL, AOC::AOC_SUB, AOC::AOC_XOR },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+
 		if(
-			(ao._op == L"LD" && ao._args[0] == L"A" && aon2._op == L"LD" && ao._args[1] == aon2._args[0]) &&
+			(ao._opc == AOC::AOC_LD && ao.IsReg(0, AOR::AOR_A) && aon2._opc == AOC::AOC_LD && ao._args[1] == aon2._args[0]) &&
 				(
-				((aon1._op == L"ADD" || aon1._op == L"SUB") && (aon1._args[1] == L"0x1" || (aon1._args[1] == L"0x2" && !ao._volatile && !aon2._volatile))) ||
-				((aon1._op == L"INC" || aon1._op == L"DEC" || aon1._op == L"NEG" || aon1._op == L"CPL" || aon1._op == L"SRL" || aon1._op == L"SRA" || aon1._op == L"SLL" || aon1._op == L"SLA") && aon1._args[0] == L"A") ||
-				((aon1._op == L"AND" || aon1._op == L"OR" || aon1._op == L"XOR") && ao._args[1][0] == L'(' && ao._args[1].find(L',') == std::wstring::npos && ao._args[1] != L"(X)" && ao._args[1] != L"(Y)")
+				((aon1._opc == AOC::AOC_ADD || aon1._opc == AOC::AOC_SUB) && (aon1.IsImm(1, 0x1) || (aon1.IsImm(1, 0x2) && !ao._volatile && !aon2._volatile))) ||
+				((aon1._opc == AOC::AOC_INC || aon1._opc == AOC::AOC_DEC || aon1._opc == AOC::AOC_NEG || aon1._opc == AOC::AOC_CPL || aon1._opc == AOC::AOC_SRL || aon1._opc == AOC::AOC_SRA || aon1._opc == AOC::AOC_SLL || aon1._opc == AOC::AOC_SLA) && aon1.IsReg(0, AOR::AOR_A)) ||
+				((aon1._opc == AOC::AOC_AND || aon1._opc == AOC::AOC_OR || aon1._opc == AOC::AOC_XOR) && ao._args[1][0] == L'(' && ao._args[1].find(L',') == std::wstring::npos && !ao.IsInd(1, AOR::AOR_X) && !ao.IsInd(1, AOR::AOR_Y))
 				) &&
-			!is_reg_used_after(next2, cs.cend(), L"A")
+			!is_reg_live_after(next2, C1STM8_LIVE_A)
 			)
 		{
 			// LD A, (...)
@@ -8311,15 +9849,15 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			bool proceed = true;
 			bool leave_next1 = false;
 
-			if(aon1._op == L"INC")
+			if(aon1._opc == AOC::AOC_INC)
 			{
 				ao._data = L"INC " + ao._args[1];
 			}
 			else
-			if(aon1._op == L"ADD")
+			if(aon1._opc == AOC::AOC_ADD)
 			{
 				ao._data = L"INC " + ao._args[1];
-				if(aon1._args[1] == L"0x2")
+				if(aon1.IsImm(1, 0x2))
 				{
 					// B1_ASM_OP_STM8 constructor sets _parsed to false
 					next1->reset(new B1_ASM_OP_STM8(ao));
@@ -8327,15 +9865,15 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 				}
 			}
 			else
-			if(aon1._op == L"DEC")
+			if(aon1._opc == AOC::AOC_DEC)
 			{
 				ao._data = L"DEC " + ao._args[1];
 			}
 			else
-			if(aon1._op == L"SUB")
+			if(aon1._opc == AOC::AOC_SUB)
 			{
 				ao._data = L"DEC " + ao._args[1];
-				if(aon1._args[1] == L"0x2")
+				if(aon1.IsImm(1, 0x2))
 				{
 					// B1_ASM_OP_STM8 constructor sets _parsed to false
 					next1->reset(new B1_ASM_OP_STM8(ao));
@@ -8343,7 +9881,7 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 				}
 			}
 			else
-			if(aon1._op == L"NEG" || aon1._op == L"CPL" || aon1._op == L"SRL" || aon1._op == L"SRA" || aon1._op == L"SLL" || aon1._op == L"SLA")
+			if(aon1._opc == AOC::AOC_NEG || aon1._opc == AOC::AOC_CPL || aon1._opc == AOC::AOC_SRL || aon1._opc == AOC::AOC_SRA || aon1._opc == AOC::AOC_SLL || aon1._opc == AOC::AOC_SLA)
 			{
 				ao._data = aon1._op + L" " + ao._args[1];
 			}
@@ -8354,7 +9892,7 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 
 				if(Utils::str2int32(aon1._args[1], n) == B1_RES_OK)
 				{
-					if(aon1._op == L"AND")
+					if(aon1._opc == AOC::AOC_AND)
 					{
 						n = ~n;
 					}
@@ -8380,8 +9918,8 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 
 				if(bpos >= 0)
 				{
-					ao._data =	(aon1._op == L"AND")	? L"BRES " :
-								(aon1._op == L"OR")	? L"BSET " : L"BCPL ";
+					ao._data =	(aon1._opc == AOC::AOC_AND)	? L"BRES " :
+								(aon1._opc == AOC::AOC_OR)	? L"BSET " : L"BCPL ";
 					ao._data += ao._args[1] + L", " + Utils::str_tohex16(bpos);
 				}
 				else
@@ -8399,17 +9937,24 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 				}
 				del_op(cs, next2);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if ((ao._op == L"LDW" && ao._args[1] == L"X") &&
-			(aon1._op == L"LDW" && aon1._args[0] == L"X") &&
-			(!aon2._volatile && aon2._op == L"SUBW" && aon2._args[0] == L"X") &&
+		return false;
+	});
+
+	rules.Add(0x20008, 2, { AOC::AOC_LDW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+
+		if ((ao._opc == AOC::AOC_LDW && ao.IsReg(1, AOR::AOR_X)) &&
+			(aon1._opc == AOC::AOC_LDW && aon1.IsReg(0, AOR::AOR_X)) &&
+			(!aon2._volatile && aon2._opc == AOC::AOC_SUBW && aon2.IsReg(0, AOR::AOR_X)) &&
 			(ao._args[0] == aon2._args[1])
 			)
 		{
@@ -8427,18 +9972,27 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 				aon2._data = L"NEGW X";
 				aon2._parsed = false;
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x20009, 2, { AOC::AOC_LD, AOC::AOC_LDW }, { AOC::AOC_LD, AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+
 		if (!ao._volatile &&
-			(((ao._op == L"LD" && aon1._op == L"LD") && (aon2._op == L"ADD" || aon2._op == L"AND" || aon2._op == L"OR" || aon2._op == L"XOR")) ||
-				((ao._op == L"LDW" && aon1._op == L"LDW") && (aon2._op == L"ADDW") &&
-					aon1._args[1] != L"(X)" && aon1._args[1] != L"(Y)" && aon1._args[1].front() != L'[' &&
+			(((ao._opc == AOC::AOC_LD && aon1._opc == AOC::AOC_LD) && (aon2._opc == AOC::AOC_ADD || aon2._opc == AOC::AOC_AND || aon2._opc == AOC::AOC_OR || aon2._opc == AOC::AOC_XOR)) ||
+				((ao._opc == AOC::AOC_LDW && aon1._opc == AOC::AOC_LDW) && (aon2._opc == AOC::AOC_ADDW) &&
+					!aon1.IsInd(1, AOR::AOR_X) && !aon1.IsInd(1, AOR::AOR_Y) && aon1._args[1].front() != L'[' &&
 					aon1._args[1].find(L", X)") == std::wstring::npos && aon1._args[1].find(L", Y)") == std::wstring::npos)) &&
 			(ao._args[0] == aon2._args[1])
 			)
@@ -8453,20 +10007,29 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			aon2._parsed = false;
 			del_op(cs, next1);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x2000A, 2, { AOC::AOC_LD, AOC::AOC_LDW, AOC::AOC_PUSH, AOC::AOC_PUSHW }, { AOC::AOC_SUB, AOC::AOC_SUBW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+
 		if ((
-			((ao._op == L"PUSH" || ao._op == L"PUSHW") && (ao._args[0] == L"A" || ao._args[0] == L"X" || ao._args[0] == L"Y")) ||
-			((ao._op == L"LD" || ao._op == L"LDW") && ao._args[0].find(L", SP)") != std::wstring::npos)
+			((ao._opc == AOC::AOC_PUSH || ao._opc == AOC::AOC_PUSHW) && (ao.IsReg(0, AOR::AOR_A) || ao.IsReg(0, AOR::AOR_X) || ao.IsReg(0, AOR::AOR_Y))) ||
+			((ao._opc == AOC::AOC_LD || ao._opc == AOC::AOC_LDW) && ao._args[0].find(L", SP)") != std::wstring::npos)
 			) &&
 			(
-			(aon1._op == L"SUB" || aon1._op == L"SUBW") && aon1._args[0] == L"SP" &&
-			(aon2._op == L"LD" || aon2._op == L"LDW") && aon2._args[1].find(L", SP)") != std::wstring::npos
+			(aon1._opc == AOC::AOC_SUB || aon1._opc == AOC::AOC_SUBW) && aon1.IsReg(0, AOR::AOR_SP) &&
+			(aon2._opc == AOC::AOC_LD || aon2._opc == AOC::AOC_LDW) && aon2._args[1].find(L", SP)") != std::wstring::npos
 			) &&
 			(aon2._args[0] == ao._args[ao._args.size() - 1])
 			)
@@ -8515,19 +10078,30 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 					{
 						del_op(cs, next2);
 
-						update_opt_rule_usage_stat(rule_id);
 						changed = true;
-						continue;
+						return true;
 					}
 				}
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if( (ao._op == L"ADD" || ao._op == L"ADDW") && ao._args[0] == L"SP" && 
+		return false;
+	});
+
+	rules.Add(0x2000B, 2, { AOC::AOC_ADD, AOC::AOC_ADDW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		int n1_size = 0;
+		bool n1_arithm_op = is_arithm_op(aon1, n1_size);
+
+		if( (ao._opc == AOC::AOC_ADD || ao._opc == AOC::AOC_ADDW) && ao.IsReg(0, AOR::AOR_SP) && 
 			(n1_arithm_op) &&
-			(aon2._op == L"ADD" || aon2._op == L"ADDW") && aon2._args[0] == L"SP"
+			(aon2._opc == AOC::AOC_ADD || aon2._opc == AOC::AOC_ADDW) && aon2.IsReg(0, AOR::AOR_SP)
 			)
 		{
 			// ADDW SP, N
@@ -8553,9 +10127,8 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 					aon2._parsed = false;
 					i = del_op(cs, i);
 
-					update_opt_rule_usage_stat(rule_id);
 					changed = true;
-					continue;
+					return true;
 				}
 				else
 				if(no_SP_off && ao._args.size() == 2 && !correct_SP_offset(aon1._args[1], 0, no_SP_off, &off).empty())
@@ -8566,35 +10139,30 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 					aon2._parsed = false;
 					i = del_op(cs, i);
 
-					update_opt_rule_usage_stat(rule_id);
 					changed = true;
-					continue;
+					return true;
 				}
 			}
 		}
 
+		return false;
+	});
 
-		auto next3 = std::next(next2);
-		if(next3 == cs.end())
-		{
-			i++;
-			continue;
-		}
-
-		auto &aon3 = *static_cast<B1_ASM_OP_STM8 *>(next3->get());
-		if(aon3._is_inline || !aon3.Parse())
-		{
-			i++;
-			continue;
-		}
+	rules.Add(0x2000C, 3, { AOC::AOC_CLRW, AOC::AOC_LDW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
 		if (
-			((ao._op == L"CLRW" || ao._op == L"LDW") && ao._args[0] == L"X") &&
-			(aon1._op == L"LDW" && aon1._args[1] == L"X") &&
-			(aon2._op == L"SUBW" && aon2._args[0] == L"X") &&
-			(aon3._op == L"NEGW" && aon3._args[0] == L"X")
+			((ao._opc == AOC::AOC_CLRW || ao._opc == AOC::AOC_LDW) && ao.IsReg(0, AOR::AOR_X)) &&
+			(aon1._opc == AOC::AOC_LDW && aon1.IsReg(1, AOR::AOR_X)) &&
+			(aon2._opc == AOC::AOC_SUBW && aon2.IsReg(0, AOR::AOR_X)) &&
+			(aon3._opc == AOC::AOC_NEGW && aon3.IsReg(0, AOR::AOR_X))
 			)
 		{
 			// CLRW X or LDW X, <imm1>
@@ -8617,30 +10185,43 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			
 			int32_t n1 = 0, n2;
 
-			bool proceed = (ao._op == L"CLRW" || Utils::str2int32(ao._args[1], n1) == B1_RES_OK) && (Utils::str2int32(aon2._args[1], n2) == B1_RES_OK);
+			bool proceed = (ao._opc == AOC::AOC_CLRW || Utils::str2int32(ao._args[1], n1) == B1_RES_OK) && (Utils::str2int32(aon2._args[1], n2) == B1_RES_OK);
 
-			if(proceed || ao._op == L"CLRW")
+			if(proceed || ao._opc == AOC::AOC_CLRW)
 			{
 				aon2._data = L"LDW X, " + (proceed ? Utils::str_tohex16(n2 - n1) : aon2._args[1]);
 				aon2._parsed = false;
 				del_op(cs, next3);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x2000D, 3, { AOC::AOC_PUSH, AOC::AOC_PUSHW }, { AOC::AOC_LD, AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+
 		if (
-			((((ao._op == L"PUSH" && aon1._op == L"LD") && (aon2._op == L"ADD" || aon2._op == L"AND" || aon2._op == L"OR" || aon2._op == L"XOR" || aon2._op == L"SUB")) &&
-			(aon2._args[1] == L"(0x1, SP)") &&
-			(ao._args[0] == L"A" && aon1._args[0] == L"A" && aon2._args[0] == L"A"))) ||
+			((((ao._opc == AOC::AOC_PUSH && aon1._opc == AOC::AOC_LD) && (aon2._opc == AOC::AOC_ADD || aon2._opc == AOC::AOC_AND || aon2._opc == AOC::AOC_OR || aon2._opc == AOC::AOC_XOR || aon2._opc == AOC::AOC_SUB)) &&
+			(aon2.IsIdx(1, AOR::AOR_SP, 0x1)) &&
+			(ao.IsReg(0, AOR::AOR_A) && aon1.IsReg(0, AOR::AOR_A) && aon2.IsReg(0, AOR::AOR_A)))) ||
 
-			((ao._op == L"PUSHW" && aon1._op == L"LDW" && (aon2._op == L"ADDW" || aon2._op == L"SUBW")) &&
-			(ao._args[0] == L"X" && aon1._args[0] == L"X" && aon2._args[0] == L"X" && aon2._args[1] == L"(0x1, SP)") &&
-			(aon1._args[1][0] != L'[' && aon1._args[1].find(L", X)") == std::wstring::npos && aon1._args[1] != L"(X)"))
+			((ao._opc == AOC::AOC_PUSHW && aon1._opc == AOC::AOC_LDW && (aon2._opc == AOC::AOC_ADDW || aon2._opc == AOC::AOC_SUBW)) &&
+			(ao.IsReg(0, AOR::AOR_X) && aon1.IsReg(0, AOR::AOR_X) && aon2.IsReg(0, AOR::AOR_X) && aon2.IsIdx(1, AOR::AOR_SP, 0x1)) &&
+			(aon1._args[1][0] != L'[' && aon1._args[1].find(L", X)") == std::wstring::npos && !aon1.IsInd(1, AOR::AOR_X)))
 			)
 		{
 			// PUSH A
@@ -8671,7 +10252,7 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			std::wstring new_op = L"ADDW";
 			std::wstring neg_op = L"NEGW X";
 
-			if(ao._op == L"PUSH")
+			if(ao._opc == AOC::AOC_PUSH)
 			{
 				data_size = 1;
 				reg = L"A";
@@ -8684,7 +10265,7 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			int32_t n = -1;
 			bool remove_push = false;
 
-			if((aon3._op == L"ADD" || aon3._op == L"ADDW") && aon3._args[0] == L"SP")
+			if((aon3._opc == AOC::AOC_ADD || aon3._opc == AOC::AOC_ADDW) && aon3.IsReg(0, AOR::AOR_SP))
 			{
 				if(Utils::str2int32(aon3._args[1], n) == B1_RES_OK)
 				{
@@ -8736,19 +10317,30 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 					}
 				}
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x2000E, 3, { AOC::AOC_LD, AOC::AOC_LDW }, { AOC::AOC_LD, AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+
 		if(
-			((ao._op == L"LDW" || ao._op == L"LD") && (ao._op == aon2._op) && (ao._args[0] == aon2._args[1]) && (ao._args[1] == aon2._args[0])) &&
-			((aon1._op == L"LDW" || aon1._op == L"LD") && (aon1._op == aon3._op) && (aon1._args[0] == aon3._args[1]) && (aon1._args[1] == aon3._args[0])) &&
-			(ao._args[0].find(L", X)") == std::wstring::npos && ao._args[0] != L"(X)" && ao._args[0].find(L", Y)") == std::wstring::npos && ao._args[0] != L"(Y)") &&
-			(aon1._args[0].find(L", X)") == std::wstring::npos && aon1._args[0] != L"(X)" && aon1._args[0].find(L", Y)") == std::wstring::npos && aon1._args[0] != L"(Y)")
+			((ao._opc == AOC::AOC_LDW || ao._opc == AOC::AOC_LD) && (ao._op == aon2._op) && (ao._args[0] == aon2._args[1]) && (ao._args[1] == aon2._args[0])) &&
+			((aon1._opc == AOC::AOC_LDW || aon1._opc == AOC::AOC_LD) && (aon1._op == aon3._op) && (aon1._args[0] == aon3._args[1]) && (aon1._args[1] == aon3._args[0])) &&
+			(ao._args[0].find(L", X)") == std::wstring::npos && !ao.IsInd(0, AOR::AOR_X) && ao._args[0].find(L", Y)") == std::wstring::npos && !ao.IsInd(0, AOR::AOR_Y)) &&
+			(aon1._args[0].find(L", X)") == std::wstring::npos && !aon1.IsInd(0, AOR::AOR_X) && aon1._args[0].find(L", Y)") == std::wstring::npos && !aon1.IsInd(0, AOR::AOR_Y))
 			)
 		{
 			// LDW (0x1, SP), Y
@@ -8763,26 +10355,32 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			{
 				del_op(cs, next2);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 			if(!aon3._volatile)
 			{
 				del_op(cs, next3);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		int n3_size = 0;
-		bool n3_arithm_op = is_arithm_op(aon3, n3_size);
+		return false;
+	});
+
+	rules.Add(0x2000F, 3, { AOC::AOC_PUSH, AOC::AOC_PUSHW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		int i_size = 0;
+		bool i_arithm_op = is_arithm_op(ao, i_size);
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if ((ao._op == L"PUSH" || ao._op == L"PUSHW"))
+		if ((ao._opc == AOC::AOC_PUSH || ao._opc == AOC::AOC_PUSHW))
 		{
 			// PUSH A or PUSHW X/Y
 			// AND A, 0x20
@@ -8792,7 +10390,7 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			// AND A, 0x20
 			// LD (4096), A
 
-			int32_t size = (ao._op == L"PUSH") ? 1 : 2, n = 0;
+			int32_t size = (ao._opc == AOC::AOC_PUSH) ? 1 : 2, n = 0;
 			std::vector<std::tuple<B1_ASM_OPS::iterator, std::wstring, int>> new_offsets;
 			bool proceed = false;
 			auto next = next1;
@@ -8828,7 +10426,7 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 					continue;
 				}
 
-				if((next_ao->_op == L"ADD" || next_ao->_op == L"ADDW") && next_ao->_args[0] == L"SP")
+				if((next_ao->_opc == AOC::AOC_ADD || next_ao->_opc == AOC::AOC_ADDW) && next_ao->IsReg(0, AOR::AOR_SP))
 				{
 					if(Utils::str2int32(next_ao->_args[1], n) == B1_RES_OK && n >= size)
 					{
@@ -8878,19 +10476,30 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 				}
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x20010, 3, { AOC::AOC_LDW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+
 		if(
-			(ao._op == L"LDW" && aon1._op == L"LDW" && aon2._op == L"LDW" && aon3._op == L"LDW") &&
-			(ao._args[0] == L"X" && aon1._args[0] == L"Y" && aon1._args[1] == L"X" && aon2._args[0] == L"X" && aon3._args[1] == L"Y") &&
+			(ao._opc == AOC::AOC_LDW && aon1._opc == AOC::AOC_LDW && aon2._opc == AOC::AOC_LDW && aon3._opc == AOC::AOC_LDW) &&
+			(ao.IsReg(0, AOR::AOR_X) && aon1.IsReg(0, AOR::AOR_Y) && aon1.IsReg(1, AOR::AOR_X) && aon2.IsReg(0, AOR::AOR_X) && aon3.IsReg(1, AOR::AOR_Y)) &&
 			(aon2._args[1].front() == L'(' && aon2._args[1].find(L", X)") == std::wstring::npos && aon2._args[1].find(L", SP)") == std::wstring::npos) &&
-			(aon3._args[0].size() >= 3 && aon3._args[0][1] != L'[' && (aon3._args[0] == L"(X)" || aon3._args[0].find(L", X)") != std::wstring::npos))
+			(aon3._args[0].size() >= 3 && aon3._args[0][1] != L'[' && (aon3.IsInd(0, AOR::AOR_X) || aon3._args[0].find(L", X)") != std::wstring::npos))
 			)
 		{
 			// LDW X, <smth>
@@ -8908,16 +10517,15 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			const auto smth = ao._args[1];
 			const auto addr = aon2._args[1].substr(1, aon2._args[1].length() - 2);
 
-			if(aon3._args[0] == L"(X)")
+			if(aon3.IsInd(0, AOR::AOR_X))
 			{
 				aon1._data = L"LDW [" + addr + L"], X";
 				aon1._parsed = false;
 				del_op(cs, next2);
 				del_op(cs, next3);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 			else
 			{
@@ -8932,18 +10540,28 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 					aon2._parsed = false;
 					del_op(cs, next3);
 
-					update_opt_rule_usage_stat(rule_id);
 					changed = true;
-					continue;
+					return true;
 				}
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x20011, 3, { AOC::AOC_POPW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+
 		if(
-			(ao._op == L"POPW" && aon1._op == L"LDW" && aon2._op == L"LDW" && aon3._op == L"LDW") &&
-			(ao._args[0] == L"X" && aon1._args[0] == L"X" && aon1._args[1] == L"(X)" && aon2._args[0] == L"Y" && aon2._args[1] == L"X" && aon3._args[0] == L"X")
+			(ao._opc == AOC::AOC_POPW && aon1._opc == AOC::AOC_LDW && aon2._opc == AOC::AOC_LDW && aon3._opc == AOC::AOC_LDW) &&
+			(ao.IsReg(0, AOR::AOR_X) && aon1.IsReg(0, AOR::AOR_X) && aon1.IsInd(1, AOR::AOR_X) && aon2.IsReg(0, AOR::AOR_Y) && aon2.IsReg(1, AOR::AOR_X) && aon3.IsReg(0, AOR::AOR_X))
 			)
 		{
 			// POPW X
@@ -8960,17 +10578,27 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			aon1._parsed = false;
 			del_op(cs, next2);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x20012, 3, { AOC::AOC_POPW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+
 		if(
-			(ao._op == L"POPW" && aon1._op == L"LDW" && aon2._op == L"LDW" && aon3._op == L"LDW") &&
-			(ao._args[0] == L"Y" && aon1._args[0] == L"X" && aon1._args[1].front() == L'(' && aon1._args[1][1] != L'[' &&
-				aon1._args[1].find(L", X)") == std::wstring::npos && aon1._args[1].find(L", SP)") == std::wstring::npos && aon2._args[0] == L"(X)" && aon2._args[1] == L"Y" && aon3._args[0] == L"X")
+			(ao._opc == AOC::AOC_POPW && aon1._opc == AOC::AOC_LDW && aon2._opc == AOC::AOC_LDW && aon3._opc == AOC::AOC_LDW) &&
+			(ao.IsReg(0, AOR::AOR_Y) && aon1.IsReg(0, AOR::AOR_X) && aon1._args[1].front() == L'(' && aon1._args[1][1] != L'[' &&
+				aon1._args[1].find(L", X)") == std::wstring::npos && aon1._args[1].find(L", SP)") == std::wstring::npos && aon2.IsInd(0, AOR::AOR_X) && aon2.IsReg(1, AOR::AOR_Y) && aon3.IsReg(0, AOR::AOR_X))
 			)
 		{
 			// POPW Y
@@ -8987,18 +10615,30 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			aon1._parsed = false;
 			del_op(cs, next2);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x20013, 3, { AOC::AOC_PUSH }, { AOC::AOC_LD },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+
 		if(
-			(ao._op == L"PUSH" && ao._args[0] == L"A") &&
-			(aon1._op == L"LD" && aon1._args[1] == L"A" && (aon1._args[0].front() == L'(' || aon1._args[0].front() == L'[') && aon1._args[0].find(L", SP)") == std::wstring::npos) &&
-			(aon2._op == L"LD" && aon2._args[0] == L"A" && aon2._args[1] == L"(0x1, SP)") &&
-			((aon3._op == L"ADD" || aon3._op == L"ADDW") && aon3._args[0] == L"SP" && aon3._args[1] == L"0x1")
+			(ao._opc == AOC::AOC_PUSH && ao.IsReg(0, AOR::AOR_A)) &&
+			(aon1._opc == AOC::AOC_LD && aon1.IsReg(1, AOR::AOR_A) && (aon1._args[0].front() == L'(' || aon1._args[0].front() == L'[') && aon1._args[0].find(L", SP)") == std::wstring::npos) &&
+			(aon2._opc == AOC::AOC_LD && aon2.IsReg(0, AOR::AOR_A) && aon2.IsIdx(1, AOR::AOR_SP, 0x1)) &&
+			((aon3._opc == AOC::AOC_ADD || aon3._opc == AOC::AOC_ADDW) && aon3.IsReg(0, AOR::AOR_SP) && aon3.IsImm(1, 0x1))
 			)
 		{
 			// PUSH A
@@ -9011,17 +10651,30 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 			del_op(cs, next3);
 			i = del_op(cs, i);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x20014, 3, { AOC::AOC_PUSHW }, { AOC::AOC_LD },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		int n3_size = 0;
+		bool n3_arithm_op = is_arithm_op(aon3, n3_size);
+
 		if(
-			(ao._op == L"PUSHW" && aon1._op == L"LD" && aon1._args[0] == L"A" && aon1._args[1] == L"(0x2, SP)") &&
-			((aon2._op == L"ADD" || aon2._op == L"ADDW") && aon2._args[0] == L"SP") &&
-			(n3_arithm_op || aon3._op == L"RET" || aon3._op == L"RETF")
+			(ao._opc == AOC::AOC_PUSHW && aon1._opc == AOC::AOC_LD && aon1.IsReg(0, AOR::AOR_A) && aon1.IsIdx(1, AOR::AOR_SP, 0x2)) &&
+			((aon2._opc == AOC::AOC_ADD || aon2._opc == AOC::AOC_ADDW) && aon2.IsReg(0, AOR::AOR_SP)) &&
+			(n3_arithm_op || aon3._opc == AOC::AOC_RET || aon3._opc == AOC::AOC_RETF)
 			)
 		{
 			// PUSHW X/Y
@@ -9049,144 +10702,96 @@ C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 				}
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
-			}
-		}
-
-		auto next4 = std::next(next3);
-		if(next4 == cs.end())
-		{
-			i++;
-			continue;
-		}
-
-		auto &aon4 = *static_cast<B1_ASM_OP_STM8 *>(next4->get());
-		if(aon4._is_inline || !aon4.Parse())
-		{
-			i++;
-			continue;
-		}
-
-		auto next5 = std::next(next4);
-		if(next5 == cs.end())
-		{
-			i++;
-			continue;
-		}
-
-		auto &aon5 = *static_cast<B1_ASM_OP_STM8 *>(next5->get());
-		if(aon5._is_inline || !aon5.Parse())
-		{
-			i++;
-			continue;
-		}
-
-		auto next6 = std::next(next5);
-		if(next6 == cs.end())
-		{
-			i++;
-			continue;
+				return true;
+			}
 		}
 
-		auto &aon6 = *static_cast<B1_ASM_OP_STM8 *>(next6->get());
-		if(aon6._is_inline || !aon6.Parse())
-		{
-			i++;
-			continue;
-		}
+		return false;
+	});
+
+	rules.Add(0x20015, 6, { AOC::AOC_LDW }, { AOC::AOC_PUSHW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+		auto &aon5 = *wnd._ops[5];
+		auto next6 = wnd._its[6];
+		auto &aon6 = *wnd._ops[6];
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
 		if (
 			(
-				(ao._op == L"LDW" && ao._args[0] == L"X" && ao._args[1] != L"Y" && ao._args[1] != L"SP" && ao._args[1] != L"(X)" && ao._args[1].find(L", X)") == std::wstring::npos) ||
-				(!ao._volatile && ao._op == L"LDW" && ao._args[1] == L"X" && ao._args[0] != L"Y" && ao._args[0] != L"SP" && ao._args[0] != L"(X)" && ao._args[0].find(L", X)") == std::wstring::npos && ao._args[0] != L"(Y)" && ao._args[0].find(L", Y)") == std::wstring::npos)
+				(ao._opc == AOC::AOC_LDW && ao.IsReg(0, AOR::AOR_X) && !ao.IsReg(1, AOR::AOR_Y) && !ao.IsReg(1, AOR::AOR_SP) && !ao.IsInd(1, AOR::AOR_X) && ao._args[1].find(L", X)") == std::wstring::npos) ||
+				(!ao._volatile && ao._opc == AOC::AOC_LDW && ao.IsReg(1, AOR::AOR_X) && !ao.IsReg(0, AOR::AOR_Y) && !ao.IsReg(0, AOR::AOR_SP) && !ao.IsInd(0, AOR::AOR_X) && ao._args[0].find(L", X)") == std::wstring::npos && !ao.IsInd(0, AOR::AOR_Y) && ao._args[0].find(L", Y)") == std::wstring::npos)
 			) &&
-			(aon1._op == L"PUSHW" && aon1._args[0] == L"X") &&
-			(aon2._op == L"LD" && aon2._args[0] == L"A") &&
-			(aon3._op == L"CLRW" && aon3._args[0] == L"X") &&
-			(aon4._op == L"LD" && aon4._args[0] == L"XL") &&
-			(aon5._op == L"CPW" && aon5._args[0] == L"X" && aon5._args[1] == L"(0x1, SP)") &&
-			((aon6._op == L"ADD" || aon6._op == L"ADDW") && aon6._args[0] == L"SP" && aon6._args[1] == L"0x2")
+			(aon1._opc == AOC::AOC_PUSHW && aon1.IsReg(0, AOR::AOR_X)) &&
+			(aon2._opc == AOC::AOC_LD && aon2.IsReg(0, AOR::AOR_A)) &&
+			(aon3._opc == AOC::AOC_CLRW && aon3.IsReg(0, AOR::AOR_X)) &&
+			(aon4._opc == AOC::AOC_LD && aon4.IsReg(0, AOR::AOR_XL)) &&
+			(aon5._opc == AOC::AOC_CPW && aon5.IsReg(0, AOR::AOR_X) && aon5.IsIdx(1, AOR::AOR_SP, 0x1)) &&
+			((aon6._opc == AOC::AOC_ADD || aon6._opc == AOC::AOC_ADDW) && aon6.IsReg(0, AOR::AOR_SP) && aon6.IsImm(1, 0x2))
 			)
 		{
 			bool no_SP_off = true;
 			auto new_off = correct_SP_offset(aon2._args[1], 2, no_SP_off);
-			if(!no_SP_off && !new_off.empty())
-			{
-				aon2._data = L"LD A, " + new_off;
-				aon2._parsed = false;
-			}
 
-			if(no_SP_off || new_off.empty())
+			if(no_SP_off || !new_off.empty())
 			{
-				aon5._data = L"CPW X, " + (ao._args[0] == L"X" ? ao._args[1] : ao._args[0]);
+				if(!no_SP_off)
+				{
+					aon2._data = L"LD A, " + new_off;
+					aon2._parsed = false;
+				}
+
+				aon5._data = L"CPW X, " + (ao.IsReg(0, AOR::AOR_X) ? ao._args[1] : ao._args[0]);
 				aon5._parsed = false;
 				del_op(cs, next6);
 				del_op(cs, next1);
-				if(ao._args[0] == L"X")
+				if(ao.IsReg(0, AOR::AOR_X))
 				{
 					del_op(cs, i);
 					i = next2;
 				}
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		i++;
-	}
+		return false;
+	});
 
-	return C1_T_ERROR::C1_RES_OK;
+	rules.Compile();
 }
 
-C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
+C1_T_ERROR C1STM8Compiler::Optimize2(bool &changed)
 {
-	auto &cs = *_code_secs.begin();
-	auto i = cs.begin();
-
-	while(i != cs.end())
-	{
-		int32_t rule_id = 0x30000;
-
-		auto &ao = *static_cast<B1_ASM_OP_STM8 *>(i->get());
-
-		if(ao._type == AOT::AOT_LABEL)
-		{
-			_opt_labels[ao._data] = i;
-			i++;
-			continue;
-		}
-
-		if(ao._is_inline || !ao.Parse())
-		{
-			i++;
-			continue;
-		}
+	TRepStage trep_stage("Optimize2");
 
+	return apply_opt_rules(_opt_rules2, changed);
+}
 
-		auto next1 = std::next(i);
-		if(next1 == cs.end())
-		{
-			i++;
-			continue;
-		}
+void C1STM8Compiler::init_opt_rules3()
+{
+	auto &rules = _opt_rules3;
 
-		auto &aon1 = *static_cast<B1_ASM_OP_STM8 *>(next1->get());
-		if(aon1._is_inline || !aon1.Parse())
-		{
-			i++;
-			continue;
-		}
+	rules.Add(0x30001, 1, { AOC::AOC_ADD, AOC::AOC_ADDW, AOC::AOC_SUB, AOC::AOC_SUBW }, { AOC::AOC_LD, AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
 		if (
-			(ao._op == L"ADD" || ao._op == L"ADDW" || ao._op == L"SUB" || ao._op == L"SUBW") && ao._args[0] == L"SP" &&
-			((aon1._op == L"LD" || aon1._op == L"LDW") && aon1._args[0] == L"(0x1, SP)" && (aon1._args[1] == L"A" || aon1._args[1] == L"X"))
+			(ao._opc == AOC::AOC_ADD || ao._opc == AOC::AOC_ADDW || ao._opc == AOC::AOC_SUB || ao._opc == AOC::AOC_SUBW) && ao.IsReg(0, AOR::AOR_SP) &&
+			((aon1._opc == AOC::AOC_LD || aon1._opc == AOC::AOC_LDW) && aon1.IsIdx(0, AOR::AOR_SP, 0x1) && (aon1.IsReg(1, AOR::AOR_A) || aon1.IsReg(1, AOR::AOR_X)))
 			)
 		{
 			// ADDW SP, N
@@ -9194,10 +10799,10 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			// ->
 			// ADDW SP, N + 2
 			// PUSHW X
-			int32_t n, n1 = (aon1._op == L"LD") ? 1 : 2;
+			int32_t n, n1 = (aon1._opc == AOC::AOC_LD) ? 1 : 2;
 			if(Utils::str2int32(ao._args[1], n) == B1_RES_OK)
 			{
-				n += (ao._op == L"ADD" || ao._op == L"ADDW") ? n1 : -n1;
+				n += (ao._opc == AOC::AOC_ADD || ao._opc == AOC::AOC_ADDW) ? n1 : -n1;
 
 				if(n > 0 && n <= 255)
 				{
@@ -9218,12 +10823,12 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 						}
 
 						int32_t isize = 0;
-						if(next_ao->_op == L"CALL" || next_ao->_op == L"CALLR" || next_ao->_op == L"CALLF" || is_arithm_op(*next_ao, isize))
+						if(next_ao->_opc == AOC::AOC_CALL || next_ao->_opc == AOC::AOC_CALLR || next_ao->_opc == AOC::AOC_CALLF || is_arithm_op(*next_ao, isize))
 						{
 							break;
 						}
 
-						if(next_ao->_op == L"PUSH" || next_ao->_op == L"PUSHW" || next_ao->_op == L"LD" || next_ao->_op == L"LDW" || next_ao->_op == L"ADD" || next_ao->_op == L"ADDW" || next_ao->_op == L"SUB" || next_ao->_op == L"SUBW")
+						if(next_ao->_opc == AOC::AOC_PUSH || next_ao->_opc == AOC::AOC_PUSHW || next_ao->_opc == AOC::AOC_LD || next_ao->_opc == AOC::AOC_LDW || next_ao->_opc == AOC::AOC_ADD || next_ao->_opc == AOC::AOC_ADDW || next_ao->_opc == AOC::AOC_SUB || next_ao->_opc == AOC::AOC_SUBW)
 						{
 							continue;
 						}
@@ -9236,22 +10841,30 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					{
 						ao._data = ao._op + L" SP, " + std::to_wstring(n);
 						ao._parsed = false;
-						aon1._data = ((aon1._op == L"LD") ? L"PUSH " : L"PUSHW ") + aon1._args[1];
+						aon1._data = ((aon1._opc == AOC::AOC_LD) ? L"PUSH " : L"PUSHW ") + aon1._args[1];
 						aon1._parsed = false;
 
-						update_opt_rule_usage_stat(rule_id);
 						changed = true;
-						continue;
+						return true;
 					}
 				}
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x30002, 1, { AOC::AOC_CLRW, AOC::AOC_LDW }, { AOC::AOC_SLAW, AOC::AOC_SLLW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+
 		if (
-			((ao._op == L"CLRW" || ao._op == L"LDW") && ao._args[0] == L"X") &&
-			((aon1._op == L"SLLW" || aon1._op == L"SLAW") && aon1._args[0] == L"X")
+			((ao._opc == AOC::AOC_CLRW || ao._opc == AOC::AOC_LDW) && ao.IsReg(0, AOR::AOR_X)) &&
+			((aon1._opc == AOC::AOC_SLLW || aon1._opc == AOC::AOC_SLAW) && aon1.IsReg(0, AOR::AOR_X))
 			)
 		{
 			// CLRW X or LDW X, <imm>
@@ -9262,26 +10875,34 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			// LDW X, <imm> * 2
 			int32_t n = 0;
 
-			bool proceed = (ao._op == L"CLRW" || (Utils::str2int32(ao._args[1], n) == B1_RES_OK && n > 0));
+			bool proceed = (ao._opc == AOC::AOC_CLRW || (Utils::str2int32(ao._args[1], n) == B1_RES_OK && n > 0));
 
 			if(proceed)
 			{
-				if(ao._op != L"CLRW")
+				if(ao._opc != AOC::AOC_CLRW)
 				{
 					ao._data = L"LDW X, " + Utils::str_tohex16(n * 2);
 					ao._parsed = false;
 				}
 				del_op(cs, next1);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if((ao._op == L"CLRW" && aon1._op == L"LDW") && aon1._args[0] == ao._args[0] && aon1._args[1].find(L", X)") != std::wstring::npos)
+		return false;
+	});
+
+	rules.Add(0x30003, 1, { AOC::AOC_CLRW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+
+		if((ao._opc == AOC::AOC_CLRW && aon1._opc == AOC::AOC_LDW) && aon1._args[0] == ao._args[0] && aon1._args[1].find(L", X)") != std::wstring::npos)
 		{
 			// CLRW X
 			// LDW X, ([<smth>], X)
@@ -9301,19 +10922,25 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			aon1._parsed = false;
 			i = del_op(cs, i);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
+		return false;
+	});
+
+	rules.Add(0x30004, 1, { AOC::AOC_LD, AOC::AOC_LDW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
 		bool i_arg0_SP_based = (ao._args.size() != 0 && ao._args[0].find(L", SP)") != std::wstring::npos);
 		bool i_arg1_SP_based = (ao._args.size() > 1 && ao._args[1].find(L", SP)") != std::wstring::npos);
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if((ao._op == L"LD" || ao._op == L"LDW") && !ao._volatile &&
-			ao._args[0] != L"(X)" && ao._args[0].find(L", X)") == std::wstring::npos && ao._args[0] != L"(Y)" && ao._args[0].find(L", Y)") == std::wstring::npos &&
-			ao._args[1] != L"(X)" && ao._args[1].find(L", X)") == std::wstring::npos && ao._args[1] != L"(Y)" && ao._args[1].find(L", Y)") == std::wstring::npos
+		if((ao._opc == AOC::AOC_LD || ao._opc == AOC::AOC_LDW) && !ao._volatile &&
+			!ao.IsInd(0, AOR::AOR_X) && ao._args[0].find(L", X)") == std::wstring::npos && !ao.IsInd(0, AOR::AOR_Y) && ao._args[0].find(L", Y)") == std::wstring::npos &&
+			!ao.IsInd(1, AOR::AOR_X) && ao._args[1].find(L", X)") == std::wstring::npos && !ao.IsInd(1, AOR::AOR_Y) && ao._args[1].find(L", Y)") == std::wstring::npos
 			)
 		{
 			// LD A, smth or LD smth, A
@@ -9347,15 +10974,15 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					break;
 				}
 
-				if(!i_arg0_SP_based && !i_arg1_SP_based && (((next_ao->_op == L"SUB" || next_ao->_op == L"SUBW" || next_ao->_op == L"ADD" || next_ao->_op == L"ADDW") && next_ao->_args[0] == L"SP") || (next_ao->_op == L"PUSH" || next_ao->_op == L"PUSHW")))
+				if(!i_arg0_SP_based && !i_arg1_SP_based && (((next_ao->_opc == AOC::AOC_SUB || next_ao->_opc == AOC::AOC_SUBW || next_ao->_opc == AOC::AOC_ADD || next_ao->_opc == AOC::AOC_ADDW) && next_ao->IsReg(0, AOR::AOR_SP)) || (next_ao->_opc == AOC::AOC_PUSH || next_ao->_opc == AOC::AOC_PUSHW)))
 				{
 					continue;
 				}
-				if(ao._op == L"LDW" && next_ao->_op == L"LD" && next_ao->_args[0] == L"A")
+				if(ao._opc == AOC::AOC_LDW && next_ao->_opc == AOC::AOC_LD && next_ao->IsReg(0, AOR::AOR_A))
 				{
 					continue;
 				}
-				if(ao._op == L"LD" && next_ao->_op == L"LDW" && (next_ao->_args[0] == L"X" || next_ao->_args[0] == L"Y"))
+				if(ao._opc == AOC::AOC_LD && next_ao->_opc == AOC::AOC_LDW && (next_ao->IsReg(0, AOR::AOR_X) || next_ao->IsReg(0, AOR::AOR_Y)))
 				{
 					continue;
 				}
@@ -9363,7 +10990,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				{
 					continue;
 				}
-				if(next_ao->_op == L"CP" || next_ao->_op == L"CPW" || next_ao->_op == L"TNZ" || next_ao->_op == L"TNZW")
+				if(next_ao->_opc == AOC::AOC_CP || next_ao->_opc == AOC::AOC_CPW || next_ao->_opc == AOC::AOC_TNZ || next_ao->_opc == AOC::AOC_TNZW)
 				{
 					continue;
 				}
@@ -9393,13 +11020,13 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 							break;
 						}
 
-						if(next_ao->_op == L"PUSH" || next_ao->_op == L"PUSHW")
+						if(next_ao->_opc == AOC::AOC_PUSH || next_ao->_opc == AOC::AOC_PUSHW)
 						{
 							nextn = std::next(nextn);
 							continue;
 						}
 
-						if(next_ao->_op == L"JREQ" || next_ao->_op == L"JRNE")
+						if(next_ao->_opc == AOC::AOC_JREQ || next_ao->_opc == AOC::AOC_JRNE)
 						{
 							proceed = true;
 							tnz = true;
@@ -9407,9 +11034,9 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 						}
 
 						int32_t size = 0;
-						if (next_ao->_op == L"CALL" || next_ao->_op == L"CALLR" || next_ao->_op == L"CALLF" ||
-							next_ao->_op == L"JRA" || next_ao->_op == L"JP" || next_ao->_op == L"JPF" || next_ao->_op == L"RET" || next_ao->_op == L"RETF" || next_ao->_op == L"IRET" ||
-							next_ao->_op == L"CP" || next_ao->_op == L"CPW" || next_ao->_op == L"TNZ" || next_ao->_op == L"TNZW" ||
+						if (next_ao->_opc == AOC::AOC_CALL || next_ao->_opc == AOC::AOC_CALLR || next_ao->_opc == AOC::AOC_CALLF ||
+							next_ao->_opc == AOC::AOC_JRA || next_ao->_opc == AOC::AOC_JP || next_ao->_opc == AOC::AOC_JPF || next_ao->_opc == AOC::AOC_RET || next_ao->_opc == AOC::AOC_RETF || next_ao->_opc == AOC::AOC_IRET ||
+							next_ao->_opc == AOC::AOC_CP || next_ao->_opc == AOC::AOC_CPW || next_ao->_opc == AOC::AOC_TNZ || next_ao->_opc == AOC::AOC_TNZW ||
 							is_arithm_op(*next_ao, size))
 						{
 							proceed = true;
@@ -9430,7 +11057,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				if(tnz)
 				{
 					auto next_ao = static_cast<B1_ASM_OP_STM8 *>(next->get());
-					next_ao->_data = (ao._op == L"LD") ? L"TNZ A" : L"TNZW X";
+					next_ao->_data = (ao._opc == AOC::AOC_LD) ? L"TNZ A" : L"TNZW X";
 					next_ao->_parsed = false;
 				}
 				else
@@ -9438,17 +11065,26 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					del_op(cs, next);
 				}
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x30005, 1, { AOC::AOC_LD, AOC::AOC_LDW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		bool i_arg0_SP_based = (ao._args.size() != 0 && ao._args[0].find(L", SP)") != std::wstring::npos);
+
 		if(	!ao._volatile &&
-			((ao._op == L"LD" && ao._args[1] == L"A" && !(ao._args[0][0] == L'X' || ao._args[0][0] == L'Y')) || (ao._op == L"LDW" && (ao._args[1] == L"X" || ao._args[1] == L"Y") && !(ao._args[0] == L"X" || ao._args[0] == L"Y" || ao._args[0] == L"SP"))) &&
-			ao._args[0] != L"(X)" && ao._args[0] != L"(Y)" && ao._args[0].find(L", X)") == std::wstring::npos && ao._args[0].find(L", Y)") == std::wstring::npos
+			((ao._opc == AOC::AOC_LD && ao.IsReg(1, AOR::AOR_A) && !(ao._args[0][0] == L'X' || ao._args[0][0] == L'Y')) || (ao._opc == AOC::AOC_LDW && (ao.IsReg(1, AOR::AOR_X) || ao.IsReg(1, AOR::AOR_Y)) && !(ao.IsReg(0, AOR::AOR_X) || ao.IsReg(0, AOR::AOR_Y) || ao.IsReg(0, AOR::AOR_SP)))) &&
+			!ao.IsInd(0, AOR::AOR_X) && !ao.IsInd(0, AOR::AOR_Y) && ao._args[0].find(L", X)") == std::wstring::npos && ao._args[0].find(L", Y)") == std::wstring::npos
 			)
 		{
 			// -LD (smth), A
@@ -9471,25 +11107,25 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					break;
 				}
 
-				if(	next_ao->_op[0] == L'J' || next_ao->_op == L"CALL" || next_ao->_op == L"CALLR" || next_ao->_op == L"CALLF" || next_ao->_op == L"RET" || next_ao->_op == L"RETF" ||
-					next_ao->_op == L"IRET" || next_ao->_op == L"BTJF" || next_ao->_op == L"BTJT")
+				if(	next_ao->_op[0] == L'J' || next_ao->_opc == AOC::AOC_CALL || next_ao->_opc == AOC::AOC_CALLR || next_ao->_opc == AOC::AOC_CALLF || next_ao->_opc == AOC::AOC_RET || next_ao->_opc == AOC::AOC_RETF ||
+					next_ao->_opc == AOC::AOC_IRET || next_ao->_opc == AOC::AOC_BTJF || next_ao->_opc == AOC::AOC_BTJT)
 				{
 					break;
 				}
 
-				if(i_arg0_SP_based && (next_ao->_op == L"PUSH" || next_ao->_op == L"PUSHW" || next_ao->_op == L"POP" || next_ao->_op == L"POPW"))
+				if(i_arg0_SP_based && (next_ao->_opc == AOC::AOC_PUSH || next_ao->_opc == AOC::AOC_PUSHW || next_ao->_opc == AOC::AOC_POP || next_ao->_opc == AOC::AOC_POPW))
 				{
 					break;
 				}
 
-				if(next_ao->_op == L"BCPL" || next_ao->_op == L"BRES" || next_ao->_op == L"BSET" || next_ao->_op == L"BCCM")
+				if(next_ao->_opc == AOC::AOC_BCPL || next_ao->_opc == AOC::AOC_BRES || next_ao->_opc == AOC::AOC_BSET || next_ao->_opc == AOC::AOC_BCCM)
 				{
 					continue;
 				}
 
 				// these instructions can read memory or stack
-				bool next_1arg_op = (next_ao->_op == L"CLR" || next_ao->_op == L"CPL" || next_ao->_op == L"DEC" || next_ao->_op == L"INC" || next_ao->_op == L"NEG" || next_ao->_op == L"RLC" || next_ao->_op == L"RRC" ||
-					next_ao->_op == L"SLL" || next_ao->_op == L"SLA" || next_ao->_op == L"SRA" || next_ao->_op == L"SRL" || next_ao->_op == L"SWAP" || next_ao->_op == L"TNZ");
+				bool next_1arg_op = (next_ao->_opc == AOC::AOC_CLR || next_ao->_opc == AOC::AOC_CPL || next_ao->_opc == AOC::AOC_DEC || next_ao->_opc == AOC::AOC_INC || next_ao->_opc == AOC::AOC_NEG || next_ao->_opc == AOC::AOC_RLC || next_ao->_opc == AOC::AOC_RRC ||
+					next_ao->_opc == AOC::AOC_SLL || next_ao->_opc == AOC::AOC_SLA || next_ao->_opc == AOC::AOC_SRA || next_ao->_opc == AOC::AOC_SRL || next_ao->_opc == AOC::AOC_SWAP || next_ao->_opc == AOC::AOC_TNZ);
 
 				if(i_arg0_SP_based)
 				{
@@ -9529,15 +11165,22 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			{
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(ao._op == L"PUSHW" && ao._args[0] == L"X")
+		return false;
+	});
+
+	rules.Add(0x30006, 1, { AOC::AOC_PUSHW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+
+		if(ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_X))
 		{
 			// PUSHW X
 			// ...       <- these ops should not use Y register and stack
@@ -9560,14 +11203,14 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					break;
 				}
 
-				if(next_ao->_op == L"POPW" && next_ao->_args[0] == L"Y")
+				if(next_ao->_opc == AOC::AOC_POPW && next_ao->IsReg(0, AOR::AOR_Y))
 				{
 					proceed = true;
 					break;
 				}
 
-				if(	next_ao->_op == L"POPW" || next_ao->_op == L"POP" || next_ao->_op == L"PUSHW" || next_ao->_op == L"PUSH" ||
-					next_ao->_op == L"CALLR" || next_ao->_op == L"CALL" || next_ao->_op == L"CALLF" || next_ao->_op == L"RET" || next_ao->_op == L"RETF" || next_ao->_op == L"IRET")
+				if(	next_ao->_opc == AOC::AOC_POPW || next_ao->_opc == AOC::AOC_POP || next_ao->_opc == AOC::AOC_PUSHW || next_ao->_opc == AOC::AOC_PUSH ||
+					next_ao->_opc == AOC::AOC_CALLR || next_ao->_opc == AOC::AOC_CALL || next_ao->_opc == AOC::AOC_CALLF || next_ao->_opc == AOC::AOC_RET || next_ao->_opc == AOC::AOC_RETF || next_ao->_opc == AOC::AOC_IRET)
 				{
 					break;
 				}
@@ -9593,47 +11236,47 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				ao._parsed = false;
 				del_op(cs, next);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if((ao._op == L"JRNC" || ao._op == L"JRPL") && aon1._type == AOT::AOT_LABEL && ao._args[0] == aon1._op)
+		return false;
+	});
+
+	rules.Add(0x30007, 1, { AOC::AOC_JRNC, AOC::AOC_JRPL }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+
+		if((ao._opc == AOC::AOC_JRNC || ao._opc == AOC::AOC_JRPL) && aon1._type == AOT::AOT_LABEL && ao._args[0] == aon1._op)
 		{
 			// -JRNC/JRPL label
 			// -:label
 			del_op(cs, next1);
 			i = del_op(cs, i);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
-		}
-
-
-		auto next2 = std::next(next1);
-		if(next2 == cs.end())
-		{
-			i++;
-			continue;
+			return true;
 		}
 
-		auto &aon2 = *static_cast<B1_ASM_OP_STM8 *>(next2->get());
-		if(aon2._is_inline || !aon2.Parse())
-		{
-			i++;
-			continue;
-		}
+		return false;
+	});
 
-		int n2_size = 0;
-		bool n2_arithm_op = is_arithm_op(aon2, n2_size);
+	rules.Add(0x30008, 2, { AOC::AOC_CLRW }, { AOC::AOC_ADDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if((ao._op == L"CLRW" && aon1._op == L"ADDW") && aon1._args[0] == ao._args[0])
+		if((ao._opc == AOC::AOC_CLRW && aon1._opc == AOC::AOC_ADDW) && aon1._args[0] == ao._args[0])
 		{
 			// CLRW X
 			// ADDW X, <smth>
@@ -9641,7 +11284,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			// LDW X, <smth>
 			ao._data = L"LDW " + aon1._args[0] + L", " + aon1._args[1];
 			ao._parsed = false;
-			if(aon2._op == L"JRNC")
+			if(aon2._opc == AOC::AOC_JRNC)
 			{
 				// 32-bit integer addition
 				aon1._data = L"RCF";
@@ -9652,30 +11295,49 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				del_op(cs, next1);
 			}
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x30009, 2, { AOC::AOC_LDW }, { AOC::AOC_LD },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		int n2_size = 0;
+		bool n2_arithm_op = is_arithm_op(aon2, n2_size);
+
 		if( n2_arithm_op &&
-			(ao._op == L"LDW" && ao._args[0] == L"(0x1, SP)" && ao._args[1] == L"X") &&
-			(aon1._op == L"LD" && aon1._args[0] == L"A" && aon1._args[1] == L"(0x2, SP)")
+			(ao._opc == AOC::AOC_LDW && ao.IsIdx(0, AOR::AOR_SP, 0x1) && ao.IsReg(1, AOR::AOR_X)) &&
+			(aon1._opc == AOC::AOC_LD && aon1.IsReg(0, AOR::AOR_A) && aon1.IsIdx(1, AOR::AOR_SP, 0x2))
 			)
 		{
 			aon1._data = L"LD A, XL";
 			aon1._parsed = false;
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if ((ao._op == L"LDW" && aon1._op == L"POPW" && aon2._op == L"POPW") &&
-			(ao._args[1] == aon1._args[0] && aon1._args[0] == aon2._args[0]) && ao._args[0] == L"(0x3, SP)")
+		return false;
+	});
+
+	rules.Add(0x3000A, 2, { AOC::AOC_LDW }, { AOC::AOC_POPW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+
+		if ((ao._opc == AOC::AOC_LDW && aon1._opc == AOC::AOC_POPW && aon2._opc == AOC::AOC_POPW) &&
+			(ao._args[1] == aon1._args[0] && aon1._args[0] == aon2._args[0]) && ao.IsIdx(0, AOR::AOR_SP, 0x3))
 		{
 			// LDW (3, SP), X
 			// POPW X
@@ -9687,29 +11349,47 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			del_op(cs, next2);
 			del_op(cs, next1);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if ((ao._op == L"CP" || ao._op == L"CPW") && (aon2._op == ao._op) && (ao._args == aon2._args) && (aon1._op.length() > 2 && aon1._op.substr(0, 2) == L"JR"))
+		return false;
+	});
+
+	rules.Add(0x3000B, 2, { AOC::AOC_CP, AOC::AOC_CPW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+
+		if ((ao._opc == AOC::AOC_CP || ao._opc == AOC::AOC_CPW) && (aon2._op == ao._op) && (ao._args == aon2._args) && (aon1._op.length() > 2 && aon1._op.substr(0, 2) == L"JR"))
 		{
 			// CPW X, <smth>
 			// JRXXX <label>
 			// -CPW X, <smth>
 			del_op(cs, next2);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if (ao._op == L"CLRW" && aon1._op == L"LD" && aon1._args[0] == ao._args[0] + L"L" && aon2._op == L"PUSHW" && aon2._args[0] == ao._args[0] &&
-			!is_reg_used_after(next2, cs.cend(), ao._args[0]))
+		return false;
+	});
+
+	rules.Add(0x3000C, 2, { AOC::AOC_CLRW }, { AOC::AOC_LD },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+
+		if (ao._opc == AOC::AOC_CLRW && aon1._opc == AOC::AOC_LD && aon1._args[0] == ao._args[0] + L"L" && aon2._opc == AOC::AOC_PUSHW && aon2._args[0] == ao._args[0] &&
+			!is_reg_live_after(next2, ao.IsReg(0, AOR::AOR_X) ? C1STM8_LIVE_X : C1STM8_LIVE_Y))
 		{
 			// CLRW X or Y
 			// LD XL or YL, A
@@ -9723,14 +11403,23 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			aon1._parsed = false;
 			del_op(cs, next2);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if((ao._op == L"ADDW" || ao._op == L"ADD") && ao._args[0] == L"SP" && ao._args[1] == L"0x2")
+		return false;
+	});
+
+	rules.Add(0x3000D, 2, { AOC::AOC_ADD, AOC::AOC_ADDW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+
+		if((ao._opc == AOC::AOC_ADDW || ao._opc == AOC::AOC_ADD) && ao.IsReg(0, AOR::AOR_SP) && ao.IsImm(1, 0x2))
 		{
 			// ADDW SP, 2
 			// LDW X, smth
@@ -9747,8 +11436,8 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			while(true)
 			{
 				if(
-					((aon->_op == L"LDW" || aon->_op == L"ADDW" || aon->_op == L"LD" || aon->_op == L"ADD" || aon->_op == L"SUB" || aon->_op == L"SUBW") && !(aon->_args[0] == L"SP" || aon->_args[1] == L"SP" || aon->_args[0].find(L", SP)") != std::wstring::npos || aon->_args[1].find(L", SP)") != std::wstring::npos)) ||
-					aon->_op == L"CALL" || aon->_op == L"CALLR" || aon->_op == L"CALLF" || aon->_op == L"SLAW"
+					((aon->_opc == AOC::AOC_LDW || aon->_opc == AOC::AOC_ADDW || aon->_opc == AOC::AOC_LD || aon->_opc == AOC::AOC_ADD || aon->_opc == AOC::AOC_SUB || aon->_opc == AOC::AOC_SUBW) && !(aon->IsReg(0, AOR::AOR_SP) || aon->IsReg(1, AOR::AOR_SP) || aon->_args[0].find(L", SP)") != std::wstring::npos || aon->_args[1].find(L", SP)") != std::wstring::npos)) ||
+					aon->_opc == AOC::AOC_CALL || aon->_opc == AOC::AOC_CALLR || aon->_opc == AOC::AOC_CALLF || aon->_opc == AOC::AOC_SLAW
 					)
 				{
 					next = std::next(next);
@@ -9764,7 +11453,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					continue;
 				}
 
-				if(aon->_op == L"PUSHW")
+				if(aon->_opc == AOC::AOC_PUSHW)
 				{
 					proceed = true;
 				}
@@ -9778,16 +11467,23 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				aon->_parsed = false;
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	ao._op == L"LDW" && ao._args[0] == L"X" && check_label_name(ao._args[1]) &&
-			aon1._op == L"PUSHW" && aon1._args[0] == ao._args[0])
+		return false;
+	});
+
+	rules.Add(0x3000E, 2, { AOC::AOC_LDW }, { AOC::AOC_PUSHW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+
+		if(	ao._opc == AOC::AOC_LDW && ao.IsReg(0, AOR::AOR_X) && check_label_name(ao._args[1]) &&
+			aon1._opc == AOC::AOC_PUSHW && aon1._args[0] == ao._args[0])
 		{
 			// LDW X, __STR_1
 			// PUSHW X
@@ -9807,17 +11503,28 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				ao._data = L"PUSH " + ao._args[1] + L".ll";
 				ao._parsed = false;
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if (!ao._volatile && (ao._op == L"CLRW" || ao._op == L"INCW" || ao._op == L"DECW" || ao._op == L"LDW" || ao._op == L"ADDW" || ao._op == L"SUBW") && ao._args[0] == L"X" && (ao._args.size() == 1 || (ao._args[1] != L"Y" && ao._args[1] != L"SP")) &&
-			!aon1._volatile && (aon1._op == L"CLRW" || aon1._op == L"INCW" || aon1._op == L"DECW" || aon1._op == L"LDW" || aon1._op == L"ADDW" || aon1._op == L"SUBW") && aon1._args[0] == L"Y" &&
-			aon2._op == L"TNZW" && aon2._args[0] == L"X")
+		return false;
+	});
+
+	rules.Add(0x3000F, 2, { AOC::AOC_ADDW, AOC::AOC_CLRW, AOC::AOC_DECW, AOC::AOC_INCW, AOC::AOC_LDW, AOC::AOC_SUBW }, { AOC::AOC_ADDW, AOC::AOC_CLRW, AOC::AOC_DECW, AOC::AOC_INCW, AOC::AOC_LDW, AOC::AOC_SUBW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+
+		if (!ao._volatile && (ao._opc == AOC::AOC_CLRW || ao._opc == AOC::AOC_INCW || ao._opc == AOC::AOC_DECW || ao._opc == AOC::AOC_LDW || ao._opc == AOC::AOC_ADDW || ao._opc == AOC::AOC_SUBW) && ao.IsReg(0, AOR::AOR_X) && (ao._args.size() == 1 || (!ao.IsReg(1, AOR::AOR_Y) && !ao.IsReg(1, AOR::AOR_SP))) &&
+			!aon1._volatile && (aon1._opc == AOC::AOC_CLRW || aon1._opc == AOC::AOC_INCW || aon1._opc == AOC::AOC_DECW || aon1._opc == AOC::AOC_LDW || aon1._opc == AOC::AOC_ADDW || aon1._opc == AOC::AOC_SUBW) && aon1.IsReg(0, AOR::AOR_Y) &&
+			aon2._opc == AOC::AOC_TNZW && aon2.IsReg(0, AOR::AOR_X))
 		{
 			// CLRW/INCW/DECW X or LDW/ADDW/SUBW X, <smth1>
 			// CLRW/INCW/DECW Y or LDW/ADDW/SUBW Y, <smth2>
@@ -9829,14 +11536,22 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			del_op(cs, next2);
 			i = next1;
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(ao._op == L"CLRW" && ao._args[0] == L"Y")
+		return false;
+	});
+
+	rules.Add(0x30010, 2, { AOC::AOC_CLRW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+
+		if(ao._opc == AOC::AOC_CLRW && ao.IsReg(0, AOR::AOR_Y))
 		{
 			// CLRW Y
 			// [PUSH]
@@ -9862,16 +11577,16 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					break;
 				}
 
-				if(aon->_op == L"PUSH")
+				if(aon->_opc == AOC::AOC_PUSH)
 				{
 					continue;
 				}
-				if(pushw_y == cs.cend() && aon->_op == L"PUSHW" && aon->_args[0] == L"Y")
+				if(pushw_y == cs.cend() && aon->_opc == AOC::AOC_PUSHW && aon->IsReg(0, AOR::AOR_Y))
 				{
 					pushw_y = next;
 					continue;
 				}
-				if(pushw_y != cs.cend() && aon->_op == L"LDW" && aon->_args[0] == L"Y")
+				if(pushw_y != cs.cend() && aon->_opc == AOC::AOC_LDW && aon->IsReg(0, AOR::AOR_Y))
 				{
 					proceed = true;
 				}
@@ -9889,18 +11604,25 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				ao->_comment.clear();
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
+		return false;
+	});
+
+	rules.Add(0x30011, 2, {}, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
 		int32_t i_size = 0;
 		bool i_arithm_op = is_arithm_op(ao, i_size);
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(i_arithm_op && !ao._volatile && (ao._args[0] == L"X" || ao._args[0] == L"Y"))
+		if(i_arithm_op && !ao._volatile && (ao.IsReg(0, AOR::AOR_X) || ao.IsReg(0, AOR::AOR_Y)))
 		{
 			// -CLRW/INCW/DECW <reg> or LDW/ADDW/SUBW <reg>, <smth1>
 			// [PUSH,PUSHW,LDW,LD]  <- <reg> is not used here
@@ -9929,36 +11651,28 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			{
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
+		return false;
+	});
 
-		auto next3 = std::next(next2);
-		if(next3 == cs.end())
-		{
-			i++;
-			continue;
-		}
-
-		auto &aon3 = *static_cast<B1_ASM_OP_STM8 *>(next3->get());
-		if(aon3._is_inline || !aon3.Parse())
-		{
-			i++;
-			continue;
-		}
-
+	rules.Add(0x30012, 3, { AOC::AOC_ADD, AOC::AOC_ADDW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
 		int n3_size = 0;
 		bool n3_arithm_op = is_arithm_op(aon3, n3_size);
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if ((ao._op == L"ADD" || ao._op == L"ADDW") && ao._args[0] == L"SP" &&
-			aon1._op == L"LDW" && aon1._args[0] == L"(0x1, SP)" && aon1._args[1] == L"Y" &&
-			aon2._op == L"LDW" && aon2._args[0] == L"(0x3, SP)" && aon2._args[1] == L"X" &&
-			(n3_arithm_op || aon3._op == L"CALL" || aon3._op == L"CALLR" || aon3._op == L"CALLF")
+		if ((ao._opc == AOC::AOC_ADD || ao._opc == AOC::AOC_ADDW) && ao.IsReg(0, AOR::AOR_SP) &&
+			aon1._opc == AOC::AOC_LDW && aon1.IsIdx(0, AOR::AOR_SP, 0x1) && aon1.IsReg(1, AOR::AOR_Y) &&
+			aon2._opc == AOC::AOC_LDW && aon2.IsIdx(0, AOR::AOR_SP, 0x3) && aon2.IsReg(1, AOR::AOR_X) &&
+			(n3_arithm_op || aon3._opc == AOC::AOC_CALL || aon3._opc == AOC::AOC_CALLR || aon3._opc == AOC::AOC_CALLF)
 			)
 		{
 			// ADDW SP, N
@@ -9978,18 +11692,29 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				aon2._data = L"PUSHW Y";
 				aon2._parsed = false;
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	(ao._op == L"PUSHW") &&
-			(aon1._op == L"LD" && aon1._args[0] == L"A" && aon1._args[1] == L"(0x2, SP)") &&
-			(aon2._op == L"LD" && aon2._args[0] == L"(0x3, SP)" && aon2._args[1] == L"A") &&
-			(aon3._op == L"ADD" || aon3._op == L"ADDW") && aon3._args[0] == L"SP" && aon3._args[1] == L"0x2")
+		return false;
+	});
+
+	rules.Add(0x30013, 3, { AOC::AOC_PUSHW }, { AOC::AOC_LD },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+
+		if(	(ao._opc == AOC::AOC_PUSHW) &&
+			(aon1._opc == AOC::AOC_LD && aon1.IsReg(0, AOR::AOR_A) && aon1.IsIdx(1, AOR::AOR_SP, 0x2)) &&
+			(aon2._opc == AOC::AOC_LD && aon2.IsIdx(0, AOR::AOR_SP, 0x3) && aon2.IsReg(1, AOR::AOR_A)) &&
+			(aon3._opc == AOC::AOC_ADD || aon3._opc == AOC::AOC_ADDW) && aon3.IsReg(0, AOR::AOR_SP) && aon3.IsImm(1, 0x2))
 		{
 			ao._data = L"LD A, XL";
 			ao._parsed = false;
@@ -9998,14 +11723,22 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			del_op(cs, next2);
 			del_op(cs, next3);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if((ao._op == L"SUB" || ao._op == L"SUBW") && ao._args[0] == L"SP" && (ao._args[1] == L"0x1" || ao._args[1] == L"0x2" || ao._args[1] == L"0x4"))
+		return false;
+	});
+
+	rules.Add(0x30014, 3, { AOC::AOC_SUB, AOC::AOC_SUBW }, {},
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+
+		if((ao._opc == AOC::AOC_SUB || ao._opc == AOC::AOC_SUBW) && ao.IsReg(0, AOR::AOR_SP) && (ao.IsImm(1, 0x1) || ao.IsImm(1, 0x2) || ao.IsImm(1, 0x4)))
 		{
 			// SUB SP, 1 / 2 / 4													(1) remove
 			// [some LD A, <smth> / LDW X, <smth> / LDW Y, <smth> / PUSH / PUSHW]	(2) correct SP offset
@@ -10044,7 +11777,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					break;
 				}
 
-				if((next_ao->_op == L"LD" || next_ao->_op == L"LDW") && next_ao->_args[0] == L"(0x1, SP)")
+				if((next_ao->_opc == AOC::AOC_LD || next_ao->_opc == AOC::AOC_LDW) && next_ao->IsIdx(0, AOR::AOR_SP, 0x1))
 				{
 					if(stk_off != 0)
 					{
@@ -10052,17 +11785,17 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 						break;
 					}
 
-					if(n == 1 && next_ao->_op == L"LD")
+					if(n == 1 && next_ao->_opc == AOC::AOC_LD)
 					{
 						break;
 					}
 					else
-					if(n == 2 && next_ao->_op == L"LDW")
+					if(n == 2 && next_ao->_opc == AOC::AOC_LDW)
 					{
 						break;
 					}
 					else
-					if(n == 4 && next_ao->_op == L"LDW" && next_ao->_args[1] == L"Y")
+					if(n == 4 && next_ao->_opc == AOC::AOC_LDW && next_ao->IsReg(1, AOR::AOR_Y))
 					{
 						next = std::next(next);
 						if(next == cs.end())
@@ -10084,7 +11817,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 							break;
 						}
 
-						if(!(next_ao1->_op == L"LDW" && next_ao1->_args[0] == L"(0x3, SP)" && next_ao1->_args[1] == L"X"))
+						if(!(next_ao1->_opc == AOC::AOC_LDW && next_ao1->IsIdx(0, AOR::AOR_SP, 0x3) && next_ao1->IsReg(1, AOR::AOR_X)))
 						{
 							proceed = false;
 							break;
@@ -10097,23 +11830,23 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					break;
 				}
 
-				if(next_ao->_op == L"CLR" && next_ao->_args[0] == L"(0x1, SP)")
+				if(next_ao->_opc == AOC::AOC_CLR && next_ao->IsIdx(0, AOR::AOR_SP, 0x1))
 				{
 					proceed = false;
 					break;
 				}
 
-				if(next_ao->_op == L"PUSH" || next_ao->_op == L"PUSHW")
+				if(next_ao->_opc == AOC::AOC_PUSH || next_ao->_opc == AOC::AOC_PUSHW)
 				{
 					stk_off++;
-					if(next_ao->_op == L"PUSHW")
+					if(next_ao->_opc == AOC::AOC_PUSHW)
 					{
 						stk_off++;
 					}
 					continue;
 				}
 
-				if(next_ao->_op == L"CALLR" || next_ao->_op == L"CALL" || next_ao->_op == L"CALLF")
+				if(next_ao->_opc == AOC::AOC_CALLR || next_ao->_opc == AOC::AOC_CALL || next_ao->_opc == AOC::AOC_CALLF)
 				{
 					continue;
 				}
@@ -10145,7 +11878,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					continue;
 				}
 
-				if((next_ao->_op == L"ADD" || next_ao->_op == L"ADDW") && next_ao->_args[0] == L"SP")
+				if((next_ao->_opc == AOC::AOC_ADD || next_ao->_opc == AOC::AOC_ADDW) && next_ao->IsReg(0, AOR::AOR_SP))
 				{
 					int32_t n1 = 0;
 
@@ -10190,13 +11923,13 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					}
 
 					int32_t isize = 0;
-					if(	ao->_op == L"JRA" || ao->_op == L"JP" || ao->_op == L"CALLR" || ao->_op == L"CALL" || ao->_op == L"CALLF" || ao->_op == L"RET" || ao->_op == L"RETF" || ao->_op == L"IRET" ||
+					if(	ao->_opc == AOC::AOC_JRA || ao->_opc == AOC::AOC_JP || ao->_opc == AOC::AOC_CALLR || ao->_opc == AOC::AOC_CALL || ao->_opc == AOC::AOC_CALLF || ao->_opc == AOC::AOC_RET || ao->_opc == AOC::AOC_RETF || ao->_opc == AOC::AOC_IRET ||
 						is_arithm_op(*ao, isize))
 					{
 						break;
 					}
 
-					if(ao->_op == L"PUSH" || ao->_op == L"PUSHW" || ao->_op == L"POP" || ao->_op == L"POPW" || ao->_op == L"LD" || ao->_op == L"LDW" || ao->_op == L"SUB" || ao->_op == L"SUBW" || ao->_op == L"ADD" || ao->_op == L"ADDW")
+					if(ao->_opc == AOC::AOC_PUSH || ao->_opc == AOC::AOC_PUSHW || ao->_opc == AOC::AOC_POP || ao->_opc == AOC::AOC_POPW || ao->_opc == AOC::AOC_LD || ao->_opc == AOC::AOC_LDW || ao->_opc == AOC::AOC_SUB || ao->_opc == AOC::AOC_SUBW || ao->_opc == AOC::AOC_ADD || ao->_opc == AOC::AOC_ADDW)
 					{
 						next++;
 						continue;
@@ -10257,19 +11990,29 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 						next_ao1->_parsed = false;
 					}
 
-					update_opt_rule_usage_stat(rule_id);
 					changed = true;
-					continue;
+					return true;
 				}
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x30015, 3, { AOC::AOC_LDW, AOC::AOC_PUSHW }, { AOC::AOC_PUSH },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+
 		if (
-			((ao._op == L"LDW" && ao._args[0] == L"(0x1, SP)" && ao._args[1] == L"X") || (ao._op == L"PUSHW" && ao._args[0] == L"X")) &&
-			aon1._op == L"PUSH" && aon2._op == L"PUSH" &&
-			(aon3._op == L"LDW" && aon3._args[0] == L"X" && aon3._args[1] == L"(0x3, SP)")
+			((ao._opc == AOC::AOC_LDW && ao.IsIdx(0, AOR::AOR_SP, 0x1) && ao.IsReg(1, AOR::AOR_X)) || (ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_X))) &&
+			aon1._opc == AOC::AOC_PUSH && aon2._opc == AOC::AOC_PUSH &&
+			(aon3._opc == AOC::AOC_LDW && aon3.IsReg(0, AOR::AOR_X) && aon3.IsIdx(1, AOR::AOR_SP, 0x3))
 			)
 		{
 			// LDW (0x1, SP), X
@@ -10282,19 +12025,30 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			// PUSH smth
 
 			del_op(cs, next3);
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x30016, 3, { AOC::AOC_PUSH }, { AOC::AOC_PUSH },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+
 		if (
-			(ao._op == L"PUSH") && (aon1._op == L"PUSH") &&
-			(aon2._op == L"LDW" && aon2._args[0] == L"X" && aon2._args[1] != L"Y" && aon2._args[1] != L"SP" && aon2._args[1].find(L", SP)") == std::wstring::npos) &&
+			(ao._opc == AOC::AOC_PUSH) && (aon1._opc == AOC::AOC_PUSH) &&
+			(aon2._opc == AOC::AOC_LDW && aon2.IsReg(0, AOR::AOR_X) && !aon2.IsReg(1, AOR::AOR_Y) && !aon2.IsReg(1, AOR::AOR_SP) && aon2._args[1].find(L", SP)") == std::wstring::npos) &&
 			(
-				(aon3._op == L"POPW" && aon3._args[0] == L"Y") ||
-				((aon3._op == L"SLAW" || aon3._op == L"SLLW") && aon3._args[0] == L"X")
+				(aon3._opc == AOC::AOC_POPW && aon3.IsReg(0, AOR::AOR_Y)) ||
+				((aon3._opc == AOC::AOC_SLAW || aon3._opc == AOC::AOC_SLLW) && aon3.IsReg(0, AOR::AOR_X))
 			)
 			)
 		{
@@ -10322,7 +12076,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			bool proceed = true;
 			auto next = std::next(next3);
 
-			if(aon3._op != L"POPW")
+			if(aon3._opc != AOC::AOC_POPW)
 			{
 				if(next == cs.end())
 				{
@@ -10335,7 +12089,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					proceed = false;
 				}
 
-				if(aon._op != L"POPW" || aon._args[0] != L"Y")
+				if(aon._opc != AOC::AOC_POPW || !aon.IsReg(0, AOR::AOR_Y))
 				{
 					proceed = false;
 				}
@@ -10346,7 +12100,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				bool A_reg = false;
 				std::wstring imm_val;
 
-				if(ao._args[0] == L"A" && aon1._args[0] == L"0x0")
+				if(ao.IsReg(0, AOR::AOR_A) && aon1.IsImm(0, 0x0))
 				{
 					A_reg = true;
 				}
@@ -10364,7 +12118,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					}
 				}
 				else
-				if(ao._args[0].front() != L'(' && aon1._args[0] == L"0x0")
+				if(ao._args[0].front() != L'(' && aon1.IsImm(0, 0x0))
 				{
 					if(ao._args[0].length() >= 4)
 					{
@@ -10379,7 +12133,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 
 				if(A_reg || !imm_val.empty())
 				{
-					del_op(cs, (aon3._op == L"POPW") ? next3 : next);
+					del_op(cs, (aon3._opc == AOC::AOC_POPW) ? next3 : next);
 					if(A_reg)
 					{
 						ao._data = L"CLRW Y";
@@ -10394,17 +12148,25 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 						del_op(cs, next1);
 					}
 
-					update_opt_rule_usage_stat(rule_id);
 					changed = true;
-					continue;
+					return true;
 				}
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	ao._op == L"PUSH" && ao._args[0] == L"0x0" &&
-			aon1._op == L"PUSH" && aon1._args[0] == L"0x0")
+		return false;
+	});
+
+	rules.Add(0x30017, 3, { AOC::AOC_PUSH }, { AOC::AOC_PUSH },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+
+		if(	ao._opc == AOC::AOC_PUSH && ao.IsImm(0, 0x0) &&
+			aon1._opc == AOC::AOC_PUSH && aon1.IsImm(0, 0x0))
 		{
 			// PUSH 0
 			// PUSH 0
@@ -10429,12 +12191,12 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					break;
 				}
 
-				if(aon->_op == L"PUSH")
+				if(aon->_opc == AOC::AOC_PUSH)
 				{
 					break;
 				}
 
-				if(aon->_op == L"CLRW" && aon->_args[0] == L"X")
+				if(aon->_opc == AOC::AOC_CLRW && aon->IsReg(0, AOR::AOR_X))
 				{
 					proceed = true;
 					break;
@@ -10457,36 +12219,29 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				aon1._parsed = false;
 				del_op(cs, next);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-
-		auto next4 = std::next(next3);
-		if(next4 == cs.end())
-		{
-			i++;
-			continue;
-		}
-
-		auto &aon4 = *static_cast<B1_ASM_OP_STM8 *>(next4->get());
-		if(aon4._is_inline || !aon4.Parse())
-		{
-			i++;
-			continue;
-		}
-
-		int n4_size = 0;
-		bool n4_arithm_op = is_arithm_op(aon4, n4_size);
-
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	(ao._op == L"PUSHW" && ao._args[0] == L"X") && (aon1._op == L"PUSHW" && aon1._args[0] == L"Y") &&
-			(aon2._op == L"LDW" && aon2._args[0] == L"Y") &&
-			(aon3._op == L"LDW" && aon3._args[0] == L"X" && aon3._args[1] != L"Y" && aon3._args[1] != L"SP" && aon3._args[1] != L"(X)" && aon3._args[1].find(L", X)") == std::wstring::npos && aon3._args[1].front() != L'[') &&
-			(aon4._op == L"ADDW" && aon4._args[0] == L"X" && aon4._args[1] == L"(0x3, SP)")
+		return false;
+	});
+
+	rules.Add(0x30018, 4, { AOC::AOC_PUSHW }, { AOC::AOC_PUSHW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		auto next4 = wnd._its[4];
+		auto &aon4 = *wnd._ops[4];
+
+		if(	(ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_X)) && (aon1._opc == AOC::AOC_PUSHW && aon1.IsReg(0, AOR::AOR_Y)) &&
+			(aon2._opc == AOC::AOC_LDW && aon2.IsReg(0, AOR::AOR_Y)) &&
+			(aon3._opc == AOC::AOC_LDW && aon3.IsReg(0, AOR::AOR_X) && !aon3.IsReg(1, AOR::AOR_Y) && !aon3.IsReg(1, AOR::AOR_SP) && !aon3.IsInd(1, AOR::AOR_X) && aon3._args[1].find(L", X)") == std::wstring::npos && aon3._args[1].front() != L'[') &&
+			(aon4._opc == AOC::AOC_ADDW && aon4.IsReg(0, AOR::AOR_X) && aon4.IsIdx(1, AOR::AOR_SP, 0x3))
 			)
 		{
 			// PUSHW X
@@ -10502,19 +12257,32 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			aon3._data = L"ADDW X, " + aon3._args[1];
 			aon3._parsed = false;
 			del_op(cs, next4);
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	(ao._op == L"PUSHW" && ao._args[0] == L"Y") &&
-			(!aon1._volatile && aon1._op == L"LDW" && aon1._args[0] == L"Y" &&
-				(aon1._args[1].find(L", SP)") != std::wstring::npos || ((aon1._args[1][0] != L'(' && aon1._args[1][0] != L'[') && aon1._args[1] != L"X" && aon1._args[1] != L"SP") || (aon1._args[1][0] == L'(' && aon1._args[1] != L"(Y)" && aon1._args[1].find(L", Y)") == std::wstring::npos))) &&
-			(!aon2._volatile && aon2._op == L"LDW" && aon2._args[0] == L"X" && aon2._args[1] != L"Y" && aon2._args[1] != L"SP") &&
-			(aon3._op == L"ADDW" && aon3._args[0] == L"Y" && aon3._args[1] == L"(0x1, SP)") && 
-			(aon4._op == L"ADD" || aon4._op == L"ADDW") && aon4._args[0] == L"SP"
+		return false;
+	});
+
+	rules.Add(0x30019, 4, { AOC::AOC_PUSHW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto next4 = wnd._its[4];
+		auto &aon4 = *wnd._ops[4];
+
+		if(	(ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_Y)) &&
+			(!aon1._volatile && aon1._opc == AOC::AOC_LDW && aon1.IsReg(0, AOR::AOR_Y) &&
+				(aon1._args[1].find(L", SP)") != std::wstring::npos || ((aon1._args[1][0] != L'(' && aon1._args[1][0] != L'[') && !aon1.IsReg(1, AOR::AOR_X) && !aon1.IsReg(1, AOR::AOR_SP)) || (aon1._args[1][0] == L'(' && !aon1.IsInd(1, AOR::AOR_Y) && aon1._args[1].find(L", Y)") == std::wstring::npos))) &&
+			(!aon2._volatile && aon2._opc == AOC::AOC_LDW && aon2.IsReg(0, AOR::AOR_X) && !aon2.IsReg(1, AOR::AOR_Y) && !aon2.IsReg(1, AOR::AOR_SP)) &&
+			(aon3._opc == AOC::AOC_ADDW && aon3.IsReg(0, AOR::AOR_Y) && aon3.IsIdx(1, AOR::AOR_SP, 0x1)) && 
+			(aon4._opc == AOC::AOC_ADD || aon4._opc == AOC::AOC_ADDW) && aon4.IsReg(0, AOR::AOR_SP)
 			)
 		{
 			// PUSHW Y
@@ -10563,20 +12331,35 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				del_op(cs, next3);
 				del_op(cs, next4);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x3001A, 4, { AOC::AOC_PUSHW }, { AOC::AOC_CALL, AOC::AOC_CALLF, AOC::AOC_CALLR },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto next4 = wnd._its[4];
+		auto &aon4 = *wnd._ops[4];
+
 		if(
-			(ao._op == L"PUSHW" && ao._args[0] == L"X") &&
-			((aon1._op == L"CALL" || aon1._op == L"CALLR" || aon1._op == L"CALLF") && aon1._args[0] == L"__LIB_STR_CPY") &&
-			(aon2._op == L"CALL" || aon2._op == L"CALLR" || aon2._op == L"CALLF") &&
-			(aon3._op == L"POPW" && aon3._args[0] == L"X") &&
-			((aon4._op == L"CALL" || aon4._op == L"CALLR" || aon4._op == L"CALLF") && aon4._args[0] == L"__LIB_STR_RLS")
+			(ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_X)) &&
+			((aon1._opc == AOC::AOC_CALL || aon1._opc == AOC::AOC_CALLR || aon1._opc == AOC::AOC_CALLF) && aon1._args[0] == L"__LIB_STR_CPY") &&
+			(aon2._opc == AOC::AOC_CALL || aon2._opc == AOC::AOC_CALLR || aon2._opc == AOC::AOC_CALLF) &&
+			(aon3._opc == AOC::AOC_POPW && aon3.IsReg(0, AOR::AOR_X)) &&
+			((aon4._opc == AOC::AOC_CALL || aon4._opc == AOC::AOC_CALLR || aon4._opc == AOC::AOC_CALLF) && aon4._args[0] == L"__LIB_STR_RLS")
 			)
 		{
 			// PUSHW X
@@ -10592,16 +12375,31 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			del_op(cs, i);
 			i = next2;
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	ao._op == L"PUSHW" && ao._args[0] == L"X" && aon1._op == L"CLRW" && aon1._args[0] == L"Y" && aon2._op == L"LDW" && aon2._args[0] == L"X" && aon2._args[1] == L"(0x1, SP)" &&
-			(aon3._op == L"ADD" || aon3._op == L"ADDW") && aon3._args[0] == L"SP" && aon3._args[1] == L"0x2" &&
-			(n4_arithm_op || aon4._op == L"RET" || aon4._op == L"RETF" || aon4._op == L"CALLR" || aon4._op == L"CALL" || aon4._op == L"CALLF")
+		return false;
+	});
+
+	rules.Add(0x3001B, 4, { AOC::AOC_PUSHW }, { AOC::AOC_CLRW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+		int n4_size = 0;
+		bool n4_arithm_op = is_arithm_op(aon4, n4_size);
+
+		if(	ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_X) && aon1._opc == AOC::AOC_CLRW && aon1.IsReg(0, AOR::AOR_Y) && aon2._opc == AOC::AOC_LDW && aon2.IsReg(0, AOR::AOR_X) && aon2.IsIdx(1, AOR::AOR_SP, 0x1) &&
+			(aon3._opc == AOC::AOC_ADD || aon3._opc == AOC::AOC_ADDW) && aon3.IsReg(0, AOR::AOR_SP) && aon3.IsImm(1, 0x2) &&
+			(n4_arithm_op || aon4._opc == AOC::AOC_RET || aon4._opc == AOC::AOC_RETF || aon4._opc == AOC::AOC_CALLR || aon4._opc == AOC::AOC_CALL || aon4._opc == AOC::AOC_CALLF)
 			)
 		{
 			// PUSHW X
@@ -10615,24 +12413,35 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			i = del_op(cs, i);
 			del_op(cs, next2);
 			del_op(cs, next3);
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x3001C, 4, { AOC::AOC_CLRW, AOC::AOC_LDW }, { AOC::AOC_LD, AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		auto next4 = wnd._its[4];
+
 		if ((
-				((!ao._volatile && !ao._is_inline && ((ao._op == L"LDW" && ao._args[0] == L"Y" && ao._args[1] != L"(Y)" && ao._args[1].find(L", Y)") == std::wstring::npos && ao._args[1] != L"X") || (ao._op == L"CLRW" && ao._args[0] == L"Y"))) &&
-				(!aon1._volatile && !aon1._is_inline && aon1._op == L"LDW" && aon1._args[0] == L"X")) ||
-				((ao._op == L"CLRW" && ao._args[0] == L"X") && (aon1._op == L"LD" && aon1._args[0] == L"XL"))
+				((!ao._volatile && !ao._is_inline && ((ao._opc == AOC::AOC_LDW && ao.IsReg(0, AOR::AOR_Y) && !ao.IsInd(1, AOR::AOR_Y) && ao._args[1].find(L", Y)") == std::wstring::npos && !ao.IsReg(1, AOR::AOR_X)) || (ao._opc == AOC::AOC_CLRW && ao.IsReg(0, AOR::AOR_Y)))) &&
+				(!aon1._volatile && !aon1._is_inline && aon1._opc == AOC::AOC_LDW && aon1.IsReg(0, AOR::AOR_X))) ||
+				((ao._opc == AOC::AOC_CLRW && ao.IsReg(0, AOR::AOR_X)) && (aon1._opc == AOC::AOC_LD && aon1.IsReg(0, AOR::AOR_XL)))
 			)
 			&&
 			(
-				((aon2._op == L"PUSHW" && aon2._args[0] == L"X") && (aon3._op == L"PUSHW" && aon3._args[0] == L"Y")) ||
+				((aon2._opc == AOC::AOC_PUSHW && aon2.IsReg(0, AOR::AOR_X)) && (aon3._opc == AOC::AOC_PUSHW && aon3.IsReg(0, AOR::AOR_Y))) ||
 				(
-					(!aon2._volatile && !aon2._is_inline && aon2._op == L"LDW" && aon2._args[1] == L"Y" && aon2._args[0] != L"(X)" && aon2._args[0].find(L", X)") == std::wstring::npos && aon2._args[0] != L"X") &&
-					(!aon3._volatile && !aon3._is_inline && aon3._op == L"LDW" && aon3._args[1] == L"X" && aon3._args[0] != L"(Y)" && aon3._args[0].find(L", Y)") == std::wstring::npos && aon3._args[0] != L"Y")
+					(!aon2._volatile && !aon2._is_inline && aon2._opc == AOC::AOC_LDW && aon2.IsReg(1, AOR::AOR_Y) && !aon2.IsInd(0, AOR::AOR_X) && aon2._args[0].find(L", X)") == std::wstring::npos && !aon2.IsReg(0, AOR::AOR_X)) &&
+					(!aon3._volatile && !aon3._is_inline && aon3._opc == AOC::AOC_LDW && aon3.IsReg(1, AOR::AOR_X) && !aon3.IsInd(0, AOR::AOR_Y) && aon3._args[0].find(L", Y)") == std::wstring::npos && !aon3.IsReg(0, AOR::AOR_Y))
 				)
 			))
 		{
@@ -10656,9 +12465,9 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			bool no_SP_off = true;
 			std::wstring new_off;
 
-			if(aon1._op == L"LD")
+			if(aon1._opc == AOC::AOC_LD)
 			{
-				if(i == cs.begin() || aon2._op == L"PUSHW")
+				if(i == cs.begin() || aon2._opc == AOC::AOC_PUSHW)
 				{
 					proceed = false;
 				}
@@ -10666,14 +12475,14 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				{
 					auto pr_it = std::prev(i);
 					auto &pr = *static_cast<B1_ASM_OP_STM8 *>(pr_it->get());
-					if(!pr._parsed || pr._op != L"CLRW" || pr._args[0] != L"Y")
+					if(!pr._parsed || pr._opc != AOC::AOC_CLRW || !pr.IsReg(0, AOR::AOR_Y))
 					{
 						proceed = false;
 					}
 				}
 			}
 			else
-			if(ao._op == L"LDW")
+			if(ao._opc == AOC::AOC_LDW)
 			{
 				new_off = correct_SP_offset(ao._args[1], -2, no_SP_off);
 				if(!no_SP_off && new_off.empty())
@@ -10702,13 +12511,13 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 						break;
 					}
 
-					if(next_ao->_op.front() == L'J' || next_ao->_op == L"CALL" || next_ao->_op == L"CALLR" || next_ao->_op == L"CALLF" || next_ao->_op == L"RET" || next_ao->_op == L"IRET" || next_ao->_op == L"TRAP")
+					if(next_ao->_op.front() == L'J' || next_ao->_opc == AOC::AOC_CALL || next_ao->_opc == AOC::AOC_CALLR || next_ao->_opc == AOC::AOC_CALLF || next_ao->_opc == AOC::AOC_RET || next_ao->_opc == AOC::AOC_IRET || next_ao->_opc == AOC::AOC_TRAP)
 					{
 						proceed = false;
 						break;
 					}
 
-					if((next_ao->_op == L"LDW" && next_ao->_args[0] == L"Y" && next_ao->_args[1] != L"(Y)" && next_ao->_args[1].find(L", Y)") == std::wstring::npos) || (next_ao->_op == L"CLRW" && next_ao->_args[0] == L"Y"))
+					if((next_ao->_opc == AOC::AOC_LDW && next_ao->IsReg(0, AOR::AOR_Y) && !next_ao->IsInd(1, AOR::AOR_Y) && next_ao->_args[1].find(L", Y)") == std::wstring::npos) || (next_ao->_opc == AOC::AOC_CLRW && next_ao->IsReg(0, AOR::AOR_Y)))
 					{
 						auto nexti1 = std::next(nexti);
 
@@ -10731,7 +12540,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 							break;
 						}
 
-						if(!(next_aon1->_op == L"LDW" && next_aon1->_args[0] == L"X"))
+						if(!(next_aon1->_opc == AOC::AOC_LDW && next_aon1->IsReg(0, AOR::AOR_X)))
 						{
 							proceed = false;
 						}
@@ -10751,7 +12560,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 
 			if(proceed)
 			{
-				if(aon1._op == L"LD")
+				if(aon1._opc == AOC::AOC_LD)
 				{
 					aon1._data = L"LDW " + aon2._args[0] + L", X";
 					aon1._parsed = false;
@@ -10760,13 +12569,13 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					del_op(cs, std::prev(i));
 				}
 				else
-				if(aon2._op == L"PUSHW")
+				if(aon2._opc == AOC::AOC_PUSHW)
 				{
 					ao._data = aon1._data;
 					ao._parsed = false;
 					aon1._data = L"PUSHW X";
 					aon1._parsed = false;
-					aon2._data = (ao._op == L"LDW") ? (L"LDW X, " + (no_SP_off ? ao._args[1] : new_off)) : L"CLRW X";
+					aon2._data = (ao._opc == AOC::AOC_LDW) ? (L"LDW X, " + (no_SP_off ? ao._args[1] : new_off)) : L"CLRW X";
 					aon2._parsed = false;
 					aon3._data = L"PUSHW X";
 					aon3._parsed = false;
@@ -10777,26 +12586,41 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					ao._parsed = false;
 					aon1._data = aon3._data;
 					aon1._parsed = false;
-					aon2._data = (ao._op == L"LDW") ? L"LDW X, " + ao._args[1] : L"CLRW X";
+					aon2._data = (ao._opc == AOC::AOC_LDW) ? L"LDW X, " + ao._args[1] : L"CLRW X";
 					aon2._parsed = false;
 					aon3._data = L"LDW " + aon2._args[0] + L", X";
 					aon3._parsed = false;
 				}
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x3001D, 4, { AOC::AOC_ADDW, AOC::AOC_RCF, AOC::AOC_SUBW }, { AOC::AOC_JRNC },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto next4 = wnd._its[4];
+		auto &aon4 = *wnd._ops[4];
+
 		if (
-			(ao._op == L"RCF" || ((ao._op == L"ADDW" || ao._op == L"SUBW") && ao._args[0] == L"X" && aon4._op == L"RCF")) &&
-			aon1._op == L"JRNC" &&
-			(aon2._op == L"INCW" || aon2._op == L"DECW") && aon2._args[0] == L"Y" &&
+			(ao._opc == AOC::AOC_RCF || ((ao._opc == AOC::AOC_ADDW || ao._opc == AOC::AOC_SUBW) && ao.IsReg(0, AOR::AOR_X) && aon4._opc == AOC::AOC_RCF)) &&
+			aon1._opc == AOC::AOC_JRNC &&
+			(aon2._opc == AOC::AOC_INCW || aon2._opc == AOC::AOC_DECW) && aon2.IsReg(0, AOR::AOR_Y) &&
 			aon3._type == AOT::AOT_LABEL && aon3._op == aon1._args[0] &&
-			(aon4._op == L"RCF" || (((aon4._op == L"ADDW" || aon4._op == L"SUBW") || aon4._op == L"INCW" || aon4._op == L"DECW") && aon4._args[0] == L"Y"))
+			(aon4._opc == AOC::AOC_RCF || (((aon4._opc == AOC::AOC_ADDW || aon4._opc == AOC::AOC_SUBW) || aon4._opc == AOC::AOC_INCW || aon4._opc == AOC::AOC_DECW) && aon4.IsReg(0, AOR::AOR_Y)))
 			)
 		{
 			// RCF or ADDW X, smth1
@@ -10814,47 +12638,46 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			// or
 			// remove all
 			auto next = std::next(next4);
-			if(aon4._op == L"RCF")
+			if(aon4._opc == AOC::AOC_RCF)
 			{
 				del_op(cs, next4);
 			}
-			if(ao._op == L"RCF")
+			if(ao._opc == AOC::AOC_RCF)
 			{
 				del_op(cs, next3);
 				del_op(cs, next2);
-				del_op(cs, next1);
-				del_op(cs, i);
-			}
-			i = next;
-
-			update_opt_rule_usage_stat(rule_id);
-			changed = true;
-			continue;
-		}
-
-
-		auto next5 = std::next(next4);
-		if(next5 == cs.end())
-		{
-			i++;
-			continue;
-		}
+				del_op(cs, next1);
+				del_op(cs, i);
+			}
+			i = next;
 
-		auto &aon5 = *static_cast<B1_ASM_OP_STM8 *>(next5->get());
-		if(aon5._is_inline || !aon5.Parse())
-		{
-			i++;
-			continue;
+			changed = true;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	((ao._op == L"PUSH" && ao._args[0] != L"A" && ao._args[0] != L"CC" && ao._args[0][0] != L'(' && aon1._op == L"PUSH" && aon1._args[0] != L"A" && aon1._args[0] != L"CC" && aon1._args[0][0] != L'(') ||
-			(ao._op == L"CLRW" && ao._args[0] == L"X" && aon1._op == L"PUSHW" && aon1._args[0] == L"X")) &&
-			(aon2._op == L"LDW" && aon2._args[0] == L"Y" && aon2._args[1] != L"X" && aon2._args[1] != L"SP") &&
-			(aon3._op == L"LDW" && aon3._args[0] == L"X" && aon3._args[1] == L"(0x3, SP)") &&
-			(aon4._op == L"ADDW" && aon4._args[0] == L"Y" && aon4._args[1] == L"(0x1, SP)") &&
-			(aon5._op == L"ADD" || aon5._op == L"ADDW") && aon5._args[0] == L"SP"
+		return false;
+	});
+
+	rules.Add(0x3001E, 5, { AOC::AOC_CLRW, AOC::AOC_PUSH }, { AOC::AOC_PUSH, AOC::AOC_PUSHW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto next4 = wnd._its[4];
+		auto &aon4 = *wnd._ops[4];
+		auto next5 = wnd._its[5];
+		auto &aon5 = *wnd._ops[5];
+
+		if(	((ao._opc == AOC::AOC_PUSH && !ao.IsReg(0, AOR::AOR_A) && !ao.IsReg(0, AOR::AOR_CC) && ao._args[0][0] != L'(' && aon1._opc == AOC::AOC_PUSH && !aon1.IsReg(0, AOR::AOR_A) && !aon1.IsReg(0, AOR::AOR_CC) && aon1._args[0][0] != L'(') ||
+			(ao._opc == AOC::AOC_CLRW && ao.IsReg(0, AOR::AOR_X) && aon1._opc == AOC::AOC_PUSHW && aon1.IsReg(0, AOR::AOR_X))) &&
+			(aon2._opc == AOC::AOC_LDW && aon2.IsReg(0, AOR::AOR_Y) && !aon2.IsReg(1, AOR::AOR_X) && !aon2.IsReg(1, AOR::AOR_SP)) &&
+			(aon3._opc == AOC::AOC_LDW && aon3.IsReg(0, AOR::AOR_X) && aon3.IsIdx(1, AOR::AOR_SP, 0x3)) &&
+			(aon4._opc == AOC::AOC_ADDW && aon4.IsReg(0, AOR::AOR_Y) && aon4.IsIdx(1, AOR::AOR_SP, 0x1)) &&
+			(aon5._opc == AOC::AOC_ADD || aon5._opc == AOC::AOC_ADDW) && aon5.IsReg(0, AOR::AOR_SP)
 			)
 		{
 			// PUSH 0 or CLRW X
@@ -10871,7 +12694,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			bool proceed = true;
 			int32_t n1 = 0, n2 = 0;
 
-			if(ao._op == L"PUSH")
+			if(ao._opc == AOC::AOC_PUSH)
 			{
 				if(Utils::str2int32(ao._args[0], n1) != B1_RES_OK)
 				{
@@ -10910,23 +12733,35 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				del_op(cs, next4);
 				del_op(cs, next5);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
+		return false;
+	});
+
+	rules.Add(0x3001F, 5, { AOC::AOC_PUSH }, { AOC::AOC_PUSH },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto next4 = wnd._its[4];
+		auto &aon4 = *wnd._ops[4];
+		auto &aon5 = *wnd._ops[5];
 		int n5_size = 0;
 		bool n5_arithm_op = is_arithm_op(aon5, n5_size);
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	(ao._op == L"PUSH" && ao._args[0] == L"A") &&
-			(aon1._op == L"PUSH" && aon1._args[0] == L"0x0") &&
-			(aon2._op == L"LDW" && aon2._args[0] == L"Y" && aon2._args[1] != L"SP") &&
-			(aon3._op == L"LDW" && aon3._args[0] == L"X" && aon3._args[1] == L"(0x1, SP)") &&
-			(aon4._op == L"ADD" || aon4._op == L"ADDW") && aon4._args[0] == L"SP" &&
-			(n5_arithm_op || aon5._op == L"RET" || aon5._op == L"RETF" || aon5._op == L"CALLR" || aon5._op == L"CALL" || aon5._op == L"CALLF")
+		if(	(ao._opc == AOC::AOC_PUSH && ao.IsReg(0, AOR::AOR_A)) &&
+			(aon1._opc == AOC::AOC_PUSH && aon1.IsImm(0, 0x0)) &&
+			(aon2._opc == AOC::AOC_LDW && aon2.IsReg(0, AOR::AOR_Y) && !aon2.IsReg(1, AOR::AOR_SP)) &&
+			(aon3._opc == AOC::AOC_LDW && aon3.IsReg(0, AOR::AOR_X) && aon3.IsIdx(1, AOR::AOR_SP, 0x1)) &&
+			(aon4._opc == AOC::AOC_ADD || aon4._opc == AOC::AOC_ADDW) && aon4.IsReg(0, AOR::AOR_SP) &&
+			(n5_arithm_op || aon5._opc == AOC::AOC_RET || aon5._opc == AOC::AOC_RETF || aon5._opc == AOC::AOC_CALLR || aon5._opc == AOC::AOC_CALL || aon5._opc == AOC::AOC_CALLF)
 			)
 		{
 			// PUSH A
@@ -10967,20 +12802,32 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				}
 				del_op(cs, next4);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x30020, 5, { AOC::AOC_PUSH }, { AOC::AOC_CLRW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		auto next4 = wnd._its[4];
+		auto &aon4 = *wnd._ops[4];
+
 		if (
-			(ao._op == L"PUSH" && ao._args[0] == L"A") &&
-			(aon1._op == L"CLRW" && aon1._args[0] == L"X") &&
-			(aon2._op == L"LD" && aon2._args[0] == L"XL") &&
-			(aon3._op == L"LDW" && aon3._args[0] == L"(0x2, SP)" && aon3._args[1] == L"X") &&
-			(((aon4._op == L"ADD" || aon4._op == L"ADDW") && aon4._args[0] == L"SP" && aon4._args[1] == L"0x1") || (aon4._op == L"POP" && aon4._args[0] == L"A"))
+			(ao._opc == AOC::AOC_PUSH && ao.IsReg(0, AOR::AOR_A)) &&
+			(aon1._opc == AOC::AOC_CLRW && aon1.IsReg(0, AOR::AOR_X)) &&
+			(aon2._opc == AOC::AOC_LD && aon2.IsReg(0, AOR::AOR_XL)) &&
+			(aon3._opc == AOC::AOC_LDW && aon3.IsIdx(0, AOR::AOR_SP, 0x2) && aon3.IsReg(1, AOR::AOR_X)) &&
+			(((aon4._opc == AOC::AOC_ADD || aon4._opc == AOC::AOC_ADDW) && aon4.IsReg(0, AOR::AOR_SP) && aon4.IsImm(1, 0x1)) || (aon4._opc == AOC::AOC_POP && aon4.IsReg(0, AOR::AOR_A)))
 			)
 		{
 			aon3._data = L"LDW (0x1, SP), X";
@@ -10988,19 +12835,33 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			del_op(cs, next4);
 			i = del_op(cs, i);
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	(ao._op == L"PUSHW" && ao._args[0] == L"X") &&
-			(aon1._op == L"LDW" && aon1._args[0] == L"X" && aon1._args[1] != L"Y" && aon1._args[1] != L"SP") &&
-			(aon2._op == L"CPW" && aon2._args[0] == L"X" && aon2._args[1] == L"(0x1, SP)") &&
-			((aon3._op == L"ADDW" || aon3._op == L"ADD") && aon3._args[0] == L"SP" && aon3._args[1] == L"0x2") &&
-			((aon4._op == L"JRNE" || aon4._op == L"JREQ")) &&
-			((aon5._op == L"LDW" || aon5._op == L"CLRW") && aon5._args[0] == L"X")
+		return false;
+	});
+
+	rules.Add(0x30021, 5, { AOC::AOC_PUSHW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+		auto &aon5 = *wnd._ops[5];
+
+		if(	(ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_X)) &&
+			(aon1._opc == AOC::AOC_LDW && aon1.IsReg(0, AOR::AOR_X) && !aon1.IsReg(1, AOR::AOR_Y) && !aon1.IsReg(1, AOR::AOR_SP)) &&
+			(aon2._opc == AOC::AOC_CPW && aon2.IsReg(0, AOR::AOR_X) && aon2.IsIdx(1, AOR::AOR_SP, 0x1)) &&
+			((aon3._opc == AOC::AOC_ADDW || aon3._opc == AOC::AOC_ADD) && aon3.IsReg(0, AOR::AOR_SP) && aon3.IsImm(1, 0x2)) &&
+			((aon4._opc == AOC::AOC_JRNE || aon4._opc == AOC::AOC_JREQ)) &&
+			((aon5._opc == AOC::AOC_LDW || aon5._opc == AOC::AOC_CLRW) && aon5.IsReg(0, AOR::AOR_X))
 			)
 		{
 			// PUSHW X
@@ -11016,20 +12877,32 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			del_op(cs, next1);
 			del_op(cs, next2);
 			del_op(cs, next3);
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x30022, 5, { AOC::AOC_PUSHW }, { AOC::AOC_LD },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+		auto next5 = wnd._its[5];
+		auto &aon5 = *wnd._ops[5];
+
 		if(
-			(ao._op == L"PUSHW" && ao._args[0] == L"X") &&
-			(aon1._op == L"LD" && aon1._args[0] == L"A" && aon1._args[1][0] == L'(') &&
-			(aon2._op == L"CLRW" && aon2._args[0] == L"X") &&
-			(aon3._op == L"LD" && aon3._args[0] == L"XL") &&
-			(aon4._op == L"ADDW" && aon4._args[0] == L"X" && aon4._args[1] == L"(0x1, SP)") &&
-			((aon5._op == L"ADDW" || aon5._op == L"ADD") && aon5._args[0] == L"SP" && aon5._args[1] == L"0x2")
+			(ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_X)) &&
+			(aon1._opc == AOC::AOC_LD && aon1.IsReg(0, AOR::AOR_A) && aon1._args[1][0] == L'(') &&
+			(aon2._opc == AOC::AOC_CLRW && aon2.IsReg(0, AOR::AOR_X)) &&
+			(aon3._opc == AOC::AOC_LD && aon3.IsReg(0, AOR::AOR_XL)) &&
+			(aon4._opc == AOC::AOC_ADDW && aon4.IsReg(0, AOR::AOR_X) && aon4.IsIdx(1, AOR::AOR_SP, 0x1)) &&
+			((aon5._opc == AOC::AOC_ADDW || aon5._opc == AOC::AOC_ADD) && aon5.IsReg(0, AOR::AOR_SP) && aon5.IsImm(1, 0x2))
 			)
 		{
 			// PUSHW X
@@ -11059,20 +12932,34 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			aon4._parsed = false;
 			del_op(cs, next5);
 			
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x30023, 5, { AOC::AOC_LD }, { AOC::AOC_PUSH },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+		auto &aon5 = *wnd._ops[5];
+
 		if (
-			(!ao._volatile && ao._op == L"LD" && ao._args[0] == L"A" && ao._args[1] != L"XL" && ao._args[1] != L"XH") &&
-			(aon1._op == L"PUSH" && aon1._args[0] == L"A") &&
-			(!aon2._volatile && aon2._op == L"LD" && aon2._args[0] == L"A") &&
-			(aon3._op == L"CLRW" && aon3._args[0] == L"X") &&
-			(aon4._op == L"LD" && aon4._args[0] == L"XL") &&
-			(aon5._op == L"POP" && aon5._args[0] == L"A")
+			(!ao._volatile && ao._opc == AOC::AOC_LD && ao.IsReg(0, AOR::AOR_A) && !ao.IsReg(1, AOR::AOR_XL) && !ao.IsReg(1, AOR::AOR_XH)) &&
+			(aon1._opc == AOC::AOC_PUSH && aon1.IsReg(0, AOR::AOR_A)) &&
+			(!aon2._volatile && aon2._opc == AOC::AOC_LD && aon2.IsReg(0, AOR::AOR_A)) &&
+			(aon3._opc == AOC::AOC_CLRW && aon3.IsReg(0, AOR::AOR_X)) &&
+			(aon4._opc == AOC::AOC_LD && aon4.IsReg(0, AOR::AOR_XL)) &&
+			(aon5._opc == AOC::AOC_POP && aon5.IsReg(0, AOR::AOR_A))
 			)
 		{
 			// LD A, smth1 (not XL and XH)
@@ -11102,16 +12989,26 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				del_op(cs, i);
 				i = next2;
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	(ao._op == L"LD" && ao._args[0] == L"(0x1, SP)") &&
-			(aon1._op == L"JRA") &&
+		return false;
+	});
+
+	rules.Add(0x30024, 5, { AOC::AOC_LD }, { AOC::AOC_JRA, AOC::AOC_JRA },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto next4 = wnd._its[4];
+
+		if(	(ao._opc == AOC::AOC_LD && ao.IsIdx(0, AOR::AOR_SP, 0x1)) &&
+			(aon1._opc == AOC::AOC_JRA) &&
 			(aon2._type == AOT::AOT_LABEL)
 			)
 		{
@@ -11138,7 +13035,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					break;
 				}
 
-				if(next_ao->_op == L"LD" && next_ao->_args[0] == L"(0x1, SP)")
+				if(next_ao->_opc == AOC::AOC_LD && next_ao->IsIdx(0, AOR::AOR_SP, 0x1))
 				{
 					if(!ld1sp)
 					{
@@ -11147,7 +13044,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					continue;
 				}
 
-				if(next_ao->_op == L"LD" || next_ao->_op == L"LDW")
+				if(next_ao->_opc == AOC::AOC_LD || next_ao->_opc == AOC::AOC_LDW)
 				{
 					continue;
 				}
@@ -11168,16 +13065,26 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				cs.splice(std::prev(nexti), cs, nexti);
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	(ao._op == L"LDW" && ao._args[0] == L"(0x1, SP)" && ao._args[1] == L"X") &&
-			(aon1._op == L"JRA") &&
+		return false;
+	});
+
+	rules.Add(0x30025, 5, { AOC::AOC_LDW }, { AOC::AOC_JRA, AOC::AOC_JRA },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto next4 = wnd._its[4];
+
+		if(	(ao._opc == AOC::AOC_LDW && ao.IsIdx(0, AOR::AOR_SP, 0x1) && ao.IsReg(1, AOR::AOR_X)) &&
+			(aon1._opc == AOC::AOC_JRA) &&
 			(aon2._type == AOT::AOT_LABEL)
 			)
 		{
@@ -11204,7 +13111,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					break;
 				}
 
-				if(next_ao->_op == L"LDW" && next_ao->_args[0] == L"(0x1, SP)" && next_ao->_args[1] == L"X")
+				if(next_ao->_opc == AOC::AOC_LDW && next_ao->IsIdx(0, AOR::AOR_SP, 0x1) && next_ao->IsReg(1, AOR::AOR_X))
 				{
 					if(!ld1sp)
 					{
@@ -11213,7 +13120,7 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 					continue;
 				}
 
-				if(next_ao->_op == L"LD" || next_ao->_op == L"LDW")
+				if(next_ao->_opc == AOC::AOC_LD || next_ao->_opc == AOC::AOC_LDW)
 				{
 					continue;
 				}
@@ -11234,35 +13141,34 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				cs.splice(std::prev(nexti), cs, nexti);
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		auto next6 = std::next(next5);
-		if(next6 == cs.end())
-		{
-			i++;
-			continue;
-		}
-
-		auto &aon6 = *static_cast<B1_ASM_OP_STM8 *>(next6->get());
-		if(aon6._is_inline || !aon6.Parse())
-		{
-			i++;
-			continue;
-		}
-
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	(ao._op == L"PUSHW" && ao._args[0] == L"Y") &&
-			(aon1._op == L"LDW" && aon1._args[0] == L"Y" && aon1._args[1] != L"X" && aon1._args[1] != L"SP" && aon1._args[1] != L"(Y)" && aon1._args[1].find(L", Y)") == std::wstring::npos && aon1._args[1].front() != L'[') &&
-			(aon2._op == L"ADDW" && aon2._args[0] == L"X") &&
-			(aon3._op == L"JRNC") &&
-			(aon4._op == L"INCW" && aon4._args[0] == L"Y") &&
+		return false;
+	});
+
+	rules.Add(0x30026, 6, { AOC::AOC_PUSHW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+		auto &aon5 = *wnd._ops[5];
+		auto next6 = wnd._its[6];
+		auto &aon6 = *wnd._ops[6];
+
+		if(	(ao._opc == AOC::AOC_PUSHW && ao.IsReg(0, AOR::AOR_Y)) &&
+			(aon1._opc == AOC::AOC_LDW && aon1.IsReg(0, AOR::AOR_Y) && !aon1.IsReg(1, AOR::AOR_X) && !aon1.IsReg(1, AOR::AOR_SP) && !aon1.IsInd(1, AOR::AOR_Y) && aon1._args[1].find(L", Y)") == std::wstring::npos && aon1._args[1].front() != L'[') &&
+			(aon2._opc == AOC::AOC_ADDW && aon2.IsReg(0, AOR::AOR_X)) &&
+			(aon3._opc == AOC::AOC_JRNC) &&
+			(aon4._opc == AOC::AOC_INCW && aon4.IsReg(0, AOR::AOR_Y)) &&
 			(aon5._type == AOT::AOT_LABEL && aon5._op == aon3._args[0]) &&
-			(aon6._op == L"ADDW" && aon6._args[0] == L"Y" && aon6._args[1] == L"(0x1, SP)")
+			(aon6._opc == AOC::AOC_ADDW && aon6.IsReg(0, AOR::AOR_Y) && aon6.IsIdx(1, AOR::AOR_SP, 0x1))
 			)
 		{
 			// PUSHW Y
@@ -11282,20 +13188,34 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			aon1._data = L"ADDW Y, " + aon1._args[1];
 			aon1._parsed = false;
 			del_op(cs, next6);
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
-		if(	(ao._op == L"PUSHW") &&
-			(aon1._op == L"ADDW" && aon1._args[0] == L"Y") &&
-			(aon2._op == L"ADDW" && aon2._args[0] == L"X") &&
-			(aon3._op == L"JRNC") &&
-			(aon4._op == L"INCW" && aon4._args[0] == L"Y") &&
+		return false;
+	});
+
+	rules.Add(0x30027, 6, { AOC::AOC_PUSHW }, { AOC::AOC_ADDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+		auto &aon5 = *wnd._ops[5];
+		auto next6 = wnd._its[6];
+		auto &aon6 = *wnd._ops[6];
+
+		if(	(ao._opc == AOC::AOC_PUSHW) &&
+			(aon1._opc == AOC::AOC_ADDW && aon1.IsReg(0, AOR::AOR_Y)) &&
+			(aon2._opc == AOC::AOC_ADDW && aon2.IsReg(0, AOR::AOR_X)) &&
+			(aon3._opc == AOC::AOC_JRNC) &&
+			(aon4._opc == AOC::AOC_INCW && aon4.IsReg(0, AOR::AOR_Y)) &&
 			(aon5._type == AOT::AOT_LABEL && aon5._op == aon3._args[0]) &&
-			((aon6._op == L"ADDW" || aon6._op == L"ADD") && aon6._args[0] == L"SP")
+			((aon6._opc == AOC::AOC_ADDW || aon6._opc == AOC::AOC_ADD) && aon6.IsReg(0, AOR::AOR_SP))
 			)
 		{
 			// PUSHW X or Y
@@ -11343,22 +13263,37 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				}
 				i = del_op(cs, i);
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x30028, 6, { AOC::AOC_POPW }, { AOC::AOC_LDW },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+		auto &aon5 = *wnd._ops[5];
+		auto &aon6 = *wnd._ops[6];
+
 		if(
-			(ao._op == L"POPW" && ao._args[0] == L"X") &&
-			(aon1._op == L"LDW" && aon1._args[0] == L"X" && (aon1._args[1] == L"(X)" || aon1._args[1].find(L", X)") != std::wstring::npos)) &&
-			(aon2._op == L"PUSHW" && aon2._args[0] == L"X") &&
-			(aon3._op == L"LDW" && aon3._args[0] == L"X" && aon3._args[1].front() == L'(') &&
-			((aon4._op == L"CALL" || aon4._op == L"CALLR" || aon4._op == L"CALLF") && aon4._args[0] == L"__LIB_STR_RLS") &&
-			(aon5._op == L"POPW" && aon5._args[0] == L"X") &&
-			(aon6._op == L"LDW" && aon6._args[1] == L"X" && aon6._args[0] == aon3._args[1])
+			(ao._opc == AOC::AOC_POPW && ao.IsReg(0, AOR::AOR_X)) &&
+			(aon1._opc == AOC::AOC_LDW && aon1.IsReg(0, AOR::AOR_X) && (aon1.IsInd(1, AOR::AOR_X) || aon1._args[1].find(L", X)") != std::wstring::npos)) &&
+			(aon2._opc == AOC::AOC_PUSHW && aon2.IsReg(0, AOR::AOR_X)) &&
+			(aon3._opc == AOC::AOC_LDW && aon3.IsReg(0, AOR::AOR_X) && aon3._args[1].front() == L'(') &&
+			((aon4._opc == AOC::AOC_CALL || aon4._opc == AOC::AOC_CALLR || aon4._opc == AOC::AOC_CALLF) && aon4._args[0] == L"__LIB_STR_RLS") &&
+			(aon5._opc == AOC::AOC_POPW && aon5.IsReg(0, AOR::AOR_X)) &&
+			(aon6._opc == AOC::AOC_LDW && aon6.IsReg(1, AOR::AOR_X) && aon6._args[0] == aon3._args[1])
 			)
 		{
 			// POPW X
@@ -11386,21 +13321,36 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			del_op(cs, i);
 			i = next2;
 			
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x30029, 6, { AOC::AOC_LD }, { AOC::AOC_PUSH },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &i = wnd._its[0];
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto next2 = wnd._its[2];
+		auto &aon2 = *wnd._ops[2];
+		auto &aon3 = *wnd._ops[3];
+		auto &aon4 = *wnd._ops[4];
+		auto &aon5 = *wnd._ops[5];
+		auto &aon6 = *wnd._ops[6];
+
 		if(
-			(ao._op == L"LD" && ao._args[0] == L"A" && ao._args[1] == L"(0x1, SP)") &&
-			(aon1._op == L"PUSH" && aon1._args[0] == L"A") &&
-			(aon2._op == L"PUSH" && aon2._args[0] == L"0x0") &&
-			(aon3._op == L"LDW" && aon3._args[0] == L"X") &&
-			(aon4._op == L"CPW" && aon4._args[0] == L"X" && aon4._args[1] == L"(0x1, SP)") &&
-			((aon5._op == L"ADD" || aon5._op == L"ADDW") && aon5._args[0] == L"SP" && aon5._args[1] == L"0x2") &&
-			(aon6._op[0] == L'J' && aon6._op[1] == L'R')
+			(ao._opc == AOC::AOC_LD && ao.IsReg(0, AOR::AOR_A) && ao.IsIdx(1, AOR::AOR_SP, 0x1)) &&
+			(aon1._opc == AOC::AOC_PUSH && aon1.IsReg(0, AOR::AOR_A)) &&
+			(aon2._opc == AOC::AOC_PUSH && aon2.IsImm(0, 0x0)) &&
+			(aon3._opc == AOC::AOC_LDW && aon3.IsReg(0, AOR::AOR_X)) &&
+			(aon4._opc == AOC::AOC_CPW && aon4.IsReg(0, AOR::AOR_X) && aon4.IsIdx(1, AOR::AOR_SP, 0x1)) &&
+			((aon5._opc == AOC::AOC_ADD || aon5._opc == AOC::AOC_ADDW) && aon5.IsReg(0, AOR::AOR_SP) && aon5.IsImm(1, 0x2)) &&
+			aon6.IsRelJump()
 		)
 		{
 			// LD A, (1, SP)
@@ -11434,22 +13384,38 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 				del_op(cs, i);
 				i = next2;
 
-				update_opt_rule_usage_stat(rule_id);
 				changed = true;
-				continue;
+				return true;
 			}
 		}
 
-		rule_id++;
-		update_opt_rule_usage_stat(rule_id, true);
+		return false;
+	});
+
+	rules.Add(0x3002A, 6, { AOC::AOC_LDW }, { AOC::AOC_CALL, AOC::AOC_CALLF, AOC::AOC_CALLR },
+	[this](C1STM8_OPT_WND &wnd, bool &changed) -> bool
+	{
+		auto &cs = wnd._cs;
+		auto &ao = *wnd._ops[0];
+		auto next1 = wnd._its[1];
+		auto &aon1 = *wnd._ops[1];
+		auto &aon2 = *wnd._ops[2];
+		auto next3 = wnd._its[3];
+		auto &aon3 = *wnd._ops[3];
+		auto next4 = wnd._its[4];
+		auto &aon4 = *wnd._ops[4];
+		auto next5 = wnd._its[5];
+		auto &aon5 = *wnd._ops[5];
+		auto &aon6 = *wnd._ops[6];
+
 		if(
-			(ao._op == L"LDW" && ao._args[0] == L"X") &&
-			((aon1._op == L"CALL" || aon1._op == L"CALLR" || aon1._op == L"CALLF") && aon1._args[0] == L"__LIB_STR_CPY") &&
-			(aon2._op == L"CALL" || aon2._op == L"CALLR" || aon2._op == L"CALLF") &&
-			(aon3._op == L"LDW" && aon3._args[0] == L"(0x1, SP)" && aon3._args[1] == L"X") &&
-			(aon4._op == L"LDW" && aon4._args[0] == L"X" && ao._args[1] == aon4._args[1]) &&
-			((aon5._op == L"CALL" || aon5._op == L"CALLR" || aon5._op == L"CALLF") && aon5._args[0] == L"__LIB_STR_RLS") &&
-			(aon6._op == L"POPW" && aon6._args[0] == L"X")
+			(ao._opc == AOC::AOC_LDW && ao.IsReg(0, AOR::AOR_X)) &&
+			((aon1._opc == AOC::AOC_CALL || aon1._opc == AOC::AOC_CALLR || aon1._opc == AOC::AOC_CALLF) && aon1._args[0] == L"__LIB_STR_CPY") &&
+			(aon2._opc == AOC::AOC_CALL || aon2._opc == AOC::AOC_CALLR || aon2._opc == AOC::AOC_CALLF) &&
+			(aon3._opc == AOC::AOC_LDW && aon3.IsIdx(0, AOR::AOR_SP, 0x1) && aon3.IsReg(1, AOR::AOR_X)) &&
+			(aon4._opc == AOC::AOC_LDW && aon4.IsReg(0, AOR::AOR_X) && ao._args[1] == aon4._args[1]) &&
+			((aon5._opc == AOC::AOC_CALL || aon5._opc == AOC::AOC_CALLR || aon5._opc == AOC::AOC_CALLF) && aon5._args[0] == L"__LIB_STR_RLS") &&
+			(aon6._opc == AOC::AOC_POPW && aon6.IsReg(0, AOR::AOR_X))
 			)
 		{
 			// LDW X, (NS1::__VAR_S4_S)
@@ -11471,20 +13437,27 @@ C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
 			aon6._data = L"ADDW SP, 2";
 			aon6._parsed = false;
 
-			update_opt_rule_usage_stat(rule_id);
 			changed = true;
-			continue;
+			return true;
 		}
 
+		return false;
+	});
 
-		i++;
-	}
+	rules.Compile();
+}
 
-	return C1_T_ERROR::C1_RES_OK;
+C1_T_ERROR C1STM8Compiler::Optimize3(bool &changed)
+{
+	TRepStage trep_stage("Optimize3");
+
+	return apply_opt_rules(_opt_rules3, changed);
 }
 
 C1_T_ERROR C1STM8Compiler::Save(const std::string &file_name, bool overwrite_existing /*= true*/)
 {
+	TRepStage trep_stage("Save");
+
 	std::FILE *ofs = std::fopen(file_name.c_str(), overwrite_existing ? "w" : "a");
 	if(ofs == nullptr)
 	{
@@ -11541,7 +13514,11 @@ static int optimize(C1STM8Compiler &c1stm8, const std::string &opt_log_file_name
 		}
 	}
 
+	// the optimizer passes check only the instructions queued after changes made nearby, the changes affecting
+	// distant instructions (e.g. register usage analysis following jumps) are not tracked, so when the passes
+	// become stable all the instructions are queued and checked once more
 	bool changed = true;
+	bool full = true;
 
 	while(changed)
 	{
@@ -11603,6 +13580,27 @@ static int optimize(C1STM8Compiler &c1stm8, const std::string &opt_log_file_name
 				changed = true;
 			}
 		}
+
+		// the dead loads sweep walks the whole code section, so it is done once per round: the instructions
+		// it changes are queued for the next round
+		bool changed_dl = false;
+		c1stm8.RemoveDeadLoads(changed_dl);
+		if(changed_dl)
+		{
+			changed = true;
+		}
+
+		if(changed)
+		{
+			full = false;
+		}
+		else
+		if(!full)
+		{
+			c1stm8.QueueOptAll();
+			full = true;
+			changed = true;
+		}
 	}
 
 	if(!opt_log_file_name.empty())
@@ -11620,8 +13618,46 @@ static int optimize(C1STM8Compiler &c1stm8, const std::string &opt_log_file_name
 	return retcode;
 }
 
+// returns compiler version and options the compiled library modules depend on (library modules cache key)
+static std::string c1stm8_get_cache_opts(const std::string &MCU_name, bool out_src_lines, bool opt_nocheck)
+{
+	std::string opts = std::string(B1_PROJECT_NAME) + " " + version;
+#ifdef B1_GIT_REVISION
+	opts += std::string(" ") + B1_GIT_REVISION;
+#endif
+
+	opts += "|" + MCU_name;
+
+	// MCU settings files
+	for(const auto &ext: { ".cfg", ".io" })
+	{
+		uint64_t hash = 0;
+		auto file_name = _global_settings.GetLibFileName(MCU_name, ext);
+		if(!file_name.empty() && Utils::file_hash(file_name, hash))
+		{
+			opts += "|" + std::to_string(hash);
+		}
+		else
+		{
+			opts += "|-";
+		}
+	}
+
+	opts += "|" + std::to_string(_global_settings.GetMemModelSmall());
+	opts += "|" + std::to_string(_global_settings.GetRetAddressSize());
+	opts += "|" + std::to_string(_global_settings.GetFixRetStackPtr());
+	opts += "|" + std::to_string(_global_settings.GetRAMStart()) + "," + std::to_string(_global_settings.GetRAMSize());
+	opts += "|" + std::to_string(_global_settings.GetROMStart()) + "," + std::to_string(_global_settings.GetROMSize());
+	opts += "|" + std::to_string(_global_settings.GetStackSize()) + "," + std::to_string(_global_settings.GetHeapSize());
+	opts += "|" + std::to_string(b1_opt_explicit_val) + "," + std::to_string(b1_opt_base_val);
+	opts += "|" + std::to_string(opt_nocheck) + "," + std::to_string(out_src_lines);
+	opts += "|" + std::to_string(sizeof(wchar_t));
+
+	return opts;
+}
+
 
-int main(int argc, char** argv)
+static int c1stm8_main(int argc, char **argv)
 {
 	int i;
 	int retcode = 0;
@@ -11639,7 +13675,11 @@ int main(int argc, char** argv)
 	int32_t heap_size = -1;
 	bool opt_nocheck = false;
 	std::string opt_log_file_name;
-	std::string args;
+	std::string cache_dir;
+	std::string arc_lib_dir;
+	bool time_report = false;
+	std::string time_report_json;
+	std::vector<std::string> args;
 
 
 	// use current locale
@@ -11649,13 +13689,74 @@ int main(int argc, char** argv)
 	// options
 	for(i = 1; i < argc; i++)
 	{
+		// library modules cache directory
+		if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == "CACHE")
+		{
+			if(i == argc - 1)
+			{
+				args_error = true;
+				args_error_txt = "missing cache directory";
+			}
+			else
+			{
+				i++;
+				cache_dir = argv[i];
+			}
+
+			continue;
+		}
+
+		// create library archive
+		if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == "MKLIB")
+		{
+			if(i == argc - 1)
+			{
+				args_error = true;
+				args_error_txt = "missing library directory";
+			}
+			else
+			{
+				i++;
+				arc_lib_dir = argv[i];
+			}
+
+			continue;
+		}
+
+		// print compilation stages time and memory usage report
+		if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == "TIME-REPORT")
+		{
+			time_report = true;
+			args.push_back("-time-report");
+			continue;
+		}
+
+		// write compilation stages time and memory usage report in JSON format
+		if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == "TIME-REPORT-JSON")
+		{
+			if(i == argc - 1)
+			{
+				args_error = true;
+				args_error_txt = "missing report file name";
+			}
+			else
+			{
+				i++;
+				time_report_json = argv[i];
+				args.push_back("-time-report-json");
+				args.push_back(argv[i]);
+			}
+
+			continue;
+		}
+
 		// print error description
 		if ((argv[i][0] == '-' || argv[i][0] == '/') &&
 			(argv[i][1] == 'D' || argv[i][1] == 'd') &&
 			argv[i][2] == 0)
 		{
 			print_err_desc = true;
-			args = args + " -d";
+			args.push_back("-d");
 
 			continue;
 		}
@@ -11713,7 +13814,8 @@ int main(int argc, char** argv)
 			{
 				i++;
 				lib_dir = argv[i];
-				args = args + " -l " + argv[i];
+				args.push_back("-l");
+				args.push_back(argv[i]);
 			}
 
 			continue;
@@ -11733,7 +13835,8 @@ int main(int argc, char** argv)
 			{
 				i++;
 				MCU_name = get_MCU_config_name(argv[i]);
-				args = args + " -m " + MCU_name;
+				args.push_back("-m");
+				args.push_back(MCU_name);
 			}
 
 			continue;
@@ -11754,7 +13857,7 @@ int main(int argc, char** argv)
 				_global_settings.SetMemModelLarge();
 			}
 
-			args = args + " " + argv[i];
+			args.push_back(argv[i]);
 			continue;
 		}
 
@@ -11764,7 +13867,7 @@ int main(int argc, char** argv)
 			(argv[i][2] == 'U' || argv[i][2] == 'u') &&
 			argv[i][3] == 0)
 		{
-			args = args + " -mu";
+			args.push_back("-mu");
 			continue;
 		}
 
@@ -11887,7 +13990,8 @@ int main(int argc, char** argv)
 					args_error_txt = "wrong RAM size";
 				}
 				_global_settings.SetRAMSize(n);
-				args = args + " -ram_size " + argv[i];
+				args.push_back("-ram_size");
+				args.push_back(argv[i]);
 			}
 
 			continue;
@@ -11914,7 +14018,8 @@ int main(int argc, char** argv)
 					args_error_txt = "wrong RAM starting address";
 				}
 				_global_settings.SetRAMStart(n);
-				args = args + " -ram_start " + argv[i];
+				args.push_back("-ram_start");
+				args.push_back(argv[i]);
 			}
 
 			continue;
@@ -11941,7 +14046,8 @@ int main(int argc, char** argv)
 					args_error_txt = "wrong ROM size";
 				}
 				_global_settings.SetROMSize(n);
-				args = args + " -rom_size " + argv[i];
+				args.push_back("-rom_size");
+				args.push_back(argv[i]);
 			}
 
 			continue;
@@ -11968,7 +14074,8 @@ int main(int argc, char** argv)
 					args_error_txt = "wrong ROM starting address";
 				}
 				_global_settings.SetROMStart(n);
-				args = args + " -rom_start " + argv[i];
+				args.push_back("-rom_start");
+				args.push_back(argv[i]);
 			}
 
 			continue;
@@ -12059,7 +14166,7 @@ int main(int argc, char** argv)
 		args_error_txt = "invalid target";
 	}
 
-	if((args_error || i == argc) && !(print_version))
+	if((args_error || (i == argc && arc_lib_dir.empty())) && !(print_version))
 	{
 		c1stm8_print_version(stderr);
 		if(args_error)
@@ -12076,14 +14183,18 @@ int main(int argc, char** argv)
 		std::fputs(B1_PROJECT_NAME, stderr);
 		std::fputs(" [options] filename\n", stderr);
 		std::fputs("options:\n", stderr);
+		std::fputs("-cache or /cache - library modules cache directory, e.g. -cache /tmp/c1stm8.cache\n", stderr);
+		std::fputs("-client or /client - send the command line to compile server (the first option only), e.g. -client /tmp/c1stm8.sock\n", stderr);
 		std::fputs("-d or /d - print error description\n", stderr);
 		std::fputs("-hs or /hs - set heap size (in bytes), e.g. -hs 1024\n", stderr);
 		std::fputs("-l or /l - libraries directory, e.g. -l \"../lib\"\n", stderr);
 		std::fputs("-m or /m - specify MCU name, e.g. -m STM8S103F3\n", stderr);
+		std::fputs("-mklib or /mklib - create library archive from the files of the specified library directory, e.g. -mklib ../lib/STM8\n", stderr);
 		std::fputs("-ml or /ml - set large memory model\n", stderr);
 		std::fputs("-ms or /ms - set small memory model (default)\n", stderr);
 		std::fputs("-mu or /mu - print memory usage\n", stderr);
 		std::fputs("-na or /na - don't run assembler\n", stderr);
+		std::fputs("-next-server or /next-server - send assembler command lines to its compile server (with -server option only), e.g. -next-server /tmp/a1stm8.sock\n", stderr);
 		std::fputs("-no or /no - disable optimizations\n", stderr);
 		std::fputs("-o or /o - output file name, e.g.: -o out.asm\n", stderr);
 		std::fputs("-op or /op - specify option (EXPLICIT, BASE1 or NOCHECK), e.g. -op NOCHECK\n", stderr);
@@ -12092,8 +14203,11 @@ int main(int argc, char** argv)
 		std::fputs("-rom_size or /rom_size - specify ROM size, e.g.: -rom_size 0x2000\n", stderr);
 		std::fputs("-rom_start or /rom_start - specify ROM starting address, e.g.: -rom_start 0x8000\n", stderr);
 		std::fputs("-s or /s - output source lines\n", stderr);
+		std::fputs("-server or /server - run compile server on a local socket (the first option only), e.g. -server /tmp/c1stm8.sock\n", stderr);
 		std::fputs("-ss or /ss - set stack size (in bytes), e.g. -ss 256\n", stderr);
 		std::fputs("-t or /t - set target (default STM8), e.g.: -t STM8\n", stderr);
+		std::fputs("-time-report or /time-report - print compilation stages time and memory usage report\n", stderr);
+		std::fputs("-time-report-json or /time-report-json - append compilation stages time and memory usage report in JSON format to the file, e.g. -time-report-json report.json\n", stderr);
 		std::fputs("-v or /v - show compiler version\n", stderr);
 		return 1;
 	}
@@ -12106,6 +14220,31 @@ int main(int argc, char** argv)
 		return 0;
 	}
 
+	if(time_report || !time_report_json.empty())
+	{
+		trep_enable();
+	}
+
+	if(!arc_lib_dir.empty())
+	{
+		// just create library archive and stop executing (the compiler converts the library files to binary form)
+		C1STM8Compiler c1stm8(false, opt_nocheck);
+		std::string err_file_name;
+		auto err = arc_create(arc_lib_dir,
+			[&c1stm8](const std::string &file_name, std::vector<char> &data, int32_t &lines_num)
+			{
+				return static_cast<B1_T_ERROR>(c1stm8.ConvertLibFile(file_name, data, lines_num));
+			},
+			err_file_name);
+		if(err != B1_RES_OK)
+		{
+			c1_print_error(static_cast<C1_T_ERROR>(err), -1, err_file_name, print_err_desc);
+			return 29;
+		}
+
+		return 0;
+	}
+
 
 	// list of source files
 	std::vector<std::string> src_files;
@@ -12204,6 +14343,11 @@ int main(int argc, char** argv)
 
 	C1STM8Compiler c1stm8(out_src_lines, opt_nocheck);
 
+	if(!cache_dir.empty())
+	{
+		c1stm8.SetCacheDir(cache_dir, c1stm8_get_cache_opts(MCU_name, out_src_lines, opt_nocheck));
+	}
+
 	std::set<std::wstring> undef;
 	std::set<std::wstring> resolved;
 	
@@ -12219,31 +14363,55 @@ int main(int argc, char** argv)
 
 	while(true)
 	{
-		auto err = c1stm8.Load(src_files);
-		if(err != C1_T_ERROR::C1_RES_OK)
-		{
-			c1_print_warnings(c1stm8.GetWarnings());
-			c1_print_error(err, c1stm8.GetCurrLineNum(), c1stm8.GetCurrFileName(), print_err_desc);
-			retcode = 4;
-			break;
-		}
+		bool cached = false;
 
-		err = c1stm8.Compile();
-		if(err != C1_T_ERROR::C1_RES_OK)
+		// library modules can be taken from cache
+		if(!first_run)
 		{
-			c1_print_warnings(c1stm8.GetWarnings());
-			c1_print_error(err, c1stm8.GetCurrLineNum(), c1stm8.GetCurrFileName(), print_err_desc);
-			retcode = 5;
-			break;
+			auto err = c1stm8.LoadCached(src_files[0], code_init, code_init ? -1 : 0, cached);
+			if(err != C1_T_ERROR::C1_RES_OK)
+			{
+				c1_print_warnings(c1stm8.GetWarnings());
+				c1_print_error(err, c1stm8.GetCurrLineNum(), c1stm8.GetCurrFileName(), print_err_desc);
+				retcode = 6;
+				break;
+			}
 		}
 
-		err = c1stm8.WriteCode(code_init, code_init ? -1 : 0);
-		if(err != C1_T_ERROR::C1_RES_OK)
+		if(!cached)
 		{
-			c1_print_warnings(c1stm8.GetWarnings());
-			c1_print_error(err, c1stm8.GetCurrLineNum(), c1stm8.GetCurrFileName(), print_err_desc);
-			retcode = 6;
-			break;
+			auto err = c1stm8.Load(src_files);
+			if(err != C1_T_ERROR::C1_RES_OK)
+			{
+				c1_print_warnings(c1stm8.GetWarnings());
+				c1_print_error(err, c1stm8.GetCurrLineNum(), c1stm8.GetCurrFileName(), print_err_desc);
+				retcode = 4;
+				break;
+			}
+
+			err = c1stm8.Compile();
+			if(err != C1_T_ERROR::C1_RES_OK)
+			{
+				c1_print_warnings(c1stm8.GetWarnings());
+				c1_print_error(err, c1stm8.GetCurrLineNum(), c1stm8.GetCurrFileName(), print_err_desc);
+				retcode = 5;
+				break;
+			}
+
+			err = c1stm8.WriteCode(code_init, code_init ? -1 : 0);
+			if(err != C1_T_ERROR::C1_RES_OK)
+			{
+				c1_print_warnings(c1stm8.GetWarnings());
+				c1_print_error(err, c1stm8.GetCurrLineNum(), c1stm8.GetCurrFileName(), print_err_desc);
+				retcode = 6;
+				break;
+			}
+
+			if(!first_run)
+			{
+				// failure to write cache file is not a compilation error
+				c1stm8.SaveCached(src_files[0], code_init);
+			}
 		}
 
 		if(first_run)
@@ -12262,7 +14430,7 @@ int main(int argc, char** argv)
 
 		c1stm8.AddFunctionsSymbols();
 
-		err = c1stm8.GetUndefinedSymbols(undef);
+		auto err = c1stm8.GetUndefinedSymbols(undef);
 		if(err != C1_T_ERROR::C1_RES_OK)
 		{
 			c1_print_warnings(c1stm8.GetWarnings());
@@ -12406,6 +14574,16 @@ int main(int argc, char** argv)
 
 	c1_print_warnings(c1stm8.GetWarnings());
 
+	if(time_report)
+	{
+		trep_print(stderr);
+	}
+
+	if(!time_report_json.empty() && !trep_write_json(time_report_json))
+	{
+		std::perror("fail");
+	}
+
 	if(!no_asm)
 	{
 		std::fputs("running assembler...\n", stdout);
@@ -12423,7 +14601,18 @@ int main(int argc, char** argv)
 			cwd.clear();
 		}
 
-		int sc = std::system((cwd + "a1stm8" + args + " -f " + ofn).c_str());
+		args.push_back("-f");
+		args.push_back(ofn);
+
+#ifdef A1STM8_BUILTIN
+		// the built-in assembler runs if the next stage compile server is not available, it writes its own
+		// time report (the compiler's one is already written)
+		trep_push("a1stm8");
+		int sc = srv_run_next_stage(cwd + "a1stm8", args, a1stm8_main);
+		trep_pop();
+#else
+		int sc = srv_run_next_stage(cwd + "a1stm8", args);
+#endif
 		if(sc == -1)
 		{
 			std::perror("fail");
@@ -12433,3 +14622,92 @@ int main(int argc, char** argv)
 
 	return retcode;
 }
+
+// loads settings of the MCU specified in the request command line to keep them resident in compile server
+static int c1stm8_warm_up(int argc, char **argv)
+{
+	const auto MCU_name = get_MCU_config_name(srv_get_opt_value(argc, argv, "M"));
+	if(MCU_name.empty())
+	{
+		return 0;
+	}
+
+	STM8Settings settings;
+
+	settings.SetTargetName("STM8");
+	settings.SetMCUName(MCU_name);
+	settings.SetLibDirRoot(srv_get_opt_value(argc, argv, "L"));
+	settings.InitLibDirs();
+
+	auto file_name = settings.GetLibFileName(MCU_name, ".cfg");
+	if(!file_name.empty())
+	{
+		settings.Read(file_name);
+	}
+
+	settings.InitLibDirs();
+
+	file_name = settings.GetLibFileName(MCU_name, ".io");
+	if(!file_name.empty())
+	{
+		settings.ReadIoSettings(file_name);
+	}
+
+#ifdef A1STM8_BUILTIN
+	return a1stm8_warm_up(argc, argv);
+#else
+	return 0;
+#endif
+}
+
+int main(int argc, char **argv)
+{
+	// compile server mode options should go first
+	if(argc > 2 && (argv[1][0] == '-' || argv[1][0] == '/'))
+	{
+		const auto opt = Utils::str_toupper(std::string(argv[1] + 1));
+
+		// run compile server
+		if(opt == "SERVER")
+		{
+#ifdef A1STM8_BUILTIN
+			// initialize the built-in assembler instructions map once for all requests
+			a1stm8_load_instructions();
+#endif
+
+			Settings::EnableFileCache();
+
+			if(srv_run(argv[2], srv_get_opt_value(argc, argv, "NEXT-SERVER"), c1stm8_main, c1stm8_warm_up) != 0)
+			{
+				std::perror("fail");
+			}
+
+			return 28;
+		}
+
+		// send the command line to compile server
+		if(opt == "CLIENT")
+		{
+			const std::string socket_name = argv[2];
+
+			argc -= 2;
+			argv[2] = argv[0];
+			argv += 2;
+
+			auto retcode = srv_request(socket_name, argc, argv);
+			if(retcode >= 0)
+			{
+				return retcode;
+			}
+
+			// the server is not available, process the command line locally
+		}
+	}
+
+#ifdef A1STM8_BUILTIN
+	// the built-in assembler reads the same MCU settings files
+	Settings::EnableFileCache();
+#endif
+
+	return c1stm8_main(argc, argv);
+}
@@ -9,15 +9,124 @@
 
 #pragma once
 
+#include <functional>
+
 #include "../../common/source/c1.h"
 
 
+// STM8 instruction codes
+enum class AOC
+{
+	AOC_UNKNOWN = 0,
+	AOC_ADC, AOC_ADD, AOC_ADDW, AOC_AND,
+	AOC_BCCM, AOC_BCP, AOC_BCPL, AOC_BREAK, AOC_BRES, AOC_BSET, AOC_BTJF, AOC_BTJT,
+	AOC_CALL, AOC_CALLF, AOC_CALLR, AOC_CCF, AOC_CLR, AOC_CLRW, AOC_CP, AOC_CPL, AOC_CPLW, AOC_CPW,
+	AOC_DEC, AOC_DECW, AOC_DIV, AOC_DIVW,
+	AOC_EXG, AOC_EXGW,
+	AOC_HALT,
+	AOC_INC, AOC_INCW, AOC_INT, AOC_IRET,
+	AOC_JP, AOC_JPF,
+	// relative jumps (must be listed one after another, from AOC_JRA to AOC_JRV)
+	AOC_JRA, AOC_JRC, AOC_JREQ, AOC_JRF, AOC_JRH, AOC_JRIH, AOC_JRIL, AOC_JRM, AOC_JRMI, AOC_JRNC, AOC_JRNE, AOC_JRNH, AOC_JRNM,
+	AOC_JRNV, AOC_JRPL, AOC_JRSGE, AOC_JRSGT, AOC_JRSLE, AOC_JRSLT, AOC_JRT, AOC_JRUGE, AOC_JRUGT, AOC_JRULE, AOC_JRULT, AOC_JRV,
+	AOC_LD, AOC_LDF, AOC_LDW,
+	AOC_MOV, AOC_MUL,
+	AOC_NEG, AOC_NEGW, AOC_NOP,
+	AOC_OR,
+	AOC_POP, AOC_POPW, AOC_PUSH, AOC_PUSHW,
+	AOC_RCF, AOC_RET, AOC_RETF, AOC_RIM, AOC_RLC, AOC_RLCW, AOC_RLWA, AOC_RRC, AOC_RRCW, AOC_RRWA, AOC_RVF,
+	AOC_SBC, AOC_SCF, AOC_SIM, AOC_SLA, AOC_SLAW, AOC_SLL, AOC_SLLW, AOC_SRA, AOC_SRAW, AOC_SRL, AOC_SRLW, AOC_SUB, AOC_SUBW,
+	AOC_SWAP, AOC_SWAPW,
+	AOC_TNZ, AOC_TNZW, AOC_TRAP,
+	AOC_WFE, AOC_WFI,
+	AOC_XOR,
+
+	// number of instruction codes
+	AOC_COUNT
+};
+
+// STM8 registers
+enum class AOR
+{
+	AOR_NONE = 0,
+	AOR_A,
+	AOR_X,
+	AOR_XL,
+	AOR_XH,
+	AOR_Y,
+	AOR_YL,
+	AOR_YH,
+	AOR_SP,
+	AOR_CC,
+};
+
+// instruction argument addressing modes
+enum class AOM
+{
+	AOM_NONE = 0,
+	AOM_REG,	// register (A, X, XL, SP, etc.)
+	AOM_IMM,	// immediate value or symbol (0x10, __LIB_STR_RLS, etc.)
+	AOM_MEM,	// memory at numeric or symbolic address, e.g. (0x10), (__VAR_A)
+	AOM_IND,	// memory at address stored in register: (X), (Y)
+	AOM_IDX,	// memory at register plus offset: (0x1, SP), (__VAR_A, X)
+	AOM_OTHER,	// everything else (pointer indirect modes, expressions)
+};
+
+// decoded instruction argument: numeric values (immediate value, address or offset) are stored
+// in _num if _is_num is true
+class B1_ASM_ARG_STM8
+{
+public:
+	AOM _mode;
+	AOR _reg;
+	bool _is_num;
+	int32_t _num;
+
+	B1_ASM_ARG_STM8()
+	: _mode(AOM::AOM_NONE)
+	, _reg(AOR::AOR_NONE)
+	, _is_num(false)
+	, _num(0)
+	{
+	}
+};
+
+// registers and condition flags tracked by the liveness analysis
+#define C1STM8_LIVE_A 0x1
+#define C1STM8_LIVE_XL 0x2
+#define C1STM8_LIVE_XH 0x4
+#define C1STM8_LIVE_X (C1STM8_LIVE_XL | C1STM8_LIVE_XH)
+#define C1STM8_LIVE_YL 0x8
+#define C1STM8_LIVE_YH 0x10
+#define C1STM8_LIVE_Y (C1STM8_LIVE_YL | C1STM8_LIVE_YH)
+#define C1STM8_LIVE_C 0x20
+#define C1STM8_LIVE_Z 0x40
+#define C1STM8_LIVE_N 0x80
+#define C1STM8_LIVE_V 0x100
+#define C1STM8_LIVE_H 0x200
+#define C1STM8_LIVE_FLAGS (C1STM8_LIVE_C | C1STM8_LIVE_Z | C1STM8_LIVE_N | C1STM8_LIVE_V | C1STM8_LIVE_H)
+#define C1STM8_LIVE_ALL (C1STM8_LIVE_A | C1STM8_LIVE_X | C1STM8_LIVE_Y | C1STM8_LIVE_FLAGS)
+
 class B1_ASM_OP_STM8: public B1_ASM_OP
 {
 public:
 	mutable bool _parsed;
+	// instruction mnemonic and arguments in text form (normalized, used to build new instructions)
 	mutable std::wstring _op;
 	mutable std::vector<std::wstring> _args;
+	// decoded instruction code and arguments (to match instructions without comparing strings)
+	mutable AOC _opc;
+	mutable std::vector<B1_ASM_ARG_STM8> _opnds;
+	// optimizer passes the instruction is queued for (C1STM8_OPT_RULES queue bits), new instructions are
+	// queued for all passes
+	mutable int32_t _opt_queue;
+	// registers and flags live before and after the instruction (C1STM8_LIVE_* bits), all of them are
+	// considered live until the liveness analysis is performed
+	mutable int32_t _live_in;
+	mutable int32_t _live_out;
+	// registers and flags the instruction reads and writes (-1 if not known yet, reset by the parser)
+	mutable int32_t _live_use;
+	mutable int32_t _live_def;
 
 
 	B1_ASM_OP_STM8() = delete;
@@ -25,6 +134,12 @@ public:
 	B1_ASM_OP_STM8(AOT type, const std::wstring &data, const std::wstring &comment, bool is_volatile, bool is_inline)
 	: B1_ASM_OP(type, data, comment, is_volatile, is_inline)
 	, _parsed(false)
+	, _opc(AOC::AOC_UNKNOWN)
+	, _opt_queue(-1)
+	, _live_in(C1STM8_LIVE_ALL)
+	, _live_out(C1STM8_LIVE_ALL)
+	, _live_use(-1)
+	, _live_def(0)
 	{
 	}
 
@@ -35,6 +150,105 @@ public:
 
 	bool ParseNumeric(const std::wstring &num_str, int32_t &n) const;
 	bool Parse() const;
+
+	// the functions check decoded arguments of a parsed instruction
+	bool IsReg(size_t arg_num, AOR reg) const;
+	bool IsImm(size_t arg_num, int32_t num) const;
+	// (X), (Y)
+	bool IsInd(size_t arg_num, AOR reg) const;
+	// (off, reg), e.g. IsIdx(0, AOR::AOR_SP, 1) is true for (0x1, SP)
+	bool IsIdx(size_t arg_num, AOR reg, int32_t off) const;
+	// JRA, JREQ, JRNE, etc.
+	bool IsRelJump() const;
+};
+
+// peephole optimizer window: the instruction being optimized and the instructions following it
+class C1STM8_OPT_WND
+{
+public:
+	static const int32_t MAX_SIZE = 7;
+
+	B1_ASM_OPS &_cs;
+	// number of instructions in the window
+	int32_t _size;
+	B1_ASM_OPS::iterator _its[MAX_SIZE];
+	B1_ASM_OP_STM8 *_ops[MAX_SIZE];
+
+
+	C1STM8_OPT_WND() = delete;
+
+	C1STM8_OPT_WND(B1_ASM_OPS &cs)
+	: _cs(cs)
+	, _size(0)
+	{
+	}
+
+	// makes the window contain the first instruction and wnd_size instructions following it, fails if the code
+	// section ends before or the instructions are inline or cannot be parsed
+	bool Extend(int32_t wnd_size);
+};
+
+// peephole optimization rule: _wnd_size is the number of instructions following the first one the rule checks,
+// _ops lists instruction codes allowed at the first and the second window positions (empty list allows any
+// instruction), _apply function checks the rest of the window and changes the code. the function returns
+// true if it has changed the code, in this case the optimizer continues from the window's first instruction
+// iterator (the function can change it)
+class C1STM8_OPT_RULE
+{
+public:
+	int32_t _id;
+	int32_t _wnd_size;
+	std::vector<AOC> _ops[2];
+	std::function<bool(C1STM8_OPT_WND &wnd, bool &changed)> _apply;
+
+	// instruction codes allowed at the second window position (filled by C1STM8_OPT_RULES::Compile())
+	std::vector<bool> _second_ops;
+
+	// the rule statistics record (set by C1STM8_OPT_RULES::InitStat() if the statistics are collected)
+	C1_OPT_RULE_STAT *_stat;
+};
+
+// peephole optimization rules compiled into an index by instruction code: all the rules applicable to
+// a window are found with a single lookup by its first instruction code and then checked in the order
+// they were added. every rule set is an optimizer pass that checks only the instructions queued for it
+// (see B1_ASM_OP_STM8::_opt_queue)
+class C1STM8_OPT_RULES
+{
+protected:
+	int32_t _queue_bit;
+	bool _skip_inline;
+
+	std::list<C1STM8_OPT_RULE> _rules;
+	std::vector<std::vector<const C1STM8_OPT_RULE *>> _index;
+
+
+public:
+	C1STM8_OPT_RULES() = delete;
+
+	C1STM8_OPT_RULES(int32_t queue_bit, bool skip_inline)
+	: _queue_bit(queue_bit)
+	, _skip_inline(skip_inline)
+	{
+	}
+
+	int32_t GetQueueBit() const
+	{
+		return _queue_bit;
+	}
+
+	bool GetSkipInline() const
+	{
+		return _skip_inline;
+	}
+
+	void Add(int32_t id, int32_t wnd_size, const std::vector<AOC> &first_ops, const std::vector<AOC> &second_ops, const std::function<bool(C1STM8_OPT_WND &wnd, bool &changed)> &apply);
+	void Compile();
+	void InitStat(std::map<int32_t, C1_OPT_RULE_STAT> &stat);
+
+	const std::vector<const C1STM8_OPT_RULE *> &GetRules(AOC opc) const
+	{
+		return _index[(int)opc];
+	}
 };
 
 class C1STM8Compiler: public C1Compiler
@@ -66,6 +280,8 @@ protected:
 	std::set<std::wstring> _clear_locals;
 
 	std::set<std::wstring> _allocated_arrays;
+	// arrays allocated on every path to the label
+	std::map<std::wstring, std::set<std::wstring>> _label_allocated_arrays;
 
 	std::map<int, std::wstring> _irq_handlers;
 
@@ -74,10 +290,23 @@ protected:
 	//                   iterator        store arg   file id  line cnt
 	std::list<std::tuple<const_iterator, B1_CMP_ARG, int32_t, int32_t>> _store_at;
 
+	C1STM8_OPT_RULES _opt_rules1;
+	C1STM8_OPT_RULES _opt_rules2;
+	C1STM8_OPT_RULES _opt_rules3;
+
+	// true if the liveness analysis results stored in the instructions can be used (the optimizer rules do not
+	// update them and reset the flag)
+	bool _live_valid;
+	std::map<std::wstring, const B1_ASM_OP_STM8 *> _live_labels;
+
 	C1_T_ERROR process_asm_cmd(const std::wstring &line) override;
 
 	B1_ASM_OPS::iterator create_asm_op(B1_ASM_OPS &sec, B1_ASM_OPS::const_iterator where, AOT type, const std::wstring &lbl, bool is_volatile, bool is_inline) override;
 
+	void get_cache_state(std::vector<int64_t> &state) const override;
+
+	void init_opt_rules_stat() override;
+
 	C1_T_ERROR stm8_calc_array_size(const B1_CMP_VAR &var, int32_t size1);
 	C1_T_ERROR stm8_st_gf(const B1_CMP_VAR &var, bool is_ma);
 	C1_T_ERROR stm8_arrange_types(const B1Types type_from, const B1Types type_to);
@@ -96,6 +325,7 @@ protected:
 	C1_T_ERROR stm8_store(const B1_CMP_ARG &arg);
 	C1_T_ERROR stm8_assign(const B1_CMP_CMD &cmd, bool omit_zero_init);
 	C1_T_ERROR stm8_un_op(const B1_CMP_CMD &cmd, bool omit_zero_init);
+	void stm8_narrow_op_type(const B1_CMP_CMD &cmd, B1_CMP_ARG &arg1, B1_CMP_ARG &arg2, B1Types &com_type, bool &comp) const;
 	C1_T_ERROR stm8_add_op(const B1_CMP_CMD &cmd);
 	C1_T_ERROR stm8_mul_op(const B1_CMP_CMD &cmd);
 	C1_T_ERROR stm8_bit_op(const B1_CMP_CMD &cmd);
@@ -106,14 +336,24 @@ protected:
 	C1_T_ERROR stm8_load_ptr(const B1_CMP_ARG &first, const B1_CMP_ARG &count);
 	C1_T_ERROR stm8_write_ioctl_fn(const B1_CMP_ARG &arg);
 	C1_T_ERROR stm8_write_ioctl(std::list<B1_CMP_CMD>::iterator &cmd_it);
+	void stm8_write_switch_tree(const std::vector<std::pair<int32_t, std::wstring>> &cases, size_t first, size_t last, const B1Types type, const std::wstring &dflt_label);
+	C1_T_ERROR stm8_write_switch(std::list<B1_CMP_CMD>::iterator &cmd_it, bool &done);
 
 	C1_T_ERROR write_data_sec(bool code_init) override;
+	void calc_allocated_arrays();
 	C1_T_ERROR write_code_sec(bool code_init) override;
 
 	std::wstring correct_SP_offset(const std::wstring &arg, int32_t op_size, bool &no_SP_off, int32_t *offset = nullptr) const;
 	bool is_arithm_op(const B1_ASM_OP_STM8 &ao, int32_t &size, int *n_SP_arg = nullptr) const;
 	bool is_reg_used(const B1_ASM_OP_STM8 &ao, const std::wstring &reg_name, bool &reg_write_op) const;
-	bool is_reg_used_after(B1_ASM_OPS::const_iterator start, B1_ASM_OPS::const_iterator end, const std::wstring &reg_name, bool branch = false) const;
+	void update_liveness();
+	bool is_reg_live_after(B1_ASM_OPS::const_iterator it, int32_t regs);
+
+	void init_opt_rules1();
+	void init_opt_rules2();
+	void init_opt_rules3();
+	B1_ASM_OPS::iterator queue_opt_window(B1_ASM_OPS &cs, B1_ASM_OPS::iterator where);
+	C1_T_ERROR apply_opt_rules(const C1STM8_OPT_RULES &rules, bool &changed);
 
 
 public:
@@ -125,9 +365,13 @@ public:
 	C1_T_ERROR WriteCodeInitDAT();
 	C1_T_ERROR WriteCodeInitEnd();
 
+	// queues all instructions for all optimizer passes
+	void QueueOptAll();
 	C1_T_ERROR Optimize1(bool &changed);
 	C1_T_ERROR Optimize2(bool &changed);
 	C1_T_ERROR Optimize3(bool &changed);
+	// removes register loads whose results are not used (walks the whole code section)
+	void RemoveDeadLoads(bool &changed);
 
 	 C1_T_ERROR Save(const std::string &file_name, bool overwrite_existing = true) override;
 };
@@ -13,15 +13,24 @@
 #include <sstream>
 #include <algorithm>
 #include <regex>
+#include <cstdlib>
+#include <filesystem>
 
 #ifdef _WIN32
 #include <windows.h>
+#include <process.h>
 #else
 #include <unistd.h>
 #include <linux/limits.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <cerrno>
+
+extern char **environ;
 #endif
 
 #include "moresym.h"
+#include "libarc.h"
 
 
 B1_T_ERROR Utils::str2int32(const std::wstring &str, int32_t &num)
@@ -626,8 +635,102 @@ std::wstring Utils::any2wstr(const std::any &any_val)
 	return std::wstring();
 }
 
+// runs the executable directly (without command interpreter) and waits for it to complete,
+// returns the process exit code or -1 if the process cannot be started (errno is set)
+int Utils::run_process(const std::string &exe_name, const std::vector<std::string> &args)
+{
+	std::vector<std::string> args1;
+	std::vector<char *> argv;
 
-B1_T_ERROR Settings::Read(const std::string &file_name)
+	args1.push_back(exe_name);
+	args1.insert(args1.end(), args.cbegin(), args.cend());
+
+#ifdef _WIN32
+	// _spawnvp concatenates arguments, so quote the ones containing spaces
+	for(auto &a: args1)
+	{
+		if(a.find_first_of(" \t") != std::string::npos && a.front() != '\"')
+		{
+			a = "\"" + a + "\"";
+		}
+	}
+#endif
+
+	for(auto &a: args1)
+	{
+		argv.push_back(a.data());
+	}
+	argv.push_back(nullptr);
+
+#ifdef _WIN32
+	auto res = ::_spawnvp(_P_WAIT, argv[0], argv.data());
+	return (res == -1) ? -1 : static_cast<int>(res);
+#else
+	pid_t pid;
+
+	auto res = ::posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ);
+	if(res != 0)
+	{
+		errno = res;
+		return -1;
+	}
+
+	int status = 0;
+	while(::waitpid(pid, &status, 0) == -1)
+	{
+		if(errno != EINTR)
+		{
+			return -1;
+		}
+	}
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : (128 + WTERMSIG(status));
+#endif
+}
+
+uint64_t Utils::str_hash(const std::string &str, uint64_t hash /*= 14695981039346656037ULL*/)
+{
+	for(const auto c: str)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+bool Utils::file_hash(const std::string &file_name, uint64_t &hash)
+{
+	std::FILE *fp = std::fopen(file_name.c_str(), "rb");
+	if(fp == nullptr)
+	{
+		return false;
+	}
+
+	char buf[4096];
+	size_t n;
+
+	hash = 14695981039346656037ULL;
+
+	while((n = std::fread(buf, 1, sizeof(buf), fp)) > 0)
+	{
+		hash = str_hash(std::string(buf, n), hash);
+	}
+
+	bool res = !std::ferror(fp);
+
+	std::fclose(fp);
+
+	return res;
+}
+
+
+bool Settings::_use_file_cache = false;
+std::map<std::string, std::pair<std::map<std::wstring, std::wstring>, std::map<std::string, int32_t>>> Settings::_cfg_file_cache;
+std::map<std::string, decltype(Settings::_io_settings)> Settings::_io_file_cache;
+std::map<std::string, std::map<std::string, std::string>> Settings::_lib_files_cache;
+
+B1_T_ERROR Settings::read_cfg_file(const std::string &file_name, std::map<std::string, int32_t> &int_names)
 {
 	std::FILE *fp = std::fopen(file_name.c_str(), "rt");
 	if(fp == nullptr)
@@ -682,7 +785,7 @@ B1_T_ERROR Settings::Read(const std::string &file_name)
 			Utils::str_split(value, L",", ins);
 			for(const auto &in: ins)
 			{
-				_int_names[Utils::wstr2str(Utils::str_trim(in))] = int_num;
+				int_names[Utils::wstr2str(Utils::str_trim(in))] = int_num;
 			}
 		}
 		else
@@ -693,6 +796,78 @@ B1_T_ERROR Settings::Read(const std::string &file_name)
 
 	std::fclose(fp);
 
+	return B1_RES_OK;
+}
+
+// returns parsed settings files cache key: absolute file name followed by file size and last write time, so a changed
+// file gets a new key and is parsed again
+std::string Settings::get_file_cache_key(const std::string &file_name)
+{
+#ifdef _WIN32
+	char path[MAX_PATH];
+
+	std::string key = (::_fullpath(path, file_name.c_str(), MAX_PATH) == nullptr) ? file_name : std::string(path);
+#else
+	char path[PATH_MAX];
+
+	std::string key = (::realpath(file_name.c_str(), path) == nullptr) ? file_name : std::string(path);
+#endif
+
+	// the functions return -1 and the minimal time value on error
+	std::error_code ec;
+	const auto size = std::filesystem::file_size(key, ec);
+	const auto time = std::filesystem::last_write_time(key, ec);
+
+	return key + '\n' + std::to_string(size) + '\n' + std::to_string(time.time_since_epoch().count());
+}
+
+// removes cache entries of the previous versions of the file
+template<typename T>
+static void erase_old_file_cache_entries(std::map<std::string, T> &cache, const std::string &cache_key)
+{
+	const auto path = cache_key.substr(0, cache_key.find('\n') + 1);
+
+	for(auto ce = cache.lower_bound(path); ce != cache.end() && ce->first.compare(0, path.length(), path) == 0; )
+	{
+		ce = cache.erase(ce);
+	}
+}
+
+B1_T_ERROR Settings::Read(const std::string &file_name)
+{
+	const auto cache_key = _use_file_cache ? get_file_cache_key(file_name) : std::string();
+	const auto cf = _use_file_cache ? _cfg_file_cache.find(cache_key) : _cfg_file_cache.end();
+
+	if(cf != _cfg_file_cache.end())
+	{
+		_settings = cf->second.first;
+		for(const auto &in: cf->second.second)
+		{
+			_int_names[in.first] = in.second;
+		}
+	}
+	else
+	{
+		std::map<std::string, int32_t> int_names;
+
+		auto err = read_cfg_file(file_name, int_names);
+		if(err != B1_RES_OK)
+		{
+			return err;
+		}
+
+		for(const auto &in: int_names)
+		{
+			_int_names[in.first] = in.second;
+		}
+
+		if(_use_file_cache)
+		{
+			erase_old_file_cache_entries(_cfg_file_cache, cache_key);
+			_cfg_file_cache[cache_key] = std::make_pair(_settings, int_names);
+		}
+	}
+
 #define SETTINGS_READ_NUM_PROPERTY(NAME, VAR) \
 { \
 	const auto s = _settings.find(L"" #NAME); \
@@ -808,6 +983,7 @@ void Settings::InitLibDirs()
 {
 	// build library directories list
 	_lib_dirs.clear();
+	_lib_files = nullptr;
 
 	std::string dir = _lib_dir_root;
 
@@ -847,8 +1023,77 @@ void Settings::InitLibDirs()
 	}
 }
 
+std::string Settings::get_lib_file_key(const std::string &file_name)
+{
+#ifdef _WIN32
+	// case-insensitive file names
+	return Utils::str_toupper(file_name);
+#else
+	return file_name;
+#endif
+}
+
+// builds index of all files from library directories (to avoid probing every directory for every
+// library file name), the index is rebuilt if a directory is changed (file added, removed or renamed)
+void Settings::index_lib_files() const
+{
+	std::string dirs_key;
+	std::error_code ec;
+
+	for(const auto &dir: _lib_dirs)
+	{
+		auto wt = std::filesystem::last_write_time(dir, ec);
+		dirs_key += dir + "|" + (ec ? std::string("-") : std::to_string(wt.time_since_epoch().count())) + "\n";
+	}
+
+	auto lf = _lib_files_cache.find(dirs_key);
+	if(lf == _lib_files_cache.end())
+	{
+		std::map<std::string, std::string> files;
+
+		// the last directories have higher priority
+		for(const auto &dir: _lib_dirs)
+		{
+			for(std::filesystem::directory_iterator di(dir, ec), end; !ec && di != end; di.increment(ec))
+			{
+				if(di->is_regular_file(ec))
+				{
+					const auto file_name = di->path().filename().string();
+					files[get_lib_file_key(file_name)] = dir + file_name;
+				}
+			}
+
+			// archived files have precedence over regular files of the same directory (LibFileReader falls back
+			// to the regular file if it is changed after the archive creation)
+			std::vector<std::string> arc_files;
+			if(arc_get_file_names(dir + B1_LIB_ARC_FILE_NAME, arc_files))
+			{
+				for(const auto &file_name: arc_files)
+				{
+					files[get_lib_file_key(file_name)] = dir + B1_LIB_ARC_FILE_NAME + "/" + file_name;
+				}
+			}
+		}
+
+		lf = _lib_files_cache.emplace(dirs_key, std::move(files)).first;
+	}
+
+	_lib_files = &lf->second;
+}
+
 std::string Settings::GetLibFileName(const std::string &file_name, const std::string &ext) const
 {
+	if(file_name.find_first_of("\\/") == std::string::npos)
+	{
+		if(_lib_files == nullptr)
+		{
+			index_lib_files();
+		}
+
+		const auto lf = _lib_files->find(get_lib_file_key(file_name + ext));
+		return (lf == _lib_files->cend()) ? std::string() : lf->second;
+	}
+
 	for(auto dir = _lib_dirs.crbegin(); dir != _lib_dirs.crend(); dir++)
 	{
 		FILE *fp = std::fopen((*dir + file_name + ext).c_str(), "r");
@@ -887,6 +1132,27 @@ bool Settings::get_field(std::wstring &line, bool optional, std::wstring &value)
 }
 
 B1_T_ERROR Settings::ReadIoSettings(const std::string &file_name)
+{
+	const auto cache_key = _use_file_cache ? get_file_cache_key(file_name) : std::string();
+	const auto cf = _use_file_cache ? _io_file_cache.find(cache_key) : _io_file_cache.end();
+
+	if(cf != _io_file_cache.end())
+	{
+		_io_settings = cf->second;
+		return B1_RES_OK;
+	}
+
+	auto err = read_io_file(file_name);
+	if(err == B1_RES_OK && _use_file_cache)
+	{
+		erase_old_file_cache_entries(_io_file_cache, cache_key);
+		_io_file_cache[cache_key] = _io_settings;
+	}
+
+	return err;
+}
+
+B1_T_ERROR Settings::read_io_file(const std::string &file_name)
 {
 	std::FILE *fp = std::fopen(file_name.c_str(), "rt");
 	if(fp == nullptr)
@@ -134,6 +134,12 @@ public:
 
 	[[nodiscard]]
 	static std::wstring any2wstr(const std::any &any_val);
+
+	static int run_process(const std::string &exe_name, const std::vector<std::string> &args);
+
+	// FNV-1a hash of a string or of a file contents
+	static uint64_t str_hash(const std::string &str, uint64_t hash = 14695981039346656037ULL);
+	static bool file_hash(const std::string &file_name, uint64_t &hash);
 };
 
 
@@ -209,6 +215,8 @@ protected:
 
 	std::string _lib_dir_root;
 	std::vector<std::string> _lib_dirs;
+	// index of files from all library directories (built on the first GetLibFileName() call)
+	mutable const std::map<std::string, std::string> *_lib_files;
 
 	std::map<std::wstring, std::wstring> _settings;
 
@@ -243,8 +251,25 @@ protected:
 	int32_t _heap_size;
 
 
+	// parsed settings files cache (used by compile server to keep MCU settings resident)
+	static bool _use_file_cache;
+	//                   file key     settings                                      interrupt names
+	static std::map<std::string, std::pair<std::map<std::wstring, std::wstring>, std::map<std::string, int32_t>>> _cfg_file_cache;
+	static std::map<std::string, decltype(_io_settings)> _io_file_cache;
+
+	// library files indices (one per library directories list)
+	//                   library dirs key        file name    file path
+	static std::map<std::string, std::map<std::string, std::string>> _lib_files_cache;
+
+
 	static bool get_field(std::wstring &line, bool optional, std::wstring &value);
 
+	static std::string get_file_cache_key(const std::string &file_name);
+	static std::string get_lib_file_key(const std::string &file_name);
+	void index_lib_files() const;
+	B1_T_ERROR read_cfg_file(const std::string &file_name, std::map<std::string, int32_t> &int_names);
+	B1_T_ERROR read_io_file(const std::string &file_name);
+
 
 public:
 	Settings()
@@ -257,6 +282,8 @@ public:
 	, _multiplication(false)
 	, _division(false)
 
+	, _lib_files(nullptr)
+
 	, _mem_model_small(true)
 	, _ret_address_size(-1)
 	, _fix_addresses(false)
@@ -336,6 +363,8 @@ public:
 	bool GetPrintWarnings() const { return _print_warnings; }
 	bool GetPrintWarningDesc() const { return _print_warning_desc; }
 
+	static void EnableFileCache() { _use_file_cache = true; }
+
 	B1_T_ERROR Read(const std::string &file_name);
 	bool GetValue(const std::wstring &key, std::wstring &value) const;
 
@@ -16,6 +16,7 @@
 
 #include "a1.h"
 #include "moresym.h"
+#include "timerep.h"
 
 
 A1_T_ERROR IhxWriter::WriteDataRecord(int32_t first_pos, int32_t last_pos)
@@ -855,7 +856,7 @@ A1_T_ERROR EVal::Resolve(const std::map<std::wstring, MemRef> &symbols /*= std::
 		n = ~n;
 	}
 
-	auto err = _global_settings.ProcessNumPostfix(_postfix, n);
+	auto err = _a1_global_settings.ProcessNumPostfix(_postfix, n);
 	if(err != B1_RES_OK)
 	{
 		return static_cast<A1_T_ERROR>(err);
@@ -947,7 +948,7 @@ A1_T_ERROR Exp::BuildExp(std::vector<Token>::const_iterator &start, const std::v
 
 					std::wstring value;
 
-					if(_global_settings.GetValue(symbol, value))
+					if(_a1_global_settings.GetValue(symbol, value))
 					{
 						exp.AddVal(EVal(value + (postfix.empty() ? L"" : (L"." + postfix)), usgn));
 					}
@@ -1976,7 +1977,7 @@ A1_T_ERROR CodeStmt::Write(IhxWriter *writer, const std::map<std::wstring, MemRe
 		if(!postfix.empty())
 		{
 			int32_t icode = code;
-			auto err = _global_settings.ProcessNumPostfix(postfix, icode);
+			auto err = _a1_global_settings.ProcessNumPostfix(postfix, icode);
 			if(err != B1_RES_OK)
 			{
 				return static_cast<A1_T_ERROR>(err);
@@ -3165,6 +3166,8 @@ A1_T_ERROR Sections::ReadSections(int32_t file_num, SectType sec_type, const std
 
 A1_T_ERROR Sections::ReadSourceFiles(const std::vector<std::string> &src_files)
 {
+	TRepStage trep_stage("ReadSourceFiles");
+
 	_curr_line_num = 0;
 	_curr_file_name.clear();
 
@@ -3243,7 +3246,7 @@ A1_T_ERROR Sections::ReadHeapSections()
 	if(size() == first_sec_num)
 	{
 		// no heap
-		_global_settings.SetHeapSize(0);
+		_a1_global_settings.SetHeapSize(0);
 	}
 	else
 	if(size() == first_sec_num + 1)
@@ -3256,7 +3259,7 @@ A1_T_ERROR Sections::ReadHeapSections()
 			return err;
 		}
 
-		if(hs > _global_settings.GetRAMSize())
+		if(hs > _a1_global_settings.GetRAMSize())
 		{
 			_curr_file_name = at(first_sec_num).GetFileName();
 			return A1_T_ERROR::A1_RES_EWSECSIZE;
@@ -3267,7 +3270,7 @@ A1_T_ERROR Sections::ReadHeapSections()
 			// .HEAP section without data definition: use the rest of RAM
 			hs = -1;
 		}
-		_global_settings.SetHeapSize(hs);
+		_a1_global_settings.SetHeapSize(hs);
 	}
 	else
 	if(size() > first_sec_num + 1)
@@ -3287,7 +3290,7 @@ A1_T_ERROR Sections::ReadHeapSections()
 			hs = hs1 > hs ? hs1 : hs;
 
 			_warnings.push_back(std::make_tuple(at(i).GetSectLineNum(), at(i).GetFileName(), A1_T_WARNING::A1_WRN_WMANYHPSECT));
-			if(hs > _global_settings.GetRAMSize())
+			if(hs > _a1_global_settings.GetRAMSize())
 			{
 				_curr_file_name = at(i).GetFileName();
 				return A1_T_ERROR::A1_RES_EWSECSIZE;
@@ -3299,7 +3302,7 @@ A1_T_ERROR Sections::ReadHeapSections()
 			// .HEAP section without data definition: use the rest of RAM
 			hs = -1;
 		}
-		_global_settings.SetHeapSize(hs);
+		_a1_global_settings.SetHeapSize(hs);
 	}
 
 	return A1_T_ERROR::A1_RES_OK;
@@ -3329,13 +3332,13 @@ A1_T_ERROR Sections::ReadStackSections()
 			return err;
 		}
 
-		if(_global_settings.GetHeapSize() + ss > _global_settings.GetRAMSize())
+		if(_a1_global_settings.GetHeapSize() + ss > _a1_global_settings.GetRAMSize())
 		{
 			_curr_file_name = at(first_sec_num).GetFileName();
 			return A1_T_ERROR::A1_RES_EWSECSIZE;
 		}
 
-		_global_settings.SetStackSize(ss);
+		_a1_global_settings.SetStackSize(ss);
 	}
 	else
 	if(size() > first_sec_num + 1)
@@ -3354,29 +3357,29 @@ A1_T_ERROR Sections::ReadStackSections()
 			ss = ss1 > ss ? ss1 : ss;
 
 			_warnings.push_back(std::make_tuple(at(i).GetSectLineNum(), at(i).GetFileName(), A1_T_WARNING::A1_WRN_WMANYSTKSECT));
-			if(_global_settings.GetHeapSize() + ss > _global_settings.GetRAMSize())
+			if(_a1_global_settings.GetHeapSize() + ss > _a1_global_settings.GetRAMSize())
 			{
 				_curr_file_name = at(i).GetFileName();
 				return A1_T_ERROR::A1_RES_EWSECSIZE;
 			}
 		}
 
-		_global_settings.SetStackSize(ss);
+		_a1_global_settings.SetStackSize(ss);
 	}
 
 	// add special symbols
 	MemRef mr;
 
 	mr.SetName(L"__RET_ADDR_SIZE");
-	mr.SetAddress(_global_settings.GetRetAddressSize());
+	mr.SetAddress(_a1_global_settings.GetRetAddressSize());
 	_memrefs[L"__RET_ADDR_SIZE"] = mr;
 
 	// add .STACK section symbols
 	mr.SetName(L"__STACK_START");
-	mr.SetAddress(_global_settings.GetRAMStart() + (_global_settings.GetRAMSize() - _global_settings.GetStackSize()));
+	mr.SetAddress(_a1_global_settings.GetRAMStart() + (_a1_global_settings.GetRAMSize() - _a1_global_settings.GetStackSize()));
 	_memrefs[L"__STACK_START"] = mr;
 	mr.SetName(L"__STACK_SIZE");
-	mr.SetAddress(_global_settings.GetStackSize());
+	mr.SetAddress(_a1_global_settings.GetStackSize());
 	_memrefs[L"__STACK_SIZE"] = mr;
 
 	return A1_T_ERROR::A1_RES_OK;
@@ -3388,20 +3391,20 @@ A1_T_ERROR Sections::ReadDataSections()
 	for(int32_t i = 0; i < _token_files.size(); i++)
 	{
 		int32_t size = 0;
-		auto err = ReadSections(i, SectType::ST_DATA, L"", _global_settings.GetRAMStart() + _data_size, size, _global_settings.GetRAMSize() - _data_size - _global_settings.GetHeapSize());
+		auto err = ReadSections(i, SectType::ST_DATA, L"", _a1_global_settings.GetRAMStart() + _data_size, size, _a1_global_settings.GetRAMSize() - _data_size - _a1_global_settings.GetHeapSize());
 		if(err != A1_T_ERROR::A1_RES_OK)
 		{
 			return err;
 		}
 		_data_size += size;
 
-		if(_data_size + _global_settings.GetHeapSize() > _global_settings.GetRAMSize())
+		if(_data_size + _a1_global_settings.GetHeapSize() > _a1_global_settings.GetRAMSize())
 		{
 			_curr_file_name = _src_files[i];
 			return A1_T_ERROR::A1_RES_EWSECSIZE;
 		}
 
-		if(_data_size + _global_settings.GetHeapSize() + _global_settings.GetStackSize() > _global_settings.GetRAMSize())
+		if(_data_size + _a1_global_settings.GetHeapSize() + _a1_global_settings.GetStackSize() > _a1_global_settings.GetRAMSize())
 		{
 			_warnings.push_back(std::make_tuple(-1, _src_files[i], A1_T_WARNING::A1_WRN_EWNORAM));
 		}
@@ -3409,8 +3412,8 @@ A1_T_ERROR Sections::ReadDataSections()
 
 	MemRef mr;
 	// add .HEAP section symbols
-	auto heap_size = _global_settings.GetHeapSize();
-	auto heap_start = _global_settings.GetRAMStart();
+	auto heap_size = _a1_global_settings.GetHeapSize();
+	auto heap_start = _a1_global_settings.GetRAMStart();
 	if(heap_size == 0)
 	{
 		// no heap
@@ -3421,8 +3424,8 @@ A1_T_ERROR Sections::ReadDataSections()
 	{
 		// use all free RAM for heap
 		heap_start += _data_size;
-		heap_size = _global_settings.GetRAMSize() - _data_size - _global_settings.GetStackSize();
-		_global_settings.SetHeapSize(heap_size);
+		heap_size = _a1_global_settings.GetRAMSize() - _data_size - _a1_global_settings.GetStackSize();
+		_a1_global_settings.SetHeapSize(heap_size);
 	}
 	else
 	{
@@ -3438,13 +3441,13 @@ A1_T_ERROR Sections::ReadDataSections()
 
 	// add .DATA sections symbols
 	mr.SetName(L"__DATA_START");
-	mr.SetAddress(_global_settings.GetRAMStart());
+	mr.SetAddress(_a1_global_settings.GetRAMStart());
 	_memrefs[L"__DATA_START"] = mr;
 	mr.SetName(L"__DATA_SIZE");
 	mr.SetAddress(_data_size);
 	_memrefs[L"__DATA_SIZE"] = mr;
 	mr.SetName(L"__DATA_TOTAL_SIZE");
-	mr.SetAddress(_global_settings.GetRAMSize());
+	mr.SetAddress(_a1_global_settings.GetRAMSize());
 	_memrefs[L"__DATA_TOTAL_SIZE"] = mr;
 
 	return A1_T_ERROR::A1_RES_OK;
@@ -3458,14 +3461,14 @@ A1_T_ERROR Sections::ReadCodeInitSections()
 	for(int32_t i = 0; i < _token_files.size(); i++)
 	{
 		int32_t size = 0;
-		auto err = ReadSections(i, SectType::ST_INIT, L"", _global_settings.GetROMStart() + _init_size, size, _global_settings.GetROMSize());
+		auto err = ReadSections(i, SectType::ST_INIT, L"", _a1_global_settings.GetROMStart() + _init_size, size, _a1_global_settings.GetROMSize());
 		if(err != A1_T_ERROR::A1_RES_OK)
 		{
 			return err;
 		}
 		_init_size += size;
 
-		if(_init_size > _global_settings.GetROMSize())
+		if(_init_size > _a1_global_settings.GetROMSize())
 		{
 			_curr_file_name = _src_files[i];
 			return A1_T_ERROR::A1_RES_EWSECSIZE;
@@ -3483,7 +3486,7 @@ A1_T_ERROR Sections::ReadCodeInitSections()
 	// add .CODE INIT sections symbols
 	MemRef mr;
 	mr.SetName(L"__INIT_START");
-	mr.SetAddress(_global_settings.GetROMStart());
+	mr.SetAddress(_a1_global_settings.GetROMStart());
 	_memrefs[L"__INIT_START"] = mr;
 	mr.SetName(L"__INIT_SIZE");
 	mr.SetAddress(_init_size);
@@ -3506,7 +3509,7 @@ A1_T_ERROR Sections::ReadConstSections()
 		total_size = _init_size + _const_size;
 #endif
 
-		auto err = ReadSections(i, SectType::ST_CONST, L"",  _global_settings.GetROMStart() + total_size, size, _global_settings.GetROMSize() - total_size);
+		auto err = ReadSections(i, SectType::ST_CONST, L"",  _a1_global_settings.GetROMStart() + total_size, size, _a1_global_settings.GetROMSize() - total_size);
 		if(err != A1_T_ERROR::A1_RES_OK)
 		{
 			return err;
@@ -3519,7 +3522,7 @@ A1_T_ERROR Sections::ReadConstSections()
 		total_size = _init_size + _const_size;
 #endif
 
-		if(total_size > _global_settings.GetROMSize())
+		if(total_size > _a1_global_settings.GetROMSize())
 		{
 			_curr_file_name = _src_files[i];
 			return A1_T_ERROR::A1_RES_EWSECSIZE;
@@ -3530,9 +3533,9 @@ A1_T_ERROR Sections::ReadConstSections()
 	MemRef mr;
 	mr.SetName(L"__CONST_START");
 #ifdef A1_CONST_AFTER_CODE
-	mr.SetAddress(_global_settings.GetROMStart() + _init_size + _code_size);
+	mr.SetAddress(_a1_global_settings.GetROMStart() + _init_size + _code_size);
 #else
-	mr.SetAddress(_global_settings.GetROMStart() + _init_size);
+	mr.SetAddress(_a1_global_settings.GetROMStart() + _init_size);
 #endif
 	_memrefs[L"__CONST_START"] = mr;
 	mr.SetName(L"__CONST_SIZE");
@@ -3556,7 +3559,7 @@ A1_T_ERROR Sections::ReadCodeSections()
 		total_size = _init_size + _const_size + _code_size;
 #endif
 
-		auto err = ReadSections(i, SectType::ST_CODE, L"", _global_settings.GetROMStart() + total_size, size, _global_settings.GetROMSize() - total_size);
+		auto err = ReadSections(i, SectType::ST_CODE, L"", _a1_global_settings.GetROMStart() + total_size, size, _a1_global_settings.GetROMSize() - total_size);
 		if(err != A1_T_ERROR::A1_RES_OK)
 		{
 			return err;
@@ -3569,7 +3572,7 @@ A1_T_ERROR Sections::ReadCodeSections()
 		total_size = _init_size + _const_size + _code_size;
 #endif
 
-		if(total_size > _global_settings.GetROMSize())
+		if(total_size > _a1_global_settings.GetROMSize())
 		{
 			_curr_file_name = _src_files[i];
 			return A1_T_ERROR::A1_RES_EWSECSIZE;
@@ -3580,16 +3583,16 @@ A1_T_ERROR Sections::ReadCodeSections()
 	MemRef mr;
 	mr.SetName(L"__CODE_START");
 #ifdef A1_CONST_AFTER_CODE
-	mr.SetAddress(_global_settings.GetROMStart() + _init_size);
+	mr.SetAddress(_a1_global_settings.GetROMStart() + _init_size);
 #else
-	mr.SetAddress(_global_settings.GetROMStart() + _init_size + _const_size);
+	mr.SetAddress(_a1_global_settings.GetROMStart() + _init_size + _const_size);
 #endif
 	_memrefs[L"__CODE_START"] = mr;
 	mr.SetName(L"__CODE_SIZE");
 	mr.SetAddress(_code_size);
 	_memrefs[L"__CODE_SIZE"] = mr;
 	mr.SetName(L"__CODE_TOTAL_SIZE");
-	mr.SetAddress(_global_settings.GetROMSize());
+	mr.SetAddress(_a1_global_settings.GetROMSize());
 	_memrefs[L"__CODE_TOTAL_SIZE"] = mr;
 
 	return A1_T_ERROR::A1_RES_OK;
@@ -3597,6 +3600,8 @@ A1_T_ERROR Sections::ReadCodeSections()
 
 A1_T_ERROR Sections::ReadSections()
 {
+	TRepStage trep_stage("ReadSections");
+
 	Clear();
 
 	// read .HEAP section
@@ -3657,6 +3662,8 @@ A1_T_ERROR Sections::ReadSections()
 
 A1_T_ERROR Sections::Write(const std::string &file_name)
 {
+	TRepStage trep_stage("Write");
+
 	bool rel_out_range = false;
 	int ror_line_num = 0;
 	std::string ror_file_name;
@@ -3674,7 +3681,7 @@ A1_T_ERROR Sections::Write(const std::string &file_name)
 		return err;
 	}
 
-	err = writer.SetAddress(_global_settings.GetROMStart());
+	err = writer.SetAddress(_a1_global_settings.GetROMStart());
 	if(err != A1_T_ERROR::A1_RES_OK)
 	{
 		writer.Close();
@@ -3711,12 +3718,12 @@ A1_T_ERROR Sections::Write(const std::string &file_name)
 				{
 					auto stmt = dynamic_cast<const CodeStmt *>(i);
 
-					if(_global_settings.GetFixAddresses() && err == A1_T_ERROR::A1_RES_ERELOUTRANGE && stmt != nullptr)
+					if(_a1_global_settings.GetFixAddresses() && err == A1_T_ERROR::A1_RES_ERELOUTRANGE && stmt != nullptr)
 					{
 						rel_out_range = true;
 						ror_line_num = i->GetLineNum();
 						ror_file_name = _curr_file_name;
-						_global_settings.AddInstToReplace(ror_line_num, _curr_file_name, stmt->GetInst());
+						_a1_global_settings.AddInstToReplace(ror_line_num, _curr_file_name, stmt->GetInst());
 					}
 					else
 					{
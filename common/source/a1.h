@@ -62,7 +62,7 @@ public:
 };
 
 
-extern A1Settings &_global_settings;
+extern A1Settings &_a1_global_settings;
 
 
 class IhxWriter
@@ -895,12 +895,12 @@ public:
 
 	int32_t GetStackSize() const
 	{
-		return _global_settings.GetStackSize();
+		return _a1_global_settings.GetStackSize();
 	}
 
 	int32_t GetHeapSize() const
 	{
-		return _global_settings.GetHeapSize();
+		return _a1_global_settings.GetHeapSize();
 	}
 
 	int32_t GetConstSize() const
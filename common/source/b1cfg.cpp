@@ -0,0 +1,986 @@
+/*
+ BASIC1 compiler
+ Copyright (c) 2021-2026 Nikolay Pletnev
+ MIT license
+
+ b1cfg.cpp: control-flow graph and dataflow analysis of intermediate code
+*/
+
+
+#include <algorithm>
+#include <map>
+
+#include "b1cfg.h"
+
+
+B1_CMP_BITSET::B1_CMP_BITSET(size_t size /*= 0*/)
+: _bits((size + 63) >> 6, 0)
+{
+}
+
+void B1_CMP_BITSET::resize(size_t size)
+{
+	_bits.assign((size + 63) >> 6, 0);
+}
+
+void B1_CMP_BITSET::clear()
+{
+	std::fill(_bits.begin(), _bits.end(), 0);
+}
+
+bool B1_CMP_BITSET::unite(const B1_CMP_BITSET &bs)
+{
+	bool changed = false;
+
+	for(size_t i = 0; i < _bits.size(); i++)
+	{
+		auto b = _bits[i] | bs._bits[i];
+		if(b != _bits[i])
+		{
+			_bits[i] = b;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+void B1_CMP_BITSET::subtract(const B1_CMP_BITSET &bs)
+{
+	for(size_t i = 0; i < _bits.size(); i++)
+	{
+		_bits[i] &= ~bs._bits[i];
+	}
+}
+
+void B1_CMP_BITSET::intersect(const B1_CMP_BITSET &bs)
+{
+	for(size_t i = 0; i < _bits.size(); i++)
+	{
+		_bits[i] &= bs._bits[i];
+	}
+}
+
+
+B1_CMP_USE_DEF::B1_CMP_USE_DEF()
+: ext(false)
+{
+}
+
+void B1_CMP_USE_DEF::clear()
+{
+	use.clear();
+	sub.clear();
+	def.clear();
+	mod.clear();
+	ext = false;
+}
+
+
+B1_CMP_BLOCK::B1_CMP_BLOCK(B1_CMP_CMDS::iterator f, B1_CMP_CMDS::iterator l)
+: first(f)
+, last(l)
+, jump(-1)
+, entry(false)
+, exit(false)
+{
+}
+
+
+B1_CMP_LOOP::B1_CMP_LOOP(int h)
+: header(h)
+, parent(-1)
+{
+}
+
+bool B1_CMP_LOOP::contains(int block) const
+{
+	return std::binary_search(blocks.cbegin(), blocks.cend(), block);
+}
+
+
+bool B1_CMP_FLOW::is_var_name(const B1_TYPED_VALUE &tv)
+{
+	return !tv.value.empty() && !B1CUtils::is_imm_val(tv.value);
+}
+
+bool B1_CMP_FLOW::is_terminator(const B1_CMP_CMD &cmd)
+{
+	return	cmd.cmd == L"JMP" || cmd.cmd == L"JT" || cmd.cmd == L"JF" || cmd.cmd == L"ERR" || cmd.cmd == L"CALL" ||
+			cmd.cmd == L"RET" || cmd.cmd == L"END" || cmd.cmd == L"STOP";
+}
+
+int B1_CMP_FLOW::add_var(const B1_ATOM &name)
+{
+	auto v = _var_inds.find(&name.str());
+	if(v != _var_inds.end())
+	{
+		return v->second;
+	}
+
+	int ind = (int)_vars.size();
+	_vars.push_back(name);
+	_var_inds[&name.str()] = ind;
+
+	return ind;
+}
+
+// registers all variables the command refers to
+void B1_CMP_FLOW::add_vars(const B1_CMP_CMD &cmd)
+{
+	if(!B1CUtils::is_cmd(cmd))
+	{
+		return;
+	}
+
+	if(	cmd.cmd == L"JMP" || cmd.cmd == L"JT" || cmd.cmd == L"JF" || cmd.cmd == L"ERR" || cmd.cmd == L"NS" || cmd.cmd == L"INT" ||
+		cmd.cmd == L"DAT" || cmd.cmd == L"RST")
+	{
+		return;
+	}
+
+	// skip subroutine labels and type names
+	size_t skip = (cmd.cmd == L"CALL") ? 0 : (cmd.cmd == L"GA" || cmd.cmd == L"LA" || cmd.cmd == L"MA" || cmd.cmd == L"RETVAL") ? 1 : cmd.args.size();
+
+	for(size_t a = 0; a < cmd.args.size(); a++)
+	{
+		if(a == skip)
+		{
+			continue;
+		}
+
+		for(const auto &tv: cmd.args[a])
+		{
+			if(is_var_name(tv))
+			{
+				add_var(tv.value);
+			}
+		}
+	}
+}
+
+void B1_CMP_FLOW::add_use(const B1_CMP_ARG &arg, B1_CMP_USE_DEF &ud) const
+{
+	for(auto tv = arg.cbegin(); tv != arg.cend(); tv++)
+	{
+		if(!is_var_name(*tv))
+		{
+			continue;
+		}
+
+		int ind = get_var_index(tv->value);
+		if(ind < 0)
+		{
+			continue;
+		}
+
+		ud.use.push_back(ind);
+
+		if(tv != arg.cbegin())
+		{
+			ud.sub.push_back(ind);
+		}
+
+		// variable passed by reference can be changed
+		if(tv->type == B1Types::B1T_VARREF)
+		{
+			ud.mod.push_back(ind);
+		}
+	}
+}
+
+void B1_CMP_FLOW::add_dst(const B1_CMP_ARG &arg, B1_CMP_USE_DEF &ud) const
+{
+	if(is_var_name(arg[0]))
+	{
+		int ind = get_var_index(arg[0].value);
+		if(ind >= 0)
+		{
+			if(arg.size() == 1)
+			{
+				ud.def.push_back(ind);
+			}
+			else
+			{
+				ud.mod.push_back(ind);
+			}
+		}
+	}
+
+	// subscripts
+	for(auto tv = arg.cbegin() + 1; tv != arg.cend(); tv++)
+	{
+		if(!is_var_name(*tv))
+		{
+			continue;
+		}
+
+		int ind = get_var_index(tv->value);
+		if(ind >= 0)
+		{
+			ud.use.push_back(ind);
+			ud.sub.push_back(ind);
+		}
+	}
+}
+
+B1_CMP_FLOW::B1_CMP_FLOW(B1_CMP_CMDS &cmds, const ENTRY_LABEL_FN &is_entry_label, const EXT_CALL_FN &is_ext_call)
+: _cmds(cmds)
+, _is_entry_label(is_entry_label)
+, _is_ext_call(is_ext_call)
+{
+	for(const auto &cmd: _cmds)
+	{
+		add_vars(cmd);
+	}
+
+	_ext_vars.resize(_vars.size());
+	for(int v = 0; v < (int)_vars.size(); v++)
+	{
+		if(!_cmds.is_gen_local(_vars[v]))
+		{
+			_ext_vars.set(v);
+		}
+	}
+
+	// split the code into basic blocks: a block starts with labels and ends with a jump (or before the next label)
+	std::unordered_map<std::wstring, int> labels;
+	std::vector<std::wstring> sub_labels;
+
+	auto first = _cmds.begin();
+	bool cmd_found = false;
+
+	for(auto i = _cmds.begin(); i != _cmds.end(); i++)
+	{
+		if(B1CUtils::is_label(*i))
+		{
+			if(cmd_found)
+			{
+				_blocks.emplace_back(first, i);
+				first = i;
+				cmd_found = false;
+			}
+
+			labels[i->cmd] = (int)_blocks.size();
+			continue;
+		}
+
+		cmd_found = true;
+
+		if(i->cmd == L"CALL")
+		{
+			sub_labels.push_back(i->args[0][0].value);
+		}
+
+		if(is_terminator(*i))
+		{
+			_blocks.emplace_back(first, std::next(i));
+			first = std::next(i);
+			cmd_found = false;
+		}
+	}
+
+	if(first != _cmds.end())
+	{
+		_blocks.emplace_back(first, _cmds.end());
+	}
+
+	if(_blocks.empty())
+	{
+		return;
+	}
+
+	// entry blocks
+	_blocks[0].entry = true;
+
+	for(const auto &l: labels)
+	{
+		if(_is_entry_label(l.first))
+		{
+			_blocks[l.second].entry = true;
+		}
+	}
+
+	for(const auto &l: sub_labels)
+	{
+		auto lbl = labels.find(l);
+		if(lbl != labels.end())
+		{
+			_blocks[lbl->second].entry = true;
+		}
+	}
+
+	// edges
+	for(int b = 0; b < (int)_blocks.size(); b++)
+	{
+		auto &blk = _blocks[b];
+		const auto &cmd = *std::prev(blk.last);
+		bool fall_through = true;
+
+		if(!B1CUtils::is_label(cmd))
+		{
+			if(cmd.cmd == L"JMP" || cmd.cmd == L"JT" || cmd.cmd == L"JF" || cmd.cmd == L"ERR")
+			{
+				auto lbl = labels.find(cmd.args[cmd.cmd == L"ERR" ? 1 : 0][0].value);
+				if(lbl == labels.end())
+				{
+					blk.exit = true;
+				}
+				else
+				{
+					blk.succs.push_back(lbl->second);
+					blk.jump = lbl->second;
+				}
+
+				fall_through = (cmd.cmd != L"JMP");
+			}
+			else
+			if(cmd.cmd == L"RET" || cmd.cmd == L"END" || cmd.cmd == L"STOP")
+			{
+				blk.exit = true;
+				fall_through = false;
+			}
+		}
+
+		if(fall_through)
+		{
+			if(b + 1 == (int)_blocks.size())
+			{
+				blk.exit = true;
+			}
+			else
+			if(std::find(blk.succs.begin(), blk.succs.end(), b + 1) == blk.succs.end())
+			{
+				blk.succs.push_back(b + 1);
+			}
+		}
+
+		for(auto s: blk.succs)
+		{
+			_blocks[s].preds.push_back(b);
+		}
+	}
+}
+
+int B1_CMP_FLOW::get_var_index(const B1_ATOM &name) const
+{
+	auto v = _var_inds.find(&name.str());
+	return (v == _var_inds.end()) ? -1 : v->second;
+}
+
+void B1_CMP_FLOW::get_use_def(const B1_CMP_CMD &cmd, B1_CMP_USE_DEF &ud) const
+{
+	ud.clear();
+
+	if(B1CUtils::is_label(cmd))
+	{
+		return;
+	}
+
+	if(B1CUtils::is_inline_asm(cmd) || cmd.cmd == L"INT")
+	{
+		ud.ext = true;
+		return;
+	}
+
+	if(	cmd.cmd == L"JMP" || cmd.cmd == L"JT" || cmd.cmd == L"JF" || cmd.cmd == L"ERR" || cmd.cmd == L"NS" || cmd.cmd == L"DAT" ||
+		cmd.cmd == L"RST" || cmd.cmd == L"RET" || cmd.cmd == L"END" || cmd.cmd == L"STOP")
+	{
+		return;
+	}
+
+	if(cmd.cmd == L"CALL")
+	{
+		for(auto a = cmd.args.cbegin() + 1; a != cmd.args.cend(); a++)
+		{
+			add_use(*a, ud);
+		}
+
+		ud.ext = true;
+		return;
+	}
+
+	if(cmd.cmd == L"GA" || cmd.cmd == L"LA" || cmd.cmd == L"MA" || cmd.cmd == L"GF" || cmd.cmd == L"LF")
+	{
+		for(auto a = cmd.args.cbegin() + std::min((size_t)2, cmd.args.size()); a != cmd.args.cend(); a++)
+		{
+			add_use(*a, ud);
+		}
+
+		// allocated variable gets its initial value, freed variable is not used any more
+		add_dst(B1_CMP_ARG(cmd.args[0][0].value), ud);
+		return;
+	}
+
+	if(cmd.cmd == L"RETVAL")
+	{
+		add_use(cmd.args[0], ud);
+	}
+	else
+	if(cmd.cmd == L"IN" || cmd.cmd == L"READ" || cmd.cmd == L"GET" || cmd.cmd == L"TRR")
+	{
+		for(auto a = cmd.args.cbegin(); a != cmd.args.cend(); a++)
+		{
+			if(a != cmd.args.cbegin() + 1 || cmd.cmd == L"TRR")
+			{
+				add_use(*a, ud);
+			}
+		}
+
+		add_dst(cmd.args[1], ud);
+	}
+	else
+	if(B1CUtils::is_un_op(cmd))
+	{
+		add_use(cmd.args[0], ud);
+		add_dst(cmd.args[1], ud);
+	}
+	else
+	if(B1CUtils::is_bin_op(cmd))
+	{
+		add_use(cmd.args[0], ud);
+		add_use(cmd.args[1], ud);
+		add_dst(cmd.args[2], ud);
+	}
+	else
+	{
+		for(const auto &a: cmd.args)
+		{
+			add_use(a, ud);
+		}
+	}
+
+	if(_is_ext_call(cmd))
+	{
+		ud.ext = true;
+	}
+}
+
+// reverse post-order of the blocks (entry blocks first, unreachable blocks at the end)
+void B1_CMP_FLOW::get_rpo(std::vector<int> &order) const
+{
+	std::vector<char> visited(_blocks.size(), 0);
+	std::vector<std::pair<int, size_t>> stack;
+
+	order.clear();
+
+	for(int pass = 0; pass < 2; pass++)
+	{
+		for(int r = 0; r < (int)_blocks.size(); r++)
+		{
+			if(visited[r] || (pass == 0 && !_blocks[r].entry))
+			{
+				continue;
+			}
+
+			visited[r] = 1;
+			stack.push_back(std::make_pair(r, 0));
+
+			while(!stack.empty())
+			{
+				auto &top = stack.back();
+				const auto &succs = _blocks[top.first].succs;
+
+				if(top.second < succs.size())
+				{
+					int s = succs[top.second++];
+					if(!visited[s])
+					{
+						visited[s] = 1;
+						stack.push_back(std::make_pair(s, 0));
+					}
+				}
+				else
+				{
+					order.push_back(top.first);
+					stack.pop_back();
+				}
+			}
+		}
+	}
+
+	std::reverse(order.begin(), order.end());
+}
+
+void B1_CMP_FLOW::calc_liveness()
+{
+	const size_t vars_num = _vars.size();
+	B1_CMP_USE_DEF ud;
+
+	_live_in.assign(_blocks.size(), B1_CMP_BITSET(vars_num));
+	_live_out.assign(_blocks.size(), B1_CMP_BITSET(vars_num));
+
+	// variables read before being written in the block (gen) and variables written in the block (kill)
+	std::vector<B1_CMP_BITSET> gen(_blocks.size(), B1_CMP_BITSET(vars_num));
+	std::vector<B1_CMP_BITSET> kill(_blocks.size(), B1_CMP_BITSET(vars_num));
+
+	for(size_t b = 0; b < _blocks.size(); b++)
+	{
+		for(auto i = _blocks[b].last; i != _blocks[b].first; )
+		{
+			i--;
+
+			get_use_def(*i, ud);
+
+			for(auto d: ud.def)
+			{
+				gen[b].reset(d);
+				kill[b].set(d);
+			}
+			for(auto u: ud.use)
+			{
+				gen[b].set(u);
+			}
+			if(ud.ext)
+			{
+				gen[b].unite(_ext_vars);
+			}
+		}
+	}
+
+	std::vector<int> order;
+	get_rpo(order);
+
+	B1_CMP_BITSET live(vars_num);
+	bool changed = true;
+
+	while(changed)
+	{
+		changed = false;
+
+		for(auto o = order.crbegin(); o != order.crend(); o++)
+		{
+			const auto &blk = _blocks[*o];
+			auto &out = _live_out[*o];
+
+			if(blk.exit)
+			{
+				out.unite(_ext_vars);
+			}
+			for(auto s: blk.succs)
+			{
+				out.unite(_live_in[s]);
+			}
+
+			live = out;
+			live.subtract(kill[*o]);
+			live.unite(gen[*o]);
+
+			if(live != _live_in[*o])
+			{
+				_live_in[*o] = live;
+				changed = true;
+			}
+		}
+	}
+}
+
+void B1_CMP_FLOW::live_step_back(const B1_CMP_CMD &cmd, B1_CMP_BITSET &live) const
+{
+	B1_CMP_USE_DEF ud;
+
+	get_use_def(cmd, ud);
+
+	for(auto d: ud.def)
+	{
+		live.reset(d);
+	}
+	for(auto u: ud.use)
+	{
+		live.set(u);
+	}
+	if(ud.ext)
+	{
+		live.unite(_ext_vars);
+	}
+}
+
+bool B1_CMP_FLOW::is_live(const B1_CMP_BITSET &live, const B1_ATOM &name) const
+{
+	int ind = get_var_index(name);
+	// variable unknown at the moment of analysis
+	return ind < 0 || live.test(ind);
+}
+
+void B1_CMP_FLOW::calc_reaching_defs(bool init)
+{
+	const int vars_num = (int)_vars.size();
+	B1_CMP_USE_DEF ud;
+
+	_defs.clear();
+	_cmd_defs.clear();
+	_var_defs.assign(vars_num, std::vector<int>());
+
+	for(const auto &blk: _blocks)
+	{
+		for(auto i = blk.first; i != blk.last; i++)
+		{
+			get_use_def(*i, ud);
+
+			if(ud.def.empty() && ud.mod.empty())
+			{
+				continue;
+			}
+
+			_cmd_defs[&*i] = (int)_defs.size();
+
+			for(auto d: ud.def)
+			{
+				_var_defs[d].push_back((int)_defs.size());
+				_defs.push_back(std::make_pair(&*i, d));
+			}
+			for(auto m: ud.mod)
+			{
+				_var_defs[m].push_back((int)_defs.size());
+				_defs.push_back(std::make_pair(&*i, m));
+			}
+		}
+	}
+
+	const int defs_num = (int)_defs.size();
+	const int total_num = defs_num + 2 * vars_num;
+
+	B1_CMP_BITSET unknown_vals(total_num), init_vals(total_num);
+
+	_ext_defs.resize(total_num);
+	_ext_unknown.resize(total_num);
+
+	for(int v = 0; v < vars_num; v++)
+	{
+		_var_defs[v].push_back(defs_num + v);
+		_var_defs[v].push_back(defs_num + vars_num + v);
+
+		unknown_vals.set(defs_num + v);
+		init_vals.set(defs_num + vars_num + v);
+
+		if(_ext_vars.test(v))
+		{
+			for(auto d: _var_defs[v])
+			{
+				_ext_defs.set(d);
+			}
+			_ext_unknown.set(defs_num + v);
+		}
+	}
+
+	_reach_in.assign(_blocks.size(), B1_CMP_BITSET(total_num));
+	_reach_out.assign(_blocks.size(), B1_CMP_BITSET(total_num));
+
+	// definitions made in the block and reaching its end (gen) and definitions overwritten in the block (kill)
+	std::vector<B1_CMP_BITSET> gen(_blocks.size(), B1_CMP_BITSET(total_num));
+	std::vector<B1_CMP_BITSET> kill(_blocks.size(), B1_CMP_BITSET(total_num));
+
+	for(size_t b = 0; b < _blocks.size(); b++)
+	{
+		for(auto i = _blocks[b].first; i != _blocks[b].last; i++)
+		{
+			get_use_def(*i, ud);
+
+			if(ud.ext)
+			{
+				gen[b].subtract(_ext_defs);
+				gen[b].unite(_ext_unknown);
+				kill[b].unite(_ext_defs);
+			}
+
+			int def = ud.def.empty() && ud.mod.empty() ? -1 : _cmd_defs[&*i];
+
+			for(auto d: ud.def)
+			{
+				for(auto vd: _var_defs[d])
+				{
+					gen[b].reset(vd);
+					kill[b].set(vd);
+				}
+				gen[b].set(def++);
+			}
+			for(auto m: ud.mod)
+			{
+				gen[b].set(def++);
+			}
+		}
+	}
+
+	std::vector<int> order;
+	get_rpo(order);
+
+	B1_CMP_BITSET reach(total_num);
+	bool changed = true;
+
+	while(changed)
+	{
+		changed = false;
+
+		for(auto o: order)
+		{
+			const auto &blk = _blocks[o];
+			auto &in = _reach_in[o];
+
+			if(blk.entry)
+			{
+				in.unite((o == 0 && init) ? init_vals : unknown_vals);
+			}
+			for(auto p: blk.preds)
+			{
+				in.unite(_reach_out[p]);
+			}
+
+			reach = in;
+			reach.subtract(kill[o]);
+			reach.unite(gen[o]);
+
+			if(reach != _reach_out[o])
+			{
+				_reach_out[o] = reach;
+				changed = true;
+			}
+		}
+	}
+}
+
+void B1_CMP_FLOW::reach_step(const B1_CMP_CMD &cmd, B1_CMP_BITSET &reach) const
+{
+	B1_CMP_USE_DEF ud;
+
+	get_use_def(cmd, ud);
+
+	if(ud.ext)
+	{
+		reach.subtract(_ext_defs);
+		reach.unite(_ext_unknown);
+	}
+
+	if(ud.def.empty() && ud.mod.empty())
+	{
+		return;
+	}
+
+	const int defs_num = (int)_defs.size();
+	auto cd = _cmd_defs.find(&cmd);
+	int def = (cd == _cmd_defs.end()) ? -1 : cd->second;
+
+	for(auto d: ud.def)
+	{
+		for(auto vd: _var_defs[d])
+		{
+			reach.reset(vd);
+		}
+		// the command is not known to the analysis: the variable value is unknown
+		reach.set(def < 0 ? defs_num + d : def++);
+	}
+	for(auto m: ud.mod)
+	{
+		reach.set(def < 0 ? defs_num + m : def++);
+	}
+}
+
+void B1_CMP_FLOW::get_var_defs(const B1_CMP_BITSET &reach, int var, std::vector<int> &defs) const
+{
+	defs.clear();
+
+	for(auto d: _var_defs[var])
+	{
+		if(reach.test(d))
+		{
+			defs.push_back(d);
+		}
+	}
+}
+
+const B1_CMP_CMD *B1_CMP_FLOW::get_def_cmd(int def) const
+{
+	return (def < (int)_defs.size()) ? _defs[def].first : nullptr;
+}
+
+int B1_CMP_FLOW::get_def_var(int def) const
+{
+	return (def < (int)_defs.size()) ? _defs[def].second : (def - (int)_defs.size()) % (int)_vars.size();
+}
+
+void B1_CMP_FLOW::calc_loops()
+{
+	const int blocks_num = (int)_blocks.size();
+
+	_idoms.assign(blocks_num, -1);
+	_loops.clear();
+
+	// blocks reachable from the code entries
+	std::vector<char> reached(blocks_num, 0);
+	std::vector<int> stack;
+
+	for(int b = 0; b < blocks_num; b++)
+	{
+		if(_blocks[b].entry)
+		{
+			reached[b] = 1;
+			stack.push_back(b);
+		}
+	}
+	while(!stack.empty())
+	{
+		const int b = stack.back();
+		stack.pop_back();
+
+		for(const auto s: _blocks[b].succs)
+		{
+			if(!reached[s])
+			{
+				reached[s] = 1;
+				stack.push_back(s);
+			}
+		}
+	}
+
+	std::vector<int> order;
+	get_rpo(order);
+	order.erase(std::remove_if(order.begin(), order.end(), [&reached](int b) { return !reached[b]; }), order.end());
+
+	// immediate dominators (Cooper, Harvey, Kennedy), a virtual root block precedes all the entry blocks
+	const int root = blocks_num;
+	std::vector<int> num(blocks_num + 1, -1);
+	std::vector<int> idom(blocks_num + 1, -1);
+
+	num[root] = 0;
+	idom[root] = root;
+	for(int i = 0; i < (int)order.size(); i++)
+	{
+		num[order[i]] = i + 1;
+	}
+
+	auto intersect = [&num, &idom](int b1, int b2) -> int
+	{
+		while(b1 != b2)
+		{
+			while(num[b1] > num[b2])
+			{
+				b1 = idom[b1];
+			}
+			while(num[b2] > num[b1])
+			{
+				b2 = idom[b2];
+			}
+		}
+
+		return b1;
+	};
+
+	bool changed = true;
+
+	while(changed)
+	{
+		changed = false;
+
+		for(const auto b: order)
+		{
+			int new_idom = _blocks[b].entry ? root : -1;
+
+			for(const auto p: _blocks[b].preds)
+			{
+				if(idom[p] >= 0)
+				{
+					new_idom = (new_idom < 0) ? p : intersect(p, new_idom);
+				}
+			}
+
+			if(new_idom != idom[b])
+			{
+				idom[b] = new_idom;
+				changed = true;
+			}
+		}
+	}
+
+	for(const auto b: order)
+	{
+		_idoms[b] = (idom[b] == root) ? -1 : idom[b];
+	}
+
+	// back edges: jumps to blocks dominating the jump sources
+	std::map<int, std::vector<int>> latches;
+
+	for(const auto b: order)
+	{
+		for(const auto s: _blocks[b].succs)
+		{
+			if(dominates(s, b))
+			{
+				latches[s].push_back(b);
+			}
+		}
+	}
+
+	// loop blocks: the header and the blocks the latches can be reached from without passing the header
+	std::vector<char> in_loop(blocks_num, 0);
+
+	for(const auto &l: latches)
+	{
+		B1_CMP_LOOP loop(l.first);
+
+		loop.latches = l.second;
+
+		in_loop[l.first] = 1;
+		loop.blocks.push_back(l.first);
+
+		for(const auto b: l.second)
+		{
+			if(!in_loop[b])
+			{
+				in_loop[b] = 1;
+				loop.blocks.push_back(b);
+				stack.push_back(b);
+			}
+		}
+
+		while(!stack.empty())
+		{
+			const int b = stack.back();
+			stack.pop_back();
+
+			for(const auto p: _blocks[b].preds)
+			{
+				if(reached[p] && !in_loop[p])
+				{
+					in_loop[p] = 1;
+					loop.blocks.push_back(p);
+					stack.push_back(p);
+				}
+			}
+		}
+
+		for(const auto b: loop.blocks)
+		{
+			in_loop[b] = 0;
+		}
+
+		std::sort(loop.blocks.begin(), loop.blocks.end());
+		_loops.push_back(loop);
+	}
+
+	// loops sharing blocks are nested, so an enclosing loop is always larger than the inner one
+	std::stable_sort(_loops.begin(), _loops.end(), [](const B1_CMP_LOOP &l1, const B1_CMP_LOOP &l2) { return l1.blocks.size() < l2.blocks.size(); });
+
+	for(int l = 0; l < (int)_loops.size(); l++)
+	{
+		for(int l1 = l + 1; l1 < (int)_loops.size(); l1++)
+		{
+			if(_loops[l1].blocks.size() > _loops[l].blocks.size() && _loops[l1].contains(_loops[l].header))
+			{
+				_loops[l].parent = l1;
+				break;
+			}
+		}
+	}
+}
+
+bool B1_CMP_FLOW::dominates(int b1, int b2) const
+{
+	for(int b = b2; b >= 0; b = _idoms[b])
+	{
+		if(b == b1)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,251 @@
+/*
+ BASIC1 compiler
+ Copyright (c) 2021-2026 Nikolay Pletnev
+ MIT license
+
+ b1cfg.h: control-flow graph and dataflow analysis of intermediate code
+*/
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <functional>
+
+#include "b1cmp.h"
+
+
+// fixed-size set of small non-negative integers (variable or definition indexes)
+class B1_CMP_BITSET
+{
+protected:
+	std::vector<uint64_t> _bits;
+
+public:
+	B1_CMP_BITSET(size_t size = 0);
+
+	void resize(size_t size);
+	void clear();
+
+	bool test(size_t n) const
+	{
+		return ((_bits[n >> 6] >> (n & 63)) & 1) != 0;
+	}
+
+	void set(size_t n)
+	{
+		_bits[n >> 6] |= (uint64_t)1 << (n & 63);
+	}
+
+	void reset(size_t n)
+	{
+		_bits[n >> 6] &= ~((uint64_t)1 << (n & 63));
+	}
+
+	// returns true if the set is changed
+	bool unite(const B1_CMP_BITSET &bs);
+	void subtract(const B1_CMP_BITSET &bs);
+	void intersect(const B1_CMP_BITSET &bs);
+
+	bool operator==(const B1_CMP_BITSET &bs) const
+	{
+		return _bits == bs._bits;
+	}
+
+	bool operator!=(const B1_CMP_BITSET &bs) const
+	{
+		return _bits != bs._bits;
+	}
+};
+
+
+// variables accessed by a command (indexes of B1_CMP_FLOW variables)
+class B1_CMP_USE_DEF
+{
+public:
+	// variables read by the command
+	std::vector<int> use;
+	// variables used as array subscripts or function arguments (the subset of use)
+	std::vector<int> sub;
+	// scalar variables overwritten by the command
+	std::vector<int> def;
+	// variables modified partially (array elements) or by reference
+	std::vector<int> mod;
+	// the command can read and change any non-local variable (subroutine or user function call, inline code)
+	bool ext;
+
+	B1_CMP_USE_DEF();
+
+	void clear();
+};
+
+
+// basic block: commands [first, last) executed one after another
+class B1_CMP_BLOCK
+{
+public:
+	B1_CMP_CMDS::iterator first;
+	B1_CMP_CMDS::iterator last;
+
+	std::vector<int> succs;
+	std::vector<int> preds;
+	// block the last command jumps to (-1 if the block does not end with a jump or the label is not found)
+	int jump;
+
+	// the block can get control from outside of the code (the code beginning, subroutine, function or handler label)
+	bool entry;
+	// control can leave the code after the block (RET, END, jump to unknown label, the code end)
+	bool exit;
+
+	B1_CMP_BLOCK(B1_CMP_CMDS::iterator f, B1_CMP_CMDS::iterator l);
+};
+
+
+// natural loop: the header block dominates all blocks of the loop, latches are the blocks jumping back to the header
+class B1_CMP_LOOP
+{
+public:
+	int header;
+	// blocks of the loop including the header (sorted)
+	std::vector<int> blocks;
+	std::vector<int> latches;
+	// the nearest enclosing loop (-1 for outermost loops)
+	int parent;
+
+	B1_CMP_LOOP(int h);
+
+	bool contains(int block) const;
+};
+
+
+// control-flow graph of intermediate code with liveness and reaching definitions analysis.
+// the analysis results are valid until the code is changed, passes that modify the code
+// should make sure the changes do not affect the results used afterwards
+class B1_CMP_FLOW
+{
+public:
+	// checks if a label can get control from outside of the code
+	typedef std::function<bool(const std::wstring &)> ENTRY_LABEL_FN;
+	// checks if a command calls user code (the code can read and change non-local variables)
+	typedef std::function<bool(const B1_CMP_CMD &)> EXT_CALL_FN;
+
+protected:
+	B1_CMP_CMDS &_cmds;
+	ENTRY_LABEL_FN _is_entry_label;
+	EXT_CALL_FN _is_ext_call;
+
+	std::vector<B1_CMP_BLOCK> _blocks;
+
+	// variables: names and indexes (atoms are interned so the string addresses identify them)
+	std::vector<B1_ATOM> _vars;
+	std::unordered_map<const std::wstring *, int> _var_inds;
+	// non-local variables (visible outside of the code)
+	B1_CMP_BITSET _ext_vars;
+
+	// liveness
+	std::vector<B1_CMP_BITSET> _live_in;
+	std::vector<B1_CMP_BITSET> _live_out;
+
+	// reaching definitions: [0, defs count) - commands writing variables,
+	// [defs count, defs count + vars count) - unknown values of variables (got outside of the code),
+	// [defs count + vars count, defs count + 2 * vars count) - initial values of variables
+	std::vector<std::pair<const B1_CMP_CMD *, int>> _defs;
+	// the first definition of every command writing variables
+	std::unordered_map<const B1_CMP_CMD *, int> _cmd_defs;
+	// definitions of every variable
+	std::vector<std::vector<int>> _var_defs;
+	// definitions of all non-local variables and their unknown values
+	B1_CMP_BITSET _ext_defs;
+	B1_CMP_BITSET _ext_unknown;
+	std::vector<B1_CMP_BITSET> _reach_in;
+	std::vector<B1_CMP_BITSET> _reach_out;
+
+	// immediate dominators (-1 for entry and unreachable blocks)
+	std::vector<int> _idoms;
+	// loops, inner loops precede enclosing ones
+	std::vector<B1_CMP_LOOP> _loops;
+
+	static bool is_var_name(const B1_TYPED_VALUE &tv);
+
+	int add_var(const B1_ATOM &name);
+	void add_vars(const B1_CMP_CMD &cmd);
+	void add_use(const B1_CMP_ARG &arg, B1_CMP_USE_DEF &ud) const;
+	void add_dst(const B1_CMP_ARG &arg, B1_CMP_USE_DEF &ud) const;
+	void get_rpo(std::vector<int> &order) const;
+
+public:
+	// checks if the command ends basic block (jump, call or return)
+	static bool is_terminator(const B1_CMP_CMD &cmd);
+
+	B1_CMP_FLOW(B1_CMP_CMDS &cmds, const ENTRY_LABEL_FN &is_entry_label, const EXT_CALL_FN &is_ext_call);
+
+	const std::vector<B1_CMP_BLOCK> &get_blocks() const
+	{
+		return _blocks;
+	}
+
+	int get_vars_num() const
+	{
+		return (int)_vars.size();
+	}
+
+	int get_var_index(const B1_ATOM &name) const;
+
+	bool is_ext_var(int var) const
+	{
+		return _ext_vars.test(var);
+	}
+
+	const B1_ATOM &get_var_name(int var) const
+	{
+		return _vars[var];
+	}
+
+	void get_use_def(const B1_CMP_CMD &cmd, B1_CMP_USE_DEF &ud) const;
+
+	// liveness: variables whose current values can be read later
+	void calc_liveness();
+	const B1_CMP_BITSET &get_live_out(int block) const
+	{
+		return _live_out[block];
+	}
+	// turns the set of variables live after the command into the set of variables live before it
+	void live_step_back(const B1_CMP_CMD &cmd, B1_CMP_BITSET &live) const;
+	bool is_live(const B1_CMP_BITSET &live, const B1_ATOM &name) const;
+
+	// reaching definitions, init flag means the variables have their initial values at the code beginning
+	void calc_reaching_defs(bool init);
+	const B1_CMP_BITSET &get_reach_in(int block) const
+	{
+		return _reach_in[block];
+	}
+	// turns the set of definitions reaching the command into the set of definitions reaching the next one
+	void reach_step(const B1_CMP_CMD &cmd, B1_CMP_BITSET &reach) const;
+	// definitions of the variable from the set
+	void get_var_defs(const B1_CMP_BITSET &reach, int var, std::vector<int> &defs) const;
+
+	int get_defs_num() const
+	{
+		return (int)_defs.size();
+	}
+	// command of the definition (nullptr for unknown and initial values), the command pointer
+	// is valid until the command is deleted
+	const B1_CMP_CMD *get_def_cmd(int def) const;
+	int get_def_var(int def) const;
+	bool is_init_def(int def) const
+	{
+		return def >= (int)(_defs.size() + _vars.size());
+	}
+
+	// dominators and natural loops (irreducible cycles are not recognized as loops)
+	void calc_loops();
+	// checks if every path from code entries to block b2 goes through block b1
+	bool dominates(int b1, int b2) const;
+	const std::vector<B1_CMP_LOOP> &get_loops() const
+	{
+		return _loops;
+	}
+};
@@ -16,6 +16,8 @@ extern "C"
 
 #include <limits.h>
 #include <cwctype>
+#include <unordered_set>
+#include <mutex>
 
 #include "moresym.h"
 #include "b1cmp.h"
@@ -351,7 +353,7 @@ int B1CUtils::get_fn_arg_index(const std::wstring &name)
 	return (name.find(L"__ARG_") == 0) ? std::stoi(name.substr(std::wstring(L"__ARG_").length())) : -1;
 }
 
-bool B1CUtils::is_src(const B1_CMP_CMD &cmd, const std::wstring &val)
+bool B1CUtils::is_src(const B1_CMP_CMD &cmd, const B1_ATOM &val)
 {
 	if(B1CUtils::is_label(cmd))
 	{
@@ -494,7 +496,7 @@ bool B1CUtils::is_src(const B1_CMP_CMD &cmd, const std::wstring &val)
 	return false;
 }
 
-bool B1CUtils::is_dst(const B1_CMP_CMD &cmd, const std::wstring &val)
+bool B1CUtils::is_dst(const B1_CMP_CMD &cmd, const B1_ATOM &val)
 {
 	if(B1CUtils::is_label(cmd))
 	{
@@ -576,7 +578,7 @@ bool B1CUtils::is_dst(const B1_CMP_CMD &cmd, const std::wstring &val)
 }
 
 // check if the variable is array subscript or function call argument
-bool B1CUtils::is_sub_or_arg(const B1_CMP_CMD &cmd, const std::wstring &val)
+bool B1CUtils::is_sub_or_arg(const B1_CMP_CMD &cmd, const B1_ATOM &val)
 {
 	if(B1CUtils::is_label(cmd))
 	{
@@ -793,7 +795,7 @@ bool B1CUtils::is_sub_or_arg(const B1_CMP_CMD &cmd, const std::wstring &val)
 	return false;
 }
 
-bool B1CUtils::is_used(const B1_CMP_CMD &cmd, const std::wstring &val)
+bool B1CUtils::is_used(const B1_CMP_CMD &cmd, const B1_ATOM &val)
 {
 	if(B1CUtils::is_label(cmd))
 	{
@@ -1010,7 +1012,7 @@ bool B1CUtils::is_used(const B1_CMP_CMD &cmd, const std::wstring &val)
 	return false;
 }
 
-bool B1CUtils::replace_dst(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CMP_ARG &arg, bool preserve_type /*= false*/)
+bool B1CUtils::replace_dst(B1_CMP_CMD &cmd, const B1_ATOM &val, const B1_CMP_ARG &arg, bool preserve_type /*= false*/)
 {
 	if(B1CUtils::is_label(cmd))
 	{
@@ -1022,13 +1024,13 @@ bool B1CUtils::replace_dst(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 		return false;
 	}
 
-	B1_CMP_ARG *to_replace = nullptr;
+	int to_replace = -1;
 
 	if(cmd.cmd == L"READ")
 	{
 		if(cmd.args[1][0].value == val)
 		{
-			to_replace = &cmd.args[1];
+			to_replace = 1;
 		}
 	}
 
@@ -1036,7 +1038,7 @@ bool B1CUtils::replace_dst(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 	{
 		if(cmd.args[1][0].value == val)
 		{
-			to_replace = &cmd.args[1];
+			to_replace = 1;
 		}
 	}
 
@@ -1046,55 +1048,57 @@ bool B1CUtils::replace_dst(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 		{
 			if(cmd.args[1][0].value == val)
 			{
-				to_replace = &cmd.args[1];
+				to_replace = 1;
 			}
 		}
 	}
 
-	if(to_replace == nullptr && cmd.args.size() == 2)
+	if(to_replace < 0 && cmd.args.size() == 2)
 	{
 		for(auto &op: B1CUtils::_un_ops)
 		{
 			if(cmd.cmd == op && cmd.args[1][0].value == val)
 			{
-				to_replace = &cmd.args[1];
+				to_replace = 1;
 				break;
 			}
 		}
 	}
 
-	if(to_replace == nullptr && cmd.args.size() == 3)
+	if(to_replace < 0 && cmd.args.size() == 3)
 	{
 		for(auto &op: B1CUtils::_bin_ops)
 		{
 			if(cmd.cmd == op && cmd.args[2][0].value == val)
 			{
-				to_replace = &cmd.args[2];
+				to_replace = 2;
 				break;
 			}
 		}
 	}
 
-	if(to_replace == nullptr)
+	if(to_replace < 0)
 	{
 		return false;
 	}
 
+	auto &rep = cmd.edit_args()[to_replace];
+
 	if(preserve_type)
 	{
-		auto type = (*to_replace)[0].type;
-		*to_replace = arg;
-		(*to_replace)[0].type = type;
+		auto type = rep[0].type;
+		rep = arg;
+		rep[0].type = type;
 	}
 	else
 	{
-		*to_replace = arg;
+		rep = arg;
 	}
 
 	return true;
 }
 
-bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CMP_ARG &arg, int *count_replaced /*= nullptr*/)
+bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_ATOM &val, const B1_CMP_ARG &arg, int *count_replaced /*= nullptr*/)
 {
 	bool replaced = false;
 	if(count_replaced != nullptr)
@@ -1108,7 +1112,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 		{
 			if((*a)[0].value == val)
 			{
-				*a = arg;
+				cmd.edit_args()[a - cmd.args.begin()] = arg;
 				replaced = true;
 				if(count_replaced != nullptr)
 				{
@@ -1124,7 +1128,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 	{
 		if(cmd.args[0][0].value == val)
 		{
-			cmd.args[0] = arg;
+			cmd.edit_args()[0] = arg;
 			if(count_replaced != nullptr)
 			{
 				*count_replaced = 1;
@@ -1139,7 +1143,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 	{
 		if(cmd.args[1][0].value == val)
 		{
-			cmd.args[1] = arg;
+			cmd.edit_args()[1] = arg;
 			if(count_replaced != nullptr)
 			{
 				*count_replaced = 1;
@@ -1156,7 +1160,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 		{
 			if(cmd.args[1][0].value == val)
 			{
-				cmd.args[1] = arg;
+				cmd.edit_args()[1] = arg;
 				if(count_replaced != nullptr)
 				{
 					*count_replaced = 1;
@@ -1169,7 +1173,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 		{
 			if((*a)[0].value == val)
 			{
-				*a = arg;
+				cmd.edit_args()[a - cmd.args.begin()] = arg;
 				if(count_replaced != nullptr)
 				{
 					*count_replaced = *count_replaced + 1;
@@ -1185,7 +1189,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 	{
 		if(cmd.args[1][0].value == val)
 		{
-			cmd.args[1] = arg;
+			cmd.edit_args()[1] = arg;
 			if(count_replaced != nullptr)
 			{
 				*count_replaced = 1;
@@ -1200,7 +1204,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 	{
 		if(cmd.args.size() > 2 && cmd.args[2][0].value == val)
 		{
-			cmd.args[2] = arg;
+			cmd.edit_args()[2] = arg;
 			if(count_replaced != nullptr)
 			{
 				*count_replaced = 1;
@@ -1217,7 +1221,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 		{
 			if((*a)[0].value == val)
 			{
-				*a = arg;
+				cmd.edit_args()[a - cmd.args.begin()] = arg;
 				replaced = true;
 				if(count_replaced != nullptr)
 				{
@@ -1237,7 +1241,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 			{
 				if(cmd.args[0][0].value == val)
 				{
-					cmd.args[0] = arg;
+					cmd.edit_args()[0] = arg;
 					if(count_replaced != nullptr)
 					{
 						*count_replaced = 1;
@@ -1257,7 +1261,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 				{
 					if((*a)[0].value == val)
 					{
-						*a = arg;
+						cmd.edit_args()[a - cmd.args.begin()] = arg;
 						if(count_replaced != nullptr)
 						{
 							*count_replaced = *count_replaced + 1;
@@ -1281,7 +1285,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CM
 				{
 					if((*a)[0].value == val)
 					{
-						*a = arg;
+						cmd.edit_args()[a - cmd.args.begin()] = arg;
 						if(count_replaced != nullptr)
 						{
 							*count_replaced = *count_replaced + 1;
@@ -1312,7 +1316,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 		{
 			if(*a == src_arg)
 			{
-				*a = arg;
+				cmd.edit_args()[a - cmd.args.begin()] = arg;
 				if(count_replaced != nullptr)
 				{
 					*count_replaced = *count_replaced + 1;
@@ -1328,7 +1332,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 	{
 		if(cmd.args[0] == src_arg)
 		{
-			cmd.args[0] = arg;
+			cmd.edit_args()[0] = arg;
 			if(count_replaced != nullptr)
 			{
 				*count_replaced = 1;
@@ -1343,7 +1347,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 	{
 		if(cmd.args[1] == src_arg)
 		{
-			cmd.args[1] = arg;
+			cmd.edit_args()[1] = arg;
 			if(count_replaced != nullptr)
 			{
 				*count_replaced = 1;
@@ -1360,7 +1364,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 		{
 			if(cmd.args[1] == src_arg)
 			{
-				cmd.args[1] = arg;
+				cmd.edit_args()[1] = arg;
 				if(count_replaced != nullptr)
 				{
 					*count_replaced = 1;
@@ -1373,7 +1377,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 		{
 			if(*a == src_arg)
 			{
-				*a = arg;
+				cmd.edit_args()[a - cmd.args.begin()] = arg;
 				if(count_replaced != nullptr)
 				{
 					*count_replaced = *count_replaced + 1;
@@ -1389,7 +1393,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 	{
 		if(cmd.args[1] == src_arg)
 		{
-			cmd.args[1] = arg;
+			cmd.edit_args()[1] = arg;
 			if(count_replaced != nullptr)
 			{
 				*count_replaced = 1;
@@ -1406,7 +1410,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 		{
 			if(cmd.args[2] == src_arg)
 			{
-				cmd.args[2] = arg;
+				cmd.edit_args()[2] = arg;
 				if(count_replaced != nullptr)
 				{
 					*count_replaced = 1;
@@ -1424,7 +1428,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 		{
 			if(*a == src_arg)
 			{
-				*a = arg;
+				cmd.edit_args()[a - cmd.args.begin()] = arg;
 				if(count_replaced != nullptr)
 				{
 					*count_replaced = *count_replaced + 1;
@@ -1444,7 +1448,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 			{
 				if(cmd.args[0] == src_arg)
 				{
-					cmd.args[0] = arg;
+					cmd.edit_args()[0] = arg;
 					if(count_replaced != nullptr)
 					{
 						*count_replaced = 1;
@@ -1464,7 +1468,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 				{
 					if(*a == src_arg)
 					{
-						*a = arg;
+						cmd.edit_args()[a - cmd.args.begin()] = arg;
 						if(count_replaced != nullptr)
 						{
 							*count_replaced = *count_replaced + 1;
@@ -1488,7 +1492,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 				{
 					if(*a == src_arg)
 					{
-						*a = arg;
+						cmd.edit_args()[a - cmd.args.begin()] = arg;
 						if(count_replaced != nullptr)
 						{
 							*count_replaced = *count_replaced + 1;
@@ -1506,7 +1510,7 @@ bool B1CUtils::replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_
 }
 
 // replaces source variable in cmd command (including subscripts and function arguments)
-bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, const B1_TYPED_VALUE &tv, bool preserve_type /*= false*/)
+bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const B1_ATOM &val, const B1_TYPED_VALUE &tv, bool preserve_type /*= false*/)
 {
 	if(B1CUtils::is_label(cmd))
 	{
@@ -1519,7 +1523,8 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 	}
 
 	bool processed = false;
-	std::vector<B1_TYPED_VALUE *> to_replace;
+	// argument and value indices
+	std::vector<std::pair<int, int>> to_replace;
 
 	if(cmd.cmd == L"GA" || cmd.cmd == L"MA")
 	{
@@ -1529,7 +1534,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 			{
 				if(aa->value == val)
 				{
-					to_replace.push_back(&*aa);
+					to_replace.push_back(std::make_pair(a - cmd.args.begin(), aa - a->begin()));
 				}
 			}
 		}
@@ -1543,7 +1548,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 		{
 			if(aa->value == val)
 			{
-				to_replace.push_back(&*aa);
+				to_replace.push_back(std::make_pair(0, aa - cmd.args[0].begin()));
 			}
 		}
 
@@ -1556,7 +1561,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 		{
 			if(aa->value == val)
 			{
-				to_replace.push_back(&*aa);
+				to_replace.push_back(std::make_pair(1, aa - cmd.args[1].begin()));
 			}
 		}
 
@@ -1569,7 +1574,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 		{
 			if(aa->value == val)
 			{
-				to_replace.push_back(&*aa);
+				to_replace.push_back(std::make_pair(1, aa - cmd.args[1].begin()));
 			}
 		}
 
@@ -1582,7 +1587,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 		{
 			if(aa->value == val)
 			{
-				to_replace.push_back(&*aa);
+				to_replace.push_back(std::make_pair(1, aa - cmd.args[1].begin()));
 			}
 		}
 
@@ -1597,7 +1602,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 			{
 				if(aa->value == val)
 				{
-					to_replace.push_back(&*aa);
+					to_replace.push_back(std::make_pair(2, aa - cmd.args[2].begin()));
 				}
 			}
 		}
@@ -1611,7 +1616,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 		{
 			if(aa->value == val)
 			{
-				to_replace.push_back(&*aa);
+				to_replace.push_back(std::make_pair(1, aa - cmd.args[1].begin()));
 			}
 		}
 
@@ -1626,7 +1631,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 		{
 			if(aa->value == val)
 			{
-				to_replace.push_back(&*aa);
+				to_replace.push_back(std::make_pair(1, aa - cmd.args[1].begin()));
 			}
 		}
 
@@ -1636,7 +1641,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 			{
 				if(aa->value == val)
 				{
-					to_replace.push_back(&*aa);
+					to_replace.push_back(std::make_pair(a - cmd.args.begin(), aa - a->begin()));
 				}
 			}
 		}
@@ -1648,7 +1653,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 	{
 		if(cmd.args[0][1].value == val)
 		{
-			to_replace.push_back(&cmd.args[0][1]);
+			to_replace.push_back(std::make_pair(0, 1));
 		}
 
 		processed = true;
@@ -1662,7 +1667,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 			{
 				if(aa->value == val)
 				{
-					to_replace.push_back(&*aa);
+					to_replace.push_back(std::make_pair(a - cmd.args.begin(), aa - a->begin()));
 				}
 			}
 		}
@@ -1688,7 +1693,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 
 						if(aa->value == val)
 						{
-							to_replace.push_back(&*aa);
+							to_replace.push_back(std::make_pair(a - cmd.args.begin(), aa - a->begin()));
 						}
 					}
 				}
@@ -1711,7 +1716,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 					{
 						if(aa->value == val)
 						{
-							to_replace.push_back(&*aa);
+							to_replace.push_back(std::make_pair(a - cmd.args.begin(), aa - a->begin()));
 						}
 					}
 				}
@@ -1740,7 +1745,7 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 
 						if(aa->value == val)
 						{
-							to_replace.push_back(&*aa);
+							to_replace.push_back(std::make_pair(a - cmd.args.begin(), aa - a->begin()));
 						}
 					}
 				}
@@ -1751,24 +1756,33 @@ bool B1CUtils::replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, c
 		}
 	}
 
-	for(auto rep: to_replace)
+	if(to_replace.empty())
+	{
+		return false;
+	}
+
+	auto &args = cmd.edit_args();
+
+	for(const auto &rep: to_replace)
 	{
+		auto &v = args[rep.first][rep.second];
+
 		if(preserve_type)
 		{
-			auto type = rep->type;
-			*rep = tv;
-			rep->type = type;
+			auto type = v.type;
+			v = tv;
+			v.type = type;
 		}
 		else
 		{
-			*rep = tv;
+			v = tv;
 		}
 	}
 
-	return !to_replace.empty();
+	return true;
 }
 
-bool B1CUtils::replace_all(B1_CMP_CMD &cmd, const std::wstring &val, const B1_TYPED_VALUE &tv, bool preserve_type /*= false*/)
+bool B1CUtils::replace_all(B1_CMP_CMD &cmd, const B1_ATOM &val, const B1_TYPED_VALUE &tv, bool preserve_type /*= false*/)
 {
 	B1_CMP_ARG arg(tv.value, tv.type);
 
@@ -2221,15 +2235,84 @@ bool B1CUtils::get_asm_type(const B1Types type, std::wstring *asmtype /*= nullpt
 }
 
 
+const std::wstring *B1_ATOM::intern(const std::wstring &str)
+{
+	// the table is never shrunk, unordered_set keeps its elements' addresses on rehashing
+	static std::unordered_set<std::wstring> atoms;
+	static std::mutex atoms_mutex;
+
+	std::lock_guard<std::mutex> lock(atoms_mutex);
+
+	return &*atoms.insert(str).first;
+}
+
+B1_ATOM::B1_ATOM()
+{
+	static const std::wstring *empty_str = intern(std::wstring());
+
+	_str = empty_str;
+}
+
+B1_ATOM::B1_ATOM(const std::wstring &str)
+: _str(intern(str))
+{
+}
+
+B1_ATOM::B1_ATOM(const wchar_t *str)
+: _str(intern(str))
+{
+}
+
+void B1_ATOM::clear()
+{
+	*this = B1_ATOM();
+}
+
+void B1_ATOM::pop_back()
+{
+	_str = intern(_str->substr(0, _str->length() - 1));
+}
+
+B1_ATOM &B1_ATOM::erase(size_t pos /*= 0*/, size_t n /*= std::wstring::npos*/)
+{
+	_str = intern(std::wstring(*_str).erase(pos, n));
+	return *this;
+}
+
+B1_ATOM &B1_ATOM::insert(size_t pos, const std::wstring &str)
+{
+	_str = intern(std::wstring(*_str).insert(pos, str));
+	return *this;
+}
+
+B1_ATOM &B1_ATOM::operator+=(const std::wstring &str)
+{
+	_str = intern(*_str + str);
+	return *this;
+}
+
+
 B1_TYPED_VALUE::B1_TYPED_VALUE()
 : type(B1Types::B1T_UNKNOWN)
 {
 }
 
+B1_TYPED_VALUE::B1_TYPED_VALUE(const B1_ATOM &val, const B1Types tp /*= B1Types::B1T_UNKNOWN*/)
+: type(tp)
+, value(val)
+{
+}
+
 B1_TYPED_VALUE::B1_TYPED_VALUE(const std::wstring &val, const B1Types tp /*= B1Types::B1T_UNKNOWN*/)
+: type(tp)
+, value(val)
+{
+}
+
+B1_TYPED_VALUE::B1_TYPED_VALUE(const wchar_t *val, const B1Types tp /*= B1Types::B1T_UNKNOWN*/)
+: type(tp)
+, value(val)
 {
-	value = val;
-	type = tp;
 }
 
 bool B1_TYPED_VALUE::operator!=(const B1_TYPED_VALUE &tv) const
@@ -2248,11 +2331,21 @@ B1_CMP_ARG::B1_CMP_ARG()
 {
 }
 
+B1_CMP_ARG::B1_CMP_ARG(const B1_ATOM &val, const B1Types tp /*= B1Types::B1T_UNKNOWN*/)
+{
+	push_back(B1_TYPED_VALUE(val, tp));
+}
+
 B1_CMP_ARG::B1_CMP_ARG(const std::wstring &val, const B1Types tp /*= B1Types::B1T_UNKNOWN*/)
 {
 	push_back(B1_TYPED_VALUE(val, tp));
 }
 
+B1_CMP_ARG::B1_CMP_ARG(const wchar_t *val, const B1Types tp /*= B1Types::B1T_UNKNOWN*/)
+{
+	push_back(B1_TYPED_VALUE(val, tp));
+}
+
 bool B1_CMP_ARG::operator==(const B1_CMP_ARG &arg) const
 {
 	if(size() != arg.size())
@@ -2273,6 +2366,9 @@ bool B1_CMP_ARG::operator==(const B1_CMP_ARG &arg) const
 
 
 B1_CMP_CMD::B1_CMP_CMD(int32_t line_num, int32_t line_cnt, int32_t src_file_id, int32_t src_line_id)
+: _owner(nullptr)
+, cmd(_cmd)
+, args(_args)
 {
 	clear();
 
@@ -2282,11 +2378,65 @@ B1_CMP_CMD::B1_CMP_CMD(int32_t line_num, int32_t line_cnt, int32_t src_file_id,
 	this->src_line_id = src_line_id;
 }
 
+B1_CMP_CMD::B1_CMP_CMD(const B1_CMP_CMD &cmd)
+: _cmd(cmd._cmd)
+, _args(cmd._args)
+, _owner(nullptr)
+, type(cmd.type)
+, cmd(_cmd)
+, args(_args)
+, line_num(cmd.line_num)
+, line_cnt(cmd.line_cnt)
+, src_file_id(cmd.src_file_id)
+, src_line_id(cmd.src_line_id)
+{
+}
+
+B1_CMP_CMD &B1_CMP_CMD::operator=(const B1_CMP_CMD &cmd)
+{
+	if(this != &cmd)
+	{
+		changed();
+
+		_cmd = cmd._cmd;
+		_args = cmd._args;
+		type = cmd.type;
+		line_num = cmd.line_num;
+		line_cnt = cmd.line_cnt;
+		src_file_id = cmd.src_file_id;
+		src_line_id = cmd.src_line_id;
+	}
+
+	return *this;
+}
+
+void B1_CMP_CMD::changed()
+{
+	if(_owner != nullptr && _owner->_track_changes)
+	{
+		_owner->_changed_cmds.insert(this);
+	}
+}
+
+void B1_CMP_CMD::set_cmd(const std::wstring &name)
+{
+	changed();
+	_cmd = name;
+}
+
+B1_CMP_ARGS &B1_CMP_CMD::edit_args()
+{
+	changed();
+	return _args;
+}
+
 void B1_CMP_CMD::clear()
 {
+	changed();
+
 	type = B1_CMD_TYPE::B1_CMD_TYPE_UNKNOWN;
-	cmd.clear();
-	args.clear();
+	_cmd.clear();
+	_args.clear();
 
 	line_num = -1;
 	line_cnt = -1;
@@ -2303,6 +2453,7 @@ B1_CMP_CMDS::B1_CMP_CMDS()
 , _curr_line_cnt(-1)
 , _curr_src_file_id(-1)
 , _curr_src_line_id(-1)
+, _track_changes(false)
 {
 }
 
@@ -2314,7 +2465,200 @@ B1_CMP_CMDS::B1_CMP_CMDS(const std::wstring &name_space, int32_t next_label /*=
 , _curr_line_cnt(-1)
 , _curr_src_file_id(-1)
 , _curr_src_line_id(-1)
+, _track_changes(false)
+{
+}
+
+// copied (or moved) list does not copy the changes log
+B1_CMP_CMDS::B1_CMP_CMDS(const B1_CMP_CMDS &cmds)
+: std::list<B1_CMP_CMD>(cmds)
+, _next_label(cmds._next_label)
+, _next_local(cmds._next_local)
+, _curr_name_space(cmds._curr_name_space)
+, _curr_line_num(cmds._curr_line_num)
+, _curr_line_cnt(cmds._curr_line_cnt)
+, _curr_src_file_id(cmds._curr_src_file_id)
+, _curr_src_line_id(cmds._curr_src_line_id)
+, _track_changes(false)
+{
+	own_cmds();
+}
+
+B1_CMP_CMDS::B1_CMP_CMDS(B1_CMP_CMDS &&cmds)
+: std::list<B1_CMP_CMD>(std::move(cmds))
+, _next_label(cmds._next_label)
+, _next_local(cmds._next_local)
+, _curr_name_space(std::move(cmds._curr_name_space))
+, _curr_line_num(cmds._curr_line_num)
+, _curr_line_cnt(cmds._curr_line_cnt)
+, _curr_src_file_id(cmds._curr_src_file_id)
+, _curr_src_line_id(cmds._curr_src_line_id)
+, _track_changes(false)
+{
+	own_cmds();
+}
+
+B1_CMP_CMDS &B1_CMP_CMDS::operator=(const B1_CMP_CMDS &cmds)
+{
+	if(this != &cmds)
+	{
+		clear();
+		std::list<B1_CMP_CMD>::operator=(cmds);
+		_next_label = cmds._next_label;
+		_next_local = cmds._next_local;
+		_curr_name_space = cmds._curr_name_space;
+		_curr_line_num = cmds._curr_line_num;
+		_curr_line_cnt = cmds._curr_line_cnt;
+		_curr_src_file_id = cmds._curr_src_file_id;
+		_curr_src_line_id = cmds._curr_src_line_id;
+		own_cmds();
+	}
+
+	return *this;
+}
+
+B1_CMP_CMDS &B1_CMP_CMDS::operator=(B1_CMP_CMDS &&cmds)
+{
+	if(this != &cmds)
+	{
+		clear();
+		std::list<B1_CMP_CMD>::operator=(std::move(cmds));
+		_next_label = cmds._next_label;
+		_next_local = cmds._next_local;
+		_curr_name_space = std::move(cmds._curr_name_space);
+		_curr_line_num = cmds._curr_line_num;
+		_curr_line_cnt = cmds._curr_line_cnt;
+		_curr_src_file_id = cmds._curr_src_file_id;
+		_curr_src_line_id = cmds._curr_src_line_id;
+		own_cmds();
+	}
+
+	return *this;
+}
+
+// makes the list the owner of its commands and logs them as inserted ones
+void B1_CMP_CMDS::own_cmds()
+{
+	for(auto &cmd: *this)
+	{
+		cmd_inserted(cmd);
+	}
+}
+
+void B1_CMP_CMDS::cmd_inserted(B1_CMP_CMD &cmd)
+{
+	cmd._owner = this;
+
+	if(_track_changes)
+	{
+		_changed_cmds.insert(&cmd);
+	}
+}
+
+void B1_CMP_CMDS::cmd_removed(B1_CMP_CMD &cmd)
+{
+	cmd._owner = nullptr;
+
+	if(_track_changes)
+	{
+		_changed_cmds.erase(&cmd);
+		_removed_cmds.push_back(&cmd);
+	}
+}
+
+B1_CMP_CMDS::iterator B1_CMP_CMDS::insert(const_iterator pos, const B1_CMP_CMD &cmd)
+{
+	auto i = std::list<B1_CMP_CMD>::insert(pos, cmd);
+	cmd_inserted(*i);
+	return i;
+}
+
+B1_CMP_CMDS::iterator B1_CMP_CMDS::insert(const_iterator pos, const_iterator first, const_iterator last)
+{
+	auto i = std::list<B1_CMP_CMD>::insert(pos, first, last);
+	for(auto i1 = i; i1 != pos; i1++)
+	{
+		cmd_inserted(*i1);
+	}
+	return i;
+}
+
+void B1_CMP_CMDS::push_back(const B1_CMP_CMD &cmd)
+{
+	std::list<B1_CMP_CMD>::push_back(cmd);
+	cmd_inserted(back());
+}
+
+B1_CMP_CMDS::iterator B1_CMP_CMDS::erase(const_iterator pos)
+{
+	cmd_removed(const_cast<B1_CMP_CMD &>(*pos));
+	return std::list<B1_CMP_CMD>::erase(pos);
+}
+
+B1_CMP_CMDS::iterator B1_CMP_CMDS::erase(const_iterator first, const_iterator last)
+{
+	for(auto i = first; i != last; i++)
+	{
+		cmd_removed(const_cast<B1_CMP_CMD &>(*i));
+	}
+	return std::list<B1_CMP_CMD>::erase(first, last);
+}
+
+void B1_CMP_CMDS::pop_back()
+{
+	cmd_removed(back());
+	std::list<B1_CMP_CMD>::pop_back();
+}
+
+void B1_CMP_CMDS::splice(const_iterator pos, B1_CMP_CMDS &cmds, const_iterator it)
+{
+	auto &cmd = const_cast<B1_CMP_CMD &>(*it);
+	cmds.cmd_removed(cmd);
+	std::list<B1_CMP_CMD>::splice(pos, cmds, it);
+	cmd_inserted(cmd);
+}
+
+void B1_CMP_CMDS::splice(const_iterator pos, B1_CMP_CMDS &cmds, const_iterator first, const_iterator last)
+{
+	std::vector<B1_CMP_CMD *> moved;
+
+	for(auto i = first; i != last; i++)
+	{
+		moved.push_back(&const_cast<B1_CMP_CMD &>(*i));
+		cmds.cmd_removed(*moved.back());
+	}
+
+	std::list<B1_CMP_CMD>::splice(pos, cmds, first, last);
+
+	for(auto cmd: moved)
+	{
+		cmd_inserted(*cmd);
+	}
+}
+
+void B1_CMP_CMDS::clear()
+{
+	for(auto &cmd: *this)
+	{
+		cmd_removed(cmd);
+	}
+	std::list<B1_CMP_CMD>::clear();
+}
+
+void B1_CMP_CMDS::track_changes()
+{
+	_track_changes = true;
+	_changed_cmds.clear();
+	_removed_cmds.clear();
+	own_cmds();
+}
+
+void B1_CMP_CMDS::get_changes(std::vector<B1_CMP_CMD *> &changed, std::vector<B1_CMP_CMD *> &removed)
 {
+	changed.assign(_changed_cmds.cbegin(), _changed_cmds.cend());
+	removed.swap(_removed_cmds);
+	_changed_cmds.clear();
+	_removed_cmds.clear();
 }
 
 std::wstring B1_CMP_CMDS::get_name_space_prefix() const
@@ -2331,11 +2675,11 @@ void B1_CMP_CMDS::emit_label(const std::wstring &name, const_iterator pos, bool
 
 	if(global)
 	{
-		cmd.cmd = name;
+		cmd._cmd = name;
 	}
 	else
 	{
-		cmd.cmd = (name.find(get_name_space_prefix()) == 0 ? std::wstring() : get_name_space_prefix()) + name;
+		cmd._cmd = (name.find(get_name_space_prefix()) == 0 ? std::wstring() : get_name_space_prefix()) + name;
 	}
 
 	insert(pos, cmd);
@@ -2369,9 +2713,9 @@ std::wstring B1_CMP_CMDS::emit_local(const B1Types type, const_iterator pos)
 	B1_CMP_CMD cmd(_curr_line_num, _curr_line_cnt, _curr_src_file_id, _curr_src_line_id);
 
 	cmd.type = B1_CMD_TYPE::B1_CMD_TYPE_COMMAND;
-	cmd.cmd = L"LA";
-	cmd.args.push_back(name);
-	cmd.args.push_back(B1_CMP_ARG(Utils::get_type_name(type), type));
+	cmd._cmd = L"LA";
+	cmd._args.push_back(name);
+	cmd._args.push_back(B1_CMP_ARG(Utils::get_type_name(type), type));
 
 	insert(pos, cmd);
 
@@ -2394,13 +2738,13 @@ std::wstring B1_CMP_CMDS::emit_command(const std::wstring &name, const_iterator
 	B1_CMP_CMD cmd(_curr_line_num, _curr_line_cnt, _curr_src_file_id, _curr_src_line_id);
 
 	cmd.type = B1_CMD_TYPE::B1_CMD_TYPE_COMMAND;
-	cmd.cmd = name;
+	cmd._cmd = name;
 	
 	//cmd.args = args;
-	cmd.args.clear();
+	cmd._args.clear();
 	for(const auto &a: args)
 	{
-		cmd.args.push_back(B1_CMP_ARG(a));
+		cmd._args.push_back(B1_CMP_ARG(a));
 	}
 
 	insert(pos, cmd);
@@ -2428,13 +2772,13 @@ std::wstring B1_CMP_CMDS::emit_command(const std::wstring &name, const_iterator
 	B1_CMP_CMD cmd(_curr_line_num, _curr_line_cnt, _curr_src_file_id, _curr_src_line_id);
 
 	cmd.type = B1_CMD_TYPE::B1_CMD_TYPE_COMMAND;
-	cmd.cmd = name;
+	cmd._cmd = name;
 	
 	//cmd.args = args;
-	cmd.args.clear();
+	cmd._args.clear();
 	for(const auto &a : args)
 	{
-		cmd.args.push_back(B1_CMP_ARG(a.value, a.type));
+		cmd._args.push_back(B1_CMP_ARG(a.value, a.type));
 	}
 	
 	insert(pos, cmd);
@@ -2457,8 +2801,8 @@ std::wstring B1_CMP_CMDS::emit_command(const std::wstring &name, const_iterator
 	B1_CMP_CMD cmd(_curr_line_num, _curr_line_cnt, _curr_src_file_id, _curr_src_line_id);
 
 	cmd.type = B1_CMD_TYPE::B1_CMD_TYPE_COMMAND;
-	cmd.cmd = name;
-	std::copy(args.begin(), args.end(), std::back_inserter(cmd.args));
+	cmd._cmd = name;
+	std::copy(args.begin(), args.end(), std::back_inserter(cmd._args));
 	insert(pos, cmd);
 	return name;
 }
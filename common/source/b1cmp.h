@@ -13,16 +13,222 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <unordered_set>
 #include <iterator>
 
 #include "Utils.h"
 
 
 class B1_CMP_CMD;
+class B1_CMP_CMDS;
 class B1_CMP_ARG;
 class B1_TYPED_VALUE;
 
 
+// interned string (atom): equal strings share the same string object from the process-wide atoms table,
+// so atoms are copied and compared by pointer, the string itself is used for output and string operations
+class B1_ATOM
+{
+protected:
+	const std::wstring *_str;
+
+	static const std::wstring *intern(const std::wstring &str);
+
+public:
+	B1_ATOM();
+	B1_ATOM(const std::wstring &str);
+	B1_ATOM(const wchar_t *str);
+
+	operator const std::wstring &() const
+	{
+		return *_str;
+	}
+
+	const std::wstring &str() const
+	{
+		return *_str;
+	}
+
+	const wchar_t *c_str() const
+	{
+		return _str->c_str();
+	}
+
+	bool empty() const
+	{
+		return _str->empty();
+	}
+
+	size_t length() const
+	{
+		return _str->length();
+	}
+
+	size_t size() const
+	{
+		return _str->size();
+	}
+
+	wchar_t operator[](size_t pos) const
+	{
+		return (*_str)[pos];
+	}
+
+	wchar_t front() const
+	{
+		return _str->front();
+	}
+
+	wchar_t back() const
+	{
+		return _str->back();
+	}
+
+	std::wstring::const_iterator begin() const
+	{
+		return _str->cbegin();
+	}
+
+	std::wstring::const_iterator end() const
+	{
+		return _str->cend();
+	}
+
+	std::wstring substr(size_t pos = 0, size_t n = std::wstring::npos) const
+	{
+		return _str->substr(pos, n);
+	}
+
+	size_t find(const std::wstring &str, size_t pos = 0) const
+	{
+		return _str->find(str, pos);
+	}
+
+	size_t find(wchar_t c, size_t pos = 0) const
+	{
+		return _str->find(c, pos);
+	}
+
+	size_t rfind(const std::wstring &str, size_t pos = std::wstring::npos) const
+	{
+		return _str->rfind(str, pos);
+	}
+
+	size_t rfind(wchar_t c, size_t pos = std::wstring::npos) const
+	{
+		return _str->rfind(c, pos);
+	}
+
+	size_t find_first_of(const std::wstring &str, size_t pos = 0) const
+	{
+		return _str->find_first_of(str, pos);
+	}
+
+	size_t find_last_of(const std::wstring &str, size_t pos = std::wstring::npos) const
+	{
+		return _str->find_last_of(str, pos);
+	}
+
+	int compare(size_t pos, size_t n, const std::wstring &str) const
+	{
+		return _str->compare(pos, n, str);
+	}
+
+	// modifying functions replace the atom with another one
+	void clear();
+	void pop_back();
+	B1_ATOM &erase(size_t pos = 0, size_t n = std::wstring::npos);
+	B1_ATOM &insert(size_t pos, const std::wstring &str);
+	B1_ATOM &operator+=(const std::wstring &str);
+
+	bool operator==(const B1_ATOM &atom) const
+	{
+		return _str == atom._str;
+	}
+
+	bool operator!=(const B1_ATOM &atom) const
+	{
+		return _str != atom._str;
+	}
+
+	bool operator==(const std::wstring &str) const
+	{
+		return *_str == str;
+	}
+
+	bool operator!=(const std::wstring &str) const
+	{
+		return *_str != str;
+	}
+
+	bool operator==(const wchar_t *str) const
+	{
+		return *_str == str;
+	}
+
+	bool operator!=(const wchar_t *str) const
+	{
+		return *_str != str;
+	}
+
+	// atoms are ordered by their strings so containers of atoms are iterated in the same order as containers of strings
+	bool operator<(const B1_ATOM &atom) const
+	{
+		return _str != atom._str && *_str < *atom._str;
+	}
+};
+
+inline bool operator==(const std::wstring &str, const B1_ATOM &atom)
+{
+	return atom == str;
+}
+
+inline bool operator!=(const std::wstring &str, const B1_ATOM &atom)
+{
+	return atom != str;
+}
+
+inline bool operator==(const wchar_t *str, const B1_ATOM &atom)
+{
+	return atom == str;
+}
+
+inline bool operator!=(const wchar_t *str, const B1_ATOM &atom)
+{
+	return atom != str;
+}
+
+inline std::wstring operator+(const B1_ATOM &atom, const std::wstring &str)
+{
+	return atom.str() + str;
+}
+
+inline std::wstring operator+(const std::wstring &str, const B1_ATOM &atom)
+{
+	return str + atom.str();
+}
+
+inline std::wstring operator+(const B1_ATOM &atom, const wchar_t *str)
+{
+	return atom.str() + str;
+}
+
+inline std::wstring operator+(const wchar_t *str, const B1_ATOM &atom)
+{
+	return str + atom.str();
+}
+
+inline std::wstring operator+(const B1_ATOM &atom, wchar_t c)
+{
+	return atom.str() + c;
+}
+
+inline std::wstring operator+(wchar_t c, const B1_ATOM &atom)
+{
+	return c + atom.str();
+}
+
+
 class B1CUtils
 {
 public:
@@ -59,16 +265,16 @@ public:
 
 	static int get_fn_arg_index(const std::wstring &name);
 
-	static bool is_src(const B1_CMP_CMD &cmd, const std::wstring &val);
-	static bool is_dst(const B1_CMP_CMD &cmd, const std::wstring &val);
-	static bool is_sub_or_arg(const B1_CMP_CMD &cmd, const std::wstring &val);
-	static bool is_used(const B1_CMP_CMD &cmd, const std::wstring &val);
+	static bool is_src(const B1_CMP_CMD &cmd, const B1_ATOM &val);
+	static bool is_dst(const B1_CMP_CMD &cmd, const B1_ATOM &val);
+	static bool is_sub_or_arg(const B1_CMP_CMD &cmd, const B1_ATOM &val);
+	static bool is_used(const B1_CMP_CMD &cmd, const B1_ATOM &val);
 
-	static bool replace_dst(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CMP_ARG &arg, bool preserve_type = false);
-	static bool replace_src(B1_CMP_CMD &cmd, const std::wstring &val, const B1_CMP_ARG &arg, int *count_replaced = nullptr);
+	static bool replace_dst(B1_CMP_CMD &cmd, const B1_ATOM &val, const B1_CMP_ARG &arg, bool preserve_type = false);
+	static bool replace_src(B1_CMP_CMD &cmd, const B1_ATOM &val, const B1_CMP_ARG &arg, int *count_replaced = nullptr);
 	static bool replace_src(B1_CMP_CMD &cmd, const B1_CMP_ARG &src_arg, const B1_CMP_ARG &arg, int *count_replaced = nullptr);
-	static bool replace_src_with_subs(B1_CMP_CMD &cmd, const std::wstring &val, const B1_TYPED_VALUE &tv, bool preserve_type = false);
-	static bool replace_all(B1_CMP_CMD &cmd, const std::wstring &val, const B1_TYPED_VALUE &tv, bool preserve_type = false);
+	static bool replace_src_with_subs(B1_CMP_CMD &cmd, const B1_ATOM &val, const B1_TYPED_VALUE &tv, bool preserve_type = false);
+	static bool replace_all(B1_CMP_CMD &cmd, const B1_ATOM &val, const B1_TYPED_VALUE &tv, bool preserve_type = false);
 
 	static bool arg_is_src(const B1_CMP_CMD &cmd, const B1_CMP_ARG &arg);
 	// if is_local = true, the function compares variable by name only (because locals can be reused with different types)
@@ -104,10 +310,12 @@ class B1_TYPED_VALUE
 {
 public:
 	B1Types type;
-	std::wstring value;
+	B1_ATOM value;
 
 	B1_TYPED_VALUE();
+	B1_TYPED_VALUE(const B1_ATOM &val, const B1Types tp = B1Types::B1T_UNKNOWN);
 	B1_TYPED_VALUE(const std::wstring &val, const B1Types tp = B1Types::B1T_UNKNOWN);
+	B1_TYPED_VALUE(const wchar_t *val, const B1Types tp = B1Types::B1T_UNKNOWN);
 
 	bool operator!=(const B1_TYPED_VALUE &tv) const;
 
@@ -118,7 +326,9 @@ class B1_CMP_ARG: public std::vector<B1_TYPED_VALUE>
 {
 public:
 	B1_CMP_ARG();
+	B1_CMP_ARG(const B1_ATOM &val, const B1Types tp = B1Types::B1T_UNKNOWN);
 	B1_CMP_ARG(const std::wstring &val, const B1Types tp = B1Types::B1T_UNKNOWN);
+	B1_CMP_ARG(const wchar_t *val, const B1Types tp = B1Types::B1T_UNKNOWN);
 
 	bool operator==(const B1_CMP_ARG &arg) const;
 };
@@ -131,10 +341,23 @@ public:
 
 class B1_CMP_CMD
 {
+	friend class B1_CMP_CMDS;
+
+protected:
+	std::wstring _cmd;
+	B1_CMP_ARGS _args;
+
+	// list the command belongs to (it logs the command changes)
+	B1_CMP_CMDS *_owner;
+
+	void changed();
+
 public:
 	B1_CMD_TYPE type;
-	std::wstring cmd;
-	B1_CMP_ARGS args;
+	// command name and arguments are read-only, they are changed with set_cmd() and edit_args() functions only
+	// (so the list the command belongs to can track the changes, see B1_CMP_CMDS::track_changes())
+	const std::wstring &cmd;
+	const B1_CMP_ARGS &args;
 
 	int32_t line_num;
 	int32_t line_cnt;
@@ -143,12 +366,23 @@ public:
 
 	B1_CMP_CMD() = delete;
 	B1_CMP_CMD(int32_t line_num, int32_t line_cnt, int32_t src_file_id, int32_t src_line_id);
+	// a copy does not belong to any list
+	B1_CMP_CMD(const B1_CMP_CMD &cmd);
+	// the command stays in its list and is logged as changed one
+	B1_CMP_CMD &operator=(const B1_CMP_CMD &cmd);
+
+	void set_cmd(const std::wstring &name);
+	// returns the arguments to change, the command is logged as changed one
+	B1_CMP_ARGS &edit_args();
 
 	void clear();
 };
 
+// the class hides std::list functions inserting and removing commands to log the changes
 class B1_CMP_CMDS: public std::list<B1_CMP_CMD>
 {
+	friend class B1_CMP_CMD;
+
 protected:
 	int32_t _next_label;
 	int32_t _next_local;
@@ -160,9 +394,39 @@ protected:
 	mutable int32_t _curr_src_file_id;
 	mutable int32_t _curr_src_line_id;
 
+	// commands changes log (inserted or changed commands and removed ones), disabled by default
+	bool _track_changes;
+	std::unordered_set<B1_CMP_CMD *> _changed_cmds;
+	std::vector<B1_CMP_CMD *> _removed_cmds;
+
+	void own_cmds();
+	void cmd_inserted(B1_CMP_CMD &cmd);
+	void cmd_removed(B1_CMP_CMD &cmd);
+
 public:
 	B1_CMP_CMDS();
 	B1_CMP_CMDS(const std::wstring &name_space, int32_t next_label = 0, int32_t next_local = 0);
+	B1_CMP_CMDS(const B1_CMP_CMDS &cmds);
+	B1_CMP_CMDS(B1_CMP_CMDS &&cmds);
+
+	B1_CMP_CMDS &operator=(const B1_CMP_CMDS &cmds);
+	B1_CMP_CMDS &operator=(B1_CMP_CMDS &&cmds);
+
+	iterator insert(const_iterator pos, const B1_CMP_CMD &cmd);
+	iterator insert(const_iterator pos, const_iterator first, const_iterator last);
+	void push_back(const B1_CMP_CMD &cmd);
+	iterator erase(const_iterator pos);
+	iterator erase(const_iterator first, const_iterator last);
+	void pop_back();
+	void splice(const_iterator pos, B1_CMP_CMDS &cmds, const_iterator it);
+	void splice(const_iterator pos, B1_CMP_CMDS &cmds, const_iterator first, const_iterator last);
+	void clear();
+
+	// starts logging of the commands changes
+	void track_changes();
+	// returns the commands inserted or changed since the previous call and the removed ones and clears the log,
+	// pointers to removed commands can be used as keys only
+	void get_changes(std::vector<B1_CMP_CMD *> &changed, std::vector<B1_CMP_CMD *> &removed);
 
 	std::wstring get_name_space_prefix() const;
 
@@ -0,0 +1,599 @@
+/*
+ BASIC1 compiler
+ Copyright (c) 2021-2026 Nikolay Pletnev
+ MIT license
+
+ b1ir.cpp: binary intermediate code files
+*/
+
+
+#include "b1ir.h"
+#include "Utils.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+// opcodes of known commands: B1IR_OP_CMDS + index in the table
+#define B1IR_OP_LABEL 0
+#define B1IR_OP_NAMED_CMD 1
+#define B1IR_OP_TEXT 2
+#define B1IR_OP_CMDS 3
+
+static const wchar_t *const ir_cmds[] =
+{
+	L"DEF", L"GA", L"MA", L"LA", L"NS", L"OUT", L"IN", L"GET", L"PUT", L"TRR", L"IOCTL", L"END", L"RET", L"RST", L"RETVAL",
+	L"SET", L"XARG", L"JMP", L"JF", L"JT", L"CALL", L"GF", L"LF", L"IMP", L"INI", L"INL", L"INT", L"USES", L"ERR", L"DAT", L"READ",
+	L"=", L"-", L"!", L"+", L"*", L"/", L"^", L"<<", L">>", L"%", L"&", L"|", L"~", L"==", L"<>", L">", L"<", L">=", L"<="
+};
+
+#define B1IR_CMDS_NUM (sizeof(ir_cmds) / sizeof(ir_cmds[0]))
+
+
+B1IRWriter::B1IRWriter(bool text)
+: _text(text)
+, _fp(nullptr)
+, _line_num(0)
+{
+}
+
+B1IRWriter::~B1IRWriter()
+{
+	if(_fp != nullptr)
+	{
+		std::fclose(_fp);
+	}
+}
+
+uint32_t B1IRWriter::add_string(const std::wstring &str)
+{
+	auto si = _str_ids.find(str);
+	if(si != _str_ids.end())
+	{
+		return si->second;
+	}
+
+	B1IR_STR s;
+	s.off = (uint32_t)_chars.size();
+	s.len = (uint32_t)str.length();
+	_chars.insert(_chars.end(), str.cbegin(), str.cend());
+	_chars.push_back(0);
+	_strs.push_back(s);
+
+	return (_str_ids[str] = (uint32_t)(_strs.size() - 1));
+}
+
+bool B1IRWriter::Open(const std::string &file_name)
+{
+	_file_name = file_name;
+	_line_num = 0;
+
+	if(_text)
+	{
+		_fp = std::fopen(file_name.c_str(), "w");
+		return _fp != nullptr;
+	}
+
+	_chars.clear();
+	_strs.clear();
+	_str_ids.clear();
+	_cmds.clear();
+	_args.clear();
+	_vals.clear();
+
+	return true;
+}
+
+bool B1IRWriter::Close()
+{
+	if(_text)
+	{
+		bool res = _fp != nullptr && std::fclose(_fp) == 0;
+		_fp = nullptr;
+		return res;
+	}
+
+	std::vector<char> data;
+	if(!GetData(data))
+	{
+		return false;
+	}
+
+	auto ofp = std::fopen(_file_name.c_str(), "wb");
+	if(ofp == nullptr)
+	{
+		return false;
+	}
+
+	bool res = std::fwrite(data.data(), data.size(), 1, ofp) == 1;
+
+	return (std::fclose(ofp) == 0) && res;
+}
+
+bool B1IRWriter::GetData(std::vector<char> &data) const
+{
+	if(_text)
+	{
+		return false;
+	}
+
+	B1IR_HEADER hdr;
+	std::memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = B1IR_MAGIC;
+	hdr.version = B1IR_VERSION;
+	hdr.wchar_size = sizeof(wchar_t);
+	hdr.strs_num = (uint32_t)_strs.size();
+	hdr.chars_num = (uint32_t)_chars.size();
+	hdr.cmds_num = (uint32_t)_cmds.size();
+	hdr.args_num = (uint32_t)_args.size();
+	hdr.vals_num = (uint32_t)_vals.size();
+
+	data.clear();
+	data.reserve(sizeof(hdr) + _strs.size() * sizeof(B1IR_STR) + _cmds.size() * sizeof(B1IR_CMD) + _args.size() * sizeof(B1IR_ARG) +
+		_vals.size() * sizeof(B1IR_VAL) + _chars.size() * sizeof(wchar_t));
+
+	auto append = [&data](const void *ptr, size_t size)
+	{
+		data.insert(data.end(), static_cast<const char *>(ptr), static_cast<const char *>(ptr) + size);
+	};
+
+	append(&hdr, sizeof(hdr));
+	append(_strs.data(), _strs.size() * sizeof(B1IR_STR));
+	append(_cmds.data(), _cmds.size() * sizeof(B1IR_CMD));
+	append(_args.data(), _args.size() * sizeof(B1IR_ARG));
+	append(_vals.data(), _vals.size() * sizeof(B1IR_VAL));
+	append(_chars.data(), _chars.size() * sizeof(wchar_t));
+
+	return true;
+}
+
+bool B1IRWriter::WriteComment(const std::wstring &text)
+{
+	_line_num++;
+
+	if(_text)
+	{
+		return std::fwprintf(_fp, L";%ls\n", text.c_str()) >= 0;
+	}
+
+	return true;
+}
+
+bool B1IRWriter::WriteLabel(const std::wstring &name)
+{
+	_line_num++;
+
+	if(_text)
+	{
+		return std::fwprintf(_fp, L":%ls\n", name.c_str()) >= 0;
+	}
+
+	B1IR_CMD c;
+	c.op = B1IR_OP_LABEL;
+	c.args_num = 0;
+	c.name = add_string(Utils::str_toupper(name));
+	c.line_num = _line_num;
+	c.first_arg = (uint32_t)_args.size();
+	_cmds.push_back(c);
+
+	return true;
+}
+
+bool B1IRWriter::write_text_arg(const B1_CMP_ARG &arg)
+{
+	for(auto ai = arg.cbegin(); ai != arg.cend(); ai++)
+	{
+		if(std::fwprintf(_fp, L"%ls%ls", (ai == std::next(arg.cbegin())) ? L"(" : L",", ai->value.c_str()) < 0)
+		{
+			return false;
+		}
+
+		if(ai->type != B1Types::B1T_UNKNOWN)
+		{
+			if(std::fwprintf(_fp, L"<%ls>", Utils::get_type_name(ai->type).c_str()) < 0)
+			{
+				return false;
+			}
+		}
+	}
+
+	if(arg.size() > 1)
+	{
+		if(std::fwprintf(_fp, L")") < 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool B1IRWriter::WriteCommand(const std::wstring &cmd, const std::vector<B1_CMP_ARG> &args)
+{
+	_line_num++;
+
+	if(_text)
+	{
+		if(std::fwprintf(_fp, L"%ls", cmd.c_str()) < 0)
+		{
+			return false;
+		}
+
+		for(const auto &a: args)
+		{
+			if(!write_text_arg(a))
+			{
+				return false;
+			}
+		}
+
+		return std::fwprintf(_fp, L"\n") >= 0;
+	}
+
+	if(args.size() > UINT16_MAX)
+	{
+		return false;
+	}
+
+	const auto cmd_uc = Utils::str_toupper(cmd);
+
+	B1IR_CMD c;
+	c.op = B1IR_OP_NAMED_CMD;
+	c.args_num = (uint16_t)args.size();
+	c.name = 0;
+	c.line_num = _line_num;
+	c.first_arg = (uint32_t)_args.size();
+
+	for(size_t i = 0; i < B1IR_CMDS_NUM; i++)
+	{
+		if(cmd_uc == ir_cmds[i])
+		{
+			c.op = (uint16_t)(B1IR_OP_CMDS + i);
+			break;
+		}
+	}
+
+	if(c.op == B1IR_OP_NAMED_CMD)
+	{
+		c.name = add_string(cmd_uc);
+	}
+
+	_cmds.push_back(c);
+
+	for(const auto &a: args)
+	{
+		B1IR_ARG ia;
+		ia.first_val = (uint32_t)_vals.size();
+		ia.vals_num = (uint32_t)a.size();
+		_args.push_back(ia);
+
+		for(const auto &v: a)
+		{
+			B1IR_VAL iv;
+			iv.str = add_string(B1CUtils::is_str_val(v.value) ? v.value.str() : Utils::str_toupper(v.value));
+			iv.type = (int32_t)v.type;
+			_vals.push_back(iv);
+		}
+	}
+
+	return true;
+}
+
+bool B1IRWriter::WriteText(const std::wstring &line)
+{
+	_line_num++;
+
+	if(_text)
+	{
+		return std::fwprintf(_fp, L"%ls\n", line.c_str()) >= 0;
+	}
+
+	B1IR_CMD c;
+	c.op = B1IR_OP_TEXT;
+	c.args_num = 0;
+	c.name = add_string(line);
+	c.line_num = _line_num;
+	c.first_arg = (uint32_t)_args.size();
+	_cmds.push_back(c);
+
+	return true;
+}
+
+
+B1IRReader::B1IRReader()
+: _data(nullptr)
+, _size(0)
+, _mapped(false)
+, _hdr(nullptr)
+, _cmds(nullptr)
+, _args(nullptr)
+, _vals(nullptr)
+{
+}
+
+B1IRReader::~B1IRReader()
+{
+	Close();
+}
+
+bool B1IRReader::IsIRFile(const std::string &file_name)
+{
+	auto fp = std::fopen(file_name.c_str(), "rb");
+	if(fp == nullptr)
+	{
+		return false;
+	}
+
+	uint32_t magic = 0;
+	bool res = std::fread(&magic, sizeof(magic), 1, fp) == 1 && magic == B1IR_MAGIC;
+
+	std::fclose(fp);
+
+	return res;
+}
+
+// checks header and ranges of all records so the records can be read without checks
+bool B1IRReader::check_file()
+{
+	if(_size < sizeof(B1IR_HEADER))
+	{
+		return false;
+	}
+
+	_hdr = reinterpret_cast<const B1IR_HEADER *>(_data);
+	if(_hdr->magic != B1IR_MAGIC || _hdr->version != B1IR_VERSION || _hdr->wchar_size != sizeof(wchar_t))
+	{
+		return false;
+	}
+
+	const uint64_t size =	sizeof(B1IR_HEADER) + (uint64_t)_hdr->strs_num * sizeof(B1IR_STR) + (uint64_t)_hdr->cmds_num * sizeof(B1IR_CMD) +
+							(uint64_t)_hdr->args_num * sizeof(B1IR_ARG) + (uint64_t)_hdr->vals_num * sizeof(B1IR_VAL) + (uint64_t)_hdr->chars_num * sizeof(wchar_t);
+	if(size != _size)
+	{
+		return false;
+	}
+
+	auto strs = reinterpret_cast<const B1IR_STR *>(_data + sizeof(B1IR_HEADER));
+	_cmds = reinterpret_cast<const B1IR_CMD *>(strs + _hdr->strs_num);
+	_args = reinterpret_cast<const B1IR_ARG *>(_cmds + _hdr->cmds_num);
+	_vals = reinterpret_cast<const B1IR_VAL *>(_args + _hdr->args_num);
+	auto chars = reinterpret_cast<const wchar_t *>(_vals + _hdr->vals_num);
+
+	_atoms.clear();
+	_atoms.reserve(_hdr->strs_num);
+	for(uint32_t i = 0; i < _hdr->strs_num; i++)
+	{
+		if((uint64_t)strs[i].off + strs[i].len >= _hdr->chars_num)
+		{
+			return false;
+		}
+		_atoms.push_back(B1_ATOM(std::wstring(chars + strs[i].off, strs[i].len)));
+	}
+
+	for(uint32_t i = 0; i < _hdr->cmds_num; i++)
+	{
+		const auto &c = _cmds[i];
+		if(	c.op >= B1IR_OP_CMDS + B1IR_CMDS_NUM || (c.op < B1IR_OP_CMDS && c.name >= _hdr->strs_num) ||
+			(uint64_t)c.first_arg + c.args_num > _hdr->args_num)
+		{
+			return false;
+		}
+	}
+
+	for(uint32_t i = 0; i < _hdr->args_num; i++)
+	{
+		if((uint64_t)_args[i].first_val + _args[i].vals_num > _hdr->vals_num)
+		{
+			return false;
+		}
+	}
+
+	for(uint32_t i = 0; i < _hdr->vals_num; i++)
+	{
+		if(_vals[i].str >= _hdr->strs_num)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool B1IRReader::Open(const std::string &file_name)
+{
+	Close();
+
+#ifdef _WIN32
+	auto fh = ::CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(fh == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if(!::GetFileSizeEx(fh, &size) || size.QuadPart < (LONGLONG)sizeof(B1IR_HEADER))
+	{
+		::CloseHandle(fh);
+		return false;
+	}
+
+	auto mh = ::CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+	::CloseHandle(fh);
+	if(mh == NULL)
+	{
+		return false;
+	}
+
+	auto data = ::MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+	::CloseHandle(mh);
+	if(data == NULL)
+	{
+		return false;
+	}
+
+	_data = static_cast<const char *>(data);
+	_size = size.QuadPart;
+#else
+	int fd = ::open(file_name.c_str(), O_RDONLY);
+	if(fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if(::fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(B1IR_HEADER))
+	{
+		::close(fd);
+		return false;
+	}
+
+	auto data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	_data = static_cast<const char *>(data);
+	_size = st.st_size;
+#endif
+
+	_mapped = true;
+
+	if(!check_file())
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool B1IRReader::Open(const char *data, size_t size)
+{
+	Close();
+
+	_data = data;
+	_size = size;
+
+	if(!check_file())
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void B1IRReader::Close()
+{
+	if(_data != nullptr && _mapped)
+	{
+#ifdef _WIN32
+		::UnmapViewOfFile(_data);
+#else
+		::munmap(const_cast<char *>(_data), _size);
+#endif
+	}
+
+	_data = nullptr;
+	_size = 0;
+	_mapped = false;
+	_hdr = nullptr;
+	_cmds = nullptr;
+	_args = nullptr;
+	_vals = nullptr;
+	_atoms.clear();
+}
+
+uint32_t B1IRReader::GetCmdsNum() const
+{
+	return (_hdr == nullptr) ? 0 : _hdr->cmds_num;
+}
+
+bool B1IRReader::ReadCmd(uint32_t cmd_num, bool &is_label, std::wstring &cmd, std::vector<B1_CMP_ARG> &args, int32_t &line_num) const
+{
+	if(cmd_num >= GetCmdsNum())
+	{
+		return false;
+	}
+
+	const auto &c = _cmds[cmd_num];
+
+	is_label = c.op == B1IR_OP_LABEL;
+	cmd = (c.op < B1IR_OP_CMDS) ? _atoms[c.name].str() : ir_cmds[c.op - B1IR_OP_CMDS];
+	line_num = c.line_num;
+
+	args.resize(c.args_num);
+	for(uint32_t i = 0; i < c.args_num; i++)
+	{
+		const auto &a = _args[c.first_arg + i];
+		auto &arg = args[i];
+
+		arg.clear();
+		for(uint32_t j = 0; j < a.vals_num; j++)
+		{
+			const auto &v = _vals[a.first_val + j];
+			arg.push_back(B1_TYPED_VALUE(_atoms[v.str], static_cast<B1Types>(v.type)));
+		}
+	}
+
+	return true;
+}
+
+bool B1IRReader::IsTextCmd(uint32_t cmd_num) const
+{
+	return cmd_num < GetCmdsNum() && _cmds[cmd_num].op == B1IR_OP_TEXT;
+}
+
+std::wstring B1IRReader::GetCmdText(uint32_t cmd_num) const
+{
+	bool is_label = false;
+	std::wstring cmd;
+	std::vector<B1_CMP_ARG> args;
+	int32_t line_num = 0;
+
+	if(!ReadCmd(cmd_num, is_label, cmd, args, line_num))
+	{
+		return std::wstring();
+	}
+
+	if(is_label)
+	{
+		return L":" + cmd;
+	}
+
+	if(IsTextCmd(cmd_num))
+	{
+		return cmd;
+	}
+
+	for(const auto &a: args)
+	{
+		for(auto ai = a.cbegin(); ai != a.cend(); ai++)
+		{
+			cmd += (ai == std::next(a.cbegin())) ? L"(" : L",";
+			cmd += ai->value.str();
+
+			if(ai->type != B1Types::B1T_UNKNOWN)
+			{
+				cmd += L"<" + Utils::get_type_name(ai->type) + L">";
+			}
+		}
+
+		if(a.size() > 1)
+		{
+			cmd += L")";
+		}
+	}
+
+	return cmd;
+}
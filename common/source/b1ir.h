@@ -0,0 +1,159 @@
+/*
+ BASIC1 compiler
+ Copyright (c) 2021-2026 Nikolay Pletnev
+ MIT license
+
+ b1ir.h: binary intermediate code files
+*/
+
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "b1cmp.h"
+
+
+// binary intermediate code file format:
+// header, string table, commands, arguments, values, characters of all strings (zero-terminated)
+// command: opcode (label, one of the known commands, a command with name from the string table or a text line
+// to be loaded the same way the text form is), text form line number, arguments range. argument: values range
+// (the first value and optional subscripts or function arguments). value: string index and type (B1T_UNKNOWN for
+// values written without type). library archives store their files in the same form (see libarc.h)
+#define B1IR_MAGIC 0x52493142
+#define B1IR_VERSION 2
+
+struct B1IR_HEADER
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t wchar_size;
+	uint32_t strs_num;
+	uint32_t chars_num;
+	uint32_t cmds_num;
+	uint32_t args_num;
+	uint32_t vals_num;
+	uint32_t reserved;
+};
+
+struct B1IR_STR
+{
+	// offset in characters
+	uint32_t off;
+	uint32_t len;
+};
+
+struct B1IR_CMD
+{
+	uint16_t op;
+	uint16_t args_num;
+	// label, command name or text line (for labels, unknown commands and text lines)
+	uint32_t name;
+	int32_t line_num;
+	uint32_t first_arg;
+};
+
+struct B1IR_ARG
+{
+	uint32_t first_val;
+	uint32_t vals_num;
+};
+
+struct B1IR_VAL
+{
+	uint32_t str;
+	int32_t type;
+};
+
+
+// writes intermediate code either in binary form (default) or as text (the text form is the same the
+// intermediate code compiler reads from library files, it can be used for debugging). values written
+// in binary form are normalized the way the text loader does it (names are converted to upper case)
+class B1IRWriter
+{
+protected:
+	bool _text;
+	std::string _file_name;
+	std::FILE *_fp;
+
+	// number of the current line of the text form (used for error messages in both forms)
+	int32_t _line_num;
+
+	// string table
+	std::vector<wchar_t> _chars;
+	std::vector<B1IR_STR> _strs;
+	std::unordered_map<std::wstring, uint32_t> _str_ids;
+
+	std::vector<B1IR_CMD> _cmds;
+	std::vector<B1IR_ARG> _args;
+	std::vector<B1IR_VAL> _vals;
+
+	uint32_t add_string(const std::wstring &str);
+	bool write_text_arg(const B1_CMP_ARG &arg);
+
+
+public:
+	B1IRWriter(bool text);
+	~B1IRWriter();
+
+	bool Open(const std::string &file_name);
+	bool Close();
+	// gets binary form of the code written (instead of writing it to the file with Close() call)
+	bool GetData(std::vector<char> &data) const;
+
+	// comments are written in text form only
+	bool WriteComment(const std::wstring &text);
+	bool WriteLabel(const std::wstring &name);
+	// arguments of B1T_UNKNOWN type are written without type
+	bool WriteCommand(const std::wstring &cmd, const std::vector<B1_CMP_ARG> &args);
+	// writes the line as is (for lines that can be loaded as text only, e.g. inline assembler code)
+	bool WriteText(const std::wstring &line);
+};
+
+
+// reads binary intermediate code file: the file is mapped into memory and its records are read
+// in place, strings are converted to atoms once when the file is opened
+class B1IRReader
+{
+protected:
+	const char *_data;
+	size_t _size;
+	// the data is mapped by the reader (not provided by caller)
+	bool _mapped;
+
+	const B1IR_HEADER *_hdr;
+	const B1IR_CMD *_cmds;
+	const B1IR_ARG *_args;
+	const B1IR_VAL *_vals;
+
+	std::vector<B1_ATOM> _atoms;
+
+	bool check_file();
+
+
+public:
+	B1IRReader();
+	~B1IRReader();
+
+	// checks if the file starts with binary intermediate code file signature
+	static bool IsIRFile(const std::string &file_name);
+
+	bool Open(const std::string &file_name);
+	// reads binary intermediate code placed in memory (e.g. an archived library file), the data should
+	// stay valid until the reader is closed
+	bool Open(const char *data, size_t size);
+	void Close();
+
+	uint32_t GetCmdsNum() const;
+
+	// reads label name or command name and arguments, line_num is the record's line number in the text form,
+	// text line records are returned as commands without arguments with the line in cmd
+	bool ReadCmd(uint32_t cmd_num, bool &is_label, std::wstring &cmd, std::vector<B1_CMP_ARG> &args, int32_t &line_num) const;
+	bool IsTextCmd(uint32_t cmd_num) const;
+	// returns the record in text form
+	std::wstring GetCmdText(uint32_t cmd_num) const;
+};
@@ -12,8 +12,12 @@
 #include <algorithm>
 #include <filesystem>
 #include <array>
+#include <chrono>
 
 #include "moresym.h"
+#include "libarc.h"
+#include "b1ir.h"
+#include "timerep.h"
 
 #include "c1.h"
 
@@ -403,6 +407,8 @@ C1_T_ERROR C1Compiler::load_inline(size_t offset, const std::wstring &line, iter
 		return C1_T_ERROR::C1_RES_EFOPEN;
 	}
 
+	_cache_deps.insert(get_alt_fn_name(tv.value));
+
 	if(_inline_code.find(file_name) != _inline_code.end())
 	{
 		return C1_T_ERROR::C1_RES_ERECURINL;
@@ -410,18 +416,35 @@ C1_T_ERROR C1Compiler::load_inline(size_t offset, const std::wstring &line, iter
 
 	_inline_code.insert(file_name);
 
-	std::FILE *fp = std::fopen(file_name.c_str(), "r");
-	if(fp == nullptr)
+	LibFileReader reader;
+	if(!reader.Open(file_name))
 	{
 		return C1_T_ERROR::C1_RES_EFOPEN;
 	}
 
+	// archived files are stored in binary intermediate code form
+	B1IRReader ir_reader;
+	uint32_t ir_cmd_num = 0;
+	if(reader.IsArchived())
+	{
+		size_t size = 0;
+		int32_t lines_num = 0;
+
+		auto data = reader.GetData(size, lines_num);
+		if(!ir_reader.Open(data, size))
+		{
+			return C1_T_ERROR::C1_RES_EFOPEN;
+		}
+	}
+
 	auto saved_ns = _curr_name_space;
 	_curr_name_space = gen_next_tmp_namespace();
 
 	_last_dat_namespace.clear();
 
 	std::wstring inl_line;
+	int32_t inl_line_num = 0;
+	std::vector<B1_CMP_ARG> inl_fields;
 
 	auto start = empty() ? end() : std::prev(load_at);
 
@@ -440,19 +463,43 @@ C1_T_ERROR C1Compiler::load_inline(size_t offset, const std::wstring &line, iter
 
 	while(true)
 	{
-		err = static_cast<C1_T_ERROR>(Utils::read_line(fp, inl_line));
-		if(err == static_cast<C1_T_ERROR>(B1_RES_EEOF))
+		if(reader.IsArchived())
 		{
-			err = C1_T_ERROR::C1_RES_OK;
-			if(inl_line.empty())
+			if(ir_cmd_num >= ir_reader.GetCmdsNum())
 			{
 				break;
 			}
-		}
 
-		if(err != C1_T_ERROR::C1_RES_OK)
+			// only text lines can contain inline code parameters
+			bool is_label = false;
+			ir_reader.ReadCmd(ir_cmd_num, is_label, inl_line, inl_fields, inl_line_num);
+			if(!ir_reader.IsTextCmd(ir_cmd_num++))
+			{
+				err = load_ir_cmd(false, is_label, inl_line, inl_fields, load_at, pure_asm);
+				if(err != C1_T_ERROR::C1_RES_OK)
+				{
+					break;
+				}
+
+				continue;
+			}
+		}
+		else
 		{
-			break;
+			err = static_cast<C1_T_ERROR>(reader.ReadLine(inl_line, inl_line_num));
+			if(err == static_cast<C1_T_ERROR>(B1_RES_EEOF))
+			{
+				err = C1_T_ERROR::C1_RES_OK;
+				if(inl_line.empty())
+				{
+					break;
+				}
+			}
+
+			if(err != C1_T_ERROR::C1_RES_OK)
+			{
+				break;
+			}
 		}
 
 		bool empty_val = false;
@@ -481,7 +528,8 @@ C1_T_ERROR C1Compiler::load_inline(size_t offset, const std::wstring &line, iter
 
 	_curr_name_space = saved_ns;
 
-	std::fclose(fp);
+	ir_reader.Close();
+	reader.Close();
 
 	if(_inline_asm && err == C1_T_ERROR::C1_RES_OK)
 	{
@@ -529,6 +577,196 @@ C1_T_ERROR C1Compiler::load_inline(size_t offset, const std::wstring &line, iter
 	return err;
 }
 
+// reads value with optional type (B1T_UNKNOWN for values without type, B1T_INVALID for invalid type names),
+// delim is set to the delimiter the value ends with (0 if the end of the string is reached)
+C1_T_ERROR C1Compiler::get_field_value(const std::wstring &str, const std::wstring &delimiters, B1_TYPED_VALUE &tv, wchar_t &delim, size_t &next_off) const
+{
+	tv.value = Utils::str_trim(get_next_value(str, L"<" + delimiters, next_off));
+	tv.type = B1Types::B1T_UNKNOWN;
+
+	if(next_off != std::wstring::npos && str[next_off - 1] == L'<')
+	{
+		const auto type = Utils::str_trim(get_next_value(str, L">", next_off));
+		if(next_off == std::wstring::npos)
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+		tv.type = check_type_name(type) ? Utils::get_type_by_name(type) : B1Types::B1T_INVALID;
+
+		if(!Utils::str_trim(get_next_value(str, delimiters, next_off)).empty())
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+	}
+
+	delim = (next_off == std::wstring::npos) ? 0 : str[next_off - 1];
+
+	return C1_T_ERROR::C1_RES_OK;
+}
+
+// splits command arguments into fields: value<type>(value<type>, ...), types and values in parentheses are optional
+C1_T_ERROR C1Compiler::get_fields(const std::wstring &str, std::vector<B1_CMP_ARG> &fields, size_t &next_off) const
+{
+	fields.clear();
+
+	while(next_off != std::wstring::npos)
+	{
+		B1_CMP_ARG field;
+		B1_TYPED_VALUE tv;
+		wchar_t delim = 0;
+
+		auto err = get_field_value(str, L",(", tv, delim, next_off);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		field.push_back(tv);
+
+		if(delim == L'(')
+		{
+			while(true)
+			{
+				err = get_field_value(str, L",)", tv, delim, next_off);
+				if(err != C1_T_ERROR::C1_RES_OK)
+				{
+					return err;
+				}
+				// empty values without type are omitted function arguments
+				if(delim == 0 || (tv.value.empty() && tv.type != B1Types::B1T_UNKNOWN))
+				{
+					return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+				}
+				field.push_back(tv);
+
+				if(delim == L')')
+				{
+					if(!Utils::str_trim(get_next_value(str, L",", next_off)).empty())
+					{
+						return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+					}
+
+					break;
+				}
+			}
+		}
+
+		fields.push_back(field);
+	}
+
+	return C1_T_ERROR::C1_RES_OK;
+}
+
+// reads field consisting of a single value without type
+C1_T_ERROR C1Compiler::get_simple_field(const std::vector<B1_CMP_ARG> &fields, size_t &fi, B1_TYPED_VALUE &tv, bool allow_empty /*= false*/) const
+{
+	if(fi >= fields.size())
+	{
+		return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+	}
+
+	const auto &field = fields[fi++];
+	if(field.size() != 1 || field[0].type != B1Types::B1T_UNKNOWN || (!allow_empty && field[0].value.empty()))
+	{
+		return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+	}
+
+	tv = field[0];
+
+	return C1_T_ERROR::C1_RES_OK;
+}
+
+// reads typed value with optional typed subscripts or function arguments (the same as get_arg() but for fields)
+C1_T_ERROR C1Compiler::get_typed_field(const std::vector<B1_CMP_ARG> &fields, size_t &fi, B1_CMP_ARG &arg) const
+{
+	bool check_optional = false;
+
+	if(fi >= fields.size())
+	{
+		return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+	}
+
+	arg = fields[fi++];
+
+	for(auto tvi = arg.begin(); tvi != arg.end(); tvi++)
+	{
+		if(tvi != arg.begin() && tvi->value.empty() && tvi->type == B1Types::B1T_UNKNOWN)
+		{
+			// probably omitted function argument
+			check_optional = true;
+			continue;
+		}
+
+		if(tvi->type == B1Types::B1T_UNKNOWN)
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+		if(!check_label_name(tvi->value) && !check_num_val(tvi->value) && !check_str_val(tvi->value) && !check_stdfn_name(tvi->value))
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+		if(tvi->type == B1Types::B1T_INVALID)
+		{
+			return C1_T_ERROR::C1_RES_EINVTYPNAME;
+		}
+
+		tvi->value = add_namespace(tvi->value);
+	}
+
+	if(check_optional)
+	{
+		auto fn = get_fn(arg);
+		if(fn == nullptr)
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+
+		for(int i = 0; i < fn->args.size(); i++)
+		{
+			if(arg[i + 1].value.empty())
+			{
+				if(fn->args[i].optional)
+				{
+					arg[i + 1].value = fn->args[i].defval;
+					arg[i + 1].type = fn->args[i].type;
+				}
+				else
+				{
+					return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+				}
+			}
+		}
+	}
+
+	return C1_T_ERROR::C1_RES_OK;
+}
+
+C1_T_ERROR C1Compiler::load_label(const std::wstring &name, const_iterator pos, bool pure_asm)
+{
+	if(!check_label_name(name))
+	{
+		return C1_T_ERROR::C1_RES_EINVLBNAME;
+	}
+	const auto lname = add_namespace(Utils::str_toupper(name));
+
+	if(_inline_asm)
+	{
+		_asm_stmt_it->edit_args().push_back(L":" + lname + L"\n");
+	}
+	else
+	{
+		if(pure_asm)
+		{
+			return C1_T_ERROR::C1_RES_EINTERR;
+		}
+
+		emit_label(lname, pos, true);
+	}
+
+	_all_symbols.insert(lname);
+
+	return C1_T_ERROR::C1_RES_OK;
+}
+
 C1_T_ERROR C1Compiler::load_next_command(const std::wstring &line, const_iterator pos, bool pure_asm)
 {
 	auto b = line.cbegin();
@@ -555,38 +793,11 @@ C1_T_ERROR C1Compiler::load_next_command(const std::wstring &line, const_iterato
 	if(b != e)
 	{		
 		std::wstring cmd;
-		B1_TYPED_VALUE tv;
-		B1_CMP_ARG arg;
-		std::vector<B1_CMP_ARG> args;
 
 		// label
 		if(*b == L':')
 		{
-			b++;
-			std::wstring lname(b, e);
-			if(!check_label_name(lname))
-			{
-				return C1_T_ERROR::C1_RES_EINVLBNAME;
-			}
-			lname = add_namespace(Utils::str_toupper(lname));
-			
-			if(_inline_asm)
-			{
-				_asm_stmt_it->args.push_back(L":" + lname + L"\n");
-			}
-			else
-			{
-				if(pure_asm)
-				{
-					return C1_T_ERROR::C1_RES_EINTERR;
-				}
-
-				emit_label(lname, pos, true);
-			}
-
-			_all_symbols.insert(lname);
-
-			return C1_T_ERROR::C1_RES_OK;
+			return load_label(std::wstring(std::next(b), e), pos, pure_asm);
 		}
 
 		const std::wstring tmpline(b, e);
@@ -642,28 +853,64 @@ C1_T_ERROR C1Compiler::load_next_command(const std::wstring &line, const_iterato
 			return C1_T_ERROR::C1_RES_EINTERR;
 		}
 
-		if(cmd != L"DAT")
+		std::vector<B1_CMP_ARG> fields;
+		err = get_fields(tmpline, fields, offset);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+
+		return load_command(cmd, fields, pos);
+	}
+
+	return C1_T_ERROR::C1_RES_OK;
+}
+
+// loads command from its fields read from text or binary intermediate code
+C1_T_ERROR C1Compiler::load_command(std::wstring cmd, const std::vector<B1_CMP_ARG> &fields, const_iterator pos)
+{
+	C1_T_ERROR err = C1_T_ERROR::C1_RES_OK;
+	size_t fi = 0;
+	B1_TYPED_VALUE tv;
+	B1_CMP_ARG arg;
+	std::vector<B1_CMP_ARG> args;
+
+	if(cmd != L"DAT")
+	{
+		_last_dat_namespace.clear();
+	}
+
+	if(cmd == L"DEF")
+	{
+		// read fn name
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
 		{
-			_last_dat_namespace.clear();
+			return err;
+		}
+		if(!check_label_name(tv.value))
+		{
+			return C1_T_ERROR::C1_RES_EINVLBNAME;
 		}
+		tv.value = add_namespace(tv.value);
+		args.push_back(tv.value);
 
-		if(cmd == L"DEF")
+		// read fn return type
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
 		{
-			// read fn name
-			err = get_simple_arg(tmpline, tv, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
-			{
-				return err;
-			}
-			if(!check_label_name(tv.value))
-			{
-				return C1_T_ERROR::C1_RES_EINVLBNAME;
-			}
-			tv.value = add_namespace(tv.value);
-			args.push_back(tv.value);
+			return err;
+		}
+		if(!check_type_name(tv.value))
+		{
+			return C1_T_ERROR::C1_RES_EINVTYPNAME;
+		}
+		args.push_back(B1_CMP_ARG(tv.value, Utils::get_type_by_name(tv.value)));
 
-			// read fn return type
-			err = get_simple_arg(tmpline, tv, offset);
+		// read fn arguments types
+		while(fi < fields.size())
+		{
+			err = get_simple_field(fields, fi, tv);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
@@ -673,614 +920,534 @@ C1_T_ERROR C1Compiler::load_next_command(const std::wstring &line, const_iterato
 				return C1_T_ERROR::C1_RES_EINVTYPNAME;
 			}
 			args.push_back(B1_CMP_ARG(tv.value, Utils::get_type_by_name(tv.value)));
+		}
+	}
+	else
+	if(cmd == L"GA" || cmd == L"MA")
+	{
+		// read var. name
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		if(!check_label_name(tv.value))
+		{
+			return C1_T_ERROR::C1_RES_EINVLBNAME;
+		}
+		tv.value = add_namespace(tv.value);
+		args.push_back(tv.value);
 
-			// read fn arguments types
-			while(offset != std::wstring::npos)
-			{
-				err = get_simple_arg(tmpline, tv, offset);
-				if(err != C1_T_ERROR::C1_RES_OK)
-				{
-					return err;
-				}
-				if(!check_type_name(tv.value))
-				{
-					return C1_T_ERROR::C1_RES_EINVTYPNAME;
-				}
-				args.push_back(B1_CMP_ARG(tv.value, Utils::get_type_by_name(tv.value)));
-			}
+		// read var. type
+		if(fi >= fields.size() || fields[fi].size() > 2 || fields[fi][0].type != B1Types::B1T_UNKNOWN)
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 		}
-		else
-		if(cmd == L"GA" || cmd == L"MA")
+		const auto &type_field = fields[fi++];
+		std::wstring sval = type_field[0].value;
+		if(sval.empty())
 		{
-			// read var. name
-			err = get_simple_arg(tmpline, tv, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
-			{
-				return err;
-			}
-			if(!check_label_name(tv.value))
-			{
-				return C1_T_ERROR::C1_RES_EINVLBNAME;
-			}
-			tv.value = add_namespace(tv.value);
-			args.push_back(tv.value);
-
-			// read var. type
-			auto sval = Utils::str_trim(get_next_value(tmpline, L",(", offset));
-			if(sval.empty())
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+		if(!check_type_name(sval))
+		{
+			return C1_T_ERROR::C1_RES_EINVTYPNAME;
+		}
+		args.push_back(B1_CMP_ARG(sval, Utils::get_type_by_name(sval)));
+
+		bool is_static = false;
+
+		// read optional type modifiers (V - stands for volatile, S - static, C - const)
+		if(type_field.size() > 1)
+		{
+			if(type_field[1].type != B1Types::B1T_UNKNOWN)
 			{
 				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 			}
-			if(!check_type_name(sval))
-			{
-				return C1_T_ERROR::C1_RES_EINVTYPNAME;
-			}
-			args.push_back(B1_CMP_ARG(sval, Utils::get_type_by_name(sval)));
-
-			bool is_static = false;
-
-			// read optional type modifiers (V - stands for volatile, S - static, C - const)
-			if(offset != std::wstring::npos && tmpline[offset - 1] == L'(')
-			{
-				sval = Utils::str_trim(get_next_value(tmpline, L")", offset));
-
-				std::wstring type_mod;
-				auto lpos = sval.find(L'V');
-				if(lpos != std::wstring::npos)
-				{
-					type_mod += L'V';
-					sval.erase(lpos, 1);
-				}
-				lpos = sval.find(L'S');
-				if(lpos != std::wstring::npos)
-				{
-					// here tv.value already contains variable name (for GA stmt)
-					is_static = true;
-					sval.erase(lpos, 1);
-				}
-				lpos = sval.find(L'C');
-				if(lpos != std::wstring::npos)
-				{
-					// here tv.value already contains variable name (for GA stmt), CONST variables are always static
-					is_static = true;
-					type_mod += L'C';
-					sval.erase(lpos, 1);
-				}
-
-				if(!sval.empty())
-				{
-					return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-				}
-
-				if(!type_mod.empty())
-				{
-					args.back().push_back(B1_TYPED_VALUE(type_mod));
-				}
-
-				sval = Utils::str_trim(get_next_value(tmpline, L",", offset));
-				if(!sval.empty())
-				{
-					return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-				}
-			}
+			sval = type_field[1].value;
 
-			// read var. address
-			if(cmd == L"MA")
+			std::wstring type_mod;
+			auto lpos = sval.find(L'V');
+			if(lpos != std::wstring::npos)
 			{
-				err = get_simple_arg(tmpline, tv, offset);
-				if(err != C1_T_ERROR::C1_RES_OK)
-				{
-					return err;
-				}
-				if(!Utils::check_const_name(tv.value) && !check_address(tv.value))
-				{
-					return static_cast<C1_T_ERROR>(B1_RES_EINVNUM);
-				}
+				type_mod += L'V';
+				sval.erase(lpos, 1);
 			}
-			else
-			if(is_static)
+			lpos = sval.find(L'S');
+			if(lpos != std::wstring::npos)
 			{
-				// turn static or const GA stmt into MA with variable name as address
-				cmd = L"MA";
+				// here tv.value already contains variable name (for GA stmt)
+				is_static = true;
+				sval.erase(lpos, 1);
 			}
-
-			if(cmd == L"MA")
+			lpos = sval.find(L'C');
+			if(lpos != std::wstring::npos)
 			{
-				args.push_back(tv.value);
+				// here tv.value already contains variable name (for GA stmt), CONST variables are always static
+				is_static = true;
+				type_mod += L'C';
+				sval.erase(lpos, 1);
 			}
 
-			// get var. size
-			int argnum = 0;
-			while(offset != std::wstring::npos)
+			if(!sval.empty())
 			{
-				err = get_arg(tmpline, arg, offset);
-				if(err != C1_T_ERROR::C1_RES_OK)
-				{
-					return err;
-				}
-				args.push_back(arg);
-				argnum++;
-
-				if(argnum % 2 == 0)
-				{
-					if(	args[args.size() - 2].size() == 1 && args[args.size() - 2 + 1].size() == 1 &&
-						B1CUtils::is_num_val(args[args.size() - 2][0].value) && B1CUtils::is_num_val(args[args.size() - 2 + 1][0].value))
-						{
-							// check immediate subscript range
-							int32_t lb = 0, ub = -1;
-
-							auto err = Utils::str2int32(args[args.size() - 2][0].value, lb);
-							if(err != B1_RES_OK)
-							{
-								return static_cast<C1_T_ERROR>(err);
-							}
-							Utils::correct_int_value(lb, args[args.size() - 2][0].type);
-
-							err = Utils::str2int32(args[args.size() - 2 + 1][0].value, ub);
-							if(err != B1_RES_OK)
-							{
-								return static_cast<C1_T_ERROR>(err);
-							}
-							Utils::correct_int_value(ub, args[args.size() - 2 + 1][0].type);
-
-							if(lb > ub)
-							{
-								return static_cast<C1_T_ERROR>(B1_RES_ESUBSRANGE);
-							}
-						}
-				}
+				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 			}
 
-			if(argnum % 2 != 0)
+			if(!type_mod.empty())
 			{
-				return static_cast<C1_T_ERROR>(B1_RES_EWRARGCNT);
+				args.back().push_back(B1_TYPED_VALUE(type_mod));
 			}
 		}
-		else
-		if(cmd == L"LA")
-		{
-			// read var. name
-			err = get_simple_arg(tmpline, tv, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
-			{
-				return err;
-			}
-			if(!check_label_name(tv.value))
-			{
-				return C1_T_ERROR::C1_RES_EINVLBNAME;
-			}
-			tv.value = add_namespace(tv.value);
-			args.push_back(tv.value);
 
-			// read var. type
-			err = get_simple_arg(tmpline, tv, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
-			{
-				return err;
-			}
-			if(!check_type_name(tv.value))
-			{
-				return C1_T_ERROR::C1_RES_EINVTYPNAME;
-			}
-			args.push_back(B1_CMP_ARG(tv.value, Utils::get_type_by_name(tv.value)));
-		}
-		else
-		if(cmd == L"NS")
+		// read var. address
+		if(cmd == L"MA")
 		{
-			err = get_simple_arg(tmpline, tv, offset);
+			err = get_simple_field(fields, fi, tv);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
 			}
-			if(!check_namespace_name(tv.value))
+			if(!Utils::check_const_name(tv.value) && !check_address(tv.value))
 			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+				return static_cast<C1_T_ERROR>(B1_RES_EINVNUM);
 			}
-			args.push_back(tv.value);
-
-			// set namespace
-			_curr_name_space = tv.value;
 		}
 		else
-		if(cmd == L"OUT" || cmd == L"IN" || cmd == L"GET" || cmd == L"PUT" || cmd == L"TRR")
+		if(is_static)
 		{
-			if(offset == std::wstring::npos)
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
+			// turn static or const GA stmt into MA with variable name as address
+			cmd = L"MA";
+		}
 
-			auto sval = Utils::str_trim(get_next_value(tmpline, L",", offset));
-			args.push_back(sval);
-			if(offset == std::wstring::npos)
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
+		if(cmd == L"MA")
+		{
+			args.push_back(tv.value);
+		}
 
-			err = get_arg(tmpline, arg, offset);
+		// get var. size
+		int argnum = 0;
+		while(fi < fields.size())
+		{
+			err = get_typed_field(fields, fi, arg);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
 			}
+			args.push_back(arg);
+			argnum++;
 
-			if((cmd == L"GET" || cmd == L"TRR") && arg[0].type == B1Types::B1T_STRING)
+			if(argnum % 2 == 0)
 			{
-				return static_cast<C1_T_ERROR>(B1_RES_ETYPMISM);
-			}
+				if(	args[args.size() - 2].size() == 1 && args[args.size() - 2 + 1].size() == 1 &&
+					B1CUtils::is_num_val(args[args.size() - 2][0].value) && B1CUtils::is_num_val(args[args.size() - 2 + 1][0].value))
+					{
+						// check immediate subscript range
+						int32_t lb = 0, ub = -1;
 
-			if(offset != std::wstring::npos)
-			{
-				if(arg[0].type != B1Types::B1T_BYTE)
-				{
-					return static_cast<C1_T_ERROR>(B1_RES_ETYPMISM);
-				}
-				if(arg.size() != 2)
-				{
-					return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-				}
+						auto err = Utils::str2int32(args[args.size() - 2][0].value, lb);
+						if(err != B1_RES_OK)
+						{
+							return static_cast<C1_T_ERROR>(err);
+						}
+						Utils::correct_int_value(lb, args[args.size() - 2][0].type);
 
-				args.push_back(arg);
+						err = Utils::str2int32(args[args.size() - 2 + 1][0].value, ub);
+						if(err != B1_RES_OK)
+						{
+							return static_cast<C1_T_ERROR>(err);
+						}
+						Utils::correct_int_value(ub, args[args.size() - 2 + 1][0].type);
 
-				err = get_arg(tmpline, arg, offset);
-				if(err != C1_T_ERROR::C1_RES_OK)
-				{
-					return err;
-				}
+						if(lb > ub)
+						{
+							return static_cast<C1_T_ERROR>(B1_RES_ESUBSRANGE);
+						}
+					}
 			}
+		}
 
-			args.push_back(arg);
+		if(argnum % 2 != 0)
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_EWRARGCNT);
 		}
-		else
-		if(cmd == L"IOCTL")
+	}
+	else
+	if(cmd == L"LA")
+	{
+		// read var. name
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
 		{
-			if(offset == std::wstring::npos)
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
+			return err;
+		}
+		if(!check_label_name(tv.value))
+		{
+			return C1_T_ERROR::C1_RES_EINVLBNAME;
+		}
+		tv.value = add_namespace(tv.value);
+		args.push_back(tv.value);
 
-			// read device name
-			err = get_arg(tmpline, arg, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
-			{
-				return err;
-			}
-			if(!B1CUtils::is_str_val(arg[0].value))
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
-			args.push_back(arg);
-			auto dev_name = _global_settings.GetIoDeviceName(arg[0].value.substr(1, arg[0].value.length() - 2));
+		// read var. type
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		if(!check_type_name(tv.value))
+		{
+			return C1_T_ERROR::C1_RES_EINVTYPNAME;
+		}
+		args.push_back(B1_CMP_ARG(tv.value, Utils::get_type_by_name(tv.value)));
+	}
+	else
+	if(cmd == L"NS")
+	{
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		if(!check_namespace_name(tv.value))
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+		args.push_back(tv.value);
 
-			if(offset == std::wstring::npos)
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
+		// set namespace
+		_curr_name_space = tv.value;
+	}
+	else
+	if(cmd == L"OUT" || cmd == L"IN" || cmd == L"GET" || cmd == L"PUT" || cmd == L"TRR")
+	{
+		if(fi >= fields.size())
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
 
-			// read command
-			err = get_arg(tmpline, arg, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
+		err = get_simple_field(fields, fi, tv, true);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		args.push_back(tv.value);
+		if(fi >= fields.size())
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+
+		err = get_typed_field(fields, fi, arg);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+
+		if((cmd == L"GET" || cmd == L"TRR") && arg[0].type == B1Types::B1T_STRING)
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ETYPMISM);
+		}
+
+		if(fi < fields.size())
+		{
+			if(arg[0].type != B1Types::B1T_BYTE)
 			{
-				return err;
+				return static_cast<C1_T_ERROR>(B1_RES_ETYPMISM);
 			}
-			if(!B1CUtils::is_str_val(arg[0].value))
+			if(arg.size() != 2)
 			{
 				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 			}
+
 			args.push_back(arg);
-			auto cmd_name = arg[0].value.substr(1, arg[0].value.length() - 2);
 
-			// check data
-			Settings::IoCmd iocmd;
-			if(!_global_settings.GetIoCmd(dev_name, cmd_name, iocmd))
+			err = get_typed_field(fields, fi, arg);
+			if(err != C1_T_ERROR::C1_RES_OK)
 			{
-				return C1_T_ERROR::C1_RES_EUNKIODEV;
+				return err;
 			}
-			if(iocmd.accepts_data)
-			{
-				bool def_val = false;
+		}
 
-				if(offset == std::wstring::npos)
-				{
-					if(!iocmd.def_val.empty())
-					{
-						def_val = true;
-					}
-					else
-					{
-						return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-					}
-				}
+		args.push_back(arg);
+	}
+	else
+	if(cmd == L"IOCTL")
+	{
+		if(fi >= fields.size())
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
 
-				if(def_val)
-				{
-					arg.clear();
-					arg.push_back(L"\"" + iocmd.def_val + L"\"");
-				}
-				else
-				{
-					// read data
-					err = get_arg(tmpline, arg, offset);
-					if(err != C1_T_ERROR::C1_RES_OK)
-					{
-						return err;
-					}
-				}
+		// read device name
+		err = get_typed_field(fields, fi, arg);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		if(!B1CUtils::is_str_val(arg[0].value))
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+		args.push_back(arg);
+		auto dev_name = _global_settings.GetIoDeviceName(arg[0].value.substr(1, arg[0].value.length() - 2));
 
-				if(iocmd.predef_only)
-				{
-					if(!B1CUtils::is_str_val(arg[0].value))
-					{
-						return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-					}
+		if(fi >= fields.size())
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
 
-					auto cmd_data = arg[0].value.substr(1, arg[0].value.length() - 2);
-					if(iocmd.values.find(cmd_data) == iocmd.values.end())
-					{
-						return static_cast<C1_T_ERROR>(B1_RES_ETYPMISM);
-					}
-				}
-				else
-				{
-					if(iocmd.data_type == B1Types::B1T_LABEL)
-					{
-						const auto label = (arg[0].value.length() >= 3 && arg[0].value[0] == L'\"') ? arg[0].value.substr(1, arg[0].value.length() - 2) : arg[0].value;
-						
-						if(!check_label_name(label))
-						{
-							return C1_T_ERROR::C1_RES_EINVLBNAME;
-						}
-						_req_symbols.insert(label);
-						arg[0].value = label;
-						arg[0].type = B1Types::B1T_LABEL;
-					}
-					else
-					if(iocmd.data_type == B1Types::B1T_VARREF)
-					{
-						const auto varname = (arg[0].value.length() >= 3 && arg[0].value[0] == L'\"') ? arg[0].value.substr(1, arg[0].value.length() - 2) : arg[0].value;
-						// the symbol can be either variable reference or a memref (mem. refrences should not be added to _req_symbols)
-						// in case of variable it is added to _req_symbols by corresponding C1Compiler::write_ioctl function
-						//_req_symbols.insert(varname);
-						arg[0].value = varname;
-						arg[0].type = B1Types::B1T_VARREF;
-					}
-					else
-					if(iocmd.data_type == B1Types::B1T_TEXT)
-					{
-						const auto text = (arg[0].value.length() >= 3 && arg[0].value[0] == L'\"') ? arg[0].value.substr(1, arg[0].value.length() - 2) : arg[0].value;
-						arg[0].value = text;
-						arg[0].type = B1Types::B1T_TEXT;
-					}
-					else
-					if(!B1CUtils::are_types_compatible(arg[0].type, iocmd.data_type))
-					{
-						return static_cast<C1_T_ERROR>(B1_RES_ETYPMISM);
-					}
-				}
+		// read command
+		err = get_typed_field(fields, fi, arg);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		if(!B1CUtils::is_str_val(arg[0].value))
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+		args.push_back(arg);
+		auto cmd_name = arg[0].value.substr(1, arg[0].value.length() - 2);
 
-				args.push_back(arg);
-			}
+		// check data
+		Settings::IoCmd iocmd;
+		if(!_global_settings.GetIoCmd(dev_name, cmd_name, iocmd))
+		{
+			return C1_T_ERROR::C1_RES_EUNKIODEV;
 		}
-		else
-		if(cmd == L"END" || cmd == L"RET" || cmd == L"RST")
+		if(iocmd.accepts_data)
 		{
-			if(cmd == L"RST")
+			bool def_val = false;
+
+			if(fi >= fields.size())
 			{
-				// get mandatory namespace name
-				if(offset == std::wstring::npos)
+				if(!iocmd.def_val.empty())
+				{
+					def_val = true;
+				}
+				else
 				{
 					return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 				}
+			}
 
-				err = get_simple_arg(tmpline, tv, offset);
+			if(def_val)
+			{
+				arg.clear();
+				arg.push_back(L"\"" + iocmd.def_val + L"\"");
+			}
+			else
+			{
+				// read data
+				err = get_typed_field(fields, fi, arg);
 				if(err != C1_T_ERROR::C1_RES_OK)
 				{
 					return err;
 				}
-				if(!check_namespace_name(tv.value))
+			}
+
+			if(iocmd.predef_only)
+			{
+				if(!B1CUtils::is_str_val(arg[0].value))
 				{
 					return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 				}
-				args.push_back(tv.value);
-			}
 
-			if(offset != std::wstring::npos)
+				auto cmd_data = arg[0].value.substr(1, arg[0].value.length() - 2);
+				if(iocmd.values.find(cmd_data) == iocmd.values.end())
+				{
+					return static_cast<C1_T_ERROR>(B1_RES_ETYPMISM);
+				}
+			}
+			else
 			{
-				if(cmd == L"RST")
+				if(iocmd.data_type == B1Types::B1T_LABEL)
 				{
-					err = get_simple_arg(tmpline, tv, offset);
-					if(err != C1_T_ERROR::C1_RES_OK)
-					{
-						return err;
-					}
-					if(!check_label_name(tv.value))
+					const auto label = (arg[0].value.length() >= 3 && arg[0].value[0] == L'\"') ? arg[0].value.substr(1, arg[0].value.length() - 2) : arg[0].value.str();
+					
+					if(!check_label_name(label))
 					{
 						return C1_T_ERROR::C1_RES_EINVLBNAME;
 					}
-					tv.value = add_namespace(tv.value);
-					args.push_back(tv.value);
+					_req_symbols.insert(label);
+					arg[0].value = label;
+					arg[0].type = B1Types::B1T_LABEL;
+				}
+				else
+				if(iocmd.data_type == B1Types::B1T_VARREF)
+				{
+					const auto varname = (arg[0].value.length() >= 3 && arg[0].value[0] == L'\"') ? arg[0].value.substr(1, arg[0].value.length() - 2) : arg[0].value.str();
+					// the symbol can be either variable reference or a memref (mem. refrences should not be added to _req_symbols)
+					// in case of variable it is added to _req_symbols by corresponding C1Compiler::write_ioctl function
+					//_req_symbols.insert(varname);
+					arg[0].value = varname;
+					arg[0].type = B1Types::B1T_VARREF;
+				}
+				else
+				if(iocmd.data_type == B1Types::B1T_TEXT)
+				{
+					const auto text = (arg[0].value.length() >= 3 && arg[0].value[0] == L'\"') ? arg[0].value.substr(1, arg[0].value.length() - 2) : arg[0].value.str();
+					arg[0].value = text;
+					arg[0].type = B1Types::B1T_TEXT;
+				}
+				else
+				if(!B1CUtils::are_types_compatible(arg[0].type, iocmd.data_type))
+				{
+					return static_cast<C1_T_ERROR>(B1_RES_ETYPMISM);
 				}
 			}
+
+			args.push_back(arg);
 		}
-		else
-		if(cmd == L"RETVAL")
+	}
+	else
+	if(cmd == L"END" || cmd == L"RET" || cmd == L"RST")
+	{
+		if(cmd == L"RST")
 		{
-			err = get_arg(tmpline, arg, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
+			// get mandatory namespace name
+			if(fi >= fields.size())
 			{
-				return err;
+				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 			}
-			args.push_back(arg);
 
-			err = get_simple_arg(tmpline, tv, offset);
+			err = get_simple_field(fields, fi, tv);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
 			}
-			if(!check_type_name(tv.value))
-			{
-				return C1_T_ERROR::C1_RES_EINVTYPNAME;
-			}
-			args.push_back(B1_CMP_ARG(tv.value, Utils::get_type_by_name(tv.value)));
-		}
-		else
-		if(cmd == L"SET")
-		{
-			if(offset == std::wstring::npos)
+			if(!check_namespace_name(tv.value))
 			{
 				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 			}
-
-			err = get_simple_arg(tmpline, tv, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
-			{
-				return err;
-			}
 			args.push_back(tv.value);
+		}
 
-			if(tv.value == L"ERR")
+		if(fi < fields.size())
+		{
+			if(cmd == L"RST")
 			{
-				err = get_arg(tmpline, arg, offset);
+				err = get_simple_field(fields, fi, tv);
 				if(err != C1_T_ERROR::C1_RES_OK)
 				{
 					return err;
 				}
-				args.push_back(arg);
-			}
-			else
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+				if(!check_label_name(tv.value))
+				{
+					return C1_T_ERROR::C1_RES_EINVLBNAME;
+				}
+				tv.value = add_namespace(tv.value);
+				args.push_back(tv.value);
 			}
 		}
-		else
-		if(cmd == L"XARG")
+	}
+	else
+	if(cmd == L"RETVAL")
+	{
+		err = get_typed_field(fields, fi, arg);
+		if(err != C1_T_ERROR::C1_RES_OK)
 		{
-			if(offset == std::wstring::npos)
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
+			return err;
+		}
+		args.push_back(arg);
 
-			err = get_arg(tmpline, arg, offset);
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		if(!check_type_name(tv.value))
+		{
+			return C1_T_ERROR::C1_RES_EINVTYPNAME;
+		}
+		args.push_back(B1_CMP_ARG(tv.value, Utils::get_type_by_name(tv.value)));
+	}
+	else
+	if(cmd == L"SET")
+	{
+		if(fi >= fields.size())
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		args.push_back(tv.value);
+
+		if(tv.value == L"ERR")
+		{
+			err = get_typed_field(fields, fi, arg);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
 			}
-
 			args.push_back(arg);
 		}
 		else
-		if(cmd == L"JMP" || cmd == L"JF" || cmd == L"JT" || cmd == L"CALL" || cmd == L"GF" || cmd == L"LF" || cmd == L"IMP" || cmd == L"INI" || cmd == L"INL" || cmd == L"INT" || cmd == L"USES")
 		{
-			// read label name
-			err = get_simple_arg(tmpline, tv, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
-			{
-				return err;
-			}
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+	}
+	else
+	if(cmd == L"XARG")
+	{
+		if(fi >= fields.size())
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
 
-			if(cmd != L"USES" && !check_label_name(tv.value))
-			{
-				return C1_T_ERROR::C1_RES_EINVLBNAME;
-			}
-			
-			if(cmd == L"IMP")
-			{
-				_req_symbols.insert(tv.value);
-			}
-			else
-			if(cmd == L"INT")
-			{
-				_req_symbols.insert(L"__" + tv.value);
-			}
-			else
-			if(cmd == L"INI")
-			{
-				_init_files.push_back(tv.value);
-			}
-			else
-			if(cmd != L"INL")
-			{
-				tv.value = add_namespace(tv.value);
-			}
+		err = get_typed_field(fields, fi, arg);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
 
-			args.push_back(tv.value);
+		args.push_back(arg);
+	}
+	else
+	if(cmd == L"JMP" || cmd == L"JF" || cmd == L"JT" || cmd == L"CALL" || cmd == L"GF" || cmd == L"LF" || cmd == L"IMP" || cmd == L"INI" || cmd == L"INL" || cmd == L"INT" || cmd == L"USES")
+	{
+		// read label name
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
 
-			if(cmd == L"CALL")
-			{
-				while(offset != std::wstring::npos)
-				{
-					err = get_arg(tmpline, arg, offset);
-					if(err != C1_T_ERROR::C1_RES_OK)
-					{
-						return err;
-					}
-					args.push_back(arg);
-				}
-			}
+		if(cmd != L"USES" && !check_label_name(tv.value))
+		{
+			return C1_T_ERROR::C1_RES_EINVLBNAME;
+		}
+		
+		if(cmd == L"IMP")
+		{
+			_req_symbols.insert(tv.value);
 		}
 		else
-		if(cmd == L"ERR")
+		if(cmd == L"INT")
 		{
-			// read error code (can be absent)
-			if(offset == std::wstring::npos)
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
-
-			auto sval = Utils::str_trim(get_next_value(tmpline, L",", offset));
-			args.push_back(sval);
-			if(offset == std::wstring::npos)
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
-
-			// read label name
-			err = get_simple_arg(tmpline, tv, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
-			{
-				return err;
-			}
-			if(!check_label_name(tv.value))
-			{
-				return C1_T_ERROR::C1_RES_EINVLBNAME;
-			}
-			tv.value = add_namespace(tv.value);
-			args.push_back(tv.value);
+			_req_symbols.insert(L"__" + tv.value);
 		}
 		else
-		if(cmd == L"DAT")
+		if(cmd == L"INI")
+		{
+			_init_files.push_back(tv.value);
+		}
+		else
+		if(cmd != L"INL")
 		{
-			// get mandatory namespace name
-			if(offset == std::wstring::npos)
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
-
-			err = get_simple_arg(tmpline, tv, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
-			{
-				return err;
-			}
-
 			tv.value = add_namespace(tv.value);
+		}
 
-			if(tv.value == L"*")
-			{
-				if(_last_dat_namespace.empty())
-				{
-					return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-				}
-
-				tv.value = _last_dat_namespace;
-			}
-			else
-			{
-				_last_dat_namespace = tv.value;
-			}
-
-			args.push_back(tv.value);
+		args.push_back(tv.value);
 
-			while(offset != std::wstring::npos)
+		if(cmd == L"CALL")
+		{
+			while(fi < fields.size())
 			{
-				err = get_arg(tmpline, arg, offset);
+				err = get_typed_field(fields, fi, arg);
 				if(err != C1_T_ERROR::C1_RES_OK)
 				{
 					return err;
@@ -1288,64 +1455,140 @@ C1_T_ERROR C1Compiler::load_next_command(const std::wstring &line, const_iterato
 				args.push_back(arg);
 			}
 		}
-		else
-		if(cmd == L"READ")
+	}
+	else
+	if(cmd == L"ERR")
+	{
+		// read error code (can be absent)
+		if(fi >= fields.size())
 		{
-			// get mandatory namespace name
-			if(offset == std::wstring::npos)
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
 
-			err = get_simple_arg(tmpline, tv, offset);
-			if(err != C1_T_ERROR::C1_RES_OK)
-			{
-				return err;
-			}
-			args.push_back(tv.value);
+		err = get_simple_field(fields, fi, tv, true);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		args.push_back(tv.value);
+		if(fi >= fields.size())
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+
+		// read label name
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		if(!check_label_name(tv.value))
+		{
+			return C1_T_ERROR::C1_RES_EINVLBNAME;
+		}
+		tv.value = add_namespace(tv.value);
+		args.push_back(tv.value);
+	}
+	else
+	if(cmd == L"DAT")
+	{
+		// get mandatory namespace name
+		if(fi >= fields.size())
+		{
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
+
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
 
-			if(offset == std::wstring::npos)
+		tv.value = add_namespace(tv.value);
+
+		if(tv.value == L"*")
+		{
+			if(_last_dat_namespace.empty())
 			{
 				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 			}
-			err = get_arg(tmpline, arg, offset);
+
+			tv.value = _last_dat_namespace;
+		}
+		else
+		{
+			_last_dat_namespace = tv.value;
+		}
+
+		args.push_back(tv.value);
+
+		while(fi < fields.size())
+		{
+			err = get_typed_field(fields, fi, arg);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
 			}
 			args.push_back(arg);
 		}
-		else
-		if(B1CUtils::is_bin_op(cmd) || B1CUtils::is_log_op(cmd) || B1CUtils::is_un_op(cmd))
+	}
+	else
+	if(cmd == L"READ")
+	{
+		// get mandatory namespace name
+		if(fi >= fields.size())
 		{
-			while(offset != std::wstring::npos)
-			{
-				err = get_arg(tmpline, arg, offset);
-				if(err != C1_T_ERROR::C1_RES_OK)
-				{
-					return err;
-				}
-				args.push_back(arg);
-			}
+			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+		}
 
-			if(!((B1CUtils::is_bin_op(cmd) && args.size() == 3) || args.size() == 2))
-			{
-				return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			}
+		err = get_simple_field(fields, fi, tv);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
 		}
-		else
+		args.push_back(tv.value);
+
+		if(fi >= fields.size())
 		{
 			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 		}
+		err = get_typed_field(fields, fi, arg);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+		args.push_back(arg);
+	}
+	else
+	if(B1CUtils::is_bin_op(cmd) || B1CUtils::is_log_op(cmd) || B1CUtils::is_un_op(cmd))
+	{
+		while(fi < fields.size())
+		{
+			err = get_typed_field(fields, fi, arg);
+			if(err != C1_T_ERROR::C1_RES_OK)
+			{
+				return err;
+			}
+			args.push_back(arg);
+		}
 
-		if(offset != std::wstring::npos)
+		if(!((B1CUtils::is_bin_op(cmd) && args.size() == 3) || args.size() == 2))
 		{
 			return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 		}
+	}
+	else
+	{
+		return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+	}
 
-		emit_command(cmd, pos, args);
+	if(fi < fields.size())
+	{
+		return static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
 	}
 
+	emit_command(cmd, pos, args);
+
 	return C1_T_ERROR::C1_RES_OK;
 }
 
@@ -1738,7 +1981,9 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 			{
 				_sub_entry_labels.insert(cmd.args[0][0].value);
 
-				for(auto a = cmd.args.begin() + 1; a != cmd.args.end(); a++)
+				auto &args = cmd.edit_args();
+
+				for(auto a = args.begin() + 1; a != args.end(); a++)
 				{
 					auto err = check_arg(*a);
 					if(err != C1_T_ERROR::C1_RES_OK)
@@ -1919,7 +2164,9 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 
 			auto dim_num = 0;
 
-			for(auto a = cmd.args.begin() + dims_off; a != cmd.args.end(); a++, dim_num++)
+			auto &args = cmd.edit_args();
+
+			for(auto a = args.begin() + dims_off; a != args.end(); a++, dim_num++)
 			{
 				auto err = check_arg(*a);
 				if(err != C1_T_ERROR::C1_RES_OK)
@@ -1999,7 +2246,7 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 
 		if(cmd.cmd == L"OUT")
 		{
-			auto err = check_arg(cmd.args[1]);
+			auto err = check_arg(cmd.edit_args()[1]);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
@@ -2010,7 +2257,7 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 
 		if(cmd.cmd == L"IN")
 		{
-			auto err = check_arg(cmd.args[1]);
+			auto err = check_arg(cmd.edit_args()[1]);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
@@ -2021,7 +2268,7 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 
 		if(cmd.cmd == L"GET" || cmd.cmd == L"PUT" || cmd.cmd == L"TRR")
 		{
-			auto err = check_arg(cmd.args[1]);
+			auto err = check_arg(cmd.edit_args()[1]);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
@@ -2029,7 +2276,7 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 
 			if(cmd.args.size() != 2)
 			{
-				err = check_arg(cmd.args[2]);
+				err = check_arg(cmd.edit_args()[2]);
 				if(err != C1_T_ERROR::C1_RES_OK)
 				{
 					return err;
@@ -2041,7 +2288,7 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 
 		if(cmd.cmd == L"XARG")
 		{
-			auto err = check_arg(cmd.args[0]);
+			auto err = check_arg(cmd.edit_args()[0]);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
@@ -2052,7 +2299,7 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 
 		if(cmd.cmd == L"RETVAL")
 		{
-			auto err = check_arg(cmd.args[0]);
+			auto err = check_arg(cmd.edit_args()[0]);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
@@ -2063,7 +2310,7 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 
 		if(cmd.cmd == L"READ")
 		{
-			auto err = check_arg(cmd.args[1]);
+			auto err = check_arg(cmd.edit_args()[1]);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
@@ -2074,7 +2321,7 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 
 		if(cmd.cmd == L"SET")
 		{
-			auto err = check_arg(cmd.args[1]);
+			auto err = check_arg(cmd.edit_args()[1]);
 			if(err != C1_T_ERROR::C1_RES_OK)
 			{
 				return err;
@@ -2097,7 +2344,7 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 
 				if(!(iocmd.data_type == B1Types::B1T_LABEL || iocmd.data_type == B1Types::B1T_VARREF || iocmd.data_type == B1Types::B1T_TEXT))
 				{
-					auto err = check_arg(cmd.args[2]);
+					auto err = check_arg(cmd.edit_args()[2]);
 					if(err != C1_T_ERROR::C1_RES_OK)
 					{
 						return err;
@@ -2108,7 +2355,7 @@ C1_T_ERROR C1Compiler::read_and_check_vars(iterator begin, iterator end, bool in
 			continue;
 		}
 
-		for(auto &a: cmd.args)
+		for(auto &a: cmd.edit_args())
 		{
 			auto err = check_arg(a);
 			if(err != C1_T_ERROR::C1_RES_OK)
@@ -2181,6 +2428,8 @@ C1_T_ERROR C1Compiler::process_imm_str_value(const B1_CMP_ARG &arg)
 	{
 		if(B1CUtils::is_str_val(a.value))
 		{
+			_cache_imm_str = true;
+
 			if(_str_labels.find(a.value) == _str_labels.cend())
 			{
 				const auto label = L"__STR_" + std::to_wstring(_str_labels.size());
@@ -2866,6 +3115,11 @@ C1Compiler::C1Compiler(bool out_src_lines, bool opt_nocheck)
 , _next_temp_namespace_id(32768)
 , _curr_code_sec(nullptr)
 , _curr_const_sec(nullptr)
+, _opt_rules_stat_on(false)
+, _cache_imm_str(false)
+, _cache_code_size(0)
+, _cache_ns_id(0)
+, _cache_label_id(0)
 {
 	_call_stmt = L"CALL";
 	_ret_stmt = L"RET";
@@ -2877,12 +3131,123 @@ C1Compiler::~C1Compiler()
 {
 }
 
+// loads binary intermediate code record (text lines are loaded the same way lines of text files are)
+C1_T_ERROR C1Compiler::load_ir_cmd(bool is_text, bool is_label, const std::wstring &cmd, const std::vector<B1_CMP_ARG> &fields, const_iterator pos, bool pure_asm)
+{
+	if(is_text)
+	{
+		return load_next_command(cmd, pos, pure_asm);
+	}
+
+	if(is_label)
+	{
+		return load_label(cmd, pos, pure_asm);
+	}
+
+	if(pure_asm)
+	{
+		return C1_T_ERROR::C1_RES_EINTERR;
+	}
+
+	if(!check_cmd_name(cmd))
+	{
+		return C1_T_ERROR::C1_RES_EINVCMDNAME;
+	}
+
+	return load_command(cmd, fields, pos);
+}
+
+// loads binary intermediate code file written by the BASIC compiler
+C1_T_ERROR C1Compiler::load_ir_file(const std::string &file_name)
+{
+	B1IRReader reader;
+	if(!reader.Open(file_name))
+	{
+		return C1_T_ERROR::C1_RES_EFOPEN;
+	}
+
+	if(reader.GetCmdsNum() == 0)
+	{
+		_curr_line_cnt = 0;
+		return C1_T_ERROR::C1_RES_EIFEMPTY;
+	}
+
+	return load_ir(reader);
+}
+
+// loads library file from archive (archived files are stored in binary intermediate code form)
+C1_T_ERROR C1Compiler::load_archived_file(const LibFileReader &reader)
+{
+	size_t size = 0;
+	int32_t lines_num = 0;
+
+	auto data = reader.GetData(size, lines_num);
+	if(lines_num == 0)
+	{
+		_curr_line_cnt = 0;
+		return C1_T_ERROR::C1_RES_EIFEMPTY;
+	}
+
+	B1IRReader ir_reader;
+	if(!ir_reader.Open(data, size))
+	{
+		return C1_T_ERROR::C1_RES_EFOPEN;
+	}
+
+	return load_ir(ir_reader);
+}
+
+// loads commands of binary intermediate code file or archived library file
+C1_T_ERROR C1Compiler::load_ir(const B1IRReader &reader)
+{
+	bool is_label = false;
+	std::wstring cmd;
+	std::vector<B1_CMP_ARG> fields;
+
+	const auto cmds_num = reader.GetCmdsNum();
+
+	for(uint32_t i = 0; i < cmds_num; i++)
+	{
+		reader.ReadCmd(i, is_label, cmd, fields, _curr_line_cnt);
+
+		_curr_src_line_id++;
+
+		// text form is necessary only for source lines output
+		if(_out_src_lines)
+		{
+			_src_lines[_curr_src_line_id] = reader.GetCmdText(i);
+		}
+
+		auto err = load_ir_cmd(reader.IsTextCmd(i), is_label, cmd, fields, cend(), false);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			return err;
+		}
+	}
+
+	return C1_T_ERROR::C1_RES_OK;
+}
+
 C1_T_ERROR C1Compiler::Load(const std::vector<std::string> &file_names)
 {
+	TRepStage trep_stage("Load");
+
 	C1_T_ERROR err = C1_T_ERROR::C1_RES_EIFEMPTY;
 
 	clear();
 
+	_cache_deps.clear();
+	_cache_imm_str = false;
+
+	if(!_cache_dir.empty())
+	{
+		get_cache_state(_cache_state);
+		_cache_sub_entry_labels = _sub_entry_labels;
+		_cache_code_size = get_code_size();
+		_cache_ns_id = _next_temp_namespace_id;
+		_cache_label_id = _next_label;
+	}
+
 	_curr_name_space = gen_next_tmp_namespace();
 
 	_src_lines.clear();
@@ -2916,63 +3281,180 @@ C1_T_ERROR C1Compiler::Load(const std::vector<std::string> &file_names)
 
 		_last_dat_namespace.clear();
 
-		std::FILE *ofp = std::fopen(fn.c_str(), "r");
-		if(ofp == nullptr)
+		if(B1IRReader::IsIRFile(fn))
 		{
-			return C1_T_ERROR::C1_RES_EFOPEN;
+			err = load_ir_file(fn);
+			if(err != C1_T_ERROR::C1_RES_OK)
+			{
+				break;
+			}
+
+			continue;
 		}
 
-		std::wstring line;
+		LibFileReader reader;
+		if(!reader.Open(fn))
+		{
+			return C1_T_ERROR::C1_RES_EFOPEN;
+		}
 
-		while(true)
+		if(reader.IsArchived())
 		{
-			err = static_cast<C1_T_ERROR>(Utils::read_line(ofp, line));
-			if(err == static_cast<C1_T_ERROR>(B1_RES_EEOF) && line.empty() && _curr_line_cnt == 0)
-			{
-				_curr_line_cnt = 0;
-				err = C1_T_ERROR::C1_RES_EIFEMPTY;
-				break;
-			}
+			err = load_archived_file(reader);
+		}
+		else
+		{
+			std::wstring line;
+			int32_t line_num = 0;
 
-			if(err == static_cast<C1_T_ERROR>(B1_RES_EEOF))
+			while(true)
 			{
-				err = C1_T_ERROR::C1_RES_OK;
-				if(line.empty())
+				err = static_cast<C1_T_ERROR>(reader.ReadLine(line, line_num));
+				if(err == static_cast<C1_T_ERROR>(B1_RES_EEOF) && line.empty() && line_num == 0)
 				{
+					_curr_line_cnt = 0;
+					err = C1_T_ERROR::C1_RES_EIFEMPTY;
 					break;
 				}
-			}
 
-			if(err != C1_T_ERROR::C1_RES_OK)
-			{
-				break;
+				if(err == static_cast<C1_T_ERROR>(B1_RES_EEOF))
+				{
+					err = C1_T_ERROR::C1_RES_OK;
+					if(line.empty())
+					{
+						break;
+					}
+				}
+
+				if(err != C1_T_ERROR::C1_RES_OK)
+				{
+					break;
+				}
+
+				_curr_src_line_id++;
+
+				_src_lines[_curr_src_line_id] = line;
+
+				_curr_line_cnt = line_num;
+
+				err = load_next_command(line, cend(), false);
+				if(err != C1_T_ERROR::C1_RES_OK)
+				{
+					break;
+				}
 			}
+		}
+
+		reader.Close();
+
+		if(_inline_asm && err == C1_T_ERROR::C1_RES_OK)
+		{
+			err = static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
+			break;
+		}
+
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			break;
+		}
+	}
 
-			_curr_src_line_id++;
+	return err;
+}
 
-			_src_lines[_curr_src_line_id] = line;
+// converts library file to binary intermediate code: the lines are split into fields the same way load_next_command()
+// does it, inline assembler blocks, lines with inline code parameters and lines that cannot be loaded are stored as text
+C1_T_ERROR C1Compiler::ConvertLibFile(const std::string &file_name, std::vector<char> &data, int32_t &lines_num) const
+{
+	std::FILE *fp = std::fopen(file_name.c_str(), "r");
+	if(fp == nullptr)
+	{
+		return C1_T_ERROR::C1_RES_EFOPEN;
+	}
 
-			_curr_line_cnt++;
+	B1IRWriter writer(false);
+	writer.Open(file_name);
 
-			err = load_next_command(line, cend(), false);
-			if(err != C1_T_ERROR::C1_RES_OK)
+	C1_T_ERROR err = C1_T_ERROR::C1_RES_OK;
+	std::wstring line, cmd;
+	std::vector<B1_CMP_ARG> fields;
+	bool inline_asm = false;
+	bool res = true;
+
+	lines_num = 0;
+
+	while(res)
+	{
+		err = static_cast<C1_T_ERROR>(Utils::read_line(fp, line));
+		if(err == static_cast<C1_T_ERROR>(B1_RES_EEOF))
+		{
+			err = C1_T_ERROR::C1_RES_OK;
+			if(line.empty())
 			{
 				break;
 			}
 		}
 
-		std::fclose(ofp);
+		if(err != C1_T_ERROR::C1_RES_OK)
+		{
+			break;
+		}
+
+		lines_num++;
 
-		if(_inline_asm && err == C1_T_ERROR::C1_RES_OK)
+		// remove comment, leading and trailing spaces
+		size_t offset = 0;
+		if(find_first_of(line, L";", offset) != C1_T_ERROR::C1_RES_OK)
+		{
+			res = writer.WriteText(line);
+			continue;
+		}
+
+		const auto tmpline = Utils::str_trim(line.substr(0, offset));
+
+		// inline code parameters are replaced before removing comments
+		const bool inl_params = line.find(L'{') != std::wstring::npos;
+
+		if(tmpline.empty())
+		{
+			res = inl_params ? writer.WriteText(line) : writer.WriteComment(std::wstring());
+			continue;
+		}
+
+		// label
+		if(tmpline[0] == L':')
+		{
+			res = (inline_asm || inl_params) ? writer.WriteText(line) : writer.WriteLabel(tmpline.substr(1));
+			continue;
+		}
+
+		offset = 0;
+		get_cmd_name(tmpline, cmd, offset);
+
+		if(inline_asm || cmd == L"ASM")
 		{
-			err = static_cast<C1_T_ERROR>(B1_RES_ESYNTAX);
-			break;
+			inline_asm = cmd != L"ENDASM";
+			res = writer.WriteText(line);
+			continue;
 		}
 
-		if(err != C1_T_ERROR::C1_RES_OK)
+		if(inl_params || !check_cmd_name(cmd) || get_fields(tmpline, fields, offset) != C1_T_ERROR::C1_RES_OK ||
+			std::any_of(fields.cbegin(), fields.cend(), [](const B1_CMP_ARG &f)
+				{ return std::any_of(f.cbegin(), f.cend(), [](const B1_TYPED_VALUE &tv) { return tv.type == B1Types::B1T_INVALID; }); }))
 		{
-			break;
+			// the error is reported when the line is loaded
+			res = writer.WriteText(line);
+			continue;
 		}
+
+		res = writer.WriteCommand(cmd, fields);
+	}
+
+	std::fclose(fp);
+
+	if(err == C1_T_ERROR::C1_RES_OK && !(res && writer.GetData(data)))
+	{
+		err = static_cast<C1_T_ERROR>(B1_RES_EENVFAT);
 	}
 
 	return err;
@@ -2980,6 +3462,8 @@ C1_T_ERROR C1Compiler::Load(const std::vector<std::string> &file_names)
 
 C1_T_ERROR C1Compiler::Compile()
 {
+	TRepStage trep_stage("Compile");
+
 	_curr_src_file_id = -1;
 	_curr_line_cnt = 0;
 
@@ -3020,6 +3504,8 @@ C1_T_ERROR C1Compiler::Compile()
 
 C1_T_ERROR C1Compiler::WriteCode(bool code_init, int32_t code_sec_index)
 {
+	TRepStage trep_stage("WriteCode");
+
 	_curr_code_sec = nullptr;
 
 	auto err = write_data_sec(code_init);
@@ -3047,6 +3533,8 @@ C1_T_ERROR C1Compiler::WriteCode(bool code_init, int32_t code_sec_index)
 
 C1_T_ERROR C1Compiler::Save(const std::string &file_name, bool overwrite_existing /*= true*/)
 {
+	TRepStage trep_stage("Save");
+
 	std::FILE *ofs = std::fopen(file_name.c_str(), overwrite_existing ? "w" : "a");
 	if(ofs == nullptr)
 	{
@@ -3132,26 +3620,31 @@ C1_T_ERROR C1Compiler::Save(const std::string &file_name, bool overwrite_existin
 	return C1_T_ERROR::C1_RES_OK;
 }
 
-// init = false creates new record and sets its usage count to 0 (if the record does not exist)
-void C1Compiler::update_opt_rule_usage_stat(int32_t rule_id, bool init /*= false*/) const
+void C1Compiler::init_opt_rules_stat()
 {
-	auto rule = _opt_rules_usage_data.find(rule_id);
-	if(rule == _opt_rules_usage_data.end())
-	{
-		_opt_rules_usage_data.emplace(std::make_pair((int)rule_id, std::make_tuple((int)(init ? 0 : 1))));
-	}
-	else
-	if(!init)
+}
+
+static bool c1_str2int64(const std::wstring &str, int64_t &num)
+{
+	wchar_t *end = nullptr;
+
+	if(str.empty())
 	{
-		rule->second = std::make_tuple(std::get<0>(rule->second) + 1);
+		return false;
 	}
+
+	num = std::wcstoll(str.c_str(), &end, 10);
+
+	return *end == 0 && num >= 0;
 }
 
-C1_T_ERROR C1Compiler::ReadOptLogFile(const std::string &file_name) const
+// the file lines are rule id, number of hits, number of checks and time spent in the checks (nanoseconds), the
+// last two values are optional (absent in the files written by older compiler versions)
+C1_T_ERROR C1Compiler::ReadOptLogFile(const std::string &file_name)
 {
 	C1_T_ERROR err = C1_T_ERROR::C1_RES_OK;
 
-	_opt_rules_usage_data.clear();
+	_opt_rules_stat.clear();
 
 	if(!std::filesystem::exists(file_name))
 	{
@@ -3162,6 +3655,9 @@ C1_T_ERROR C1Compiler::ReadOptLogFile(const std::string &file_name) const
 		}
 		std::fclose(fp);
 
+		init_opt_rules_stat();
+		_opt_rules_stat_on = true;
+
 		return C1_T_ERROR::C1_RES_OK;
 	}
 
@@ -3198,24 +3694,34 @@ C1_T_ERROR C1Compiler::ReadOptLogFile(const std::string &file_name) const
 
 		std::vector<std::wstring> data;
 		Utils::str_split(line, L",", data);
-		if(data.size() != 2)
+		if(data.size() != 2 && data.size() != 4)
 		{
 			err = C1_T_ERROR::C1_RES_EWOPTLOGFMT;
 			break;
 		}
 
-		int32_t rule_id = -1, usage_count = -1;
-		if(Utils::str2int32(Utils::str_trim(data[0]), rule_id) != B1_RES_OK || Utils::str2int32(Utils::str_trim(data[1]), usage_count) != B1_RES_OK)
+		int32_t rule_id = -1;
+		C1_OPT_RULE_STAT stat;
+		if(	Utils::str2int32(Utils::str_trim(data[0]), rule_id) != B1_RES_OK ||
+			!c1_str2int64(Utils::str_trim(data[1]), stat._hits) ||
+			(data.size() == 4 && (!c1_str2int64(Utils::str_trim(data[2]), stat._attempts) || !c1_str2int64(Utils::str_trim(data[3]), stat._time)))
+			)
 		{
 			err = C1_T_ERROR::C1_RES_EWOPTLOGFMT;
 			break;
 		}
 
-		_opt_rules_usage_data[(int)rule_id] = std::make_tuple((int)usage_count);
+		_opt_rules_stat[rule_id] = stat;
 	}
 
 	std::fclose(fp);
 
+	if(err == C1_T_ERROR::C1_RES_OK)
+	{
+		init_opt_rules_stat();
+		_opt_rules_stat_on = true;
+	}
+
 	return err;
 }
 
@@ -3227,9 +3733,9 @@ C1_T_ERROR C1Compiler::WriteOptLogFile(const std::string &file_name) const
 		return C1_T_ERROR::C1_RES_EFOPEN;
 	}
 
-	for(const auto &od: _opt_rules_usage_data)
+	for(const auto &od: _opt_rules_stat)
 	{
-		std::fwprintf(fp, L"0x%X,%d\n", (unsigned int)od.first, (int)std::get<0>(od.second));
+		std::fwprintf(fp, L"0x%X,%lld,%lld,%lld\n", (unsigned int)od.first, (long long)od.second._hits, (long long)od.second._attempts, (long long)od.second._time);
 	}
 
 	std::fclose(fp);
@@ -3283,3 +3789,438 @@ C1_T_ERROR C1Compiler::GetInitFiles(std::vector<std::wstring> &init_files) const
 
 	return C1_T_ERROR::C1_RES_OK;
 }
+
+// library modules cache file format version
+#define C1_CACHE_VERSION 1
+
+static bool cache_write(std::FILE *fp, const void *data, size_t size)
+{
+	return size == 0 || std::fwrite(data, size, 1, fp) == 1;
+}
+
+static bool cache_read(std::FILE *fp, void *data, size_t size)
+{
+	return size == 0 || std::fread(data, size, 1, fp) == 1;
+}
+
+template<typename T>
+static bool cache_write_val(std::FILE *fp, T val)
+{
+	return cache_write(fp, &val, sizeof(val));
+}
+
+template<typename T>
+static bool cache_read_val(std::FILE *fp, T &val)
+{
+	return cache_read(fp, &val, sizeof(val));
+}
+
+template<typename S>
+static bool cache_write_str(std::FILE *fp, const S &str)
+{
+	return cache_write_val(fp, (uint32_t)str.length()) && cache_write(fp, str.data(), str.length() * sizeof(str[0]));
+}
+
+template<typename S>
+static bool cache_read_str(std::FILE *fp, S &str)
+{
+	uint32_t len = 0;
+
+	if(!cache_read_val(fp, len) || len > 0x100000)
+	{
+		return false;
+	}
+
+	str.resize(len);
+
+	return cache_read(fp, str.data(), len * sizeof(str[0]));
+}
+
+template<typename C>
+static bool cache_write_strs(std::FILE *fp, const C &strs)
+{
+	if(!cache_write_val(fp, (uint32_t)strs.size()))
+	{
+		return false;
+	}
+
+	for(const auto &s: strs)
+	{
+		if(!cache_write_str(fp, s))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool cache_read_strs(std::FILE *fp, std::vector<std::wstring> &strs)
+{
+	uint32_t n = 0;
+
+	if(!cache_read_val(fp, n) || n > 0x100000)
+	{
+		return false;
+	}
+
+	strs.resize(n);
+
+	for(auto &s: strs)
+	{
+		if(!cache_read_str(fp, s))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// changes numeric part of generated names (e.g. NS32768 or __ALB_12) from old_first..old_first + count - 1 range
+// to new_first..new_first + count - 1
+static std::wstring cache_rebase(const std::wstring &str, const std::wstring &prefix, int32_t old_first, int32_t new_first, int32_t count)
+{
+	if(count == 0 || old_first == new_first)
+	{
+		return str;
+	}
+
+	std::wstring res;
+	size_t pos = 0;
+
+	while(true)
+	{
+		auto next = str.find(prefix, pos);
+		if(next == std::wstring::npos)
+		{
+			break;
+		}
+
+		auto end = next + prefix.length();
+		while(end < str.length() && std::iswdigit(str[end]))
+		{
+			end++;
+		}
+
+		int32_t n = 0;
+		if(	(next == 0 || !(std::iswalnum(str[next - 1]) || str[next - 1] == L'_')) &&
+			(end == str.length() || !(std::iswalnum(str[end]) || str[end] == L'_')) &&
+			end > next + prefix.length() && end - next - prefix.length() < 10 &&
+			Utils::str2int32(str.substr(next + prefix.length(), end - next - prefix.length()), n) == B1_RES_OK &&
+			n >= old_first && n < old_first + count
+			)
+		{
+			res += str.substr(pos, next - pos) + prefix + std::to_wstring(n - old_first + new_first);
+		}
+		else
+		{
+			res += str.substr(pos, end - pos);
+		}
+
+		pos = end;
+	}
+
+	return res + str.substr(pos);
+}
+
+void C1Compiler::get_cache_state(std::vector<int64_t> &state) const
+{
+	state.clear();
+
+	state.push_back(_next_local);
+	state.push_back(_data_stmts_init.size());
+	state.push_back(_str_labels.size());
+	state.push_back(_data_size);
+	state.push_back(_const_size);
+	state.push_back(_fn_names.size());
+	state.push_back(_inline_code.size());
+	state.push_back(_data_sec.size());
+
+	int64_t const_size = 0;
+	for(const auto &s: _const_secs)
+	{
+		const_size += s.size();
+	}
+	state.push_back(const_size);
+
+	state.push_back(_warnings.size());
+}
+
+size_t C1Compiler::get_code_size() const
+{
+	size_t code_size = _code_init_sec.size();
+
+	for(const auto &s: _code_secs)
+	{
+		code_size += s.size();
+	}
+
+	return code_size;
+}
+
+std::string C1Compiler::get_cache_file_name(uint64_t file_hash, bool code_init) const
+{
+	char hash_str[17];
+	std::snprintf(hash_str, sizeof(hash_str), "%016llx", (unsigned long long)Utils::str_hash(_cache_opts + (code_init ? "I" : "C") + std::to_string(file_hash)));
+
+	return (std::filesystem::path(_cache_dir) / (std::string(hash_str) + ".c1c")).string();
+}
+
+void C1Compiler::SetCacheDir(const std::string &cache_dir, const std::string &cache_opts)
+{
+	_cache_dir = cache_dir;
+	_cache_opts = cache_opts;
+}
+
+C1_T_ERROR C1Compiler::LoadCached(const std::string &file_name, bool code_init, int32_t code_sec_index, bool &loaded)
+{
+	TRepStage trep_stage("LoadCached");
+
+	loaded = false;
+
+	if(_cache_dir.empty())
+	{
+		return C1_T_ERROR::C1_RES_OK;
+	}
+
+	// missing or unreadable source file is reported by Load() function
+	uint64_t file_hash = 0;
+	if(!arc_file_hash(file_name, file_hash))
+	{
+		return C1_T_ERROR::C1_RES_OK;
+	}
+
+	std::FILE *fp = std::fopen(get_cache_file_name(file_hash, code_init).c_str(), "rb");
+	if(fp == nullptr)
+	{
+		return C1_T_ERROR::C1_RES_OK;
+	}
+
+	uint32_t version = 0;
+	std::string opts;
+	uint64_t hash = 0;
+	uint8_t init = 0;
+	std::vector<std::wstring> deps;
+	int32_t ns_id = 0, ns_num = 0, label_id = 0, label_num = 0;
+	std::vector<std::wstring> all_symbols, req_symbols, init_files, sub_entry_labels;
+	uint32_t ops_num = 0;
+
+	bool valid =
+		cache_read_val(fp, version) && version == C1_CACHE_VERSION &&
+		cache_read_str(fp, opts) && opts == _cache_opts &&
+		cache_read_val(fp, hash) && hash == file_hash &&
+		cache_read_val(fp, init) && init == (code_init ? 1 : 0) &&
+		cache_read_strs(fp, deps);
+
+	// inline files loaded by the module should not be changed
+	for(const auto &d: deps)
+	{
+		uint64_t dep_hash = 0;
+		valid = valid && cache_read_val(fp, hash) && arc_file_hash(_global_settings.GetLibFileName(Utils::wstr2str(d), ".b1c"), dep_hash) && dep_hash == hash;
+	}
+
+	valid = valid &&
+		cache_read_val(fp, ns_id) && cache_read_val(fp, ns_num) &&
+		cache_read_val(fp, label_id) && cache_read_val(fp, label_num) &&
+		cache_read_strs(fp, all_symbols) && cache_read_strs(fp, req_symbols) && cache_read_strs(fp, init_files) &&
+		cache_read_strs(fp, sub_entry_labels) &&
+		cache_read_val(fp, ops_num);
+
+	B1_ASM_OPS ops;
+
+	for(uint32_t i = 0; valid && i < ops_num; i++)
+	{
+		uint8_t type = 0, is_volatile = 0, is_inline = 0;
+		std::wstring data;
+
+		valid = cache_read_val(fp, type) && type <= static_cast<uint8_t>(AOT::AOT_DATA) && cache_read_val(fp, is_volatile) && cache_read_val(fp, is_inline) && cache_read_str(fp, data) && cache_read_str(fp, _comment);
+		if(valid)
+		{
+			create_asm_op(ops, ops.cend(), static_cast<AOT>(type), data, is_volatile != 0, is_inline != 0);
+		}
+	}
+
+	_comment.clear();
+
+	std::fclose(fp);
+
+	if(!valid)
+	{
+		return C1_T_ERROR::C1_RES_OK;
+	}
+
+	// reproduce Load() function effect
+	clear();
+
+	if(_src_file_name_ids.find(file_name) == _src_file_name_ids.cend())
+	{
+		_src_file_names.push_back(file_name);
+		_src_file_name_ids[file_name] = _src_file_names.size() - 1;
+	}
+
+	const auto new_ns_id = _next_temp_namespace_id;
+	const auto new_label_id = _next_label;
+
+	_curr_name_space = gen_next_tmp_namespace();
+	_next_temp_namespace_id = new_ns_id + ns_num;
+	_next_label = new_label_id + label_num;
+
+	_src_lines.clear();
+	_inline_asm = false;
+	_curr_src_line_id = -1;
+	_last_dat_namespace.clear();
+
+	// empty module compilation resets the rest of the module-specific compiler state
+	auto err = Compile();
+	if(err != C1_T_ERROR::C1_RES_OK)
+	{
+		return err;
+	}
+
+	_all_symbols.clear();
+	_req_symbols.clear();
+	_init_files.clear();
+
+	err = WriteCode(code_init, code_sec_index);
+	if(err != C1_T_ERROR::C1_RES_OK)
+	{
+		return err;
+	}
+
+	// change names generated by the cached module
+	const auto rebase = [&](const std::wstring &str)
+	{
+		return cache_rebase(cache_rebase(str, L"NS", ns_id, new_ns_id, ns_num), L"__ALB_", label_id, new_label_id, label_num);
+	};
+
+	for(auto &op: ops)
+	{
+		op->_data = rebase(op->_data);
+		op->_comment = rebase(op->_comment);
+	}
+
+	for(const auto &s: all_symbols)
+	{
+		_all_symbols.insert(rebase(s));
+	}
+
+	for(const auto &s: req_symbols)
+	{
+		_req_symbols.insert(rebase(s));
+	}
+
+	for(const auto &s: sub_entry_labels)
+	{
+		_sub_entry_labels.insert(rebase(s));
+	}
+
+	_init_files = init_files;
+
+	_curr_code_sec->splice(_curr_code_sec->end(), ops);
+
+	_curr_src_file_id = _src_file_name_ids[file_name];
+	_curr_line_cnt = 0;
+
+	loaded = true;
+
+	return C1_T_ERROR::C1_RES_OK;
+}
+
+C1_T_ERROR C1Compiler::SaveCached(const std::string &file_name, bool code_init)
+{
+	if(_cache_dir.empty() || _cache_imm_str)
+	{
+		return C1_T_ERROR::C1_RES_OK;
+	}
+
+	// cache modules producing code only (no variables, constants, etc.)
+	std::vector<int64_t> state;
+	get_cache_state(state);
+	if(state != _cache_state ||
+		!_locals.empty() || !_vars.empty() || !_mem_areas.empty() || !_ufns.empty() || !_data_stmts.empty() || !_vars_stats.empty() || !_vars_order.empty()
+		)
+	{
+		return C1_T_ERROR::C1_RES_OK;
+	}
+
+	const auto code_size = get_code_size();
+	if(code_size < _cache_code_size || code_size - _cache_code_size > _curr_code_sec->size())
+	{
+		return C1_T_ERROR::C1_RES_OK;
+	}
+
+	uint64_t file_hash = 0;
+	if(!arc_file_hash(file_name, file_hash))
+	{
+		return C1_T_ERROR::C1_RES_EFOPEN;
+	}
+
+	std::vector<uint64_t> deps_hashes;
+	for(const auto &d: _cache_deps)
+	{
+		uint64_t hash = 0;
+		if(!arc_file_hash(_global_settings.GetLibFileName(Utils::wstr2str(d), ".b1c"), hash))
+		{
+			return C1_T_ERROR::C1_RES_EFOPEN;
+		}
+		deps_hashes.push_back(hash);
+	}
+
+	std::vector<std::wstring> sub_entry_labels;
+	std::set_difference(_sub_entry_labels.begin(), _sub_entry_labels.end(), _cache_sub_entry_labels.begin(), _cache_sub_entry_labels.end(), std::back_inserter(sub_entry_labels));
+
+	std::error_code ec;
+	std::filesystem::create_directories(_cache_dir, ec);
+
+	// write to a temporary file first not to let concurrent builds read incomplete data
+	const auto cache_file_name = get_cache_file_name(file_hash, code_init);
+	const auto tmp_file_name = cache_file_name + "." + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".tmp";
+
+	std::FILE *fp = std::fopen(tmp_file_name.c_str(), "wb");
+	if(fp == nullptr)
+	{
+		return C1_T_ERROR::C1_RES_EFOPEN;
+	}
+
+	bool res =
+		cache_write_val(fp, (uint32_t)C1_CACHE_VERSION) &&
+		cache_write_str(fp, _cache_opts) &&
+		cache_write_val(fp, file_hash) &&
+		cache_write_val(fp, (uint8_t)(code_init ? 1 : 0)) &&
+		cache_write_strs(fp, _cache_deps);
+
+	for(const auto h: deps_hashes)
+	{
+		res = res && cache_write_val(fp, h);
+	}
+
+	res = res &&
+		cache_write_val(fp, _cache_ns_id) && cache_write_val(fp, _next_temp_namespace_id - _cache_ns_id) &&
+		cache_write_val(fp, _cache_label_id) && cache_write_val(fp, _next_label - _cache_label_id) &&
+		cache_write_strs(fp, _all_symbols) && cache_write_strs(fp, _req_symbols) && cache_write_strs(fp, _init_files) &&
+		cache_write_strs(fp, sub_entry_labels) &&
+		cache_write_val(fp, (uint32_t)(code_size - _cache_code_size));
+
+	for(auto op = std::prev(_curr_code_sec->cend(), code_size - _cache_code_size); res && op != _curr_code_sec->cend(); op++)
+	{
+		const auto &ao = **op;
+		res = cache_write_val(fp, (uint8_t)ao._type) && cache_write_val(fp, (uint8_t)ao._volatile) && cache_write_val(fp, (uint8_t)ao._is_inline) && cache_write_str(fp, ao._data) && cache_write_str(fp, ao._comment);
+	}
+
+	res = (std::fclose(fp) == 0) && res;
+
+	if(res)
+	{
+		std::filesystem::rename(tmp_file_name, cache_file_name, ec);
+		res = !ec;
+	}
+
+	if(!res)
+	{
+		std::filesystem::remove(tmp_file_name, ec);
+		return C1_T_ERROR::C1_RES_EFOPEN;
+	}
+
+	return C1_T_ERROR::C1_RES_OK;
+}
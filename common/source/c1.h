@@ -20,6 +20,10 @@ extern "C"
 #include <memory>
 
 
+class B1IRReader;
+class LibFileReader;
+
+
 // assembler op type
 enum class AOT
 {
@@ -61,6 +65,28 @@ class B1_ASM_OPS: public std::list<std::unique_ptr<B1_ASM_OP>>
 };
 
 
+// optimizer rule statistics stored in optimizer log file, the values are summed up over all the compiler runs
+// sharing the file
+class C1_OPT_RULE_STAT
+{
+public:
+	// number of times the rule changed code
+	int64_t _hits;
+	// number of times the rule was checked
+	int64_t _attempts;
+	// time spent in the rule checks, nanoseconds
+	int64_t _time;
+
+
+	C1_OPT_RULE_STAT()
+	: _hits(0)
+	, _attempts(0)
+	, _time(0)
+	{
+	}
+};
+
+
 class C1Compiler: public B1_CMP_CMDS
 {
 protected:
@@ -145,11 +171,26 @@ protected:
 
 	std::vector<std::tuple<int32_t, std::string, C1_T_WARNING>> _warnings;
 
-	// variables for optimizer log helper functions
-	//     rule id      use counter
-	mutable std::map<int, std::tuple<int>> _opt_rules_usage_data;
+	// optimizer rules statistics, collected only if optimizer log file is specified (see ReadOptLogFile())
+	bool _opt_rules_stat_on;
+	std::map<int32_t, C1_OPT_RULE_STAT> _opt_rules_stat;
 	mutable std::map<std::wstring, B1_ASM_OPS::const_iterator> _opt_labels;
 
+	// library modules cache
+	std::string _cache_dir;
+	// compiler version and options the cached code depends on
+	std::string _cache_opts;
+	// names of inline files loaded by the current module
+	std::set<std::wstring> _cache_deps;
+	// the current module uses immediate string values (__STR_XXX labels depend on previously compiled modules)
+	bool _cache_imm_str;
+	// compiler state saved before loading the current module
+	std::vector<int64_t> _cache_state;
+	std::set<std::wstring> _cache_sub_entry_labels;
+	size_t _cache_code_size;
+	int32_t _cache_ns_id;
+	int32_t _cache_label_id;
+
 
 	C1_T_ERROR find_first_of(const std::wstring &str, const std::wstring &delimiters, size_t &off) const;
 	std::wstring get_next_value(const std::wstring &str, const std::wstring &delimiters, size_t &next_off) const;
@@ -169,7 +210,17 @@ protected:
 	virtual C1_T_ERROR process_asm_cmd(const std::wstring &line) = 0;
 	C1_T_ERROR replace_inline(std::wstring &line, const std::map<std::wstring, std::wstring> &inl_params, bool &empty_val) const;
 	C1_T_ERROR load_inline(size_t offset, const std::wstring &line, iterator load_at, const std::map<std::wstring, std::wstring> &inl_params = std::map<std::wstring, std::wstring>(), const B1_CMP_CMD *orig_cmd = nullptr, bool pure_asm = false);
+	C1_T_ERROR get_field_value(const std::wstring &str, const std::wstring &delimiters, B1_TYPED_VALUE &tv, wchar_t &delim, size_t &next_off) const;
+	C1_T_ERROR get_fields(const std::wstring &str, std::vector<B1_CMP_ARG> &fields, size_t &next_off) const;
+	C1_T_ERROR get_simple_field(const std::vector<B1_CMP_ARG> &fields, size_t &fi, B1_TYPED_VALUE &tv, bool allow_empty = false) const;
+	C1_T_ERROR get_typed_field(const std::vector<B1_CMP_ARG> &fields, size_t &fi, B1_CMP_ARG &arg) const;
+	C1_T_ERROR load_label(const std::wstring &name, const_iterator pos, bool pure_asm);
+	C1_T_ERROR load_command(std::wstring cmd, const std::vector<B1_CMP_ARG> &fields, const_iterator pos);
 	C1_T_ERROR load_next_command(const std::wstring &line, const_iterator pos, bool pure_asm);
+	C1_T_ERROR load_ir_cmd(bool is_text, bool is_label, const std::wstring &cmd, const std::vector<B1_CMP_ARG> &fields, const_iterator pos, bool pure_asm);
+	C1_T_ERROR load_ir(const B1IRReader &reader);
+	C1_T_ERROR load_ir_file(const std::string &file_name);
+	C1_T_ERROR load_archived_file(const LibFileReader &reader);
 
 	const B1_CMP_FN *get_fn(const B1_TYPED_VALUE &val) const;
 	const B1_CMP_FN *get_fn(const B1_CMP_ARG &arg) const;
@@ -197,12 +248,18 @@ protected:
 	virtual C1_T_ERROR write_const_sec();
 	virtual C1_T_ERROR write_code_sec(bool code_init) = 0;
 
-	// optimizer log helper function
-	// init = false creates new record and sets its usage count to 0 (if the record does not exist)
-	void update_opt_rule_usage_stat(int32_t rule_id, bool init = false) const;
+	// optimizer log helper function: creates statistics records for all the optimizer rules (so the rules never
+	// applied are written to the log too) and makes the optimizer collect the statistics
+	virtual void init_opt_rules_stat();
 
 	C1_T_ERROR save_section(const std::wstring &sec_name, const B1_ASM_OPS &sec, std::FILE *fp);
 
+	// library modules cache helper functions
+	// gets the compiler state that must not be changed by a module to be cached
+	virtual void get_cache_state(std::vector<int64_t> &state) const;
+	size_t get_code_size() const;
+	std::string get_cache_file_name(uint64_t file_hash, bool code_init) const;
+
 	void add_alt_fn_name(const std::wstring &fn_name, const std::wstring &alt_fn_name)
 	{
 		_fn_names[fn_name] = alt_fn_name;
@@ -252,17 +309,26 @@ public:
 	virtual ~C1Compiler();
 
 	// optimizer log helper functions
-	C1_T_ERROR ReadOptLogFile(const std::string &file_name) const;
+	C1_T_ERROR ReadOptLogFile(const std::string &file_name);
 	C1_T_ERROR WriteOptLogFile(const std::string &file_name) const;
 
 	// loads files with b1c instructions
 	C1_T_ERROR Load(const std::vector<std::string> &file_names);
+	// converts library file to binary intermediate code to store it in library archive (see arc_create())
+	C1_T_ERROR ConvertLibFile(const std::string &file_name, std::vector<char> &data, int32_t &lines_num) const;
 	C1_T_ERROR Compile();
 	// code_sec_index = -1: write _code_init_sec
 	// code_sec_index >= 0: write _code_init_sec[code_sec_index]
 	C1_T_ERROR WriteCode(bool code_init, int32_t code_sec_index);
 	virtual C1_T_ERROR Save(const std::string &file_name, bool overwrite_existing = true);
 
+	// library modules cache (disabled if cache_dir is empty)
+	void SetCacheDir(const std::string &cache_dir, const std::string &cache_opts);
+	// the same as Load(), Compile() and WriteCode() calls for a library module found in cache (loaded is set to false if there's no valid cache entry)
+	C1_T_ERROR LoadCached(const std::string &file_name, bool code_init, int32_t code_sec_index, bool &loaded);
+	// stores the library module processed with Load(), Compile() and WriteCode() calls in cache (if the module code does not depend on previously compiled modules)
+	C1_T_ERROR SaveCached(const std::string &file_name, bool code_init);
+
 	void AddFunctionsSymbols();
 	C1_T_ERROR GetUndefinedSymbols(std::set<std::wstring> &symbols) const;
 	C1_T_ERROR GetResolvedSymbols(std::set<std::wstring> &symbols) const;
@@ -0,0 +1,437 @@
+/*
+ BASIC1 compiler
+ Copyright (c) 2021-2026 Nikolay Pletnev
+ MIT license
+
+ cmpsrv.cpp: compile server mode
+*/
+
+
+#include "cmpsrv.h"
+#include "Utils.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+
+// max. length of a request string (current directory or command line argument)
+#define SRV_MAX_STR_LEN 0x10000
+// max. number of command line arguments in request
+#define SRV_MAX_ARGS_NUM 0x1000
+// number of file descriptors passed from client to server (stdin, stdout, stderr)
+#define SRV_FDS_NUM 3
+// exit code returned to client if the request processing is terminated abnormally
+#define SRV_RES_EABORT 255
+// max. time (in seconds) a client can take to send its request, the server does not accept other clients while
+// reading the request
+#define SRV_REQ_TIMEOUT 5
+
+
+// socket of the next compilation stage compile server (-next-server option)
+static std::string srv_next_socket_name;
+
+
+#ifndef _WIN32
+static bool srv_write(int fd, const void *data, size_t size)
+{
+	auto ptr = static_cast<const char *>(data);
+
+	while(size > 0)
+	{
+		auto n = ::write(fd, ptr, size);
+		if(n < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+
+		ptr += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+static bool srv_read(int fd, void *data, size_t size)
+{
+	auto ptr = static_cast<char *>(data);
+
+	while(size > 0)
+	{
+		auto n = ::read(fd, ptr, size);
+		if(n <= 0)
+		{
+			if(n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+
+		ptr += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+static bool srv_write_str(int fd, const std::string &str)
+{
+	uint32_t len = str.length();
+
+	return srv_write(fd, &len, sizeof(len)) && srv_write(fd, str.data(), len);
+}
+
+static bool srv_read_str(int fd, std::string &str)
+{
+	uint32_t len = 0;
+
+	if(!srv_read(fd, &len, sizeof(len)) || len > SRV_MAX_STR_LEN)
+	{
+		return false;
+	}
+
+	str.resize(len);
+
+	return len == 0 || srv_read(fd, &str[0], len);
+}
+
+static bool srv_make_addr(const std::string &socket_name, sockaddr_un &addr)
+{
+	std::memset(&addr, 0, sizeof(addr));
+
+	if(socket_name.empty() || socket_name.length() >= sizeof(addr.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		return false;
+	}
+
+	addr.sun_family = AF_UNIX;
+	std::strcpy(addr.sun_path, socket_name.c_str());
+
+	return true;
+}
+
+// reads request: client's standard streams descriptors, current directory and command line
+static bool srv_read_request(int conn, int *fds, std::string &cwd, std::vector<std::string> &args)
+{
+	char c = 0;
+	iovec iov = { &c, 1 };
+	alignas(cmsghdr) char cbuf[CMSG_SPACE(sizeof(int) * SRV_FDS_NUM)];
+	msghdr msg;
+
+	std::memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof(cbuf);
+
+	if(::recvmsg(conn, &msg, 0) != 1)
+	{
+		return false;
+	}
+
+	auto cmsg = CMSG_FIRSTHDR(&msg);
+	if(cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(int) * SRV_FDS_NUM))
+	{
+		return false;
+	}
+
+	std::memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * SRV_FDS_NUM);
+
+	uint32_t args_num = 0;
+
+	if(!srv_read_str(conn, cwd) || !srv_read(conn, &args_num, sizeof(args_num)) || args_num == 0 || args_num > SRV_MAX_ARGS_NUM)
+	{
+		return false;
+	}
+
+	args.resize(args_num);
+	for(auto &a: args)
+	{
+		if(!srv_read_str(conn, a))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+#endif
+
+int srv_run(const std::string &socket_name, const std::string &next_socket_name, SRV_REQ_FN req_fn, SRV_REQ_FN warm_up_fn)
+{
+#ifdef _WIN32
+	errno = ENOSYS;
+	return -1;
+#else
+	sockaddr_un addr;
+
+	if(!srv_make_addr(socket_name, addr))
+	{
+		return -1;
+	}
+
+	srv_next_socket_name = next_socket_name;
+
+	int sfd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(sfd < 0)
+	{
+		return -1;
+	}
+
+	// remove socket file possibly left by previous server instance
+	::unlink(socket_name.c_str());
+
+	if(::bind(sfd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(sfd, SOMAXCONN) != 0)
+	{
+		auto err = errno;
+		::close(sfd);
+		errno = err;
+		return -1;
+	}
+
+	// request processes are not waited for, client gets exit code via socket
+	std::signal(SIGCHLD, SIG_IGN);
+	// client disconnection should not terminate server
+	std::signal(SIGPIPE, SIG_IGN);
+
+	while(true)
+	{
+		int conn = ::accept(sfd, nullptr, nullptr);
+		if(conn < 0)
+		{
+			if(errno == EINTR || errno == ECONNABORTED)
+			{
+				continue;
+			}
+
+			auto err = errno;
+			::close(sfd);
+			errno = err;
+			return -1;
+		}
+
+		int fds[SRV_FDS_NUM] = { -1, -1, -1 };
+		std::string cwd;
+		std::vector<std::string> args;
+
+		// a stalled client must not block the server
+		timeval tv = { SRV_REQ_TIMEOUT, 0 };
+		::setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+		if(srv_read_request(conn, fds, cwd, args))
+		{
+			std::vector<char *> argv;
+
+			for(auto &a: args)
+			{
+				argv.push_back(&a[0]);
+			}
+			argv.push_back(nullptr);
+
+			// switch to client's directory so relative paths from its command line are valid
+			int cwd_err = (::chdir(cwd.c_str()) == 0) ? 0 : errno;
+
+			auto pid = ::fork();
+			if(pid == 0)
+			{
+				::close(sfd);
+
+				std::signal(SIGCHLD, SIG_DFL);
+				std::signal(SIGPIPE, SIG_DFL);
+
+				for(int i = 0; i < SRV_FDS_NUM; i++)
+				{
+					::dup2(fds[i], i);
+					::close(fds[i]);
+				}
+
+				int32_t retcode = SRV_RES_EABORT;
+
+				if(cwd_err != 0)
+				{
+					errno = cwd_err;
+					std::perror("fail");
+				}
+				else
+				{
+					retcode = req_fn(args.size(), argv.data());
+				}
+
+				std::fflush(stdout);
+				std::fflush(stderr);
+
+				srv_write(conn, &retcode, sizeof(retcode));
+				::_exit(0);
+			}
+
+			// the request is processed with the data loaded by the previous requests, load the data it needs
+			// for the next ones while it runs
+			if(pid > 0 && cwd_err == 0 && warm_up_fn != nullptr)
+			{
+				warm_up_fn(args.size(), argv.data());
+			}
+		}
+
+		for(int i = 0; i < SRV_FDS_NUM; i++)
+		{
+			if(fds[i] >= 0)
+			{
+				::close(fds[i]);
+			}
+		}
+
+		::close(conn);
+	}
+#endif
+}
+
+int srv_request(const std::string &socket_name, int argc, char **argv)
+{
+#ifdef _WIN32
+	errno = ENOSYS;
+	return -1;
+#else
+	sockaddr_un addr;
+
+	if(!srv_make_addr(socket_name, addr))
+	{
+		return -1;
+	}
+
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+	{
+		return -1;
+	}
+
+	if(::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+	{
+		::close(fd);
+		return -1;
+	}
+
+	// current directory
+	std::vector<char> cwd(256);
+	while(::getcwd(cwd.data(), cwd.size()) == nullptr)
+	{
+		if(errno != ERANGE)
+		{
+			::close(fd);
+			return -1;
+		}
+		cwd.resize(cwd.size() * 2);
+	}
+
+	// pass standard streams to server
+	char c = 0;
+	iovec iov = { &c, 1 };
+	alignas(cmsghdr) char cbuf[CMSG_SPACE(sizeof(int) * SRV_FDS_NUM)];
+	msghdr msg;
+
+	std::memset(&msg, 0, sizeof(msg));
+	std::memset(cbuf, 0, sizeof(cbuf));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = cbuf;
+	msg.msg_controllen = sizeof(cbuf);
+
+	auto cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(int) * SRV_FDS_NUM);
+	int fds[SRV_FDS_NUM] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+	std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	std::fflush(stdout);
+	std::fflush(stderr);
+
+	uint32_t args_num = argc;
+	bool sent = ::sendmsg(fd, &msg, 0) == 1 && srv_write_str(fd, cwd.data()) && srv_write(fd, &args_num, sizeof(args_num));
+	for(int i = 0; sent && i < argc; i++)
+	{
+		sent = srv_write_str(fd, argv[i]);
+	}
+
+	if(!sent)
+	{
+		::close(fd);
+		return -1;
+	}
+
+	// wait for the request to complete
+	int32_t retcode = SRV_RES_EABORT;
+	if(!srv_read(fd, &retcode, sizeof(retcode)))
+	{
+		retcode = SRV_RES_EABORT;
+	}
+
+	::close(fd);
+
+	return retcode;
+#endif
+}
+
+int srv_run_next_stage(const std::string &exe_name, const std::vector<std::string> &args, SRV_REQ_FN local_fn)
+{
+	if(srv_next_socket_name.empty() && local_fn == nullptr)
+	{
+		return Utils::run_process(exe_name, args);
+	}
+
+	std::vector<std::string> args1;
+	std::vector<char *> argv;
+
+	args1.push_back(exe_name);
+	args1.insert(args1.end(), args.cbegin(), args.cend());
+
+	for(auto &a: args1)
+	{
+		argv.push_back(&a[0]);
+	}
+	argv.push_back(nullptr);
+
+	if(!srv_next_socket_name.empty())
+	{
+		auto retcode = srv_request(srv_next_socket_name, args1.size(), argv.data());
+		if(retcode >= 0)
+		{
+			return retcode;
+		}
+	}
+
+	if(local_fn != nullptr)
+	{
+		return local_fn(args1.size(), argv.data());
+	}
+
+	return Utils::run_process(exe_name, args);
+}
+
+std::string srv_get_opt_value(int argc, char **argv, const std::string &opt_name)
+{
+	std::string value;
+
+	for(int i = 1; i < argc - 1; i++)
+	{
+		if((argv[i][0] == '-' || argv[i][0] == '/') && Utils::str_toupper(std::string(argv[i] + 1)) == opt_name)
+		{
+			value = argv[++i];
+		}
+	}
+
+	return value;
+}
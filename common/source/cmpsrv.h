@@ -0,0 +1,41 @@
+/*
+ BASIC1 compiler
+ Copyright (c) 2021-2026 Nikolay Pletnev
+ MIT license
+
+ cmpsrv.h: compile server mode
+*/
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+// function processing single compilation request (gets the client's command line)
+typedef int (*SRV_REQ_FN)(int argc, char **argv);
+
+
+// runs compile server listening on a local (Unix domain) socket: every request is processed by a forked
+// copy of the server process so the data loaded by warm_up_fn stays resident and is shared by all requests,
+// warm_up_fn is called in the server process for every request after forking the request process, so the data
+// it loads is used starting from the next request (can be nullptr), next_socket_name is the socket of the next
+// compilation stage compile server (can be empty, see srv_run_next_stage),
+// the function returns -1 on error only (errno is set)
+extern int srv_run(const std::string &socket_name, const std::string &next_socket_name, SRV_REQ_FN req_fn, SRV_REQ_FN warm_up_fn);
+
+// sends the command line to the compile server and waits for the request to complete, the server
+// writes to the client's standard output and error streams, the function returns the request exit code
+// or -1 if the server is not available
+extern int srv_request(const std::string &socket_name, int argc, char **argv);
+
+// runs the next compilation stage (exe_name is the stage executable file name, args - its command line arguments):
+// in a request process of compile server started with -next-server option the command line is sent to the next
+// stage compile server, the executable is started only if the server is not available, the function returns
+// the stage exit code or -1 on error (errno is set), if local_fn is not nullptr (the stage is built into the
+// current executable) it is called with the stage command line instead of starting the executable
+extern int srv_run_next_stage(const std::string &exe_name, const std::vector<std::string> &args, SRV_REQ_FN local_fn = nullptr);
+
+// returns value of the command line option (e.g. "-m STM8S103F3" for opt_name == "M") or empty string
+extern std::string srv_get_opt_value(int argc, char **argv, const std::string &opt_name);
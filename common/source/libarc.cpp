@@ -0,0 +1,519 @@
+/*
+ BASIC1 compiler
+ Copyright (c) 2021-2026 Nikolay Pletnev
+ MIT license
+
+ libarc.cpp: library archives
+*/
+
+
+#include "libarc.h"
+#include "Utils.h"
+
+#include <cstring>
+#include <map>
+#include <filesystem>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+// archive file format:
+// header, files table (sorted by file name), data of every file padded to 4 bytes, file names
+// file data: the file converted to binary intermediate code (see b1ir.h)
+#define ARC_MAGIC 0x414C3142
+#define ARC_VERSION 4
+#define ARC_ALIGN(n) (((n) + 3) & ~(size_t)3)
+
+struct ARC_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t wchar_size;
+	uint32_t files_num;
+};
+
+struct ARC_FILE
+{
+	// hash of the original file contents
+	uint64_t hash;
+	uint32_t name_off;
+	uint32_t name_len;
+	uint32_t data_off;
+	uint32_t data_size;
+	int32_t lines_num;
+};
+
+// mapped archive file
+struct ARC_MAP
+{
+	const char *data;
+	size_t size;
+	int64_t mtime;
+	// number of LibFileReader objects reading the archived files
+	int32_t refs;
+	// the archive is changed and mapped again, the mapping is released when it is not used
+	bool replaced;
+};
+
+
+// opened archives (the latest mapping of every archive)
+static std::map<std::string, ARC_MAP *> arc_maps;
+
+
+static bool arc_map_file(const std::string &arc_file_name, ARC_MAP &map)
+{
+#ifdef _WIN32
+	auto fh = ::CreateFileA(arc_file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(fh == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if(!::GetFileSizeEx(fh, &size) || size.QuadPart < (LONGLONG)sizeof(ARC_HEADER))
+	{
+		::CloseHandle(fh);
+		return false;
+	}
+
+	auto mh = ::CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+	::CloseHandle(fh);
+	if(mh == NULL)
+	{
+		return false;
+	}
+
+	auto data = ::MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+	::CloseHandle(mh);
+	if(data == NULL)
+	{
+		return false;
+	}
+
+	map.data = static_cast<const char *>(data);
+	map.size = size.QuadPart;
+#else
+	int fd = ::open(arc_file_name.c_str(), O_RDONLY);
+	if(fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if(::fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ARC_HEADER))
+	{
+		::close(fd);
+		return false;
+	}
+
+	auto data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	map.data = static_cast<const char *>(data);
+	map.size = st.st_size;
+#endif
+
+	// check header and files table
+	auto hdr = reinterpret_cast<const ARC_HEADER *>(map.data);
+	bool valid = hdr->magic == ARC_MAGIC && hdr->version == ARC_VERSION && hdr->wchar_size == sizeof(wchar_t) &&
+		hdr->files_num <= (map.size - sizeof(ARC_HEADER)) / sizeof(ARC_FILE);
+
+	auto files = reinterpret_cast<const ARC_FILE *>(map.data + sizeof(ARC_HEADER));
+	for(uint32_t i = 0; valid && i < hdr->files_num; i++)
+	{
+		valid =	(uint64_t)files[i].name_off + files[i].name_len <= map.size &&
+				(uint64_t)files[i].data_off + files[i].data_size <= map.size &&
+				files[i].data_off % 4 == 0;
+	}
+
+	if(!valid)
+	{
+#ifdef _WIN32
+		::UnmapViewOfFile(map.data);
+#else
+		::munmap(const_cast<char *>(map.data), map.size);
+#endif
+		return false;
+	}
+
+	return true;
+}
+
+static void arc_unmap_file(ARC_MAP *map)
+{
+#ifdef _WIN32
+	::UnmapViewOfFile(map->data);
+#else
+	::munmap(const_cast<char *>(map->data), map->size);
+#endif
+
+	delete map;
+}
+
+// releases archive mapping used by LibFileReader object
+static void arc_release_map(ARC_MAP *map)
+{
+	if(--map->refs == 0 && map->replaced)
+	{
+		arc_unmap_file(map);
+	}
+}
+
+// returns archive file mapping (the archive is mapped on the first call or if it is changed)
+static ARC_MAP *arc_get_map(const std::string &arc_file_name)
+{
+	std::error_code ec;
+	auto wt = std::filesystem::last_write_time(arc_file_name, ec);
+	if(ec)
+	{
+		return nullptr;
+	}
+
+	int64_t mtime = wt.time_since_epoch().count();
+
+	auto am = arc_maps.find(arc_file_name);
+	if(am != arc_maps.end() && am->second->mtime == mtime)
+	{
+		return am->second;
+	}
+
+	ARC_MAP map;
+	if(!arc_map_file(arc_file_name, map))
+	{
+		return nullptr;
+	}
+
+	map.mtime = mtime;
+	map.refs = 0;
+	map.replaced = false;
+
+	if(am == arc_maps.end())
+	{
+		am = arc_maps.emplace(arc_file_name, nullptr).first;
+	}
+	else
+	if(am->second->refs == 0)
+	{
+		arc_unmap_file(am->second);
+	}
+	else
+	{
+		// the archived files are being read, the previous mapping is released by the last reader
+		am->second->replaced = true;
+	}
+
+	am->second = new ARC_MAP(map);
+
+	return am->second;
+}
+
+// splits archived file name into archive file name, the archived file name itself and name of the regular
+// file the archived one is created from
+static bool arc_split_file_name(const std::string &file_name, std::string &arc_file_name, std::string &name, std::string &reg_file_name)
+{
+	const std::string arc_dir = std::string(B1_LIB_ARC_FILE_NAME) + "/";
+
+	auto pos = file_name.rfind(arc_dir);
+	if(pos == std::string::npos || (pos != 0 && file_name[pos - 1] != '/' && file_name[pos - 1] != '\\'))
+	{
+		return false;
+	}
+
+	arc_file_name = file_name.substr(0, pos + arc_dir.length() - 1);
+	name = file_name.substr(pos + arc_dir.length());
+	reg_file_name = file_name.substr(0, pos) + name;
+
+	return true;
+}
+
+// checks whether the regular file is changed after the archive creation (is newer than the archive), the file
+// contents are not compared so a library copied without preserving modification times is read from regular files
+// until the archive is re-created
+static bool arc_file_is_stale(const std::string &reg_file_name, const ARC_MAP &map)
+{
+	std::error_code ec;
+
+	auto wt = std::filesystem::last_write_time(reg_file_name, ec);
+	if(ec)
+	{
+		// there's no regular file, use the archived one
+		return false;
+	}
+
+	return wt.time_since_epoch().count() > map.mtime;
+}
+
+// looks for the archived file, returns nullptr if the file is not archived or the regular file it is created from
+// is changed, reg_file_name is set to name of the regular file to read then
+static const ARC_FILE *arc_find_file(const std::string &file_name, ARC_MAP **arc_map, std::string &reg_file_name)
+{
+	std::string arc_file_name, name;
+
+	reg_file_name = file_name;
+
+	if(!arc_split_file_name(file_name, arc_file_name, name, reg_file_name))
+	{
+		return nullptr;
+	}
+
+	auto map = arc_get_map(arc_file_name);
+	if(map == nullptr)
+	{
+		return nullptr;
+	}
+
+	auto hdr = reinterpret_cast<const ARC_HEADER *>(map->data);
+	auto files = reinterpret_cast<const ARC_FILE *>(map->data + sizeof(ARC_HEADER));
+	auto files_end = files + hdr->files_num;
+
+	auto file = std::lower_bound(files, files_end, name,
+		[map](const ARC_FILE &f, const std::string &n) { return std::string(map->data + f.name_off, f.name_len) < n; });
+	if(file == files_end || std::string(map->data + file->name_off, file->name_len) != name || arc_file_is_stale(reg_file_name, *map))
+	{
+		return nullptr;
+	}
+
+	*arc_map = map;
+
+	return file;
+}
+
+B1_T_ERROR arc_create(const std::string &lib_dir, const ARC_CONV_FN &conv_fn, std::string &err_file_name)
+{
+	std::error_code ec;
+	std::vector<std::string> file_names;
+
+	for(std::filesystem::directory_iterator di(lib_dir, ec), end; !ec && di != end; di.increment(ec))
+	{
+		if(di->is_regular_file(ec) && Utils::str_toupper(di->path().extension().string()) == ".B1C")
+		{
+			file_names.push_back(di->path().filename().string());
+		}
+	}
+
+	if(ec)
+	{
+		err_file_name = lib_dir;
+		return B1_RES_EENVFAT;
+	}
+
+	std::sort(file_names.begin(), file_names.end());
+
+	const auto dir = (lib_dir.empty() || lib_dir.back() == '/' || lib_dir.back() == '\\') ? lib_dir : (lib_dir + "/");
+
+	ARC_HEADER hdr = { ARC_MAGIC, ARC_VERSION, sizeof(wchar_t), (uint32_t)file_names.size() };
+	std::vector<ARC_FILE> files(file_names.size());
+	std::vector<char> data, file_data;
+	std::string names;
+
+	size_t data_off = sizeof(hdr) + files.size() * sizeof(ARC_FILE);
+
+	for(size_t i = 0; i < file_names.size(); i++)
+	{
+		auto &f = files[i];
+
+		std::memset(&f, 0, sizeof(f));
+
+		if(!Utils::file_hash(dir + file_names[i], f.hash))
+		{
+			err_file_name = dir + file_names[i];
+			return B1_RES_EENVFAT;
+		}
+
+		auto err = conv_fn(dir + file_names[i], file_data, f.lines_num);
+		if(err != B1_RES_OK)
+		{
+			err_file_name = dir + file_names[i];
+			return err;
+		}
+
+		f.data_off = data_off + data.size();
+		f.data_size = file_data.size();
+		f.name_len = file_names[i].length();
+		names += file_names[i];
+
+		data.insert(data.end(), file_data.cbegin(), file_data.cend());
+		data.resize(ARC_ALIGN(data.size()));
+	}
+
+	size_t names_off = data_off + data.size();
+	for(auto &f: files)
+	{
+		f.name_off = names_off;
+		names_off += f.name_len;
+	}
+
+	// write to a temporary file first not to let concurrent builds read incomplete data
+	const auto arc_file_name = dir + B1_LIB_ARC_FILE_NAME;
+	const auto tmp_file_name = arc_file_name + ".tmp";
+
+	std::FILE *fp = std::fopen(tmp_file_name.c_str(), "wb");
+	if(fp == nullptr)
+	{
+		err_file_name = tmp_file_name;
+		return B1_RES_EENVFAT;
+	}
+
+	bool res =	std::fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+				(files.empty() || std::fwrite(files.data(), files.size() * sizeof(ARC_FILE), 1, fp) == 1) &&
+				(data.empty() || std::fwrite(data.data(), data.size(), 1, fp) == 1) &&
+				(names.empty() || std::fwrite(names.data(), names.size(), 1, fp) == 1);
+
+	res = (std::fclose(fp) == 0) && res;
+
+	if(res)
+	{
+		std::filesystem::rename(tmp_file_name, arc_file_name, ec);
+		res = !ec;
+	}
+
+	if(!res)
+	{
+		std::filesystem::remove(tmp_file_name, ec);
+		err_file_name = arc_file_name;
+		return B1_RES_EENVFAT;
+	}
+
+	return B1_RES_OK;
+}
+
+bool arc_get_file_names(const std::string &arc_file_name, std::vector<std::string> &file_names)
+{
+	file_names.clear();
+
+	auto map = arc_get_map(arc_file_name);
+	if(map == nullptr)
+	{
+		return false;
+	}
+
+	auto hdr = reinterpret_cast<const ARC_HEADER *>(map->data);
+	auto files = reinterpret_cast<const ARC_FILE *>(map->data + sizeof(ARC_HEADER));
+
+	for(uint32_t i = 0; i < hdr->files_num; i++)
+	{
+		file_names.emplace_back(map->data + files[i].name_off, files[i].name_len);
+	}
+
+	return true;
+}
+
+bool arc_file_hash(const std::string &file_name, uint64_t &hash)
+{
+	ARC_MAP *map = nullptr;
+	std::string reg_file_name;
+
+	auto file = arc_find_file(file_name, &map, reg_file_name);
+	if(file != nullptr)
+	{
+		hash = file->hash;
+		return true;
+	}
+
+	return Utils::file_hash(reg_file_name, hash);
+}
+
+
+LibFileReader::LibFileReader()
+: _fp(nullptr)
+, _map(nullptr)
+, _data(nullptr)
+, _size(0)
+, _line_num(0)
+, _lines_num(0)
+{
+}
+
+LibFileReader::~LibFileReader()
+{
+	Close();
+}
+
+bool LibFileReader::Open(const std::string &file_name)
+{
+	Close();
+
+	ARC_MAP *map = nullptr;
+	std::string reg_file_name;
+
+	auto file = arc_find_file(file_name, &map, reg_file_name);
+	if(file != nullptr)
+	{
+		_map = map;
+		_map->refs++;
+
+		_data = map->data + file->data_off;
+		_size = file->data_size;
+		_lines_num = file->lines_num;
+		return true;
+	}
+
+	_fp = std::fopen(reg_file_name.c_str(), "r");
+
+	return _fp != nullptr;
+}
+
+void LibFileReader::Close()
+{
+	if(_fp != nullptr)
+	{
+		std::fclose(_fp);
+		_fp = nullptr;
+	}
+
+	if(_map != nullptr)
+	{
+		arc_release_map(_map);
+		_map = nullptr;
+	}
+
+	_data = nullptr;
+	_size = 0;
+	_line_num = 0;
+	_lines_num = 0;
+}
+
+bool LibFileReader::IsArchived() const
+{
+	return _map != nullptr;
+}
+
+const char *LibFileReader::GetData(size_t &size, int32_t &lines_num) const
+{
+	size = _size;
+	lines_num = _lines_num;
+
+	return _data;
+}
+
+B1_T_ERROR LibFileReader::ReadLine(std::wstring &line, int32_t &line_num)
+{
+	line.clear();
+
+	if(_fp == nullptr)
+	{
+		line_num = _line_num;
+		return B1_RES_EENVFAT;
+	}
+
+	auto err = Utils::read_line(_fp, line);
+	if(err == B1_RES_OK || (err == B1_RES_EEOF && !line.empty()))
+	{
+		_line_num++;
+	}
+
+	line_num = _line_num;
+	return err;
+}
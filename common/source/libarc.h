@@ -0,0 +1,78 @@
+/*
+ BASIC1 compiler
+ Copyright (c) 2021-2026 Nikolay Pletnev
+ MIT license
+
+ libarc.h: library archives
+*/
+
+
+#pragma once
+
+extern "C"
+{
+#include "b1err.h"
+}
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+
+
+// library archive file name: the archive contains all .b1c files of the library directory it is placed in,
+// archived files have precedence over regular files of the same directory unless a regular file is changed
+// after the archive creation (its modification time is later than the archive's one), the archived files names
+// look like <lib_dir>/lib.b1a/<file_name>
+#define B1_LIB_ARC_FILE_NAME "lib.b1a"
+
+
+// converts library file to the form it is stored in archive (binary intermediate code, see b1ir.h),
+// lines_num is set to number of the file lines
+typedef std::function<B1_T_ERROR(const std::string &file_name, std::vector<char> &data, int32_t &lines_num)> ARC_CONV_FN;
+
+struct ARC_MAP;
+
+
+// creates archive of all .b1c files of the library directory, err_file_name is set to the name of
+// a file that cannot be read, converted or written
+extern B1_T_ERROR arc_create(const std::string &lib_dir, const ARC_CONV_FN &conv_fn, std::string &err_file_name);
+
+// gets names of the archived files (empty list if there's no valid archive)
+extern bool arc_get_file_names(const std::string &arc_file_name, std::vector<std::string> &file_names);
+
+// calculates hash of a library file contents (archived or regular one)
+extern bool arc_file_hash(const std::string &file_name, uint64_t &hash);
+
+
+// reads a library file (archived or regular one): archived files are stored in binary intermediate code form
+// (read it with B1IRReader), regular files are read line by line, the archive stays mapped while it is read
+class LibFileReader
+{
+protected:
+	std::FILE *_fp;
+
+	ARC_MAP *_map;
+	const char *_data;
+	size_t _size;
+
+	int32_t _line_num;
+	int32_t _lines_num;
+
+
+public:
+	LibFileReader();
+	~LibFileReader();
+
+	bool Open(const std::string &file_name);
+	void Close();
+
+	bool IsArchived() const;
+	// returns archived file data and number of lines of the original file
+	const char *GetData(size_t &size, int32_t &lines_num) const;
+
+	// reads a line of regular file, the same as Utils::read_line() but returns number of the line read as well
+	// (or total number of lines on EOF)
+	B1_T_ERROR ReadLine(std::wstring &line, int32_t &line_num);
+};
@@ -0,0 +1,301 @@
+/*
+ BASIC1 compiler
+ Copyright (c) 2021-2026 Nikolay Pletnev
+ MIT license
+
+ timerep.cpp: compilation stages time and memory usage report
+*/
+
+
+#include "timerep.h"
+#include "version.h"
+
+#include <vector>
+#include <chrono>
+#include <iterator>
+#include <algorithm>
+#include <mutex>
+
+#ifdef _WIN32
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+struct TREP_STAGE
+{
+	std::string name;
+	int64_t calls;
+	// wall time, ns
+	int64_t time;
+	int64_t max_time;
+	// process peak memory usage at the stage end and peak memory increase during the stage, kB
+	int64_t peak_mem;
+	int64_t mem_inc;
+};
+
+struct TREP_PASS
+{
+	std::string name;
+	int64_t runs;
+	// runs that changed code
+	int64_t changes;
+	// wall time, ns
+	int64_t time;
+	int64_t max_time;
+};
+
+
+// report of a tool saved by trep_push()
+struct TREP_REPORT
+{
+	const char *tool_name;
+	bool on;
+	int64_t start_time;
+	int depth;
+	std::vector<TREP_STAGE> stages;
+	std::vector<TREP_PASS> passes;
+};
+
+
+// name of the tool the report is written for
+static const char *trep_tool_name = B1_PROJECT_NAME;
+static bool trep_on = false;
+static int64_t trep_start_time = 0;
+// number of the stages being measured by the current thread (including nested ones)
+static thread_local int trep_depth = 0;
+// stages in order of their first calls, a stage running in several threads at once sums the threads' times
+static std::vector<TREP_STAGE> trep_stages;
+// optimization passes in order of their first runs
+static std::vector<TREP_PASS> trep_passes;
+static std::mutex trep_mutex;
+static std::vector<TREP_REPORT> trep_saved;
+
+
+static int64_t trep_get_time()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// returns process peak memory usage (resident set size), kB
+static int64_t trep_get_peak_mem()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc;
+	if(!::GetProcessMemoryInfo(::GetCurrentProcess(), &pmc, sizeof(pmc)))
+	{
+		return 0;
+	}
+	return pmc.PeakWorkingSetSize / 1024;
+#else
+	struct rusage ru;
+	if(::getrusage(RUSAGE_SELF, &ru) != 0)
+	{
+		return 0;
+	}
+#ifdef __APPLE__
+	// macOS reports the value in bytes
+	return ru.ru_maxrss / 1024;
+#else
+	return ru.ru_maxrss;
+#endif
+#endif
+}
+
+void trep_enable()
+{
+	trep_on = true;
+	trep_start_time = trep_get_time();
+	trep_depth = 0;
+	trep_stages.clear();
+	trep_passes.clear();
+}
+
+bool trep_enabled()
+{
+	return trep_on;
+}
+
+void trep_push(const char *tool_name)
+{
+	trep_saved.push_back(TREP_REPORT { trep_tool_name, trep_on, trep_start_time, trep_depth, std::move(trep_stages), std::move(trep_passes) });
+
+	trep_tool_name = tool_name;
+	trep_on = false;
+	trep_start_time = 0;
+	trep_depth = 0;
+	trep_stages.clear();
+	trep_passes.clear();
+}
+
+void trep_pop()
+{
+	if(trep_saved.empty())
+	{
+		return;
+	}
+
+	auto &r = trep_saved.back();
+
+	trep_tool_name = r.tool_name;
+	trep_on = r.on;
+	trep_start_time = r.start_time;
+	trep_depth = r.depth;
+	trep_stages = std::move(r.stages);
+	trep_passes = std::move(r.passes);
+
+	trep_saved.pop_back();
+}
+
+void trep_print(std::FILE *fstr)
+{
+	const double total_time = (trep_get_time() - trep_start_time) / 1e6;
+
+	std::fprintf(fstr, "time report (%s):\n", trep_tool_name);
+	std::fprintf(fstr, "%-24s %8s %12s %12s %14s %14s\n", "stage", "calls", "time, ms", "max, ms", "peak mem, kB", "mem inc, kB");
+
+	for(const auto &s: trep_stages)
+	{
+		std::fprintf(fstr, "%-24s %8lld %12.3f %12.3f %14lld %14lld\n", s.name.c_str(), (long long)s.calls, s.time / 1e6, s.max_time / 1e6, (long long)s.peak_mem, (long long)s.mem_inc);
+	}
+
+	std::fprintf(fstr, "%-24s %8s %12.3f %12s %14lld\n", "total", "", total_time, "", (long long)trep_get_peak_mem());
+
+	if(!trep_passes.empty())
+	{
+		std::fprintf(fstr, "%-24s %8s %8s %12s %12s\n", "pass", "runs", "changes", "time, ms", "max, ms");
+
+		for(const auto &p: trep_passes)
+		{
+			std::fprintf(fstr, "%-24s %8lld %8lld %12.3f %12.3f\n", p.name.c_str(), (long long)p.runs, (long long)p.changes, p.time / 1e6, p.max_time / 1e6);
+		}
+	}
+}
+
+bool trep_write_json(const std::string &file_name)
+{
+	const double total_time = (trep_get_time() - trep_start_time) / 1e6;
+
+	std::FILE *fp = std::fopen(file_name.c_str(), "a");
+	if(fp == nullptr)
+	{
+		return false;
+	}
+
+	// stage names are identifiers so they need no escaping
+	std::fprintf(fp, "{\"tool\":\"%s\",\"version\":\"%s\",\"stages\":[", trep_tool_name, B1_CMP_VERSION);
+
+	for(auto s = trep_stages.cbegin(); s != trep_stages.cend(); s++)
+	{
+		std::fprintf(fp, "%s{\"name\":\"%s\",\"calls\":%lld,\"time_ms\":%.3f,\"max_time_ms\":%.3f,\"peak_mem_kb\":%lld,\"mem_inc_kb\":%lld}",
+			s == trep_stages.cbegin() ? "" : ",", s->name.c_str(), (long long)s->calls, s->time / 1e6, s->max_time / 1e6, (long long)s->peak_mem, (long long)s->mem_inc);
+	}
+
+	std::fprintf(fp, "],\"passes\":[");
+
+	for(auto p = trep_passes.cbegin(); p != trep_passes.cend(); p++)
+	{
+		std::fprintf(fp, "%s{\"name\":\"%s\",\"runs\":%lld,\"changes\":%lld,\"time_ms\":%.3f,\"max_time_ms\":%.3f}",
+			p == trep_passes.cbegin() ? "" : ",", p->name.c_str(), (long long)p->runs, (long long)p->changes, p->time / 1e6, p->max_time / 1e6);
+	}
+
+	std::fprintf(fp, "],\"total_time_ms\":%.3f,\"peak_mem_kb\":%lld}\n", total_time, (long long)trep_get_peak_mem());
+
+	return std::fclose(fp) == 0;
+}
+
+
+TRepStage::TRepStage(const char *stage_name)
+: _enabled(trep_on)
+, _stage(-1)
+, _start_time(0)
+, _start_mem(0)
+{
+	if(!_enabled || trep_depth++ > 0)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(trep_mutex);
+
+	auto s = std::find_if(trep_stages.begin(), trep_stages.end(), [stage_name](const TREP_STAGE &s) { return s.name == stage_name; });
+	if(s == trep_stages.end())
+	{
+		trep_stages.push_back(TREP_STAGE { stage_name, 0, 0, 0, 0, 0 });
+		s = std::prev(trep_stages.end());
+	}
+
+	_stage = s - trep_stages.begin();
+	_start_mem = trep_get_peak_mem();
+	_start_time = trep_get_time();
+}
+
+TRepStage::~TRepStage()
+{
+	if(!_enabled)
+	{
+		return;
+	}
+
+	trep_depth--;
+
+	if(_stage < 0)
+	{
+		return;
+	}
+
+	const auto time = trep_get_time() - _start_time;
+	const auto peak_mem = trep_get_peak_mem();
+
+	std::lock_guard<std::mutex> lock(trep_mutex);
+
+	auto &s = trep_stages[_stage];
+	s.calls++;
+	s.time += time;
+	s.max_time = std::max(s.max_time, time);
+	s.peak_mem = std::max(s.peak_mem, peak_mem);
+	s.mem_inc += peak_mem - _start_mem;
+}
+
+
+TRepPass::TRepPass(const char *pass_name)
+: _enabled(trep_on)
+, _pass_name(pass_name)
+, _start_time(0)
+, changed(false)
+{
+	if(_enabled)
+	{
+		_start_time = trep_get_time();
+	}
+}
+
+TRepPass::~TRepPass()
+{
+	if(!_enabled)
+	{
+		return;
+	}
+
+	const auto time = trep_get_time() - _start_time;
+
+	std::lock_guard<std::mutex> lock(trep_mutex);
+
+	auto p = std::find_if(trep_passes.begin(), trep_passes.end(), [this](const TREP_PASS &p) { return p.name == _pass_name; });
+	if(p == trep_passes.end())
+	{
+		trep_passes.push_back(TREP_PASS { _pass_name, 0, 0, 0, 0 });
+		p = std::prev(trep_passes.end());
+	}
+
+	p->runs++;
+	if(changed)
+	{
+		p->changes++;
+	}
+	p->time += time;
+	p->max_time = std::max(p->max_time, time);
+}
@@ -0,0 +1,69 @@
+/*
+ BASIC1 compiler
+ Copyright (c) 2021-2026 Nikolay Pletnev
+ MIT license
+
+ timerep.h: compilation stages time and memory usage report
+*/
+
+
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+
+
+// enables (and resets) collecting of compilation stages statistics
+extern void trep_enable();
+
+extern bool trep_enabled();
+
+// saves the current statistics and starts a new report of another tool running in the same process (the
+// built-in assembler), the tool's report is disabled until it calls trep_enable()
+extern void trep_push(const char *tool_name);
+
+// discards the report started by trep_push() and restores the saved one
+extern void trep_pop();
+
+// prints statistics in human-readable form
+extern void trep_print(std::FILE *fstr);
+
+// appends statistics to the file as a single line JSON object (so the file gets report of every tool run)
+extern bool trep_write_json(const std::string &file_name);
+
+
+// measures wall time and peak memory usage of a compilation stage from construction to destruction,
+// a stage started within another one is counted as a part of the outer stage, the class does nothing
+// if time report is disabled
+class TRepStage
+{
+protected:
+	bool _enabled;
+	int _stage;
+	int64_t _start_time;
+	int64_t _start_mem;
+
+
+public:
+	TRepStage(const char *stage_name);
+	~TRepStage();
+};
+
+// measures a run of an optimization pass: passes run within stages so they are reported separately
+// (number of runs, runs that changed code and wall time), the class does nothing if time report is disabled
+class TRepPass
+{
+protected:
+	bool _enabled;
+	const char *_pass_name;
+	int64_t _start_time;
+
+
+public:
+	// the pass changed code
+	bool changed;
+
+	TRepPass(const char *pass_name);
+	~TRepPass();
+};
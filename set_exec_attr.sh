@@ -4,6 +4,7 @@ chmod 755 ./a1stm8/build/*.sh
 chmod 755 ./b1c/build/*.sh
 chmod 755 ./c1stm8/build/*.sh
 chmod 755 ./a1rv32/build/*.sh
+chmod 755 ./bench/*.sh
 chmod 755 ./common/build/*.sh
 chmod 755 ./common/setup/*.sh
 chmod 755 ./distr/*.sh